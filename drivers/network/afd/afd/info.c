@@ -10,6 +10,8 @@
 
 #include "afd.h"
 
+#include <tdiinfo.h>
+
 NTSTATUS NTAPI
 AfdGetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
             PIO_STACK_LOCATION IrpSp ) {
@@ -106,6 +108,7 @@ AfdSetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
     PFILE_OBJECT FileObject = IrpSp->FileObject;
     PAFD_FCB FCB = FileObject->FsContext;
     PCHAR NewBuffer;
+    ULONG WindowSize;
 
     UNREFERENCED_PARAMETER(DeviceObject);
 
@@ -163,6 +166,26 @@ AfdSetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
                     {
                         Status = STATUS_SUCCESS;
                     }
+
+                    /* Size the receive window of the transport as well, so that
+                     * it doesn't buffer more than that behind our back. This
+                     * goes to the connection object, accepted sockets included */
+                    if (NT_SUCCESS(Status) &&
+                        !(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS) &&
+                        FCB->Connection.Object &&
+                        InfoReq->Information.Ulong > 0)
+                    {
+                        WindowSize = InfoReq->Information.Ulong;
+                        if (!NT_SUCCESS(TdiSetInformationEx(FCB->Connection.Object,
+                                                            INFO_CLASS_PROTOCOL,
+                                                            INFO_TYPE_CONNECTION,
+                                                            TCP_SOCKET_WINDOW,
+                                                            &WindowSize,
+                                                            sizeof(WindowSize))))
+                        {
+                            AFD_DbgPrint(MIN_TRACE,("Transport didn't take the window size %u\n", WindowSize));
+                        }
+                    }
                 }
                 else
                 {
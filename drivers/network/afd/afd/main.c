@@ -367,6 +367,8 @@ AfdCreateSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
     InitializeListHead( &FCB->DatagramList );
     InitializeListHead( &FCB->PendingConnections );
+    InitializeListHead( &FCB->PollWaitList );
+    InitializeListHead( &FCB->PollSetMembers );
 
     AFD_DbgPrint(MID_TRACE,("%p: Checking command channel\n", FCB));
 
@@ -492,6 +494,8 @@ AfdCloseSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
     KillSelectsForFCB( FCB->DeviceExt, FileObject, FALSE );
 
+    ASSERT(IsListEmpty(&FCB->PollWaitList));
+    ASSERT(IsListEmpty(&FCB->PollSetMembers));
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_CONNECT]));
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]));
     ASSERT(IsListEmpty(&FCB->PendingIrpList[FUNCTION_RECV]));
@@ -971,6 +975,12 @@ AfdDispatch(PDEVICE_OBJECT DeviceObject, PIRP Irp)
         case IOCTL_AFD_ENUM_NETWORK_EVENTS:
             return AfdEnumEvents( DeviceObject, Irp, IrpSp );
 
+        case IOCTL_AFD_POLL_SET_CONTROL:
+            return AfdPollSetControl( DeviceObject, Irp, IrpSp );
+
+        case IOCTL_AFD_POLL_SET_WAIT:
+            return AfdPollSetWait( DeviceObject, Irp, IrpSp );
+
         case IOCTL_AFD_RECV_DATAGRAM:
             return AfdPacketSocketReadData( DeviceObject, Irp, IrpSp );
 
@@ -1267,6 +1277,12 @@ AfdCancelHandler(PDEVICE_OBJECT DeviceObject,
             DbgPrint("WARNING!!! IRP cancellation race could lead to a process hang! (IOCTL_AFD_SELECT)\n");
             return;
 
+        case IOCTL_AFD_POLL_SET_WAIT:
+            /* The completion paths leave the IRP to us once we own it */
+            PollSetCancelWait(DeviceExt, FCB, Irp);
+            SocketStateUnlock(FCB);
+            return;
+
         case IOCTL_AFD_DISCONNECT:
             Function = FUNCTION_DISCONNECT;
             break;
@@ -1343,6 +1359,7 @@ DriverEntry(PDRIVER_OBJECT DriverObject, PUNICODE_STRING RegistryPath)
     DeviceExt = DeviceObject->DeviceExtension;
     KeInitializeSpinLock( &DeviceExt->Lock );
     InitializeListHead( &DeviceExt->Polls );
+    InitializeListHead( &DeviceExt->PollSetCancelling );
 
     AFD_DbgPrint(MID_TRACE,("Device created: object %p ext %p\n",
                             DeviceObject, DeviceExt));
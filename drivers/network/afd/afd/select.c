@@ -68,6 +68,8 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        for( i = 0; i < PollReq->HandleCount; i++ )
+            RemoveEntryList( &Poll->WaitBlocks[i].ListEntry );
         ExFreePoolWithTag(Poll, TAG_AFD_ACTIVE_POLL);
     }
 
@@ -122,37 +124,59 @@ static VOID NTAPI SelectTimeout( PKDPC Dpc,
     AFD_DbgPrint(MID_TRACE,("Timeout\n"));
 }
 
+static VOID PollSetFreeMember( PAFD_POLL_SET_MEMBER Member );
+static VOID PollSetDestroy( PAFD_POLL_SET Set );
+
 VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         PFILE_OBJECT FileObject,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
+    LIST_ENTRY KillList;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
 
+    InitializeListHead( &KillList );
+
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
+    /* A poll can wait on the same socket more than once, so collect
+     * them first: signalling one unlinks all of its wait blocks */
+    ListEntry = FCB->PollWaitList.Flink;
+    while ( ListEntry != &FCB->PollWaitList ) {
+        WaitBlock = CONTAINING_RECORD(ListEntry, AFD_POLL_WAIT_BLOCK, ListEntry);
+        Poll = WaitBlock->Poll;
         ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
 
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
+        if( Poll->Signalled || (OnlyExclusive && !Poll->Exclusive) )
+            continue;
+
+        Poll->Signalled = TRUE;
+        RemoveEntryList( &Poll->ListEntry );
+        InsertTailList( &KillList, &Poll->ListEntry );
+    }
+
+    while( !IsListEmpty( &KillList ) ) {
+        Poll = CONTAINING_RECORD(KillList.Flink, AFD_ACTIVE_POLL, ListEntry);
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+        ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+        SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
+    }
+
+    if( !OnlyExclusive ) {
+        while( !IsListEmpty( &FCB->PollSetMembers ) ) {
+            PollSetFreeMember( CONTAINING_RECORD(FCB->PollSetMembers.Flink,
+                                                 AFD_POLL_SET_MEMBER,
+                                                 FcbEntry) );
+        }
+
+        if( FCB->PollSet ) {
+            PollSetDestroy( FCB->PollSet );
+            FCB->PollSet = NULL;
         }
     }
 
@@ -189,6 +213,19 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return STATUS_NO_MEMORY;
     }
 
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
+
+        /* We are about to link into its FCB, so it had better be ours */
+        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        if( FileObject->DeviceObject != DeviceObject || !FileObject->FsContext ) {
+            AFD_DbgPrint(MIN_TRACE,("Handle %u is not a socket\n", i));
+            ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+            SignalSocket( NULL, Irp, PollReq, STATUS_INVALID_HANDLE );
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+
     if( Exclusive ) {
         for( i = 0; i < PollReq->HandleCount; i++ ) {
             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
@@ -229,13 +266,28 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
        PAFD_ACTIVE_POLL Poll = NULL;
 
        Poll = ExAllocatePoolWithTag(NonPagedPool,
-                                    sizeof(AFD_ACTIVE_POLL),
+                                    FIELD_OFFSET(AFD_ACTIVE_POLL, WaitBlocks) +
+                                    PollReq->HandleCount * sizeof(AFD_POLL_WAIT_BLOCK),
                                     TAG_AFD_ACTIVE_POLL);
 
        if (Poll){
           Poll->Irp = Irp;
           Poll->DeviceExt = DeviceExt;
           Poll->Exclusive = Exclusive;
+          Poll->Signalled = FALSE;
+
+          for( i = 0; i < PollReq->HandleCount; i++ ) {
+              Poll->WaitBlocks[i].Poll = Poll;
+
+              if( !AFD_HANDLES(PollReq)[i].Handle ) {
+                  InitializeListHead( &Poll->WaitBlocks[i].ListEntry );
+                  continue;
+              }
+
+              FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+              FCB = FileObject->FsContext;
+              InsertTailList( &FCB->PollWaitList, &Poll->WaitBlocks[i].ListEntry );
+          }
 
           KeInitializeTimerEx( &Poll->Timer, NotificationTimer );
 
@@ -404,12 +456,17 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
     return Signalled ? 1 : 0;
 }
 
+static VOID PollSetUpdateMember( PAFD_POLL_SET_MEMBER Member );
+
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
-    PLIST_ENTRY ThePollEnt = NULL;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
+    PLIST_ENTRY ListEntry;
+    LIST_ENTRY SignalList;
     PAFD_FCB FCB;
     KIRQL OldIrql;
     PAFD_POLL_INFO PollReq;
+    UINT i;
 
     AFD_DbgPrint(MID_TRACE,("Called: DeviceExt %p FileObject %p\n",
                             DeviceExt, FileObject));
@@ -424,20 +481,44 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Now signal normal select irps. Only the ones waiting on this
+     * socket can have changed, and they are all on its wait list */
+    InitializeListHead( &SignalList );
+
+    ListEntry = FCB->PollWaitList.Flink;
+    while( ListEntry != &FCB->PollWaitList ) {
+        WaitBlock = CONTAINING_RECORD( ListEntry, AFD_POLL_WAIT_BLOCK, ListEntry );
+        Poll = WaitBlock->Poll;
+        ListEntry = ListEntry->Flink;
+
+        if( Poll->Signalled ) continue;
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
-        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
         AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
-            AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
-            SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
-        } else
-            ThePollEnt = ThePollEnt->Flink;
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+        i = (UINT)(WaitBlock - Poll->WaitBlocks);
+        if( PollReq->Handles[i].Events & FCB->PollState ) {
+            Poll->Signalled = TRUE;
+            RemoveEntryList( &Poll->ListEntry );
+            InsertTailList( &SignalList, &Poll->ListEntry );
+        }
+    }
+
+    while( !IsListEmpty( &SignalList ) ) {
+        Poll = CONTAINING_RECORD( SignalList.Flink, AFD_ACTIVE_POLL, ListEntry );
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+
+        /* Report every handle that is ready, not just this one */
+        UpdatePollWithFCB( Poll, FileObject );
+        AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
+        SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
+    }
+
+    /* And the poll sets watching it */
+    ListEntry = FCB->PollSetMembers.Flink;
+    while( ListEntry != &FCB->PollSetMembers ) {
+        PollSetUpdateMember( CONTAINING_RECORD( ListEntry, AFD_POLL_SET_MEMBER, FcbEntry ) );
+        ListEntry = ListEntry->Flink;
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -453,3 +534,443 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
 
     AFD_DbgPrint(MID_TRACE,("Leaving\n"));
 }
+
+/* Persistent poll sets. Everything below runs under DeviceExt->Lock,
+ * except for the IOCTL entry points which also own the FCB state lock
+ * of the handle the set belongs to */
+
+static ULONG PollSetHarvest( PAFD_POLL_SET Set,
+                             PAFD_POLL_SET_WAIT_INFO WaitReq,
+                             ULONG MaxEntries ) {
+    PAFD_POLL_SET_MEMBER Member;
+    LIST_ENTRY Reported;
+    ULONG Count = 0, Events;
+
+    InitializeListHead( &Reported );
+
+    while( Count < MaxEntries && !IsListEmpty( &Set->ReadyMembers ) ) {
+        Member = CONTAINING_RECORD( RemoveHeadList( &Set->ReadyMembers ),
+                                    AFD_POLL_SET_MEMBER, ReadyEntry );
+
+        Events = Member->Events & Member->FCB->PollState;
+        if( !Events ) {
+            /* Not ready anymore, PollReeval queues it again once it is */
+            Member->Ready = FALSE;
+            continue;
+        }
+
+        WaitReq->Entries[Count].Handle = Member->Handle;
+        WaitReq->Entries[Count].Events = Events;
+        WaitReq->Entries[Count].Context = Member->Context;
+        Count++;
+
+        InsertTailList( &Reported, &Member->ReadyEntry );
+    }
+
+    /* Level triggered: what we reported stays queued, but behind the
+     * members that did not fit, so those come first next time */
+    while( !IsListEmpty( &Reported ) )
+        InsertTailList( &Set->ReadyMembers, RemoveHeadList( &Reported ) );
+
+    WaitReq->EntryCount = Count;
+
+    return Count;
+}
+
+/* The wait block is freed here, unless its timer is still queued: the
+ * DPC refers to it and frees it when it finds no IRP.
+ * Returns FALSE and leaves everything alone if the cancel routine has
+ * already claimed the IRP; PollSetCancelWait completes it instead. */
+static BOOLEAN PollSetCompleteWait( PAFD_POLL_SET_WAIT Wait,
+                                    NTSTATUS Status,
+                                    BOOLEAN Cancelling ) {
+    PIRP Irp = Wait->Irp;
+    PAFD_POLL_SET_WAIT_INFO WaitReq = Irp->AssociatedIrp.SystemBuffer;
+
+    if( !Cancelling && !IoSetCancelRoutine( Irp, NULL ) )
+        return FALSE;
+
+    RemoveEntryList( &Wait->ListEntry );
+    Wait->Irp = NULL;
+
+    if( Wait->TimerFired || KeCancelTimer( &Wait->Timer ) )
+        ExFreePoolWithTag( Wait, TAG_AFD_POLL_SET_WAIT );
+
+    Irp->IoStatus.Status = Status;
+    Irp->IoStatus.Information =
+        FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries) +
+        WaitReq->EntryCount * sizeof(AFD_POLL_SET_ENTRY);
+    IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+
+    return TRUE;
+}
+
+static VOID PollSetWake( PAFD_POLL_SET Set ) {
+    PAFD_POLL_SET_WAIT Wait;
+    PLIST_ENTRY ListEntry;
+
+    ListEntry = Set->Waits.Flink;
+    while( ListEntry != &Set->Waits ) {
+        Wait = CONTAINING_RECORD( ListEntry, AFD_POLL_SET_WAIT, ListEntry );
+        ListEntry = ListEntry->Flink;
+
+        if( !PollSetHarvest( Set, Wait->Irp->AssociatedIrp.SystemBuffer,
+                             Wait->MaxEntries ) )
+            break;
+
+        /* A wait being cancelled stays queued; harvesting consumed
+         * nothing, so the next one gets the same entries */
+        (void)PollSetCompleteWait( Wait, STATUS_SUCCESS, FALSE );
+    }
+}
+
+static VOID PollSetUpdateMember( PAFD_POLL_SET_MEMBER Member ) {
+    if( !(Member->Events & Member->FCB->PollState) )
+        return;
+
+    if( !Member->Ready ) {
+        Member->Ready = TRUE;
+        InsertTailList( &Member->Set->ReadyMembers, &Member->ReadyEntry );
+    }
+
+    PollSetWake( Member->Set );
+}
+
+static VOID PollSetFreeMember( PAFD_POLL_SET_MEMBER Member ) {
+    RemoveEntryList( &Member->SetEntry );
+    RemoveEntryList( &Member->FcbEntry );
+    if( Member->Ready )
+        RemoveEntryList( &Member->ReadyEntry );
+
+    ExFreePoolWithTag( Member, TAG_AFD_POLL_SET_MEMBER );
+}
+
+static VOID PollSetDestroy( PAFD_POLL_SET Set ) {
+    PAFD_POLL_SET_WAIT Wait;
+    PAFD_POLL_SET_WAIT_INFO WaitReq;
+
+    while( !IsListEmpty( &Set->Waits ) ) {
+        Wait = CONTAINING_RECORD( Set->Waits.Flink, AFD_POLL_SET_WAIT, ListEntry );
+        WaitReq = Wait->Irp->AssociatedIrp.SystemBuffer;
+        WaitReq->EntryCount = 0;
+        if( !PollSetCompleteWait( Wait, STATUS_CANCELLED, FALSE ) ) {
+            /* Keep it where the cancel routine can still find it */
+            RemoveEntryList( &Wait->ListEntry );
+            InsertTailList( &Set->DeviceExt->PollSetCancelling,
+                            &Wait->ListEntry );
+        }
+    }
+
+    while( !IsListEmpty( &Set->Members ) ) {
+        PollSetFreeMember( CONTAINING_RECORD( Set->Members.Flink,
+                                              AFD_POLL_SET_MEMBER, SetEntry ) );
+    }
+
+    ExFreePoolWithTag( Set, TAG_AFD_POLL_SET );
+}
+
+static KDEFERRED_ROUTINE PollSetTimeout;
+static VOID NTAPI PollSetTimeout( PKDPC Dpc,
+                                  PVOID DeferredContext,
+                                  PVOID SystemArgument1,
+                                  PVOID SystemArgument2 ) {
+    PAFD_POLL_SET_WAIT Wait = DeferredContext;
+    PAFD_DEVICE_EXTENSION DeviceExt = Wait->DeviceExt;
+    PAFD_POLL_SET_WAIT_INFO WaitReq;
+    KIRQL OldIrql;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    if( !Wait->Irp ) {
+        /* Completed while we were queued */
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+        ExFreePoolWithTag( Wait, TAG_AFD_POLL_SET_WAIT );
+        return;
+    }
+
+    /* Whoever completes the IRP frees the wait block now */
+    Wait->TimerFired = TRUE;
+
+    WaitReq = Wait->Irp->AssociatedIrp.SystemBuffer;
+    WaitReq->EntryCount = 0;
+    (void)PollSetCompleteWait( Wait, STATUS_TIMEOUT, FALSE );
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+}
+
+/* Called with the FCB state lock held, which keeps FCB->PollSet stable */
+static PAFD_POLL_SET PollSetGet( PAFD_DEVICE_EXTENSION DeviceExt, PAFD_FCB FCB ) {
+    PAFD_POLL_SET Set = FCB->PollSet;
+
+    if( Set ) return Set;
+
+    Set = ExAllocatePoolWithTag( NonPagedPool, sizeof(AFD_POLL_SET),
+                                 TAG_AFD_POLL_SET );
+    if( !Set ) return NULL;
+
+    InitializeListHead( &Set->Members );
+    InitializeListHead( &Set->ReadyMembers );
+    InitializeListHead( &Set->Waits );
+    Set->DeviceExt = DeviceExt;
+
+    FCB->PollSet = Set;
+
+    return Set;
+}
+
+NTSTATUS NTAPI
+AfdPollSetControl( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                   PIO_STACK_LOCATION IrpSp ) {
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    PAFD_FCB FCB = FileObject->FsContext;
+    PAFD_DEVICE_EXTENSION DeviceExt = DeviceObject->DeviceExtension;
+    PAFD_POLL_SET_CONTROL_INFO ControlReq = Irp->AssociatedIrp.SystemBuffer;
+    PAFD_POLL_SET Set;
+    PAFD_POLL_SET_MEMBER Member = NULL, NewMember = NULL;
+    PFILE_OBJECT SocketObject;
+    PAFD_FCB SocketFCB;
+    PLIST_ENTRY ListEntry;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
+
+    if( IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(*ControlReq) ||
+        (ControlReq->Operation != AFD_POLL_SET_ADD &&
+         ControlReq->Operation != AFD_POLL_SET_MODIFY &&
+         ControlReq->Operation != AFD_POLL_SET_REMOVE) ) {
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_PARAMETER, Irp, 0 );
+    }
+
+    AFD_DbgPrint(MID_TRACE,("Called (Operation %u Handle %p Events %x)\n",
+                            ControlReq->Operation,
+                            (PVOID)ControlReq->Handle,
+                            ControlReq->Events));
+
+    Status = ObReferenceObjectByHandle( (HANDLE)ControlReq->Handle,
+                                        0,
+                                        *IoFileObjectType,
+                                        Irp->RequestorMode,
+                                        (PVOID *)&SocketObject,
+                                        NULL );
+    if( !NT_SUCCESS(Status) )
+        return UnlockAndMaybeComplete( FCB, Status, Irp, 0 );
+
+    /* Only our own sockets have a poll state, and a set can't watch itself */
+    if( SocketObject->DeviceObject != DeviceObject ||
+        SocketObject == FileObject ||
+        !SocketObject->FsContext ) {
+        ObDereferenceObject( SocketObject );
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_HANDLE, Irp, 0 );
+    }
+
+    SocketFCB = SocketObject->FsContext;
+
+    Set = PollSetGet( DeviceExt, FCB );
+    if( ControlReq->Operation == AFD_POLL_SET_ADD ) {
+        NewMember = ExAllocatePoolWithTag( NonPagedPool,
+                                           sizeof(AFD_POLL_SET_MEMBER),
+                                           TAG_AFD_POLL_SET_MEMBER );
+    }
+
+    if( !Set || (ControlReq->Operation == AFD_POLL_SET_ADD && !NewMember) ) {
+        ObDereferenceObject( SocketObject );
+        return UnlockAndMaybeComplete( FCB, STATUS_NO_MEMORY, Irp, 0 );
+    }
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    /* A socket is in few sets, so look on its side */
+    for( ListEntry = SocketFCB->PollSetMembers.Flink;
+         ListEntry != &SocketFCB->PollSetMembers;
+         ListEntry = ListEntry->Flink ) {
+        if( CONTAINING_RECORD( ListEntry, AFD_POLL_SET_MEMBER, FcbEntry )->Set == Set ) {
+            Member = CONTAINING_RECORD( ListEntry, AFD_POLL_SET_MEMBER, FcbEntry );
+            break;
+        }
+    }
+
+    switch( ControlReq->Operation ) {
+    case AFD_POLL_SET_ADD:
+        if( Member ) {
+            Status = STATUS_OBJECT_NAME_COLLISION;
+            break;
+        }
+
+        Member = NewMember;
+        NewMember = NULL;
+
+        Member->Set = Set;
+        Member->FCB = SocketFCB;
+        Member->Handle = ControlReq->Handle;
+        Member->Events = ControlReq->Events;
+        Member->Context = ControlReq->Context;
+        Member->Ready = FALSE;
+        InsertTailList( &Set->Members, &Member->SetEntry );
+        InsertTailList( &SocketFCB->PollSetMembers, &Member->FcbEntry );
+
+        PollSetUpdateMember( Member );
+        Status = STATUS_SUCCESS;
+        break;
+
+    case AFD_POLL_SET_MODIFY:
+        if( !Member ) {
+            Status = STATUS_NOT_FOUND;
+            break;
+        }
+
+        Member->Events = ControlReq->Events;
+        Member->Context = ControlReq->Context;
+
+        PollSetUpdateMember( Member );
+        Status = STATUS_SUCCESS;
+        break;
+
+    default:
+        if( !Member ) {
+            Status = STATUS_NOT_FOUND;
+            break;
+        }
+
+        PollSetFreeMember( Member );
+        Status = STATUS_SUCCESS;
+        break;
+    }
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+    if( NewMember )
+        ExFreePoolWithTag( NewMember, TAG_AFD_POLL_SET_MEMBER );
+
+    ObDereferenceObject( SocketObject );
+
+    AFD_DbgPrint(MID_TRACE,("Returning %x\n", Status));
+
+    return UnlockAndMaybeComplete( FCB, Status, Irp, 0 );
+}
+
+NTSTATUS NTAPI
+AfdPollSetWait( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                PIO_STACK_LOCATION IrpSp ) {
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    PAFD_FCB FCB = FileObject->FsContext;
+    PAFD_DEVICE_EXTENSION DeviceExt = DeviceObject->DeviceExtension;
+    PAFD_POLL_SET_WAIT_INFO WaitReq = Irp->AssociatedIrp.SystemBuffer;
+    ULONG OutputLength = IrpSp->Parameters.DeviceIoControl.OutputBufferLength;
+    PAFD_POLL_SET Set;
+    PAFD_POLL_SET_WAIT Wait;
+    LARGE_INTEGER Timeout;
+    ULONG MaxEntries;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
+
+    if( IrpSp->Parameters.DeviceIoControl.InputBufferLength <
+            FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries) ||
+        OutputLength <
+            FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries) + sizeof(AFD_POLL_SET_ENTRY) ) {
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_PARAMETER, Irp, 0 );
+    }
+
+    MaxEntries = (OutputLength - FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries)) /
+                 sizeof(AFD_POLL_SET_ENTRY);
+    Timeout = WaitReq->Timeout;
+
+    AFD_DbgPrint(MID_TRACE,("Called (MaxEntries %u Timeout %d)\n",
+                            MaxEntries, (INT)Timeout.QuadPart));
+
+    Set = PollSetGet( DeviceExt, FCB );
+    if( !Set )
+        return UnlockAndMaybeComplete( FCB, STATUS_NO_MEMORY, Irp, 0 );
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    /* A zero timeout only polls, like select */
+    if( PollSetHarvest( Set, WaitReq, MaxEntries ) || !Timeout.QuadPart ) {
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+        Status = WaitReq->EntryCount ? STATUS_SUCCESS : STATUS_TIMEOUT;
+        return UnlockAndMaybeComplete( FCB, Status, Irp,
+                                       FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries) +
+                                       WaitReq->EntryCount * sizeof(AFD_POLL_SET_ENTRY) );
+    }
+
+    Wait = ExAllocatePoolWithTag( NonPagedPool, sizeof(AFD_POLL_SET_WAIT),
+                                  TAG_AFD_POLL_SET_WAIT );
+    if( !Wait ) {
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+        return UnlockAndMaybeComplete( FCB, STATUS_NO_MEMORY, Irp, 0 );
+    }
+
+    Wait->Irp = Irp;
+    Wait->DeviceExt = DeviceExt;
+    Wait->MaxEntries = MaxEntries;
+    Wait->TimerFired = FALSE;
+    KeInitializeTimerEx( &Wait->Timer, NotificationTimer );
+    KeInitializeDpc( &Wait->TimeoutDpc, PollSetTimeout, Wait );
+
+    InsertTailList( &Set->Waits, &Wait->ListEntry );
+    KeSetTimer( &Wait->Timer, Timeout, &Wait->TimeoutDpc );
+
+    IoMarkIrpPending( Irp );
+    (void)IoSetCancelRoutine( Irp, AfdCancelHandler );
+
+    /* Cancelled before the routine was in place, nobody will call it */
+    if( Irp->Cancel && IoSetCancelRoutine( Irp, NULL ) ) {
+        WaitReq->EntryCount = 0;
+        (void)PollSetCompleteWait( Wait, STATUS_CANCELLED, TRUE );
+    }
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+    SocketStateUnlock( FCB );
+
+    AFD_DbgPrint(MID_TRACE,("Pending\n"));
+
+    return STATUS_PENDING;
+}
+
+static PAFD_POLL_SET_WAIT PollSetFindWait( PLIST_ENTRY Waits, PIRP Irp ) {
+    PAFD_POLL_SET_WAIT Wait;
+    PLIST_ENTRY ListEntry;
+
+    for( ListEntry = Waits->Flink;
+         ListEntry != Waits;
+         ListEntry = ListEntry->Flink ) {
+        Wait = CONTAINING_RECORD( ListEntry, AFD_POLL_SET_WAIT, ListEntry );
+        if( Wait->Irp == Irp )
+            return Wait;
+    }
+
+    return NULL;
+}
+
+/* Called by AfdCancelHandler with the FCB state lock held. Nobody else
+ * completes the IRP once the cancel routine owns it, so the wait is still
+ * queued, on its set or, if the set went away, on the device */
+VOID PollSetCancelWait( PAFD_DEVICE_EXTENSION DeviceExt, PAFD_FCB FCB,
+                        PIRP Irp ) {
+    PAFD_POLL_SET_WAIT Wait = NULL;
+    PAFD_POLL_SET_WAIT_INFO WaitReq;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    if( FCB->PollSet )
+        Wait = PollSetFindWait( &FCB->PollSet->Waits, Irp );
+    if( !Wait )
+        Wait = PollSetFindWait( &DeviceExt->PollSetCancelling, Irp );
+
+    ASSERT(Wait);
+    if( Wait ) {
+        WaitReq = Irp->AssociatedIrp.SystemBuffer;
+        WaitReq->EntryCount = 0;
+        (void)PollSetCompleteWait( Wait, STATUS_CANCELLED, TRUE );
+    }
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+}
@@ -759,6 +759,83 @@ NTSTATUS TdiQueryInformationEx(
                                  OutputLength);                             /* Return information */
 }
 
+NTSTATUS TdiSetInformationEx(
+    PFILE_OBJECT FileObject,
+    ULONG Class,
+    ULONG Type,
+    ULONG Id,
+    PVOID InputBuffer,
+    ULONG InputLength)
+/*
+ * FUNCTION: Extended set of information on the object the file object stands for
+ * ARGUMENTS:
+ *     FileObject   = Pointer to the connection or address file object
+ *     Class        = Entity class
+ *     Type         = Entity type
+ *     Id           = Entity id
+ *     InputBuffer  = Pointer to the new value
+ *     InputLength  = Length of InputBuffer
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PTCP_REQUEST_SET_INFORMATION_EX SetInfo;
+    PDEVICE_OBJECT DeviceObject;
+    IO_STATUS_BLOCK Iosb;
+    NTSTATUS Status;
+    KEVENT Event;
+    ULONG Length;
+    PIRP Irp;
+
+    if (!FileObject) {
+        AFD_DbgPrint(MIN_TRACE, ("Bad file object.\n"));
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+    if (!DeviceObject) {
+        AFD_DbgPrint(MIN_TRACE, ("Bad device object.\n"));
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Length = FIELD_OFFSET(TCP_REQUEST_SET_INFORMATION_EX, Buffer) + InputLength;
+    SetInfo = ExAllocatePoolWithTag(NonPagedPool, Length, TAG_AFD_SET_INFORMATION);
+    if (!SetInfo)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* The transport finds the object by the file object, not by the entity */
+    RtlZeroMemory(SetInfo, Length);
+    SetInfo->ID.toi_class = Class;
+    SetInfo->ID.toi_type  = Type;
+    SetInfo->ID.toi_id    = Id;
+    SetInfo->BufferSize   = InputLength;
+    RtlCopyMemory(SetInfo->Buffer, InputBuffer, InputLength);
+
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+
+    Irp = IoBuildDeviceIoControlRequest(IOCTL_TCP_SET_INFORMATION_EX,
+                                        DeviceObject,
+                                        SetInfo,
+                                        Length,
+                                        NULL,
+                                        0,
+                                        FALSE,
+                                        &Event,
+                                        &Iosb);
+    if (!Irp) {
+        ExFreePoolWithTag(SetInfo, TAG_AFD_SET_INFORMATION);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    IoGetNextIrpStackLocation(Irp)->FileObject = FileObject;
+
+    Status = TdiCall(Irp, DeviceObject, &Event, &Iosb);
+
+    ExFreePoolWithTag(SetInfo, TAG_AFD_SET_INFORMATION);
+
+    return Status;
+}
+
 NTSTATUS TdiQueryAddress(
     PFILE_OBJECT FileObject,
     PULONG Address)
@@ -47,11 +47,15 @@
 #define TAG_AFD_POLL_HANDLE                'hpfA'
 #define TAG_AFD_FCB                        'cffA'
 #define TAG_AFD_ACTIVE_POLL                'pafA'
+#define TAG_AFD_POLL_SET                   'spfA'
+#define TAG_AFD_POLL_SET_MEMBER            'mpfA'
+#define TAG_AFD_POLL_SET_WAIT              'wpfA'
 #define TAG_AFD_EA_INFO                    'aefA'
 #define TAG_AFD_STORED_DATAGRAM            'gsfA'
 #define TAG_AFD_SNMP_ADDRESS_INFO          'asfA'
 #define TAG_AFD_TDI_CONNECTION_INFORMATION 'cTfA'
 #define TAG_AFD_WSA_BUFFER                 'bWfA'
+#define TAG_AFD_SET_INFORMATION            'iSfA'
 
 typedef struct IPADDR_ENTRY {
 	ULONG  Addr;
@@ -110,9 +114,18 @@ typedef struct _AFD_MAPBUF {
 typedef struct _AFD_DEVICE_EXTENSION {
     PDEVICE_OBJECT DeviceObject;
     LIST_ENTRY Polls;
+    /* Poll set waits whose set went away while they were being cancelled */
+    LIST_ENTRY PollSetCancelling;
     KSPIN_LOCK Lock;
 } AFD_DEVICE_EXTENSION, *PAFD_DEVICE_EXTENSION;
 
+/* One per handle of a select, linked into the FCB it waits on so a
+ * state change only looks at the polls that care about that socket */
+typedef struct _AFD_POLL_WAIT_BLOCK {
+    LIST_ENTRY ListEntry;
+    struct _AFD_ACTIVE_POLL *Poll;
+} AFD_POLL_WAIT_BLOCK, *PAFD_POLL_WAIT_BLOCK;
+
 typedef struct _AFD_ACTIVE_POLL {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -121,8 +134,40 @@ typedef struct _AFD_ACTIVE_POLL {
     KTIMER Timer;
     PKEVENT EventObject;
     BOOLEAN Exclusive;
+    BOOLEAN Signalled;
+    AFD_POLL_WAIT_BLOCK WaitBlocks[1];
 } AFD_ACTIVE_POLL, *PAFD_ACTIVE_POLL;
 
+typedef struct _AFD_POLL_SET {
+    LIST_ENTRY Members;
+    LIST_ENTRY ReadyMembers;
+    LIST_ENTRY Waits;
+    PAFD_DEVICE_EXTENSION DeviceExt;
+} AFD_POLL_SET, *PAFD_POLL_SET;
+
+/* The socket is not referenced: cleaning it up removes the member */
+typedef struct _AFD_POLL_SET_MEMBER {
+    LIST_ENTRY SetEntry;
+    LIST_ENTRY FcbEntry;
+    LIST_ENTRY ReadyEntry;
+    BOOLEAN Ready;
+    PAFD_POLL_SET Set;
+    struct _AFD_FCB *FCB;
+    SOCKET Handle;
+    ULONG Events;
+    PVOID Context;
+} AFD_POLL_SET_MEMBER, *PAFD_POLL_SET_MEMBER;
+
+typedef struct _AFD_POLL_SET_WAIT {
+    LIST_ENTRY ListEntry;
+    PIRP Irp;
+    PAFD_DEVICE_EXTENSION DeviceExt;
+    ULONG MaxEntries;
+    BOOLEAN TimerFired;
+    KDPC TimeoutDpc;
+    KTIMER Timer;
+} AFD_POLL_SET_WAIT, *PAFD_POLL_SET_WAIT;
+
 typedef struct _IRP_LIST {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -201,6 +246,9 @@ typedef struct _AFD_FCB {
     LIST_ENTRY PendingIrpList[MAX_FUNCTIONS];
     LIST_ENTRY DatagramList;
     LIST_ENTRY PendingConnections;
+    LIST_ENTRY PollWaitList;     /* AFD_POLL_WAIT_BLOCKs of selects on us */
+    LIST_ENTRY PollSetMembers;   /* Our memberships in poll sets */
+    PAFD_POLL_SET PollSet;       /* The poll set owned by this handle */
 } AFD_FCB, *PAFD_FCB;
 
 /* bind.c */
@@ -336,6 +384,14 @@ VOID ZeroEvents( PAFD_HANDLE HandleArray,
 VOID SignalSocket(
    PAFD_ACTIVE_POLL Poll OPTIONAL, PIRP _Irp OPTIONAL,
    PAFD_POLL_INFO PollReq, NTSTATUS Status);
+NTSTATUS NTAPI
+AfdPollSetControl( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+		   PIO_STACK_LOCATION IrpSp );
+NTSTATUS NTAPI
+AfdPollSetWait( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+		PIO_STACK_LOCATION IrpSp );
+VOID PollSetCancelWait( PAFD_DEVICE_EXTENSION DeviceExt, PAFD_FCB FCB,
+			PIRP Irp );
 
 /* tdi.c */
 
@@ -43,3 +43,11 @@ NTSTATUS TdiQueryDeviceControl(
     PVOID OutputBuffer,
     ULONG OutputBufferLength,
     PULONG Return);
+
+NTSTATUS TdiSetInformationEx(
+    PFILE_OBJECT FileObject,
+    ULONG Class,
+    ULONG Type,
+    ULONG Id,
+    PVOID InputBuffer,
+    ULONG InputLength);
@@ -7,6 +7,13 @@
 
 #pragma once
 
+#ifdef CHECKSUM_HOST
+
+/* The checksum routines are also built into a host test */
+#include <typedefs.h>
+
+#endif /* CHECKSUM_HOST */
+
 ULONG ChecksumFold(
   ULONG Sum);
 
@@ -15,12 +22,26 @@ ULONG ChecksumCompute(
     UINT Count,
     ULONG Seed);
 
+ULONG ChecksumCopy(
+    PVOID Destination,
+    PVOID Source,
+    UINT Count,
+    ULONG Seed);
+
+#ifndef CHECKSUM_HOST
+
 unsigned int
 csum_partial(
   const unsigned char * buff,
   int len,
   unsigned int sum);
 
+ULONG
+UDPv4ChecksumComplete(
+  PIPv4_HEADER IPHeader,
+  ULONG Sum,
+  ULONG DataLength);
+
 ULONG
 UDPv4ChecksumCalculate(
   PIPv4_HEADER IPHeader,
@@ -47,3 +68,5 @@ UDPv4ChecksumCalculate(
     (BOOLEAN)(TCPv4Checksum(Data, Count, \
       TCPv4Checksum(TcpPseudoHeader, sizeof(TCPv4_PSEUDO_HEADER), \
       0)) == DH2N(0x0000FFFF))
+
+#endif /* CHECKSUM_HOST */
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <neighbor.h>
+#include <routetrie.h>
 
 
 /* Forward Information Base Entry */
@@ -18,6 +19,8 @@ typedef struct _FIB_ENTRY {
     IP_ADDRESS Netmask;           /* Netmask of network */
     PNEIGHBOR_CACHE_ENTRY Router; /* Pointer to NCE of router to use */
     UINT Metric;                  /* Cost of this route */
+    PROUTE_TRIE_NODE Node;        /* Trie node of the prefix, NULL for non IPv4 routes */
+    LIST_ENTRY PrefixListEntry;   /* Entry on the route list of the trie node */
 } FIB_ENTRY, *PFIB_ENTRY;
 
 PFIB_ENTRY RouterAddRoute(
@@ -0,0 +1,52 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS TCP/IP protocol driver
+ * FILE:        include/routetrie.h
+ * PURPOSE:     Longest prefix match trie for the forward information base
+ */
+
+#pragma once
+
+#ifdef ROUTETRIE_HOST
+
+/* The trie is also built into a host benchmark */
+#include <typedefs.h>
+
+#endif /* ROUTETRIE_HOST */
+
+/* A path compressed binary trie over IPv4 prefixes. Nodes only exist for
+   prefixes that have routes and for the branch points between them, so a
+   lookup visits at most 33 nodes however many routes there are */
+typedef struct _ROUTE_TRIE_NODE {
+    struct _ROUTE_TRIE_NODE *Parent;
+    struct _ROUTE_TRIE_NODE *Child[2]; /* Indexed by the bit after the prefix */
+    ULONG Prefix;                      /* Host byte order, bits past PrefixLength are clear */
+    UINT PrefixLength;                 /* Number of significant bits in Prefix */
+    LIST_ENTRY Routes;                 /* Routes to exactly this prefix, empty for branch points */
+} ROUTE_TRIE_NODE, *PROUTE_TRIE_NODE;
+
+typedef struct _ROUTE_TRIE {
+    PROUTE_TRIE_NODE Root;
+} ROUTE_TRIE, *PROUTE_TRIE;
+
+/* A lookup can match every prefix length from 0 to 32 */
+#define ROUTE_TRIE_MAX_MATCHES 33
+
+VOID RouteTrieInitialize(
+    PROUTE_TRIE Trie);
+
+PROUTE_TRIE_NODE RouteTrieInsert(
+    PROUTE_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength);
+
+VOID RouteTrieRemove(
+    PROUTE_TRIE Trie,
+    PROUTE_TRIE_NODE Node);
+
+UINT RouteTrieLookup(
+    PROUTE_TRIE Trie,
+    ULONG Address,
+    PROUTE_TRIE_NODE *Matches);
+
+/* EOF */
@@ -188,6 +188,8 @@ BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Connection, PIRP Irp );
 
 NTSTATUS TCPSetNoDelay(PCONNECTION_ENDPOINT Connection, BOOLEAN Set);
 
+NTSTATUS TCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, ULONG Size);
+
 VOID
 TCPUpdateInterfaceLinkStatus(PIP_INTERFACE IF);
 
@@ -217,4 +219,7 @@ VOID CompleteBucket(PCONNECTION_ENDPOINT Connection, PTDI_BUCKET Bucket, const B
 void
 LibTCPDumpPcb(PVOID SocketContext);
 
+void
+LibTCPDumpStatistics(void);
+
 NTSTATUS TCPGetSocketStatus(PCONNECTION_ENDPOINT Connection, PULONG State);
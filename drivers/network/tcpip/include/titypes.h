@@ -275,6 +275,8 @@ typedef struct _CONNECTION_ENDPOINT {
     LIST_ENTRY ShutdownRequest;/* Queued shutdown requests */
 
     LIST_ENTRY PacketQueue;    /* Queued received packets waiting to be processed */
+    LONG BytesConsumed;        /* Bytes taken out of the packet queue, but not tcp_recved yet */
+    LONG SendQueued;           /* The tcpip thread was asked to submit the send queue */
     
     /* Disconnect Timer */
     KTIMER DisconnectTimer;
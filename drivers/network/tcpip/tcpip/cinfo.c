@@ -24,6 +24,14 @@ TDI_STATUS SetConnectionInfo(TDIObjectID *ID,
             Set = *(BOOLEAN*)Buffer;
             return TCPSetNoDelay(Connection, Set);
         }
+        case TCP_SOCKET_WINDOW:
+        {
+            ULONG Size;
+            if (BufferSize < sizeof(ULONG))
+                return TDI_INVALID_PARAMETER;
+            Size = *(ULONG*)Buffer;
+            return TCPSetReceiveWindow(Connection, Size);
+        }
         default:
             DbgPrint("TCPIP: Unknown connection info ID: %u.\n", ID->toi_id);
     }
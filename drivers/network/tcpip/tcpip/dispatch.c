@@ -1519,6 +1519,24 @@ NTSTATUS DispTdiSetInformationEx(
 
     case TDI_CONNECTION_FILE:
         Request.Handle.ConnectionContext = TranContext->Handle.ConnectionContext;
+
+        /* Connection options sent on the connection itself apply to it, and not
+           to whatever connection the address file was associated with first.
+           Accepted connections are only reachable this way */
+        if (Info->ID.toi_class == INFO_CLASS_PROTOCOL &&
+            Info->ID.toi_type == INFO_TYPE_CONNECTION)
+        {
+            if (IrpSp->Parameters.DeviceIoControl.InputBufferLength <
+                FIELD_OFFSET(TCP_REQUEST_SET_INFORMATION_EX, Buffer) + Info->BufferSize)
+            {
+                return STATUS_INVALID_PARAMETER;
+            }
+
+            return SetConnectionInfo(&Info->ID,
+                                     TranContext->Handle.ConnectionContext,
+                                     &Info->Buffer,
+                                     Info->BufferSize);
+        }
         break;
 
     case TDI_CONTROL_CHANNEL_FILE:
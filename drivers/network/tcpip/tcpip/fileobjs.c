@@ -183,6 +183,8 @@ LogActiveObjects(VOID)
     
     TcpipReleaseSpinLock(&ConnectionEndpointListLock, OldIrql);
 
+    LibTCPDumpStatistics();
+
     DbgPrint("---------------------------------------------------\n");
 #endif
 }
@@ -506,3 +506,182 @@ AfdGetInformation(
 
     return Status;
 }
+
+NTSTATUS
+AfdPollSetControl(
+    _In_ HANDLE SetHandle,
+    _In_ ULONG Operation,
+    _In_ HANDLE SocketHandle,
+    _In_ ULONG Events,
+    _In_opt_ PVOID Context)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    AFD_POLL_SET_CONTROL_INFO ControlInfo;
+    HANDLE Event;
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    ControlInfo.Operation = Operation;
+    ControlInfo.Handle = (SOCKET)SocketHandle;
+    ControlInfo.Events = Events;
+    ControlInfo.Context = Context;
+
+    Status = NtDeviceIoControlFile(SetHandle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IOCTL_AFD_POLL_SET_CONTROL,
+                                   &ControlInfo,
+                                   sizeof(ControlInfo),
+                                   NULL,
+                                   0);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    NtClose(Event);
+
+    return Status;
+}
+
+NTSTATUS
+AfdPollSetWait(
+    _In_ HANDLE SetHandle,
+    _In_ LONGLONG Timeout,
+    _Out_writes_(MaxEntries) PAFD_POLL_SET_ENTRY Entries,
+    _In_ ULONG MaxEntries,
+    _Out_ PULONG EntryCount)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    PAFD_POLL_SET_WAIT_INFO WaitInfo;
+    ULONG WaitInfoLength;
+    HANDLE Event;
+
+    *EntryCount = 0;
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    WaitInfoLength = FIELD_OFFSET(AFD_POLL_SET_WAIT_INFO, Entries) + MaxEntries * sizeof(AFD_POLL_SET_ENTRY);
+    WaitInfo = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, WaitInfoLength);
+    if (!WaitInfo)
+    {
+        NtClose(Event);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    WaitInfo->Timeout.QuadPart = Timeout;
+
+    Status = NtDeviceIoControlFile(SetHandle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IOCTL_AFD_POLL_SET_WAIT,
+                                   WaitInfo,
+                                   WaitInfoLength,
+                                   WaitInfo,
+                                   WaitInfoLength);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    if (NT_SUCCESS(Status))
+    {
+        *EntryCount = WaitInfo->EntryCount;
+        RtlCopyMemory(Entries, WaitInfo->Entries, WaitInfo->EntryCount * sizeof(AFD_POLL_SET_ENTRY));
+    }
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, WaitInfo);
+    NtClose(Event);
+
+    return Status;
+}
+
+NTSTATUS
+AfdSelect(
+    _In_ LONGLONG Timeout,
+    _Inout_updates_(HandleCount) PAFD_HANDLE Handles,
+    _In_ ULONG HandleCount)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    PAFD_POLL_INFO PollInfo;
+    ULONG PollInfoLength;
+    HANDLE Event;
+    ULONG i;
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    PollInfoLength = FIELD_OFFSET(AFD_POLL_INFO, Handles) + HandleCount * sizeof(AFD_HANDLE);
+    PollInfo = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, PollInfoLength);
+    if (!PollInfo)
+    {
+        NtClose(Event);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    PollInfo->Timeout.QuadPart = Timeout;
+    PollInfo->HandleCount = HandleCount;
+    PollInfo->Exclusive = FALSE;
+    RtlCopyMemory(PollInfo->Handles, Handles, HandleCount * sizeof(AFD_HANDLE));
+
+    Status = NtDeviceIoControlFile((HANDLE)Handles[0].Handle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IOCTL_AFD_SELECT,
+                                   PollInfo,
+                                   PollInfoLength,
+                                   PollInfo,
+                                   PollInfoLength);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    if (NT_SUCCESS(Status))
+    {
+        for (i = 0; i < HandleCount; i++)
+        {
+            Handles[i].Events = PollInfo->Handles[i].Events;
+        }
+    }
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, PollInfo);
+    NtClose(Event);
+
+    return Status;
+}
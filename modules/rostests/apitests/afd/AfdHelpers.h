@@ -56,3 +56,25 @@ AfdGetInformation(
     _In_opt_ PBOOLEAN Boolean,
     _In_opt_ PULONG Ulong,
     _In_opt_ PLARGE_INTEGER LargeInteger);
+
+NTSTATUS
+AfdPollSetControl(
+    _In_ HANDLE SetHandle,
+    _In_ ULONG Operation,
+    _In_ HANDLE SocketHandle,
+    _In_ ULONG Events,
+    _In_opt_ PVOID Context);
+
+NTSTATUS
+AfdPollSetWait(
+    _In_ HANDLE SetHandle,
+    _In_ LONGLONG Timeout,
+    _Out_writes_(MaxEntries) PAFD_POLL_SET_ENTRY Entries,
+    _In_ ULONG MaxEntries,
+    _Out_ PULONG EntryCount);
+
+NTSTATUS
+AfdSelect(
+    _In_ LONGLONG Timeout,
+    _Inout_updates_(HandleCount) PAFD_HANDLE Handles,
+    _In_ ULONG HandleCount);
@@ -0,0 +1,365 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test for IOCTL_AFD_POLL_SET_CONTROL/IOCTL_AFD_POLL_SET_WAIT
+ *              and for waking up pending waits
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+/* 100 ms, relative */
+#define SHORT_TIMEOUT (-100LL * 10000)
+/* 10 s, relative: only ends early if the wait is woken up */
+#define LONG_TIMEOUT (-10000LL * 10000)
+
+/* Datagrams to these make the receiving sockets readable */
+#define TEST_PORT       28541
+#define OTHER_TEST_PORT 28542
+
+typedef struct _WAITER
+{
+    HANDLE Handle;
+    NTSTATUS Status;
+    AFD_POLL_SET_ENTRY Entries[2];
+    ULONG EntryCount;
+    AFD_HANDLE Handles[1];
+} WAITER, *PWAITER;
+
+static
+DWORD
+WINAPI
+PollSetWaitThread(
+    _In_ PVOID Parameter)
+{
+    PWAITER Waiter = Parameter;
+
+    Waiter->Status = AfdPollSetWait(Waiter->Handle, LONG_TIMEOUT, Waiter->Entries, RTL_NUMBER_OF(Waiter->Entries), &Waiter->EntryCount);
+    return 0;
+}
+
+static
+DWORD
+WINAPI
+SelectThread(
+    _In_ PVOID Parameter)
+{
+    PWAITER Waiter = Parameter;
+
+    Waiter->Status = AfdSelect(LONG_TIMEOUT, Waiter->Handles, RTL_NUMBER_OF(Waiter->Handles));
+    return 0;
+}
+
+static
+NTSTATUS
+CreateBoundSocket(
+    _Out_ PHANDLE SocketHandle,
+    _In_ USHORT Port)
+{
+    NTSTATUS Status;
+    struct sockaddr_in addr;
+
+    Status = AfdCreateSocket(SocketHandle, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = htons(Port);
+
+    Status = AfdBind(*SocketHandle, (const struct sockaddr *)&addr, sizeof(addr));
+    if (!NT_SUCCESS(Status))
+    {
+        NtClose(*SocketHandle);
+        *SocketHandle = NULL;
+    }
+    return Status;
+}
+
+static
+NTSTATUS
+SendToPort(
+    _In_ HANDLE SocketHandle,
+    _In_ USHORT Port)
+{
+    CHAR Buffer[16] = "wake up";
+    struct sockaddr_in addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = htons(Port);
+
+    return AfdSendTo(SocketHandle, Buffer, sizeof(Buffer), (const struct sockaddr *)&addr, sizeof(addr));
+}
+
+static
+void
+TestPollSet(void)
+{
+    NTSTATUS Status;
+    HANDLE SetHandle, SocketHandle, OtherHandle;
+    AFD_POLL_SET_ENTRY Entries[4];
+    ULONG EntryCount;
+
+    Status = AfdCreateSocket(&SetHandle, AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+
+    /* Datagram sockets can be sent on right away */
+    Status = AfdCreateSocket(&SocketHandle, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+    Status = AfdCreateSocket(&OtherHandle, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_ADD, SocketHandle, AFD_EVENT_SEND, (PVOID)0x1234);
+    if (Status == STATUS_INVALID_DEVICE_REQUEST || Status == STATUS_NOT_SUPPORTED)
+    {
+        skip("Poll sets are not supported\n");
+        goto Cleanup;
+    }
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_ADD, SocketHandle, AFD_EVENT_SEND, NULL);
+    ok(Status == STATUS_OBJECT_NAME_COLLISION, "AfdPollSetControl failed with %lx\n", Status);
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_ADD, SetHandle, AFD_EVENT_SEND, NULL);
+    ok(Status == STATUS_INVALID_HANDLE, "AfdPollSetControl failed with %lx\n", Status);
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_MODIFY, OtherHandle, AFD_EVENT_SEND, NULL);
+    ok(Status == STATUS_NOT_FOUND, "AfdPollSetControl failed with %lx\n", Status);
+    Status = AfdPollSetControl(SetHandle, 0, SocketHandle, AFD_EVENT_SEND, NULL);
+    ok(Status == STATUS_INVALID_PARAMETER, "AfdPollSetControl failed with %lx\n", Status);
+
+    /* Level triggered: reported every time, as long as it is ready */
+    Status = AfdPollSetWait(SetHandle, 0, Entries, RTL_NUMBER_OF(Entries), &EntryCount);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 1, "Got %lu entries\n", EntryCount);
+    ok(Entries[0].Handle == (SOCKET)SocketHandle, "Got handle %p\n", (PVOID)Entries[0].Handle);
+    ok(Entries[0].Events == AFD_EVENT_SEND, "Got events %lx\n", Entries[0].Events);
+    ok(Entries[0].Context == (PVOID)0x1234, "Got context %p\n", Entries[0].Context);
+
+    Status = AfdPollSetWait(SetHandle, SHORT_TIMEOUT, Entries, RTL_NUMBER_OF(Entries), &EntryCount);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 1, "Got %lu entries\n", EntryCount);
+
+    /* Both ready, but only room for one at a time: they take turns */
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_ADD, OtherHandle, AFD_EVENT_SEND | AFD_EVENT_RECEIVE, (PVOID)0x5678);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+
+    Status = AfdPollSetWait(SetHandle, 0, Entries, 1, &EntryCount);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 1, "Got %lu entries\n", EntryCount);
+    ok(Entries[0].Handle == (SOCKET)SocketHandle, "Got handle %p\n", (PVOID)Entries[0].Handle);
+    Status = AfdPollSetWait(SetHandle, 0, Entries, 1, &EntryCount);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 1, "Got %lu entries\n", EntryCount);
+    ok(Entries[0].Handle == (SOCKET)OtherHandle, "Got handle %p\n", (PVOID)Entries[0].Handle);
+    ok(Entries[0].Events == AFD_EVENT_SEND, "Got events %lx\n", Entries[0].Events);
+    ok(Entries[0].Context == (PVOID)0x5678, "Got context %p\n", Entries[0].Context);
+
+    /* Nothing to receive, so nothing is ready anymore */
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_MODIFY, SocketHandle, AFD_EVENT_RECEIVE, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_REMOVE, OtherHandle, 0, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_REMOVE, OtherHandle, 0, NULL);
+    ok(Status == STATUS_NOT_FOUND, "AfdPollSetControl failed with %lx\n", Status);
+
+    Status = AfdPollSetWait(SetHandle, 0, Entries, RTL_NUMBER_OF(Entries), &EntryCount);
+    ok(Status == STATUS_TIMEOUT, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 0, "Got %lu entries\n", EntryCount);
+    Status = AfdPollSetWait(SetHandle, SHORT_TIMEOUT, Entries, RTL_NUMBER_OF(Entries), &EntryCount);
+    ok(Status == STATUS_TIMEOUT, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 0, "Got %lu entries\n", EntryCount);
+
+    /* Closing a member takes it out of the set */
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_MODIFY, SocketHandle, AFD_EVENT_SEND, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+    NtClose(SocketHandle);
+    SocketHandle = NULL;
+
+    Status = AfdPollSetWait(SetHandle, 0, Entries, RTL_NUMBER_OF(Entries), &EntryCount);
+    ok(Status == STATUS_TIMEOUT, "AfdPollSetWait failed with %lx\n", Status);
+    ok(EntryCount == 0, "Got %lu entries\n", EntryCount);
+
+Cleanup:
+    if (SocketHandle)
+        NtClose(SocketHandle);
+    NtClose(OtherHandle);
+    NtClose(SetHandle);
+}
+
+static
+void
+TestPendingWait(void)
+{
+    NTSTATUS Status;
+    HANDLE SetHandle, ReceiveHandle, OtherHandle, SendHandle;
+    HANDLE Thread;
+    WAITER Waiter;
+    DWORD Wait;
+
+    Status = AfdCreateSocket(&SetHandle, AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+    Status = CreateBoundSocket(&ReceiveHandle, TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    Status = CreateBoundSocket(&OtherHandle, OTHER_TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    Status = CreateBoundSocket(&SendHandle, 0);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    if (!ReceiveHandle || !OtherHandle || !SendHandle)
+    {
+        skip("No sockets to test with\n");
+        goto Cleanup;
+    }
+
+    Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_ADD, ReceiveHandle, AFD_EVENT_RECEIVE, (PVOID)0x1234);
+    if (Status == STATUS_INVALID_DEVICE_REQUEST || Status == STATUS_NOT_SUPPORTED)
+    {
+        skip("Poll sets are not supported\n");
+        goto Cleanup;
+    }
+    ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+
+    /* The wait pends until the member becomes readable, not until it times out */
+    RtlZeroMemory(&Waiter, sizeof(Waiter));
+    Waiter.Handle = SetHandle;
+    Waiter.Status = (NTSTATUS)0xdeadbeef;
+    Thread = CreateThread(NULL, 0, PollSetWaitThread, &Waiter, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (!Thread)
+        goto Cleanup;
+
+    Wait = WaitForSingleObject(Thread, 500);
+    ok(Wait == WAIT_TIMEOUT, "Wait returned %lu\n", Wait);
+
+    /* A socket outside the set does not complete it */
+    Status = SendToPort(SendHandle, OTHER_TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "SendToPort failed with %lx\n", Status);
+    Wait = WaitForSingleObject(Thread, 500);
+    ok(Wait == WAIT_TIMEOUT, "Wait returned %lu\n", Wait);
+
+    Status = SendToPort(SendHandle, TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "SendToPort failed with %lx\n", Status);
+    Wait = WaitForSingleObject(Thread, 5000);
+    ok(Wait == WAIT_OBJECT_0, "Wait returned %lu\n", Wait);
+    if (Wait != WAIT_OBJECT_0)
+    {
+        /* Still pending: closing the set completes it */
+        NtClose(SetHandle);
+        SetHandle = NULL;
+        WaitForSingleObject(Thread, INFINITE);
+    }
+    CloseHandle(Thread);
+
+    ok(Waiter.Status == STATUS_SUCCESS, "AfdPollSetWait failed with %lx\n", Waiter.Status);
+    ok(Waiter.EntryCount == 1, "Got %lu entries\n", Waiter.EntryCount);
+    ok(Waiter.Entries[0].Handle == (SOCKET)ReceiveHandle, "Got handle %p\n", (PVOID)Waiter.Entries[0].Handle);
+    ok(Waiter.Entries[0].Events == AFD_EVENT_RECEIVE, "Got events %lx\n", Waiter.Entries[0].Events);
+    ok(Waiter.Entries[0].Context == (PVOID)0x1234, "Got context %p\n", Waiter.Entries[0].Context);
+
+    /* Closing the set completes a pending wait */
+    if (SetHandle)
+    {
+        Status = AfdPollSetControl(SetHandle, AFD_POLL_SET_MODIFY, ReceiveHandle, AFD_EVENT_CONNECT, NULL);
+        ok(Status == STATUS_SUCCESS, "AfdPollSetControl failed with %lx\n", Status);
+
+        RtlZeroMemory(&Waiter, sizeof(Waiter));
+        Waiter.Handle = SetHandle;
+        Waiter.Status = (NTSTATUS)0xdeadbeef;
+        Thread = CreateThread(NULL, 0, PollSetWaitThread, &Waiter, 0, NULL);
+        ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (Thread)
+        {
+            Wait = WaitForSingleObject(Thread, 500);
+            ok(Wait == WAIT_TIMEOUT, "Wait returned %lu\n", Wait);
+            NtClose(SetHandle);
+            SetHandle = NULL;
+            Wait = WaitForSingleObject(Thread, 5000);
+            ok(Wait == WAIT_OBJECT_0, "Wait returned %lu\n", Wait);
+            if (Wait == WAIT_OBJECT_0)
+                ok(Waiter.Status == STATUS_CANCELLED, "AfdPollSetWait failed with %lx\n", Waiter.Status);
+            CloseHandle(Thread);
+        }
+    }
+
+Cleanup:
+    if (SendHandle)
+        NtClose(SendHandle);
+    if (OtherHandle)
+        NtClose(OtherHandle);
+    if (ReceiveHandle)
+        NtClose(ReceiveHandle);
+    if (SetHandle)
+        NtClose(SetHandle);
+}
+
+static
+void
+TestSelectWakeup(void)
+{
+    NTSTATUS Status;
+    HANDLE ReceiveHandle, OtherHandle, SendHandle;
+    HANDLE Thread;
+    WAITER Waiter;
+    DWORD Wait;
+
+    Status = CreateBoundSocket(&ReceiveHandle, TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    Status = CreateBoundSocket(&OtherHandle, OTHER_TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    Status = CreateBoundSocket(&SendHandle, 0);
+    ok(Status == STATUS_SUCCESS, "CreateBoundSocket failed with %lx\n", Status);
+    if (!ReceiveHandle || !OtherHandle || !SendHandle)
+    {
+        skip("No sockets to test with\n");
+        goto Cleanup;
+    }
+
+    /* Select only waits on the sockets it names: a datagram for another
+     * socket leaves it pending, one for its own socket completes it */
+    RtlZeroMemory(&Waiter, sizeof(Waiter));
+    Waiter.Handles[0].Handle = (SOCKET)ReceiveHandle;
+    Waiter.Handles[0].Events = AFD_EVENT_RECEIVE;
+    Waiter.Status = (NTSTATUS)0xdeadbeef;
+    Thread = CreateThread(NULL, 0, SelectThread, &Waiter, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (!Thread)
+        goto Cleanup;
+
+    Wait = WaitForSingleObject(Thread, 500);
+    ok(Wait == WAIT_TIMEOUT, "Wait returned %lu\n", Wait);
+
+    Status = SendToPort(SendHandle, OTHER_TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "SendToPort failed with %lx\n", Status);
+    Wait = WaitForSingleObject(Thread, 500);
+    ok(Wait == WAIT_TIMEOUT, "Wait returned %lu\n", Wait);
+
+    Status = SendToPort(SendHandle, TEST_PORT);
+    ok(Status == STATUS_SUCCESS, "SendToPort failed with %lx\n", Status);
+    Wait = WaitForSingleObject(Thread, 5000);
+    ok(Wait == WAIT_OBJECT_0, "Wait returned %lu\n", Wait);
+    if (Wait != WAIT_OBJECT_0)
+    {
+        /* Let the select time out before the waiter goes away */
+        WaitForSingleObject(Thread, INFINITE);
+    }
+    CloseHandle(Thread);
+
+    ok(Waiter.Status == STATUS_SUCCESS, "AfdSelect failed with %lx\n", Waiter.Status);
+    ok(Waiter.Handles[0].Events == AFD_EVENT_RECEIVE, "Got events %lx\n", Waiter.Handles[0].Events);
+
+Cleanup:
+    if (SendHandle)
+        NtClose(SendHandle);
+    if (OtherHandle)
+        NtClose(OtherHandle);
+    if (ReceiveHandle)
+        NtClose(ReceiveHandle);
+}
+
+START_TEST(pollset)
+{
+    TestPollSet();
+    TestPendingWait();
+    TestSelectWakeup();
+}
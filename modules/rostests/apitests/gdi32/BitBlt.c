@@ -0,0 +1,569 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for BitBlt between DIB sections
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define TEST_WIDTH   128
+#define TEST_HEIGHT  32
+#define BENCH_WIDTH  640
+#define BENCH_HEIGHT 480
+#define BENCH_ITERATIONS 100
+
+/* Odd offsets, so that rows neither start nor end on a DWORD boundary */
+#define SRC_X 5
+#define SRC_Y 2
+#define DST_X 3
+#define DST_Y 1
+#define BLT_WIDTH  61
+#define BLT_HEIGHT 20
+
+/* Translated rows are read in spans of 64 pixels, go over a few of them */
+#define SPAN_TEST_WIDTH 160
+#define SPAN_BLT_WIDTH  150
+
+static const struct
+{
+    DWORD Rop;
+    PCSTR Name;
+} TestRops[] =
+{
+    { SRCCOPY, "SRCCOPY" },
+    { SRCINVERT, "SRCINVERT" },
+    { SRCAND, "SRCAND" },
+    { PATCOPY, "PATCOPY" },
+};
+
+static const WORD TestBpps[] = { 8, 16, 24, 32 };
+
+#define TEST_COLOR RGB(0x18, 0x30, 0x48)
+/* Where TEST_COLOR sits in the palette of 8 bpp sections */
+#define TEST_COLOR_INDEX 0x42
+
+static
+ULONG
+GetStride(
+    _In_ ULONG Width,
+    _In_ WORD Bpp)
+{
+    return ((Width * Bpp + 31) / 32) * 4;
+}
+
+static
+HDC
+CreateDibDC(
+    _In_ ULONG Width,
+    _In_ ULONG Height,
+    _In_ WORD Bpp,
+    _Out_ PBYTE *Bits,
+    _Out_ HBITMAP *Bitmap)
+{
+    struct
+    {
+        BITMAPINFOHEADER bmiHeader;
+        RGBQUAD bmiColors[256];
+    } bmi;
+    HDC hdc;
+    ULONG i;
+
+    hdc = CreateCompatibleDC(NULL);
+    if (!hdc)
+        return NULL;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = Width;
+    bmi.bmiHeader.biHeight = -(LONG)Height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = Bpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    /* All different colors, so that no index has to be translated */
+    if (Bpp == 8)
+    {
+        for (i = 0; i < 256; i++)
+        {
+            bmi.bmiColors[i].rgbRed = (BYTE)i;
+            bmi.bmiColors[i].rgbGreen = (BYTE)i;
+            bmi.bmiColors[i].rgbBlue = (BYTE)i;
+        }
+        bmi.bmiColors[TEST_COLOR_INDEX].rgbRed = GetRValue(TEST_COLOR);
+        bmi.bmiColors[TEST_COLOR_INDEX].rgbGreen = GetGValue(TEST_COLOR);
+        bmi.bmiColors[TEST_COLOR_INDEX].rgbBlue = GetBValue(TEST_COLOR);
+    }
+
+    *Bitmap = CreateDIBSection(hdc, (BITMAPINFO*)&bmi, DIB_RGB_COLORS, (PVOID*)Bits, NULL, 0);
+    if (!*Bitmap)
+    {
+        DeleteDC(hdc);
+        return NULL;
+    }
+
+    SelectObject(hdc, *Bitmap);
+    SelectObject(hdc, CreateSolidBrush(TEST_COLOR));
+    return hdc;
+}
+
+static
+VOID
+DestroyDibDC(
+    _In_ HDC hdc,
+    _In_ HBITMAP Bitmap)
+{
+    DeleteObject(SelectObject(hdc, GetStockObject(BLACK_BRUSH)));
+    DeleteDC(hdc);
+    DeleteObject(Bitmap);
+}
+
+static
+VOID
+FillRandom(
+    _Out_ PBYTE Bits,
+    _In_ ULONG Size,
+    _In_ WORD Bpp)
+{
+    ULONG i;
+
+    for (i = 0; i < Size; i++)
+        Bits[i] = (BYTE)rand();
+
+    /* Keep the unused bit of 555 pixels clear */
+    if (Bpp == 16)
+    {
+        for (i = 1; i < Size; i += 2)
+            Bits[i] &= 0x7F;
+    }
+}
+
+/* Counts the pixels that differ, the padding at the end of a row is not
+ * part of the picture */
+static
+ULONG
+CountErrors(
+    _In_ PBYTE Expected,
+    _In_ PBYTE Bits,
+    _In_ ULONG Width,
+    _In_ ULONG Stride,
+    _In_ WORD Bpp)
+{
+    ULONG x, y, Offset, Errors = 0;
+
+    for (y = 0; y < TEST_HEIGHT; y++)
+    {
+        for (x = 0; x < Width; x++)
+        {
+            Offset = y * Stride + x * Bpp / 8;
+            if (memcmp(Expected + Offset, Bits + Offset, Bpp / 8) != 0)
+                Errors++;
+        }
+    }
+
+    return Errors;
+}
+
+static
+BYTE
+DoRop(
+    _In_ DWORD Rop,
+    _In_ BYTE Dest,
+    _In_ BYTE Source)
+{
+    switch (Rop)
+    {
+        case SRCCOPY: return Source;
+        case SRCINVERT: return Dest ^ Source;
+        case SRCAND: return Dest & Source;
+    }
+
+    return Dest;
+}
+
+static
+VOID
+TestRop(
+    _In_ ULONG RopIndex,
+    _In_ WORD Bpp)
+{
+    DWORD Rop = TestRops[RopIndex].Rop;
+    ULONG Stride = GetStride(TEST_WIDTH, Bpp);
+    ULONG Size = Stride * TEST_HEIGHT;
+    HBITMAP SrcBitmap, DstBitmap;
+    PBYTE SrcBits, DstBits, Expected;
+    HDC hdcSrc, hdcDst;
+    ULONG x, y, Offset, Pixel, Errors;
+
+    hdcSrc = CreateDibDC(TEST_WIDTH, TEST_HEIGHT, Bpp, &SrcBits, &SrcBitmap);
+    hdcDst = CreateDibDC(TEST_WIDTH, TEST_HEIGHT, Bpp, &DstBits, &DstBitmap);
+    Expected = HeapAlloc(GetProcessHeap(), 0, Size);
+    ok(hdcSrc && hdcDst && Expected, "Setup failed for %u bpp\n", Bpp);
+    if (!hdcSrc || !hdcDst || !Expected)
+        goto Cleanup;
+
+    FillRandom(SrcBits, Size, Bpp);
+    FillRandom(DstBits, Size, Bpp);
+    CopyMemory(Expected, DstBits, Size);
+
+    ok(BitBlt(hdcDst, DST_X, DST_Y, BLT_WIDTH, BLT_HEIGHT, hdcSrc, SRC_X, SRC_Y, Rop),
+       "%s failed for %u bpp\n", TestRops[RopIndex].Name, Bpp);
+    GdiFlush();
+
+    if (Rop == PATCOPY)
+    {
+        /* The brush color has exact 5 bit components and a palette entry */
+        if (Bpp == 8)
+            Pixel = TEST_COLOR_INDEX;
+        else if (Bpp == 16)
+            Pixel = ((0x18 >> 3) << 10) | ((0x30 >> 3) << 5) | (0x48 >> 3);
+        else
+            Pixel = (0x18 << 16) | (0x30 << 8) | 0x48;
+
+        for (y = 0; y < BLT_HEIGHT; y++)
+        {
+            for (x = 0; x < BLT_WIDTH; x++)
+            {
+                Offset = (DST_Y + y) * Stride + (DST_X + x) * Bpp / 8;
+                CopyMemory(Expected + Offset, &Pixel, Bpp / 8);
+            }
+        }
+    }
+    else
+    {
+        for (y = 0; y < BLT_HEIGHT; y++)
+        {
+            for (x = 0; x < BLT_WIDTH * Bpp / 8; x++)
+            {
+                Offset = (DST_Y + y) * Stride + DST_X * Bpp / 8 + x;
+                Expected[Offset] = DoRop(Rop, Expected[Offset],
+                                         SrcBits[(SRC_Y + y) * Stride + SRC_X * Bpp / 8 + x]);
+            }
+        }
+    }
+
+    Errors = CountErrors(Expected, DstBits, TEST_WIDTH, Stride, Bpp);
+    ok(Errors == 0, "%s, %u bpp: %lu wrong pixels\n", TestRops[RopIndex].Name, Bpp, Errors);
+
+Cleanup:
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (hdcSrc)
+        DestroyDibDC(hdcSrc, SrcBitmap);
+    if (hdcDst)
+        DestroyDibDC(hdcDst, DstBitmap);
+}
+
+/* Source and target are the same surface, so the copy has to go in the
+ * right direction not to read back what it just wrote */
+static
+VOID
+TestOverlap(
+    _In_ WORD Bpp,
+    _In_ LONG dx,
+    _In_ LONG dy)
+{
+    ULONG Stride = GetStride(TEST_WIDTH, Bpp);
+    ULONG Size = Stride * TEST_HEIGHT;
+    HBITMAP Bitmap;
+    PBYTE Bits, Original = NULL, Expected = NULL;
+    HDC hdc;
+    ULONG y, Errors;
+
+    hdc = CreateDibDC(TEST_WIDTH, TEST_HEIGHT, Bpp, &Bits, &Bitmap);
+    if (hdc)
+    {
+        Original = HeapAlloc(GetProcessHeap(), 0, Size);
+        Expected = HeapAlloc(GetProcessHeap(), 0, Size);
+    }
+    ok(hdc && Original && Expected, "Setup failed for %u bpp\n", Bpp);
+    if (!hdc || !Original || !Expected)
+        goto Cleanup;
+
+    FillRandom(Bits, Size, Bpp);
+    CopyMemory(Original, Bits, Size);
+    CopyMemory(Expected, Bits, Size);
+
+    for (y = 0; y < BLT_HEIGHT; y++)
+    {
+        CopyMemory(Expected + (SRC_Y + dy + y) * Stride + (SRC_X + dx) * Bpp / 8,
+                   Original + (SRC_Y + y) * Stride + SRC_X * Bpp / 8,
+                   BLT_WIDTH * Bpp / 8);
+    }
+
+    ok(BitBlt(hdc, SRC_X + dx, SRC_Y + dy, BLT_WIDTH, BLT_HEIGHT, hdc, SRC_X, SRC_Y, SRCCOPY),
+       "SRCCOPY failed for %u bpp\n", Bpp);
+    GdiFlush();
+
+    Errors = CountErrors(Expected, Bits, TEST_WIDTH, Stride, Bpp);
+    ok(Errors == 0, "Overlapping SRCCOPY by (%ld, %ld), %u bpp: %lu wrong pixels\n",
+       dx, dy, Bpp, Errors);
+
+Cleanup:
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (Original)
+        HeapFree(GetProcessHeap(), 0, Original);
+    if (hdc)
+        DestroyDibDC(hdc, Bitmap);
+}
+
+/* Color is blue, green, red, like a 24 or 32 bpp source pixel */
+static
+VOID
+WritePixel(
+    _Out_ PBYTE Pixel,
+    _In_ WORD Bpp,
+    _In_ const BYTE *Color)
+{
+    WORD Pixel16;
+
+    /* Only grays are written to 8 bpp, their index is their value */
+    if (Bpp == 8)
+    {
+        Pixel[0] = Color[0];
+        return;
+    }
+
+    if (Bpp == 16)
+    {
+        /* 555, the low bits are dropped */
+        Pixel16 = ((Color[2] >> 3) << 10) | ((Color[1] >> 3) << 5) | (Color[0] >> 3);
+        CopyMemory(Pixel, &Pixel16, sizeof(Pixel16));
+        return;
+    }
+
+    Pixel[0] = Color[0];
+    Pixel[1] = Color[1];
+    Pixel[2] = Color[2];
+    if (Bpp == 32)
+        Pixel[3] = 0;
+}
+
+/* SRCCOPY between formats, from sources that need no rounding choices */
+static
+VOID
+TestTranslate(
+    _In_ WORD SrcBpp,
+    _In_ WORD DstBpp)
+{
+    ULONG SrcStride = GetStride(TEST_WIDTH, SrcBpp);
+    ULONG DstStride = GetStride(TEST_WIDTH, DstBpp);
+    ULONG DstSize = DstStride * TEST_HEIGHT;
+    HBITMAP SrcBitmap, DstBitmap;
+    PBYTE SrcBits, DstBits, Expected;
+    HDC hdcSrc, hdcDst;
+    ULONG x, y, Errors;
+
+    hdcSrc = CreateDibDC(TEST_WIDTH, TEST_HEIGHT, SrcBpp, &SrcBits, &SrcBitmap);
+    hdcDst = CreateDibDC(TEST_WIDTH, TEST_HEIGHT, DstBpp, &DstBits, &DstBitmap);
+    Expected = HeapAlloc(GetProcessHeap(), 0, DstSize);
+    ok(hdcSrc && hdcDst && Expected, "Setup failed for %u bpp to %u bpp\n", SrcBpp, DstBpp);
+    if (!hdcSrc || !hdcDst || !Expected)
+        goto Cleanup;
+
+    FillRandom(SrcBits, SrcStride * TEST_HEIGHT, SrcBpp);
+    FillRandom(DstBits, DstSize, DstBpp);
+    CopyMemory(Expected, DstBits, DstSize);
+
+    for (y = 0; y < BLT_HEIGHT; y++)
+    {
+        for (x = 0; x < BLT_WIDTH; x++)
+        {
+            WritePixel(Expected + (DST_Y + y) * DstStride + (DST_X + x) * DstBpp / 8, DstBpp,
+                       SrcBits + (SRC_Y + y) * SrcStride + (SRC_X + x) * SrcBpp / 8);
+        }
+    }
+
+    ok(BitBlt(hdcDst, DST_X, DST_Y, BLT_WIDTH, BLT_HEIGHT, hdcSrc, SRC_X, SRC_Y, SRCCOPY),
+       "SRCCOPY failed for %u bpp to %u bpp\n", SrcBpp, DstBpp);
+    GdiFlush();
+
+    Errors = CountErrors(Expected, DstBits, TEST_WIDTH, DstStride, DstBpp);
+    ok(Errors == 0, "SRCCOPY, %u bpp to %u bpp: %lu wrong pixels\n", SrcBpp, DstBpp, Errors);
+
+Cleanup:
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (hdcSrc)
+        DestroyDibDC(hdcSrc, SrcBitmap);
+    if (hdcDst)
+        DestroyDibDC(hdcDst, DstBitmap);
+}
+
+/* Like TestTranslate, over rows of several translation spans, and from
+ * palette sources and to palette targets as well */
+static
+VOID
+TestTranslateSpans(
+    _In_ WORD SrcBpp,
+    _In_ WORD DstBpp)
+{
+    ULONG SrcStride = GetStride(SPAN_TEST_WIDTH, SrcBpp);
+    ULONG DstStride = GetStride(SPAN_TEST_WIDTH, DstBpp);
+    ULONG DstSize = DstStride * TEST_HEIGHT;
+    HBITMAP SrcBitmap, DstBitmap;
+    PBYTE SrcBits, DstBits, Expected, Pixel;
+    HDC hdcSrc, hdcDst;
+    BYTE Color[3];
+    ULONG x, y, Errors;
+
+    hdcSrc = CreateDibDC(SPAN_TEST_WIDTH, TEST_HEIGHT, SrcBpp, &SrcBits, &SrcBitmap);
+    hdcDst = CreateDibDC(SPAN_TEST_WIDTH, TEST_HEIGHT, DstBpp, &DstBits, &DstBitmap);
+    Expected = HeapAlloc(GetProcessHeap(), 0, DstSize);
+    ok(hdcSrc && hdcDst && Expected, "Setup failed for %u bpp to %u bpp\n", SrcBpp, DstBpp);
+    if (!hdcSrc || !hdcDst || !Expected)
+        goto Cleanup;
+
+    FillRandom(SrcBits, SrcStride * TEST_HEIGHT, SrcBpp);
+    FillRandom(DstBits, DstSize, DstBpp);
+    CopyMemory(Expected, DstBits, DstSize);
+
+    for (y = 0; y < BLT_HEIGHT; y++)
+    {
+        for (x = 0; x < SPAN_BLT_WIDTH; x++)
+        {
+            Pixel = SrcBits + (SRC_Y + y) * SrcStride + (SRC_X + x) * SrcBpp / 8;
+
+            if (DstBpp == 8)
+            {
+                /* Grays match a palette entry exactly, except the one
+                 * TEST_COLOR took. Few of them, so that colors repeat */
+                Pixel[0] &= 0xF0;
+                Pixel[1] = Pixel[2] = Pixel[0];
+            }
+
+            if (SrcBpp == 8)
+            {
+                if (Pixel[0] == TEST_COLOR_INDEX)
+                {
+                    Color[0] = GetBValue(TEST_COLOR);
+                    Color[1] = GetGValue(TEST_COLOR);
+                    Color[2] = GetRValue(TEST_COLOR);
+                }
+                else
+                {
+                    Color[0] = Color[1] = Color[2] = Pixel[0];
+                }
+            }
+            else
+            {
+                CopyMemory(Color, Pixel, sizeof(Color));
+            }
+
+            WritePixel(Expected + (DST_Y + y) * DstStride + (DST_X + x) * DstBpp / 8, DstBpp, Color);
+        }
+    }
+
+    ok(BitBlt(hdcDst, DST_X, DST_Y, SPAN_BLT_WIDTH, BLT_HEIGHT, hdcSrc, SRC_X, SRC_Y, SRCCOPY),
+       "SRCCOPY failed for %u bpp to %u bpp\n", SrcBpp, DstBpp);
+    GdiFlush();
+
+    Errors = CountErrors(Expected, DstBits, SPAN_TEST_WIDTH, DstStride, DstBpp);
+    ok(Errors == 0, "SRCCOPY of %u pixel rows, %u bpp to %u bpp: %lu wrong pixels\n",
+       SPAN_BLT_WIDTH, SrcBpp, DstBpp, Errors);
+
+Cleanup:
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (hdcSrc)
+        DestroyDibDC(hdcSrc, SrcBitmap);
+    if (hdcDst)
+        DestroyDibDC(hdcDst, DstBitmap);
+}
+
+static
+VOID
+BenchRop(
+    _In_ DWORD Rop,
+    _In_ PCSTR Name,
+    _In_ WORD SrcBpp,
+    _In_ WORD DstBpp)
+{
+    HBITMAP SrcBitmap, DstBitmap;
+    PBYTE SrcBits, DstBits;
+    HDC hdcSrc, hdcDst;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed;
+    ULONG i;
+
+    hdcSrc = CreateDibDC(BENCH_WIDTH, BENCH_HEIGHT, SrcBpp, &SrcBits, &SrcBitmap);
+    hdcDst = CreateDibDC(BENCH_WIDTH, BENCH_HEIGHT, DstBpp, &DstBits, &DstBitmap);
+    if (!hdcSrc || !hdcDst)
+    {
+        skip("Could not create %u bpp and %u bpp DCs\n", SrcBpp, DstBpp);
+        goto Cleanup;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+        BitBlt(hdcDst, 0, 0, BENCH_WIDTH, BENCH_HEIGHT, hdcSrc, 0, 0, Rop);
+    GdiFlush();
+
+    QueryPerformanceCounter(&End);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    trace("%s, %u bpp to %u bpp: %I64u Mpixels/sec\n", Name, SrcBpp, DstBpp,
+          (ULONGLONG)BENCH_WIDTH * BENCH_HEIGHT * BENCH_ITERATIONS *
+          Frequency.QuadPart / Elapsed / 1000000);
+
+Cleanup:
+    if (hdcSrc)
+        DestroyDibDC(hdcSrc, SrcBitmap);
+    if (hdcDst)
+        DestroyDibDC(hdcDst, DstBitmap);
+}
+
+START_TEST(BitBlt)
+{
+    ULONG i, j;
+
+    srand(0);
+
+    for (i = 0; i < RTL_NUMBER_OF(TestRops); i++)
+    {
+        for (j = 0; j < RTL_NUMBER_OF(TestBpps); j++)
+            TestRop(i, TestBpps[j]);
+    }
+
+    for (j = 0; j < RTL_NUMBER_OF(TestBpps); j++)
+    {
+        TestOverlap(TestBpps[j], 3, 1);
+        TestOverlap(TestBpps[j], -3, -1);
+        TestOverlap(TestBpps[j], 2, 0);
+        TestOverlap(TestBpps[j], -2, 0);
+        TestOverlap(TestBpps[j], 0, 2);
+        TestOverlap(TestBpps[j], 0, -2);
+    }
+
+    TestTranslate(32, 24);
+    TestTranslate(24, 32);
+    TestTranslate(32, 16);
+    TestTranslate(24, 16);
+
+    TestTranslateSpans(8, 16);
+    TestTranslateSpans(8, 24);
+    TestTranslateSpans(8, 32);
+    TestTranslateSpans(24, 16);
+    TestTranslateSpans(24, 32);
+    TestTranslateSpans(32, 8);
+    TestTranslateSpans(32, 16);
+    TestTranslateSpans(32, 24);
+
+    /* Compare these between builds with and without USE_DIBLIB */
+    for (i = 0; i < RTL_NUMBER_OF(TestRops); i++)
+    {
+        for (j = 0; j < RTL_NUMBER_OF(TestBpps); j++)
+            BenchRop(TestRops[i].Rop, TestRops[i].Name, TestBpps[j], TestBpps[j]);
+    }
+
+    /* Translated copies */
+    BenchRop(SRCCOPY, "SRCCOPY", 32, 16);
+    BenchRop(SRCCOPY, "SRCCOPY", 16, 32);
+    BenchRop(SRCCOPY, "SRCCOPY", 24, 32);
+}
@@ -333,6 +333,196 @@ void Test_CombineRgn_XOR()
 
 }
 
+static
+VOID
+CheckRgnBox(
+    _In_ HRGN hrgn,
+    _In_ LONG left,
+    _In_ LONG top,
+    _In_ LONG right,
+    _In_ LONG bottom)
+{
+    RECT rc;
+
+    ok_long(GetRgnBox(hrgn, &rc), SIMPLEREGION);
+    ok((rc.left == left) && (rc.top == top) && (rc.right == right) && (rc.bottom == bottom),
+       "Wrong box: %ld,%ld,%ld,%ld\n", rc.left, rc.top, rc.right, rc.bottom);
+}
+
+void Test_CombineRgn_Bands()
+{
+    HRGN hrgn1, hrgn2, hrgn3;
+    INT i;
+
+    /* Build a region from rects top to bottom, the bands must be merged */
+    hrgn1 = CreateRectRgn(0, 0, 0, 0);
+    hrgn2 = CreateRectRgn(0, 0, 0, 0);
+    for (i = 0; i < 10; i++)
+    {
+        SetRectRgn(hrgn2, 10, i * 10, 50, (i + 1) * 10);
+        ok_long(CombineRgn(hrgn1, hrgn1, hrgn2, RGN_OR), SIMPLEREGION);
+    }
+    CheckRgnBox(hrgn1, 10, 0, 50, 100);
+
+    /* Same, from the bottom up with the destination as the second source */
+    SetRectRgn(hrgn1, 0, 0, 0, 0);
+    for (i = 9; i >= 0; i--)
+    {
+        SetRectRgn(hrgn2, 10, i * 10, 50, (i + 1) * 10);
+        ok_long(CombineRgn(hrgn1, hrgn2, hrgn1, RGN_OR), SIMPLEREGION);
+    }
+    CheckRgnBox(hrgn1, 10, 0, 50, 100);
+
+    /* Bands with a gap stay apart */
+    SetRectRgn(hrgn2, 10, 110, 50, 120);
+    ok_long(CombineRgn(hrgn1, hrgn1, hrgn2, RGN_OR), COMPLEXREGION);
+    ok_long(GetRegionData(hrgn1, 0, NULL), sizeof(RGNDATAHEADER) + 2 * sizeof(RECT));
+
+    /* Clip it in place, the remaining bands must be merged again */
+    hrgn3 = CreateRectRgn(0, 0, 0, 0);
+    SetRectRgn(hrgn1, 0, 0, 40, 10);
+    SetRectRgn(hrgn2, 0, 10, 60, 20);
+    ok_long(CombineRgn(hrgn1, hrgn1, hrgn2, RGN_OR), COMPLEXREGION);
+    SetRectRgn(hrgn2, 10, 0, 30, 30);
+    ok_long(CombineRgn(hrgn1, hrgn1, hrgn2, RGN_AND), SIMPLEREGION);
+    CheckRgnBox(hrgn1, 10, 0, 30, 20);
+
+    /* Same with the rectangle as the destination */
+    SetRectRgn(hrgn1, 0, 0, 40, 10);
+    SetRectRgn(hrgn3, 0, 10, 60, 20);
+    ok_long(CombineRgn(hrgn1, hrgn1, hrgn3, RGN_OR), COMPLEXREGION);
+    ok_long(CombineRgn(hrgn2, hrgn1, hrgn2, RGN_AND), SIMPLEREGION);
+    CheckRgnBox(hrgn2, 10, 0, 30, 20);
+
+    /* Two rects side by side make up one */
+    SetRectRgn(hrgn1, 0, 0, 10, 10);
+    SetRectRgn(hrgn2, 10, 0, 20, 10);
+    ok_long(CombineRgn(hrgn3, hrgn1, hrgn2, RGN_OR), SIMPLEREGION);
+    CheckRgnBox(hrgn3, 0, 0, 20, 10);
+
+    DeleteObject(hrgn1);
+    DeleteObject(hrgn2);
+    DeleteObject(hrgn3);
+}
+
+#define BENCH_ITERATIONS 10000
+
+static
+VOID
+BenchCombineRgn(
+    _In_ PCSTR Name,
+    _In_ HRGN hrgnDst,
+    _In_ HRGN hrgnSrc1,
+    _In_ HRGN hrgnSrc2,
+    _In_ INT iMode)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed;
+    HRGN hrgnSave;
+    ULONG i;
+
+    /* Operations in place would change the source, start over every time */
+    hrgnSave = CreateRectRgn(0, 0, 0, 0);
+    CombineRgn(hrgnSave, hrgnSrc1, NULL, RGN_COPY);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        CombineRgn(hrgnDst, hrgnSrc1, hrgnSrc2, iMode);
+        if (hrgnDst == hrgnSrc1)
+            CombineRgn(hrgnSrc1, hrgnSave, NULL, RGN_COPY);
+    }
+
+    QueryPerformanceCounter(&End);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    trace("%s: %I64u calls/sec\n", Name,
+          (ULONGLONG)BENCH_ITERATIONS * Frequency.QuadPart / Elapsed);
+
+    DeleteObject(hrgnSave);
+}
+
+/* Builds a region from rects top to bottom, like window management does */
+static
+VOID
+BenchBuildRgn(VOID)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed;
+    HRGN hrgnDst, hrgnRect;
+    ULONG i;
+    INT j;
+
+    hrgnDst = CreateRectRgn(0, 0, 0, 0);
+    hrgnRect = CreateRectRgn(0, 0, 0, 0);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        SetRectRgn(hrgnDst, 0, 0, 0, 0);
+        for (j = 0; j < 32; j++)
+        {
+            SetRectRgn(hrgnRect, (j & 3) * 10, j * 10, (j & 3) * 10 + 100, j * 10 + 10);
+            CombineRgn(hrgnDst, hrgnDst, hrgnRect, RGN_OR);
+        }
+    }
+
+    QueryPerformanceCounter(&End);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    trace("build from 32 rects: %I64u regions/sec\n",
+          (ULONGLONG)BENCH_ITERATIONS * Frequency.QuadPart / Elapsed);
+
+    DeleteObject(hrgnDst);
+    DeleteObject(hrgnRect);
+}
+
+/* Compare these between builds, they don't check anything */
+void Bench_CombineRgn()
+{
+    HRGN hrgnRect, hrgnRect2, hrgnComplex, hrgnDst, hrgnTemp;
+    INT i;
+
+    hrgnRect = CreateRectRgn(100, 100, 300, 200);
+    hrgnRect2 = CreateRectRgn(150, 150, 350, 250);
+    hrgnDst = CreateRectRgn(0, 0, 0, 0);
+    hrgnTemp = CreateRectRgn(0, 0, 0, 0);
+
+    /* Something like the visible region of a window with a few overlaps */
+    hrgnComplex = CreateRectRgn(0, 0, 640, 480);
+    for (i = 0; i < 20; i++)
+    {
+        SetRectRgn(hrgnTemp, i * 30, i * 20, i * 30 + 25, i * 20 + 15);
+        CombineRgn(hrgnComplex, hrgnComplex, hrgnTemp, RGN_DIFF);
+    }
+
+    BenchCombineRgn("rect AND rect", hrgnDst, hrgnRect, hrgnRect2, RGN_AND);
+    BenchCombineRgn("rect OR rect", hrgnDst, hrgnRect, hrgnRect2, RGN_OR);
+    BenchCombineRgn("complex AND rect", hrgnDst, hrgnComplex, hrgnRect, RGN_AND);
+    BenchCombineRgn("complex AND rect in place", hrgnComplex, hrgnComplex, hrgnRect, RGN_AND);
+    BenchCombineRgn("complex OR rect", hrgnDst, hrgnComplex, hrgnRect, RGN_OR);
+    BenchCombineRgn("complex DIFF rect", hrgnDst, hrgnComplex, hrgnRect, RGN_DIFF);
+    BenchCombineRgn("complex XOR rect", hrgnDst, hrgnComplex, hrgnRect, RGN_XOR);
+
+    BenchBuildRgn();
+
+    DeleteObject(hrgnRect);
+    DeleteObject(hrgnRect2);
+    DeleteObject(hrgnComplex);
+    DeleteObject(hrgnDst);
+    DeleteObject(hrgnTemp);
+}
+
 START_TEST(CombineRgn)
 {
     Test_CombineRgn_Params();
@@ -342,5 +532,7 @@ START_TEST(CombineRgn)
     Test_CombineRgn_DIFF();
     Test_CombineRgn_XOR();
     Test_RectRegions();
+    Test_CombineRgn_Bands();
+    Bench_CombineRgn();
 }
 
@@ -0,0 +1,252 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for text output from several threads
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define BENCH_ITERATIONS  200
+#define BENCH_MAX_THREADS 8
+#define BENCH_WIDTH       640
+#define BENCH_HEIGHT      32
+
+static const WCHAR BenchText[] = L"The quick brown fox jumps over the lazy dog 0123456789";
+#define BENCH_TEXT_LENGTH (RTL_NUMBER_OF(BenchText) - 1)
+
+static PCWSTR BenchFaces[] =
+{
+    L"Tahoma",
+    L"Arial",
+    L"Courier New",
+    L"Times New Roman",
+};
+
+typedef struct _BENCH_CONTEXT
+{
+    PCWSTR FaceName;
+    INT Height;
+    HANDLE StartEvent;
+    PVOID Reference;
+    ULONG Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+HDC
+CreateTextDC(
+    _In_ PCWSTR FaceName,
+    _In_ INT Height,
+    _Out_ PVOID *Bits,
+    _Out_ HBITMAP *Bitmap,
+    _Out_ HFONT *Font)
+{
+    BITMAPINFO bmi;
+    HDC hdc;
+
+    hdc = CreateCompatibleDC(NULL);
+    if (!hdc)
+        return NULL;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = BENCH_WIDTH;
+    bmi.bmiHeader.biHeight = -BENCH_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    *Bitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, Bits, NULL, 0);
+    if (!*Bitmap)
+    {
+        DeleteDC(hdc);
+        return NULL;
+    }
+
+    *Font = CreateFontW(Height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+                        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                        ANTIALIASED_QUALITY, DEFAULT_PITCH, FaceName);
+    if (!*Font)
+    {
+        DeleteObject(*Bitmap);
+        DeleteDC(hdc);
+        return NULL;
+    }
+
+    SelectObject(hdc, *Bitmap);
+    SelectObject(hdc, *Font);
+    SetBkMode(hdc, OPAQUE);
+    SetBkColor(hdc, RGB(255, 255, 255));
+    SetTextColor(hdc, RGB(0, 0, 0));
+    return hdc;
+}
+
+static
+VOID
+DestroyTextDC(
+    _In_ HDC hdc,
+    _In_ HBITMAP Bitmap,
+    _In_ HFONT Font)
+{
+    DeleteDC(hdc);
+    DeleteObject(Bitmap);
+    DeleteObject(Font);
+}
+
+static
+BOOL
+DrawBenchText(
+    _In_ HDC hdc)
+{
+    RECT rc = { 0, 0, BENCH_WIDTH, BENCH_HEIGHT };
+
+    return ExtTextOutW(hdc, 0, 0, ETO_OPAQUE, &rc, BenchText, BENCH_TEXT_LENGTH, NULL);
+}
+
+static
+DWORD
+WINAPI
+BenchThread(
+    _In_ PVOID Parameter)
+{
+    PBENCH_CONTEXT Context = Parameter;
+    HBITMAP Bitmap;
+    HFONT Font;
+    PVOID Bits;
+    HDC hdc;
+    ULONG i;
+
+    hdc = CreateTextDC(Context->FaceName, Context->Height, &Bits, &Bitmap, &Font);
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+    if (!hdc)
+    {
+        Context->Failures++;
+        return 0;
+    }
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        if (!DrawBenchText(hdc))
+            Context->Failures++;
+    }
+
+    /* Other threads must not have disturbed our face */
+    GdiFlush();
+    if (memcmp(Bits, Context->Reference, BENCH_WIDTH * BENCH_HEIGHT * 4) != 0)
+        Context->Failures++;
+
+    DestroyTextDC(hdc, Bitmap, Font);
+    return 0;
+}
+
+static
+PVOID
+RenderReference(
+    _In_ PCWSTR FaceName,
+    _In_ INT Height)
+{
+    HBITMAP Bitmap;
+    HFONT Font;
+    PVOID Bits, Reference;
+    HDC hdc;
+
+    hdc = CreateTextDC(FaceName, Height, &Bits, &Bitmap, &Font);
+    ok(hdc != NULL, "CreateTextDC failed for %S\n", FaceName);
+    if (!hdc)
+        return NULL;
+
+    Reference = HeapAlloc(GetProcessHeap(), 0, BENCH_WIDTH * BENCH_HEIGHT * 4);
+    if (Reference)
+    {
+        ok(DrawBenchText(hdc), "ExtTextOutW failed for %S\n", FaceName);
+        GdiFlush();
+        CopyMemory(Reference, Bits, BENCH_WIDTH * BENCH_HEIGHT * 4);
+    }
+
+    DestroyTextDC(hdc, Bitmap, Font);
+    return Reference;
+}
+
+static
+VOID
+RunBenchmark(
+    _In_ ULONG ThreadCount,
+    _In_ BOOL SameFace)
+{
+    BENCH_CONTEXT Contexts[BENCH_MAX_THREADS];
+    HANDLE Threads[BENCH_MAX_THREADS];
+    PVOID References[RTL_NUMBER_OF(BenchFaces)];
+    HANDLE StartEvent;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed, Glyphs;
+    ULONG i, Face;
+
+    for (i = 0; i < RTL_NUMBER_OF(BenchFaces); i++)
+        References[i] = RenderReference(BenchFaces[i], 20);
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!StartEvent)
+        goto Cleanup;
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Face = SameFace ? 0 : i % RTL_NUMBER_OF(BenchFaces);
+        Threads[i] = NULL;
+        if (!References[Face])
+            continue;
+
+        Contexts[i].FaceName = BenchFaces[Face];
+        Contexts[i].Height = 20;
+        Contexts[i].StartEvent = StartEvent;
+        Contexts[i].Reference = References[Face];
+        Contexts[i].Failures = 0;
+        Threads[i] = CreateThread(NULL, 0, BenchThread, &Contexts[i], 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        if (!Threads[i])
+            continue;
+
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+        ok(Contexts[i].Failures == 0, "%lu failures in thread %lu\n", Contexts[i].Failures, i);
+    }
+
+    QueryPerformanceCounter(&End);
+    CloseHandle(StartEvent);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    Glyphs = (ULONGLONG)ThreadCount * BENCH_ITERATIONS * BENCH_TEXT_LENGTH;
+    trace("%s, %lu threads: %I64u glyphs/sec\n",
+          SameFace ? "Same face" : "Different faces",
+          ThreadCount,
+          Glyphs * Frequency.QuadPart / Elapsed);
+
+Cleanup:
+    for (i = 0; i < RTL_NUMBER_OF(BenchFaces); i++)
+    {
+        if (References[i])
+            HeapFree(GetProcessHeap(), 0, References[i]);
+    }
+}
+
+START_TEST(ExtTextOut)
+{
+    ULONG ThreadCount;
+
+    for (ThreadCount = 1; ThreadCount <= BENCH_MAX_THREADS; ThreadCount *= 2)
+    {
+        RunBenchmark(ThreadCount, TRUE);
+        RunBenchmark(ThreadCount, FALSE);
+    }
+}
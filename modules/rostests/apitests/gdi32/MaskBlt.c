@@ -197,6 +197,19 @@ void Test_MaskBlt_32bpp()
     ok(ret == 1, "MaskBlt failed (%d)\n", ret);
     ok (pulBitsDst[0] == 0x977c5779, "pulBitsDst[0] == 0x%lx\n", pulBitsDst[0]);
     ok (pulBitsDst[1] == 0xfabefef6, "pulBitsDst[0] == 0x%lx\n", pulBitsDst[1]);
+
+    /* Only the mask is used (BLACKNESS / WHITENESS) */
+    pulBitsDst[0] = 0x12345678;
+    pulBitsDst[1] = 0x9abcdef0;
+    ret = MaskBlt(hdcDst, 0, 0, 8, 1, hdcSrc, 0, 0, hbmMsk, 0, 0, MAKEROP4(BLACKNESS, WHITENESS));
+    ok(ret == 1, "MaskBlt failed (%d)\n", ret);
+    ok ((pulBitsDst[0] & 0xFFFFFF) == 0, "pulBitsDst[0] == 0x%lx\n", pulBitsDst[0]);
+    ok ((pulBitsDst[1] & 0xFFFFFF) == 0xFFFFFF, "pulBitsDst[1] == 0x%lx\n", pulBitsDst[1]);
+
+    ret = MaskBlt(hdcDst, 0, 0, 8, 1, hdcSrc, 0, 0, hbmMsk, 0, 0, MAKEROP4(WHITENESS, BLACKNESS));
+    ok(ret == 1, "MaskBlt failed (%d)\n", ret);
+    ok ((pulBitsDst[0] & 0xFFFFFF) == 0xFFFFFF, "pulBitsDst[0] == 0x%lx\n", pulBitsDst[0]);
+    ok ((pulBitsDst[1] & 0xFFFFFF) == 0, "pulBitsDst[1] == 0x%lx\n", pulBitsDst[1]);
 }
 
 void Test_MaskBlt_Brush()
@@ -0,0 +1,294 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test for ReadFileScatter and WriteFileGather
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define TEST_PAGES      16
+#define BENCH_PAGES     256
+#define BENCH_ROUNDS    8
+
+static DWORD PageSize;
+
+#define SEGMENT_PAGE(Segment) ((PUCHAR)(ULONG_PTR)(Segment).Alignment)
+
+static
+BOOL
+WaitForIo(HANDLE File, BOOL Ret, LPOVERLAPPED Overlapped, PDWORD Bytes)
+{
+    if (!Ret && GetLastError() != ERROR_IO_PENDING)
+        return FALSE;
+
+    return GetOverlappedResult(File, Overlapped, Bytes, TRUE);
+}
+
+static
+HANDLE
+CreateTestFile(PCWSTR FileName, DWORD Flags)
+{
+    return CreateFileW(FileName,
+                       GENERIC_READ | GENERIC_WRITE,
+                       0,
+                       NULL,
+                       CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE | Flags,
+                       NULL);
+}
+
+/* Use every other page, backwards, so that no two segments are contiguous */
+static
+VOID
+SetupSegments(PUCHAR Pages, ULONG Count, FILE_SEGMENT_ELEMENT *Segments)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+        Segments[i].Alignment = (ULONG_PTR)(Pages + (2 * (Count - 1 - i)) * PageSize);
+    Segments[Count].Alignment = 0;
+}
+
+/* Each segment gets its own byte, so that a page read into the wrong segment shows */
+static
+VOID
+FillSegments(FILE_SEGMENT_ELEMENT *Segments, ULONG Count, BOOL Clear)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+        memset(SEGMENT_PAGE(Segments[i]), Clear ? 0 : (UCHAR)(i + 1), PageSize);
+}
+
+static
+ULONG
+CheckSegments(FILE_SEGMENT_ELEMENT *Segments, ULONG Count)
+{
+    ULONG Errors = 0, i, j;
+    PUCHAR Page;
+
+    for (i = 0; i < Count; i++)
+    {
+        Page = SEGMENT_PAGE(Segments[i]);
+        for (j = 0; j < PageSize; j++)
+        {
+            if (Page[j] != (UCHAR)(i + 1))
+            {
+                Errors++;
+                break;
+            }
+        }
+    }
+
+    return Errors;
+}
+
+static
+VOID
+TestScatterGather(PCWSTR FileName, PUCHAR Pages, FILE_SEGMENT_ELEMENT *Segments)
+{
+    OVERLAPPED Overlapped;
+    HANDLE File;
+    DWORD Bytes, Error;
+    BOOL Ret;
+    ULONG i;
+
+    RtlZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    /* Buffered files aren't supported */
+    File = CreateTestFile(FileName, FILE_FLAG_OVERLAPPED);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (File != INVALID_HANDLE_VALUE)
+    {
+        SetupSegments(Pages, TEST_PAGES, Segments);
+        SetLastError(0xdeadbeef);
+        Ret = WriteFileGather(File, Segments, TEST_PAGES * PageSize, NULL, &Overlapped);
+        Error = GetLastError();
+        ok(Ret == FALSE, "WriteFileGather succeeded\n");
+        ok(Error == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %lu\n", Error);
+        CloseHandle(File);
+    }
+
+    File = CreateTestFile(FileName, FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(Overlapped.hEvent);
+        return;
+    }
+
+    /* Each page gets its own pattern */
+    SetupSegments(Pages, TEST_PAGES, Segments);
+    for (i = 0; i < TEST_PAGES; i++)
+        FillMemory(SEGMENT_PAGE(Segments[i]), PageSize, (BYTE)(0x10 + i));
+
+    Ret = WriteFileGather(File, Segments, TEST_PAGES * PageSize, NULL, &Overlapped);
+    Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+    ok(Ret, "WriteFileGather failed: %lu\n", GetLastError());
+    ok(Bytes == TEST_PAGES * PageSize, "Wrote %lu bytes\n", Bytes);
+
+    /* Read the pages back in the opposite order */
+    for (i = 0; i < TEST_PAGES; i++)
+        Segments[i].Alignment = (ULONG_PTR)(Pages + (2 * i + 1) * PageSize);
+    Segments[TEST_PAGES].Alignment = 0;
+    for (i = 0; i < TEST_PAGES; i++)
+        FillMemory(SEGMENT_PAGE(Segments[i]), PageSize, 0xCC);
+
+    ResetEvent(Overlapped.hEvent);
+    Ret = ReadFileScatter(File, Segments, TEST_PAGES * PageSize, NULL, &Overlapped);
+    Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+    ok(Ret, "ReadFileScatter failed: %lu\n", GetLastError());
+    ok(Bytes == TEST_PAGES * PageSize, "Read %lu bytes\n", Bytes);
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        PUCHAR Page = SEGMENT_PAGE(Segments[i]);
+        ok(Page[0] == (BYTE)(0x10 + i) && Page[PageSize - 1] == (BYTE)(0x10 + i),
+           "Page %lu has 0x%02x..0x%02x\n", i, Page[0], Page[PageSize - 1]);
+    }
+
+    /* A partial read starting at the second page */
+    Overlapped.Offset = PageSize;
+    ResetEvent(Overlapped.hEvent);
+    Ret = ReadFileScatter(File, Segments, 2 * PageSize, NULL, &Overlapped);
+    Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+    ok(Ret, "ReadFileScatter failed: %lu\n", GetLastError());
+    ok(Bytes == 2 * PageSize, "Read %lu bytes\n", Bytes);
+    ok(SEGMENT_PAGE(Segments[0])[0] == 0x11, "Got 0x%02x\n", SEGMENT_PAGE(Segments[0])[0]);
+    ok(SEGMENT_PAGE(Segments[1])[0] == 0x12, "Got 0x%02x\n", SEGMENT_PAGE(Segments[1])[0]);
+    Overlapped.Offset = 0;
+
+    /* Segments must be page aligned */
+    Segments[1].Alignment += 512;
+    SetLastError(0xdeadbeef);
+    Ret = ReadFileScatter(File, Segments, 2 * PageSize, NULL, &Overlapped);
+    Error = GetLastError();
+    ok(Ret == FALSE, "ReadFileScatter succeeded\n");
+    ok(Error == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %lu\n", Error);
+
+    /* So must be the length */
+    Segments[1].Alignment = (ULONG_PTR)(Pages + 3 * PageSize);
+    SetLastError(0xdeadbeef);
+    Ret = ReadFileScatter(File, Segments, PageSize + 1, NULL, &Overlapped);
+    Error = GetLastError();
+    ok(Ret == FALSE, "ReadFileScatter succeeded\n");
+    ok(Error == ERROR_INVALID_PARAMETER, "Expected ERROR_INVALID_PARAMETER, got %lu\n", Error);
+
+    /* Reading past the end */
+    Overlapped.Offset = TEST_PAGES * PageSize;
+    ResetEvent(Overlapped.hEvent);
+    SetLastError(0xdeadbeef);
+    Ret = ReadFileScatter(File, Segments, PageSize, NULL, &Overlapped);
+    Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+    Error = GetLastError();
+    ok(Ret == FALSE, "ReadFileScatter succeeded\n");
+    ok(Error == ERROR_HANDLE_EOF, "Expected ERROR_HANDLE_EOF, got %lu\n", Error);
+
+    CloseHandle(File);
+    CloseHandle(Overlapped.hEvent);
+}
+
+/* One system call for the whole buffer against one per page */
+static
+VOID
+BenchmarkScatter(PCWSTR FileName, PUCHAR Pages, FILE_SEGMENT_ELEMENT *Segments)
+{
+    LARGE_INTEGER Frequency, Start, ScatterTime, LoopTime;
+    ULONG Round, i;
+    OVERLAPPED Overlapped;
+    HANDLE File;
+    DWORD Bytes;
+    BOOL Ret;
+
+    File = CreateTestFile(FileName, FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+        return;
+
+    RtlZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    SetupSegments(Pages, BENCH_PAGES, Segments);
+    FillSegments(Segments, BENCH_PAGES, FALSE);
+    Ret = WriteFileGather(File, Segments, BENCH_PAGES * PageSize, NULL, &Overlapped);
+    Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+    ok(Ret, "WriteFileGather failed: %lu\n", GetLastError());
+    if (!Ret)
+        goto Cleanup;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    FillSegments(Segments, BENCH_PAGES, TRUE);
+    QueryPerformanceCounter(&Start);
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        ResetEvent(Overlapped.hEvent);
+        Ret = ReadFileScatter(File, Segments, BENCH_PAGES * PageSize, NULL, &Overlapped);
+        Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+        ok(Ret && Bytes == BENCH_PAGES * PageSize, "ReadFileScatter failed: %lu\n", GetLastError());
+    }
+    QueryPerformanceCounter(&ScatterTime);
+    ScatterTime.QuadPart -= Start.QuadPart;
+    ok(CheckSegments(Segments, BENCH_PAGES) == 0, "ReadFileScatter read wrong data\n");
+
+    FillSegments(Segments, BENCH_PAGES, TRUE);
+    QueryPerformanceCounter(&Start);
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        for (i = 0; i < BENCH_PAGES; i++)
+        {
+            Overlapped.Offset = i * PageSize;
+            ResetEvent(Overlapped.hEvent);
+            Ret = ReadFile(File, SEGMENT_PAGE(Segments[i]), PageSize, NULL, &Overlapped);
+            Ret = WaitForIo(File, Ret, &Overlapped, &Bytes);
+            ok(Ret && Bytes == PageSize, "ReadFile failed: %lu\n", GetLastError());
+        }
+    }
+    QueryPerformanceCounter(&LoopTime);
+    LoopTime.QuadPart -= Start.QuadPart;
+    ok(CheckSegments(Segments, BENCH_PAGES) == 0, "ReadFile read wrong data\n");
+
+    trace("ReadFileScatter: %lu system calls, %I64u MB/s\n",
+          (ULONG)BENCH_ROUNDS,
+          (ULONGLONG)BENCH_ROUNDS * BENCH_PAGES * PageSize * Frequency.QuadPart /
+          (max(ScatterTime.QuadPart, 1) * 1024 * 1024));
+    trace("Looped ReadFile: %lu system calls, %I64u MB/s\n",
+          (ULONG)(BENCH_ROUNDS * BENCH_PAGES),
+          (ULONGLONG)BENCH_ROUNDS * BENCH_PAGES * PageSize * Frequency.QuadPart /
+          (max(LoopTime.QuadPart, 1) * 1024 * 1024));
+
+Cleanup:
+    CloseHandle(File);
+    CloseHandle(Overlapped.hEvent);
+}
+
+START_TEST(ReadFileScatter)
+{
+    FILE_SEGMENT_ELEMENT *Segments;
+    WCHAR TempPath[MAX_PATH], FileName[MAX_PATH];
+    SYSTEM_INFO SystemInfo;
+    PUCHAR Pages;
+
+    GetSystemInfo(&SystemInfo);
+    PageSize = SystemInfo.dwPageSize;
+
+    GetTempPathW(RTL_NUMBER_OF(TempPath), TempPath);
+    GetTempFileNameW(TempPath, L"sct", 0, FileName);
+
+    Pages = VirtualAlloc(NULL, 2 * BENCH_PAGES * PageSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    Segments = HeapAlloc(GetProcessHeap(), 0, (BENCH_PAGES + 1) * sizeof(*Segments));
+    if (!Pages || !Segments)
+    {
+        skip("Out of memory\n");
+    }
+    else
+    {
+        TestScatterGather(FileName, Pages, Segments);
+        BenchmarkScatter(FileName, Pages, Segments);
+    }
+
+    if (Segments) HeapFree(GetProcessHeap(), 0, Segments);
+    if (Pages) VirtualFree(Pages, 0, MEM_RELEASE);
+    DeleteFileW(FileName);
+}
@@ -0,0 +1,399 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for the low fragmentation front end heap
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define BENCH_ITERATIONS 20000
+#define BENCH_BATCH      64
+#define BENCH_MAX_THREADS 8
+
+/* Enough blocks per round to run through several sub-segments */
+#define STRESS_THREADS 16
+#define STRESS_ROUNDS  200
+#define STRESS_BLOCKS  300
+#define STRESS_SIZE    500
+
+typedef struct _BENCH_CONTEXT
+{
+    HANDLE Heap;
+    SIZE_T Size;
+    HANDLE StartEvent;
+    ULONG Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+DWORD
+WINAPI
+BenchThread(
+    _In_ PVOID Parameter)
+{
+    PBENCH_CONTEXT Context = Parameter;
+    PVOID Blocks[BENCH_BATCH];
+    ULONG i, j;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    for (i = 0; i < BENCH_ITERATIONS / BENCH_BATCH; i++)
+    {
+        for (j = 0; j < BENCH_BATCH; j++)
+        {
+            Blocks[j] = RtlAllocateHeap(Context->Heap, 0, Context->Size);
+            if (!Blocks[j])
+            {
+                Context->Failures++;
+                continue;
+            }
+
+            /* Touch it, so that a broken block would corrupt its neighbours */
+            *(PUCHAR)Blocks[j] = (UCHAR)j;
+            ((PUCHAR)Blocks[j])[Context->Size - 1] = (UCHAR)j;
+        }
+
+        for (j = 0; j < BENCH_BATCH; j++)
+        {
+            if (!Blocks[j])
+                continue;
+
+            if (*(PUCHAR)Blocks[j] != (UCHAR)j ||
+                ((PUCHAR)Blocks[j])[Context->Size - 1] != (UCHAR)j)
+            {
+                Context->Failures++;
+            }
+
+            if (!RtlFreeHeap(Context->Heap, 0, Blocks[j]))
+                Context->Failures++;
+        }
+    }
+
+    return 0;
+}
+
+static
+VOID
+RunBenchmark(
+    _In_ HANDLE Heap,
+    _In_ SIZE_T Size,
+    _In_ ULONG ThreadCount,
+    _In_ PCSTR Description)
+{
+    BENCH_CONTEXT Contexts[BENCH_MAX_THREADS];
+    HANDLE Threads[BENCH_MAX_THREADS];
+    HANDLE StartEvent;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed, Operations;
+    ULONG i;
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!StartEvent)
+        return;
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Contexts[i].Heap = Heap;
+        Contexts[i].Size = Size;
+        Contexts[i].StartEvent = StartEvent;
+        Contexts[i].Failures = 0;
+        Threads[i] = CreateThread(NULL, 0, BenchThread, &Contexts[i], 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        if (!Threads[i])
+            continue;
+
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+        ok(Contexts[i].Failures == 0, "%lu failures in thread %lu\n", Contexts[i].Failures, i);
+    }
+
+    QueryPerformanceCounter(&End);
+    CloseHandle(StartEvent);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    /* One allocation and one free per iteration */
+    Operations = (ULONGLONG)ThreadCount * (BENCH_ITERATIONS / BENCH_BATCH) * BENCH_BATCH;
+    trace("%s: %4lu bytes, %lu threads: %I64u allocations/sec\n",
+          Description,
+          (ULONG)Size,
+          ThreadCount,
+          Operations * Frequency.QuadPart / Elapsed);
+}
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE Heap;
+    HANDLE StartEvent;
+    ULONG Id;
+    ULONG Failures;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+/* Every thread empties whole sub-segments of the same bucket, while the
+   others still allocate from it. Blocks carry the thread and their index,
+   so a block handed out twice or out of a freed sub-segment shows */
+static
+DWORD
+WINAPI
+StressThread(
+    _In_ PVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    PULONG Blocks[STRESS_BLOCKS];
+    ULONG Round, i, j, Tag;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    for (Round = 0; Round < STRESS_ROUNDS; Round++)
+    {
+        for (i = 0; i < STRESS_BLOCKS; i++)
+        {
+            Blocks[i] = RtlAllocateHeap(Context->Heap, 0, STRESS_SIZE);
+            if (!Blocks[i])
+            {
+                Context->Failures++;
+                continue;
+            }
+
+            Tag = (Context->Id << 24) | (Round << 12) | i;
+            for (j = 0; j < STRESS_SIZE / sizeof(ULONG); j++)
+                Blocks[i][j] = Tag;
+        }
+
+        /* Free them in an order which differs from the allocation order */
+        for (i = 0; i < STRESS_BLOCKS; i++)
+        {
+            PULONG Block = Blocks[(i * 7) % STRESS_BLOCKS];
+
+            if (!Block)
+                continue;
+
+            Tag = (Context->Id << 24) | (Round << 12) | ((i * 7) % STRESS_BLOCKS);
+            for (j = 0; j < STRESS_SIZE / sizeof(ULONG); j++)
+            {
+                if (Block[j] != Tag)
+                {
+                    Context->Failures++;
+                    break;
+                }
+            }
+
+            if (!RtlFreeHeap(Context->Heap, 0, Block))
+                Context->Failures++;
+        }
+
+        /* Let another thread free the retired sub-segments now and then */
+        if ((Round % 16) == (Context->Id % 16))
+            RtlCompactHeap(Context->Heap, 0);
+    }
+
+    return 0;
+}
+
+static
+VOID
+StressFrontEnd(VOID)
+{
+    STRESS_CONTEXT Contexts[STRESS_THREADS];
+    HANDLE Threads[STRESS_THREADS];
+    HANDLE Heap, StartEvent;
+    ULONG Information = 2;
+    ULONG i;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap)
+        return;
+
+    ok_hex(RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information)), STATUS_SUCCESS);
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!StartEvent)
+    {
+        RtlDestroyHeap(Heap);
+        return;
+    }
+
+    /* More threads than affinity slots, so that slots are shared as well */
+    for (i = 0; i < STRESS_THREADS; i++)
+    {
+        Contexts[i].Heap = Heap;
+        Contexts[i].StartEvent = StartEvent;
+        Contexts[i].Id = i;
+        Contexts[i].Failures = 0;
+        Threads[i] = CreateThread(NULL, 0, StressThread, &Contexts[i], 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    SetEvent(StartEvent);
+
+    for (i = 0; i < STRESS_THREADS; i++)
+    {
+        if (!Threads[i])
+            continue;
+
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+        ok(Contexts[i].Failures == 0, "%lu failures in stress thread %lu\n", Contexts[i].Failures, i);
+    }
+
+    CloseHandle(StartEvent);
+
+    ok(RtlValidateHeap(Heap, 0, NULL) == TRUE, "Heap is not valid after the stress test\n");
+    RtlDestroyHeap(Heap);
+}
+
+static
+VOID
+TestFrontEnd(VOID)
+{
+    HANDLE Heap;
+    NTSTATUS Status;
+    ULONG Information, Sizes[] = { 1, 16, 100, 512, 1000 };
+    PVOID Ptr, NewPtr, Blocks[2000];
+    SIZE_T Size;
+    ULONG i;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap)
+        return;
+
+    /* No front end by default */
+    Information = 0xdeadbeef;
+    Status = RtlQueryHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_dec(Information, 0);
+
+    /* Only the LFH can be requested */
+    Information = 1;
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information));
+    ok_hex(Status, STATUS_UNSUCCESSFUL);
+
+    Information = 2;
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information));
+    ok_hex(Status, STATUS_SUCCESS);
+
+    Information = 0xdeadbeef;
+    Status = RtlQueryHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_dec(Information, 2);
+
+    /* Small blocks keep their size, zeroing and reallocation semantics */
+    for (i = 0; i < RTL_NUMBER_OF(Sizes); i++)
+    {
+        Ptr = RtlAllocateHeap(Heap, HEAP_ZERO_MEMORY, Sizes[i]);
+        ok(Ptr != NULL, "Allocation of %lu bytes failed\n", Sizes[i]);
+        if (!Ptr)
+            continue;
+
+        Size = RtlSizeHeap(Heap, 0, Ptr);
+        ok(Size == Sizes[i], "Expected size %lu, got %lu\n", Sizes[i], (ULONG)Size);
+        ok(*(PUCHAR)Ptr == 0 && ((PUCHAR)Ptr)[Sizes[i] - 1] == 0, "Block is not zeroed\n");
+
+        memset(Ptr, 0x55, Sizes[i]);
+        NewPtr = RtlReAllocateHeap(Heap, HEAP_ZERO_MEMORY, Ptr, Sizes[i] * 3);
+        ok(NewPtr != NULL, "Reallocation to %lu bytes failed\n", Sizes[i] * 3);
+        if (!NewPtr)
+        {
+            RtlFreeHeap(Heap, 0, Ptr);
+            continue;
+        }
+
+        ok(((PUCHAR)NewPtr)[Sizes[i] - 1] == 0x55, "Contents were not preserved\n");
+        ok(((PUCHAR)NewPtr)[Sizes[i]] == 0, "Grown part is not zeroed\n");
+        ok(RtlSizeHeap(Heap, 0, NewPtr) == Sizes[i] * 3, "Wrong size after reallocation\n");
+        ok(RtlFreeHeap(Heap, 0, NewPtr) == TRUE, "RtlFreeHeap failed\n");
+    }
+
+    /* Front end blocks are validated against their sub-segment */
+    Ptr = RtlAllocateHeap(Heap, 0, 32);
+    ok(Ptr != NULL, "Allocation failed\n");
+    if (Ptr)
+    {
+        ok(RtlValidateHeap(Heap, 0, Ptr) == TRUE, "Block is not valid\n");
+        ok(RtlFreeHeap(Heap, 0, Ptr) == TRUE, "RtlFreeHeap failed\n");
+        ok(RtlValidateHeap(Heap, 0, Ptr) == FALSE, "Freed block is valid\n");
+        ok(RtlFreeHeap(Heap, 0, Ptr) == FALSE, "Double free succeeded\n");
+        ok(RtlReAllocateHeap(Heap, 0, Ptr, 64) == NULL, "Reallocation of a freed block succeeded\n");
+    }
+
+    /* Empty sub-segments go back to the back end */
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        Blocks[i] = RtlAllocateHeap(Heap, 0, 48);
+        ok(Blocks[i] != NULL, "Allocation %lu failed\n", i);
+    }
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        if (Blocks[i])
+            ok(RtlFreeHeap(Heap, 0, Blocks[i]) == TRUE, "RtlFreeHeap failed\n");
+    }
+    ok(RtlCompactHeap(Heap, 0) != 0, "RtlCompactHeap found no free block\n");
+    ok(RtlValidateHeap(Heap, 0, NULL) == TRUE, "Heap is not valid\n");
+
+    RtlDestroyHeap(Heap);
+
+    /* A non-serialized heap can't use the front end */
+    Heap = RtlCreateHeap(HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap)
+        return;
+
+    Information = 2;
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Information, sizeof(Information));
+    ok_hex(Status, STATUS_UNSUCCESSFUL);
+
+    RtlDestroyHeap(Heap);
+}
+
+static
+VOID
+BenchmarkFrontEnd(VOID)
+{
+    SIZE_T Sizes[] = { 16, 64, 256, 1024 };
+    ULONG ThreadCounts[] = { 1, 2, 4, BENCH_MAX_THREADS };
+    ULONG Information = 2;
+    HANDLE BackEnd, FrontEnd;
+    ULONG i, j;
+
+    BackEnd = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    FrontEnd = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(BackEnd != NULL && FrontEnd != NULL, "RtlCreateHeap failed\n");
+    if (!BackEnd || !FrontEnd)
+        goto Cleanup;
+
+    ok_hex(RtlSetHeapInformation(FrontEnd, HeapCompatibilityInformation, &Information, sizeof(Information)), STATUS_SUCCESS);
+
+    for (i = 0; i < RTL_NUMBER_OF(Sizes); i++)
+    {
+        for (j = 0; j < RTL_NUMBER_OF(ThreadCounts); j++)
+        {
+            RunBenchmark(BackEnd, Sizes[i], ThreadCounts[j], "back end ");
+            RunBenchmark(FrontEnd, Sizes[i], ThreadCounts[j], "front end");
+        }
+    }
+
+Cleanup:
+    if (BackEnd) RtlDestroyHeap(BackEnd);
+    if (FrontEnd) RtlDestroyHeap(FrontEnd);
+}
+
+START_TEST(RtlHeapFrontEnd)
+{
+    TestFrontEnd();
+    StressFrontEnd();
+    BenchmarkFrontEnd();
+}
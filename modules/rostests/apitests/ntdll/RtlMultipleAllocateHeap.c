@@ -0,0 +1,162 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for RtlMultipleAllocateHeap and RtlMultipleFreeHeap
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define BATCH_COUNT 1000
+#define BENCH_ROUNDS 100
+
+static PVOID Blocks[BATCH_COUNT];
+
+static
+VOID
+TestBatch(
+    _In_ HANDLE Heap,
+    _In_ SIZE_T Size)
+{
+    ULONG Count, i;
+    BOOLEAN Zeroed = TRUE, Distinct = TRUE;
+    SIZE_T BlockSize;
+
+    RtlZeroMemory(Blocks, sizeof(Blocks));
+    Count = RtlMultipleAllocateHeap(Heap, HEAP_ZERO_MEMORY, Size, BATCH_COUNT, Blocks);
+    ok(Count == BATCH_COUNT, "Allocated %lu blocks of %lu bytes, expected %u\n", Count, (ULONG)Size, BATCH_COUNT);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (!Blocks[i])
+        {
+            ok(0, "Block %lu is NULL\n", i);
+            continue;
+        }
+
+        BlockSize = RtlSizeHeap(Heap, 0, Blocks[i]);
+        if (BlockSize != Size)
+        {
+            ok(0, "Block %lu: expected size %lu, got %lu\n", i, (ULONG)Size, (ULONG)BlockSize);
+        }
+
+        if (((PUCHAR)Blocks[i])[0] != 0 || ((PUCHAR)Blocks[i])[Size - 1] != 0)
+            Zeroed = FALSE;
+
+        /* Fill the whole block, overlapping blocks would trash each other */
+        memset(Blocks[i], (UCHAR)i, Size);
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Blocks[i] &&
+            (((PUCHAR)Blocks[i])[0] != (UCHAR)i || ((PUCHAR)Blocks[i])[Size - 1] != (UCHAR)i))
+        {
+            Distinct = FALSE;
+        }
+    }
+
+    ok(Zeroed, "Blocks of %lu bytes were not zeroed\n", (ULONG)Size);
+    ok(Distinct, "Blocks of %lu bytes overlap\n", (ULONG)Size);
+
+    /* Blocks can be freed separately as well */
+    if (Count > 1)
+    {
+        ok(RtlFreeHeap(Heap, 0, Blocks[Count - 1]) == TRUE, "RtlFreeHeap failed\n");
+        Count--;
+    }
+
+    ok_dec(RtlMultipleFreeHeap(Heap, 0, Count, Blocks), Count);
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted after freeing %lu byte blocks\n", (ULONG)Size);
+}
+
+static
+VOID
+TestInvalid(
+    _In_ HANDLE Heap)
+{
+    ULONG Count;
+
+    /* The batch stops at the first bad pointer and keeps what it freed so far */
+    Count = RtlMultipleAllocateHeap(Heap, 0, 32, 4, Blocks);
+    ok_dec(Count, 4);
+    if (Count != 4)
+        return;
+
+    Blocks[2] = (PUCHAR)Blocks[2] + 1;
+    ok_dec(RtlMultipleFreeHeap(Heap, 0, 4, Blocks), 2);
+    ok_hex(RtlGetLastNtStatus(), STATUS_INVALID_PARAMETER);
+    Blocks[2] = (PUCHAR)Blocks[2] - 1;
+    ok_dec(RtlMultipleFreeHeap(Heap, 0, 2, &Blocks[2]), 2);
+
+    Count = RtlMultipleAllocateHeap(Heap, 0, 32, 2, Blocks);
+    ok_dec(Count, 2);
+    if (Count != 2)
+        return;
+
+    Blocks[1] = (PVOID)(ULONG_PTR)0x10;
+    ok_dec(RtlMultipleFreeHeap(Heap, 0, 2, Blocks), 1);
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted after freeing invalid blocks\n");
+}
+
+static
+VOID
+Benchmark(
+    _In_ HANDLE Heap,
+    _In_ SIZE_T Size)
+{
+    LARGE_INTEGER Frequency, Start, Middle, End;
+    ULONG Round, i;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    QueryPerformanceCounter(&Start);
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        for (i = 0; i < BATCH_COUNT; i++)
+            Blocks[i] = RtlAllocateHeap(Heap, 0, Size);
+
+        for (i = 0; i < BATCH_COUNT; i++)
+            RtlFreeHeap(Heap, 0, Blocks[i]);
+    }
+    QueryPerformanceCounter(&Middle);
+
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        RtlMultipleAllocateHeap(Heap, 0, Size, BATCH_COUNT, Blocks);
+        RtlMultipleFreeHeap(Heap, 0, BATCH_COUNT, Blocks);
+    }
+    QueryPerformanceCounter(&End);
+
+    trace("%4lu bytes x %u: single calls %I64u us, batched calls %I64u us\n",
+          (ULONG)Size,
+          BATCH_COUNT,
+          (Middle.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart,
+          (End.QuadPart - Middle.QuadPart) * 1000000 / Frequency.QuadPart);
+}
+
+START_TEST(RtlMultipleAllocateHeap)
+{
+    SIZE_T Sizes[] = { 1, 24, 100, 1000, 4000 };
+    HANDLE Heap;
+    ULONG i;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap)
+        return;
+
+    /* Nothing to do is not an error */
+    ok_dec(RtlMultipleAllocateHeap(Heap, 0, 16, 0, Blocks), 0);
+    ok_dec(RtlMultipleFreeHeap(Heap, 0, 0, Blocks), 0);
+
+    for (i = 0; i < RTL_NUMBER_OF(Sizes); i++)
+        TestBatch(Heap, Sizes[i]);
+
+    TestInvalid(Heap);
+
+    for (i = 0; i < RTL_NUMBER_OF(Sizes); i++)
+        Benchmark(Heap, Sizes[i]);
+
+    RtlDestroyHeap(Heap);
+}
@@ -0,0 +1,147 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test for NtGdiGetStats
+ * PROGRAMMERS:
+ */
+
+#include <win32nt.h>
+
+static
+void
+Test_GdiBatchInfo(void)
+{
+    GDI_BATCH_INFO Info1, Info2;
+    NTSTATUS Status;
+    HDC hdc;
+    HBITMAP hbmp, hbmpOld;
+    HPEN hpen, hpenOld;
+    POINT pt;
+    INT i;
+
+    Status = NtGdiGetStats(NULL, GS_GDI_BATCH_INFO, 0, &Info1, sizeof(Info1) - 1);
+    ok_hex(Status, STATUS_INVALID_PARAMETER);
+
+    /* A compatible bitmap is no DIB section, so drawing on it is batched */
+    hdc = CreateCompatibleDC(NULL);
+    ok(hdc != NULL, "CreateCompatibleDC failed\n");
+    hbmp = CreateBitmap(100, 100, 1, 32, NULL);
+    ok(hbmp != NULL, "CreateBitmap failed\n");
+    hbmpOld = SelectObject(hdc, hbmp);
+    hpen = CreatePen(PS_SOLID, 1, RGB(0, 0, 255));
+    ok(hpen != NULL, "CreatePen failed\n");
+    PatBlt(hdc, 0, 0, 100, 100, WHITENESS);
+    GdiFlush();
+
+    ZeroMemory(&Info1, sizeof(Info1));
+    Status = NtGdiGetStats(NULL, GS_GDI_BATCH_INFO, 0, &Info1, sizeof(Info1));
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(Info1.ulFlushes > 0, "ulFlushes = %lu\n", Info1.ulFlushes);
+
+    /* Each line uses the pen that was selected when it was drawn */
+    MoveToEx(hdc, 0, 10, NULL);
+    ok_int(LineTo(hdc, 50, 10), TRUE);
+    hpenOld = SelectObject(hdc, hpen);
+    ok_int(LineTo(hdc, 99, 10), TRUE);
+    SelectObject(hdc, hpenOld);
+
+    /* The current position moves without a flush */
+    ok_int(GetCurrentPositionEx(hdc, &pt), TRUE);
+    ok_long(pt.x, 99);
+    ok_long(pt.y, 10);
+    MoveToEx(hdc, 0, 20, NULL);
+    ok_int(LineTo(hdc, 99, 20), TRUE);
+
+    for (i = 0; i < 10; i++)
+        ok_int(Rectangle(hdc, 10 * i, 30, 10 * i + 5, 35), TRUE);
+
+    /* Consecutive pixels go into one command */
+    for (i = 0; i < 100; i++)
+        ok_int(SetPixelV(hdc, i, 50, RGB(255, 0, 0)), TRUE);
+
+    GdiFlush();
+
+    ZeroMemory(&Info2, sizeof(Info2));
+    Status = NtGdiGetStats(NULL, GS_GDI_BATCH_INFO, 0, &Info2, sizeof(Info2));
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(Info2.ulCommands >= Info1.ulCommands + 14, "ulCommands = %lu, was %lu\n", Info2.ulCommands, Info1.ulCommands);
+    ok(Info2.ulFlushes - Info1.ulFlushes < Info2.ulCommands - Info1.ulCommands,
+       "%lu flushes for %lu commands\n", Info2.ulFlushes - Info1.ulFlushes, Info2.ulCommands - Info1.ulCommands);
+
+    /* Check the result */
+    ok_long(GetPixel(hdc, 20, 10), RGB(0, 0, 0));
+    ok_long(GetPixel(hdc, 70, 10), RGB(0, 0, 255));
+    ok_long(GetPixel(hdc, 50, 20), RGB(0, 0, 0));
+    ok_long(GetPixel(hdc, 50, 15), RGB(255, 255, 255));
+    ok_long(GetPixel(hdc, 10, 30), RGB(0, 0, 0));
+    ok_long(GetPixel(hdc, 12, 32), RGB(255, 255, 255));
+    ok_long(GetPixel(hdc, 17, 32), RGB(255, 255, 255));
+    ok_long(GetPixel(hdc, 0, 50), RGB(255, 0, 0));
+    ok_long(GetPixel(hdc, 99, 50), RGB(255, 0, 0));
+    ok_int(GetCurrentPositionEx(hdc, &pt), TRUE);
+    ok_long(pt.x, 99);
+    ok_long(pt.y, 20);
+
+    DeleteObject(hpen);
+    SelectObject(hdc, hbmpOld);
+    DeleteObject(hbmp);
+    DeleteDC(hdc);
+}
+
+START_TEST(NtGdiGetStats)
+{
+    GLYPH_CACHE_INFO Info1, Info2;
+    NTSTATUS Status;
+    HDC hdc;
+    HBITMAP hbmp, hbmpOld;
+    HFONT hfont, hfontOld;
+
+    /* Invalid parameters */
+    Status = NtGdiGetStats(NULL, GS_GLYPH_CACHE_INFO, 0, NULL, sizeof(Info1));
+    ok_hex(Status, STATUS_INVALID_PARAMETER);
+    Status = NtGdiGetStats(NULL, GS_GLYPH_CACHE_INFO, 0, &Info1, sizeof(Info1) - 1);
+    ok_hex(Status, STATUS_INVALID_PARAMETER);
+    Status = NtGdiGetStats(NULL, GS_GLYPH_CACHE_INFO, 0, (PVOID)(ULONG_PTR)0x10, sizeof(Info1));
+    ok_hex(Status, STATUS_ACCESS_VIOLATION);
+
+    hdc = CreateCompatibleDC(NULL);
+    ok(hdc != NULL, "CreateCompatibleDC failed\n");
+    hbmp = CreateCompatibleBitmap(hdc, 200, 50);
+    ok(hbmp != NULL, "CreateCompatibleBitmap failed\n");
+    hbmpOld = SelectObject(hdc, hbmp);
+    hfont = CreateFontW(-37, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET,
+                        OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY,
+                        DEFAULT_PITCH, L"Tahoma");
+    ok(hfont != NULL, "CreateFontW failed\n");
+    hfontOld = SelectObject(hdc, hfont);
+
+    /* The first call caches the glyphs */
+    ok_int(ExtTextOutW(hdc, 0, 0, 0, NULL, L"ReactOS", 7, NULL), TRUE);
+    GdiFlush();
+
+    ZeroMemory(&Info1, sizeof(Info1));
+    Status = NtGdiGetStats(NULL, GS_GLYPH_CACHE_INFO, 0, &Info1, sizeof(Info1));
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(Info1.ulEntries > 0, "ulEntries = %lu\n", Info1.ulEntries);
+    ok(Info1.cjSize > 0, "cjSize = %Iu\n", Info1.cjSize);
+    ok(Info1.cjMaxSize > 0, "cjMaxSize = %Iu\n", Info1.cjMaxSize);
+
+    /* The second call finds all of them in the cache */
+    ok_int(ExtTextOutW(hdc, 0, 0, 0, NULL, L"ReactOS", 7, NULL), TRUE);
+    GdiFlush();
+
+    ZeroMemory(&Info2, sizeof(Info2));
+    Status = NtGdiGetStats(NULL, GS_GLYPH_CACHE_INFO, 0, &Info2, sizeof(Info2));
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(Info2.ulHits >= Info1.ulHits + 7, "ulHits = %lu, was %lu\n", Info2.ulHits, Info1.ulHits);
+    ok(Info2.ulMisses >= Info1.ulMisses, "ulMisses = %lu, was %lu\n", Info2.ulMisses, Info1.ulMisses);
+    ok(Info2.cjMaxSize == Info1.cjMaxSize, "cjMaxSize = %Iu, was %Iu\n", Info2.cjMaxSize, Info1.cjMaxSize);
+
+    SelectObject(hdc, hfontOld);
+    DeleteObject(hfont);
+    SelectObject(hdc, hbmpOld);
+    DeleteObject(hbmp);
+    DeleteDC(hdc);
+
+    Test_GdiBatchInfo();
+}
@@ -0,0 +1,306 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for bulk TCP transfers over loopback
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include "ws2_32.h"
+
+#define CHUNK_SIZE  (64 * 1024)
+#define TOTAL_SIZE  (32 * 1024 * 1024)
+#define STALL_CHUNK (4 * 1024)
+
+typedef struct _SENDER_CONTEXT
+{
+    SOCKET Socket;
+    ULONG Sent;
+    int Error;
+} SENDER_CONTEXT, *PSENDER_CONTEXT;
+
+/* A pattern that shows reordered or lost chunks, not just lost bytes */
+static
+UCHAR
+PatternByte(
+    _In_ ULONG Offset)
+{
+    return (UCHAR)((Offset ^ (Offset >> 16)) * 7);
+}
+
+static
+DWORD
+WINAPI
+SenderThread(
+    _In_ PVOID Parameter)
+{
+    PSENDER_CONTEXT Context = Parameter;
+    PUCHAR Buffer;
+    ULONG i, Length;
+    int ret;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, CHUNK_SIZE);
+    if (!Buffer)
+    {
+        Context->Error = WSAENOBUFS;
+        shutdown(Context->Socket, SD_SEND);
+        return 0;
+    }
+
+    while (Context->Sent < TOTAL_SIZE)
+    {
+        Length = min(CHUNK_SIZE, TOTAL_SIZE - Context->Sent);
+        for (i = 0; i < Length; i++)
+            Buffer[i] = PatternByte(Context->Sent + i);
+
+        ret = send(Context->Socket, (PCHAR)Buffer, Length, 0);
+        if (ret == SOCKET_ERROR)
+        {
+            Context->Error = WSAGetLastError();
+            break;
+        }
+        Context->Sent += ret;
+    }
+
+    shutdown(Context->Socket, SD_SEND);
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    return 0;
+}
+
+static
+BOOLEAN
+CreateLoopbackPair(
+    _Out_ SOCKET *Client,
+    _Out_ SOCKET *Server)
+{
+    struct sockaddr_in addr;
+    int addrlen = sizeof(addr);
+    SOCKET Listener;
+    int ret;
+
+    *Client = INVALID_SOCKET;
+    *Server = INVALID_SOCKET;
+
+    Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (Listener == INVALID_SOCKET)
+        return FALSE;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ret = bind(Listener, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret == 0)
+        ret = getsockname(Listener, (struct sockaddr *)&addr, &addrlen);
+    if (ret == 0)
+        ret = listen(Listener, 1);
+    if (ret == 0)
+    {
+        *Client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (*Client != INVALID_SOCKET &&
+            connect(*Client, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            *Server = accept(Listener, NULL, NULL);
+        }
+    }
+
+    closesocket(Listener);
+
+    if (*Server == INVALID_SOCKET)
+    {
+        if (*Client != INVALID_SOCKET)
+            closesocket(*Client);
+        *Client = INVALID_SOCKET;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* How much the sender gets rid of while nobody reads on the other side.
+ * That is the send buffers plus AFD's receive buffer plus the TCP
+ * receive window, which is the part SO_RCVBUF changes */
+static
+ULONG
+MeasureStalledBytes(
+    _In_ int ReceiveBuffer)
+{
+    SOCKET Client, Server;
+    UCHAR Buffer[STALL_CHUNK];
+    ULONG Stalled = 0, Idle = 0;
+    u_long NonBlocking = 1;
+    int ret;
+
+    if (!CreateLoopbackPair(&Client, &Server))
+    {
+        skip("Could not connect over loopback: %d\n", WSAGetLastError());
+        return 0;
+    }
+
+    if (ReceiveBuffer)
+    {
+        ret = setsockopt(Server, SOL_SOCKET, SO_RCVBUF, (PCHAR)&ReceiveBuffer, sizeof(ReceiveBuffer));
+        ok(ret == 0, "setsockopt SO_RCVBUF returned %d, error %d\n", ret, WSAGetLastError());
+    }
+
+    ret = ioctlsocket(Client, FIONBIO, &NonBlocking);
+    ok(ret == 0, "ioctlsocket returned %d, error %d\n", ret, WSAGetLastError());
+
+    memset(Buffer, 0x55, sizeof(Buffer));
+
+    /* Give the data some time to move over before deciding it is stuck */
+    while (Idle < 5 && Stalled < TOTAL_SIZE)
+    {
+        ret = send(Client, (PCHAR)Buffer, sizeof(Buffer), 0);
+        if (ret > 0)
+        {
+            Stalled += ret;
+            Idle = 0;
+            continue;
+        }
+
+        if (WSAGetLastError() != WSAEWOULDBLOCK)
+        {
+            ok(0, "send returned %d, error %d\n", ret, WSAGetLastError());
+            break;
+        }
+
+        Idle++;
+        Sleep(50);
+    }
+
+    trace("SO_RCVBUF %d: %lu bytes sent before stalling\n", ReceiveBuffer, Stalled);
+
+    closesocket(Client);
+    closesocket(Server);
+
+    return Stalled;
+}
+
+static
+VOID
+TestReceiveWindow(VOID)
+{
+    ULONG Default, Small;
+
+    Default = MeasureStalledBytes(0);
+    Small = MeasureStalledBytes(8 * 1024);
+    if (!Default || !Small)
+        return;
+
+    /* The default window is 256 KB */
+    ok(Small + 128 * 1024 <= Default,
+       "SO_RCVBUF didn't shrink the window: %lu bytes against %lu\n", Small, Default);
+}
+
+static
+VOID
+TestTransfer(
+    _In_ int ReceiveBuffer)
+{
+    SENDER_CONTEXT Context;
+    SOCKET Client, Server;
+    HANDLE Thread;
+    PUCHAR Buffer;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Elapsed;
+    ULONG i, Received = 0, Errors = 0;
+    int ret, Value, Length;
+
+    if (!CreateLoopbackPair(&Client, &Server))
+    {
+        skip("Could not connect over loopback: %d\n", WSAGetLastError());
+        return;
+    }
+
+    if (ReceiveBuffer)
+    {
+        /* AFD passes this on to the connection of the accepted socket,
+         * so it sizes the TCP receive window as well */
+        ret = setsockopt(Server, SOL_SOCKET, SO_RCVBUF, (PCHAR)&ReceiveBuffer, sizeof(ReceiveBuffer));
+        ok(ret == 0, "setsockopt SO_RCVBUF returned %d, error %d\n", ret, WSAGetLastError());
+
+        Value = 0;
+        Length = sizeof(Value);
+        ret = getsockopt(Server, SOL_SOCKET, SO_RCVBUF, (PCHAR)&Value, &Length);
+        ok(ret == 0, "getsockopt SO_RCVBUF returned %d, error %d\n", ret, WSAGetLastError());
+        ok(Value == ReceiveBuffer, "SO_RCVBUF is %d, expected %d\n", Value, ReceiveBuffer);
+    }
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, CHUNK_SIZE);
+    if (!Buffer)
+    {
+        skip("No memory\n");
+        goto Cleanup;
+    }
+
+    Context.Socket = Client;
+    Context.Sent = 0;
+    Context.Error = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    Thread = CreateThread(NULL, 0, SenderThread, &Context, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (!Thread)
+    {
+        HeapFree(GetProcessHeap(), 0, Buffer);
+        goto Cleanup;
+    }
+
+    for (;;)
+    {
+        ret = recv(Server, (PCHAR)Buffer, CHUNK_SIZE, 0);
+        if (ret <= 0)
+            break;
+
+        for (i = 0; i < (ULONG)ret; i++)
+        {
+            if (Buffer[i] != PatternByte(Received + i))
+                Errors++;
+        }
+        Received += ret;
+    }
+
+    QueryPerformanceCounter(&End);
+
+    ok(ret == 0, "recv returned %d, error %d\n", ret, WSAGetLastError());
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+
+    ok(Context.Error == 0, "send failed with %d\n", Context.Error);
+    ok(Context.Sent == TOTAL_SIZE, "Sent %lu bytes\n", Context.Sent);
+    ok(Received == TOTAL_SIZE, "Received %lu bytes\n", Received);
+    ok(Errors == 0, "%lu corrupted bytes\n", Errors);
+
+    Elapsed = End.QuadPart - Start.QuadPart;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    trace("SO_RCVBUF %d: %I64u KB/sec\n", ReceiveBuffer,
+          (ULONGLONG)Received * Frequency.QuadPart / Elapsed / 1024);
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+
+Cleanup:
+    closesocket(Client);
+    closesocket(Server);
+}
+
+START_TEST(throughput)
+{
+    int ret;
+    WSADATA wsad;
+
+    ret = WSAStartup(MAKEWORD(2, 2), &wsad);
+    ok(ret == 0, "WSAStartup failed with %d\n", ret);
+
+    TestReceiveWindow();
+
+    /* The default window of 256 KB, then windows of 8 KB and 32 KB.
+       Compare these between builds */
+    TestTransfer(0);
+    TestTransfer(8 * 1024);
+    TestTransfer(32 * 1024);
+
+    WSACleanup();
+}
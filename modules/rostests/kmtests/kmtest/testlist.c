@@ -11,7 +11,10 @@ KMT_TESTFUNC Test_CcCopyWrite;
 KMT_TESTFUNC Test_CcMapData;
 KMT_TESTFUNC Test_CcPinMappedData;
 KMT_TESTFUNC Test_CcPinRead;
+KMT_TESTFUNC Test_CcPrefetch;
+KMT_TESTFUNC Test_CcReadAhead;
 KMT_TESTFUNC Test_CcSetFileSizes;
+KMT_TESTFUNC Test_CcVacbLookup;
 KMT_TESTFUNC Test_Example;
 KMT_TESTFUNC Test_FileAttributes;
 KMT_TESTFUNC Test_FindFile;
@@ -44,7 +47,10 @@ const KMT_TEST TestList[] =
     { "CcMapData",                    Test_CcMapData },
     { "CcPinMappedData",              Test_CcPinMappedData },
     { "CcPinRead",                    Test_CcPinRead },
+    { "CcPrefetch",                   Test_CcPrefetch },
+    { "CcReadAhead",                  Test_CcReadAhead },
     { "CcSetFileSizes",               Test_CcSetFileSizes },
+    { "CcVacbLookup",                 Test_CcVacbLookup },
     { "-Example",                     Test_Example },
     { "FileAttributes",               Test_FileAttributes },
     { "FindFile",                     Test_FindFile },
@@ -0,0 +1,307 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Kernel-Mode Test Suite logical prefetcher test
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+#include <ndk/psfuncs.h>
+
+/* From ntoskrnl/include/internal/cc.h */
+#define PF_ENABLE_APP_LAUNCH    0x1
+#define PF_ENABLE_BOOT          0x2
+
+#define PF_SCENARIO_VERSION     1
+#define PF_SCENARIO_MAGIC       'ACCS'
+#define PF_MAX_SCENARIO_SIZE    (1024 * 1024)
+
+typedef struct _PF_SCENARIO_ID
+{
+    WCHAR ScenName[30];
+    ULONG HashId;
+} PF_SCENARIO_ID, *PPF_SCENARIO_ID;
+
+typedef struct _PF_SCENARIO_HEADER
+{
+    ULONG Version;
+    ULONG MagicNumber;
+    ULONG Size;
+    PF_SCENARIO_ID ScenarioId;
+    ULONG ScenarioType;
+    ULONG FileInfoOffset;
+    ULONG NumFiles;
+    ULONG PageRunOffset;
+    ULONG NumPageRuns;
+    ULONG FileNameInfoOffset;
+    ULONG FileNameInfoSize;
+} PF_SCENARIO_HEADER, *PPF_SCENARIO_HEADER;
+
+typedef struct _PF_SCENARIO_FILE
+{
+    ULONG FileNameOffset;
+    ULONG FileNameLength;
+    ULONG FirstPageRun;
+    ULONG NumPageRuns;
+} PF_SCENARIO_FILE, *PPF_SCENARIO_FILE;
+
+#define BOOT_SCENARIO_NAME L"NTOSBOOT"
+#define BOOT_SCENARIO_HASH 0xB00DFAAD
+
+/* An application launch trace ends after a few quiet seconds */
+#define SCENARIO_WAIT_MS 30000
+
+static
+ULONG
+GetPrefetcherFlags(VOID)
+{
+    HKEY Key;
+    DWORD Value = 0, Size = sizeof(Value);
+
+    if (RegOpenKeyExW(HKEY_LOCAL_MACHINE,
+                      L"SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Memory Management\\PrefetchParameters",
+                      0,
+                      KEY_QUERY_VALUE,
+                      &Key) != ERROR_SUCCESS)
+    {
+        return 0;
+    }
+
+    if (RegQueryValueExW(Key, L"EnablePrefetcher", NULL, NULL, (PBYTE)&Value, &Size) != ERROR_SUCCESS)
+        Value = 0;
+
+    RegCloseKey(Key);
+    return Value;
+}
+
+static
+PPF_SCENARIO_HEADER
+ReadScenario(
+    _In_ PCWSTR Path,
+    _In_ PCWSTR ScenName,
+    _In_ ULONG HashId)
+{
+    HANDLE File;
+    PPF_SCENARIO_HEADER Header;
+    DWORD Size, Read;
+    BOOL Ret;
+
+    File = CreateFileW(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    ok(File != INVALID_HANDLE_VALUE, "Could not open %ls, error %lu\n", Path, GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    Size = GetFileSize(File, NULL);
+    ok(Size >= sizeof(*Header) && Size <= PF_MAX_SCENARIO_SIZE, "%ls has %lu bytes\n", Path, Size);
+    if (Size < sizeof(*Header) || Size > PF_MAX_SCENARIO_SIZE)
+    {
+        CloseHandle(File);
+        return NULL;
+    }
+
+    Header = HeapAlloc(GetProcessHeap(), 0, Size);
+    if (!Header)
+    {
+        skip("Out of memory\n");
+        CloseHandle(File);
+        return NULL;
+    }
+
+    Ret = ReadFile(File, Header, Size, &Read, NULL);
+    CloseHandle(File);
+    ok(Ret && Read == Size, "ReadFile failed, error %lu\n", GetLastError());
+    if (!Ret || Read != Size)
+        goto Fail;
+
+    ok_eq_ulong(Header->Version, PF_SCENARIO_VERSION);
+    ok_eq_ulong(Header->MagicNumber, PF_SCENARIO_MAGIC);
+    ok_eq_ulong(Header->Size, Size);
+    ok(!wcsncmp(Header->ScenarioId.ScenName, ScenName, RTL_NUMBER_OF(Header->ScenarioId.ScenName)),
+       "Scenario is %.30ls\n", Header->ScenarioId.ScenName);
+    ok_eq_hex(Header->ScenarioId.HashId, HashId);
+    ok(Header->NumFiles > 0, "Scenario has no files\n");
+    ok(Header->NumPageRuns >= Header->NumFiles, "%lu page runs for %lu files\n",
+       Header->NumPageRuns, Header->NumFiles);
+
+    /* The kernel validates the rest before using it, only check what we look at */
+    if (Header->Size != Size ||
+        Header->FileInfoOffset > Size ||
+        Header->NumFiles > (Size - Header->FileInfoOffset) / sizeof(PF_SCENARIO_FILE) ||
+        Header->FileNameInfoOffset > Size ||
+        Header->FileNameInfoSize > Size - Header->FileNameInfoOffset)
+    {
+        ok(0, "%ls is inconsistent\n", Path);
+        goto Fail;
+    }
+
+    return Header;
+
+Fail:
+    HeapFree(GetProcessHeap(), 0, Header);
+    return NULL;
+}
+
+/* Whether a file of the scenario has a name ending in Name */
+static
+BOOLEAN
+ScenarioHasFile(
+    _In_ PPF_SCENARIO_HEADER Header,
+    _In_ PCWSTR Name)
+{
+    PPF_SCENARIO_FILE FileInfo = (PPF_SCENARIO_FILE)((PUCHAR)Header + Header->FileInfoOffset);
+    PUCHAR FileNames = (PUCHAR)Header + Header->FileNameInfoOffset;
+    SIZE_T NameLength = wcslen(Name) * sizeof(WCHAR);
+    ULONG i;
+
+    for (i = 0; i < Header->NumFiles; i++)
+    {
+        if (FileInfo[i].FileNameOffset > Header->FileNameInfoSize ||
+            FileInfo[i].FileNameLength > Header->FileNameInfoSize - FileInfo[i].FileNameOffset ||
+            FileInfo[i].FileNameLength < NameLength)
+        {
+            continue;
+        }
+
+        if (!_wcsnicmp((PCWSTR)(FileNames + FileInfo[i].FileNameOffset + FileInfo[i].FileNameLength - NameLength),
+                       Name,
+                       NameLength / sizeof(WCHAR)))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static
+VOID
+TestAppLaunch(VOID)
+{
+    WCHAR CommandLine[MAX_PATH + 16];
+    WCHAR Path[MAX_PATH + 64];
+    STARTUPINFOW StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    struct
+    {
+        UNICODE_STRING Name;
+        WCHAR Buffer[MAX_PATH];
+    } ImageName;
+    PPF_SCENARIO_HEADER Header;
+    NTSTATUS Status;
+    ULONG HashId, i;
+    UINT Length;
+
+    Length = GetSystemDirectoryW(CommandLine, MAX_PATH);
+    ok(Length != 0 && Length < MAX_PATH, "GetSystemDirectoryW failed, error %lu\n", GetLastError());
+    if (Length == 0 || Length >= MAX_PATH)
+        return;
+    StringCchCatW(CommandLine, RTL_NUMBER_OF(CommandLine), L"\\cmd.exe /c exit");
+
+    ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+
+    /* Suspended, so that the old scenario is gone before the trace starts */
+    if (!CreateProcessW(NULL, CommandLine, NULL, NULL, FALSE, CREATE_SUSPENDED,
+                        NULL, NULL, &StartupInfo, &ProcessInfo))
+    {
+        skip("CreateProcessW failed, error %lu\n", GetLastError());
+        return;
+    }
+
+    /* The scenario is named after the image and the hash of its NT path */
+    Status = NtQueryInformationProcess(ProcessInfo.hProcess,
+                                       ProcessImageFileName,
+                                       &ImageName,
+                                       sizeof(ImageName),
+                                       NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        Status = RtlHashUnicodeString(&ImageName.Name, TRUE, HASH_STRING_ALGORITHM_X65599, &HashId);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    Length = GetWindowsDirectoryW(Path, MAX_PATH);
+    if (NT_SUCCESS(Status))
+    {
+        StringCchPrintfW(Path + Length, RTL_NUMBER_OF(Path) - Length,
+                         L"\\Prefetch\\CMD.EXE-%08lX.pf", HashId);
+        DeleteFileW(Path);
+    }
+
+    ResumeThread(ProcessInfo.hThread);
+    WaitForSingleObject(ProcessInfo.hProcess, SCENARIO_WAIT_MS);
+    CloseHandle(ProcessInfo.hThread);
+    CloseHandle(ProcessInfo.hProcess);
+
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* It is saved by a worker once the launch settles down */
+    for (i = 0; i < SCENARIO_WAIT_MS / 500; i++)
+    {
+        if (GetFileAttributesW(Path) != INVALID_FILE_ATTRIBUTES)
+            break;
+        Sleep(500);
+    }
+
+    ok(GetFileAttributesW(Path) != INVALID_FILE_ATTRIBUTES, "%ls was not saved\n", Path);
+    Header = ReadScenario(Path, L"CMD.EXE", HashId);
+    if (!Header)
+        return;
+
+    ok(Header->ScenarioType == 0, "Scenario type is %lu\n", Header->ScenarioType);
+    ok(ScenarioHasFile(Header, L"\\cmd.exe"), "cmd.exe is not part of its launch\n");
+    ok(ScenarioHasFile(Header, L"\\ntdll.dll"), "ntdll.dll is not part of the launch\n");
+
+    HeapFree(GetProcessHeap(), 0, Header);
+}
+
+static
+VOID
+TestBootTrace(VOID)
+{
+    WCHAR Path[MAX_PATH + 64];
+    PPF_SCENARIO_HEADER Header;
+    UINT Length;
+
+    Length = GetWindowsDirectoryW(Path, MAX_PATH);
+    StringCchPrintfW(Path + Length, RTL_NUMBER_OF(Path) - Length,
+                     L"\\Prefetch\\%ls-%08lX.pf", BOOT_SCENARIO_NAME, BOOT_SCENARIO_HASH);
+
+    /* It is only written a while after boot */
+    if (GetFileAttributesW(Path) == INVALID_FILE_ATTRIBUTES)
+    {
+        skip("No boot scenario saved yet\n");
+        return;
+    }
+
+    Header = ReadScenario(Path, BOOT_SCENARIO_NAME, BOOT_SCENARIO_HASH);
+    if (!Header)
+        return;
+
+    ok(Header->ScenarioType == 1, "Scenario type is %lu\n", Header->ScenarioType);
+
+    /* The processes started during boot have traces of their own, but
+     * what they read belongs to the boot as well */
+    ok(ScenarioHasFile(Header, L"\\smss.exe"), "smss.exe is not part of the boot\n");
+    ok(ScenarioHasFile(Header, L"\\csrss.exe"), "csrss.exe is not part of the boot\n");
+    ok(ScenarioHasFile(Header, L"\\winlogon.exe"), "winlogon.exe is not part of the boot\n");
+
+    HeapFree(GetProcessHeap(), 0, Header);
+}
+
+START_TEST(CcPrefetch)
+{
+    ULONG Flags = GetPrefetcherFlags();
+
+    if (Flags & PF_ENABLE_APP_LAUNCH)
+        TestAppLaunch();
+    else
+        skip("Application launch prefetching is disabled\n");
+
+    if (Flags & PF_ENABLE_BOOT)
+        TestBootTrace();
+    else
+        skip("Boot prefetching is disabled\n");
+}
@@ -0,0 +1,162 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Kernel-Mode Test Suite cache read ahead test
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+#include <ndk/exfuncs.h>
+
+#define FILE_SIZE   (8 * 1024 * 1024)
+#define CHUNK_SIZE  (64 * 1024)
+#define STRIDE      (256 * 1024)
+#define STRIDE_READ 4096
+
+static
+ULONG
+GetReadAheadIos(VOID)
+{
+    SYSTEM_PERFORMANCE_INFORMATION Spi;
+    NTSTATUS Status;
+
+    Status = NtQuerySystemInformation(SystemPerformanceInformation, &Spi, sizeof(Spi), NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    return NT_SUCCESS(Status) ? Spi.CcReadAheadIos : 0;
+}
+
+/* Every ULONG holds its own file offset, so misplaced data shows */
+static
+VOID
+FillChunk(
+    _Out_ PULONG Buffer,
+    _In_ ULONG Offset,
+    _In_ ULONG Length)
+{
+    ULONG i;
+
+    for (i = 0; i < Length / sizeof(ULONG); i++)
+        Buffer[i] = Offset + i * sizeof(ULONG);
+}
+
+static
+ULONG
+CheckChunk(
+    _In_ const ULONG *Buffer,
+    _In_ ULONG Offset,
+    _In_ ULONG Length)
+{
+    ULONG i, Errors = 0;
+
+    for (i = 0; i < Length / sizeof(ULONG); i++)
+    {
+        if (Buffer[i] != Offset + i * sizeof(ULONG))
+            Errors++;
+    }
+
+    return Errors;
+}
+
+static
+BOOLEAN
+CreateTestFile(
+    _In_ PCWSTR Path,
+    _In_ PULONG Buffer)
+{
+    HANDLE File;
+    ULONG Offset;
+    DWORD Written;
+    BOOL Ret = TRUE;
+
+    /* Bypass the cache, so that reading it back has to go to the disk */
+    File = CreateFileW(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    for (Offset = 0; Offset < FILE_SIZE && Ret; Offset += CHUNK_SIZE)
+    {
+        FillChunk(Buffer, Offset, CHUNK_SIZE);
+        Ret = WriteFile(File, Buffer, CHUNK_SIZE, &Written, NULL) && Written == CHUNK_SIZE;
+    }
+
+    CloseHandle(File);
+    return Ret != FALSE;
+}
+
+static
+VOID
+TestReads(
+    _In_ PCWSTR Path,
+    _In_ PULONG Buffer,
+    _In_ BOOLEAN Strided)
+{
+    HANDLE File;
+    ULONG Before, After, Offset, Length, Errors = 0;
+    DWORD Read;
+    BOOL Ret;
+
+    if (!CreateTestFile(Path, Buffer))
+    {
+        skip("Could not create %ls, error %lu\n", Path, GetLastError());
+        return;
+    }
+
+    File = CreateFileW(Path, GENERIC_READ, 0, NULL, OPEN_EXISTING,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFileW failed, error %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        DeleteFileW(Path);
+        return;
+    }
+
+    Before = GetReadAheadIos();
+
+    Length = Strided ? STRIDE_READ : CHUNK_SIZE;
+    for (Offset = 0; Offset + Length <= FILE_SIZE; Offset += Strided ? STRIDE : CHUNK_SIZE)
+    {
+        SetFilePointer(File, Offset, NULL, FILE_BEGIN);
+        Ret = ReadFile(File, Buffer, Length, &Read, NULL);
+        ok(Ret && Read == Length, "ReadFile at %lu failed, error %lu\n", Offset, GetLastError());
+        if (!Ret || Read != Length)
+            break;
+
+        Errors += CheckChunk(Buffer, Offset, Length);
+    }
+
+    After = GetReadAheadIos();
+
+    ok(Errors == 0, "%lu wrong ULONGs\n", Errors);
+    ok(After > Before, "%s reads caused no read ahead (%lu IOs)\n",
+       Strided ? "Strided" : "Sequential", After - Before);
+    trace("%s reads: %lu read ahead IOs\n", Strided ? "Strided" : "Sequential", After - Before);
+
+    CloseHandle(File);
+}
+
+START_TEST(CcReadAhead)
+{
+    WCHAR Path[MAX_PATH];
+    DWORD Length;
+    PULONG Buffer;
+
+    Length = GetTempPathW(RTL_NUMBER_OF(Path), Path);
+    ok(Length != 0 && Length < RTL_NUMBER_OF(Path) - 16, "GetTempPathW failed, error %lu\n", GetLastError());
+    if (Length == 0 || Length >= RTL_NUMBER_OF(Path) - 16)
+        return;
+    StringCchCatW(Path, RTL_NUMBER_OF(Path), L"ccreadahead.tmp");
+
+    /* Unbuffered I/O wants sector aligned buffers */
+    Buffer = VirtualAlloc(NULL, CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    if (!Buffer)
+    {
+        skip("VirtualAlloc failed\n");
+        return;
+    }
+
+    TestReads(Path, Buffer, FALSE);
+    TestReads(Path, Buffer, TRUE);
+
+    VirtualFree(Buffer, 0, MEM_RELEASE);
+}
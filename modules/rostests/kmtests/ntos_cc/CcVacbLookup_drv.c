@@ -0,0 +1,422 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         LGPLv2.1+ - See COPYING.LIB in the top level directory
+ * PURPOSE:         Test driver for VACB lookups on big files
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define IOCTL_START_TEST  1
+#define IOCTL_FINISH_TEST 2
+
+/* A sparse 4GB file, only the first bytes of each page are set */
+#define TEST_FILE_SIZE      0x100000000LL
+#define TEST_VIEW_SIZE      0x40000LL
+#define TEST_HIT_VIEWS      16
+#define TEST_HIT_ROUNDS     1000
+
+typedef struct _TEST_FCB
+{
+    FSRTL_ADVANCED_FCB_HEADER Header;
+    SECTION_OBJECT_POINTERS SectionObjectPointers;
+    FAST_MUTEX HeaderMutex;
+} TEST_FCB, *PTEST_FCB;
+
+static ULONG TestTestId = -1;
+static PFILE_OBJECT TestFileObject;
+static PDEVICE_OBJECT TestDeviceObject;
+static KMT_IRP_HANDLER TestIrpHandler;
+static KMT_MESSAGE_HANDLER TestMessageHandler;
+
+NTSTATUS
+TestEntry(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PCUNICODE_STRING RegistryPath,
+    _Out_ PCWSTR *DeviceName,
+    _Inout_ INT *Flags)
+{
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(RegistryPath);
+
+    *DeviceName = L"CcVacbLookup";
+    *Flags = TESTENTRY_NO_EXCLUSIVE_DEVICE |
+             TESTENTRY_BUFFERED_IO_DEVICE |
+             TESTENTRY_NO_READONLY_DEVICE;
+
+    KmtRegisterIrpHandler(IRP_MJ_READ, NULL, TestIrpHandler);
+    KmtRegisterMessageHandler(0, NULL, TestMessageHandler);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+TestUnload(
+    _In_ PDRIVER_OBJECT DriverObject)
+{
+    PAGED_CODE();
+}
+
+BOOLEAN
+NTAPI
+AcquireForLazyWrite(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Wait)
+{
+    return TRUE;
+}
+
+VOID
+NTAPI
+ReleaseFromLazyWrite(
+    _In_ PVOID Context)
+{
+    return;
+}
+
+BOOLEAN
+NTAPI
+AcquireForReadAhead(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Wait)
+{
+    return TRUE;
+}
+
+VOID
+NTAPI
+ReleaseFromReadAhead(
+    _In_ PVOID Context)
+{
+    return;
+}
+
+static CACHE_MANAGER_CALLBACKS Callbacks = {
+    AcquireForLazyWrite,
+    ReleaseFromLazyWrite,
+    AcquireForReadAhead,
+    ReleaseFromReadAhead,
+};
+
+static CC_FILE_SIZES FileSizes = {
+    RTL_CONSTANT_LARGE_INTEGER(TEST_FILE_SIZE), // .AllocationSize
+    RTL_CONSTANT_LARGE_INTEGER(TEST_FILE_SIZE), // .FileSize
+    RTL_CONSTANT_LARGE_INTEGER(TEST_FILE_SIZE)  // .ValidDataLength
+};
+
+static
+PVOID
+MapAndLockUserBuffer(
+    _In_ _Out_ PIRP Irp,
+    _In_ ULONG BufferLength)
+{
+    PMDL Mdl;
+
+    if (Irp->MdlAddress == NULL)
+    {
+        Mdl = IoAllocateMdl(Irp->UserBuffer, BufferLength, FALSE, FALSE, Irp);
+        if (Mdl == NULL)
+        {
+            return NULL;
+        }
+
+        _SEH2_TRY
+        {
+            MmProbeAndLockPages(Mdl, Irp->RequestorMode, IoWriteAccess);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            IoFreeMdl(Mdl);
+            Irp->MdlAddress = NULL;
+            _SEH2_YIELD(return NULL);
+        }
+        _SEH2_END;
+    }
+
+    return MmGetSystemAddressForMdlSafe(Irp->MdlAddress, NormalPagePriority);
+}
+
+static
+BOOLEAN
+MapAndCheck(
+    _In_ LONGLONG FileOffset)
+{
+    LARGE_INTEGER Offset;
+    PULONGLONG Buffer;
+    BOOLEAN Ret;
+    PVOID Bcb;
+
+    Ret = FALSE;
+    Offset.QuadPart = FileOffset;
+    KmtStartSeh();
+    Ret = CcMapData(TestFileObject, &Offset, sizeof(ULONGLONG), MAP_WAIT, &Bcb, (PVOID *)&Buffer);
+    KmtEndSeh(STATUS_SUCCESS);
+
+    if (!Ret)
+    {
+        return FALSE;
+    }
+
+    /* Each page starts with its offset in the file */
+    Ret = (*Buffer == (ULONGLONG)FileOffset);
+    CcUnpinData(Bcb);
+
+    return Ret;
+}
+
+static
+ULONGLONG
+ElapsedMicroseconds(
+    _In_ PLARGE_INTEGER Start,
+    _In_ PLARGE_INTEGER End,
+    _In_ PLARGE_INTEGER Frequency)
+{
+    return (End->QuadPart - Start->QuadPart) * 1000000 / Frequency->QuadPart;
+}
+
+static
+VOID
+TestLookups(VOID)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Slowest, Fastest, Elapsed, GbStart;
+    LONGLONG Offset, Tail;
+    ULONG Failures, Round, i;
+
+    /* Views spread over the file, created out of order */
+    ok_bool_true(MapAndCheck(TEST_FILE_SIZE - PAGE_SIZE), "Last page");
+    ok_bool_true(MapAndCheck(TEST_FILE_SIZE / 2), "Middle page");
+    ok_bool_true(MapAndCheck(TEST_VIEW_SIZE), "Second view");
+    ok_bool_true(MapAndCheck(0), "First page");
+    ok_bool_true(MapAndCheck(TEST_FILE_SIZE / 2 + PAGE_SIZE), "Same view");
+
+    /* Stream through the whole file, one page per view. The cost per GB
+     * must not grow with the number of views mapped before it.
+     */
+    Failures = 0;
+    Slowest = 0;
+    Fastest = MAXULONGLONG;
+    KeQueryPerformanceCounter(&Frequency);
+    Start = KeQueryPerformanceCounter(NULL);
+    for (Offset = 0; Offset < TEST_FILE_SIZE; Offset += TEST_VIEW_SIZE)
+    {
+        if (!MapAndCheck(Offset + PAGE_SIZE))
+        {
+            Failures++;
+        }
+
+        if ((Offset + TEST_VIEW_SIZE) % 0x40000000LL == 0)
+        {
+            End = KeQueryPerformanceCounter(NULL);
+            Elapsed = ElapsedMicroseconds(&Start, &End, &Frequency);
+            GbStart = Offset / 0x40000000LL;
+            trace("GB %I64u: %I64u us, %I64u ns per view\n",
+                  GbStart, Elapsed, Elapsed * 1000 / (0x40000000LL / TEST_VIEW_SIZE));
+            Slowest = max(Slowest, Elapsed);
+            Fastest = min(Fastest, Elapsed);
+            Start = End;
+        }
+    }
+    ok_eq_ulong(Failures, 0UL);
+
+    /* A lookup that walks the views would make the last GB many times slower
+     * than the first one. Leave room for the noise of the paging I/O.
+     */
+    ok(Slowest <= Fastest * 4,
+       "Slowest GB took %I64u us, fastest %I64u us\n", Slowest, Fastest);
+
+    /* Now only hit views that are still cached, that's the lookup alone */
+    Tail = TEST_FILE_SIZE - TEST_HIT_VIEWS * TEST_VIEW_SIZE;
+    Failures = 0;
+    Start = KeQueryPerformanceCounter(NULL);
+    for (Round = 0; Round < TEST_HIT_ROUNDS; Round++)
+    {
+        for (i = 0; i < TEST_HIT_VIEWS; i++)
+        {
+            if (!MapAndCheck(Tail + i * TEST_VIEW_SIZE + PAGE_SIZE))
+            {
+                Failures++;
+            }
+        }
+    }
+    End = KeQueryPerformanceCounter(NULL);
+    ok_eq_ulong(Failures, 0UL);
+
+    Elapsed = ElapsedMicroseconds(&Start, &End, &Frequency);
+    trace("Cached lookups at the end of the file: %I64u ns per lookup, slowest GB %I64u us\n",
+          Elapsed * 1000 / (TEST_HIT_ROUNDS * TEST_HIT_VIEWS), Slowest);
+}
+
+static
+VOID
+PerformTest(
+    ULONG TestId,
+    PDEVICE_OBJECT DeviceObject)
+{
+    PTEST_FCB Fcb;
+
+    ok_eq_pointer(TestFileObject, NULL);
+    ok_eq_pointer(TestDeviceObject, NULL);
+    ok_eq_ulong(TestTestId, -1);
+
+    TestDeviceObject = DeviceObject;
+    TestTestId = TestId;
+    TestFileObject = IoCreateStreamFileObject(NULL, DeviceObject);
+    if (!skip(TestFileObject != NULL, "Failed to allocate FO\n"))
+    {
+        Fcb = ExAllocatePool(NonPagedPool, sizeof(TEST_FCB));
+        if (!skip(Fcb != NULL, "ExAllocatePool failed\n"))
+        {
+            RtlZeroMemory(Fcb, sizeof(TEST_FCB));
+            ExInitializeFastMutex(&Fcb->HeaderMutex);
+            FsRtlSetupAdvancedHeader(&Fcb->Header, &Fcb->HeaderMutex);
+
+            TestFileObject->FsContext = Fcb;
+            TestFileObject->SectionObjectPointer = &Fcb->SectionObjectPointers;
+
+            KmtStartSeh();
+            CcInitializeCacheMap(TestFileObject, &FileSizes, FALSE, &Callbacks, NULL);
+            KmtEndSeh(STATUS_SUCCESS);
+
+            if (!skip(CcIsFileCached(TestFileObject) == TRUE, "CcInitializeCacheMap failed\n"))
+            {
+                TestLookups();
+            }
+        }
+    }
+}
+
+static
+VOID
+CleanupTest(
+    ULONG TestId,
+    PDEVICE_OBJECT DeviceObject)
+{
+    LARGE_INTEGER Zero = RTL_CONSTANT_LARGE_INTEGER(0LL);
+    CACHE_UNINITIALIZE_EVENT CacheUninitEvent;
+
+    ok_eq_pointer(TestDeviceObject, DeviceObject);
+    ok_eq_ulong(TestTestId, TestId);
+
+    if (!skip(TestFileObject != NULL, "No test FO\n"))
+    {
+        if (CcIsFileCached(TestFileObject))
+        {
+            KeInitializeEvent(&CacheUninitEvent.Event, NotificationEvent, FALSE);
+            CcUninitializeCacheMap(TestFileObject, &Zero, &CacheUninitEvent);
+            KeWaitForSingleObject(&CacheUninitEvent.Event, Executive, KernelMode, FALSE, NULL);
+        }
+
+        if (TestFileObject->FsContext != NULL)
+        {
+            ExFreePool(TestFileObject->FsContext);
+            TestFileObject->FsContext = NULL;
+            TestFileObject->SectionObjectPointer = NULL;
+        }
+
+        ObDereferenceObject(TestFileObject);
+    }
+
+    TestFileObject = NULL;
+    TestDeviceObject = NULL;
+    TestTestId = -1;
+}
+
+static
+NTSTATUS
+TestMessageHandler(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ ULONG ControlCode,
+    _In_opt_ PVOID Buffer,
+    _In_ SIZE_T InLength,
+    _Inout_ PSIZE_T OutLength)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    FsRtlEnterFileSystem();
+
+    switch (ControlCode)
+    {
+        case IOCTL_START_TEST:
+            ok_eq_ulong((ULONG)InLength, sizeof(ULONG));
+            PerformTest(*(PULONG)Buffer, DeviceObject);
+            break;
+
+        case IOCTL_FINISH_TEST:
+            ok_eq_ulong((ULONG)InLength, sizeof(ULONG));
+            CleanupTest(*(PULONG)Buffer, DeviceObject);
+            break;
+
+        default:
+            Status = STATUS_NOT_IMPLEMENTED;
+            break;
+    }
+
+    FsRtlExitFileSystem();
+
+    return Status;
+}
+
+static
+NTSTATUS
+TestIrpHandler(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PIO_STACK_LOCATION IoStack)
+{
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    DPRINT("IRP %x/%x\n", IoStack->MajorFunction, IoStack->MinorFunction);
+    ASSERT(IoStack->MajorFunction == IRP_MJ_READ);
+
+    FsRtlEnterFileSystem();
+
+    Status = STATUS_NOT_SUPPORTED;
+    Irp->IoStatus.Information = 0;
+
+    if (IoStack->MajorFunction == IRP_MJ_READ)
+    {
+        ULONG Length, i;
+        PUCHAR Buffer;
+        LARGE_INTEGER Offset;
+
+        Offset = IoStack->Parameters.Read.ByteOffset;
+        Length = IoStack->Parameters.Read.Length;
+
+        ok_eq_pointer(DeviceObject, TestDeviceObject);
+        ok_eq_pointer(IoStack->FileObject, TestFileObject);
+        ok(FlagOn(Irp->Flags, IRP_NOCACHE), "Not coming from Cc\n");
+        ok(Length % PAGE_SIZE == 0, "Length is not aligned: %lu\n", Length);
+
+        Buffer = MapAndLockUserBuffer(Irp, Length);
+        ok(Buffer != NULL, "Null pointer!\n");
+        if (Buffer != NULL)
+        {
+            RtlZeroMemory(Buffer, Length);
+            for (i = 0; i < Length; i += PAGE_SIZE)
+            {
+                *(PULONGLONG)(Buffer + i) = Offset.QuadPart + i;
+            }
+
+            Irp->IoStatus.Information = Length;
+            Status = STATUS_SUCCESS;
+        }
+        else
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    Irp->IoStatus.Status = Status;
+    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+
+    FsRtlExitFileSystem();
+
+    return Status;
+}
@@ -0,0 +1,27 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Kernel-Mode Test Suite VACB lookup test user-mode part
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define IOCTL_START_TEST  1
+#define IOCTL_FINISH_TEST 2
+
+START_TEST(CcVacbLookup)
+{
+    DWORD Ret;
+
+    KmtLoadDriver(L"CcVacbLookup", FALSE);
+    KmtOpenDriver();
+
+    Ret = KmtSendUlongToDriver(IOCTL_START_TEST, 0);
+    ok(Ret == ERROR_SUCCESS, "KmtSendUlongToDriver failed: %lx\n", Ret);
+    Ret = KmtSendUlongToDriver(IOCTL_FINISH_TEST, 0);
+    ok(Ret == ERROR_SUCCESS, "KmtSendUlongToDriver failed: %lx\n", Ret);
+
+    KmtCloseDriver();
+    KmtUnloadDriver();
+}
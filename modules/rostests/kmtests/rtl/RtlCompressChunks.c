@@ -0,0 +1,186 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Kernel-Mode Test Suite for chunked compression routines
+ * PROGRAMMER:      ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define TAG_TEST 'CCmK'
+#define CHUNK_SHIFT 12
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_COUNT 5
+#define DATA_SIZE (CHUNK_COUNT * CHUNK_SIZE)
+
+static
+VOID
+FillChunks(
+    _Out_ PUCHAR Data)
+{
+    ULONG Seed = 0x5EED, i;
+
+    /* Zeros, text, noise, zeros, pattern */
+    RtlZeroMemory(Data, DATA_SIZE);
+    for (i = 0; i < CHUNK_SIZE; i++)
+        Data[CHUNK_SIZE + i] = "ReactOS compressed chunk "[i % 25];
+    for (i = 0; i < CHUNK_SIZE; i++)
+        Data[2 * CHUNK_SIZE + i] = (UCHAR)(RtlRandomEx(&Seed) >> 3);
+    for (i = 0; i < CHUNK_SIZE; i++)
+        Data[4 * CHUNK_SIZE + i] = (UCHAR)(i & 0x1F);
+}
+
+static
+VOID
+TestChunks(
+    _In_ USHORT Format,
+    _In_ PUCHAR Data,
+    _In_ PUCHAR Compressed,
+    _In_ PUCHAR Decompressed,
+    _In_ PCOMPRESSED_DATA_INFO Info,
+    _In_ ULONG InfoLength)
+{
+    ULONG WorkSpaceSize, FragmentSize, Total, Head, i;
+    PVOID WorkSpace;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(Format, &WorkSpaceSize, &FragmentSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    WorkSpace = ExAllocatePoolWithTag(PagedPool, WorkSpaceSize, TAG_TEST);
+    if (skip(WorkSpace != NULL, "Out of memory\n"))
+        return;
+
+    RtlZeroMemory(Info, InfoLength);
+    Info->CompressionFormatAndEngine = Format;
+    Info->ChunkShift = CHUNK_SHIFT;
+
+    /* The chunk size table has to fit */
+    Status = RtlCompressChunks(Data, DATA_SIZE, Compressed, DATA_SIZE, Info,
+                               FIELD_OFFSET(COMPRESSED_DATA_INFO, CompressedChunkSizes), WorkSpace);
+    ok_eq_hex(Status, STATUS_BUFFER_TOO_SMALL);
+
+    /* More chunks than NumberOfChunks can count. Fails before touching the buffers */
+    Info->ChunkShift = 9;
+    Status = RtlCompressChunks(Data, (MAXUSHORT + 1UL) << 9, Compressed, DATA_SIZE, Info, MAXULONG, WorkSpace);
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER);
+    Info->ChunkShift = CHUNK_SHIFT;
+
+    Status = RtlCompressChunks(Data, DATA_SIZE, Compressed, DATA_SIZE, Info, InfoLength, WorkSpace);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_uint(Info->NumberOfChunks, CHUNK_COUNT);
+
+    /* Zero chunks take no space, noise is stored as it is */
+    ok_eq_ulong(Info->CompressedChunkSizes[0], 0UL);
+    ok(Info->CompressedChunkSizes[1] < CHUNK_SIZE / 8, "Text chunk is %lu bytes\n", Info->CompressedChunkSizes[1]);
+    ok_eq_ulong(Info->CompressedChunkSizes[2], (ULONG)CHUNK_SIZE);
+    ok_eq_ulong(Info->CompressedChunkSizes[3], 0UL);
+    ok(Info->CompressedChunkSizes[4] < CHUNK_SIZE / 8, "Pattern chunk is %lu bytes\n", Info->CompressedChunkSizes[4]);
+
+    for (Total = 0, i = 0; i < Info->NumberOfChunks; i++)
+        Total += Info->CompressedChunkSizes[i];
+
+    RtlFillMemory(Decompressed, DATA_SIZE, 0x55);
+    Status = RtlDecompressChunks(Decompressed, DATA_SIZE, Compressed, Total, NULL, 0, Info);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(RtlCompareMemory(Data, Decompressed, DATA_SIZE) == DATA_SIZE, "Data mismatch\n");
+
+    /* Chunks past the first buffer come from the tail, e.g. a second mapping */
+    Head = Info->CompressedChunkSizes[0] + Info->CompressedChunkSizes[1] + Info->CompressedChunkSizes[2];
+    RtlFillMemory(Decompressed, DATA_SIZE, 0x55);
+    Status = RtlDecompressChunks(Decompressed, DATA_SIZE, Compressed, Head,
+                                 Compressed + Head, Total - Head, Info);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(RtlCompareMemory(Data, Decompressed, DATA_SIZE) == DATA_SIZE, "Data mismatch\n");
+
+    /* Chunks are independent, the last one alone can be decompressed */
+    Info->CompressedChunkSizes[0] = Info->CompressedChunkSizes[4];
+    Info->NumberOfChunks = 1;
+    Status = RtlDecompressChunks(Decompressed, CHUNK_SIZE, Compressed + Total - Info->CompressedChunkSizes[4],
+                                 Info->CompressedChunkSizes[4], NULL, 0, Info);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(RtlCompareMemory(Data + 4 * CHUNK_SIZE, Decompressed, CHUNK_SIZE) == CHUNK_SIZE, "Data mismatch\n");
+
+    ExFreePoolWithTag(WorkSpace, TAG_TEST);
+}
+
+static
+VOID
+TestDescribeReserve(
+    _In_ PUCHAR Data,
+    _In_ PUCHAR Compressed,
+    _In_ PUCHAR Decompressed)
+{
+    PUCHAR Current, End = Compressed + DATA_SIZE, Chunk;
+    ULONG ChunkSize, FinalSize;
+    NTSTATUS Status;
+
+    Status = RtlReserveChunk(COMPRESSION_FORMAT_XPRESS, &Compressed, End, &Chunk, 0);
+    ok_eq_hex(Status, STATUS_UNSUPPORTED_COMPRESSION);
+
+    /* An all zeros chunk followed by an uncompressed one */
+    Current = Compressed;
+    Status = RtlReserveChunk(COMPRESSION_FORMAT_LZNT1, &Current, End, &Chunk, 0);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_pointer(Chunk, Compressed);
+
+    Status = RtlReserveChunk(COMPRESSION_FORMAT_LZNT1, &Current, End, &Chunk, CHUNK_SIZE);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_pointer(Current, Chunk + CHUNK_SIZE);
+    RtlCopyMemory(Chunk, Data + CHUNK_SIZE, CHUNK_SIZE);
+    *(PUSHORT)Current = 0;
+
+    Status = RtlReserveChunk(COMPRESSION_FORMAT_LZNT1, &Current, Current + 1, &Chunk, CHUNK_SIZE);
+    ok_eq_hex(Status, STATUS_BUFFER_TOO_SMALL);
+
+    /* Walk them again */
+    End = Current + sizeof(USHORT);
+    Current = Compressed;
+    Status = RtlDescribeChunk(COMPRESSION_FORMAT_LZNT1, &Current, End, &Chunk, &ChunkSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_pointer(Chunk, Compressed);
+
+    Status = RtlDescribeChunk(COMPRESSION_FORMAT_LZNT1, &Current, End, &Chunk, &ChunkSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_ulong(ChunkSize, (ULONG)(CHUNK_SIZE + sizeof(USHORT)));
+
+    Status = RtlDescribeChunk(COMPRESSION_FORMAT_LZNT1, &Current, End, &Chunk, &ChunkSize);
+    ok_eq_hex(Status, STATUS_NO_MORE_ENTRIES);
+    ok_eq_ulong(ChunkSize, 0UL);
+
+    Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1, Decompressed, 2 * CHUNK_SIZE,
+                                 Compressed, (ULONG)(End - Compressed), &FinalSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_ulong(FinalSize, 2UL * CHUNK_SIZE);
+    ok(RtlCompareMemory(Data, Decompressed, 2 * CHUNK_SIZE) == 2 * CHUNK_SIZE, "Data mismatch\n");
+}
+
+START_TEST(RtlCompressChunks)
+{
+    ULONG InfoLength = FIELD_OFFSET(COMPRESSED_DATA_INFO, CompressedChunkSizes[CHUNK_COUNT]);
+    PUCHAR Data, Compressed, Decompressed;
+    PCOMPRESSED_DATA_INFO Info;
+
+    Data = ExAllocatePoolWithTag(PagedPool, DATA_SIZE, TAG_TEST);
+    Compressed = ExAllocatePoolWithTag(PagedPool, DATA_SIZE, TAG_TEST);
+    Decompressed = ExAllocatePoolWithTag(PagedPool, DATA_SIZE, TAG_TEST);
+    Info = ExAllocatePoolWithTag(PagedPool, InfoLength, TAG_TEST);
+    if (skip(Data && Compressed && Decompressed && Info, "Out of memory\n"))
+        goto Cleanup;
+
+    FillChunks(Data);
+
+    TestChunks(COMPRESSION_FORMAT_LZNT1, Data, Compressed, Decompressed, Info, InfoLength);
+    TestChunks(COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_MAXIMUM, Data, Compressed, Decompressed, Info, InfoLength);
+    TestChunks(COMPRESSION_FORMAT_XPRESS, Data, Compressed, Decompressed, Info, InfoLength);
+    TestChunks(COMPRESSION_FORMAT_XPRESS_HUFF, Data, Compressed, Decompressed, Info, InfoLength);
+    TestDescribeReserve(Data, Compressed, Decompressed);
+
+Cleanup:
+    if (Info) ExFreePoolWithTag(Info, TAG_TEST);
+    if (Decompressed) ExFreePoolWithTag(Decompressed, TAG_TEST);
+    if (Compressed) ExFreePoolWithTag(Compressed, TAG_TEST);
+    if (Data) ExFreePoolWithTag(Data, TAG_TEST);
+}
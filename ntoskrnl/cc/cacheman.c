@@ -36,8 +36,10 @@ CcPfInitializePrefetcher(VOID)
     InitializeListHead(&CcPfGlobals.ActiveTraces);
     InitializeListHead(&CcPfGlobals.CompletedTraces);
     ExInitializeFastMutex(&CcPfGlobals.CompletedTracesLock);
+    KeInitializeSpinLock(&CcPfGlobals.ActiveTracesLock);
 
-    /* FIXME: Setup the rest of the prefetecher */
+    /* Enable it if the registry asks for app launch or boot prefetching */
+    CcPfEnablePrefetcher = (CcPfEnablePrefetcherFlags != 0);
 }
 
 INIT_FUNCTION
@@ -151,7 +153,7 @@ CcRemapBcb (
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
@@ -162,7 +164,9 @@ CcScheduleReadAhead (
 	)
 {
     KIRQL OldIrql;
-    LARGE_INTEGER NewOffset;
+    LONGLONG Start, End, Stride, AheadEnd;
+    ULONG Granularity, Window;
+    BOOLEAN Sequential;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
 
@@ -176,47 +180,100 @@ CcScheduleReadAhead (
         return;
     }
 
-    /* Round read length with read ahead mask */
-    Length = ROUND_UP(Length, PrivateCacheMap->ReadAheadMask + 1);
-    /* Compute the offset we'll reach */
-    NewOffset.QuadPart = FileOffset->QuadPart + Length;
+    /* The private cache map holds the state of the read stream:
+     * - FileOffset1/2 and BeyondLastByte1/2 are the two previous reads (see CcCopyData)
+     * - ReadAheadOffset[0] is where the data already read ahead ends
+     * - ReadAheadLength[0] is the current read ahead window, 0 if there's no stream
+     * - ReadAheadOffset[1] and ReadAheadLength[1] are the range CcPerformReadAhead has to read
+     */
+    Granularity = PrivateCacheMap->ReadAheadMask + 1;
+    End = FileOffset->QuadPart + Length;
 
     /* Lock read ahead spin lock */
     KeAcquireSpinLock(&PrivateCacheMap->ReadAheadSpinLock, &OldIrql);
-    /* Easy case: the file is sequentially read */
-    if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY))
+
+    /* The file is read sequentially if this read starts where the previous one ended */
+    Sequential = BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY) ||
+                 (FileOffset->QuadPart >= PrivateCacheMap->FileOffset2.QuadPart &&
+                  FileOffset->QuadPart <= ROUND_UP(PrivateCacheMap->BeyondLastByte2.QuadPart, Granularity));
+    if (Sequential)
     {
-        /* If we went backward, this is no go! */
-        if (NewOffset.QuadPart < PrivateCacheMap->ReadAheadOffset[1].QuadPart)
+        AheadEnd = PrivateCacheMap->ReadAheadOffset[0].QuadPart;
+        Window = PrivateCacheMap->ReadAheadLength[0];
+
+        if (Window == 0)
         {
-            KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
-            return;
+            /* New stream, start with the smallest window */
+            Window = max(Granularity, ROUND_UP(Length, Granularity));
+            Start = ROUND_UP(End, Granularity);
+        }
+        else if (FileOffset->QuadPart < AheadEnd)
+        {
+            /* The reader is in the data we read ahead */
+            InterlockedExchangeAdd((PLONG)&CcReadAheadHitPages,
+                                   (LONG)BYTES_TO_PAGES(min(End, AheadEnd) - FileOffset->QuadPart));
+
+            /* Nothing to do while we're at least half a window ahead */
+            if (AheadEnd - End >= Window / 2)
+            {
+                KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+                return;
+            }
+
+            /* It's catching up, read more at once */
+            Window *= 2;
+            Start = AheadEnd;
+        }
+        else
+        {
+            /* The reader overtook the read ahead, read more at once */
+            Window *= 2;
+            Start = ROUND_UP(End, Granularity);
         }
 
-        /* FIXME: hackish, but will do the job for now */
-        PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-        PrivateCacheMap->ReadAheadLength[1] = Length;
+        Window = min(max(Window, ROUND_UP(Length, Granularity)), CC_MAX_READ_AHEAD_WINDOW);
+        PrivateCacheMap->ReadAheadOffset[0].QuadPart = Start + Window;
+        PrivateCacheMap->ReadAheadLength[0] = Window;
     }
-    /* Other cases: try to find some logic in that mess... */
     else
     {
-        /* Let's check if we always read the same way (like going down in the file)
-         * and pretend it's enough for now
-         */
-        if (PrivateCacheMap->FileOffset2.QuadPart >= PrivateCacheMap->FileOffset1.QuadPart &&
-            FileOffset->QuadPart >= PrivateCacheMap->FileOffset2.QuadPart)
+        /* The stream is over, what it didn't reach was read for nothing */
+        if (PrivateCacheMap->ReadAheadLength[0] != 0 &&
+            PrivateCacheMap->ReadAheadOffset[0].QuadPart > PrivateCacheMap->BeyondLastByte2.QuadPart)
         {
-            /* FIXME: hackish, but will do the job for now */
-            PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-            PrivateCacheMap->ReadAheadLength[1] = Length;
+            InterlockedExchangeAdd((PLONG)&CcReadAheadWastedPages,
+                                   (LONG)BYTES_TO_PAGES(PrivateCacheMap->ReadAheadOffset[0].QuadPart -
+                                                        PrivateCacheMap->BeyondLastByte2.QuadPart));
         }
-        else
+        PrivateCacheMap->ReadAheadOffset[0].QuadPart = 0;
+        PrivateCacheMap->ReadAheadLength[0] = 0;
+
+        /* Strided reads: same length and same distance as the previous read */
+        Stride = FileOffset->QuadPart - PrivateCacheMap->FileOffset2.QuadPart;
+        if (Stride <= 0 ||
+            Stride != PrivateCacheMap->FileOffset2.QuadPart - PrivateCacheMap->FileOffset1.QuadPart ||
+            Length != PrivateCacheMap->BeyondLastByte2.QuadPart - PrivateCacheMap->FileOffset2.QuadPart)
         {
-            /* FIXME: handle the other cases */
             KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
-            UNIMPLEMENTED_ONCE;
             return;
         }
+
+        /* Bring in the next one */
+        Start = ROUND_DOWN(FileOffset->QuadPart + Stride, Granularity);
+        Window = (ULONG)(ROUND_UP(End + Stride, Granularity) - Start);
+    }
+
+    /* Queue the range, merging it with the pending one if they're contiguous */
+    if (PrivateCacheMap->ReadAheadLength[1] != 0 &&
+        PrivateCacheMap->ReadAheadOffset[1].QuadPart + PrivateCacheMap->ReadAheadLength[1] == Start &&
+        PrivateCacheMap->ReadAheadLength[1] + Window <= 2 * CC_MAX_READ_AHEAD_WINDOW)
+    {
+        PrivateCacheMap->ReadAheadLength[1] += Window;
+    }
+    else
+    {
+        PrivateCacheMap->ReadAheadOffset[1].QuadPart = Start;
+        PrivateCacheMap->ReadAheadLength[1] = Window;
     }
 
     /* If read ahead isn't active yet */
@@ -252,7 +309,9 @@ CcScheduleReadAhead (
         InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
     }
 
-    /* Done (fail) */
+    /* Done: the running read ahead will pick the range, or we failed
+     * to start it and the next read will try again
+     */
     KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
 }
 
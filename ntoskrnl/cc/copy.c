@@ -50,6 +50,17 @@ ULONG CcFastReadResourceMiss;
 ULONG CcDataPages = 0;
 ULONG CcDataFlushes = 0;
 
+/* Read ahead counters:
+ * - Number of reads issued by read ahead
+ * - Amount of pages they brought in
+ * - Amount of pages then read from the read ahead ranges
+ * - Amount of pages read ahead for streams that stopped before them
+ */
+ULONG CcReadAheadIos = 0;
+ULONG CcReadAheadPages = 0;
+ULONG CcReadAheadHitPages = 0;
+ULONG CcReadAheadWastedPages = 0;
+
 /* FUNCTIONS *****************************************************************/
 
 VOID
@@ -387,11 +398,10 @@ CcCopyData (
     /* If that was a successful sync read operation, let's handle read ahead */
     if (Operation == CcOperationRead && Length == 0 && Wait)
     {
-        /* If file isn't random access and next read may get us cross VACB boundary,
-         * schedule next read
+        /* If file isn't random access, let read ahead keep up with the reader.
+         * It only queues work when the reader gets close to the end of its window.
          */
-        if (!BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS) &&
-            (CurrentOffset - 1) / VACB_MAPPING_GRANULARITY != (CurrentOffset + BytesCopied - 1) / VACB_MAPPING_GRANULARITY)
+        if (!BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS))
         {
             CcScheduleReadAhead(FileObject, (PLARGE_INTEGER)&FileOffset, BytesCopied);
         }
@@ -498,6 +508,7 @@ CcPerformReadAhead(
     PPRIVATE_CACHE_MAP PrivateCacheMap;
     BOOLEAN Locked;
 
+    Status = STATUS_SUCCESS;
     SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
 
     /* Critical:
@@ -521,12 +532,15 @@ CcPerformReadAhead(
         KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
         CurrentOffset = PrivateCacheMap->ReadAheadOffset[1].QuadPart;
         Length = PrivateCacheMap->ReadAheadLength[1];
+        PrivateCacheMap->ReadAheadLength[1] = 0;
         KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
     }
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
     /* Time to go! */
     DPRINT("Doing ReadAhead for %p\n", FileObject);
+
+NextRange:
     /* Lock the file, first */
     if (!SharedCacheMap->Callbacks->AcquireForReadAhead(SharedCacheMap->LazyWriteContext, FALSE))
     {
@@ -576,6 +590,9 @@ CcPerformReadAhead(
                 DPRINT1("Failed to read data: %lx!\n", Status);
                 goto Clear;
             }
+
+            InterlockedIncrement((PLONG)&CcReadAheadIos);
+            InterlockedExchangeAdd((PLONG)&CcReadAheadPages, BYTES_TO_PAGES(PartialLength));
         }
 
         CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
@@ -608,6 +625,9 @@ CcPerformReadAhead(
                 DPRINT1("Failed to read data: %lx!\n", Status);
                 goto Clear;
             }
+
+            InterlockedIncrement((PLONG)&CcReadAheadIos);
+            InterlockedExchangeAdd((PLONG)&CcReadAheadPages, BYTES_TO_PAGES(PartialLength));
         }
 
         CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
@@ -617,24 +637,36 @@ CcPerformReadAhead(
     }
 
 Clear:
+    /* Don't keep writers out for longer than a range */
+    if (Locked)
+    {
+        SharedCacheMap->Callbacks->ReleaseFromReadAhead(SharedCacheMap->LazyWriteContext);
+    }
+
     /* See previous comment about private cache map */
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     PrivateCacheMap = FileObject->PrivateCacheMap;
     if (PrivateCacheMap != NULL)
     {
-        /* Mark read ahead as unactive */
         KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
+
+        /* The reader went on meanwhile, read the next range it asked for */
+        if (Locked && NT_SUCCESS(Status) && PrivateCacheMap->ReadAheadLength[1] != 0)
+        {
+            CurrentOffset = PrivateCacheMap->ReadAheadOffset[1].QuadPart;
+            Length = PrivateCacheMap->ReadAheadLength[1];
+            PrivateCacheMap->ReadAheadLength[1] = 0;
+            KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
+            KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+            goto NextRange;
+        }
+
+        /* Mark read ahead as unactive */
         InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
         KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
     }
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
-    /* If file was locked, release it */
-    if (Locked)
-    {
-        SharedCacheMap->Callbacks->ReleaseFromReadAhead(SharedCacheMap->LazyWriteContext);
-    }
-
     /* And drop our extra reference (See: CcScheduleReadAhead) */
     ObDereferenceObject(FileObject);
 
@@ -0,0 +1,1081 @@
+/*
+ * COPYRIGHT:       See COPYING in the top level directory
+ * PROJECT:         ReactOS kernel
+ * FILE:            ntoskrnl/cc/prefetch.c
+ * PURPOSE:         Logical prefetcher for application launch and boot
+ *
+ * PROGRAMMERS:     ReactOS Team
+ */
+
+/*
+ * The prefetcher traces the file pages a scenario (an application launch,
+ * or the boot) accesses through the cache during its first seconds: data
+ * and image section page-ins as well as cached reads all get their view
+ * through CcRosGetVacb. When the trace ends, the pages are sorted, merged
+ * into runs and saved in \SystemRoot\Prefetch. The next time the scenario
+ * starts, the runs are read back with a few large cached reads, file after
+ * file in the order they were first needed, before the scenario faults on
+ * them one page at a time.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntoskrnl.h>
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS ******************************************************************/
+
+/* Off unless PrefetchParameters\EnablePrefetcher turns it on */
+ULONG CcPfEnablePrefetcherFlags = 0;
+
+#define PFSN_TRACE_MAGIC            'nsfP'
+#define PFSN_MAX_FILES              256
+#define PFSN_APP_LAUNCH_ENTRIES     8192
+#define PFSN_BOOT_ENTRIES           32768
+#define PFSN_NUM_PERIODS            RTL_NUMBER_OF(((PPFSN_TRACE_HEADER)NULL)->FaultsPerPeriod)
+
+/* An application launch is over after a period with fewer accesses than this */
+#define PFSN_MIN_FAULTS_PER_PERIOD  16
+/* Don't save traces which barely touched anything */
+#define PFSN_MIN_TRACE_ENTRIES      32
+
+#define PFSN_PAGES_PER_VIEW         (VACB_MAPPING_GRANULARITY / PAGE_SIZE)
+
+#define PFSN_BOOT_SCENARIO_NAME     L"NTOSBOOT"
+#define PFSN_BOOT_SCENARIO_HASH     0xB00DFAAD
+
+static BOOLEAN CcPfBootTraceStarted = FALSE;
+
+/* FUNCTIONS ****************************************************************/
+
+static
+NTSTATUS
+CcPfOpenScenario(
+    IN PPF_SCENARIO_ID ScenarioId,
+    IN BOOLEAN Write,
+    OUT PHANDLE FileHandle)
+{
+    static UNICODE_STRING PrefetchDirectory = RTL_CONSTANT_STRING(L"\\SystemRoot\\Prefetch");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus;
+    UNICODE_STRING FileName;
+    WCHAR Buffer[80];
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    Status = RtlStringCbPrintfW(Buffer, sizeof(Buffer),
+                                L"\\SystemRoot\\Prefetch\\%.*ls-%08lX.pf",
+                                (int)RTL_NUMBER_OF(ScenarioId->ScenName),
+                                ScenarioId->ScenName,
+                                ScenarioId->HashId);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    RtlInitUnicodeString(&FileName, Buffer);
+
+    if (Write)
+    {
+        /* Create the directory the first time a scenario gets saved */
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &PrefetchDirectory,
+                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                                   NULL,
+                                   NULL);
+        Status = ZwCreateFile(&Handle,
+                              FILE_LIST_DIRECTORY | SYNCHRONIZE,
+                              &ObjectAttributes,
+                              &IoStatus,
+                              NULL,
+                              FILE_ATTRIBUTE_DIRECTORY,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              FILE_OPEN_IF,
+                              FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                              NULL,
+                              0);
+        if (!NT_SUCCESS(Status))
+        {
+            return Status;
+        }
+
+        ZwClose(Handle);
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    return ZwCreateFile(FileHandle,
+                        (Write ? FILE_WRITE_DATA : FILE_READ_DATA) | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatus,
+                        NULL,
+                        FILE_ATTRIBUTE_NORMAL,
+                        Write ? 0 : FILE_SHARE_READ,
+                        Write ? FILE_OVERWRITE_IF : FILE_OPEN,
+                        FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                        NULL,
+                        0);
+}
+
+static
+BOOLEAN
+CcPfIsRangeValid(
+    IN ULONG Offset,
+    IN ULONG Count,
+    IN ULONG ElementSize,
+    IN ULONG Size)
+{
+    return (Offset <= Size) && ((ULONGLONG)Count * ElementSize <= Size - Offset);
+}
+
+static
+BOOLEAN
+CcPfVerifyScenario(
+    IN PPF_SCENARIO_HEADER Header,
+    IN ULONG Size,
+    IN PPF_SCENARIO_ID ScenarioId,
+    IN ULONG ScenarioType)
+{
+    PPF_SCENARIO_FILE FileInfo;
+    PPF_PAGE_RUN PageRuns;
+    ULONG i;
+
+    if (Header->Version != PF_SCENARIO_VERSION ||
+        Header->MagicNumber != PF_SCENARIO_MAGIC ||
+        Header->Size != Size ||
+        Header->ScenarioType != ScenarioType ||
+        Header->NumFiles > PFSN_MAX_FILES ||
+        RtlCompareMemory(&Header->ScenarioId, ScenarioId, sizeof(*ScenarioId)) != sizeof(*ScenarioId))
+    {
+        return FALSE;
+    }
+
+    /* Everything must be within the file and properly aligned */
+    if ((Header->FileInfoOffset & (sizeof(ULONG) - 1)) ||
+        (Header->PageRunOffset & (sizeof(ULONG) - 1)) ||
+        (Header->FileNameInfoOffset & (sizeof(WCHAR) - 1)) ||
+        !CcPfIsRangeValid(Header->FileInfoOffset, Header->NumFiles, sizeof(PF_SCENARIO_FILE), Size) ||
+        !CcPfIsRangeValid(Header->PageRunOffset, Header->NumPageRuns, sizeof(PF_PAGE_RUN), Size) ||
+        !CcPfIsRangeValid(Header->FileNameInfoOffset, Header->FileNameInfoSize, sizeof(UCHAR), Size))
+    {
+        return FALSE;
+    }
+
+    FileInfo = (PPF_SCENARIO_FILE)((PUCHAR)Header + Header->FileInfoOffset);
+    for (i = 0; i < Header->NumFiles; i++)
+    {
+        if (FileInfo[i].FirstPageRun > Header->NumPageRuns ||
+            FileInfo[i].NumPageRuns > Header->NumPageRuns - FileInfo[i].FirstPageRun ||
+            FileInfo[i].FileNameLength == 0 ||
+            FileInfo[i].FileNameLength > MAXUSHORT ||
+            ((FileInfo[i].FileNameOffset | FileInfo[i].FileNameLength) & (sizeof(WCHAR) - 1)) ||
+            FileInfo[i].FileNameOffset > Header->FileNameInfoSize ||
+            FileInfo[i].FileNameLength > Header->FileNameInfoSize - FileInfo[i].FileNameOffset)
+        {
+            return FALSE;
+        }
+    }
+
+    PageRuns = (PPF_PAGE_RUN)((PUCHAR)Header + Header->PageRunOffset);
+    for (i = 0; i < Header->NumPageRuns; i++)
+    {
+        if (PageRuns[i].NumPages == 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static
+NTSTATUS
+CcPfReadScenario(
+    IN PPF_SCENARIO_ID ScenarioId,
+    IN ULONG ScenarioType,
+    OUT PPF_SCENARIO_HEADER *Scenario)
+{
+    FILE_STANDARD_INFORMATION StandardInfo;
+    PPF_SCENARIO_HEADER Header;
+    LARGE_INTEGER ByteOffset;
+    IO_STATUS_BLOCK IoStatus;
+    HANDLE Handle;
+    NTSTATUS Status;
+    ULONG Size;
+
+    Status = CcPfOpenScenario(ScenarioId, FALSE, &Handle);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    Status = ZwQueryInformationFile(Handle,
+                                    &IoStatus,
+                                    &StandardInfo,
+                                    sizeof(StandardInfo),
+                                    FileStandardInformation);
+    if (!NT_SUCCESS(Status))
+    {
+        ZwClose(Handle);
+        return Status;
+    }
+
+    if (StandardInfo.EndOfFile.QuadPart < sizeof(PF_SCENARIO_HEADER) ||
+        StandardInfo.EndOfFile.QuadPart > PF_MAX_SCENARIO_SIZE)
+    {
+        ZwClose(Handle);
+        return STATUS_FILE_CORRUPT_ERROR;
+    }
+
+    Size = StandardInfo.EndOfFile.LowPart;
+    Header = ExAllocatePoolWithTag(PagedPool, Size, TAG_PREFETCH);
+    if (Header == NULL)
+    {
+        ZwClose(Handle);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    ByteOffset.QuadPart = 0;
+    Status = ZwReadFile(Handle, NULL, NULL, NULL, &IoStatus, Header, Size, &ByteOffset, NULL);
+    ZwClose(Handle);
+
+    if (NT_SUCCESS(Status) &&
+        (IoStatus.Information != Size || !CcPfVerifyScenario(Header, Size, ScenarioId, ScenarioType)))
+    {
+        DPRINT1("CCPF: Ignoring invalid scenario file for %.*S\n",
+                (int)RTL_NUMBER_OF(ScenarioId->ScenName), ScenarioId->ScenName);
+        Status = STATUS_FILE_CORRUPT_ERROR;
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        ExFreePoolWithTag(Header, TAG_PREFETCH);
+        return Status;
+    }
+
+    *Scenario = Header;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+CcPfPrefetchRuns(
+    IN PFILE_OBJECT FileObject,
+    IN PPF_PAGE_RUN PageRuns,
+    IN ULONG NumPageRuns)
+{
+    ULONGLONG View, LastView;
+    PREAD_LIST ReadList;
+    ULONG NumEntries = 0, i;
+
+    /* One entry per view is enough, Mm reads adjacent views together */
+    for (i = 0; i < NumPageRuns; i++)
+    {
+        View = PageRuns[i].FirstPage / PFSN_PAGES_PER_VIEW;
+        LastView = ((ULONGLONG)PageRuns[i].FirstPage + PageRuns[i].NumPages - 1) / PFSN_PAGES_PER_VIEW;
+        NumEntries += (ULONG)(LastView - View + 1);
+    }
+
+    ReadList = ExAllocatePoolWithTag(PagedPool,
+                                     FIELD_OFFSET(READ_LIST, List) + NumEntries * sizeof(FILE_SEGMENT_ELEMENT),
+                                     TAG_PREFETCH);
+    if (ReadList == NULL)
+    {
+        return;
+    }
+
+    ReadList->FileObject = FileObject;
+    ReadList->NumberOfEntries = 0;
+    ReadList->IsImage = FALSE;
+
+    for (i = 0; i < NumPageRuns; i++)
+    {
+        LastView = ((ULONGLONG)PageRuns[i].FirstPage + PageRuns[i].NumPages - 1) / PFSN_PAGES_PER_VIEW;
+        for (View = PageRuns[i].FirstPage / PFSN_PAGES_PER_VIEW; View <= LastView; View++)
+        {
+            ReadList->List[ReadList->NumberOfEntries++].Alignment = View * VACB_MAPPING_GRANULARITY;
+        }
+    }
+
+    MmPrefetchPages(1, &ReadList);
+
+    ExFreePoolWithTag(ReadList, TAG_PREFETCH);
+}
+
+static
+VOID
+CcPfPrefetchScenario(
+    IN PPFSN_TRACE_HEADER Trace,
+    IN PPF_SCENARIO_HEADER Header)
+{
+    PPF_SCENARIO_FILE FileInfo;
+    PPF_PAGE_RUN PageRuns;
+    PUCHAR FileNames;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus;
+    UNICODE_STRING FileName;
+    PFILE_OBJECT FileObject;
+    LARGE_INTEGER ByteOffset;
+    HANDLE Handle;
+    NTSTATUS Status;
+    PVOID Buffer;
+    ULONG i, j;
+
+    Buffer = ExAllocatePoolWithTag(PagedPool, PAGE_SIZE, TAG_PREFETCH);
+    if (Buffer == NULL)
+    {
+        return;
+    }
+
+    FileInfo = (PPF_SCENARIO_FILE)((PUCHAR)Header + Header->FileInfoOffset);
+    PageRuns = (PPF_PAGE_RUN)((PUCHAR)Header + Header->PageRunOffset);
+    FileNames = (PUCHAR)Header + Header->FileNameInfoOffset;
+
+    InterlockedIncrement(&CcPfGlobals.ActivePrefetches);
+
+    for (i = 0; i < Header->NumFiles; i++)
+    {
+        for (j = 0; j < FileInfo[i].NumPageRuns; j++)
+        {
+            Trace->ScenarioPages += PageRuns[FileInfo[i].FirstPageRun + j].NumPages;
+        }
+
+        FileName.Buffer = (PWCHAR)(FileNames + FileInfo[i].FileNameOffset);
+        FileName.Length = (USHORT)FileInfo[i].FileNameLength;
+        FileName.MaximumLength = FileName.Length;
+
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &FileName,
+                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                                   NULL,
+                                   NULL);
+        Status = ZwCreateFile(&Handle,
+                              FILE_READ_DATA | SYNCHRONIZE,
+                              &ObjectAttributes,
+                              &IoStatus,
+                              NULL,
+                              FILE_ATTRIBUTE_NORMAL,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              FILE_OPEN,
+                              FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                              NULL,
+                              0);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT("CCPF: Failed to open %wZ (0x%lx)\n", &FileName, Status);
+            continue;
+        }
+
+        /* A first cached read makes the file system set up the cache map */
+        if (FileInfo[i].NumPageRuns != 0)
+        {
+            ByteOffset.QuadPart = (LONGLONG)PageRuns[FileInfo[i].FirstPageRun].FirstPage * PAGE_SIZE;
+            ZwReadFile(Handle, NULL, NULL, NULL, &IoStatus, Buffer, PAGE_SIZE, &ByteOffset, NULL);
+        }
+
+        /* Keep the cache map, and the views we read, until the trace ends */
+        Status = ObReferenceObjectByHandle(Handle,
+                                           0,
+                                           IoFileObjectType,
+                                           KernelMode,
+                                           (PVOID*)&FileObject,
+                                           NULL);
+        if (NT_SUCCESS(Status))
+        {
+            if (FileObject->PrivateCacheMap != NULL &&
+                FileObject->SectionObjectPointer != NULL &&
+                FileObject->SectionObjectPointer->SharedCacheMap != NULL)
+            {
+                CcRosReferenceCache(FileObject);
+                Trace->PrefetchedFiles[Trace->NumPrefetchedFiles++] = FileObject;
+
+                CcPfPrefetchRuns(FileObject, &PageRuns[FileInfo[i].FirstPageRun], FileInfo[i].NumPageRuns);
+            }
+            else
+            {
+                ObDereferenceObject(FileObject);
+            }
+        }
+
+        ZwClose(Handle);
+    }
+
+    InterlockedDecrement(&CcPfGlobals.ActivePrefetches);
+
+    ExFreePoolWithTag(Buffer, TAG_PREFETCH);
+}
+
+static
+int
+__cdecl
+CcPfCompareLogEntries(
+    const void *x,
+    const void *y)
+{
+    const PF_LOG_ENTRY *Entry1 = x;
+    const PF_LOG_ENTRY *Entry2 = y;
+
+    if (Entry1->FileKey != Entry2->FileKey)
+    {
+        return (Entry1->FileKey < Entry2->FileKey) ? -1 : 1;
+    }
+
+    if (Entry1->FileOffset != Entry2->FileOffset)
+    {
+        return (Entry1->FileOffset < Entry2->FileOffset) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+static
+POBJECT_NAME_INFORMATION
+CcPfQueryFileName(
+    IN PFILE_OBJECT FileObject)
+{
+    OBJECT_NAME_INFORMATION LocalNameInfo;
+    POBJECT_NAME_INFORMATION NameInfo;
+    ULONG ReturnLength;
+    NTSTATUS Status;
+
+    Status = ObQueryNameString(FileObject, &LocalNameInfo, sizeof(LocalNameInfo), &ReturnLength);
+    if ((Status != STATUS_BUFFER_OVERFLOW &&
+         Status != STATUS_BUFFER_TOO_SMALL &&
+         Status != STATUS_INFO_LENGTH_MISMATCH) ||
+        ReturnLength <= sizeof(LocalNameInfo))
+    {
+        return NULL;
+    }
+
+    NameInfo = ExAllocatePoolWithTag(PagedPool, ReturnLength, TAG_PREFETCH);
+    if (NameInfo == NULL)
+    {
+        return NULL;
+    }
+
+    Status = ObQueryNameString(FileObject, NameInfo, ReturnLength, &ReturnLength);
+    if (!NT_SUCCESS(Status) || NameInfo->Name.Length == 0)
+    {
+        ExFreePoolWithTag(NameInfo, TAG_PREFETCH);
+        return NULL;
+    }
+
+    return NameInfo;
+}
+
+static
+NTSTATUS
+CcPfWriteScenario(
+    IN PPFSN_TRACE_HEADER Trace)
+{
+    PPFSN_LOG_ENTRIES LogEntries = Trace->CurrentTraceBuffer;
+    POBJECT_NAME_INFORMATION *Names;
+    PPF_SCENARIO_HEADER Header = NULL;
+    PPF_SCENARIO_FILE Files, FileInfo = NULL;
+    PPF_PAGE_RUN PageRuns, PageRun = NULL;
+    PPF_LOG_ENTRY Entry;
+    PUCHAR FileNames;
+    ULONG NumFiles = 0, NumPageRuns = 0, NumPages = 0, NamesSize = 0;
+    ULONG Size, FileKey, RunEnd, i;
+    LARGE_INTEGER ByteOffset;
+    IO_STATUS_BLOCK IoStatus;
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    if (LogEntries->NumEntries < PFSN_MIN_TRACE_ENTRIES)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    Names = ExAllocatePoolWithTag(PagedPool, Trace->NumFiles * sizeof(*Names), TAG_PREFETCH);
+    if (Names == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    /* Files we can't name can't be opened later */
+    for (i = 0; i < Trace->NumFiles; i++)
+    {
+        Names[i] = CcPfQueryFileName(Trace->Files[i]);
+        if (Names[i] != NULL)
+        {
+            NamesSize += Names[i]->Name.Length;
+            NumFiles++;
+        }
+    }
+
+    /* Group the pages by file and sort them, then count the runs */
+    qsort(LogEntries->Entries, LogEntries->NumEntries, sizeof(PF_LOG_ENTRY), CcPfCompareLogEntries);
+
+    FileKey = MAXULONG;
+    RunEnd = 0;
+    for (i = 0; i < (ULONG)LogEntries->NumEntries; i++)
+    {
+        Entry = &LogEntries->Entries[i];
+        if (Names[Entry->FileKey] == NULL)
+        {
+            continue;
+        }
+
+        if (Entry->FileKey != FileKey || Entry->FileOffset > RunEnd)
+        {
+            FileKey = Entry->FileKey;
+            NumPageRuns++;
+        }
+        else if (Entry->FileOffset < RunEnd)
+        {
+            continue;
+        }
+
+        RunEnd = Entry->FileOffset + 1;
+        NumPages++;
+    }
+
+    /*
+     * A scenario whose files were still in memory from an earlier run barely
+     * faults, don't let that replace a trace of a cold start.
+     */
+    if (NumPages < PFSN_MIN_TRACE_ENTRIES || NumPages < Trace->ScenarioPages / 2)
+    {
+        DPRINT("CCPF: Keeping the scenario of %.*S, %lu pages traced, %lu prefetched\n",
+               (int)RTL_NUMBER_OF(Trace->ScenarioId.ScenName), Trace->ScenarioId.ScenName,
+               NumPages, Trace->ScenarioPages);
+        Status = STATUS_SUCCESS;
+        goto Cleanup;
+    }
+
+    Size = sizeof(PF_SCENARIO_HEADER) +
+           NumFiles * sizeof(PF_SCENARIO_FILE) +
+           NumPageRuns * sizeof(PF_PAGE_RUN) +
+           NamesSize;
+    if (NamesSize > PF_MAX_SCENARIO_SIZE || Size > PF_MAX_SCENARIO_SIZE)
+    {
+        Status = STATUS_BUFFER_OVERFLOW;
+        goto Cleanup;
+    }
+
+    Header = ExAllocatePoolWithTag(PagedPool, Size, TAG_PREFETCH);
+    if (Header == NULL)
+    {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto Cleanup;
+    }
+
+    RtlZeroMemory(Header, sizeof(*Header));
+    Header->Version = PF_SCENARIO_VERSION;
+    Header->MagicNumber = PF_SCENARIO_MAGIC;
+    Header->Size = Size;
+    Header->ScenarioId = Trace->ScenarioId;
+    Header->ScenarioType = Trace->ScenarioType;
+    Header->FileInfoOffset = sizeof(PF_SCENARIO_HEADER);
+    Header->PageRunOffset = Header->FileInfoOffset + NumFiles * sizeof(PF_SCENARIO_FILE);
+    Header->FileNameInfoOffset = Header->PageRunOffset + NumPageRuns * sizeof(PF_PAGE_RUN);
+
+    Files = (PPF_SCENARIO_FILE)((PUCHAR)Header + Header->FileInfoOffset);
+    PageRuns = (PPF_PAGE_RUN)((PUCHAR)Header + Header->PageRunOffset);
+    FileNames = (PUCHAR)Header + Header->FileNameInfoOffset;
+
+    /* Same walk as above, file keys are in first access order */
+    FileKey = MAXULONG;
+    for (i = 0; i < (ULONG)LogEntries->NumEntries; i++)
+    {
+        Entry = &LogEntries->Entries[i];
+        if (Names[Entry->FileKey] == NULL)
+        {
+            continue;
+        }
+
+        if (Entry->FileKey != FileKey)
+        {
+            FileKey = Entry->FileKey;
+            FileInfo = &Files[Header->NumFiles++];
+            FileInfo->FileNameOffset = Header->FileNameInfoSize;
+            FileInfo->FileNameLength = Names[FileKey]->Name.Length;
+            FileInfo->FirstPageRun = Header->NumPageRuns;
+            FileInfo->NumPageRuns = 0;
+            RtlCopyMemory(FileNames + Header->FileNameInfoSize,
+                          Names[FileKey]->Name.Buffer,
+                          FileInfo->FileNameLength);
+            Header->FileNameInfoSize += FileInfo->FileNameLength;
+            PageRun = NULL;
+        }
+
+        if (PageRun != NULL && Entry->FileOffset <= PageRun->FirstPage + PageRun->NumPages)
+        {
+            PageRun->NumPages = max(PageRun->NumPages, Entry->FileOffset - PageRun->FirstPage + 1);
+            continue;
+        }
+
+        PageRun = &PageRuns[Header->NumPageRuns++];
+        PageRun->FirstPage = Entry->FileOffset;
+        PageRun->NumPages = 1;
+        FileInfo->NumPageRuns++;
+    }
+
+    ASSERT(Header->NumFiles == NumFiles);
+    ASSERT(Header->NumPageRuns == NumPageRuns);
+    ASSERT(Header->FileNameInfoSize == NamesSize);
+
+    Status = CcPfOpenScenario(&Trace->ScenarioId, TRUE, &Handle);
+    if (NT_SUCCESS(Status))
+    {
+        ByteOffset.QuadPart = 0;
+        Status = ZwWriteFile(Handle, NULL, NULL, NULL, &IoStatus, Header, Size, &ByteOffset, NULL);
+        ZwClose(Handle);
+    }
+
+    DPRINT("CCPF: Saved %.*S, %lu files, %lu runs, %lu pages (0x%lx)\n",
+           (int)RTL_NUMBER_OF(Trace->ScenarioId.ScenName), Trace->ScenarioId.ScenName,
+           NumFiles, NumPageRuns, NumPages, Status);
+
+Cleanup:
+    if (Header != NULL)
+    {
+        ExFreePoolWithTag(Header, TAG_PREFETCH);
+    }
+
+    for (i = 0; i < Trace->NumFiles; i++)
+    {
+        if (Names[i] != NULL)
+        {
+            ExFreePoolWithTag(Names[i], TAG_PREFETCH);
+        }
+    }
+
+    ExFreePoolWithTag(Names, TAG_PREFETCH);
+
+    return Status;
+}
+
+static
+VOID
+CcPfFreeTrace(
+    IN PPFSN_TRACE_HEADER Trace)
+{
+    PFILE_OBJECT FileObject;
+    ULONG i;
+
+    for (i = 0; i < Trace->NumPrefetchedFiles; i++)
+    {
+        FileObject = Trace->PrefetchedFiles[i];
+        if (FileObject->SectionObjectPointer->SharedCacheMap != NULL)
+        {
+            CcRosDereferenceCache(FileObject);
+        }
+        ObDereferenceObject(FileObject);
+    }
+
+    for (i = 0; i < Trace->NumFiles; i++)
+    {
+        ObDereferenceObject(Trace->Files[i]);
+    }
+
+    if (Trace->Process != NULL)
+    {
+        ObDereferenceObject(Trace->Process);
+    }
+
+    if (Trace->PrefetchedFiles != NULL)
+    {
+        ExFreePoolWithTag(Trace->PrefetchedFiles, TAG_PREFETCH);
+    }
+
+    if (Trace->Files != NULL)
+    {
+        ExFreePoolWithTag(Trace->Files, TAG_PREFETCH);
+    }
+
+    if (Trace->CurrentTraceBuffer != NULL)
+    {
+        ExFreePoolWithTag(Trace->CurrentTraceBuffer, TAG_PREFETCH);
+    }
+
+    ExFreePoolWithTag(Trace, TAG_PREFETCH);
+}
+
+static
+VOID
+NTAPI
+CcPfEndTraceWorkerThreadRoutine(
+    IN PVOID Parameter)
+{
+    PPFSN_TRACE_HEADER Trace = Parameter;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+    RemoveEntryList(&Trace->ActiveTracesLink);
+    if (CcPfGlobals.SystemWideTrace == Trace)
+    {
+        CcPfGlobals.SystemWideTrace = NULL;
+    }
+    if (Trace->Process != NULL)
+    {
+        ExInitializeFastReference(&Trace->Process->PrefetchTrace, NULL);
+    }
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+
+    /* Loggers hold the list lock throughout, none is left logging into it */
+
+    Trace->TraceDumpStatus = CcPfWriteScenario(Trace);
+    if (!NT_SUCCESS(Trace->TraceDumpStatus))
+    {
+        DPRINT1("CCPF: Failed to save the scenario of %.*S (0x%lx)\n",
+                (int)RTL_NUMBER_OF(Trace->ScenarioId.ScenName), Trace->ScenarioId.ScenName,
+                Trace->TraceDumpStatus);
+    }
+
+    CcPfFreeTrace(Trace);
+}
+
+static
+VOID
+NTAPI
+CcPfTraceTimerRoutine(
+    IN PKDPC Dpc,
+    IN PVOID DeferredContext,
+    IN PVOID SystemArgument1,
+    IN PVOID SystemArgument2)
+{
+    PPFSN_TRACE_HEADER Trace = DeferredContext;
+    LONG NumFaults, Period;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    NumFaults = Trace->NumFaults;
+    Period = Trace->CurPeriod;
+    Trace->FaultsPerPeriod[Period] = NumFaults - Trace->LastNumFaults;
+    Trace->LastNumFaults = NumFaults;
+    Trace->CurPeriod = ++Period;
+
+    /* Keep going until the scenario settles down or the log is full */
+    if (Period < PFSN_NUM_PERIODS &&
+        NumFaults < Trace->MaxFaults &&
+        (Trace->ScenarioType != PfApplicationLaunchScenarioType ||
+         Period <= 2 ||
+         Trace->FaultsPerPeriod[Period - 1] >= PFSN_MIN_FAULTS_PER_PERIOD))
+    {
+        KeSetTimer(&Trace->TraceTimer, Trace->TraceTimerPeriod, &Trace->TraceTimerDpc);
+        return;
+    }
+
+    /* Saving it requires file I/O */
+    if (InterlockedExchange(&Trace->EndTraceCalled, 1) == 0)
+    {
+        ExQueueWorkItem(&Trace->EndTraceWorkItem, DelayedWorkQueue);
+    }
+}
+
+static
+NTSTATUS
+CcPfBeginTrace(
+    IN PPF_SCENARIO_ID ScenarioId,
+    IN PF_SCENARIO_TYPE ScenarioType,
+    IN PEPROCESS Process)
+{
+    PPF_SCENARIO_HEADER Scenario;
+    PPFSN_TRACE_HEADER Trace, Current;
+    PLIST_ENTRY ListEntry;
+    LONG MaxEntries;
+    KIRQL OldIrql;
+
+    Trace = ExAllocatePoolWithTag(NonPagedPool, sizeof(*Trace), TAG_PREFETCH);
+    if (Trace == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Trace, sizeof(*Trace));
+
+    /* Loggers run at DISPATCH_LEVEL, their data is non paged */
+    MaxEntries = (ScenarioType == PfSystemBootScenarioType) ? PFSN_BOOT_ENTRIES : PFSN_APP_LAUNCH_ENTRIES;
+    Trace->CurrentTraceBuffer = ExAllocatePoolWithTag(NonPagedPool,
+                                                      FIELD_OFFSET(PFSN_LOG_ENTRIES, Entries[MaxEntries]),
+                                                      TAG_PREFETCH);
+    Trace->Files = ExAllocatePoolWithTag(NonPagedPool, PFSN_MAX_FILES * sizeof(PFILE_OBJECT), TAG_PREFETCH);
+    Trace->PrefetchedFiles = ExAllocatePoolWithTag(PagedPool, PFSN_MAX_FILES * sizeof(PFILE_OBJECT), TAG_PREFETCH);
+    if (Trace->CurrentTraceBuffer == NULL || Trace->Files == NULL || Trace->PrefetchedFiles == NULL)
+    {
+        CcPfFreeTrace(Trace);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Trace->Magic = PFSN_TRACE_MAGIC;
+    Trace->ScenarioId = *ScenarioId;
+    Trace->ScenarioType = ScenarioType;
+    InitializeListHead(&Trace->TraceBuffersList);
+    InsertTailList(&Trace->TraceBuffersList, &Trace->CurrentTraceBuffer->TraceBuffersLink);
+    Trace->NumTraceBuffers = 1;
+    Trace->CurrentTraceBuffer->NumEntries = 0;
+    Trace->CurrentTraceBuffer->MaxEntries = MaxEntries;
+    Trace->MaxFaults = MaxEntries;
+    KeInitializeSpinLock(&Trace->TraceBufferSpinLock);
+    KeInitializeSpinLock(&Trace->TraceTimerSpinLock);
+    KeInitializeTimer(&Trace->TraceTimer);
+    KeInitializeDpc(&Trace->TraceTimerDpc, CcPfTraceTimerRoutine, Trace);
+    ExInitializeWorkItem(&Trace->EndTraceWorkItem, CcPfEndTraceWorkerThreadRoutine, Trace);
+    Trace->TraceTimerPeriod.QuadPart = (ScenarioType == PfSystemBootScenarioType) ?
+                                       -12 * 1000 * 1000 * 10LL :
+                                       -1 * 1000 * 1000 * 10LL;
+
+    if (Process != NULL)
+    {
+        ObReferenceObject(Process);
+        Trace->Process = Process;
+    }
+
+    /*
+     * Start an application launch trace right away, so that the same scenario
+     * isn't traced twice and the prefetch reads don't end up in the boot one.
+     * Nothing is logged in it until the prefetch is done.
+     */
+    Trace->Prefetching = TRUE;
+    if (ScenarioType == PfApplicationLaunchScenarioType)
+    {
+        KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+        for (ListEntry = CcPfGlobals.ActiveTraces.Flink;
+             ListEntry != &CcPfGlobals.ActiveTraces;
+             ListEntry = ListEntry->Flink)
+        {
+            Current = CONTAINING_RECORD(ListEntry, PFSN_TRACE_HEADER, ActiveTracesLink);
+            if (RtlCompareMemory(&Current->ScenarioId, ScenarioId, sizeof(*ScenarioId)) == sizeof(*ScenarioId))
+            {
+                KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+                CcPfFreeTrace(Trace);
+                return STATUS_TOO_MANY_SESSIONS;
+            }
+        }
+        InsertTailList(&CcPfGlobals.ActiveTraces, &Trace->ActiveTracesLink);
+        /* Holds no reference, the trace is taken off before it is freed */
+        ExInitializeFastReference(&Process->PrefetchTrace, Trace);
+        KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+    }
+
+    if (NT_SUCCESS(CcPfReadScenario(ScenarioId, ScenarioType, &Scenario)))
+    {
+        CcPfPrefetchScenario(Trace, Scenario);
+        ExFreePoolWithTag(Scenario, TAG_PREFETCH);
+    }
+
+    KeQuerySystemTime(&Trace->LaunchTime);
+
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+    if (ScenarioType == PfSystemBootScenarioType)
+    {
+        InsertTailList(&CcPfGlobals.ActiveTraces, &Trace->ActiveTracesLink);
+        CcPfGlobals.SystemWideTrace = Trace;
+    }
+    Trace->Prefetching = FALSE;
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+
+    KeSetTimer(&Trace->TraceTimer, Trace->TraceTimerPeriod, &Trace->TraceTimerDpc);
+
+    return STATUS_SUCCESS;
+}
+
+/* Called at DISPATCH_LEVEL with the active traces lock held */
+static
+VOID
+CcPfLogPage(
+    IN PPFSN_TRACE_HEADER Trace,
+    IN PFILE_OBJECT FileObject,
+    IN ULONG Page)
+{
+    PPFSN_LOG_ENTRIES LogEntries;
+    PPF_LOG_ENTRY Entry;
+    ULONG FileKey;
+
+    KeAcquireSpinLockAtDpcLevel(&Trace->TraceBufferSpinLock);
+
+    LogEntries = Trace->CurrentTraceBuffer;
+    if (LogEntries->NumEntries >= LogEntries->MaxEntries)
+    {
+        goto Release;
+    }
+
+    /* Most of the time, the file is the same as the last time */
+    Entry = (LogEntries->NumEntries > 0) ? &LogEntries->Entries[LogEntries->NumEntries - 1] : NULL;
+    if (Entry != NULL &&
+        Trace->Files[Entry->FileKey]->SectionObjectPointer == FileObject->SectionObjectPointer)
+    {
+        FileKey = Entry->FileKey;
+
+        /* Faults on a page the cache just handed out for the same view */
+        if (Entry->FileOffset == Page)
+        {
+            goto Release;
+        }
+    }
+    else
+    {
+        for (FileKey = 0; FileKey < Trace->NumFiles; FileKey++)
+        {
+            if (Trace->Files[FileKey]->SectionObjectPointer == FileObject->SectionObjectPointer)
+            {
+                break;
+            }
+        }
+
+        if (FileKey == Trace->NumFiles)
+        {
+            if (Trace->NumFiles == PFSN_MAX_FILES)
+            {
+                goto Release;
+            }
+
+            /* Keep it, its name is needed at the end of the trace */
+            ObReferenceObject(FileObject);
+            Trace->Files[Trace->NumFiles++] = FileObject;
+        }
+    }
+
+    Entry = &LogEntries->Entries[LogEntries->NumEntries++];
+    Entry->FileOffset = Page;
+    Entry->Type = 0;
+    Entry->FileKey = FileKey;
+    Trace->NumFaults++;
+
+Release:
+    KeReleaseSpinLockFromDpcLevel(&Trace->TraceBufferSpinLock);
+}
+
+/*
+ * Called for every view the cache hands out, for page-ins as well as for
+ * cached I/O. Logging accesses rather than misses keeps the traces complete
+ * when the scenario was prefetched.
+ */
+VOID
+NTAPI
+CcPfLogFileAccess(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN LONGLONG FileOffset)
+{
+    PPFSN_TRACE_HEADER Trace, BootTrace;
+    PEPROCESS Process;
+    ULONG Page;
+    KIRQL OldIrql;
+
+    /*
+     * Nothing is being traced, most of the time. Checked without the lock:
+     * a trace that just started misses a few accesses at worst, and one
+     * that just ended is checked again below.
+     */
+    Process = PsGetCurrentProcess();
+    if (ExGetObjectFastReference(Process->PrefetchTrace) == NULL &&
+        CcPfGlobals.SystemWideTrace == NULL)
+    {
+        return;
+    }
+
+    /* A log entry holds 30 bits of page number */
+    if ((ULONGLONG)FileOffset >> PAGE_SHIFT >= (1UL << 30))
+    {
+        return;
+    }
+
+    Page = (ULONG)(FileOffset >> PAGE_SHIFT);
+
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+
+    Trace = ExGetObjectFastReference(Process->PrefetchTrace);
+    BootTrace = CcPfGlobals.SystemWideTrace;
+
+    /* The prefetch reads of a launch belong in neither trace */
+    if (Trace == NULL || !Trace->Prefetching)
+    {
+        if (Trace != NULL && !Trace->EndTraceCalled)
+        {
+            CcPfLogPage(Trace, SharedCacheMap->FileObject, Page);
+        }
+
+        /* The boot trace covers the processes started during boot too */
+        if (BootTrace != NULL && !BootTrace->Prefetching && !BootTrace->EndTraceCalled)
+        {
+            CcPfLogPage(BootTrace, SharedCacheMap->FileObject, Page);
+        }
+    }
+
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+CcPfBeginAppLaunch(
+    IN PEPROCESS Process,
+    IN PVOID Section)
+{
+    POBJECT_NAME_INFORMATION ImageFileName;
+    PF_SCENARIO_ID ScenarioId;
+    NTSTATUS Status;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(Section);
+    PAGED_CODE();
+
+    if (!CcPfEnablePrefetcher || !(CcPfEnablePrefetcherFlags & PF_ENABLE_APP_LAUNCH))
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    ImageFileName = Process->SeAuditProcessCreationInfo.ImageFileName;
+    if (ImageFileName == NULL || ImageFileName->Name.Length == 0)
+    {
+        return STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    /* Same as the prefetch files of Windows, e.g. NOTEPAD.EXE-1A2B3C4D.pf */
+    RtlZeroMemory(&ScenarioId, sizeof(ScenarioId));
+    for (i = 0; i < sizeof(Process->ImageFileName) && Process->ImageFileName[i] != ANSI_NULL; i++)
+    {
+        ScenarioId.ScenName[i] = RtlUpcaseUnicodeChar((UCHAR)Process->ImageFileName[i]);
+    }
+
+    /* The same image launched from another path is another scenario */
+    Status = RtlHashUnicodeString(&ImageFileName->Name, TRUE, HASH_STRING_ALGORITHM_X65599, &ScenarioId.HashId);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    return CcPfBeginTrace(&ScenarioId, PfApplicationLaunchScenarioType, Process);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+CcPfBeginBootPhase(
+    IN PF_BOOT_PHASE_ID Phase)
+{
+    PF_SCENARIO_ID ScenarioId;
+
+    PAGED_CODE();
+
+    if (!CcPfEnablePrefetcher || !(CcPfEnablePrefetcherFlags & PF_ENABLE_BOOT))
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    /* The boot trace starts along with the session manager */
+    if (Phase != PfSessionManagerInitPhase || CcPfBootTraceStarted)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    CcPfBootTraceStarted = TRUE;
+
+    RtlZeroMemory(&ScenarioId, sizeof(ScenarioId));
+    RtlCopyMemory(ScenarioId.ScenName, PFSN_BOOT_SCENARIO_NAME, sizeof(PFSN_BOOT_SCENARIO_NAME));
+    ScenarioId.HashId = PFSN_BOOT_SCENARIO_HASH;
+
+    return CcPfBeginTrace(&ScenarioId, PfSystemBootScenarioType, NULL);
+}
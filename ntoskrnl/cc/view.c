@@ -363,6 +363,7 @@ retry:
             ASSERT(!current->MappedCount);
             ASSERT(Refs == 1);
 
+            CcRosRemoveVacbFromIndex(current->SharedCacheMap, current);
             RemoveEntryList(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -452,6 +453,120 @@ CcRosReleaseVacb (
     return STATUS_SUCCESS;
 }
 
+/*
+ * The VACB index maps a view number (FileOffset / VACB_MAPPING_GRANULARITY)
+ * to the VACB mapping it. It's a two level sparse array: streaming through
+ * a huge file only costs a leaf per 32MB actually cached. It is protected by
+ * the cache map lock, so it has to be updated with the VACB list.
+ */
+static
+PROS_VACB *
+CcRosGetVacbIndexSlot (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset,
+    BOOLEAN Create)
+{
+    ULONGLONG View;
+    ULONG Leaf, NewSize;
+    PROS_VACB **NewIndex;
+
+    View = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+    if ((View >> VACB_INDEX_LEAF_SHIFT) >= MAXULONG)
+    {
+        return NULL;
+    }
+
+    Leaf = (ULONG)(View >> VACB_INDEX_LEAF_SHIFT);
+    if (Leaf >= SharedCacheMap->VacbIndexSize)
+    {
+        if (!Create)
+        {
+            return NULL;
+        }
+
+        /* Grow geometrically, so that a growing file doesn't reallocate it all the time */
+        NewSize = max(Leaf + 1, SharedCacheMap->VacbIndexSize * 2);
+        NewIndex = ExAllocatePoolWithTag(NonPagedPool, NewSize * sizeof(*NewIndex), TAG_VACB_INDEX);
+        if (NewIndex == NULL)
+        {
+            return NULL;
+        }
+
+        RtlZeroMemory(NewIndex, NewSize * sizeof(*NewIndex));
+        if (SharedCacheMap->VacbIndex != NULL)
+        {
+            RtlCopyMemory(NewIndex,
+                          SharedCacheMap->VacbIndex,
+                          SharedCacheMap->VacbIndexSize * sizeof(*NewIndex));
+            ExFreePoolWithTag(SharedCacheMap->VacbIndex, TAG_VACB_INDEX);
+        }
+
+        SharedCacheMap->VacbIndex = NewIndex;
+        SharedCacheMap->VacbIndexSize = NewSize;
+    }
+
+    if (SharedCacheMap->VacbIndex[Leaf] == NULL)
+    {
+        if (!Create)
+        {
+            return NULL;
+        }
+
+        SharedCacheMap->VacbIndex[Leaf] = ExAllocatePoolWithTag(NonPagedPool,
+                                                                VACB_INDEX_LEAF_SIZE * sizeof(PROS_VACB),
+                                                                TAG_VACB_INDEX);
+        if (SharedCacheMap->VacbIndex[Leaf] == NULL)
+        {
+            return NULL;
+        }
+
+        RtlZeroMemory(SharedCacheMap->VacbIndex[Leaf], VACB_INDEX_LEAF_SIZE * sizeof(PROS_VACB));
+    }
+
+    return &SharedCacheMap->VacbIndex[Leaf][View & (VACB_INDEX_LEAF_SIZE - 1)];
+}
+
+/* Must be called with the cache map lock held */
+VOID
+CcRosRemoveVacbFromIndex (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    PROS_VACB Vacb)
+{
+    PROS_VACB *Slot;
+
+    Slot = CcRosGetVacbIndexSlot(SharedCacheMap, Vacb->FileOffset.QuadPart, FALSE);
+    ASSERT(Slot != NULL && *Slot == Vacb);
+    if (Slot != NULL)
+    {
+        *Slot = NULL;
+    }
+}
+
+static
+VOID
+CcRosFreeVacbIndex (
+    PROS_SHARED_CACHE_MAP SharedCacheMap)
+{
+    ULONG i;
+
+    if (SharedCacheMap->VacbIndex == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < SharedCacheMap->VacbIndexSize; i++)
+    {
+        if (SharedCacheMap->VacbIndex[i] != NULL)
+        {
+            ExFreePoolWithTag(SharedCacheMap->VacbIndex[i], TAG_VACB_INDEX);
+        }
+    }
+
+    ExFreePoolWithTag(SharedCacheMap->VacbIndex, TAG_VACB_INDEX);
+    SharedCacheMap->VacbIndex = NULL;
+    SharedCacheMap->VacbIndexSize = 0;
+}
+
 /* Returns with VACB Lock Held! */
 PROS_VACB
 NTAPI
@@ -459,7 +574,7 @@ CcRosLookupVacb (
     PROS_SHARED_CACHE_MAP SharedCacheMap,
     LONGLONG FileOffset)
 {
-    PLIST_ENTRY current_entry;
+    PROS_VACB *Slot;
     PROS_VACB current;
     KIRQL oldIrql;
 
@@ -468,33 +583,25 @@ CcRosLookupVacb (
     DPRINT("CcRosLookupVacb(SharedCacheMap 0x%p, FileOffset %I64u)\n",
            SharedCacheMap, FileOffset);
 
-    oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-    KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
+    /* VACBs only leave the index with the cache map lock held and while
+     * unreferenced, so there's no need for the master lock here.
+     */
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
 
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    current = NULL;
+    Slot = CcRosGetVacbIndexSlot(SharedCacheMap, FileOffset, FALSE);
+    if (Slot != NULL && *Slot != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-            return current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        current = *Slot;
+        ASSERT(IsPointInRange(current->FileOffset.QuadPart,
+                              VACB_MAPPING_GRANULARITY,
+                              FileOffset));
+        CcRosVacbIncRefCount(current);
     }
 
-    KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
 
-    return NULL;
+    return current;
 }
 
 VOID
@@ -733,6 +840,7 @@ CcRosFreeUnusedVacb (
             ASSERT(Refs == 1);
 
             /* Reset and move to free list */
+            CcRosRemoveVacbFromIndex(current->SharedCacheMap, current);
             RemoveEntryList(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -784,6 +892,7 @@ CcRosCreateVacb (
 {
     PROS_VACB current;
     PROS_VACB previous;
+    PROS_VACB *Slot;
     PLIST_ENTRY current_entry;
     NTSTATUS Status;
     KIRQL oldIrql;
@@ -853,56 +962,59 @@ Retry:
      * our newly created VACB and return the existing one.
      */
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    previous = NULL;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    Slot = CcRosGetVacbIndexSlot(SharedCacheMap, FileOffset, TRUE);
+    if (Slot == NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-#if DBG
-            if (SharedCacheMap->Trace)
-            {
-                DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
-                        SharedCacheMap,
-                        (*Vacb),
-                        current);
-            }
-#endif
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
 
-            Refs = CcRosVacbDecRefCount(*Vacb);
-            ASSERT(Refs == 0);
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
 
-            *Vacb = current;
-            return STATUS_SUCCESS;
-        }
-        if (current->FileOffset.QuadPart < FileOffset)
+        *Vacb = NULL;
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (*Slot != NULL)
+    {
+        current = *Slot;
+        CcRosVacbIncRefCount(current);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+#if DBG
+        if (SharedCacheMap->Trace)
         {
-            ASSERT(previous == NULL ||
-                   previous->FileOffset.QuadPart < current->FileOffset.QuadPart);
-            previous = current;
+            DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
+                    SharedCacheMap,
+                    (*Vacb),
+                    current);
         }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+#endif
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
+
+        *Vacb = current;
+        return STATUS_SUCCESS;
     }
-    /* There was no existing VACB. */
+
+    /* There was no existing VACB. Keep the list sorted, views are
+     * mostly created in ascending order so look from its end.
+     */
     current = *Vacb;
-    if (previous)
-    {
-        InsertHeadList(&previous->CacheMapVacbListEntry, &current->CacheMapVacbListEntry);
-    }
-    else
+    *Slot = current;
+    current_entry = SharedCacheMap->CacheMapVacbListHead.Blink;
+    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
     {
-        InsertHeadList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
+        previous = CONTAINING_RECORD(current_entry,
+                                     ROS_VACB,
+                                     CacheMapVacbListEntry);
+        ASSERT(previous->FileOffset.QuadPart != current->FileOffset.QuadPart);
+        if (previous->FileOffset.QuadPart < current->FileOffset.QuadPart)
+            break;
+        current_entry = current_entry->Blink;
     }
+    InsertHeadList(current_entry, &current->CacheMapVacbListEntry);
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     InsertTailList(&VacbLruListHead, &current->VacbLruListEntry);
     KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
@@ -988,6 +1100,9 @@ CcRosGetVacb (
 
     ASSERT(Refs > 1);
 
+    /* Let the prefetcher know, should it be tracing */
+    CcPfLogFileAccess(SharedCacheMap, FileOffset);
+
     return STATUS_SUCCESS;
 }
 
@@ -1189,9 +1304,10 @@ CcRosDeleteFileCache (
         while (!IsListEmpty(&SharedCacheMap->CacheMapVacbListHead))
         {
             current_entry = RemoveTailList(&SharedCacheMap->CacheMapVacbListHead);
+            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+            CcRosRemoveVacbFromIndex(SharedCacheMap, current);
             KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 
-            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             if (current->Dirty)
@@ -1259,6 +1375,7 @@ CcRosDeleteFileCache (
         RemoveEntryList(&SharedCacheMap->SharedCacheMapLinks);
         KeReleaseQueuedSpinLock(LockQueueMasterLock, *OldIrql);
 
+        CcRosFreeVacbIndex(SharedCacheMap);
         ExFreeToNPagedLookasideList(&SharedCacheMapLookasideList, SharedCacheMap);
         *OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     }
@@ -1666,6 +1783,27 @@ ExpKdbgExtDefWrites(ULONG Argc, PCHAR Argv[])
 
     return TRUE;
 }
+
+BOOLEAN
+ExpKdbgExtReadAhead(ULONG Argc, PCHAR Argv[])
+{
+    KdbpPrint("CcReadAheadIos:\t\t%lu\n", CcReadAheadIos);
+    KdbpPrint("CcReadAheadPages:\t%lu (%lu Kb)\n", CcReadAheadPages,
+              (CcReadAheadPages * PAGE_SIZE) / 1024);
+    KdbpPrint("CcReadAheadHitPages:\t%lu (%lu Kb)\n", CcReadAheadHitPages,
+              (CcReadAheadHitPages * PAGE_SIZE) / 1024);
+    KdbpPrint("CcReadAheadWastedPages:\t%lu (%lu Kb)\n", CcReadAheadWastedPages,
+              (CcReadAheadWastedPages * PAGE_SIZE) / 1024);
+
+    /* Pages still ahead of a live stream are neither hit nor wasted yet */
+    if (CcReadAheadPages != 0)
+    {
+        KdbpPrint("Read ahead pages used:\t%lu%%\n",
+                  (ULONG)((ULONGLONG)CcReadAheadHitPages * 100 / CcReadAheadPages));
+    }
+
+    return TRUE;
+}
 #endif
 
 /* EOF */
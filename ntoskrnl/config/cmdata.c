@@ -530,6 +530,14 @@ INIT_SECTION CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL
     },
 
+    {
+        L"Session Manager\\Memory Management\\PrefetchParameters",
+        L"EnablePrefetcher",
+        &CcPfEnablePrefetcherFlags,
+        NULL,
+        NULL
+    },
+
     {
         L"Session Manager\\Executive",
         L"AdditionalCriticalWorkerThreads",
@@ -65,6 +65,35 @@ extern ULONG CcPinReadNoWait;
 extern ULONG CcPinMappedDataCount;
 extern ULONG CcDataPages;
 extern ULONG CcDataFlushes;
+extern ULONG CcReadAheadIos;
+extern ULONG CcReadAheadPages;
+extern ULONG CcReadAheadHitPages;
+extern ULONG CcReadAheadWastedPages;
+
+typedef enum _PF_SCENARIO_TYPE
+{
+    PfApplicationLaunchScenarioType,
+    PfSystemBootScenarioType,
+    PfMaxScenarioType
+} PF_SCENARIO_TYPE;
+
+typedef enum _PF_BOOT_PHASE_ID
+{
+    PfKernelInitPhase = 0,
+    PfBootDriverInitPhase = 90,
+    PfSystemDriverInitPhase = 120,
+    PfSessionManagerInitPhase = 150,
+    PfSMRegistryInitPhase = 180,
+    PfVideoInitPhase = 210,
+    PfPostVideoInitPhase = 240,
+    PfBootAcceptedRegistryInitPhase = 270,
+    PfUserShellReadyPhase = 300,
+    PfMaxBootPhaseId = 900
+} PF_BOOT_PHASE_ID;
+
+/* EnablePrefetcher registry value */
+#define PF_ENABLE_APP_LAUNCH    0x1
+#define PF_ENABLE_BOOT          0x2
 
 typedef struct _PF_SCENARIO_ID
 {
@@ -153,6 +182,18 @@ typedef struct _PFSN_TRACE_HEADER
     LARGE_INTEGER LaunchTime;
     PPF_SECTION_INFO SectionInfo;
     ULONG SectionInfoCount;
+
+    /* ROS specific */
+    /* Referenced file objects, the log entries' FileKey indexes this */
+    PFILE_OBJECT *Files;
+    ULONG NumFiles;
+    /* Files prefetched for this trace, their cache is held until it ends */
+    PFILE_OBJECT *PrefetchedFiles;
+    ULONG NumPrefetchedFiles;
+    /* Pages in the scenario file this trace was prefetched from */
+    ULONG ScenarioPages;
+    /* Set while prefetching, the accesses aren't logged */
+    BOOLEAN Prefetching;
 } PFSN_TRACE_HEADER, *PPFSN_TRACE_HEADER;
 
 typedef struct _PFSN_PREFETCHER_GLOBALS
@@ -167,6 +208,53 @@ typedef struct _PFSN_PREFETCHER_GLOBALS
     LONG ActivePrefetches;
 } PFSN_PREFETCHER_GLOBALS, *PPFSN_PREFETCHER_GLOBALS;
 
+//
+// Prefetcher
+//
+extern BOOLEAN CcPfEnablePrefetcher;
+extern ULONG CcPfEnablePrefetcherFlags;
+extern PFSN_PREFETCHER_GLOBALS CcPfGlobals;
+
+/*
+ * Scenario file, \SystemRoot\Prefetch\NAME-HASH.pf
+ * The header is followed by the file table, the page runs of the files,
+ * and the file names. Files are in the order they were first accessed,
+ * page runs are sorted by page within each file.
+ */
+#define PF_SCENARIO_VERSION     1
+#define PF_SCENARIO_MAGIC       'ACCS'
+#define PF_MAX_SCENARIO_SIZE    (1024 * 1024)
+
+typedef struct _PF_SCENARIO_HEADER
+{
+    ULONG Version;
+    ULONG MagicNumber;
+    ULONG Size;
+    PF_SCENARIO_ID ScenarioId;
+    ULONG ScenarioType; // PF_SCENARIO_TYPE
+    ULONG FileInfoOffset;
+    ULONG NumFiles;
+    ULONG PageRunOffset;
+    ULONG NumPageRuns;
+    ULONG FileNameInfoOffset;
+    ULONG FileNameInfoSize;
+} PF_SCENARIO_HEADER, *PPF_SCENARIO_HEADER;
+
+typedef struct _PF_SCENARIO_FILE
+{
+    /* Relative to FileNameInfoOffset, in bytes, not NULL terminated */
+    ULONG FileNameOffset;
+    ULONG FileNameLength;
+    ULONG FirstPageRun;
+    ULONG NumPageRuns;
+} PF_SCENARIO_FILE, *PPF_SCENARIO_FILE;
+
+typedef struct _PF_PAGE_RUN
+{
+    ULONG FirstPage;
+    ULONG NumPages;
+} PF_PAGE_RUN, *PPF_PAGE_RUN;
+
 typedef struct _ROS_SHARED_CACHE_MAP
 {
     CSHORT NodeTypeCode;
@@ -188,6 +276,9 @@ typedef struct _ROS_SHARED_CACHE_MAP
 
     /* ROS specific */
     LIST_ENTRY CacheMapVacbListHead;
+    /* Index of the VACBs of the list above, by view number */
+    struct _ROS_VACB ***VacbIndex;
+    ULONG VacbIndexSize;
     BOOLEAN PinAccess;
     KSPIN_LOCK CacheMapLock;
 #if DBG
@@ -198,6 +289,13 @@ typedef struct _ROS_SHARED_CACHE_MAP
 #define READAHEAD_DISABLED 0x1
 #define WRITEBEHIND_DISABLED 0x2
 
+/* Read ahead windows start at the read ahead granularity and double up to this */
+#define CC_MAX_READ_AHEAD_WINDOW (4 * VACB_MAPPING_GRANULARITY)
+
+/* A VACB index leaf holds the VACBs of 128 views (32MB of file) */
+#define VACB_INDEX_LEAF_SHIFT 7
+#define VACB_INDEX_LEAF_SIZE (1 << VACB_INDEX_LEAF_SHIFT)
+
 typedef struct _ROS_VACB
 {
     /* Base address of the region where the view's data is mapped. */
@@ -293,6 +391,19 @@ CcPfInitializePrefetcher(
     VOID
 );
 
+NTSTATUS
+NTAPI
+CcPfBeginAppLaunch(
+    IN PEPROCESS Process,
+    IN PVOID Section
+);
+
+NTSTATUS
+NTAPI
+CcPfBeginBootPhase(
+    IN PF_BOOT_PHASE_ID Phase
+);
+
 VOID
 NTAPI
 CcMdlReadComplete2(
@@ -308,6 +419,13 @@ CcMdlWriteComplete2(
     IN PMDL MdlChain
 );
 
+VOID
+NTAPI
+CcPfLogFileAccess(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN LONGLONG FileOffset
+);
+
 NTSTATUS
 NTAPI
 CcRosFlushVacb(PROS_VACB Vacb);
@@ -360,6 +478,12 @@ CcRosLookupVacb(
     LONGLONG FileOffset
 );
 
+VOID
+CcRosRemoveVacbFromIndex(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    PROS_VACB Vacb
+);
+
 VOID
 NTAPI
 CcInitCacheZeroPage(VOID);
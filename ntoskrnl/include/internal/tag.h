@@ -4,8 +4,10 @@
 #define TAG_CC                  '  cC'
 #define TAG_VACB                'aVcC'
 #define TAG_SHARED_CACHE_MAP    'cScC'
+#define TAG_VACB_INDEX          'xIcC'
 #define TAG_PRIVATE_CACHE_MAP   'cPcC'
 #define TAG_BCB                 'cBcC'
+#define TAG_PREFETCH            'fPcC'
 
 /* Executive Callbacks */
 #define TAG_CALLBACK_ROUTINE_BLOCK 'brbC'
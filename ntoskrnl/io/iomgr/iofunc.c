@@ -1134,6 +1134,287 @@ IopGetDriverPathInformation(IN PFILE_OBJECT FileObject,
     return STATUS_SUCCESS;
 }
 
+static
+NTSTATUS
+IopScatterGatherFile(IN HANDLE FileHandle,
+                     IN HANDLE Event OPTIONAL,
+                     IN PIO_APC_ROUTINE ApcRoutine OPTIONAL,
+                     IN PVOID ApcContext OPTIONAL,
+                     OUT PIO_STATUS_BLOCK IoStatusBlock,
+                     IN FILE_SEGMENT_ELEMENT BufferDescription[],
+                     IN ULONG Length,
+                     IN PLARGE_INTEGER ByteOffset OPTIONAL,
+                     IN PULONG Key OPTIONAL,
+                     IN BOOLEAN Write)
+{
+    NTSTATUS Status;
+    PFILE_OBJECT FileObject;
+    PIRP Irp;
+    PDEVICE_OBJECT DeviceObject;
+    PIO_STACK_LOCATION StackPtr;
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PKEVENT EventObject = NULL;
+    LARGE_INTEGER CapturedByteOffset;
+    ULONG CapturedKey = 0;
+    BOOLEAN Synchronous = FALSE;
+    PFILE_SEGMENT_ELEMENT Segments = NULL;
+    ULONG NumberOfPages, i;
+    PMDL Mdl;
+
+    PAGED_CODE();
+    CapturedByteOffset.QuadPart = 0;
+    IOTRACE(IO_API_DEBUG, "FileHandle: %p\n", FileHandle);
+
+    /* Get File Object */
+    Status = ObReferenceObjectByHandle(FileHandle,
+                                       Write ? FILE_WRITE_DATA : FILE_READ_DATA,
+                                       IoFileObjectType,
+                                       PreviousMode,
+                                       (PVOID*)&FileObject,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Get the device object */
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+
+    /*
+     * The segments are handed down to the driver in a single MDL, which is
+     * only possible for non-cached I/O, and the length must be sector aligned
+     */
+    if (!(FileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) ||
+        (DeviceObject->Flags & DO_BUFFERED_IO) ||
+        ((DeviceObject->SectorSize != 0) && (Length % DeviceObject->SectorSize != 0)))
+    {
+        /* Release the file object and and fail */
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Each segment describes one page */
+    NumberOfPages = BYTES_TO_PAGES(Length);
+    if (NumberOfPages != 0)
+    {
+        Segments = ExAllocatePoolWithTag(PagedPool,
+                                         NumberOfPages * sizeof(FILE_SEGMENT_ELEMENT),
+                                         TAG_IO);
+        if (!Segments)
+        {
+            ObDereferenceObject(FileObject);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    /* Validate User-Mode Buffers */
+    if (PreviousMode != KernelMode)
+    {
+        _SEH2_TRY
+        {
+            /* Probe the status block */
+            ProbeForWriteIoStatusBlock(IoStatusBlock);
+
+            /* Check if we got a byte offset */
+            if (ByteOffset)
+            {
+                /* Capture and probe it */
+                CapturedByteOffset = ProbeForReadLargeInteger(ByteOffset);
+            }
+
+            /* Capture and probe the key */
+            if (Key) CapturedKey = ProbeForReadUlong(Key);
+
+            /* Capture the segments, so that they can't change once checked */
+            ProbeForRead(BufferDescription,
+                         NumberOfPages * sizeof(FILE_SEGMENT_ELEMENT),
+                         TYPE_ALIGNMENT(FILE_SEGMENT_ELEMENT));
+            if (Segments)
+            {
+                RtlCopyMemory(Segments,
+                              BufferDescription,
+                              NumberOfPages * sizeof(FILE_SEGMENT_ELEMENT));
+            }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Release the file object and return the exception code */
+            if (Segments) ExFreePoolWithTag(Segments, TAG_IO);
+            ObDereferenceObject(FileObject);
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+    else
+    {
+        /* Kernel mode: capture directly */
+        if (ByteOffset) CapturedByteOffset = *ByteOffset;
+        if (Key) CapturedKey = *Key;
+        if (Segments)
+        {
+            RtlCopyMemory(Segments,
+                          BufferDescription,
+                          NumberOfPages * sizeof(FILE_SEGMENT_ELEMENT));
+        }
+    }
+
+    /* Every segment must be a whole page, and the offset sector aligned */
+    for (i = 0; i < NumberOfPages; i++)
+    {
+        if (((ULONG_PTR)Segments[i].Alignment != Segments[i].Alignment) ||
+            ((Segments[i].Alignment & (PAGE_SIZE - 1)) != 0))
+        {
+            break;
+        }
+    }
+
+    if ((i != NumberOfPages) ||
+        ((ByteOffset) &&
+         (DeviceObject->SectorSize != 0) &&
+         (CapturedByteOffset.QuadPart % DeviceObject->SectorSize != 0) &&
+         !((FileObject->Flags & FO_SYNCHRONOUS_IO) &&
+           (CapturedByteOffset.u.LowPart == FILE_USE_FILE_POINTER_POSITION) &&
+           (CapturedByteOffset.u.HighPart == -1))))
+    {
+        /* Release the file object and and fail */
+        if (Segments) ExFreePoolWithTag(Segments, TAG_IO);
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Check for event */
+    if (Event)
+    {
+        /* Reference it */
+        Status = ObReferenceObjectByHandle(Event,
+                                           EVENT_MODIFY_STATE,
+                                           ExEventObjectType,
+                                           PreviousMode,
+                                           (PVOID*)&EventObject,
+                                           NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            /* Fail */
+            if (Segments) ExFreePoolWithTag(Segments, TAG_IO);
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Otherwise reset the event */
+        KeClearEvent(EventObject);
+    }
+
+    /* Check if we should use Sync IO or not */
+    if (FileObject->Flags & FO_SYNCHRONOUS_IO)
+    {
+        /* Lock the file object */
+        Status = IopLockFileObject(FileObject, PreviousMode);
+        if (Status != STATUS_SUCCESS)
+        {
+            if (EventObject) ObDereferenceObject(EventObject);
+            if (Segments) ExFreePoolWithTag(Segments, TAG_IO);
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Check if we don't have a byte offset available */
+        if (!(ByteOffset) ||
+            ((CapturedByteOffset.u.LowPart == FILE_USE_FILE_POINTER_POSITION) &&
+             (CapturedByteOffset.u.HighPart == -1)))
+        {
+            /* Use the Current Byte Offset instead */
+            CapturedByteOffset = FileObject->CurrentByteOffset;
+        }
+
+        /* Remember we are sync */
+        Synchronous = TRUE;
+    }
+    else if (!ByteOffset)
+    {
+        /* Otherwise, this was async I/O without a byte offset, so fail */
+        if (EventObject) ObDereferenceObject(EventObject);
+        if (Segments) ExFreePoolWithTag(Segments, TAG_IO);
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Clear the File Object's event */
+    KeClearEvent(&FileObject->Event);
+
+    /* Allocate the IRP */
+    Irp = IoAllocateIrp(DeviceObject->StackSize, FALSE);
+    if (!Irp) return IopCleanupFailedIrp(FileObject, EventObject, Segments);
+
+    /* Set the IRP */
+    Irp->Tail.Overlay.OriginalFileObject = FileObject;
+    Irp->Tail.Overlay.Thread = PsGetCurrentThread();
+    Irp->RequestorMode = PreviousMode;
+    Irp->Overlay.AsynchronousParameters.UserApcRoutine = ApcRoutine;
+    Irp->Overlay.AsynchronousParameters.UserApcContext = ApcContext;
+    Irp->UserIosb = IoStatusBlock;
+    Irp->UserEvent = EventObject;
+    Irp->PendingReturned = FALSE;
+    Irp->Cancel = FALSE;
+    Irp->CancelRoutine = NULL;
+    Irp->AssociatedIrp.SystemBuffer = NULL;
+    Irp->MdlAddress = NULL;
+    Irp->UserBuffer = NULL;
+
+    /* Set the Stack Data, read and write parameters are laid out the same */
+    StackPtr = IoGetNextIrpStackLocation(Irp);
+    StackPtr->MajorFunction = Write ? IRP_MJ_WRITE : IRP_MJ_READ;
+    StackPtr->FileObject = FileObject;
+    StackPtr->Parameters.Read.Key = CapturedKey;
+    StackPtr->Parameters.Read.Length = Length;
+    StackPtr->Parameters.Read.ByteOffset = CapturedByteOffset;
+
+    /* Check if we have a buffer length */
+    if (Length)
+    {
+        _SEH2_TRY
+        {
+            /* Allocate a single MDL and lock every page into it */
+            Mdl = IoAllocateMdl((PVOID)(ULONG_PTR)Segments[0].Alignment,
+                                Length,
+                                FALSE,
+                                TRUE,
+                                Irp);
+            if (!Mdl)
+                ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+            MmProbeAndLockSelectedPages(Mdl,
+                                        Segments,
+                                        PreviousMode,
+                                        Write ? IoReadAccess : IoWriteAccess);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Allocating failed, clean up and return the exception code */
+            ExFreePoolWithTag(Segments, TAG_IO);
+            IopCleanupAfterException(FileObject, Irp, EventObject, NULL);
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+
+        /*
+         * Only the MDL describes the data, the user buffer is set to its
+         * virtual address for drivers building partial MDLs out of it
+         */
+        Irp->UserBuffer = MmGetMdlVirtualAddress(Mdl);
+        ExFreePoolWithTag(Segments, TAG_IO);
+    }
+
+    /* Now set the deferred I/O flags */
+    Irp->Flags = (Write ? IRP_WRITE_OPERATION : IRP_READ_OPERATION) |
+                 IRP_NOCACHE |
+                 IRP_DEFER_IO_COMPLETION;
+
+    /* Perform the call */
+    return IopPerformSynchronousRequest(DeviceObject,
+                                        Irp,
+                                        FileObject,
+                                        TRUE,
+                                        PreviousMode,
+                                        Synchronous,
+                                        Write ? IopWriteTransfer : IopReadTransfer);
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -3002,7 +3283,7 @@ NtReadFile(IN HANDLE FileHandle,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
@@ -3016,8 +3297,17 @@ NtReadFileScatter(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER  ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Each segment is a page-aligned, page-sized buffer */
+    return IopScatterGatherFile(FileHandle,
+                                Event,
+                                UserApcRoutine,
+                                UserApcContext,
+                                UserIoStatusBlock,
+                                BufferDescription,
+                                BufferLength,
+                                ByteOffset,
+                                Key,
+                                FALSE);
 }
 
 /*
@@ -4060,6 +4350,9 @@ NtWriteFile(IN HANDLE FileHandle,
                                         IopWriteTransfer);
 }
 
+/*
+ * @implemented
+ */
 NTSTATUS
 NTAPI
 NtWriteFileGather(IN HANDLE FileHandle,
@@ -4072,8 +4365,17 @@ NtWriteFileGather(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Each segment is a page-aligned, page-sized buffer */
+    return IopScatterGatherFile(FileHandle,
+                                Event,
+                                UserApcRoutine,
+                                UserApcContext,
+                                UserIoStatusBlock,
+                                BufferDescription,
+                                BufferLength,
+                                ByteOffset,
+                                Key,
+                                TRUE);
 }
 
 /*
@@ -372,6 +372,147 @@ MiUnmapLockedPagesInUserSpace(
     ExFreePoolWithTag(Vad, 'ldaV');
 }
 
+#ifndef NEWCC
+/* Largest paging read issued for a prefetch, in cache views */
+#define MI_PREFETCH_MAX_VIEWS 4
+#define MI_PREFETCH_MAX_PAGES (MI_PREFETCH_MAX_VIEWS * (VACB_MAPPING_GRANULARITY / PAGE_SIZE))
+
+static
+VOID
+MiPrefetchVacbs(
+    _In_ PROS_SHARED_CACHE_MAP SharedCacheMap,
+    _In_reads_(VacbCount) PROS_VACB *Vacbs,
+    _In_ ULONG VacbCount,
+    _Out_writes_(MI_PREFETCH_MAX_PAGES) PFILE_SEGMENT_ELEMENT SegmentArray)
+{
+    LONGLONG FileOffset = Vacbs[0]->FileOffset.QuadPart;
+    LONGLONG Size;
+    ULONG PageCount = 0, Pages, i, j;
+    IO_STATUS_BLOCK IoStatus;
+    NTSTATUS Status;
+    KEVENT Event;
+    PMDL Mdl;
+
+    /* The views are contiguous in the file, but not in memory */
+    for (i = 0; i < VacbCount; i++)
+    {
+        Size = SharedCacheMap->SectionSize.QuadPart - Vacbs[i]->FileOffset.QuadPart;
+        Pages = (ULONG)BYTES_TO_PAGES(min(Size, VACB_MAPPING_GRANULARITY));
+        for (j = 0; j < Pages; j++)
+        {
+            SegmentArray[PageCount++].Alignment = (ULONG_PTR)Vacbs[i]->BaseAddress + j * PAGE_SIZE;
+        }
+    }
+
+    Status = STATUS_INSUFFICIENT_RESOURCES;
+    Mdl = IoAllocateMdl(Vacbs[0]->BaseAddress, PageCount * PAGE_SIZE, FALSE, FALSE, NULL);
+    if (Mdl)
+    {
+        _SEH2_TRY
+        {
+            MmProbeAndLockSelectedPages(Mdl, SegmentArray, KernelMode, IoWriteAccess);
+            Status = STATUS_SUCCESS;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+
+        if (NT_SUCCESS(Status))
+        {
+            /* One paging read for all the views */
+            Mdl->MdlFlags |= MDL_IO_PAGE_READ;
+            KeInitializeEvent(&Event, NotificationEvent, FALSE);
+            Status = IoPageRead(SharedCacheMap->FileObject, Mdl, &Vacbs[0]->FileOffset, &Event, &IoStatus);
+            if (Status == STATUS_PENDING)
+            {
+                KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
+                Status = IoStatus.Status;
+            }
+
+            MmUnlockPages(Mdl);
+        }
+
+        IoFreeMdl(Mdl);
+    }
+
+    if (Status == STATUS_END_OF_FILE) Status = STATUS_SUCCESS;
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Prefetch of %I64x failed with %lx\n", FileOffset, Status);
+    }
+
+    for (i = 0; i < VacbCount; i++)
+    {
+        /* Zero the part of the last view that is past the end of the file */
+        Size = SharedCacheMap->SectionSize.QuadPart - Vacbs[i]->FileOffset.QuadPart;
+        if (NT_SUCCESS(Status) && Size < VACB_MAPPING_GRANULARITY)
+        {
+            Size = ROUND_TO_PAGES(Size);
+            RtlZeroMemory((PUCHAR)Vacbs[i]->BaseAddress + Size, VACB_MAPPING_GRANULARITY - (ULONG)Size);
+        }
+
+        CcRosReleaseVacb(SharedCacheMap, Vacbs[i], NT_SUCCESS(Status), FALSE, FALSE);
+    }
+}
+
+static
+VOID
+MiPrefetchViews(
+    _In_ PROS_SHARED_CACHE_MAP SharedCacheMap,
+    _In_ ULONGLONG FirstView,
+    _In_ ULONGLONG NumberOfViews,
+    _Out_writes_(MI_PREFETCH_MAX_PAGES) PFILE_SEGMENT_ELEMENT SegmentArray)
+{
+    PROS_VACB Vacbs[MI_PREFETCH_MAX_VIEWS];
+    LONGLONG BaseOffset;
+    ULONG VacbCount = 0;
+    PVOID BaseAddress;
+    BOOLEAN UptoDate;
+    NTSTATUS Status;
+    PROS_VACB Vacb;
+
+    for (; NumberOfViews != 0; FirstView++, NumberOfViews--)
+    {
+        Status = CcRosGetVacb(SharedCacheMap,
+                              FirstView * VACB_MAPPING_GRANULARITY,
+                              &BaseOffset,
+                              &BaseAddress,
+                              &UptoDate,
+                              &Vacb);
+        if (!NT_SUCCESS(Status))
+        {
+            break;
+        }
+
+        if (UptoDate)
+        {
+            /* Already cached, the read can't go through it */
+            CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
+            if (VacbCount != 0)
+            {
+                MiPrefetchVacbs(SharedCacheMap, Vacbs, VacbCount, SegmentArray);
+                VacbCount = 0;
+            }
+            continue;
+        }
+
+        Vacbs[VacbCount++] = Vacb;
+        if (VacbCount == MI_PREFETCH_MAX_VIEWS)
+        {
+            MiPrefetchVacbs(SharedCacheMap, Vacbs, VacbCount, SegmentArray);
+            VacbCount = 0;
+        }
+    }
+
+    if (VacbCount != 0)
+    {
+        MiPrefetchVacbs(SharedCacheMap, Vacbs, VacbCount, SegmentArray);
+    }
+}
+#endif
+
 /* PUBLIC FUNCTIONS ***********************************************************/
 
 /*
@@ -1652,15 +1793,89 @@ MmUnmapReservedMapping(IN PVOID BaseAddress,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
 MmPrefetchPages(IN ULONG NumberOfLists,
                 IN PREAD_LIST *ReadLists)
 {
+#ifndef NEWCC
+    PROS_SHARED_CACHE_MAP SharedCacheMap;
+    PFILE_SEGMENT_ELEMENT SegmentArray;
+    ULONGLONG FirstView, NumberOfViews, View = 0;
+    PFILE_OBJECT FileObject;
+    PREAD_LIST ReadList;
+    ULONG i, j;
+
+    PAGED_CODE();
+
+    SegmentArray = ExAllocatePoolWithTag(PagedPool,
+                                         MI_PREFETCH_MAX_PAGES * sizeof(FILE_SEGMENT_ELEMENT),
+                                         TAG_MM);
+    if (!SegmentArray) return STATUS_INSUFFICIENT_RESOURCES;
+
+    for (i = 0; i < NumberOfLists; i++)
+    {
+        ReadList = ReadLists[i];
+        FileObject = ReadList->FileObject;
+
+        //
+        // Both data and image sections page in through the file cache, so
+        // that is where the pages go. Nothing maps them until they fault.
+        //
+        if (!FileObject->SectionObjectPointer ||
+            !FileObject->SectionObjectPointer->SharedCacheMap)
+        {
+            DPRINT("%wZ is not cached, skipping\n", &FileObject->FileName);
+            continue;
+        }
+
+        CcRosReferenceCache(FileObject);
+        SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
+
+        //
+        // Offsets in the same or in adjacent views are read together
+        //
+        FirstView = NumberOfViews = 0;
+        for (j = 0; j <= ReadList->NumberOfEntries; j++)
+        {
+            if (j < ReadList->NumberOfEntries)
+            {
+                if ((LONGLONG)ReadList->List[j].Alignment >= SharedCacheMap->SectionSize.QuadPart)
+                    continue;
+
+                View = ReadList->List[j].Alignment / VACB_MAPPING_GRANULARITY;
+                if (NumberOfViews != 0 &&
+                    View >= FirstView &&
+                    View <= FirstView + NumberOfViews)
+                {
+                    NumberOfViews = max(NumberOfViews, View - FirstView + 1);
+                    continue;
+                }
+            }
+
+            if (NumberOfViews != 0)
+            {
+                MiPrefetchViews(SharedCacheMap, FirstView, NumberOfViews, SegmentArray);
+            }
+
+            if (j < ReadList->NumberOfEntries)
+            {
+                FirstView = View;
+                NumberOfViews = 1;
+            }
+        }
+
+        CcRosDereferenceCache(FileObject);
+    }
+
+    ExFreePoolWithTag(SegmentArray, TAG_MM);
+    return STATUS_SUCCESS;
+#else
     UNIMPLEMENTED;
     return STATUS_NOT_IMPLEMENTED;
+#endif
 }
 
 /*
@@ -1690,16 +1905,79 @@ MmProbeAndLockProcessPages(IN OUT PMDL MemoryDescriptorList,
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
 MmProbeAndLockSelectedPages(IN OUT PMDL MemoryDescriptorList,
-                            IN LARGE_INTEGER PageList[],
+                            IN PFILE_SEGMENT_ELEMENT SegmentArray,
                             IN KPROCESSOR_MODE AccessMode,
                             IN LOCK_OPERATION Operation)
 {
-    UNIMPLEMENTED;
+    PFN_NUMBER MdlBuffer[(sizeof(MDL) / sizeof(PFN_NUMBER)) + 1];
+    PMDL PageMdl = (PMDL)MdlBuffer;
+    PPFN_NUMBER MdlPages;
+    ULONG PageCount, ByteCount, i;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    //
+    // Sanity checks
+    //
+    ASSERT(MemoryDescriptorList->ByteCount != 0);
+    ASSERT(MemoryDescriptorList->ByteOffset == 0);
+    ASSERT((MemoryDescriptorList->MdlFlags & (MDL_PAGES_LOCKED |
+                                              MDL_MAPPED_TO_SYSTEM_VA |
+                                              MDL_SOURCE_IS_NONPAGED_POOL |
+                                              MDL_PARTIAL |
+                                              MDL_IO_SPACE)) == 0);
+
+    MdlPages = MmGetMdlPfnArray(MemoryDescriptorList);
+    PageCount = BYTES_TO_PAGES(MemoryDescriptorList->ByteCount);
+
+    //
+    // The pages can be anywhere, probe and lock them one by one
+    //
+    for (i = 0; i < PageCount; i++)
+    {
+        ASSERT((SegmentArray[i].Alignment & (PAGE_SIZE - 1)) == 0);
+        MmInitializeMdl(PageMdl, (PVOID)(ULONG_PTR)SegmentArray[i].Alignment, PAGE_SIZE);
+
+        _SEH2_TRY
+        {
+            MmProbeAndLockPages(PageMdl, AccessMode, Operation);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+
+        if (!NT_SUCCESS(Status)) break;
+
+        //
+        // The big MDL now owns the lock on this page
+        //
+        MdlPages[i] = *MmGetMdlPfnArray(PageMdl);
+        MemoryDescriptorList->MdlFlags |= PageMdl->MdlFlags & (MDL_PAGES_LOCKED |
+                                                               MDL_WRITE_OPERATION |
+                                                               MDL_IO_SPACE);
+        MemoryDescriptorList->Process = PageMdl->Process;
+    }
+
+    if (NT_SUCCESS(Status)) return;
+
+    //
+    // Unlock what we locked so far, and raise the error
+    //
+    if (i != 0)
+    {
+        ByteCount = MemoryDescriptorList->ByteCount;
+        MemoryDescriptorList->ByteCount = i * PAGE_SIZE;
+        MmUnlockPages(MemoryDescriptorList);
+        MemoryDescriptorList->ByteCount = ByteCount;
+    }
+
+    ExRaiseStatus(Status);
 }
 
 /*
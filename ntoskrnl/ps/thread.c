@@ -65,7 +65,12 @@ PspUserThreadStartup(IN PKSTART_ROUTINE StartRoutine,
         /* Check if the Prefetcher is enabled */
         if (CcPfEnablePrefetcher)
         {
-            /* FIXME: Prepare to prefetch this process */
+            /* Prepare to prefetch this process, for its first thread only */
+            if (!(PspSetProcessFlag(Thread->ThreadsProcess, PSF_LAUNCH_PREFETCHED_BIT) &
+                  PSF_LAUNCH_PREFETCHED_BIT))
+            {
+                CcPfBeginAppLaunch(Thread->ThreadsProcess, NULL);
+            }
         }
 
         /* Raise to APC */
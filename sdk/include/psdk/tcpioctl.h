@@ -99,6 +99,7 @@
 
 /* TCP connection options */
 #define TCP_SOCKET_NODELAY 1
+#define TCP_SOCKET_WINDOW  6
 
 typedef struct IFEntry
 {
@@ -59,6 +59,32 @@ typedef struct _AFD_POLL_INFO {
     AFD_HANDLE			        Handles[1];
 } AFD_POLL_INFO, *PAFD_POLL_INFO;
 
+/* Persistent poll sets (ReactOS specific). Sockets are registered once
+ * on an AFD handle with IOCTL_AFD_POLL_SET_CONTROL, then the ready ones
+ * are harvested with IOCTL_AFD_POLL_SET_WAIT as often as needed */
+#define AFD_POLL_SET_ADD		1
+#define AFD_POLL_SET_MODIFY		2
+#define AFD_POLL_SET_REMOVE		3
+
+typedef struct _AFD_POLL_SET_CONTROL_INFO {
+    ULONG				Operation;
+    SOCKET				Handle;
+    ULONG				Events;
+    PVOID				Context;
+} AFD_POLL_SET_CONTROL_INFO, *PAFD_POLL_SET_CONTROL_INFO;
+
+typedef struct _AFD_POLL_SET_ENTRY {
+    SOCKET				Handle;
+    ULONG				Events;
+    PVOID				Context;
+} AFD_POLL_SET_ENTRY, *PAFD_POLL_SET_ENTRY;
+
+typedef struct _AFD_POLL_SET_WAIT_INFO {
+    LARGE_INTEGER		        Timeout;
+    ULONG				EntryCount;
+    AFD_POLL_SET_ENTRY			Entries[1];
+} AFD_POLL_SET_WAIT_INFO, *PAFD_POLL_SET_WAIT_INFO;
+
 typedef struct _AFD_ACCEPT_DATA {
     ULONG				UseSAN;
     ULONG				SequenceNumber;
@@ -261,6 +287,8 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define AFD_DEFER_ACCEPT		35
 #define AFD_GET_PENDING_CONNECT_DATA	41
 #define AFD_VALIDATE_GROUP		42
+#define AFD_POLL_SET_CONTROL		60
+#define AFD_POLL_SET_WAIT		61
 
 /* AFD IOCTLs */
 
@@ -336,6 +364,10 @@ typedef struct _AFD_TDI_HANDLE_DATA
   _AFD_CONTROL_CODE(AFD_ENUM_NETWORK_EVENTS, METHOD_NEITHER)
 #define IOCTL_AFD_VALIDATE_GROUP \
   _AFD_CONTROL_CODE(AFD_VALIDATE_GROUP, METHOD_NEITHER)
+#define IOCTL_AFD_POLL_SET_CONTROL \
+  _AFD_CONTROL_CODE(AFD_POLL_SET_CONTROL, METHOD_BUFFERED)
+#define IOCTL_AFD_POLL_SET_WAIT \
+  _AFD_CONTROL_CODE(AFD_POLL_SET_WAIT, METHOD_BUFFERED)
 
 typedef struct _AFD_SOCKET_INFORMATION {
     BOOL CommandChannel;
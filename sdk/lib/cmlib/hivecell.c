@@ -171,25 +171,47 @@ HvpComputeFreeListIndex(
     return Index;
 }
 
+/*
+ * Free cells are kept on doubly linked lists, one per size class, so that
+ * they can be unlinked without walking the list. The links live in the
+ * cell data, and FreeSummary has a bit set for each non empty list.
+ */
+typedef struct _HCELL_FREE_LINKS
+{
+    HCELL_INDEX Next;
+    HCELL_INDEX Prev;
+} HCELL_FREE_LINKS, *PHCELL_FREE_LINKS;
+
+/* Smaller free cells can't hold the links, and are never allocated anyway */
+#define HCELL_MIN_FREE_SIZE (sizeof(HCELL) + sizeof(HCELL_FREE_LINKS))
+
 static NTSTATUS CMAPI
 HvpAddFree(
     PHHIVE RegistryHive,
     PHCELL FreeBlock,
     HCELL_INDEX FreeIndex)
 {
-    PHCELL_INDEX FreeBlockData;
+    PHCELL_FREE_LINKS FreeLinks;
     HSTORAGE_TYPE Storage;
     ULONG Index;
 
     ASSERT(RegistryHive != NULL);
     ASSERT(FreeBlock != NULL);
 
+    if ((ULONG)FreeBlock->Size < HCELL_MIN_FREE_SIZE)
+        return STATUS_SUCCESS;
+
     Storage = HvGetCellType(FreeIndex);
     Index = HvpComputeFreeListIndex((ULONG)FreeBlock->Size);
 
-    FreeBlockData = (PHCELL_INDEX)(FreeBlock + 1);
-    *FreeBlockData = RegistryHive->Storage[Storage].FreeDisplay[Index];
+    FreeLinks = (PHCELL_FREE_LINKS)(FreeBlock + 1);
+    FreeLinks->Next = RegistryHive->Storage[Storage].FreeDisplay[Index];
+    FreeLinks->Prev = HCELL_NIL;
+    if (FreeLinks->Next != HCELL_NIL)
+        ((PHCELL_FREE_LINKS)HvGetCell(RegistryHive, FreeLinks->Next))->Prev = FreeIndex;
+
     RegistryHive->Storage[Storage].FreeDisplay[Index] = FreeIndex;
+    RegistryHive->Storage[Storage].FreeSummary |= (1 << Index);
 
     /* FIXME: Eventually get rid of free bins. */
 
@@ -202,47 +224,33 @@ HvpRemoveFree(
     PHCELL CellBlock,
     HCELL_INDEX CellIndex)
 {
-    PHCELL_INDEX FreeCellData;
-    PHCELL_INDEX pFreeCellOffset;
+    PHCELL_FREE_LINKS FreeLinks;
     HSTORAGE_TYPE Storage;
-    ULONG Index, FreeListIndex;
+    ULONG Index;
 
     ASSERT(RegistryHive->ReadOnly == FALSE);
 
+    if ((ULONG)CellBlock->Size < HCELL_MIN_FREE_SIZE)
+        return;
+
     Storage = HvGetCellType(CellIndex);
     Index = HvpComputeFreeListIndex((ULONG)CellBlock->Size);
+    FreeLinks = (PHCELL_FREE_LINKS)(CellBlock + 1);
 
-    pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[Index];
-    while (*pFreeCellOffset != HCELL_NIL)
+    if (FreeLinks->Prev != HCELL_NIL)
     {
-        FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-        if (*pFreeCellOffset == CellIndex)
-        {
-            *pFreeCellOffset = *FreeCellData;
-            return;
-        }
-        pFreeCellOffset = FreeCellData;
+        ((PHCELL_FREE_LINKS)HvGetCell(RegistryHive, FreeLinks->Prev))->Next = FreeLinks->Next;
     }
-
-    /* Something bad happened, print a useful trace info and bugcheck */
-    CMLTRACE(CMLIB_HCELL_DEBUG, "-- beginning of HvpRemoveFree trace --\n");
-    CMLTRACE(CMLIB_HCELL_DEBUG, "block we are about to free: %08x\n", CellIndex);
-    CMLTRACE(CMLIB_HCELL_DEBUG, "chosen free list index: %u\n", Index);
-    for (FreeListIndex = 0; FreeListIndex < 24; FreeListIndex++)
+    else
     {
-        CMLTRACE(CMLIB_HCELL_DEBUG, "free list [%u]: ", FreeListIndex);
-        pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[FreeListIndex];
-        while (*pFreeCellOffset != HCELL_NIL)
-        {
-            CMLTRACE(CMLIB_HCELL_DEBUG, "%08x ", *pFreeCellOffset);
-            FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-            pFreeCellOffset = FreeCellData;
-        }
-        CMLTRACE(CMLIB_HCELL_DEBUG, "\n");
+        ASSERT(RegistryHive->Storage[Storage].FreeDisplay[Index] == CellIndex);
+        RegistryHive->Storage[Storage].FreeDisplay[Index] = FreeLinks->Next;
+        if (FreeLinks->Next == HCELL_NIL)
+            RegistryHive->Storage[Storage].FreeSummary &= ~(1 << Index);
     }
-    CMLTRACE(CMLIB_HCELL_DEBUG, "-- end of HvpRemoveFree trace --\n");
 
-    ASSERT(FALSE);
+    if (FreeLinks->Next != HCELL_NIL)
+        ((PHCELL_FREE_LINKS)HvGetCell(RegistryHive, FreeLinks->Next))->Prev = FreeLinks->Prev;
 }
 
 static HCELL_INDEX CMAPI
@@ -251,28 +259,49 @@ HvpFindFree(
     ULONG Size,
     HSTORAGE_TYPE Storage)
 {
-    PHCELL_INDEX FreeCellData;
+    PHCELL_FREE_LINKS FreeLinks;
     HCELL_INDEX FreeCellOffset;
-    PHCELL_INDEX pFreeCellOffset;
-    ULONG Index;
+    ULONG Summary, Index, FirstIndex;
+
+    FirstIndex = HvpComputeFreeListIndex(Size);
+    Summary = RegistryHive->Storage[Storage].FreeSummary;
+
+    /*
+     * The small lists hold cells of a single size, any larger list only
+     * holds cells that are big enough, so the first cell is taken. Only
+     * the list of our own size class may have to be searched.
+     */
+    FreeCellOffset = RegistryHive->Storage[Storage].FreeDisplay[FirstIndex];
+    if (FreeCellOffset != HCELL_NIL &&
+        (ULONG)HvpGetCellFullSize(RegistryHive, HvGetCell(RegistryHive, FreeCellOffset)) >= Size)
+    {
+        goto Found;
+    }
 
-    for (Index = HvpComputeFreeListIndex(Size); Index < 24; Index++)
+    Summary &= ~((2 << FirstIndex) - 1);
+    for (Index = FirstIndex + 1; Summary != 0; Index++)
     {
-        pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[Index];
-        while (*pFreeCellOffset != HCELL_NIL)
+        if (Summary & (1 << Index))
         {
-            FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-            if ((ULONG)HvpGetCellFullSize(RegistryHive, FreeCellData) >= Size)
-            {
-                FreeCellOffset = *pFreeCellOffset;
-                *pFreeCellOffset = *FreeCellData;
-                return FreeCellOffset;
-            }
-            pFreeCellOffset = FreeCellData;
+            FreeCellOffset = RegistryHive->Storage[Storage].FreeDisplay[Index];
+            goto Found;
         }
     }
 
+    while (FreeCellOffset != HCELL_NIL)
+    {
+        FreeLinks = (PHCELL_FREE_LINKS)HvGetCell(RegistryHive, FreeCellOffset);
+        if ((ULONG)HvpGetCellFullSize(RegistryHive, FreeLinks) >= Size)
+            goto Found;
+
+        FreeCellOffset = FreeLinks->Next;
+    }
+
     return HCELL_NIL;
+
+Found:
+    HvpRemoveFree(RegistryHive, HvpGetCellHeader(RegistryHive, FreeCellOffset), FreeCellOffset);
+    return FreeCellOffset;
 }
 
 NTSTATUS CMAPI
@@ -293,6 +322,8 @@ HvpCreateHiveFreeCellList(
         Hive->Storage[Stable].FreeDisplay[Index] = HCELL_NIL;
         Hive->Storage[Volatile].FreeDisplay[Index] = HCELL_NIL;
     }
+    Hive->Storage[Stable].FreeSummary = 0;
+    Hive->Storage[Volatile].FreeSummary = 0;
 
     BlockOffset = 0;
     BlockIndex = 0;
@@ -202,6 +202,8 @@ HvpCreateHive(
         RegistryHive->Storage[Stable].FreeDisplay[Index] = HCELL_NIL;
         RegistryHive->Storage[Volatile].FreeDisplay[Index] = HCELL_NIL;
     }
+    RegistryHive->Storage[Stable].FreeSummary = 0;
+    RegistryHive->Storage[Volatile].FreeSummary = 0;
 
     HvpInitFileName(BaseBlock, FileName);
 
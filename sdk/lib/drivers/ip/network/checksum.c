@@ -9,7 +9,22 @@
  *   CSH 01/08-2000 Created
  */
 
+#ifndef CHECKSUM_HOST
 #include "precomp.h"
+#else
+#include <string.h>
+#include <checksum.h>
+#endif
+
+/*
+ * The sum is built in a 64-bit accumulator from aligned 32-bit loads, so
+ * there are no carries to handle in the loop. Since the one's complement
+ * sum doesn't depend on byte order, it is the same as the 16-bit sum in
+ * host byte order that RFC 1071 describes, once folded.
+ */
+
+/* Number of bytes summed per loop iteration */
+#define CHECKSUM_BLOCK (8 * sizeof(ULONG))
 
 
 ULONG ChecksumFold(
@@ -24,6 +39,90 @@ ULONG ChecksumFold(
   return Sum;
 }
 
+static ULONG ChecksumFold64(
+  ULONGLONG Sum)
+{
+  /* Fold 64-bit sum to 16 bits */
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+
+  return ChecksumFold((ULONG)Sum);
+}
+
+static ULONGLONG ChecksumBlocks(
+  const ULONG *Data,
+  UINT Count,
+  ULONGLONG Sum)
+/*
+ * FUNCTION: Sums the 32-bit words of an aligned buffer
+ * ARGUMENTS:
+ *     Data  = Pointer to buffer, 32-bit aligned
+ *     Count = Number of 32-bit words in buffer
+ *     Sum   = Sum to add to
+ * RETURNS:
+ *     Unfolded sum
+ */
+{
+  while (Count >= 8)
+    {
+      Sum += (ULONGLONG)Data[0] + Data[1] + Data[2] + Data[3];
+      Sum += (ULONGLONG)Data[4] + Data[5] + Data[6] + Data[7];
+      Data += 8;
+      Count -= 8;
+    }
+
+  while (Count--)
+    {
+      Sum += *Data++;
+    }
+
+  return Sum;
+}
+
+static ULONGLONG ChecksumCopyBlocks(
+  ULONG *Destination,
+  const ULONG *Source,
+  UINT Count,
+  ULONGLONG Sum)
+/*
+ * FUNCTION: Copies and sums the 32-bit words of an aligned buffer
+ * ARGUMENTS:
+ *     Destination = Pointer to destination buffer, 32-bit aligned
+ *     Source      = Pointer to source buffer, 32-bit aligned
+ *     Count       = Number of 32-bit words to copy
+ *     Sum         = Sum to add to
+ * RETURNS:
+ *     Unfolded sum
+ */
+{
+  ULONG Word0, Word1, Word2, Word3;
+
+  while (Count >= 4)
+    {
+      Word0 = Source[0];
+      Word1 = Source[1];
+      Word2 = Source[2];
+      Word3 = Source[3];
+      Destination[0] = Word0;
+      Destination[1] = Word1;
+      Destination[2] = Word2;
+      Destination[3] = Word3;
+      Sum += (ULONGLONG)Word0 + Word1 + Word2 + Word3;
+      Source += 4;
+      Destination += 4;
+      Count -= 4;
+    }
+
+  while (Count--)
+    {
+      Word0 = *Source++;
+      *Destination++ = Word0;
+      Sum += Word0;
+    }
+
+  return Sum;
+}
+
 ULONG ChecksumCompute(
   PVOID Data,
   UINT Count,
@@ -36,70 +135,169 @@ ULONG ChecksumCompute(
  *     Seed  = Previously calculated checksum (if any)
  * RETURNS:
  *     Checksum of buffer
+ * NOTES:
+ *     The result is not folded, but won't overflow when used as the
+ *     seed of further calls
  */
 {
-  register ULONG Sum = Seed;
+  PUCHAR Buffer = Data;
+  ULONGLONG Sum = 0;
+  BOOLEAN Swapped = FALSE;
+  ULONG Result;
+
+  if (Count == 0)
+    return Seed;
+
+  /* On an odd address, every byte ends up in the other half of its
+     16-bit word. Sum them that way and swap the result back */
+  if ((ULONG_PTR)Buffer & 1)
+    {
+      Sum = (ULONG)*Buffer << 8;
+      Buffer++;
+      Count--;
+      Swapped = TRUE;
+    }
+
+  if (((ULONG_PTR)Buffer & 2) && Count >= 2)
+    {
+      Sum += *(PUSHORT)Buffer;
+      Buffer += 2;
+      Count -= 2;
+    }
+
+  Sum = ChecksumBlocks((const ULONG *)Buffer, Count / 4, Sum);
+  Buffer += Count & ~3;
+  Count &= 3;
 
-  while (Count > 1)
+  /* Add left-over word and byte, if any */
+  if (Count >= 2)
     {
-      Sum += *(PUSHORT)Data;
+      Sum += *(PUSHORT)Buffer;
+      Buffer += 2;
       Count -= 2;
-      Data = (PVOID)((ULONG_PTR) Data + 2);
     }
 
-  /* Add left-over byte, if any */
   if (Count > 0)
     {
-      Sum += *(PUCHAR)Data;
+      Sum += *Buffer;
     }
 
-  return Sum;
+  Result = ChecksumFold64(Sum);
+  if (Swapped)
+    Result = ((Result & 0xFF) << 8) | (Result >> 8);
+
+  return Seed + Result;
 }
 
+ULONG ChecksumCopy(
+  PVOID Destination,
+  PVOID Source,
+  UINT Count,
+  ULONG Seed)
+/*
+ * FUNCTION: Copies a buffer and calculates its checksum in one pass
+ * ARGUMENTS:
+ *     Destination = Pointer to buffer to copy to
+ *     Source      = Pointer to buffer with data
+ *     Count       = Number of bytes to copy
+ *     Seed        = Previously calculated checksum (if any)
+ * RETURNS:
+ *     Checksum of buffer, same as ChecksumCompute would return
+ */
+{
+  PUCHAR Dst = Destination, Src = Source;
+  ULONGLONG Sum = 0;
+  BOOLEAN Swapped = FALSE;
+  ULONG Result;
+
+  /* Small copies, and buffers that can't both be aligned, aren't worth it */
+  if (Count < CHECKSUM_BLOCK ||
+      (((ULONG_PTR)Dst ^ (ULONG_PTR)Src) & 3))
+    {
+      RtlCopyMemory(Destination, Source, Count);
+      return ChecksumCompute(Destination, Count, Seed);
+    }
+
+  if ((ULONG_PTR)Src & 1)
+    {
+      Sum = (ULONG)*Src << 8;
+      *Dst++ = *Src++;
+      Count--;
+      Swapped = TRUE;
+    }
+
+  if ((ULONG_PTR)Src & 2)
+    {
+      Sum += *(PUSHORT)Src;
+      *(PUSHORT)Dst = *(PUSHORT)Src;
+      Src += 2;
+      Dst += 2;
+      Count -= 2;
+    }
+
+  Sum = ChecksumCopyBlocks((ULONG *)Dst, (const ULONG *)Src, Count / 4, Sum);
+  Src += Count & ~3;
+  Dst += Count & ~3;
+  Count &= 3;
+
+  if (Count >= 2)
+    {
+      Sum += *(PUSHORT)Src;
+      *(PUSHORT)Dst = *(PUSHORT)Src;
+      Src += 2;
+      Dst += 2;
+      Count -= 2;
+    }
+
+  if (Count > 0)
+    {
+      Sum += *Src;
+      *Dst = *Src;
+    }
+
+  Result = ChecksumFold64(Sum);
+  if (Swapped)
+    Result = ((Result & 0xFF) << 8) | (Result >> 8);
+
+  return Seed + Result;
+}
+
+#ifndef CHECKSUM_HOST
+
 ULONG
-UDPv4ChecksumCalculate(
+UDPv4ChecksumComplete(
   PIPv4_HEADER IPHeader,
-  PUCHAR PacketBuffer,
+  ULONG Sum,
   ULONG DataLength)
+/*
+ * FUNCTION: Finishes the checksum of an UDP datagram
+ * ARGUMENTS:
+ *     IPHeader   = Pointer to IPv4 header of the datagram
+ *     Sum        = Checksum of the UDP header and data
+ *     DataLength = Length of the UDP header and data
+ * RETURNS:
+ *     One's complement of the checksum, in host byte order
+ */
 {
-  ULONG Sum = 0;
-  USHORT TmpSum;
-  ULONG i;
-  BOOLEAN Pad;
-
-  /* Pad the data if needed */
-  Pad = (DataLength & 1);
-  if (Pad)
-      DataLength++;
-
-  /* Add from the UDP header and data */
-  for (i = 0; i < DataLength; i += 2)
-  {
-       TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
-                ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i+1] & 0x00FF));
-       Sum += TmpSum;
-  }
-
-  /* Add the source address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->SrcAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the destination address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->DstAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the proto number and length */
-  Sum += IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
+  /* Add the pseudo header, still in network byte order */
+  Sum += (IPHeader->SrcAddr & 0xFFFF) + (IPHeader->SrcAddr >> 16);
+  Sum += (IPHeader->DstAddr & 0xFFFF) + (IPHeader->DstAddr >> 16);
+  Sum += WH2N(IPPROTO_UDP) + WH2N(DataLength & 0xFFFF);
 
   /* Fold the checksum and return the one's complement */
-  return ~ChecksumFold(Sum);
+  Sum = ChecksumFold(Sum);
+  return ~(ULONG)WN2H(Sum);
+}
+
+ULONG
+UDPv4ChecksumCalculate(
+  PIPv4_HEADER IPHeader,
+  PUCHAR PacketBuffer,
+  ULONG DataLength)
+{
+  return UDPv4ChecksumComplete(IPHeader,
+                               ChecksumCompute(PacketBuffer, DataLength, 0),
+                               DataLength);
 }
 
+#endif /* CHECKSUM_HOST */
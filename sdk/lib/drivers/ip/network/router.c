@@ -17,6 +17,36 @@
 LIST_ENTRY FIBListHead;
 KSPIN_LOCK FIBLock;
 
+/* IPv4 routes indexed by prefix. Protected by FIBLock */
+ROUTE_TRIE FIBTrie;
+
+/* Incremented with FIBLock held whenever a route is added or removed */
+volatile LONG FIBGeneration;
+
+/*
+ * Most packets go to a destination that was routed to just before, so the
+ * results of RouterGetRoute are cached per destination. Lookups read the
+ * cache without taking FIBLock: an entry is only used when its sequence
+ * number is even and unchanged while it was read, and when no route was
+ * added or removed since it was stored.
+ */
+#define DEST_CACHE_SIZE 128 /* Must be a power of two */
+
+typedef struct _DEST_CACHE_ENTRY {
+    volatile LONG Sequence;     /* Odd while the entry is being written */
+    LONG Generation;            /* Value of FIBGeneration the entry is valid for */
+    ULONG Destination;          /* IPv4 address in network byte order */
+    PNEIGHBOR_CACHE_ENTRY NCE;  /* NCE of the router to use */
+} DEST_CACHE_ENTRY, *PDEST_CACHE_ENTRY;
+
+static DEST_CACHE_ENTRY DestCache[DEST_CACHE_SIZE];
+
+#define DEST_CACHE_HASH(Address) \
+    (((Address) ^ ((Address) >> 7) ^ ((Address) >> 15) ^ ((Address) >> 24)) & \
+     (DEST_CACHE_SIZE - 1))
+
+#define NCE_USABLE(NCE) (!((NCE)->State & (NUD_STALE | NUD_INCOMPLETE)))
+
 void RouterDumpRoutes() {
     PLIST_ENTRY CurrentEntry;
     PLIST_ENTRY NextEntry;
@@ -69,6 +99,15 @@ VOID DestroyFIBE(
     /* Unlink the FIB entry from the list */
     RemoveEntryList(&FIBE->ListEntry);
 
+    /* And from the trie, which drops the prefix if it has no other routes */
+    if (FIBE->Node) {
+        RemoveEntryList(&FIBE->PrefixListEntry);
+        RouteTrieRemove(&FIBTrie, FIBE->Node);
+    }
+
+    /* Cached lookups may have returned this route */
+    InterlockedIncrement(&FIBGeneration);
+
     /* And free the FIB entry */
     FreeFIB(FIBE);
 }
@@ -139,50 +178,107 @@ UINT CopyFIBs( PIP_INTERFACE IF, PFIB_ENTRY Target ) {
 }
 
 
-UINT CommonPrefixLength(
-    PIP_ADDRESS Address1,
-    PIP_ADDRESS Address2)
+static PNEIGHBOR_CACHE_ENTRY DestCacheLookup(
+    ULONG Destination)
 /*
- * FUNCTION: Computes the length of the longest prefix common to two addresses
+ * FUNCTION: Looks up the router last used for a destination
  * ARGUMENTS:
- *     Address1 = Pointer to first address
- *     Address2 = Pointer to second address
- * NOTES:
- *     The two addresses must be of the same type
+ *     Destination = IPv4 address in network byte order
  * RETURNS:
- *     Length of longest common prefix
+ *     Pointer to NCE for router, NULL if the cache has no valid entry
+ * NOTES:
+ *     Doesn't need the forward information base lock
  */
 {
-    PUCHAR Addr1, Addr2;
-    UINT Size;
-    UINT i, j;
-    UINT Bitmask;
+    PDEST_CACHE_ENTRY Entry = &DestCache[DEST_CACHE_HASH(Destination)];
+    PNEIGHBOR_CACHE_ENTRY NCE;
+    LONG Sequence, Generation;
+    ULONG Address;
+
+    Sequence = Entry->Sequence;
+    if (Sequence & 1)
+        return NULL;
+
+    KeMemoryBarrier();
+
+    Address    = Entry->Destination;
+    Generation = Entry->Generation;
+    NCE        = Entry->NCE;
+
+    KeMemoryBarrier();
 
-    TI_DbgPrint(DEBUG_ROUTER, ("Called. Address1 (0x%X)  Address2 (0x%X).\n", Address1, Address2));
+    if (Entry->Sequence != Sequence || Address != Destination ||
+        Generation != FIBGeneration || !NCE)
+        return NULL;
 
-    /*TI_DbgPrint(DEBUG_ROUTER, ("Target  (%s) \n", A2S(Address1)));*/
-    /*TI_DbgPrint(DEBUG_ROUTER, ("Adapter (%s).\n", A2S(Address2)));*/
+    /* The router may have become unreachable since, let the FIB decide */
+    if (!NCE_USABLE(NCE))
+        return NULL;
 
-    if (Address1->Type == IP_ADDRESS_V4)
-        Size = sizeof(IPv4_RAW_ADDRESS);
-    else
-        Size = sizeof(IPv6_RAW_ADDRESS);
+    return NCE;
+}
 
-    Addr1 = (PUCHAR)&Address1->Address.IPv4Address;
-    Addr2 = (PUCHAR)&Address2->Address.IPv4Address;
 
-    /* Find first non-matching byte */
-    for (i = 0; i < Size && Addr1[i] == Addr2[i]; i++);
-    if( i == Size ) return 8 * i;
+static VOID DestCacheInsert(
+    ULONG Destination,
+    PNEIGHBOR_CACHE_ENTRY NCE)
+/*
+ * FUNCTION: Remembers the router to use for a destination
+ * ARGUMENTS:
+ *     Destination = IPv4 address in network byte order
+ *     NCE         = Pointer to NCE of router to use
+ * NOTES:
+ *     The forward information base lock must be held when called
+ */
+{
+    PDEST_CACHE_ENTRY Entry = &DestCache[DEST_CACHE_HASH(Destination)];
 
-    /* Find first non-matching bit */
-    Bitmask = 0x80;
-    for (j = 0; (Addr1[i] & Bitmask) == (Addr2[i] & Bitmask); j++)
-        Bitmask >>= 1;
+    InterlockedIncrement(&Entry->Sequence);
 
-    TI_DbgPrint(DEBUG_ROUTER, ("Returning %d\n", 8 * i + j));
+    Entry->Destination = Destination;
+    Entry->Generation  = FIBGeneration;
+    Entry->NCE         = NCE;
 
-    return 8 * i + j;
+    InterlockedIncrement(&Entry->Sequence);
+}
+
+
+static PFIB_ENTRY BestRouteForPrefix(
+    PROUTE_TRIE_NODE Node,
+    BOOLEAN UsableOnly,
+    PBOOLEAN Skipped)
+/*
+ * FUNCTION: Picks the route with the lowest metric to a prefix
+ * ARGUMENTS:
+ *     Node       = Pointer to trie node of the prefix
+ *     UsableOnly = TRUE to skip routers that are stale or incomplete
+ *     Skipped    = Set to TRUE if any router was skipped
+ * RETURNS:
+ *     Pointer to FIB entry, NULL if none was found
+ * NOTES:
+ *     The forward information base lock must be held when called
+ */
+{
+    PLIST_ENTRY CurrentEntry;
+    PFIB_ENTRY Current, Best = NULL;
+
+    *Skipped = FALSE;
+
+    for (CurrentEntry = Node->Routes.Flink;
+         CurrentEntry != &Node->Routes;
+         CurrentEntry = CurrentEntry->Flink) {
+        Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, PrefixListEntry);
+
+        if (UsableOnly && !NCE_USABLE(Current->Router)) {
+            *Skipped = TRUE;
+            continue;
+        }
+
+        if (!Best || Current->Metric < Best->Metric)
+            Best = Current;
+    }
+
+    return Best;
 }
 
 
@@ -206,6 +302,7 @@ PFIB_ENTRY RouterAddRoute(
  *     these references
  */
 {
+    KIRQL OldIrql;
     PFIB_ENTRY FIBE;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. NetworkAddress (0x%X)  Netmask (0x%X) "
@@ -228,9 +325,32 @@ PFIB_ENTRY RouterAddRoute(
 		   sizeof(FIBE->Netmask) );
     FIBE->Router         = Router;
     FIBE->Metric         = Metric;
+    FIBE->Node           = NULL;
+
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
+
+    /* Index IPv4 routes by prefix for RouterGetRoute */
+    if (NetworkAddress->Type == IP_ADDRESS_V4) {
+        FIBE->Node = RouteTrieInsert(&FIBTrie,
+                                     IPv4NToHl(NetworkAddress->Address.IPv4Address),
+                                     AddrCountPrefixBits(Netmask));
+        if (!FIBE->Node) {
+            TcpipReleaseSpinLock(&FIBLock, OldIrql);
+            TI_DbgPrint(MIN_TRACE, ("Insufficient resources.\n"));
+            FreeFIB(FIBE);
+            return NULL;
+        }
+
+        InsertTailList(&FIBE->Node->Routes, &FIBE->PrefixListEntry);
+    }
 
     /* Add FIB to the forward information base */
-    TcpipInterlockedInsertTailList(&FIBListHead, &FIBE->ListEntry, &FIBLock);
+    InsertTailList(&FIBListHead, &FIBE->ListEntry);
+
+    /* Cached lookups may have a longer prefix now */
+    InterlockedIncrement(&FIBGeneration);
+
+    TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     return FIBE;
 }
@@ -244,48 +364,55 @@ PNEIGHBOR_CACHE_ENTRY RouterGetRoute(PIP_ADDRESS Destination)
  * RETURNS:
  *     Pointer to NCE for router, NULL if none was found
  * NOTES:
- *     If found the NCE is referenced
+ *     If found the NCE is referenced.
+ *     The route with the longest matching prefix whose router is usable
+ *     is taken. If no router is usable, the longest matching prefix is
+ *     tried anyway. The metric decides between routes to the same prefix
  */
 {
     KIRQL OldIrql;
-    PLIST_ENTRY CurrentEntry;
-    PLIST_ENTRY NextEntry;
-    PFIB_ENTRY Current;
-    UCHAR State;
-    UINT Length, BestLength = 0, MaskLength;
-    PNEIGHBOR_CACHE_ENTRY NCE, BestNCE = NULL;
+    PROUTE_TRIE_NODE Matches[ROUTE_TRIE_MAX_MATCHES];
+    PFIB_ENTRY Best = NULL;
+    BOOLEAN Skipped = FALSE;
+    UINT Count, i;
+    PNEIGHBOR_CACHE_ENTRY BestNCE;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. Destination (0x%X)\n", Destination));
 
     TI_DbgPrint(DEBUG_ROUTER, ("Destination (%s)\n", A2S(Destination)));
 
-    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
-
-    CurrentEntry = FIBListHead.Flink;
-    while (CurrentEntry != &FIBListHead) {
-        NextEntry = CurrentEntry->Flink;
-	    Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
+    if (Destination->Type != IP_ADDRESS_V4) {
+        TI_DbgPrint(DEBUG_ROUTER, ("Don't know address type %d\n", Destination->Type));
+        return NULL;
+    }
 
-        NCE   = Current->Router;
-        State = NCE->State;
+    BestNCE = DestCacheLookup(Destination->Address.IPv4Address);
+    if( BestNCE ) {
+        TI_DbgPrint(DEBUG_ROUTER,("Routing to %s (cached)\n", A2S(&BestNCE->Address)));
+        return BestNCE;
+    }
 
-	Length = CommonPrefixLength(Destination, &Current->NetworkAddress);
-	MaskLength = AddrCountPrefixBits(&Current->Netmask);
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
 
-	TI_DbgPrint(DEBUG_ROUTER,("This-Route: %s (Sharing %d bits)\n",
-				  A2S(&NCE->Address), Length));
+    Count = RouteTrieLookup(&FIBTrie,
+                            IPv4NToHl(Destination->Address.IPv4Address),
+                            Matches);
 
-	if(Length >= MaskLength && (Length > BestLength || !BestNCE) &&
-           ((!(State & NUD_STALE) && !(State & NUD_INCOMPLETE)) || !BestNCE)) {
-	    /* This seems to be a better router */
-	    BestNCE    = NCE;
-	    BestLength = Length;
-	    TI_DbgPrint(DEBUG_ROUTER,("Route selected\n"));
-	}
+    /* Matches are sorted from the shortest prefix to the longest one */
+    for (i = Count; i > 0 && !Best; i--) {
+        Best = BestRouteForPrefix(Matches[i - 1], TRUE, &Skipped);
 
-        CurrentEntry = NextEntry;
+        /* A skipped router becoming usable again doesn't bump
+           FIBGeneration, so only cache if there was none */
+        if (Best && i == Count && !Skipped)
+            DestCacheInsert(Destination->Address.IPv4Address, Best->Router);
     }
 
+    if (!Best && Count)
+        Best = BestRouteForPrefix(Matches[Count - 1], FALSE, &Skipped);
+
+    BestNCE = Best ? Best->Router : NULL;
+
     TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     if( BestNCE ) {
@@ -492,6 +619,10 @@ NTSTATUS RouterStartup(
     /* Initialize the Forward Information Base */
     InitializeListHead(&FIBListHead);
     TcpipInitializeSpinLock(&FIBLock);
+    RouteTrieInitialize(&FIBTrie);
+
+    /* Never matches the zeroed destination cache */
+    FIBGeneration = 1;
 
     return STATUS_SUCCESS;
 }
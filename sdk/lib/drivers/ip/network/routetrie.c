@@ -0,0 +1,239 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS TCP/IP protocol driver
+ * FILE:        network/routetrie.c
+ * PURPOSE:     Longest prefix match trie for the forward information base
+ * NOTES:
+ *   The trie doesn't do any locking of its own. The router serializes
+ *   all calls with the forward information base lock.
+ */
+
+#ifndef ROUTETRIE_HOST
+#include "precomp.h"
+
+#define AllocateTrieNode() \
+    ExAllocatePoolWithTag(NonPagedPool, sizeof(ROUTE_TRIE_NODE), FIB_TAG)
+#define FreeTrieNode(Node) \
+    ExFreePoolWithTag(Node, FIB_TAG)
+#else
+#include <stdlib.h>
+#include <routetrie.h>
+
+#define AllocateTrieNode() malloc(sizeof(ROUTE_TRIE_NODE))
+#define FreeTrieNode(Node) free(Node)
+#endif
+
+/* Mask with the first Length bits set */
+#define PREFIX_MASK(Length) ((Length) ? 0xFFFFFFFF << (32 - (Length)) : 0)
+
+/* The bit following the first Length bits, Length must be below 32 */
+#define PREFIX_BIT(Address, Length) (((Address) >> (31 - (Length))) & 1)
+
+
+static UINT CommonPrefixBits(
+    ULONG Address1,
+    ULONG Address2,
+    UINT MaxLength)
+/*
+ * FUNCTION: Counts the leading bits two addresses have in common
+ * ARGUMENTS:
+ *     Address1  = First address in host byte order
+ *     Address2  = Second address in host byte order
+ *     MaxLength = Maximum number of bits to compare
+ * RETURNS:
+ *     Length of the common prefix, at most MaxLength
+ */
+{
+    ULONG Difference = Address1 ^ Address2;
+    UINT Length = 0;
+
+    /* Halve the search range each step instead of testing bit by bit */
+    if (!(Difference & 0xFFFF0000)) { Length += 16; Difference <<= 16; }
+    if (!(Difference & 0xFF000000)) { Length += 8;  Difference <<= 8; }
+    if (!(Difference & 0xF0000000)) { Length += 4;  Difference <<= 4; }
+    if (!(Difference & 0xC0000000)) { Length += 2;  Difference <<= 2; }
+    if (!(Difference & 0x80000000)) { Length += 1;  Difference <<= 1; }
+    if (!(Difference & 0x80000000)) Length += 1;
+
+    return (Length < MaxLength) ? Length : MaxLength;
+}
+
+
+static PROUTE_TRIE_NODE CreateTrieNode(
+    PROUTE_TRIE_NODE Parent,
+    ULONG Prefix,
+    UINT PrefixLength)
+{
+    PROUTE_TRIE_NODE Node;
+
+    Node = AllocateTrieNode();
+    if (!Node)
+        return NULL;
+
+    Node->Parent = Parent;
+    Node->Child[0] = NULL;
+    Node->Child[1] = NULL;
+    Node->Prefix = Prefix;
+    Node->PrefixLength = PrefixLength;
+    InitializeListHead(&Node->Routes);
+
+    return Node;
+}
+
+
+VOID RouteTrieInitialize(
+    PROUTE_TRIE Trie)
+/*
+ * FUNCTION: Initializes an empty trie
+ * ARGUMENTS:
+ *     Trie = Pointer to trie
+ */
+{
+    Trie->Root = NULL;
+}
+
+
+PROUTE_TRIE_NODE RouteTrieInsert(
+    PROUTE_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength)
+/*
+ * FUNCTION: Finds or creates the trie node for a prefix
+ * ARGUMENTS:
+ *     Trie         = Pointer to trie
+ *     Prefix       = Network address in host byte order
+ *     PrefixLength = Number of significant bits in Prefix (0-32)
+ * RETURNS:
+ *     Pointer to the node, NULL if there are not enough resources
+ * NOTES:
+ *     The caller links its routes into the Routes list of the node
+ */
+{
+    PROUTE_TRIE_NODE *Link = &Trie->Root;
+    PROUTE_TRIE_NODE Parent = NULL;
+    PROUTE_TRIE_NODE Node, NewNode, Branch;
+    UINT Length = 0;
+
+    Prefix &= PREFIX_MASK(PrefixLength);
+
+    /* Walk down as long as the nodes hold prefixes of ours */
+    while ((Node = *Link)) {
+        Length = CommonPrefixBits(Node->Prefix, Prefix,
+                                  (Node->PrefixLength < PrefixLength) ?
+                                  Node->PrefixLength : PrefixLength);
+        if (Length < Node->PrefixLength)
+            break;
+
+        if (Node->PrefixLength == PrefixLength)
+            return Node;
+
+        Parent = Node;
+        Link = &Node->Child[PREFIX_BIT(Prefix, Node->PrefixLength)];
+    }
+
+    NewNode = CreateTrieNode(Parent, Prefix, PrefixLength);
+    if (!NewNode)
+        return NULL;
+
+    if (!Node) {
+        /* Free slot below the longest existing prefix of ours */
+        *Link = NewNode;
+        return NewNode;
+    }
+
+    if (Length == PrefixLength) {
+        /* The new prefix is a prefix of Node, so goes right above it */
+        NewNode->Child[PREFIX_BIT(Node->Prefix, PrefixLength)] = Node;
+        Node->Parent = NewNode;
+        *Link = NewNode;
+        return NewNode;
+    }
+
+    /* The prefixes diverge, so they need a branch point */
+    Branch = CreateTrieNode(Parent, Prefix & PREFIX_MASK(Length), Length);
+    if (!Branch) {
+        FreeTrieNode(NewNode);
+        return NULL;
+    }
+
+    Branch->Child[PREFIX_BIT(Prefix, Length)] = NewNode;
+    Branch->Child[PREFIX_BIT(Node->Prefix, Length)] = Node;
+    NewNode->Parent = Branch;
+    Node->Parent = Branch;
+    *Link = Branch;
+
+    return NewNode;
+}
+
+
+VOID RouteTrieRemove(
+    PROUTE_TRIE Trie,
+    PROUTE_TRIE_NODE Node)
+/*
+ * FUNCTION: Prunes a node whose last route was unlinked
+ * ARGUMENTS:
+ *     Trie = Pointer to trie
+ *     Node = Pointer to node returned by RouteTrieInsert
+ * NOTES:
+ *     Nodes that still have routes, or that still branch, are kept
+ */
+{
+    PROUTE_TRIE_NODE Parent, Child;
+
+    while (Node && IsListEmpty(&Node->Routes) &&
+           !(Node->Child[0] && Node->Child[1])) {
+        Parent = Node->Parent;
+        Child = Node->Child[0] ? Node->Child[0] : Node->Child[1];
+
+        /* Splice the only child, if any, into our place */
+        if (Parent)
+            Parent->Child[Parent->Child[1] == Node] = Child;
+        else
+            Trie->Root = Child;
+
+        if (Child)
+            Child->Parent = Parent;
+
+        FreeTrieNode(Node);
+
+        /* The parent may have been a branch point for us */
+        Node = Parent;
+    }
+}
+
+
+UINT RouteTrieLookup(
+    PROUTE_TRIE Trie,
+    ULONG Address,
+    PROUTE_TRIE_NODE *Matches)
+/*
+ * FUNCTION: Finds all prefixes with routes that match an address
+ * ARGUMENTS:
+ *     Trie    = Pointer to trie
+ *     Address = Destination address in host byte order
+ *     Matches = Array of ROUTE_TRIE_MAX_MATCHES entries for the result
+ * RETURNS:
+ *     Number of matching nodes, stored from the shortest prefix to
+ *     the longest one
+ */
+{
+    PROUTE_TRIE_NODE Node = Trie->Root;
+    UINT Count = 0;
+
+    while (Node) {
+        if ((Address & PREFIX_MASK(Node->PrefixLength)) != Node->Prefix)
+            break;
+
+        if (!IsListEmpty(&Node->Routes))
+            Matches[Count++] = Node;
+
+        if (Node->PrefixLength == 32)
+            break;
+
+        Node = Node->Child[PREFIX_BIT(Address, Node->PrefixLength)];
+    }
+
+    return Count;
+}
+
+/* EOF */
@@ -45,10 +45,57 @@ CompleteBucket(PCONNECTION_ENDPOINT Connection, PTDI_BUCKET Bucket, const BOOLEA
     }
     else
     {
+        InterlockedIncrement(&LibTCPStatistics.CompletionHops);
         ChewCreate(BucketCompletionWorker, Bucket);
     }
 }
 
+static
+VOID
+BucketListCompletionWorker(PVOID Context)
+{
+    PTDI_BUCKET First = (PTDI_BUCKET)Context;
+    LIST_ENTRY List;
+    PLIST_ENTRY Entry;
+
+    /* The first bucket stood in for the list head, put a real one back */
+    InsertTailList(&First->Entry, &List);
+
+    while (!IsListEmpty(&List))
+    {
+        Entry = RemoveHeadList(&List);
+
+        BucketCompletionWorker(CONTAINING_RECORD(Entry, TDI_BUCKET, Entry));
+    }
+}
+
+static
+VOID
+CompleteBucketList(PCONNECTION_ENDPOINT Connection, PLIST_ENTRY List)
+{
+    PTDI_BUCKET Bucket;
+    PLIST_ENTRY Entry;
+
+    if (IsListEmpty(List))
+        return;
+
+    for (Entry = List->Flink; Entry != List; Entry = Entry->Flink)
+    {
+        Bucket = CONTAINING_RECORD(Entry, TDI_BUCKET, Entry);
+
+        ReferenceObject(Connection);
+        Bucket->AssociatedEndpoint = Connection;
+    }
+
+    /* One work item completes them all in order. Unhook the list head
+     * on our stack and let the first bucket take its place */
+    Bucket = CONTAINING_RECORD(List->Flink, TDI_BUCKET, Entry);
+    RemoveEntryList(List);
+
+    InterlockedIncrement(&LibTCPStatistics.CompletionHops);
+    ChewCreate(BucketListCompletionWorker, Bucket);
+}
+
 VOID
 FlushReceiveQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOOLEAN interlocked)
 {
@@ -365,9 +412,13 @@ TCPSendEventHandler(void *arg, const u16_t space)
     NTSTATUS Status;
     PMDL Mdl;
     ULONG BytesSent;
+    LIST_ENTRY CompletedList;
     
     ReferenceObject(Connection);
 
+    /* The sends we can submit now get completed by a single work item */
+    InitializeListHead(&CompletedList);
+
     while ((Entry = ExInterlockedRemoveHeadList(&Connection->SendRequest, &Connection->Lock)))
     {
         UINT SendLen = 0;
@@ -414,10 +465,12 @@ TCPSendEventHandler(void *arg, const u16_t space)
             Bucket->Status = Status;
             Bucket->Information = (Bucket->Status == STATUS_SUCCESS) ? BytesSent : 0;
                         
-            CompleteBucket(Connection, Bucket, FALSE);
+            InsertTailList(&CompletedList, &Bucket->Entry);
         }
     }
 
+    CompleteBucketList(Connection, &CompletedList);
+
     //  If we completed all outstanding send requests then finish all pending shutdown requests,
     //  cancel the timer and dereference the connection
     if (IsListEmpty(&Connection->SendRequest))
@@ -445,9 +498,13 @@ TCPRecvEventHandler(void *arg)
     UINT RecvLen;
     PUCHAR RecvBuffer;
     NTSTATUS Status;
+    LIST_ENTRY CompletedList;
 
     ReferenceObject(Connection);
 
+    /* Same for the receives we can fill now */
+    InitializeListHead(&CompletedList);
+
     while ((Entry = ExInterlockedRemoveHeadList(&Connection->ReceiveRequest, &Connection->Lock)))
     {
         Bucket = CONTAINING_RECORD( Entry, TDI_BUCKET, Entry );
@@ -457,7 +514,7 @@ TCPRecvEventHandler(void *arg)
 
         NdisQueryBuffer( Mdl, &RecvBuffer, &RecvLen );
 
-        Status = LibTCPGetDataFromConnectionQueue(Connection, RecvBuffer, RecvLen, &Received);
+        Status = LibTCPGetDataFromConnectionQueue(Connection, RecvBuffer, RecvLen, &Received, TRUE);
         if (Status == STATUS_PENDING)
         {
             ExInterlockedInsertHeadList(&Connection->ReceiveRequest,
@@ -469,9 +526,11 @@ TCPRecvEventHandler(void *arg)
         Bucket->Status = Status;
         Bucket->Information = Received;
 
-        CompleteBucket(Connection, Bucket, FALSE);
+        InsertTailList(&CompletedList, &Bucket->Entry);
     }
 
+    CompleteBucketList(Connection, &CompletedList);
+
     DereferenceObject(Connection);
 }
 
@@ -491,7 +491,7 @@ NTSTATUS TCPReceiveData
 
     NdisQueryBuffer(Buffer, &DataBuffer, &DataLen);
 
-    Status = LibTCPGetDataFromConnectionQueue(Connection, DataBuffer, DataLen, &Received);
+    Status = LibTCPGetDataFromConnectionQueue(Connection, DataBuffer, DataLen, &Received, FALSE);
 
     if (Status == STATUS_PENDING)
     {
@@ -534,8 +534,6 @@ NTSTATUS TCPSendData
     PTDI_BUCKET Bucket;
     KIRQL OldIrql;
 
-    LockObject(Connection, &OldIrql);
-
     TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Called for %d bytes (on socket %x)\n",
                            SendLength, Connection->SocketContext));
 
@@ -543,38 +541,37 @@ NTSTATUS TCPSendData
     TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Connection->SocketContext = %x\n",
                            Connection->SocketContext));
 
-    Status = TCPTranslateError(LibTCPSend(Connection,
-                                          BufferData,
-                                          SendLength,
-                                          BytesSent,
-                                          FALSE));
-    
-    TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Send: %x, %d\n", Status, SendLength));
-
-    /* Keep this request around ... there was no data yet */
-    if (Status == STATUS_PENDING)
+    /* Freed when the send is completed */
+    Bucket = ExAllocateFromNPagedLookasideList(&TdiBucketLookasideList);
+    if (!Bucket)
     {
-        /* Freed in TCPSocketState */
-        Bucket = ExAllocateFromNPagedLookasideList(&TdiBucketLookasideList);
-        if (!Bucket)
-        {
-            UnlockObject(Connection, OldIrql);
-            TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Failed to allocate bucket\n"));
-            return STATUS_NO_MEMORY;
-        }
-        
-        Bucket->Request.RequestNotifyObject = Complete;
-        Bucket->Request.RequestContext = Context;
-        
-        InsertTailList( &Connection->SendRequest, &Bucket->Entry );
-        TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Queued write irp\n"));
+        TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Failed to allocate bucket\n"));
+        return STATUS_NO_MEMORY;
     }
 
+    Bucket->Request.RequestNotifyObject = Complete;
+    Bucket->Request.RequestContext = Context;
+
+    /* Every send goes through the queue, so it can't overtake earlier ones
+     * and all sends made before the tcpip thread wakes up share the trip */
+    LockObject(Connection, &OldIrql);
+    InsertTailList( &Connection->SendRequest, &Bucket->Entry );
     UnlockObject(Connection, OldIrql);
 
-    TI_DbgPrint(DEBUG_TCP, ("[IP, TCPSendData] Leaving. Status = %x\n", Status));
+    TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Queued write irp\n"));
 
-    return Status;
+    Status = TCPTranslateError(LibTCPSendQueue(Connection));
+    if (Status != STATUS_SUCCESS)
+    {
+        /* Nobody is going to submit the queue */
+        FlushSendQueue(Connection, Status, TRUE);
+    }
+
+    *BytesSent = 0;
+
+    TI_DbgPrint(DEBUG_TCP, ("[IP, TCPSendData] Leaving. Status = %x\n", STATUS_PENDING));
+
+    return STATUS_PENDING;
 }
 
 UINT TCPAllocatePort(const UINT HintPort)
@@ -691,6 +688,20 @@ TCPSetNoDelay(
     return STATUS_SUCCESS;
 }
 
+NTSTATUS
+TCPSetReceiveWindow(
+    PCONNECTION_ENDPOINT Connection,
+    ULONG Size)
+{
+    if (!Connection)
+        return STATUS_UNSUCCESSFUL;
+
+    if (Connection->SocketContext == NULL)
+        return STATUS_UNSUCCESSFUL;
+
+    return TCPTranslateError(LibTCPSetReceiveWindow(Connection, Size));
+}
+
 NTSTATUS
 TCPGetSocketStatus(
     PCONNECTION_ENDPOINT Connection,
@@ -35,6 +35,7 @@ NTSTATUS AddUDPHeaderIPv4(
 {
     PUDP_HEADER UDPHeader;
     NTSTATUS Status;
+    ULONG Sum;
 
     TI_DbgPrint(MID_TRACE, ("Packet: %x NdisPacket %x\n",
 			    IPPacket, IPPacket->NdisPacket));
@@ -59,11 +60,14 @@ NTSTATUS AddUDPHeaderIPv4(
 			    IPPacket->Header, IPPacket->Data,
 			    (PCHAR)IPPacket->Data - (PCHAR)IPPacket->Header));
 
-    RtlCopyMemory(IPPacket->Data, Data, DataLength);
+    /* Checksum the data while copying it. It starts at an even offset
+       from the UDP header, so the two sums can simply be added */
+    Sum = ChecksumCopy(IPPacket->Data, Data, DataLength, 0);
+    Sum = ChecksumCompute(UDPHeader, sizeof(UDP_HEADER), Sum);
 
-    UDPHeader->Checksum = UDPv4ChecksumCalculate((PIPv4_HEADER)IPPacket->Header,
-                                                 (PUCHAR)UDPHeader,
-                                                 DataLength + sizeof(UDP_HEADER));
+    UDPHeader->Checksum = UDPv4ChecksumComplete((PIPv4_HEADER)IPPacket->Header,
+                                                Sum,
+                                                DataLength + sizeof(UDP_HEADER));
     UDPHeader->Checksum = WH2N(UDPHeader->Checksum);
 
     TI_DbgPrint(MID_TRACE, ("Packet: %d ip %d udp %d payload\n",
@@ -1209,7 +1209,8 @@ do_writemore(struct netconn *conn)
 {
   err_t err;
   void *dataptr;
-  u16_t len, available;
+  u16_t len;
+  tcpwnd_size_t available;
   u8_t write_finished = 0;
   size_t diff;
   u8_t dontblock = netconn_is_nonblocking(conn) ||
@@ -1253,7 +1254,7 @@ do_writemore(struct netconn *conn)
     available = tcp_sndbuf(conn->pcb.tcp);
     if (available < len) {
       /* don't try to write more than sendbuf */
-      len = available;
+      len = (u16_t)available;
       if (dontblock){ 
         if (!len) {
           err = ERR_WOULDBLOCK;
@@ -329,12 +329,28 @@ tcp_input(struct pbuf *p, struct netif *inp)
         /* If the application has registered a "sent" function to be
            called when new send buffer space is available, we call it
            now. */
+#if LWIP_WND_SCALE
+        /* pcb->acked no longer fits in the u16_t of the sent callback,
+           so we might have to call it more than once. */
+        {
+          tcpwnd_size_t acked = pcb->acked;
+          while (acked > 0) {
+            u16_t acked16 = (u16_t)LWIP_MIN(acked, 0xffffU);
+            acked -= acked16;
+            TCP_EVENT_SENT(pcb, acked16, err);
+            if (err == ERR_ABRT) {
+              goto aborted;
+            }
+          }
+        }
+#else /* LWIP_WND_SCALE */
         if (pcb->acked > 0) {
           TCP_EVENT_SENT(pcb, pcb->acked, err);
           if (err == ERR_ABRT) {
             goto aborted;
           }
         }
+#endif /* LWIP_WND_SCALE */
 
         if (recv_data != NULL) {
           LWIP_ASSERT("pcb->refused_data == NULL", pcb->refused_data == NULL);
@@ -368,7 +384,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
           } else {
             /* correct rcv_wnd as the application won't call tcp_recved()
                for the FIN's seqno */
-            if (pcb->rcv_wnd != TCP_WND) {
+            if (pcb->rcv_wnd != TCP_WND_MAX(pcb)) {
               pcb->rcv_wnd++;
             }
             TCP_EVENT_CLOSED(pcb, err);
@@ -485,7 +501,9 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->rcv_ann_right_edge = npcb->rcv_nxt;
     npcb->snd_wnd = tcphdr->wnd;
     npcb->snd_wnd_max = tcphdr->wnd;
-    npcb->ssthresh = npcb->snd_wnd;
+    /* Start as high as we can ever send (RFC 5681), the window is not
+       scaled in a SYN so it would stop slow start far too early */
+    npcb->ssthresh = TCP_SND_BUF;
     npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
     npcb->callback_arg = pcb->callback_arg;
 #if LWIP_CALLBACK_API
@@ -644,9 +662,9 @@ tcp_process(struct tcp_pcb *pcb)
       pcb->mss = tcp_eff_send_mss(pcb->mss, &(pcb->remote_ip));
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
 
-      /* Set ssthresh again after changing pcb->mss (already set in tcp_connect
-       * but for the default value of pcb->mss) */
-      pcb->ssthresh = pcb->mss * 10;
+      /* Set ssthresh again after the connection is set up, as high as we
+       * can ever send (RFC 5681) */
+      pcb->ssthresh = TCP_SND_BUF;
 
       pcb->cwnd = ((pcb->cwnd == 1) ? (pcb->mss * 2) : pcb->mss);
       LWIP_ASSERT("pcb->snd_queuelen > 0", (pcb->snd_queuelen > 0));
@@ -854,6 +872,7 @@ tcp_receive(struct tcp_pcb *pcb)
   s32_t off;
   s16_t m;
   u32_t right_wnd_edge;
+  tcpwnd_size_t snd_wnd;
   u16_t new_tot_len;
   int found_dupack = 0;
 #if TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS
@@ -865,16 +884,17 @@ tcp_receive(struct tcp_pcb *pcb)
 
   if (flags & TCP_ACK) {
     right_wnd_edge = pcb->snd_wnd + pcb->snd_wl2;
+    snd_wnd = SND_WND_SCALE(pcb, tcphdr->wnd);
 
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
        (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
-       (pcb->snd_wl2 == ackno && tcphdr->wnd > pcb->snd_wnd)) {
-      pcb->snd_wnd = tcphdr->wnd;
+       (pcb->snd_wl2 == ackno && snd_wnd > pcb->snd_wnd)) {
+      pcb->snd_wnd = snd_wnd;
       /* keep track of the biggest window announced by the remote host to calculate
          the maximum segment size */
-      if (pcb->snd_wnd_max < tcphdr->wnd) {
-        pcb->snd_wnd_max = tcphdr->wnd;
+      if (pcb->snd_wnd_max < snd_wnd) {
+        pcb->snd_wnd_max = snd_wnd;
       }
       pcb->snd_wl1 = seqno;
       pcb->snd_wl2 = ackno;
@@ -888,10 +908,10 @@ tcp_receive(struct tcp_pcb *pcb)
         /* stop persist timer */
           pcb->persist_backoff = 0;
       }
-      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"U16_F"\n", pcb->snd_wnd));
+      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"TCPWNDSIZE_F"\n", pcb->snd_wnd));
 #if TCP_WND_DEBUG
     } else {
-      if (pcb->snd_wnd != tcphdr->wnd) {
+      if (pcb->snd_wnd != snd_wnd) {
         LWIP_DEBUGF(TCP_WND_DEBUG, 
                     ("tcp_receive: no window update lastack %"U32_F" ackno %"
                      U32_F" wl1 %"U32_F" seqno %"U32_F" wl2 %"U32_F"\n",
@@ -938,9 +958,7 @@ tcp_receive(struct tcp_pcb *pcb)
               if (pcb->dupacks > 3) {
                 /* Inflate the congestion window, but not if it means that
                    the value overflows. */
-                if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
-                  pcb->cwnd += pcb->mss;
-                }
+                TCP_WND_INC(pcb->cwnd, pcb->mss);
               } else if (pcb->dupacks == 3) {
                 /* Do fast retransmit */
                 tcp_rexmit_fast(pcb);
@@ -971,8 +989,9 @@ tcp_receive(struct tcp_pcb *pcb)
       /* Reset the retransmission time-out. */
       pcb->rto = (pcb->sa >> 3) + pcb->sv;
 
-      /* Update the send buffer space. Diff between the two can never exceed 64K? */
-      pcb->acked = (u16_t)(ackno - pcb->lastack);
+      /* Update the send buffer space. Diff between the two can never exceed
+         TCP_SND_BUF, which needs window scaling to be larger than 64K. */
+      pcb->acked = (tcpwnd_size_t)(ackno - pcb->lastack);
 
       pcb->snd_buf += pcb->acked;
 
@@ -984,16 +1003,11 @@ tcp_receive(struct tcp_pcb *pcb)
          ssthresh). */
       if (pcb->state >= ESTABLISHED) {
         if (pcb->cwnd < pcb->ssthresh) {
-          if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
-            pcb->cwnd += pcb->mss;
-          }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"U16_F"\n", pcb->cwnd));
+          TCP_WND_INC(pcb->cwnd, pcb->mss);
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         } else {
-          u16_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
-          if (new_cwnd > pcb->cwnd) {
-            pcb->cwnd = new_cwnd;
-          }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"U16_F"\n", pcb->cwnd));
+          TCP_WND_INC(pcb->cwnd, (tcpwnd_size_t)pcb->mss * pcb->mss / pcb->cwnd);
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         }
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
@@ -1366,8 +1380,11 @@ tcp_receive(struct tcp_pcb *pcb)
 
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
-        tcp_send_empty_ack(pcb);
 #if TCP_QUEUE_OOSEQ
+#if LWIP_TCP_SACK_OUT
+        /* Its block goes first in the SACK option (RFC 2018) */
+        pcb->rcv_sack_last = seqno;
+#endif /* LWIP_TCP_SACK_OUT */
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
           pcb->ooseq = tcp_seg_copy(&inseg);
@@ -1514,6 +1531,9 @@ tcp_receive(struct tcp_pcb *pcb)
         }
 #endif /* TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS */
 #endif /* TCP_QUEUE_OOSEQ */
+        /* Only ACK once the segment is queued, so that it can be
+           included in the SACK option */
+        tcp_send_empty_ack(pcb);
       }
     } else {
       /* The incoming segment is not withing the window. */
@@ -1579,6 +1599,44 @@ tcp_parseopt(struct tcp_pcb *pcb)
         /* Advance to next option */
         c += 0x04;
         break;
+#if LWIP_WND_SCALE
+      case 0x03:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: WND_SCALE\n"));
+        if (opts[c + 1] != 0x03 || c + 0x03 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        /* Only valid in the SYN that opens the connection, and a
+           retransmitted SYN must not change it */
+        if ((flags & TCP_SYN) && !(pcb->flags & TF_WND_SCALE) &&
+            (pcb->state == SYN_SENT || pcb->state == SYN_RCVD)) {
+          pcb->snd_scale = LWIP_MIN(opts[c + 2], 14);
+          pcb->rcv_scale = TCP_RCV_SCALE;
+          pcb->flags |= TF_WND_SCALE;
+          /* Nothing was received yet, so the full window is available now */
+          pcb->rcv_wnd = TCP_WND_MAX(pcb);
+          pcb->rcv_ann_wnd = TCP_WND_MAX(pcb);
+        }
+        /* Advance to next option */
+        c += 0x03;
+        break;
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+      case 0x04:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK_PERM\n"));
+        if (opts[c + 1] != 0x02 || c + 0x02 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        if (flags & TCP_SYN) {
+          pcb->flags |= TF_SACK;
+        }
+        /* Advance to next option */
+        c += 0x02;
+        break;
+#endif /* LWIP_TCP_SACK_OUT */
 #if LWIP_TCP_TIMESTAMPS
       case 0x08:
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: TS\n"));
@@ -105,7 +105,7 @@ tcp_output_alloc_header(struct tcp_pcb *pcb, u16_t optlen, u16_t datalen,
     tcphdr->seqno = seqno_be;
     tcphdr->ackno = htonl(pcb->rcv_nxt);
     TCPH_HDRLEN_FLAGS_SET(tcphdr, (5 + optlen / 4), TCP_ACK);
-    tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+    tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
     tcphdr->chksum = 0;
     tcphdr->urgp = 0;
 
@@ -306,7 +306,7 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
 
   /* fail on too much data */
   if (len > pcb->snd_buf) {
-    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"U16_F")\n",
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"TCPWNDSIZE_F")\n",
       len, pcb->snd_buf));
     pcb->flags |= TF_NAGLEMEMERR;
     return ERR_MEM;
@@ -742,6 +742,19 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
 
   if (flags & TCP_SYN) {
     optflags = TF_SEG_OPTS_MSS;
+#if LWIP_WND_SCALE
+    /* A <SYN,ACK> (sent in SYN_RCVD) may only carry the window scale
+       option if the remote host sent one in its SYN */
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_WND_SCALE)) {
+      optflags |= TF_SEG_OPTS_WND_SCALE;
+    }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+    /* Same for SACK permitted */
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_SACK)) {
+      optflags |= TF_SEG_OPTS_SACK_PERM;
+    }
+#endif /* LWIP_TCP_SACK_OUT */
   }
 #if LWIP_TCP_TIMESTAMPS
   if ((pcb->flags & TF_TIMESTAMP)) {
@@ -834,6 +847,83 @@ tcp_build_timestamp_option(struct tcp_pcb *pcb, u32_t *opts)
 }
 #endif
 
+#if LWIP_WND_SCALE
+/* Build a window scale option (4 bytes long) at the specified options pointer
+ *
+ * @param opts option pointer where to store the window scale option
+ */
+static void
+tcp_build_wnd_scale_option(u32_t *opts)
+{
+  /* Pad with one NOP option to make everything nicely aligned */
+  opts[0] = PP_HTONL(0x01030300 | TCP_RCV_SCALE);
+}
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_TCP_SACK_OUT
+/* Build a SACK permitted option (4 bytes long) at the specified options pointer
+ *
+ * @param opts option pointer where to store the SACK permitted option
+ */
+static void
+tcp_build_sack_perm_option(u32_t *opts)
+{
+  /* Pad with two NOP options to make everything nicely aligned */
+  opts[0] = PP_HTONL(0x01010402);
+}
+
+/* Collect the blocks of data queued out of sequence for the SACK option.
+ *
+ * @param pcb tcp_pcb
+ * @param left array receiving the first seqno of each block
+ * @param right array receiving the seqno following each block
+ * @param max number of blocks that fit in the option
+ * @return number of blocks found
+ */
+static u8_t
+tcp_get_sack_blocks(struct tcp_pcb *pcb, u32_t *left, u32_t *right, u8_t max)
+{
+  struct tcp_seg *seg = pcb->ooseq;
+  u32_t start, end;
+  u8_t count = 0, i;
+
+  while (seg != NULL) {
+    /* tcp_input left the sequence numbers of queued segments in host order */
+    start = seg->tcphdr->seqno;
+    end = start + seg->len;
+    /* The queue is sorted, so one block is a run of adjacent segments */
+    while ((seg->next != NULL) && (seg->next->tcphdr->seqno == end)) {
+      seg = seg->next;
+      end += seg->len;
+    }
+    seg = seg->next;
+
+    if (start == end) {
+      /* Only a FIN, no data */
+      continue;
+    }
+
+    if ((count > 0) && TCP_SEQ_BETWEEN(pcb->rcv_sack_last, start, end - 1)) {
+      /* The block with the latest segment goes first, even if that
+         pushes out another one */
+      i = (count < max) ? count++ : (u8_t)(max - 1);
+      for (; i > 0; i--) {
+        left[i] = left[i - 1];
+        right[i] = right[i - 1];
+      }
+      left[0] = start;
+      right[0] = end;
+    } else if (count < max) {
+      left[count] = start;
+      right[count] = end;
+      count++;
+    }
+  }
+
+  return count;
+}
+#endif /* LWIP_TCP_SACK_OUT */
+
 /** Send an ACK without data.
  *
  * @param pcb Protocol control block for the TCP connection to send the ACK
@@ -844,12 +934,24 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   struct pbuf *p;
   struct tcp_hdr *tcphdr;
   u8_t optlen = 0;
+#if LWIP_TCP_SACK_OUT
+  /* 40 bytes of options: three blocks next to a timestamp, four without */
+  u32_t sack_left[4], sack_right[4];
+  u8_t sack_count = 0, i;
+  u32_t *opts;
+#endif /* LWIP_TCP_SACK_OUT */
 
 #if LWIP_TCP_TIMESTAMPS
   if (pcb->flags & TF_TIMESTAMP) {
     optlen = LWIP_TCP_OPT_LENGTH(TF_SEG_OPTS_TS);
   }
 #endif
+#if LWIP_TCP_SACK_OUT
+  if ((pcb->flags & TF_SACK) && (pcb->ooseq != NULL)) {
+    sack_count = tcp_get_sack_blocks(pcb, sack_left, sack_right, optlen ? 3 : 4);
+    optlen += LWIP_TCP_SACK_OPT_LENGTH(sack_count);
+  }
+#endif /* LWIP_TCP_SACK_OUT */
 
   p = tcp_output_alloc_header(pcb, optlen, 0, htonl(pcb->snd_nxt));
   if (p == NULL) {
@@ -871,6 +973,23 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   }
 #endif 
 
+#if LWIP_TCP_SACK_OUT
+  if (sack_count) {
+    opts = (u32_t *)(void *)(tcphdr + 1);
+#if LWIP_TCP_TIMESTAMPS
+    if (pcb->flags & TF_TIMESTAMP) {
+      opts += 3;
+    }
+#endif
+    /* Pad with two NOP options to make everything nicely aligned */
+    *opts++ = htonl(0x01010500 | (2 + 8 * sack_count));
+    for (i = 0; i < sack_count; i++) {
+      *opts++ = htonl(sack_left[i]);
+      *opts++ = htonl(sack_right[i]);
+    }
+  }
+#endif /* LWIP_TCP_SACK_OUT */
+
 #if CHECKSUM_GEN_TCP
   tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
         IP_PROTO_TCP, p->tot_len);
@@ -945,13 +1064,13 @@ tcp_output(struct tcp_pcb *pcb)
 #endif /* TCP_OUTPUT_DEBUG */
 #if TCP_CWND_DEBUG
   if (seg == NULL) {
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F
-                                 ", cwnd %"U16_F", wnd %"U32_F
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F
+                                 ", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                                  ", seg == NULL, ack %"U32_F"\n",
                                  pcb->snd_wnd, pcb->cwnd, wnd, pcb->lastack));
   } else {
     LWIP_DEBUGF(TCP_CWND_DEBUG, 
-                ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F
+                ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                  ", effwnd %"U32_F", seq %"U32_F", ack %"U32_F"\n",
                  pcb->snd_wnd, pcb->cwnd, wnd,
                  ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len,
@@ -975,7 +1094,7 @@ tcp_output(struct tcp_pcb *pcb)
       break;
     }
 #if TCP_CWND_DEBUG
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
                             pcb->snd_wnd, pcb->cwnd, wnd,
                             ntohl(seg->tcphdr->seqno) + seg->len -
                             pcb->lastack,
@@ -1060,7 +1179,16 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   seg->tcphdr->ackno = htonl(pcb->rcv_nxt);
 
   /* advertise our receive window size in this TCP segment */
-  seg->tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    /* The window field of a SYN, the only segment carrying the
+       window scale option, is never scaled */
+    seg->tcphdr->wnd = htons(TCPWND16(pcb->rcv_ann_wnd));
+  } else
+#endif /* LWIP_WND_SCALE */
+  {
+    seg->tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
+  }
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
@@ -1077,6 +1205,18 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
     *opts = TCP_BUILD_MSS_OPTION(mss);
     opts += 1;
   }
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    tcp_build_wnd_scale_option(opts);
+    opts += 1;
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+  if (seg->flags & TF_SEG_OPTS_SACK_PERM) {
+    tcp_build_sack_perm_option(opts);
+    opts += 1;
+  }
+#endif /* LWIP_TCP_SACK_OUT */
 #if LWIP_TCP_TIMESTAMPS
   pcb->ts_lastacksent = pcb->rcv_nxt;
 
@@ -1212,7 +1352,7 @@ tcp_rst(u32_t seqno, u32_t ackno,
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
   TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN/4, TCP_RST | TCP_ACK);
-  tcphdr->wnd = PP_HTONS(TCP_WND);
+  tcphdr->wnd = PP_HTONS(TCPWND16(TCP_WND));
   tcphdr->chksum = 0;
   tcphdr->urgp = 0;
 
@@ -1340,7 +1480,7 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
     /* The minimum value for ssthresh should be 2 MSS */
     if (pcb->ssthresh < 2*pcb->mss) {
       LWIP_DEBUGF(TCP_FR_DEBUG, 
-                  ("tcp_receive: The minimum value for ssthresh %"U16_F
+                  ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
                    " should be min 2 mss %"U16_F"...\n",
                    pcb->ssthresh, 2*pcb->mss));
       pcb->ssthresh = 2*pcb->mss;
@@ -43,8 +43,15 @@ typedef ULONG_PTR mem_ptr_t;
 /* Endianness */
 #define BYTE_ORDER LITTLE_ENDIAN
 
-/* Checksum calculation algorithm choice */
-#define LWIP_CHKSUM_ALGORITHM 3
+/* Checksum calculation, shared with the ip library. See checksum.c */
+ULONG ChecksumFold(ULONG Sum);
+ULONG ChecksumCompute(PVOID Data, UINT Count, ULONG Seed);
+ULONG ChecksumCopy(PVOID Destination, PVOID Source, UINT Count, ULONG Seed);
+
+#define LWIP_CHKSUM(dataptr, len) \
+    ((u16_t)ChecksumFold(ChecksumCompute((dataptr), (len), 0)))
+#define LWIP_CHKSUM_COPY(dst, src, len) \
+    ((u16_t)ChecksumFold(ChecksumCopy((dst), (PVOID)(src), (len), 0)))
 
 /* Diagnostics */
 #define LWIP_PLATFORM_DIAG(x) (DbgPrint x)
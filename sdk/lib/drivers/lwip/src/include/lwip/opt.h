@@ -1060,12 +1060,36 @@
 #define LWIP_TCP_TIMESTAMPS             0
 #endif
 
+/**
+ * LWIP_WND_SCALE==1: support the TCP window scale option (RFC 7323), which
+ * allows TCP_WND and TCP_SND_BUF to be larger than 0xFFFF.
+ * TCP_RCV_SCALE is the shift count announced to the remote host (0..14).
+ * TCP_WND must not be larger than (0xFFFF << TCP_RCV_SCALE).
+ */
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  0
+#endif
+
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE                   0
+#endif
+
+/**
+ * LWIP_TCP_SACK_OUT==1: announce the SACK permitted option (RFC 2018) and
+ * report the segments queued out of sequence in the ACKs we send, so that
+ * the remote host only needs to retransmit the holes.
+ * Needs TCP_QUEUE_OOSEQ.
+ */
+#ifndef LWIP_TCP_SACK_OUT
+#define LWIP_TCP_SACK_OUT               0
+#endif
+
 /**
  * TCP_WND_UPDATE_THRESHOLD: difference in window to trigger an
  * explicit window update
  */
 #ifndef TCP_WND_UPDATE_THRESHOLD
-#define TCP_WND_UPDATE_THRESHOLD   (TCP_WND / 4)
+#define TCP_WND_UPDATE_THRESHOLD   LWIP_MIN((TCP_WND / 4), (TCP_MSS * 4))
 #endif
 
 /**
@@ -48,6 +48,32 @@ extern "C" {
 
 struct tcp_pcb;
 
+#if LWIP_WND_SCALE
+/* Window and send buffer sizes no longer fit in the 16 bit header field */
+typedef u32_t tcpwnd_size_t;
+#define TCPWNDSIZE_F U32_F
+/* Convert between our window and the (scaled) window field of a header */
+#define RCV_WND_SCALE(pcb, wnd) (((wnd) >> (pcb)->rcv_scale))
+#define SND_WND_SCALE(pcb, wnd) (((tcpwnd_size_t)(wnd) << (pcb)->snd_scale))
+#define TCPWND16(x)             ((u16_t)LWIP_MIN((x), 0xFFFF))
+/* Without a scale factor agreed on, no more than 0xFFFF can be announced */
+#define TCP_WND_MAX(pcb)        ((tcpwnd_size_t)(((pcb)->flags & TF_WND_SCALE) ? \
+                                                 (pcb)->rcv_wnd_max : TCPWND16((pcb)->rcv_wnd_max)))
+#else /* LWIP_WND_SCALE */
+typedef u16_t tcpwnd_size_t;
+#define TCPWNDSIZE_F U16_F
+#define RCV_WND_SCALE(pcb, wnd) (wnd)
+#define SND_WND_SCALE(pcb, wnd) (wnd)
+#define TCPWND16(x)             (x)
+#define TCP_WND_MAX(pcb)        ((pcb)->rcv_wnd_max)
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_WND_SCALE || LWIP_TCP_SACK_OUT
+typedef u16_t tcpflags_t;
+#else
+typedef u8_t tcpflags_t;
+#endif
+
 /** Function prototype for tcp accept callback functions. Called when a new
  * connection can be accepted on a listening pcb.
  *
@@ -174,15 +200,21 @@ struct tcp_pcb {
   /* ports are in host byte order */
   u16_t remote_port;
   
-  u8_t flags;
-#define TF_ACK_DELAY   ((u8_t)0x01U)   /* Delayed ACK. */
-#define TF_ACK_NOW     ((u8_t)0x02U)   /* Immediate ACK. */
-#define TF_INFR        ((u8_t)0x04U)   /* In fast recovery. */
-#define TF_TIMESTAMP   ((u8_t)0x08U)   /* Timestamp option enabled */
-#define TF_RXCLOSED    ((u8_t)0x10U)   /* rx closed by tcp_shutdown */
-#define TF_FIN         ((u8_t)0x20U)   /* Connection was closed locally (FIN segment enqueued). */
-#define TF_NODELAY     ((u8_t)0x40U)   /* Disable Nagle algorithm */
-#define TF_NAGLEMEMERR ((u8_t)0x80U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+  tcpflags_t flags;
+#define TF_ACK_DELAY   ((tcpflags_t)0x01U)   /* Delayed ACK. */
+#define TF_ACK_NOW     ((tcpflags_t)0x02U)   /* Immediate ACK. */
+#define TF_INFR        ((tcpflags_t)0x04U)   /* In fast recovery. */
+#define TF_TIMESTAMP   ((tcpflags_t)0x08U)   /* Timestamp option enabled */
+#define TF_RXCLOSED    ((tcpflags_t)0x10U)   /* rx closed by tcp_shutdown */
+#define TF_FIN         ((tcpflags_t)0x20U)   /* Connection was closed locally (FIN segment enqueued). */
+#define TF_NODELAY     ((tcpflags_t)0x40U)   /* Disable Nagle algorithm */
+#define TF_NAGLEMEMERR ((tcpflags_t)0x80U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+#if LWIP_WND_SCALE
+#define TF_WND_SCALE   ((tcpflags_t)0x0100U) /* Window Scale option enabled */
+#endif
+#if LWIP_TCP_SACK_OUT
+#define TF_SACK        ((tcpflags_t)0x0200U) /* Selective ACKs enabled */
+#endif
 
   /* the rest of the fields are in host byte order
      as we have to do some math with them */
@@ -194,9 +226,13 @@ struct tcp_pcb {
 
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
-  u16_t rcv_wnd;   /* receiver window available */
-  u16_t rcv_ann_wnd; /* receiver window to announce */
+  tcpwnd_size_t rcv_wnd;   /* receiver window available */
+  tcpwnd_size_t rcv_ann_wnd; /* receiver window to announce */
   u32_t rcv_ann_right_edge; /* announced right edge of window */
+  tcpwnd_size_t rcv_wnd_max; /* receiver window size, at most TCP_WND */
+#if LWIP_TCP_SACK_OUT
+  u32_t rcv_sack_last; /* seqno of the last segment received out of sequence */
+#endif /* LWIP_TCP_SACK_OUT */
 
   /* Retransmission timer. */
   s16_t rtime;
@@ -216,20 +252,20 @@ struct tcp_pcb {
   u32_t lastack; /* Highest acknowledged seqno. */
 
   /* congestion avoidance/control variables */
-  u16_t cwnd;
-  u16_t ssthresh;
+  tcpwnd_size_t cwnd;
+  tcpwnd_size_t ssthresh;
 
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
                              window update. */
   u32_t snd_lbb;       /* Sequence number of next byte to be buffered. */
-  u16_t snd_wnd;   /* sender window */
-  u16_t snd_wnd_max; /* the maximum sender window announced by the remote host */
+  tcpwnd_size_t snd_wnd;   /* sender window */
+  tcpwnd_size_t snd_wnd_max; /* the maximum sender window announced by the remote host */
 
-  u16_t acked;
+  tcpwnd_size_t acked;
 
-  u16_t snd_buf;   /* Available buffer space for sending (in bytes). */
+  tcpwnd_size_t snd_buf;   /* Available buffer space for sending (in bytes). */
 #define TCP_SNDQUEUELEN_OVERFLOW (0xffffU-3)
   u16_t snd_queuelen; /* Available buffer space for sending (in tcp_segs). */
 
@@ -279,6 +315,11 @@ struct tcp_pcb {
 
   /* KEEPALIVE counter */
   u8_t keep_cnt_sent;
+
+#if LWIP_WND_SCALE
+  u8_t snd_scale;
+  u8_t rcv_scale;
+#endif /* LWIP_WND_SCALE */
 };
 
 struct tcp_pcb_listen {  
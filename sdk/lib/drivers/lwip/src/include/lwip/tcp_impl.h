@@ -292,16 +292,33 @@ struct tcp_seg {
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
+#define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include window scale option. */
+#define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK permitted option. */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
 #define LWIP_TCP_OPT_LENGTH(flags)              \
   (flags & TF_SEG_OPTS_MSS ? 4  : 0) +          \
-  (flags & TF_SEG_OPTS_TS  ? 12 : 0)
+  (flags & TF_SEG_OPTS_TS  ? 12 : 0) +          \
+  (flags & TF_SEG_OPTS_WND_SCALE ? 4 : 0) +     \
+  (flags & TF_SEG_OPTS_SACK_PERM ? 4 : 0)
+
+/* Two NOPs, kind and length, then two sequence numbers per block */
+#define LWIP_TCP_SACK_OPT_LENGTH(blocks)        \
+  ((blocks) ? 4 + 8 * (blocks) : 0)
 
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(mss) htonl(0x02040000 | ((mss) & 0xFFFF))
 
+/** Grow a window variable, saturating instead of wrapping around */
+#define TCP_WND_INC(wnd, inc)   do { \
+                                  if ((tcpwnd_size_t)((wnd) + (inc)) >= (wnd)) { \
+                                    (wnd) = (tcpwnd_size_t)((wnd) + (inc)); \
+                                  } else { \
+                                    (wnd) = (tcpwnd_size_t)-1; \
+                                  } \
+                                } while(0)
+
 /* Global variables: */
 extern struct tcp_pcb *tcp_input_pcb;
 extern u32_t tcp_ticks;
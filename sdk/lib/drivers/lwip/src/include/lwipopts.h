@@ -64,7 +64,14 @@
  * add support for other transport mediums */
 #define TCP_MSS                         1460
 
-#define TCP_WND                         0xFFFF
+/* Window scaling lets a single connection have more than 64KB in flight.
+ * TCP_WND is only the upper bound, SO_RCVBUF can lower the receive window
+ * of a connection */
+#define LWIP_WND_SCALE                  1
+
+#define TCP_RCV_SCALE                   3
+
+#define TCP_WND                         (256 * 1024)
 
 #define TCP_SND_BUF                     TCP_WND
 
@@ -76,6 +83,11 @@
 
 #define LWIP_TCP_TIMESTAMPS             1
 
+#define LWIP_TCP_SACK_OUT               1
+
+/* Checksum outgoing TCP data while it is copied into the pbufs */
+#define LWIP_CHECKSUM_ON_COPY           1
+
 #define LWIP_CALLBACK_API               1
 
 #define LWIP_NETIF_API                  1
@@ -21,6 +21,19 @@ typedef struct _QUEUE_ENTRY
     LIST_ENTRY ListEntry;
 } QUEUE_ENTRY, *PQUEUE_ENTRY;
 
+/* Counts how often a request has to switch threads, compared to the
+ * amount of data moved. Dumped with the active objects */
+typedef struct _LIBTCP_STATISTICS
+{
+    LONG TcpipHops;             /* Requests posted to the tcpip thread */
+    LONG CompletionHops;        /* Work items that complete requests */
+    LONG QueuedSends;           /* Sends that rode along with an earlier hop */
+    LARGE_INTEGER BytesSent;
+    LARGE_INTEGER BytesReceived;
+} LIBTCP_STATISTICS, *PLIBTCP_STATISTICS;
+
+extern LIBTCP_STATISTICS LibTCPStatistics;
+
 struct lwip_callback_msg
 {
     /* Synchronization */
@@ -59,6 +72,10 @@ struct lwip_callback_msg
             PCONNECTION_ENDPOINT Connection;
             int Callback;
         } Close;
+        struct {
+            PCONNECTION_ENDPOINT Connection;
+            u32_t Size;
+        } Window;
     } Input;
     
     /* Output */
@@ -85,10 +102,13 @@ struct lwip_callback_msg
         struct {
             err_t Error;
         } Close;
+        struct {
+            err_t Error;
+        } Window;
     } Output;
 };
 
-NTSTATUS    LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHAR RecvBuffer, UINT RecvLen, UINT *Received);
+NTSTATUS    LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHAR RecvBuffer, UINT RecvLen, UINT *Received, const int safe);
 
 /* External TCP event handlers */
 extern void TCPConnectEventHandler(void *arg, const err_t err);
@@ -98,10 +118,12 @@ extern void TCPFinEventHandler(void *arg, const err_t err);
 extern void TCPRecvEventHandler(void *arg);
 
 /* TCP functions */
+void        LibTCPInitialize(void);
 PTCP_PCB    LibTCPSocket(void *arg);
 err_t       LibTCPBind(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, const u16_t port);
 PTCP_PCB    LibTCPListen(PCONNECTION_ENDPOINT Connection, const u8_t backlog);
 err_t       LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len, u32_t *sent, const int safe);
+err_t       LibTCPSendQueue(PCONNECTION_ENDPOINT Connection);
 err_t       LibTCPConnect(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, const u16_t port);
 err_t       LibTCPShutdown(PCONNECTION_ENDPOINT Connection, const int shut_rx, const int shut_tx);
 err_t       LibTCPClose(PCONNECTION_ENDPOINT Connection, const int safe, const int callback);
@@ -110,6 +132,7 @@ err_t       LibTCPGetPeerName(PTCP_PCB pcb, struct ip_addr *const ipaddr, u16_t
 err_t       LibTCPGetHostName(PTCP_PCB pcb, struct ip_addr *const ipaddr, u16_t *const port);
 void        LibTCPAccept(PTCP_PCB pcb, struct tcp_pcb *listen_pcb, void *arg);
 void        LibTCPSetNoDelay(PTCP_PCB pcb, BOOLEAN Set);
+err_t       LibTCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, const u32_t size);
 void        LibTCPGetSocketStatus(PTCP_PCB pcb, PULONG State);
 
 /* IP functions */
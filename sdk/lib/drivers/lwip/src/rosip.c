@@ -34,6 +34,8 @@ LibIPInsertPacket(void *ifarg,
 void
 LibIPInitialize(void)
 {
+    LibTCPInitialize();
+
     /* This completes asynchronously */
     tcpip_init(NULL, NULL);
 }
@@ -1,6 +1,7 @@
 #include "lwip/sys.h"
 #include "lwip/netif.h"
 #include "lwip/tcpip.h"
+#include "lwip/tcp_impl.h"
 
 #include "rosip.h"
 
@@ -32,6 +33,12 @@ extern KEVENT TerminationEvent;
 extern NPAGED_LOOKASIDE_LIST MessageLookasideList;
 extern NPAGED_LOOKASIDE_LIST QueueEntryLookasideList;
 
+LIBTCP_STATISTICS LibTCPStatistics;
+
+/* Ring of used up queue entries waiting to be freed in the tcpip thread */
+static PQUEUE_ENTRY DeferredFreeEntries;
+static KSPIN_LOCK DeferredFreeLock;
+
 /* Required for ERR_T to NTSTATUS translation in receive error handling */
 NTSTATUS TCPTranslateError(const err_t err);
 
@@ -50,6 +57,23 @@ LibTCPDumpPcb(PVOID SocketContext)
     pcb->remote_port);
 }
 
+void
+LibTCPDumpStatistics(void)
+{
+    LONGLONG Bytes = LibTCPStatistics.BytesSent.QuadPart + LibTCPStatistics.BytesReceived.QuadPart;
+    LONG Hops = LibTCPStatistics.TcpipHops + LibTCPStatistics.CompletionHops;
+
+    DbgPrint("TCP statistics:\n");
+    DbgPrint("\tBytes sent: %I64d | Bytes received: %I64d\n",
+             LibTCPStatistics.BytesSent.QuadPart,
+             LibTCPStatistics.BytesReceived.QuadPart);
+    DbgPrint("\tThread hops: tcpip: %ld | Completion: %ld | Sends sharing one: %ld\n",
+             LibTCPStatistics.TcpipHops,
+             LibTCPStatistics.CompletionHops,
+             LibTCPStatistics.QueuedSends);
+    DbgPrint("\tBytes per hop: %I64d\n", Hops ? Bytes / Hops : 0);
+}
+
 static
 void
 LibTCPEmptyQueue(PCONNECTION_ENDPOINT Connection)
@@ -98,83 +122,210 @@ PQUEUE_ENTRY LibTCPDequeuePacket(PCONNECTION_ENDPOINT Connection)
     return qp;
 }
 
-NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHAR RecvBuffer, UINT RecvLen, UINT *Received)
+static
+void
+LibTCPFreeQueueEntries(PQUEUE_ENTRY First)
 {
+    LIST_ENTRY List;
+    PLIST_ENTRY Entry;
     PQUEUE_ENTRY qp;
-    struct pbuf* p;
+
+    /* Give the ring of entries a list head again */
+    InsertTailList(&First->ListEntry, &List);
+
+    while (!IsListEmpty(&List))
+    {
+        Entry = RemoveHeadList(&List);
+        qp = CONTAINING_RECORD(Entry, QUEUE_ENTRY, ListEntry);
+
+        pbuf_free(qp->p);
+
+        ExFreeToNPagedLookasideList(&QueueEntryLookasideList, qp);
+    }
+}
+
+static
+void
+LibTCPDeferFreeQueueEntries(PQUEUE_ENTRY First)
+{
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&DeferredFreeLock, &OldIrql);
+    if (DeferredFreeEntries)
+        AppendTailList(&DeferredFreeEntries->ListEntry, &First->ListEntry);
+    else
+        DeferredFreeEntries = First;
+    KeReleaseSpinLock(&DeferredFreeLock, OldIrql);
+}
+
+/* Must be called in the tcpip thread */
+static
+void
+LibTCPFreeDeferredQueueEntries(void)
+{
+    PQUEUE_ENTRY First;
+    KIRQL OldIrql;
+
+    if (!DeferredFreeEntries) return;
+
+    KeAcquireSpinLock(&DeferredFreeLock, &OldIrql);
+    First = DeferredFreeEntries;
+    DeferredFreeEntries = NULL;
+    KeReleaseSpinLock(&DeferredFreeLock, OldIrql);
+
+    if (First)
+        LibTCPFreeQueueEntries(First);
+}
+
+/* Opens the receive window by what was taken out of the packet queue, so
+ * that the window bounds what we buffer. Must be called in the tcpip thread */
+static
+void
+LibTCPReceiveDone(PCONNECTION_ENDPOINT Connection)
+{
+    PTCP_PCB pcb = Connection->SocketContext;
+    LONG Length;
+    u16_t Chunk;
+
+    Length = InterlockedExchange(&Connection->BytesConsumed, 0);
+    if (!Length || !pcb || pcb->state == LISTEN)
+        return;
+
+    while (Length)
+    {
+        Chunk = (u16_t)LWIP_MIN(Length, 0xFFFF);
+        tcp_recved(pcb, Chunk);
+        Length -= Chunk;
+    }
+}
+
+static
+void
+LibTCPReceiveDoneCallback(void *arg)
+{
+    PCONNECTION_ENDPOINT Connection = arg;
+
+    LibTCPFreeDeferredQueueEntries();
+    LibTCPReceiveDone(Connection);
+
+    DereferenceObject(Connection);
+}
+
+void
+LibTCPInitialize(void)
+{
+    DeferredFreeEntries = NULL;
+    KeInitializeSpinLock(&DeferredFreeLock);
+}
+
+NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHAR RecvBuffer, UINT RecvLen, UINT *Received, const int safe)
+{
+    PQUEUE_ENTRY qp, Partial = NULL;
+    PLIST_ENTRY Entry;
+    LIST_ENTRY ReadList;
     NTSTATUS Status;
-    UINT ReadLength, PayloadLength, Offset, Copied;
+    UINT ReadLength, PayloadLength, PartialOffset = 0, Copied;
     KIRQL OldIrql;
 
     (*Received) = 0;
 
     LockObject(Connection, &OldIrql);
 
-    if (!IsListEmpty(&Connection->PacketQueue))
-    {
-        while ((qp = LibTCPDequeuePacket(Connection)) != NULL)
-        {
-            p = qp->p;
-
-            /* Calculate the payload length first */
-            PayloadLength = p->tot_len;
-            PayloadLength -= qp->Offset;
-            Offset = qp->Offset;
-
-            /* Check if we're reading the whole buffer */
-            ReadLength = MIN(PayloadLength, RecvLen);
-            ASSERT(ReadLength != 0);
-            if (ReadLength != PayloadLength)
-            {
-                /* Save this one for later */
-                qp->Offset += ReadLength;
-                InsertHeadList(&Connection->PacketQueue, &qp->ListEntry);
-                qp = NULL;
-            }
-
-            UnlockObject(Connection, OldIrql);
-
-            Copied = pbuf_copy_partial(p, RecvBuffer, ReadLength, Offset);
-            ASSERT(Copied == ReadLength);
-
-            LockObject(Connection, &OldIrql);
-
-            /* Update trackers */
-            RecvLen -= ReadLength;
-            RecvBuffer += ReadLength;
-            (*Received) += ReadLength;
-
-            if (qp != NULL)
-            {
-                /* Use this special pbuf free callback function because we're outside tcpip thread */
-                pbuf_free_callback(qp->p);
-
-                ExFreeToNPagedLookasideList(&QueueEntryLookasideList, qp);
-            }
-            else
-            {
-                /* If we get here, it means we've filled the buffer */
-                ASSERT(RecvLen == 0);
-            }
-
-            ASSERT((*Received) != 0);
-            Status = STATUS_SUCCESS;
-
-            if (!RecvLen)
-                break;
-        }
-    }
-    else
+    if (IsListEmpty(&Connection->PacketQueue))
     {
         if (Connection->ReceiveShutdown)
             Status = Connection->ReceiveShutdownStatus;
         else
             Status = STATUS_PENDING;
+
+        UnlockObject(Connection, OldIrql);
+
+        return Status;
+    }
+
+    /* Take all the packets that fit at once instead of dropping
+     * the lock around the copy of every single one */
+    InitializeListHead(&ReadList);
+    ReadLength = RecvLen;
+    while (ReadLength && (qp = LibTCPDequeuePacket(Connection)) != NULL)
+    {
+        PayloadLength = qp->p->tot_len - qp->Offset;
+        ASSERT(PayloadLength != 0);
+
+        if (PayloadLength > ReadLength)
+        {
+            /* Save the rest of this one for later */
+            Partial = qp;
+            PartialOffset = qp->Offset;
+            qp->Offset += ReadLength;
+            InsertHeadList(&Connection->PacketQueue, &qp->ListEntry);
+            break;
+        }
+
+        ReadLength -= PayloadLength;
+        InsertTailList(&ReadList, &qp->ListEntry);
     }
 
     UnlockObject(Connection, OldIrql);
 
-    return Status;
+    for (Entry = ReadList.Flink; Entry != &ReadList; Entry = Entry->Flink)
+    {
+        qp = CONTAINING_RECORD(Entry, QUEUE_ENTRY, ListEntry);
+
+        PayloadLength = qp->p->tot_len - qp->Offset;
+        Copied = pbuf_copy_partial(qp->p, RecvBuffer, PayloadLength, qp->Offset);
+        ASSERT(Copied == PayloadLength);
+
+        RecvBuffer += PayloadLength;
+        (*Received) += PayloadLength;
+    }
+
+    if (Partial)
+    {
+        /* If we get here, this fills the buffer */
+        Copied = pbuf_copy_partial(Partial->p, RecvBuffer, ReadLength, PartialOffset);
+        ASSERT(Copied == ReadLength);
+
+        (*Received) += ReadLength;
+    }
+
+    ASSERT((*Received) != 0);
+    ExInterlockedAddLargeStatistic(&LibTCPStatistics.BytesReceived, *Received);
+    InterlockedExchangeAdd(&Connection->BytesConsumed, (LONG)*Received);
+
+    /* Free the packets we used up in one go. The entries stay linked
+     * in a ring when our list head on the stack goes away */
+    qp = NULL;
+    if (!IsListEmpty(&ReadList))
+    {
+        qp = CONTAINING_RECORD(ReadList.Flink, QUEUE_ENTRY, ListEntry);
+        RemoveEntryList(&ReadList);
+    }
+
+    if (safe)
+    {
+        LibTCPFreeDeferredQueueEntries();
+        if (qp) LibTCPFreeQueueEntries(qp);
+        LibTCPReceiveDone(Connection);
+    }
+    else
+    {
+        /* The pbufs may only be freed and the window opened in the tcpip thread */
+        if (qp) LibTCPDeferFreeQueueEntries(qp);
+
+        ReferenceObject(Connection);
+        InterlockedIncrement(&LibTCPStatistics.TcpipHops);
+        if (tcpip_callback_with_block(LibTCPReceiveDoneCallback, Connection, 0) != ERR_OK)
+        {
+            /* No message for the callback, a blocking post or the per-packet
+             * pbuf_free_callback would fail the same way. The entries and the
+             * byte count are picked up by the poll timer of the connection,
+             * so the window opens again even if no more packets come in */
+            DereferenceObject(Connection);
+        }
+    }
+
+    return STATUS_SUCCESS;
 }
 
 static
@@ -202,6 +353,30 @@ WaitForEventSafely(PRKEVENT Event)
     }
 }
 
+static
+void
+LibTCPQueueCallback(tcpip_callback_fn function, void *arg)
+{
+    InterlockedIncrement(&LibTCPStatistics.TcpipHops);
+
+    tcpip_callback_with_block(function, arg, 1);
+}
+
+/* Runs every TCP_SLOW_INTERVAL from the TCP timer */
+static
+err_t
+InternalPollEventHandler(void *arg, PTCP_PCB pcb)
+{
+    /* Make sure the socket didn't get closed */
+    if (!arg) return ERR_OK;
+
+    /* Catch up on the receive done callbacks we failed to post */
+    LibTCPFreeDeferredQueueEntries();
+    LibTCPReceiveDone(arg);
+
+    return ERR_OK;
+}
+
 static
 err_t
 InternalSendEventHandler(void *arg, PTCP_PCB pcb, const u16_t space)
@@ -231,9 +406,11 @@ InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t er
 
     if (p)
     {
-        LibTCPEnqueuePacket(Connection, p);
+        LibTCPFreeDeferredQueueEntries();
+        LibTCPReceiveDone(Connection);
 
-        tcp_recved(pcb, p->tot_len);
+        /* The window only opens again once this is read, see LibTCPReceiveDone */
+        LibTCPEnqueuePacket(Connection, p);
 
         TCPRecvEventHandler(arg);
     }
@@ -349,7 +526,7 @@ LibTCPSocket(void *arg)
         KeInitializeEvent(&msg->Event, NotificationEvent, FALSE);
         msg->Input.Socket.Arg = arg;
 
-        tcpip_callback_with_block(LibTCPSocketCallback, msg, 1);
+        LibTCPQueueCallback(LibTCPSocketCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Socket.NewPcb;
@@ -404,7 +581,7 @@ LibTCPBind(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, const
         msg->Input.Bind.IpAddress = ipaddr;
         msg->Input.Bind.Port = port;
 
-        tcpip_callback_with_block(LibTCPBindCallback, msg, 1);
+        LibTCPQueueCallback(LibTCPBindCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Bind.Error;
@@ -457,7 +634,7 @@ LibTCPListen(PCONNECTION_ENDPOINT Connection, const u8_t backlog)
         msg->Input.Listen.Connection = Connection;
         msg->Input.Listen.Backlog = backlog;
 
-        tcpip_callback_with_block(LibTCPListenCallback, msg, 1);
+        LibTCPQueueCallback(LibTCPListenCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Listen.NewPcb;
@@ -521,6 +698,7 @@ LibTCPSendCallback(void *arg)
         /* Queued successfully so try to send it */
         tcp_output((PTCP_PCB)msg->Input.Send.Connection->SocketContext);
         msg->Output.Send.Information = SendLength;
+        ExInterlockedAddLargeStatistic(&LibTCPStatistics.BytesSent, SendLength);
     }
     else if (msg->Output.Send.Error == ERR_MEM)
     {
@@ -549,7 +727,7 @@ LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len
         if (safe)
             LibTCPSendCallback(msg);
         else
-            tcpip_callback_with_block(LibTCPSendCallback, msg, 1);
+            LibTCPQueueCallback(LibTCPSendCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Send.Error;
@@ -569,6 +747,46 @@ LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len
     return ERR_MEM;
 }
 
+static
+void
+LibTCPSendQueueCallback(void *arg)
+{
+    PCONNECTION_ENDPOINT Connection = arg;
+
+    /* Sends queued after this point need another wake-up */
+    InterlockedExchange(&Connection->SendQueued, FALSE);
+
+    TCPSendEventHandler(Connection, 0);
+
+    DereferenceObject(Connection);
+}
+
+/* Has the tcpip thread submit the send queue of the connection. Sends
+ * queued before it gets to run are submitted by the same wake-up */
+err_t
+LibTCPSendQueue(PCONNECTION_ENDPOINT Connection)
+{
+    err_t ret;
+
+    if (InterlockedExchange(&Connection->SendQueued, TRUE))
+    {
+        InterlockedIncrement(&LibTCPStatistics.QueuedSends);
+        return ERR_OK;
+    }
+
+    ReferenceObject(Connection);
+    InterlockedIncrement(&LibTCPStatistics.TcpipHops);
+
+    ret = tcpip_callback_with_block(LibTCPSendQueueCallback, Connection, 1);
+    if (ret != ERR_OK)
+    {
+        InterlockedExchange(&Connection->SendQueued, FALSE);
+        DereferenceObject(Connection);
+    }
+
+    return ret;
+}
+
 static
 void
 LibTCPConnectCallback(void *arg)
@@ -586,6 +804,7 @@ LibTCPConnectCallback(void *arg)
 
     tcp_recv((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalRecvEventHandler);
     tcp_sent((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalSendEventHandler);
+    tcp_poll((PTCP_PCB)msg->Input.Connect.Connection->SocketContext, InternalPollEventHandler, 1);
 
     Error = tcp_connect((PTCP_PCB)msg->Input.Connect.Connection->SocketContext,
                         msg->Input.Connect.IpAddress, ntohs(msg->Input.Connect.Port),
@@ -611,7 +830,7 @@ LibTCPConnect(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, con
         msg->Input.Connect.IpAddress = ipaddr;
         msg->Input.Connect.Port = port;
 
-        tcpip_callback_with_block(LibTCPConnectCallback, msg, 1);
+        LibTCPQueueCallback(LibTCPConnectCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
         {
@@ -694,7 +913,7 @@ LibTCPShutdown(PCONNECTION_ENDPOINT Connection, const int shut_rx, const int shu
         msg->Input.Shutdown.shut_rx = shut_rx;
         msg->Input.Shutdown.shut_tx = shut_tx;
 
-        tcpip_callback_with_block(LibTCPShutdownCallback, msg, 1);
+        LibTCPQueueCallback(LibTCPShutdownCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Shutdown.Error;
@@ -718,6 +937,7 @@ LibTCPCloseCallback(void *arg)
 
     /* Empty the queue even if we're already "closed" */
     LibTCPEmptyQueue(msg->Input.Close.Connection);
+    LibTCPFreeDeferredQueueEntries();
 
     /* Check if we've already been closed */
     if (msg->Input.Close.Connection->Closing)
@@ -777,7 +997,7 @@ LibTCPClose(PCONNECTION_ENDPOINT Connection, const int safe, const int callback)
         if (safe)
             LibTCPCloseCallback(msg);
         else
-            tcpip_callback_with_block(LibTCPCloseCallback, msg, 1);
+            LibTCPQueueCallback(LibTCPCloseCallback, msg);
 
         if (WaitForEventSafely(&msg->Event))
             ret = msg->Output.Close.Error;
@@ -800,6 +1020,7 @@ LibTCPAccept(PTCP_PCB pcb, struct tcp_pcb *listen_pcb, void *arg)
     tcp_arg(pcb, NULL);
     tcp_recv(pcb, InternalRecvEventHandler);
     tcp_sent(pcb, InternalSendEventHandler);
+    tcp_poll(pcb, InternalPollEventHandler, 1);
     tcp_err(pcb, InternalErrorEventHandler);
     tcp_arg(pcb, arg);
 
@@ -841,6 +1062,88 @@ LibTCPSetNoDelay(
         pcb->flags &= ~TF_NODELAY;
 }
 
+static
+void
+LibTCPSetReceiveWindowCallback(void *arg)
+{
+    struct lwip_callback_msg *msg = arg;
+    PTCP_PCB pcb = msg->Input.Window.Connection->SocketContext;
+    tcpwnd_size_t InUse, Size;
+
+    if (!pcb)
+    {
+        msg->Output.Window.Error = ERR_CLSD;
+        goto done;
+    }
+
+    /* A listening pcb is a tcp_pcb_listen, which has no window at all */
+    if (pcb->state == LISTEN)
+    {
+        msg->Output.Window.Error = ERR_VAL;
+        goto done;
+    }
+
+    /* Not connected yet, or not anymore. There is no peer to tell */
+    if (pcb->state < ESTABLISHED || pcb->state == TIME_WAIT)
+    {
+        msg->Output.Window.Error = ERR_CONN;
+        goto done;
+    }
+
+    /* Below two segments the sender has to wait for our delayed ACKs, and
+     * we can't go beyond the window the scale factor on the SYN allows */
+    Size = LWIP_MAX(msg->Input.Window.Size, 2 * TCP_MSS);
+    Size = LWIP_MIN(Size, TCP_WND);
+
+    /* Keep whatever is not tcp_recved yet accounted for. A smaller window only
+     * takes effect for data the peer sends after this, never retracting what
+     * was already announced */
+    InUse = TCP_WND_MAX(pcb) - pcb->rcv_wnd;
+    pcb->rcv_wnd_max = Size;
+    pcb->rcv_wnd = (TCP_WND_MAX(pcb) > InUse) ? TCP_WND_MAX(pcb) - InUse : 0;
+
+    /* A bigger window is worth telling the peer right away */
+    if (tcp_update_rcv_ann_wnd(pcb) >= TCP_WND_UPDATE_THRESHOLD)
+    {
+        tcp_ack_now(pcb);
+        tcp_output(pcb);
+    }
+
+    msg->Output.Window.Error = ERR_OK;
+
+done:
+    KeSetEvent(&msg->Event, IO_NO_INCREMENT, FALSE);
+}
+
+err_t
+LibTCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, const u32_t size)
+{
+    struct lwip_callback_msg *msg;
+    err_t ret;
+
+    msg = ExAllocateFromNPagedLookasideList(&MessageLookasideList);
+    if (msg)
+    {
+        KeInitializeEvent(&msg->Event, NotificationEvent, FALSE);
+
+        msg->Input.Window.Connection = Connection;
+        msg->Input.Window.Size = size;
+
+        LibTCPQueueCallback(LibTCPSetReceiveWindowCallback, msg);
+
+        if (WaitForEventSafely(&msg->Event))
+            ret = msg->Output.Window.Error;
+        else
+            ret = ERR_CLSD;
+
+        ExFreeToNPagedLookasideList(&MessageLookasideList, msg);
+
+        return ret;
+    }
+
+    return ERR_MEM;
+}
+
 void
 LibTCPGetSocketStatus(
     PTCP_PCB pcb,
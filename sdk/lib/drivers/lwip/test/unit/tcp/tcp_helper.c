@@ -36,24 +36,29 @@ tcp_remove_all(void)
   fail_unless(lwip_stats.memp[MEMP_PBUF_POOL].used == 0);
 }
 
-/** Create a TCP segment usable for passing to tcp_input */
+/** Create a TCP segment with options usable for passing to tcp_input */
 static struct pbuf*
-tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+tcp_create_segment_wnd_opts(ip_addr_t* src_ip, ip_addr_t* dst_ip,
                    u16_t src_port, u16_t dst_port, void* data, size_t data_len,
-                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd)
+                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd,
+                   u8_t* opts, u8_t optlen)
 {
   struct pbuf *p, *q;
   struct ip_hdr* iphdr;
   struct tcp_hdr* tcphdr;
-  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + sizeof(struct tcp_hdr) + data_len);
+  u16_t hdrlen = (u16_t)(sizeof(struct tcp_hdr) + optlen);
+  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + hdrlen + data_len);
+
+  /* options are padded by the caller */
+  EXPECT_RETNULL((optlen & 3) == 0);
 
   p = pbuf_alloc(PBUF_RAW, pbuf_len, PBUF_POOL);
   EXPECT_RETNULL(p != NULL);
   /* first pbuf must be big enough to hold the headers */
-  EXPECT_RETNULL(p->len >= (sizeof(struct ip_hdr) + sizeof(struct tcp_hdr)));
+  EXPECT_RETNULL(p->len >= (sizeof(struct ip_hdr) + hdrlen));
   if (data_len > 0) {
     /* first pbuf must be big enough to hold at least 1 data byte, too */
-    EXPECT_RETNULL(p->len > (sizeof(struct ip_hdr) + sizeof(struct tcp_hdr)));
+    EXPECT_RETNULL(p->len > (sizeof(struct ip_hdr) + hdrlen));
   }
 
   for(q = p; q != NULL; q = q->next) {
@@ -77,17 +82,20 @@ tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
   tcphdr->dest  = htons(dst_port);
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
-  TCPH_HDRLEN_SET(tcphdr, sizeof(struct tcp_hdr)/4);
+  TCPH_HDRLEN_SET(tcphdr, hdrlen/4);
   TCPH_FLAGS_SET(tcphdr, headerflags);
   tcphdr->wnd   = htons(wnd);
+  if (optlen > 0) {
+    memcpy(tcphdr + 1, opts, optlen);
+  }
 
   if (data_len > 0) {
     /* let p point to TCP data */
-    pbuf_header(p, -(s16_t)sizeof(struct tcp_hdr));
+    pbuf_header(p, -(s16_t)hdrlen);
     /* copy data */
     pbuf_take(p, data, data_len);
     /* let p point to TCP header again */
-    pbuf_header(p, sizeof(struct tcp_hdr));
+    pbuf_header(p, hdrlen);
   }
 
   /* calculate checksum */
@@ -100,6 +108,16 @@ tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
   return p;
 }
 
+/** Create a TCP segment usable for passing to tcp_input */
+static struct pbuf*
+tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+                   u16_t src_port, u16_t dst_port, void* data, size_t data_len,
+                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd)
+{
+  return tcp_create_segment_wnd_opts(src_ip, dst_ip, src_port, dst_port, data,
+    data_len, seqno, ackno, headerflags, wnd, NULL, 0);
+}
+
 /** Create a TCP segment usable for passing to tcp_input */
 struct pbuf*
 tcp_create_segment(ip_addr_t* src_ip, ip_addr_t* dst_ip,
@@ -107,7 +125,19 @@ tcp_create_segment(ip_addr_t* src_ip, ip_addr_t* dst_ip,
                    u32_t seqno, u32_t ackno, u8_t headerflags)
 {
   return tcp_create_segment_wnd(src_ip, dst_ip, src_port, dst_port, data,
-    data_len, seqno, ackno, headerflags, TCP_WND);
+    data_len, seqno, ackno, headerflags, TCPWND16(TCP_WND));
+}
+
+/** Create a TCP segment with options (e.g. a SYN) usable for passing to tcp_input
+ * - the options must be padded to a multiple of 4 bytes
+ */
+struct pbuf*
+tcp_create_segment_opts(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+                   u16_t src_port, u16_t dst_port, u32_t seqno, u32_t ackno,
+                   u8_t headerflags, u16_t wnd, u8_t* opts, u8_t optlen)
+{
+  return tcp_create_segment_wnd_opts(src_ip, dst_ip, src_port, dst_port, NULL,
+    0, seqno, ackno, headerflags, wnd, opts, optlen);
 }
 
 /** Create a TCP segment usable for passing to tcp_input
@@ -654,6 +654,339 @@ START_TEST(test_tcp_tx_full_window_lost_from_unacked)
 }
 END_TEST
 
+#if LWIP_WND_SCALE || LWIP_TCP_SACK_OUT
+/** Find a TCP option in a segment sent through the test netif.
+ * Returns a pointer to the option kind byte or NULL if not found. */
+static u8_t*
+test_tcp_find_option(struct pbuf *p, u8_t kind)
+{
+  u8_t *tcphdr = (u8_t*)p->payload + sizeof(struct ip_hdr);
+  u16_t hdrlen = TCPH_HDRLEN((struct tcp_hdr*)tcphdr) * 4;
+  u16_t i = sizeof(struct tcp_hdr);
+
+  while (i < hdrlen) {
+    if (tcphdr[i] == 0) {
+      break;
+    } else if (tcphdr[i] == 1) {
+      i++;
+    } else if (tcphdr[i] == kind) {
+      return &tcphdr[i];
+    } else {
+      if ((i + 1 >= hdrlen) || (tcphdr[i + 1] < 2)) {
+        break;
+      }
+      i += tcphdr[i + 1];
+    }
+  }
+  return NULL;
+}
+
+/** Get the window field of a segment sent through the test netif */
+static u16_t
+test_tcp_sent_wnd(struct pbuf *p)
+{
+  struct tcp_hdr *tcphdr = (struct tcp_hdr*)((u8_t*)p->payload + sizeof(struct ip_hdr));
+  return ntohs(tcphdr->wnd);
+}
+#endif /* LWIP_WND_SCALE || LWIP_TCP_SACK_OUT */
+
+#if LWIP_WND_SCALE
+static struct tcp_pcb* test_tcp_accepted_pcb;
+
+static err_t
+test_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  test_tcp_accepted_pcb = newpcb;
+  return ERR_OK;
+}
+
+/** Passive open with or without the window scale option from the peer */
+static void
+test_tcp_wnd_scale_passive(u8_t offer_scale)
+{
+  /* MSS 1460, NOP + window scale 7, NOP NOP + SACK permitted */
+  u8_t opts[] = {2, 4, 0x05, 0xB4, 1, 3, 3, 7, 1, 1, 4, 2};
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct tcp_pcb *pcb, *lpcb, *npcb;
+  struct pbuf *p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u8_t *opt;
+  u32_t seqno = 0x12345678;
+  err_t err;
+
+  IP4_ADDR(&local_ip,  192, 168,   1, 1);
+  IP4_ADDR(&remote_ip, 192, 168,   1, 2);
+  IP4_ADDR(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  test_tcp_accepted_pcb = NULL;
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  err = tcp_bind(pcb, &local_ip, local_port);
+  EXPECT_RET(err == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_accept);
+
+  /* the SYN: without scaling, send only MSS */
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, remote_port, local_port,
+    seqno, 0, TCP_SYN, 0xFFFF, opts, offer_scale ? sizeof(opts) : 4);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 1);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+
+  npcb = tcp_active_pcbs;
+  EXPECT_RET(npcb != NULL);
+  EXPECT(npcb->state == SYN_RCVD);
+
+  /* the SYN-ACK only carries the option if the peer sent it, and its
+     window is never scaled */
+  opt = test_tcp_find_option(txcounters.tx_packets, 3);
+  if (offer_scale) {
+    EXPECT(opt != NULL);
+    if (opt != NULL) {
+      EXPECT(opt[1] == 3);
+      EXPECT(opt[2] == TCP_RCV_SCALE);
+    }
+    EXPECT((npcb->flags & TF_WND_SCALE) != 0);
+    EXPECT(npcb->snd_scale == 7);
+    EXPECT(npcb->rcv_scale == TCP_RCV_SCALE);
+    EXPECT(npcb->rcv_wnd == TCP_WND);
+  } else {
+    EXPECT(opt == NULL);
+    EXPECT((npcb->flags & TF_WND_SCALE) == 0);
+    EXPECT(npcb->rcv_wnd == TCPWND16(TCP_WND));
+  }
+  EXPECT(test_tcp_sent_wnd(txcounters.tx_packets) == TCPWND16(TCP_WND));
+#if LWIP_TCP_SACK_OUT
+  EXPECT((test_tcp_find_option(txcounters.tx_packets, 4) != NULL) == (offer_scale != 0));
+  EXPECT(((npcb->flags & TF_SACK) != 0) == (offer_scale != 0));
+#endif /* LWIP_TCP_SACK_OUT */
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* the final ACK: from now on, the peer's window is scaled */
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, remote_port, local_port,
+    seqno + 1, npcb->snd_nxt, TCP_ACK, 100, NULL, 0);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(npcb->state == ESTABLISHED);
+  EXPECT(test_tcp_accepted_pcb == npcb);
+  EXPECT(npcb->snd_wnd == (offer_scale ? (100U << 7) : 100U));
+
+  tcp_abort(npcb);
+  EXPECT(tcp_close(lpcb) == ERR_OK);
+  if (txcounters.tx_packets != NULL) {
+    pbuf_free(txcounters.tx_packets);
+  }
+  EXPECT(lwip_stats.memp[MEMP_TCP_PCB].used == 0);
+  EXPECT(lwip_stats.memp[MEMP_TCP_PCB_LISTEN].used == 0);
+}
+
+/** Receive a SYN with the window scale option and check that it is answered
+ * and used for the peer's window */
+START_TEST(test_tcp_wnd_scale_syn)
+{
+  LWIP_UNUSED_ARG(_i);
+  test_tcp_wnd_scale_passive(1);
+}
+END_TEST
+
+/** Receive a SYN without the window scale option and check that we don't scale */
+START_TEST(test_tcp_wnd_scale_syn_no_option)
+{
+  LWIP_UNUSED_ARG(_i);
+  test_tcp_wnd_scale_passive(0);
+}
+END_TEST
+
+/** Check that the announced window is scaled down and that tcp_recved never
+ * opens the window beyond its current maximum */
+START_TEST(test_tcp_wnd_scale_recved)
+{
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[100];
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u16_t i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (char)i;
+  }
+  IP4_ADDR(&local_ip,  192, 168,   1, 1);
+  IP4_ADDR(&remote_ip, 192, 168,   1, 2);
+  IP4_ADDR(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = sizeof(data);
+  counters.expected_data = data;
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  /* as if negotiated on the SYN */
+  pcb->flags |= TF_WND_SCALE;
+  pcb->rcv_scale = TCP_RCV_SCALE;
+  pcb->rcv_wnd = pcb->rcv_ann_wnd = TCP_WND;
+
+  /* the data is not tcp_recved, so the window shrinks */
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, TCP_PSH);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recved_bytes == sizeof(data));
+  EXPECT(pcb->rcv_wnd == TCP_WND - sizeof(data));
+
+  tcp_ack_now(pcb);
+  err = tcp_output(pcb);
+  EXPECT(err == ERR_OK);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(test_tcp_sent_wnd(txcounters.tx_packets) ==
+    TCPWND16((TCP_WND - sizeof(data)) >> TCP_RCV_SCALE));
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* too much tcp_recved must not open the window beyond its maximum */
+  tcp_recved(pcb, sizeof(data));
+  EXPECT(pcb->rcv_wnd == TCP_WND);
+  tcp_recved(pcb, 0xFFFF);
+  EXPECT(pcb->rcv_wnd == TCP_WND);
+
+  /* a smaller maximum, like a smaller SO_RCVBUF */
+  pcb->rcv_wnd_max = TCP_WND / 2;
+  tcp_recved(pcb, 1);
+  EXPECT(pcb->rcv_wnd == TCP_WND / 2);
+
+  tcp_abort(pcb);
+  if (txcounters.tx_packets != NULL) {
+    pbuf_free(txcounters.tx_packets);
+  }
+  EXPECT(lwip_stats.memp[MEMP_TCP_PCB].used == 0);
+}
+END_TEST
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_TCP_SACK_OUT
+/** Check the SACK option of the last ACK sent: the blocks relative to
+ * the initial rcv_nxt, 0 ends the list */
+static void
+test_tcp_check_sack(struct test_tcp_txcounters *txcounters, u32_t base, const u32_t *blocks)
+{
+  u8_t *opt;
+  u32_t edge;
+  u16_t i, count = 0;
+
+  while (blocks[count * 2 + 1] != 0) {
+    count++;
+  }
+
+  EXPECT_RET(txcounters->tx_packets != NULL);
+  opt = test_tcp_find_option(txcounters->tx_packets, 5);
+  EXPECT(opt != NULL);
+  if (opt != NULL) {
+    EXPECT(opt[1] == 2 + 8 * count);
+    for (i = 0; (i < count * 2) && (i * 4 + 2 < opt[1]); i++) {
+      memcpy(&edge, &opt[2 + i * 4], sizeof(edge));
+      EXPECT(ntohl(edge) == base + blocks[i]);
+    }
+  }
+  pbuf_free(txcounters->tx_packets);
+  txcounters->tx_packets = NULL;
+}
+
+/** Receive out-of-sequence data and check that the duplicate ACKs tell the
+ * sender which blocks arrived, the most recent one first */
+START_TEST(test_tcp_sack_out)
+{
+  /* left and right edges of the expected blocks */
+  static const u32_t first[] = {20, 30, 0, 0};
+  static const u32_t second[] = {40, 50, 20, 30, 0, 0};
+  static const u32_t merged[] = {20, 50, 0, 0};
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[50];
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t remote_port = 0x100, local_port = 0x101;
+  u32_t base;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (char)i;
+  }
+  IP4_ADDR(&local_ip,  192, 168,   1, 1);
+  IP4_ADDR(&remote_ip, 192, 168,   1, 2);
+  IP4_ADDR(&netmask,   255, 255, 255, 0);
+  test_tcp_init_netif(&netif, &txcounters, &local_ip, &netmask);
+  memset(&txcounters, 0, sizeof(txcounters));
+  txcounters.copy_tx_packets = 1;
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = sizeof(data);
+  counters.expected_data = data;
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, local_port, remote_port);
+  /* as if negotiated on the SYN */
+  pcb->flags |= TF_SACK;
+  base = pcb->rcv_nxt;
+
+  /* [20,30) */
+  p = tcp_create_rx_segment(pcb, &data[20], 10, 20, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  test_tcp_check_sack(&txcounters, base, first);
+
+  /* [40,50) is reported first */
+  p = tcp_create_rx_segment(pcb, &data[40], 10, 40, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 2);
+  test_tcp_check_sack(&txcounters, base, second);
+
+  /* [30,40) fills the hole between the two */
+  p = tcp_create_rx_segment(pcb, &data[30], 10, 30, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 3);
+  test_tcp_check_sack(&txcounters, base, merged);
+
+  /* [0,20) delivers everything */
+  p = tcp_create_rx_segment(pcb, data, 20, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recved_bytes == sizeof(data));
+  EXPECT(counters.err_calls == 0);
+  EXPECT(pcb->ooseq == NULL);
+  EXPECT(pcb->rcv_nxt == base + sizeof(data));
+
+  tcp_abort(pcb);
+  if (txcounters.tx_packets != NULL) {
+    pbuf_free(txcounters.tx_packets);
+  }
+  EXPECT(lwip_stats.memp[MEMP_TCP_PCB].used == 0);
+}
+END_TEST
+#endif /* LWIP_TCP_SACK_OUT */
+
 /** Create the suite including all tests for this module */
 Suite *
 tcp_suite(void)
@@ -665,7 +998,15 @@ tcp_suite(void)
     test_tcp_fast_rexmit_wraparound,
     test_tcp_rto_rexmit_wraparound,
     test_tcp_tx_full_window_lost_from_unacked,
-    test_tcp_tx_full_window_lost_from_unsent
+    test_tcp_tx_full_window_lost_from_unsent,
+#if LWIP_WND_SCALE
+    test_tcp_wnd_scale_syn,
+    test_tcp_wnd_scale_syn_no_option,
+    test_tcp_wnd_scale_recved,
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+    test_tcp_sack_out,
+#endif /* LWIP_TCP_SACK_OUT */
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(TFun), tcp_setup, tcp_teardown);
 }
@@ -10,16 +10,31 @@
 
 /* INCLUDES *****************************************************************/
 
+#ifndef XPRESS_HOST
 #include <rtl.h>
 
 #define NDEBUG
 #include <debug.h>
+#endif
+
+#include "xpress.h"
 
 /* MACROS *******************************************************************/
 
 #define COMPRESSION_FORMAT_MASK  0x00FF
 #define COMPRESSION_ENGINE_MASK  0xFF00
 
+/* LZNT1 match finder, the maximum engine searches much deeper */
+#define LZNT1_CHUNK_SIZE         0x1000
+#define LZNT1_HASH_BITS          12
+#define LZNT1_STANDARD_DEPTH     4
+#define LZNT1_MAXIMUM_DEPTH      256
+
+typedef struct _LZNT1_WORKSPACE
+{
+    USHORT Head[1 << LZNT1_HASH_BITS];
+    USHORT Chain[LZNT1_CHUNK_SIZE];
+} LZNT1_WORKSPACE, *PLZNT1_WORKSPACE;
 
 
 
@@ -216,28 +231,136 @@ out:
 }
 
 
+static ULONG lznt1_hash(const UCHAR *data)
+{
+    return ((data[0] | (data[1] << 8) | (data[2] << 16)) * 0x9E3779B1) >> (32 - LZNT1_HASH_BITS);
+}
+
+/* compress a single LZNT1 chunk, returns 0 if the result doesn't fit into dst */
+static ULONG lznt1_compress_chunk(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
+                                  LZNT1_WORKSPACE *workspace, ULONG max_depth)
+{
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size, *flags;
+    ULONG displacement_bits, length_bits, max_length, max_displacement;
+    ULONG pos = 0, length, best_length, best_displacement, depth, hash, i;
+    USHORT next;
+
+    memset(workspace->Head, 0, sizeof(workspace->Head));
+
+    while (pos < src_size)
+    {
+        /* flags header for the following 8 entities */
+        if (dst_cur >= dst_end) return 0;
+        flags = dst_cur++;
+        *flags = 0;
+
+        for (i = 0; i < 8 && pos < src_size; i++)
+        {
+            /* the split between displacement and length grows with the position */
+            for (displacement_bits = 12; displacement_bits > 4; displacement_bits--)
+                if ((1 << (displacement_bits - 1)) < pos) break;
+            length_bits      = 16 - displacement_bits;
+            max_length       = min((1 << length_bits) - 1 + 3, src_size - pos);
+            max_displacement = 1 << displacement_bits;
+
+            best_length = 0;
+            best_displacement = 0;
+            if (max_length >= 3)
+            {
+                hash = lznt1_hash(src + pos);
+                next = workspace->Head[hash];
+                workspace->Chain[pos] = next;
+                workspace->Head[hash] = pos + 1;
+
+                for (depth = max_depth; next && depth; depth--)
+                {
+                    next--;
+                    if (pos - next > max_displacement) break;
+
+                    for (length = 0; length < max_length && src[next + length] == src[pos + length]; length++);
+                    if (length > best_length)
+                    {
+                        best_length = length;
+                        best_displacement = pos - next;
+                        if (length == max_length) break;
+                    }
+
+                    next = workspace->Chain[next];
+                }
+            }
+
+            if (best_length >= 3)
+            {
+                /* backwards reference */
+                if (dst_cur + sizeof(WORD) > dst_end) return 0;
+                *(WORD *)dst_cur = ((best_displacement - 1) << length_bits) | (best_length - 3);
+                dst_cur += sizeof(WORD);
+                *flags |= 1 << i;
+
+                /* remember the positions covered by the reference */
+                for (length = 1; length < best_length; length++)
+                {
+                    if (pos + length + 3 > src_size) break;
+                    hash = lznt1_hash(src + pos + length);
+                    workspace->Chain[pos + length] = workspace->Head[hash];
+                    workspace->Head[hash] = pos + length + 1;
+                }
+                pos += best_length;
+            }
+            else
+            {
+                /* uncompressed data */
+                if (dst_cur >= dst_end) return 0;
+                *dst_cur++ = src[pos++];
+            }
+        }
+    }
+
+    return dst_cur - dst;
+}
+
 static NTSTATUS
 RtlpCompressBufferLZNT1(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
-                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace)
+                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace,
+                        BOOLEAN maximum)
 {
         UCHAR *src_cur = src, *src_end = src + src_size;
         UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
-        ULONG block_size;
+        ULONG block_size, compressed_size;
 
         while (src_cur < src_end)
         {
             /* determine size of current chunk */
-            block_size = min(0x1000, src_end - src_cur);
-            if (dst_cur + sizeof(WORD) + block_size > dst_end)
+            block_size = min(LZNT1_CHUNK_SIZE, src_end - src_cur);
+            if (dst_cur + sizeof(WORD) > dst_end)
                 return STATUS_BUFFER_TOO_SMALL;
 
-            /* write (uncompressed) chunk header */
-            *(WORD *)dst_cur = 0x3000 | (block_size - 1);
-            dst_cur += sizeof(WORD);
+            /* only keep the compressed chunk if it is smaller, otherwise store it */
+            compressed_size = lznt1_compress_chunk(src_cur, block_size, dst_cur + sizeof(WORD),
+                                                   min(block_size - 1, dst_end - dst_cur - sizeof(WORD)),
+                                                   (LZNT1_WORKSPACE *)workspace,
+                                                   maximum ? LZNT1_MAXIMUM_DEPTH : LZNT1_STANDARD_DEPTH);
+
+            if (compressed_size)
+            {
+                /* write (compressed) chunk header */
+                *(WORD *)dst_cur = 0xB000 | (compressed_size - 1);
+                dst_cur += sizeof(WORD) + compressed_size;
+            }
+            else
+            {
+                if (dst_cur + sizeof(WORD) + block_size > dst_end)
+                    return STATUS_BUFFER_TOO_SMALL;
+
+                /* write (uncompressed) chunk header */
+                *(WORD *)dst_cur = 0x3000 | (block_size - 1);
+                dst_cur += sizeof(WORD);
+
+                /* write chunk content */
+                memcpy(dst_cur, src_cur, block_size);
+                dst_cur += block_size;
+            }
 
-            /* write chunk content */
-            memcpy(dst_cur, src_cur, block_size);
-            dst_cur += block_size;
             src_cur += block_size;
         }
 
@@ -248,28 +371,113 @@ RtlpCompressBufferLZNT1(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
 }
 
 
+/* describe the LZNT1 chunk at *src, the chunk includes its header */
+static NTSTATUS lznt1_describe_chunk(UCHAR **src, UCHAR *src_end, UCHAR **chunk, ULONG *chunk_size)
+{
+    WORD chunk_header;
+    ULONG size;
+
+    *chunk = *src;
+    *chunk_size = 0;
+
+    /* the end of data is marked by a zero header or the end of the buffer */
+    if (*src + sizeof(WORD) > src_end)
+        return STATUS_NO_MORE_ENTRIES;
+
+    chunk_header = *(WORD *)*src;
+    if (!chunk_header)
+        return STATUS_NO_MORE_ENTRIES;
+
+    size = sizeof(WORD) + (chunk_header & 0xFFF) + 1;
+    if (*src + size > src_end)
+        return STATUS_BAD_COMPRESSION_BUFFER;
+
+    *src += size;
+    *chunk_size = size;
+    return STATUS_SUCCESS;
+}
+
+/* reserve a chunk at *dst, size 0 stands for all zeros and
+ * LZNT1_CHUNK_SIZE for uncompressed data which gets a header */
+static NTSTATUS lznt1_reserve_chunk(UCHAR **dst, UCHAR *dst_end, UCHAR **chunk, ULONG chunk_size)
+{
+    /* literal 0 followed by a 4095 byte backwards reference */
+    static const UCHAR zero_chunk[] = { 0x03, 0xB0, 0x02, 0x00, 0xFC, 0x0F };
+    ULONG size;
+
+    if (!chunk_size)
+        size = sizeof(zero_chunk);
+    else if (chunk_size == LZNT1_CHUNK_SIZE)
+        size = sizeof(WORD) + LZNT1_CHUNK_SIZE;
+    else if (chunk_size <= sizeof(WORD) + LZNT1_CHUNK_SIZE)
+        size = chunk_size;
+    else
+        return STATUS_INVALID_PARAMETER;
+
+    if (*dst + size > dst_end)
+        return STATUS_BUFFER_TOO_SMALL;
+
+    *chunk = *dst;
+    if (!chunk_size)
+    {
+        memcpy(*dst, zero_chunk, sizeof(zero_chunk));
+    }
+    else if (chunk_size == LZNT1_CHUNK_SIZE)
+    {
+        *(WORD *)*dst = 0x3000 | (LZNT1_CHUNK_SIZE - 1);
+        *chunk += sizeof(WORD);
+    }
+
+    *dst += size;
+    return STATUS_SUCCESS;
+}
+
+/* check whether a chunk only contains zeros */
+static BOOLEAN is_zero_chunk(const UCHAR *data, ULONG size)
+{
+    while (size--)
+        if (*data++) return FALSE;
+
+    return TRUE;
+}
+
+
 static NTSTATUS
 RtlpWorkSpaceSizeLZNT1(USHORT Engine,
                        PULONG BufferAndWorkSpaceSize,
                        PULONG FragmentWorkSpaceSize)
 {
-   if (Engine == COMPRESSION_ENGINE_STANDARD)
+   C_ASSERT(sizeof(LZNT1_WORKSPACE) <= 0x8010);
+
+   if ((Engine == COMPRESSION_ENGINE_STANDARD) ||
+         (Engine == COMPRESSION_ENGINE_MAXIMUM))
    {
       *BufferAndWorkSpaceSize = 0x8010;
       *FragmentWorkSpaceSize = 0x1000;
       return(STATUS_SUCCESS);
    }
-   else if (Engine == COMPRESSION_ENGINE_MAXIMUM)
-   {
-      *BufferAndWorkSpaceSize = 0x10;
-      *FragmentWorkSpaceSize = 0x1000;
-      return(STATUS_SUCCESS);
-   }
 
    return(STATUS_NOT_SUPPORTED);
 }
 
 
+static NTSTATUS
+RtlpWorkSpaceSizeXpress(USHORT Format,
+                        USHORT Engine,
+                        PULONG BufferAndWorkSpaceSize,
+                        PULONG FragmentWorkSpaceSize)
+{
+   if ((Engine != COMPRESSION_ENGINE_STANDARD) &&
+         (Engine != COMPRESSION_ENGINE_MAXIMUM))
+      return(STATUS_NOT_SUPPORTED);
+
+   *BufferAndWorkSpaceSize = RtlpXpressWorkSpaceSize(Format == COMPRESSION_FORMAT_XPRESS_HUFF,
+                                                     Engine == COMPRESSION_ENGINE_MAXIMUM);
+   *FragmentWorkSpaceSize = 0;
+   return(STATUS_SUCCESS);
+}
+
+
 /*
  * @implemented
  */
@@ -284,7 +492,8 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                   IN PVOID WorkSpace)
 {
    USHORT Format = CompressionFormatAndEngine & COMPRESSION_FORMAT_MASK;
-   /* USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK; */
+   USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK;
+   BOOLEAN Maximum = (Engine == COMPRESSION_ENGINE_MAXIMUM);
 
    if ((Format == COMPRESSION_FORMAT_NONE) ||
          (Format == COMPRESSION_FORMAT_DEFAULT))
@@ -297,14 +506,37 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                                      CompressedBufferSize,
                                      UncompressedChunkSize,
                                      FinalCompressedSize,
-                                     WorkSpace));
+                                     WorkSpace,
+                                     Maximum));
+
+   if (Format == COMPRESSION_FORMAT_XPRESS)
+      return(RtlpXpressCompress(UncompressedBuffer,
+                                UncompressedBufferSize,
+                                CompressedBuffer,
+                                CompressedBufferSize,
+                                FinalCompressedSize,
+                                WorkSpace,
+                                Maximum));
+
+   if (Format == COMPRESSION_FORMAT_XPRESS_HUFF)
+      return(RtlpXpressHuffCompress(UncompressedBuffer,
+                                    UncompressedBufferSize,
+                                    CompressedBuffer,
+                                    CompressedBufferSize,
+                                    FinalCompressedSize,
+                                    WorkSpace,
+                                    Maximum));
 
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
 
 
 /*
- * @unimplemented
+ * @implemented
+ *
+ * Every chunk is compressed on its own, so that they can be decompressed
+ * independently. A chunk size of 0 in CompressedDataInfo stands for a chunk
+ * of zeros, the uncompressed size for a chunk that is stored as it is.
  */
 NTSTATUS NTAPI
 RtlCompressChunks(IN PUCHAR UncompressedBuffer,
@@ -315,12 +547,74 @@ RtlCompressChunks(IN PUCHAR UncompressedBuffer,
                   IN ULONG CompressedDataInfoLength,
                   IN PVOID WorkSpace)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    PUCHAR UncompressedEnd = UncompressedBuffer + UncompressedBufferSize;
+    PUCHAR CompressedEnd = CompressedBuffer + CompressedBufferSize;
+    ULONG ChunkSize, ChunkCount, Size, FinalSize, Index;
+    NTSTATUS Status;
+
+    if (CompressedDataInfo->ChunkShift < 9 || CompressedDataInfo->ChunkShift > 16)
+        return STATUS_INVALID_PARAMETER;
+
+    ChunkSize = 1 << CompressedDataInfo->ChunkShift;
+    ChunkCount = (UncompressedBufferSize >> CompressedDataInfo->ChunkShift) +
+                 ((UncompressedBufferSize & (ChunkSize - 1)) != 0);
+
+    /* NumberOfChunks is only a USHORT */
+    if (ChunkCount > MAXUSHORT)
+        return STATUS_INVALID_PARAMETER;
+
+    if (CompressedDataInfoLength < FIELD_OFFSET(COMPRESSED_DATA_INFO, CompressedChunkSizes) +
+                                   ChunkCount * sizeof(ULONG))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    CompressedDataInfo->NumberOfChunks = (USHORT)ChunkCount;
+
+    for (Index = 0; Index < ChunkCount; Index++)
+    {
+        Size = min(ChunkSize, UncompressedEnd - UncompressedBuffer);
+
+        if (is_zero_chunk(UncompressedBuffer, Size))
+        {
+            FinalSize = 0;
+        }
+        else
+        {
+            /* the result has to be smaller than the chunk to tell it apart */
+            Status = RtlCompressBuffer(CompressedDataInfo->CompressionFormatAndEngine,
+                                       UncompressedBuffer,
+                                       Size,
+                                       CompressedBuffer,
+                                       min(Size - 1, CompressedEnd - CompressedBuffer),
+                                       ChunkSize,
+                                       &FinalSize,
+                                       WorkSpace);
+            if (Status == STATUS_BUFFER_TOO_SMALL)
+            {
+                if ((ULONG)(CompressedEnd - CompressedBuffer) < Size)
+                    return STATUS_BUFFER_TOO_SMALL;
+
+                RtlCopyMemory(CompressedBuffer, UncompressedBuffer, Size);
+                FinalSize = Size;
+            }
+            else if (!NT_SUCCESS(Status))
+            {
+                return Status;
+            }
+        }
+
+        CompressedDataInfo->CompressedChunkSizes[Index] = FinalSize;
+        CompressedBuffer += FinalSize;
+        UncompressedBuffer += Size;
+    }
+
+    return STATUS_SUCCESS;
 }
 
 /*
- * @unimplemented
+ * @implemented
+ *
+ * Once a chunk doesn't fit into what is left of CompressedBuffer, it and
+ * all following chunks are taken from CompressedTail.
  */
 NTSTATUS NTAPI
 RtlDecompressChunks(OUT PUCHAR UncompressedBuffer,
@@ -331,8 +625,65 @@ RtlDecompressChunks(OUT PUCHAR UncompressedBuffer,
                     IN ULONG CompressedTailSize,
                     IN PCOMPRESSED_DATA_INFO CompressedDataInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    PUCHAR UncompressedEnd = UncompressedBuffer + UncompressedBufferSize;
+    PUCHAR CompressedEnd = CompressedBuffer + CompressedBufferSize;
+    ULONG ChunkSize, Size, CompressedSize, FinalSize, Index;
+    NTSTATUS Status;
+
+    if (CompressedDataInfo->ChunkShift < 9 || CompressedDataInfo->ChunkShift > 16)
+        return STATUS_INVALID_PARAMETER;
+
+    ChunkSize = 1 << CompressedDataInfo->ChunkShift;
+
+    for (Index = 0;
+         Index < CompressedDataInfo->NumberOfChunks && UncompressedBuffer < UncompressedEnd;
+         Index++)
+    {
+        Size = min(ChunkSize, UncompressedEnd - UncompressedBuffer);
+        CompressedSize = CompressedDataInfo->CompressedChunkSizes[Index];
+
+        if (!CompressedSize)
+        {
+            RtlZeroMemory(UncompressedBuffer, Size);
+            UncompressedBuffer += Size;
+            continue;
+        }
+
+        if (CompressedSize > (ULONG)(CompressedEnd - CompressedBuffer))
+        {
+            if (!CompressedTail || CompressedSize > CompressedTailSize)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+
+            CompressedBuffer = CompressedTail;
+            CompressedEnd = CompressedTail + CompressedTailSize;
+            CompressedTail = NULL;
+        }
+
+        if (CompressedSize == Size)
+        {
+            RtlCopyMemory(UncompressedBuffer, CompressedBuffer, Size);
+        }
+        else
+        {
+            Status = RtlDecompressBuffer(CompressedDataInfo->CompressionFormatAndEngine,
+                                         UncompressedBuffer,
+                                         Size,
+                                         CompressedBuffer,
+                                         CompressedSize,
+                                         &FinalSize);
+            if (!NT_SUCCESS(Status))
+                return Status;
+
+            /* short chunks are padded with zeros */
+            if (FinalSize < Size)
+                RtlZeroMemory(UncompressedBuffer + FinalSize, Size - FinalSize);
+        }
+
+        CompressedBuffer += CompressedSize;
+        UncompressedBuffer += Size;
+    }
+
+    return STATUS_SUCCESS;
 }
 
 /*
@@ -357,6 +708,28 @@ RtlDecompressFragment(IN USHORT format,
             return lznt1_decompress(uncompressed, uncompressed_size, compressed,
                                     compressed_size, offset, final_size, workspace);
 
+        case COMPRESSION_FORMAT_XPRESS:
+        case COMPRESSION_FORMAT_XPRESS_HUFF:
+        {
+            ULONG size;
+            NTSTATUS status;
+
+            /* there are no independent chunks to seek to */
+            if (offset)
+                return STATUS_UNSUPPORTED_COMPRESSION;
+
+            if ((format & COMPRESSION_FORMAT_MASK) == COMPRESSION_FORMAT_XPRESS)
+                status = RtlpXpressDecompress(uncompressed, uncompressed_size,
+                                              compressed, compressed_size, &size);
+            else
+                status = RtlpXpressHuffDecompress(uncompressed, uncompressed_size,
+                                                  compressed, compressed_size, &size);
+
+            if (NT_SUCCESS(status) && final_size)
+                *final_size = size;
+            return status;
+        }
+
         case COMPRESSION_FORMAT_NONE:
         case COMPRESSION_FORMAT_DEFAULT:
             return STATUS_INVALID_PARAMETER;
@@ -383,7 +756,7 @@ RtlDecompressBuffer(IN USHORT CompressionFormat,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS NTAPI
 RtlDescribeChunk(IN USHORT CompressionFormat,
@@ -392,13 +765,23 @@ RtlDescribeChunk(IN USHORT CompressionFormat,
                  OUT PUCHAR *ChunkBuffer,
                  OUT PULONG ChunkSize)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    USHORT Format = CompressionFormat & COMPRESSION_FORMAT_MASK;
+
+    if ((Format == COMPRESSION_FORMAT_NONE) ||
+         (Format == COMPRESSION_FORMAT_DEFAULT))
+        return STATUS_INVALID_PARAMETER;
+
+    /* only LZNT1 data is made of self describing chunks */
+    if (Format != COMPRESSION_FORMAT_LZNT1)
+        return STATUS_UNSUPPORTED_COMPRESSION;
+
+    return lznt1_describe_chunk(CompressedBuffer, EndOfCompressedBufferPlus1,
+                                ChunkBuffer, ChunkSize);
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS NTAPI
 RtlGetCompressionWorkSpaceSize(IN USHORT CompressionFormatAndEngine,
@@ -417,13 +800,20 @@ RtlGetCompressionWorkSpaceSize(IN USHORT CompressionFormatAndEngine,
                                     CompressBufferAndWorkSpaceSize,
                                     CompressFragmentWorkSpaceSize));
 
+   if ((Format == COMPRESSION_FORMAT_XPRESS) ||
+         (Format == COMPRESSION_FORMAT_XPRESS_HUFF))
+      return(RtlpWorkSpaceSizeXpress(Format,
+                                     Engine,
+                                     CompressBufferAndWorkSpaceSize,
+                                     CompressFragmentWorkSpaceSize));
+
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
 
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS NTAPI
 RtlReserveChunk(IN USHORT CompressionFormat,
@@ -432,8 +822,17 @@ RtlReserveChunk(IN USHORT CompressionFormat,
                 OUT PUCHAR *ChunkBuffer,
                 IN ULONG ChunkSize)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    USHORT Format = CompressionFormat & COMPRESSION_FORMAT_MASK;
+
+    if ((Format == COMPRESSION_FORMAT_NONE) ||
+         (Format == COMPRESSION_FORMAT_DEFAULT))
+        return STATUS_INVALID_PARAMETER;
+
+    if (Format != COMPRESSION_FORMAT_LZNT1)
+        return STATUS_UNSUPPORTED_COMPRESSION;
+
+    return lznt1_reserve_chunk(CompressedBuffer, EndOfCompressedBufferPlus1,
+                               ChunkBuffer, ChunkSize);
 }
 
 /* EOF */
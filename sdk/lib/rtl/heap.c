@@ -1928,6 +1928,7 @@ RtlAllocateHeap(IN PVOID HeapPtr,
     BOOLEAN HeapLocked = FALSE;
     PHEAP_VIRTUAL_ALLOC_ENTRY VirtualBlock = NULL;
     PHEAP_ENTRY_EXTRA Extra;
+    PVOID FrontEndBlock;
     NTSTATUS Status;
 
     /* Force flags */
@@ -1977,6 +1978,17 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 
     Index = AllocationSize >> HEAP_ENTRY_SHIFT;
 
+    /* Small plain allocations are served by the front end heap without taking the heap lock */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH &&
+        Index < HEAP_LFH_BUCKETS &&
+        EntryFlags == HEAP_ENTRY_BUSY)
+    {
+        FrontEndBlock = RtlpLfhAllocate(Heap, Flags, Size, AllocationSize, Index);
+        if (FrontEndBlock) return FrontEndBlock;
+
+        /* Let the back end try (and report the failure if needed) */
+    }
+
     /* Acquire the lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2147,6 +2159,64 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 }
 
 
+VOID NTAPI
+RtlpFreeHeapEntry(PHEAP Heap,
+                  PHEAP_ENTRY HeapEntry,
+                  SIZE_T BlockSize)
+{
+    USHORT TagIndex = 0;
+
+    // TODO: Tagging
+
+    /* Coalesce in kernel mode, and in usermode if it's not disabled */
+    if (RtlpGetMode() == KernelMode ||
+        (RtlpGetMode() == UserMode && !(Heap->Flags & HEAP_DISABLE_COALESCE_ON_FREE)))
+    {
+        HeapEntry = (PHEAP_ENTRY)RtlpCoalesceFreeBlocks(Heap,
+                                                       (PHEAP_FREE_ENTRY)HeapEntry,
+                                                       &BlockSize,
+                                                       FALSE);
+    }
+
+    /* If there is no need to decommit the block - put it into a free list */
+    if (BlockSize < Heap->DeCommitFreeBlockThreshold ||
+        (Heap->TotalFreeSize + BlockSize < Heap->DeCommitTotalFreeThreshold))
+    {
+        /* Check if it needs to go to a 0 list */
+        if (BlockSize > HEAP_MAX_BLOCK_SIZE)
+        {
+            /* General-purpose 0 list */
+            RtlpInsertFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
+        }
+        else
+        {
+            /* Usual free list */
+            RtlpInsertFreeBlockHelper(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize, FALSE);
+
+            /* Assert sizes are consistent */
+            if (!(HeapEntry->Flags & HEAP_ENTRY_LAST_ENTRY))
+            {
+                ASSERT((HeapEntry + BlockSize)->PreviousSize == BlockSize);
+            }
+
+            /* Increase the free size */
+            Heap->TotalFreeSize += BlockSize;
+        }
+
+        if (RtlpGetMode() == UserMode &&
+            TagIndex != 0)
+        {
+            // FIXME: Tagging
+            UNIMPLEMENTED;
+        }
+    }
+    else
+    {
+        /* Decommit this block */
+        RtlpDeCommitFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
+    }
+}
+
 /***********************************************************************
  *           HeapFree   (KERNEL32.338)
  * RETURNS
@@ -2163,7 +2233,6 @@ BOOLEAN NTAPI RtlFreeHeap(
 {
     PHEAP Heap;
     PHEAP_ENTRY HeapEntry;
-    USHORT TagIndex = 0;
     SIZE_T BlockSize;
     PHEAP_VIRTUAL_ALLOC_ENTRY VirtualEntry;
     BOOLEAN Locked = FALSE;
@@ -2189,7 +2258,9 @@ BOOLEAN NTAPI RtlFreeHeap(
         /* Check this entry, fail if it's invalid */
         if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY) ||
             (((ULONG_PTR)Ptr & 0x7) != 0) ||
-            (HeapEntry->SegmentOffset >= HEAP_SEGMENTS))
+            (HeapEntry->SegmentOffset >= HEAP_SEGMENTS &&
+             (HeapEntry->SegmentOffset != HEAP_LFH_SEGMENT_OFFSET ||
+              !RtlpLfhValidateBlock(Heap, HeapEntry))))
         {
             /* This is an invalid block */
             DPRINT1("HEAP: Trying to free an invalid address %p!\n", Ptr);
@@ -2206,6 +2277,10 @@ BOOLEAN NTAPI RtlFreeHeap(
     }
     _SEH2_END;
 
+    /* Front end blocks go back to their sub-segment without taking the heap lock */
+    if (HeapEntry->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+        return RtlpLfhFree(Heap, HeapEntry);
+
     /* Lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2241,56 +2316,8 @@ BOOLEAN NTAPI RtlFreeHeap(
         /* Normal allocation */
         BlockSize = HeapEntry->Size;
 
-        // TODO: Tagging
-
-        /* Coalesce in kernel mode, and in usermode if it's not disabled */
-        if (RtlpGetMode() == KernelMode ||
-            (RtlpGetMode() == UserMode && !(Heap->Flags & HEAP_DISABLE_COALESCE_ON_FREE)))
-        {
-            HeapEntry = (PHEAP_ENTRY)RtlpCoalesceFreeBlocks(Heap,
-                                                           (PHEAP_FREE_ENTRY)HeapEntry,
-                                                           &BlockSize,
-                                                           FALSE);
-        }
-
-        /* If there is no need to decommit the block - put it into a free list */
-        if (BlockSize < Heap->DeCommitFreeBlockThreshold ||
-            (Heap->TotalFreeSize + BlockSize < Heap->DeCommitTotalFreeThreshold))
-        {
-            /* Check if it needs to go to a 0 list */
-            if (BlockSize > HEAP_MAX_BLOCK_SIZE)
-            {
-                /* General-purpose 0 list */
-                RtlpInsertFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
-            }
-            else
-            {
-                /* Usual free list */
-                RtlpInsertFreeBlockHelper(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize, FALSE);
-
-                /* Assert sizes are consistent */
-                if (!(HeapEntry->Flags & HEAP_ENTRY_LAST_ENTRY))
-                {
-                    ASSERT((HeapEntry + BlockSize)->PreviousSize == BlockSize);
-                }
-
-                /* Increase the free size */
-                Heap->TotalFreeSize += BlockSize;
-            }
-
-
-            if (RtlpGetMode() == UserMode &&
-                TagIndex != 0)
-            {
-                // FIXME: Tagging
-                UNIMPLEMENTED;
-            }
-        }
-        else
-        {
-            /* Decommit this block */
-            RtlpDeCommitFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
-        }
+        /* Put it back to the free lists, or decommit it */
+        RtlpFreeHeapEntry(Heap, HeapEntry, BlockSize);
     }
 
     /* Release the heap lock */
@@ -2599,6 +2626,14 @@ RtlReAllocateHeap(HANDLE HeapPtr,
         return NULL;
     }
 
+    /* Front end blocks can't be split or grown, they are handled separately.
+       RtlpLfhReAllocate checks the block just like the code below does */
+    if (Heap->FrontEndHeap &&
+        (((PHEAP_ENTRY)Ptr)-1)->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+    {
+        return RtlpLfhReAllocate(Heap, Flags, Ptr, Size);
+    }
+
     /* Calculate allocation size and index */
     if (Size)
         AllocationSize = Size;
@@ -2962,14 +2997,59 @@ RtlReAllocateHeap(HANDLE HeapPtr,
 /***********************************************************************
  *           RtlCompactHeap
  *
- * @unimplemented
+ * Gives the empty front end sub-segments back to the back end and returns
+ * the size of the largest free block. Free blocks of the back end are
+ * already coalesced when they are freed, and decommitting is left to
+ * the de-commit thresholds.
+ *
+ * @implemented
  */
 ULONG NTAPI
-RtlCompactHeap(HANDLE Heap,
-		ULONG Flags)
+RtlCompactHeap(HANDLE HeapPtr,
+               ULONG Flags)
 {
-   UNIMPLEMENTED;
-   return 0;
+    PHEAP Heap = (PHEAP)HeapPtr;
+    PHEAP_FREE_ENTRY FreeEntry;
+    SIZE_T LargestSize = 0;
+    ULONG Index;
+
+    /* Force flags */
+    Flags |= Heap->ForceFlags;
+
+    /* Nothing to do for special heaps */
+    if (RtlpHeapIsSpecial(Flags))
+        return 0;
+
+    /* Lock if necessary */
+    if (!(Flags & HEAP_NO_SERIALIZE))
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    if (Heap->FrontEndHeap)
+        RtlpLfhCompact(Heap);
+
+    /* The non-dedicated list is sorted by size, the largest block is the last one */
+    if (!IsListEmpty(&Heap->FreeLists[0]))
+    {
+        FreeEntry = CONTAINING_RECORD(Heap->FreeLists[0].Blink, HEAP_FREE_ENTRY, FreeList);
+        LargestSize = FreeEntry->Size;
+    }
+    else
+    {
+        for (Index = HEAP_FREELISTS - 1; Index > 0; Index--)
+        {
+            if (!IsListEmpty(&Heap->FreeLists[Index]))
+            {
+                LargestSize = Index;
+                break;
+            }
+        }
+    }
+
+    /* Unlock if we locked */
+    if (!(Flags & HEAP_NO_SERIALIZE))
+        RtlLeaveHeapLock(Heap->LockVariable);
+
+    return (ULONG)(LargestSize << HEAP_ENTRY_SHIFT);
 }
 
 
@@ -3156,6 +3236,7 @@ RtlpValidateHeapEntry(
 {
     BOOLEAN BigAllocation, EntryFound = FALSE;
     PHEAP_SEGMENT Segment;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
     ULONG SegmentOffset;
 
     /* Perform various consistency checks of this entry */
@@ -3163,6 +3244,26 @@ RtlpValidateHeapEntry(
     if ((ULONG_PTR)HeapEntry & (HEAP_ENTRY_SIZE - 1)) goto invalid_entry;
     if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY)) goto invalid_entry;
 
+    /* Front end blocks have no segment of their own. Check them against their
+       sub-segment, then go on with the sub-segment, a busy back end block */
+    if (HeapEntry->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET)
+    {
+        _SEH2_TRY
+        {
+            SubSegment = RtlpLfhValidateBlock(Heap, HeapEntry);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            SubSegment = NULL;
+        }
+        _SEH2_END;
+
+        if (!SubSegment) goto invalid_entry;
+
+        HeapEntry = (PHEAP_ENTRY)SubSegment - 1;
+        if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY)) goto invalid_entry;
+    }
+
     BigAllocation = HeapEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC;
     Segment = Heap->Segments[HeapEntry->SegmentOffset];
 
@@ -3927,13 +4028,16 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
         }
 
         /* Check for a special magic value for enabling LFH */
-        if (*(PULONG)HeapInformation != 2)
+        if (*(PULONG)HeapInformation != HEAP_FRONT_END_LFH)
         {
             return STATUS_UNSUCCESSFUL;
         }
 
-        DPRINT1("RtlSetHeapInformation() needs to enable LFH\n");
-        return STATUS_SUCCESS;
+        /* Enable the low fragmentation front end */
+        if (!HeapHandle)
+            return STATUS_INVALID_PARAMETER;
+
+        return RtlpActivateLowFragmentationHeap((PHEAP)HeapHandle);
     }
 
     return STATUS_SUCCESS;
@@ -3972,7 +4076,138 @@ RtlQueryHeapInformation(HANDLE HeapHandle,
     return STATUS_UNSUCCESSFUL;
 }
 
-NTSTATUS
+static
+PHEAP_FREE_ENTRY
+RtlpFindFreeBlock(PHEAP Heap,
+                  SIZE_T Index)
+{
+    PLIST_ENTRY FreeListHead, Next;
+    PHEAP_FREE_ENTRY FreeBlock;
+    ULONG FreeListsInUseUlong;
+    SIZE_T InUseIndex;
+
+    /* Look through the dedicated lists first, using the bitmap */
+    if (Index < HEAP_FREELISTS)
+    {
+        InUseIndex = Index >> 5;
+
+        /* Disable all sizes which are less than the requested one */
+        FreeListsInUseUlong = Heap->u.FreeListsInUseUlong[InUseIndex] & ~((1UL << ((ULONG)Index & 0x1f)) - 1);
+
+        while (TRUE)
+        {
+            if (FreeListsInUseUlong)
+            {
+                FreeListHead = &Heap->FreeLists[InUseIndex * 32 + RtlpFindLeastSetBit(FreeListsInUseUlong)];
+                FreeBlock = CONTAINING_RECORD(FreeListHead->Blink, HEAP_FREE_ENTRY, FreeList);
+                RtlpRemoveFreeBlock(Heap, FreeBlock, TRUE, FALSE);
+                return FreeBlock;
+            }
+
+            if (++InUseIndex == HEAP_FREELISTS / 32) break;
+            FreeListsInUseUlong = Heap->u.FreeListsInUseUlong[InUseIndex];
+        }
+    }
+
+    /* Then the sorted non-dedicated list */
+    FreeListHead = &Heap->FreeLists[0];
+    Next = FreeListHead->Flink;
+    while (FreeListHead != Next)
+    {
+        FreeBlock = CONTAINING_RECORD(Next, HEAP_FREE_ENTRY, FreeList);
+
+        if (FreeBlock->Size >= Index)
+        {
+            RtlpRemoveFreeBlock(Heap, FreeBlock, FALSE, FALSE);
+            return FreeBlock;
+        }
+
+        Next = Next->Flink;
+    }
+
+    /* Nothing suitable, extend the heap */
+    FreeBlock = RtlpExtendHeap(Heap, Index << HEAP_ENTRY_SHIFT);
+    if (FreeBlock)
+        RtlpRemoveFreeBlock(Heap, FreeBlock, FALSE, FALSE);
+
+    return FreeBlock;
+}
+
+static
+ULONG
+RtlpCarveMultipleEntries(PHEAP Heap,
+                         ULONG Flags,
+                         SIZE_T Size,
+                         SIZE_T AllocationSize,
+                         SIZE_T Index,
+                         ULONG Count,
+                         PVOID *Array)
+{
+    PHEAP_FREE_ENTRY FreeBlock;
+    PHEAP_ENTRY InUseEntry, Entry;
+    SIZE_T TotalIndex;
+    UCHAR EntryFlags, LastFlags;
+    USHORT PreviousSize;
+    ULONG i;
+
+    /* Take one free block large enough for the whole batch */
+    TotalIndex = Index * Count;
+    FreeBlock = RtlpFindFreeBlock(Heap, TotalIndex);
+    if (!FreeBlock) return 0;
+
+    /* Split off the tail, the result is a single busy entry spanning all the blocks */
+    InUseEntry = RtlpSplitEntry(Heap,
+                                Flags,
+                                FreeBlock,
+                                TotalIndex << HEAP_ENTRY_SHIFT,
+                                TotalIndex,
+                                TotalIndex << HEAP_ENTRY_SHIFT);
+
+    EntryFlags = InUseEntry->Flags & ~HEAP_ENTRY_LAST_ENTRY;
+    LastFlags = InUseEntry->Flags & HEAP_ENTRY_LAST_ENTRY;
+    PreviousSize = InUseEntry->PreviousSize;
+
+    /* The split might have glued a unusable remainder to the span, it goes to the last block */
+    TotalIndex = InUseEntry->Size;
+
+    /* Now chop that span into the individual blocks */
+    for (i = 0; i < Count; i++)
+    {
+        Entry = InUseEntry + i * Index;
+
+        Entry->Size = (USHORT)Index;
+        Entry->Flags = EntryFlags;
+        Entry->SmallTagIndex = 0;
+        Entry->PreviousSize = PreviousSize;
+        Entry->SegmentOffset = InUseEntry->SegmentOffset;
+        Entry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+
+        PreviousSize = (USHORT)Index;
+        Array[i] = Entry + 1;
+    }
+
+    /* Fix up the last one */
+    Entry->Size = (USHORT)(TotalIndex - (Count - 1) * Index);
+    Entry->UnusedBytes += (UCHAR)((Entry->Size - Index) << HEAP_ENTRY_SHIFT);
+    Entry->Flags |= LastFlags;
+
+    if (!LastFlags)
+        (Entry + Entry->Size)->PreviousSize = Entry->Size;
+
+    return Count;
+}
+
+/***********************************************************************
+ *           RtlMultipleAllocateHeap
+ * Allocates Count blocks of the same size, taking the heap lock only
+ * once and carving them out of as few free blocks as possible.
+ *
+ * RETURNS
+ * Number of blocks allocated
+ *
+ * @implemented
+ */
+ULONG
 NTAPI
 RtlMultipleAllocateHeap(IN PVOID HeapHandle,
                         IN ULONG Flags,
@@ -3980,19 +4215,237 @@ RtlMultipleAllocateHeap(IN PVOID HeapHandle,
                         IN ULONG Count,
                         OUT PVOID *Array)
 {
-    UNIMPLEMENTED;
-    return 0;
+    PHEAP Heap = (PHEAP)HeapHandle;
+    SIZE_T AllocationSize, Index, MaxIndex;
+    ULONG Allocated = 0, Carved, BatchCount;
+    BOOLEAN HeapLocked = FALSE;
+    PHEAP_ENTRY Entry;
+    ULONG i;
+
+    /* Force flags */
+    Flags |= Heap->ForceFlags;
+
+    /* Calculate allocation size and index */
+    AllocationSize = (Size ? Size : 1);
+    AllocationSize = (AllocationSize + Heap->AlignRound) & Heap->AlignMask;
+    Index = AllocationSize >> HEAP_ENTRY_SHIFT;
+
+    /* Biggest span which can be carved at once */
+    MaxIndex = min(HEAP_MAX_BLOCK_SIZE, Heap->VirtualMemoryThreshold);
+
+    /* Special heaps, extra stuff, big or front end blocks are handled one by one */
+    if (RtlpHeapIsSpecial(Flags) ||
+        (Flags & HEAP_EXTRA_FLAGS_MASK) ||
+        (Flags & HEAP_SETTABLE_USER_FLAGS) ||
+        (Heap->Flags & HEAP_TAIL_CHECKING_ENABLED) ||
+        Heap->PseudoTagEntries ||
+        Size >= 0x80000000 ||
+        Index > MaxIndex ||
+        (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH && Index < HEAP_LFH_BUCKETS))
+    {
+        for (Allocated = 0; Allocated < Count; Allocated++)
+        {
+            Array[Allocated] = RtlAllocateHeap(Heap, Flags, Size);
+            if (!Array[Allocated]) break;
+        }
+
+        return Allocated;
+    }
+
+    /* Acquire the lock once for the whole batch */
+    if (!(Flags & HEAP_NO_SERIALIZE))
+    {
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+        HeapLocked = TRUE;
+    }
+
+    while (Allocated < Count)
+    {
+        BatchCount = (ULONG)min(Count - Allocated, MaxIndex / Index);
+
+        Carved = RtlpCarveMultipleEntries(Heap,
+                                          Flags,
+                                          Size,
+                                          AllocationSize,
+                                          Index,
+                                          BatchCount,
+                                          &Array[Allocated]);
+        if (!Carved) break;
+
+        Allocated += Carved;
+    }
+
+    /* Release the lock */
+    if (HeapLocked) RtlLeaveHeapLock(Heap->LockVariable);
+
+    /* Fill the blocks outside of the lock */
+    for (i = 0; i < Allocated; i++)
+    {
+        Entry = (PHEAP_ENTRY)Array[i] - 1;
+
+        /* Zero memory if that was requested */
+        if (Flags & HEAP_ZERO_MEMORY)
+            RtlZeroMemory(Entry + 1, Size);
+        else if (Heap->Flags & HEAP_FREE_CHECKING_ENABLED)
+            RtlFillMemoryUlong(Entry + 1, Size & ~0x3, ARENA_INUSE_FILLER);
+    }
+
+    if (Allocated < Count)
+    {
+        DPRINT1("HEAP: Multiple allocation failed after %lu of %lu blocks!\n", Allocated, Count);
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+
+        /* Generate an exception */
+        if (Flags & HEAP_GENERATE_EXCEPTIONS)
+            RtlRaiseStatus(STATUS_NO_MEMORY);
+    }
+
+    return Allocated;
 }
 
-NTSTATUS
+/***********************************************************************
+ *           RtlMultipleFreeHeap
+ * Frees Count blocks under a single heap lock acquisition. Blocks which
+ * are adjacent in memory are merged first, so that each run only goes
+ * through one coalescing pass and one free list insertion. Nothing is
+ * merged if the heap has HEAP_DISABLE_COALESCE_ON_FREE.
+ *
+ * RETURNS
+ * Number of blocks freed
+ *
+ * @implemented
+ */
+ULONG
 NTAPI
 RtlMultipleFreeHeap(IN PVOID HeapHandle,
                     IN ULONG Flags,
                     IN ULONG Count,
                     OUT PVOID *Array)
 {
-    UNIMPLEMENTED;
-    return 0;
+    PHEAP Heap = (PHEAP)HeapHandle;
+    PHEAP_ENTRY HeapEntry, LastEntry, NextEntry;
+    BOOLEAN HeapLocked = FALSE, Coalesce, Valid, Plain, Joins;
+    ULONG Freed = 0, i, j;
+    SIZE_T BlockSize;
+
+    /* Force flags */
+    Flags |= Heap->ForceFlags;
+
+    /* Merging the blocks is coalescing them, same rule as in RtlpFreeHeapEntry */
+    Coalesce = (RtlpGetMode() == KernelMode ||
+                !(Heap->Flags & HEAP_DISABLE_COALESCE_ON_FREE));
+
+    /* Special heaps do all their checks on their own */
+    if (RtlpHeapIsSpecial(Flags))
+    {
+        for (i = 0; i < Count; i++)
+        {
+            if (!RtlFreeHeap(Heap, Flags, Array[i])) break;
+            Freed++;
+        }
+
+        return Freed;
+    }
+
+    /* Acquire the lock once for the whole batch */
+    if (!(Flags & HEAP_NO_SERIALIZE))
+    {
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+        HeapLocked = TRUE;
+    }
+
+    for (i = 0; i < Count; i = j)
+    {
+        j = i + 1;
+
+        /* Freeing NULL pointer is a legal operation */
+        if (!Array[i])
+        {
+            Freed++;
+            continue;
+        }
+
+        HeapEntry = (PHEAP_ENTRY)Array[i] - 1;
+        Valid = (((ULONG_PTR)Array[i] & (HEAP_ENTRY_SIZE - 1)) == 0);
+        Plain = FALSE;
+
+        /* Protect with SEH in case the pointer is not valid, like RtlFreeHeap does */
+        _SEH2_TRY
+        {
+            Plain = (Valid &&
+                     (HeapEntry->Flags & HEAP_ENTRY_BUSY) &&
+                     !(HeapEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC) &&
+                     HeapEntry->SegmentOffset < HEAP_SEGMENTS);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Valid = FALSE;
+        }
+        _SEH2_END;
+
+        /* Stop at the first invalid pointer, the lock is released below */
+        if (!Valid)
+        {
+            DPRINT1("HEAP: Trying to free an invalid address %p!\n", Array[i]);
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+            break;
+        }
+
+        /* Anything but a plain back end block takes the usual way */
+        if (!Plain)
+        {
+            if (!RtlFreeHeap(Heap, Flags | HEAP_NO_SERIALIZE, Array[i])) break;
+            Freed++;
+            continue;
+        }
+
+        /* Gather the blocks of the batch which follow this one in memory into a single run */
+        BlockSize = HeapEntry->Size;
+        LastEntry = HeapEntry;
+
+        while (Coalesce && j < Count && !(LastEntry->Flags & HEAP_ENTRY_LAST_ENTRY))
+        {
+            NextEntry = LastEntry + LastEntry->Size;
+            Joins = FALSE;
+
+            /* A corrupted size could point anywhere. The block is then
+               left to the next iteration, which checks it on its own */
+            _SEH2_TRY
+            {
+                Joins = (Array[j] == (PVOID)(NextEntry + 1) &&
+                         (NextEntry->Flags & HEAP_ENTRY_BUSY) &&
+                         !(NextEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC) &&
+                         BlockSize + NextEntry->Size <= HEAP_MAX_BLOCK_SIZE);
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                Joins = FALSE;
+            }
+            _SEH2_END;
+
+            if (!Joins) break;
+
+            BlockSize += NextEntry->Size;
+            LastEntry = NextEntry;
+            j++;
+        }
+
+        /* Turn the run into one block */
+        HeapEntry->Size = (USHORT)BlockSize;
+        HeapEntry->Flags = HEAP_ENTRY_BUSY | (LastEntry->Flags & HEAP_ENTRY_LAST_ENTRY);
+
+        if (!(HeapEntry->Flags & HEAP_ENTRY_LAST_ENTRY))
+            (HeapEntry + BlockSize)->PreviousSize = (USHORT)BlockSize;
+
+        /* And free it in one go */
+        RtlpFreeHeapEntry(Heap, HeapEntry, BlockSize);
+        Freed += j - i;
+    }
+
+    /* Release the lock */
+    if (HeapLocked) RtlLeaveHeapLock(Heap->LockVariable);
+
+    return Freed;
 }
 
 /* EOF */
@@ -327,6 +327,57 @@ typedef struct _HEAP_VIRTUAL_ALLOC_ENTRY
     HEAP_ENTRY BusyBlock;
 } HEAP_VIRTUAL_ALLOC_ENTRY, *PHEAP_VIRTUAL_ALLOC_ENTRY;
 
+/* Low fragmentation front end heap */
+#define HEAP_FRONT_END_NONE            0
+#define HEAP_FRONT_END_LFH             2
+
+#define HEAP_LFH_BUCKETS               HEAP_FREELISTS
+#define HEAP_LFH_AFFINITY_SLOTS        8
+#define HEAP_LFH_SUBSEGMENT_SIZE       (4 * PAGE_SIZE)
+#define HEAP_LFH_MIN_BLOCK_COUNT       16
+#define HEAP_LFH_SEGMENT_OFFSET        0xFF
+#define HEAP_LFH_SUBSEGMENT_SIGNATURE  0x5346484C
+
+struct _HEAP_LFH_BUCKET;
+
+typedef struct _HEAP_LFH_SUBSEGMENT
+{
+    SLIST_HEADER FreeBlocks;
+    LIST_ENTRY ListEntry;
+    struct _HEAP_LFH_BUCKET *Bucket;
+    ULONG Signature;
+    USHORT BlockSize;
+    USHORT BlockCount;
+    LONG FreeCount;
+    BOOLEAN Retired;
+} HEAP_LFH_SUBSEGMENT, *PHEAP_LFH_SUBSEGMENT;
+
+typedef struct _HEAP_LFH_BUCKET
+{
+    PHEAP_LFH_SUBSEGMENT ActiveSubSegment[HEAP_LFH_AFFINITY_SLOTS];
+    LIST_ENTRY SubSegmentList;
+    USHORT BlockSize;
+    USHORT SubSegmentCount;
+} HEAP_LFH_BUCKET, *PHEAP_LFH_BUCKET;
+
+/* Counts the threads inside the lock free part of an allocation or a free.
+   Each slot has a cache line of its own, so that they don't share one */
+typedef struct _HEAP_LFH_AFFINITY_SLOT
+{
+    LONG Busy;
+    UCHAR Padding[64 - sizeof(LONG)];
+} HEAP_LFH_AFFINITY_SLOT, *PHEAP_LFH_AFFINITY_SLOT;
+
+typedef struct _HEAP_LFH
+{
+    PHEAP Heap;
+    ULONG AffinitySlots;
+    ULONG FirstBlockOffset;
+    LIST_ENTRY RetiredList;
+    HEAP_LFH_AFFINITY_SLOT Slots[HEAP_LFH_AFFINITY_SLOTS];
+    HEAP_LFH_BUCKET Buckets[HEAP_LFH_BUCKETS];
+} HEAP_LFH, *PHEAP_LFH;
+
 /* Global variables */
 extern RTL_CRITICAL_SECTION RtlpProcessHeapsListLock;
 extern BOOLEAN RtlpPageHeapEnabled;
@@ -352,6 +403,34 @@ RtlpValidateHeapEntry(PHEAP Heap, PHEAP_ENTRY HeapEntry);
 BOOLEAN NTAPI
 RtlpValidateHeapHeaders(PHEAP Heap, BOOLEAN Recalculate);
 
+/* heaplfh.c */
+PVOID NTAPI
+RtlpLfhAllocate(PHEAP Heap,
+                ULONG Flags,
+                SIZE_T Size,
+                SIZE_T AllocationSize,
+                SIZE_T Index);
+
+BOOLEAN NTAPI
+RtlpLfhFree(PHEAP Heap,
+            PHEAP_ENTRY HeapEntry);
+
+PHEAP_LFH_SUBSEGMENT NTAPI
+RtlpLfhValidateBlock(PHEAP Heap,
+                     PHEAP_ENTRY HeapEntry);
+
+VOID NTAPI
+RtlpLfhCompact(PHEAP Heap);
+
+PVOID NTAPI
+RtlpLfhReAllocate(PHEAP Heap,
+                  ULONG Flags,
+                  PVOID Ptr,
+                  SIZE_T Size);
+
+NTSTATUS NTAPI
+RtlpActivateLowFragmentationHeap(PHEAP Heap);
+
 /* heapdbg.c */
 HANDLE NTAPI
 RtlDebugCreateHeap(ULONG Flags,
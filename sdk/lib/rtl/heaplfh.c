@@ -0,0 +1,586 @@
+/*
+ * COPYRIGHT:       See COPYING in the top level directory
+ * PROJECT:         ReactOS system libraries
+ * FILE:            lib/rtl/heaplfh.c
+ * PURPOSE:         RTL Low Fragmentation front end heap
+ * PROGRAMMERS:     ReactOS Team
+ */
+
+/* Useful references:
+   http://illmatics.com/Understanding_the_LFH.pdf
+   http://msdn.microsoft.com/en-us/library/aa366750.aspx
+*/
+
+/* INCLUDES *****************************************************************/
+
+#include <rtl.h>
+#include <heap.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* Passed as the own slot by callers that are not inside a lock free section */
+#define HEAP_LFH_NO_SLOT ((ULONG)-1)
+
+/* FUNCTIONS *****************************************************************/
+
+FORCEINLINE
+ULONG
+RtlpLfhGetAffinitySlot(PHEAP_LFH Lfh)
+{
+    /* The slots are not bound to processors: threads are spread over them
+       by their id, which is way cheaper than asking the kernel for the
+       current processor on each allocation */
+    return ((ULONG)(ULONG_PTR)NtCurrentTeb()->ClientId.UniqueThread >> 2) % Lfh->AffinitySlots;
+}
+
+FORCEINLINE
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhGetSubSegment(PHEAP_LFH Lfh,
+                     PHEAP_ENTRY HeapEntry)
+{
+    /* PreviousSize holds the index of the block inside of its sub-segment */
+    return (PHEAP_LFH_SUBSEGMENT)((PUCHAR)(HeapEntry - HeapEntry->PreviousSize * HeapEntry->Size) -
+                                  Lfh->FirstBlockOffset);
+}
+
+static
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhCreateSubSegment(PHEAP Heap,
+                        PHEAP_LFH Lfh,
+                        PHEAP_LFH_BUCKET Bucket)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_ENTRY HeapEntry;
+    SIZE_T BlockCount, SubSegmentSize;
+    LONG i;
+
+    /* Size the sub-segment so that it holds a reasonable amount of blocks */
+    BlockCount = HEAP_LFH_SUBSEGMENT_SIZE / (Bucket->BlockSize << HEAP_ENTRY_SHIFT);
+    if (BlockCount < HEAP_LFH_MIN_BLOCK_COUNT)
+        BlockCount = HEAP_LFH_MIN_BLOCK_COUNT;
+
+    SubSegmentSize = Lfh->FirstBlockOffset + (BlockCount * Bucket->BlockSize << HEAP_ENTRY_SHIFT);
+
+    /* The caller holds the heap lock. The sub-segment is way beyond the front end
+       range, so this is always served by the back end */
+    ASSERT((SubSegmentSize >> HEAP_ENTRY_SHIFT) >= HEAP_LFH_BUCKETS);
+    SubSegment = RtlAllocateHeap(Heap, HEAP_NO_SERIALIZE, SubSegmentSize);
+    if (!SubSegment) return NULL;
+
+    /* Initialize it */
+    RtlInitializeSListHead(&SubSegment->FreeBlocks);
+    SubSegment->Signature = HEAP_LFH_SUBSEGMENT_SIGNATURE;
+    SubSegment->Bucket = Bucket;
+    SubSegment->BlockSize = Bucket->BlockSize;
+    SubSegment->BlockCount = (USHORT)BlockCount;
+    SubSegment->FreeCount = (LONG)BlockCount;
+
+    /* Carve the blocks, pushing them backwards so that they get handed out in address order */
+    for (i = (LONG)BlockCount - 1; i >= 0; i--)
+    {
+        HeapEntry = (PHEAP_ENTRY)((PUCHAR)SubSegment + Lfh->FirstBlockOffset) + i * Bucket->BlockSize;
+
+        HeapEntry->Size = Bucket->BlockSize;
+        HeapEntry->Flags = 0;
+        HeapEntry->SmallTagIndex = 0;
+        HeapEntry->PreviousSize = (USHORT)i;
+        HeapEntry->SegmentOffset = HEAP_LFH_SEGMENT_OFFSET;
+        HeapEntry->UnusedBytes = 0;
+
+        RtlInterlockedPushEntrySList(&SubSegment->FreeBlocks, (PSLIST_ENTRY)(HeapEntry + 1));
+    }
+
+    /* Register it within the bucket */
+    InsertTailList(&Bucket->SubSegmentList, &SubSegment->ListEntry);
+    Bucket->SubSegmentCount++;
+
+    DPRINT("LFH %p: new sub-segment %p, block size %x, %Iu blocks\n",
+           Lfh, SubSegment, Bucket->BlockSize, BlockCount);
+
+    return SubSegment;
+}
+
+static
+PSLIST_ENTRY
+RtlpLfhRefillAffinitySlot(PHEAP Heap,
+                          PHEAP_LFH Lfh,
+                          PHEAP_LFH_BUCKET Bucket,
+                          ULONG Slot)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PSLIST_ENTRY Block = NULL;
+    PLIST_ENTRY Current;
+
+    /* This is the slow path, it is serialized by the heap lock */
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    /* Another thread sharing this slot could have refilled it meanwhile */
+    SubSegment = Bucket->ActiveSubSegment[Slot];
+    if (SubSegment)
+    {
+        Block = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+        if (Block) goto Found;
+    }
+
+    /* Look for a sub-segment which got some blocks back */
+    Current = Bucket->SubSegmentList.Flink;
+    while (Current != &Bucket->SubSegmentList)
+    {
+        SubSegment = CONTAINING_RECORD(Current, HEAP_LFH_SUBSEGMENT, ListEntry);
+
+        if (RtlQueryDepthSList(&SubSegment->FreeBlocks))
+        {
+            Block = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+            if (Block)
+            {
+                Bucket->ActiveSubSegment[Slot] = SubSegment;
+                goto Found;
+            }
+        }
+
+        Current = Current->Flink;
+    }
+
+    /* Retired sub-segments which couldn't be freed yet are as good as new */
+    Current = Lfh->RetiredList.Flink;
+    while (Current != &Lfh->RetiredList)
+    {
+        SubSegment = CONTAINING_RECORD(Current, HEAP_LFH_SUBSEGMENT, ListEntry);
+        Current = Current->Flink;
+
+        if (SubSegment->Bucket == Bucket)
+        {
+            RemoveEntryList(&SubSegment->ListEntry);
+            InsertTailList(&Bucket->SubSegmentList, &SubSegment->ListEntry);
+            Bucket->SubSegmentCount++;
+            SubSegment->Retired = FALSE;
+
+            Block = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+            if (Block)
+            {
+                Bucket->ActiveSubSegment[Slot] = SubSegment;
+                goto Found;
+            }
+        }
+    }
+
+    /* Nothing left, carve a new sub-segment out of the back end */
+    SubSegment = RtlpLfhCreateSubSegment(Heap, Lfh, Bucket);
+    if (SubSegment)
+    {
+        Bucket->ActiveSubSegment[Slot] = SubSegment;
+        Block = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+    }
+
+    if (!Block) goto Quit;
+
+Found:
+    InterlockedDecrement(&SubSegment->FreeCount);
+
+Quit:
+    RtlLeaveHeapLock(Heap->LockVariable);
+    return Block;
+}
+
+static
+BOOLEAN
+RtlpLfhIsActiveSubSegment(PHEAP_LFH Lfh,
+                          PHEAP_LFH_BUCKET Bucket,
+                          PHEAP_LFH_SUBSEGMENT SubSegment)
+{
+    ULONG Slot;
+
+    for (Slot = 0; Slot < Lfh->AffinitySlots; Slot++)
+    {
+        if (Bucket->ActiveSubSegment[Slot] == SubSegment)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Whether no thread other than the caller is inside a lock free section */
+static
+BOOLEAN
+RtlpLfhIsQuiet(PHEAP_LFH Lfh,
+               ULONG OwnSlot)
+{
+    ULONG Slot;
+    LONG Busy;
+
+    for (Slot = 0; Slot < Lfh->AffinitySlots; Slot++)
+    {
+        /* A full barrier, so that it is ordered with the free counts around it */
+        Busy = InterlockedCompareExchange(&Lfh->Slots[Slot].Busy, 0, 0);
+        if (Slot == OwnSlot) Busy--;
+        if (Busy) return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Frees the retired sub-segments no thread can reach anymore. The caller holds the heap lock */
+static
+VOID
+RtlpLfhFreeRetiredSubSegments(PHEAP Heap,
+                              PHEAP_LFH Lfh,
+                              ULONG OwnSlot)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_LFH_BUCKET Bucket;
+    PLIST_ENTRY Current;
+
+    Current = Lfh->RetiredList.Flink;
+    while (Current != &Lfh->RetiredList)
+    {
+        SubSegment = CONTAINING_RECORD(Current, HEAP_LFH_SUBSEGMENT, ListEntry);
+        Current = Current->Flink;
+        Bucket = SubSegment->Bucket;
+
+        /* A thread which read a slot before it was switched away from this
+           sub-segment took a block after all. It goes back into use, and is
+           retired again once that block comes back */
+        if (SubSegment->FreeCount != SubSegment->BlockCount)
+        {
+            RemoveEntryList(&SubSegment->ListEntry);
+            InsertTailList(&Bucket->SubSegmentList, &SubSegment->ListEntry);
+            Bucket->SubSegmentCount++;
+            SubSegment->Retired = FALSE;
+            continue;
+        }
+
+        /* Only threads which are inside a lock free section can still hold a
+           pointer to it. Once there are none, a full count can't change anymore */
+        if (!RtlpLfhIsQuiet(Lfh, OwnSlot) ||
+            InterlockedCompareExchange(&SubSegment->FreeCount, 0, 0) != SubSegment->BlockCount)
+        {
+            continue;
+        }
+
+        RemoveEntryList(&SubSegment->ListEntry);
+
+        /* Stale pointers into it must not pass for front end blocks anymore */
+        SubSegment->Signature = 0;
+
+        DPRINT("LFH %p: releasing sub-segment %p, block size %x\n",
+               Lfh, SubSegment, Bucket->BlockSize);
+
+        RtlFreeHeap(Heap, HEAP_NO_SERIALIZE, SubSegment);
+    }
+}
+
+/* The caller holds the heap lock */
+static
+BOOLEAN
+RtlpLfhReleaseSubSegment(PHEAP Heap,
+                         PHEAP_LFH Lfh,
+                         PHEAP_LFH_BUCKET Bucket,
+                         PHEAP_LFH_SUBSEGMENT SubSegment,
+                         ULONG OwnSlot)
+{
+    /* Allocations pop without the lock from the sub-segments the slots point
+       to, so only the ones nobody carves from anymore can go. A thread which
+       read a slot just before the refill switched it may still pop from the
+       old sub-segment, so it is only retired here, and freed once no thread
+       can be in that position anymore */
+    if (SubSegment->Retired ||
+        SubSegment->FreeCount != SubSegment->BlockCount ||
+        RtlpLfhIsActiveSubSegment(Lfh, Bucket, SubSegment))
+    {
+        RtlpLfhFreeRetiredSubSegments(Heap, Lfh, OwnSlot);
+        return FALSE;
+    }
+
+    RemoveEntryList(&SubSegment->ListEntry);
+    Bucket->SubSegmentCount--;
+
+    SubSegment->Retired = TRUE;
+    InsertTailList(&Lfh->RetiredList, &SubSegment->ListEntry);
+
+    RtlpLfhFreeRetiredSubSegments(Heap, Lfh, OwnSlot);
+    return TRUE;
+}
+
+PVOID NTAPI
+RtlpLfhAllocate(PHEAP Heap,
+                ULONG Flags,
+                SIZE_T Size,
+                SIZE_T AllocationSize,
+                SIZE_T Index)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_BUCKET Bucket;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PSLIST_ENTRY Block = NULL;
+    PHEAP_ENTRY InUseEntry;
+    ULONG Slot;
+
+    ASSERT(Index < HEAP_LFH_BUCKETS);
+    Bucket = &Lfh->Buckets[Index];
+
+    /* Try the sub-segment this thread's slot is currently carving from. It
+       can't be freed while the slot is busy, even if the slot moves on */
+    Slot = RtlpLfhGetAffinitySlot(Lfh);
+    InterlockedIncrement(&Lfh->Slots[Slot].Busy);
+
+    SubSegment = Bucket->ActiveSubSegment[Slot];
+    if (SubSegment)
+    {
+        Block = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+        if (Block) InterlockedDecrement(&SubSegment->FreeCount);
+    }
+
+    InterlockedDecrement(&Lfh->Slots[Slot].Busy);
+
+    /* It is exhausted, go the slow way */
+    if (!Block)
+    {
+        Block = RtlpLfhRefillAffinitySlot(Heap, Lfh, Bucket, Slot);
+        if (!Block) return NULL;
+    }
+
+    /* Size, segment offset and block index never change, just mark it busy */
+    InUseEntry = (PHEAP_ENTRY)Block - 1;
+    ASSERT(InUseEntry->SegmentOffset == HEAP_LFH_SEGMENT_OFFSET);
+    ASSERT(InUseEntry->Size == Index);
+
+    InUseEntry->Flags = HEAP_ENTRY_BUSY;
+    InUseEntry->SmallTagIndex = 0;
+    InUseEntry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+
+    /* Zero memory if that was requested */
+    if (Flags & HEAP_ZERO_MEMORY)
+        RtlZeroMemory(InUseEntry + 1, Size);
+
+    return InUseEntry + 1;
+}
+
+/* Returns the sub-segment of a front end block, or NULL if the block doesn't
+   belong to one. Callers probing user pointers must wrap this in SEH */
+PHEAP_LFH_SUBSEGMENT NTAPI
+RtlpLfhValidateBlock(PHEAP Heap,
+                     PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+
+    if (!Lfh ||
+        HeapEntry->SegmentOffset != HEAP_LFH_SEGMENT_OFFSET ||
+        HeapEntry->Size == 0 ||
+        HeapEntry->Size >= HEAP_LFH_BUCKETS)
+    {
+        return NULL;
+    }
+
+    SubSegment = RtlpLfhGetSubSegment(Lfh, HeapEntry);
+
+    if (SubSegment->Signature != HEAP_LFH_SUBSEGMENT_SIGNATURE ||
+        SubSegment->BlockSize != HeapEntry->Size ||
+        HeapEntry->PreviousSize >= SubSegment->BlockCount)
+    {
+        return NULL;
+    }
+
+    return SubSegment;
+}
+
+/* The block was checked with RtlpLfhValidateBlock by the caller */
+BOOLEAN NTAPI
+RtlpLfhFree(PHEAP Heap,
+            PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_LFH_BUCKET Bucket;
+    ULONG Slot;
+
+    SubSegment = RtlpLfhGetSubSegment(Lfh, HeapEntry);
+    Bucket = &Lfh->Buckets[HeapEntry->Size];
+
+    /* Once the block is back, the sub-segment may be empty. Keep it alive
+       until we are done with it */
+    Slot = RtlpLfhGetAffinitySlot(Lfh);
+    InterlockedIncrement(&Lfh->Slots[Slot].Busy);
+
+    /* Give it back to its sub-segment */
+    HeapEntry->Flags = 0;
+    RtlInterlockedPushEntrySList(&SubSegment->FreeBlocks, (PSLIST_ENTRY)(HeapEntry + 1));
+
+    /* Only the thread returning the last block sees the count reach the total */
+    if (InterlockedIncrement(&SubSegment->FreeCount) == SubSegment->BlockCount)
+    {
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+        RtlpLfhReleaseSubSegment(Heap, Lfh, Bucket, SubSegment, Slot);
+        RtlLeaveHeapLock(Heap->LockVariable);
+    }
+
+    InterlockedDecrement(&Lfh->Slots[Slot].Busy);
+    return TRUE;
+}
+
+/* Gives the empty sub-segments back to the back end. The caller holds the heap lock */
+VOID NTAPI
+RtlpLfhCompact(PHEAP Heap)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_BUCKET Bucket;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PLIST_ENTRY Current;
+    ULONG Index;
+
+    for (Index = 1; Index < HEAP_LFH_BUCKETS; Index++)
+    {
+        Bucket = &Lfh->Buckets[Index];
+
+        Current = Bucket->SubSegmentList.Flink;
+        while (Current != &Bucket->SubSegmentList)
+        {
+            SubSegment = CONTAINING_RECORD(Current, HEAP_LFH_SUBSEGMENT, ListEntry);
+            Current = Current->Flink;
+
+            RtlpLfhReleaseSubSegment(Heap, Lfh, Bucket, SubSegment, HEAP_LFH_NO_SLOT);
+        }
+    }
+
+    /* Retry the ones which were still reachable when they were retired */
+    RtlpLfhFreeRetiredSubSegments(Heap, Lfh, HEAP_LFH_NO_SLOT);
+}
+
+PVOID NTAPI
+RtlpLfhReAllocate(PHEAP Heap,
+                  ULONG Flags,
+                  PVOID Ptr,
+                  SIZE_T Size)
+{
+    PHEAP_ENTRY InUseEntry = (PHEAP_ENTRY)Ptr - 1;
+    SIZE_T OldSize, AllocationSize;
+    PVOID NewBaseAddress;
+
+    /* Same checks as the back end does before touching the block */
+    if (!(InUseEntry->Flags & HEAP_ENTRY_BUSY) ||
+        !RtlpLfhValidateBlock(Heap, InUseEntry))
+    {
+        DPRINT1("HEAP: Trying to reallocate an invalid front end block %p!\n", Ptr);
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    /* Get the old size of the block */
+    OldSize = (InUseEntry->Size << HEAP_ENTRY_SHIFT) - InUseEntry->UnusedBytes;
+
+    /* Calculate the new allocation size */
+    AllocationSize = (Size ? Size : 1);
+    AllocationSize = (AllocationSize + Heap->AlignRound) & Heap->AlignMask;
+
+    /* Blocks staying in the same bucket are resized in place */
+    if ((AllocationSize >> HEAP_ENTRY_SHIFT) == InUseEntry->Size &&
+        !(Flags & HEAP_EXTRA_FLAGS_MASK))
+    {
+        InUseEntry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+
+        /* Zero out that additional space if required */
+        if (Size > OldSize && (Flags & HEAP_ZERO_MEMORY))
+            RtlZeroMemory((PCHAR)Ptr + OldSize, Size - OldSize);
+
+        return Ptr;
+    }
+
+    /* Anything else means moving the block */
+    if (Flags & HEAP_REALLOC_IN_PLACE_ONLY)
+    {
+        DPRINT1("Realloc in place failed, but it was the only option\n");
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+        return NULL;
+    }
+
+    NewBaseAddress = RtlAllocateHeap(Heap, Flags & ~HEAP_ZERO_MEMORY, Size);
+    if (!NewBaseAddress) return NULL;
+
+    /* Copy actual user bits */
+    RtlMoveMemory(NewBaseAddress, Ptr, min(Size, OldSize));
+
+    /* Zero remaining part if required */
+    if (Size > OldSize && (Flags & HEAP_ZERO_MEMORY))
+        RtlZeroMemory((PCHAR)NewBaseAddress + OldSize, Size - OldSize);
+
+    /* Free the old block */
+    RtlpLfhFree(Heap, InUseEntry);
+
+    return NewBaseAddress;
+}
+
+NTSTATUS NTAPI
+RtlpActivateLowFragmentationHeap(PHEAP Heap)
+{
+    PHEAP_LFH Lfh;
+    ULONG Index, AlignSize;
+
+    /* Nothing to do if it's already there */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH)
+        return STATUS_SUCCESS;
+
+    /* The front end is a user mode feature which needs a locked heap,
+       and it doesn't cooperate with heap debugging features */
+    if (RtlpGetMode() != UserMode ||
+        (Heap->ForceFlags & HEAP_FLAG_PAGE_ALLOCS) ||
+        Heap->Signature != HEAP_SIGNATURE ||
+        RtlpHeapIsSpecial(Heap->Flags) ||
+        (Heap->Flags & (HEAP_NO_SERIALIZE |
+                        HEAP_FREE_CHECKING_ENABLED |
+                        HEAP_TAIL_CHECKING_ENABLED)))
+    {
+        DPRINT1("HEAP: Can't enable the LFH on heap %p (flags %x)\n", Heap, Heap->Flags);
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    /* Another thread could have won the race */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH)
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+        return STATUS_SUCCESS;
+    }
+
+    /* The front end itself lives in the back end */
+    Lfh = RtlAllocateHeap(Heap, HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY, sizeof(HEAP_LFH));
+    if (!Lfh)
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+        return STATUS_NO_MEMORY;
+    }
+
+    Lfh->Heap = Heap;
+    InitializeListHead(&Lfh->RetiredList);
+
+    /* As many affinity slots as there are processors */
+    Lfh->AffinitySlots = NtCurrentPeb()->NumberOfProcessors;
+    if (Lfh->AffinitySlots > HEAP_LFH_AFFINITY_SLOTS)
+        Lfh->AffinitySlots = HEAP_LFH_AFFINITY_SLOTS;
+    if (!Lfh->AffinitySlots)
+        Lfh->AffinitySlots = 1;
+
+    /* Place the first block so that the user data honours the heap alignment */
+    AlignSize = (ULONG)(~Heap->AlignMask + 1);
+    Lfh->FirstBlockOffset = (ULONG)ROUND_UP(sizeof(HEAP_LFH_SUBSEGMENT) + sizeof(HEAP_ENTRY), AlignSize) -
+                            sizeof(HEAP_ENTRY);
+
+    /* Each bucket serves exactly one block size */
+    for (Index = 0; Index < HEAP_LFH_BUCKETS; Index++)
+    {
+        InitializeListHead(&Lfh->Buckets[Index].SubSegmentList);
+        Lfh->Buckets[Index].BlockSize = (USHORT)Index;
+    }
+
+    /* Publish the front end before announcing it */
+    InterlockedExchangePointer(&Heap->FrontEndHeap, Lfh);
+    Heap->FrontEndHeapType = HEAP_FRONT_END_LFH;
+
+    RtlLeaveHeapLock(Heap->LockVariable);
+
+    DPRINT("Enabled LFH %p on heap %p with %lu affinity slots\n", Lfh, Heap, Lfh->AffinitySlots);
+    return STATUS_SUCCESS;
+}
+
+/* EOF */
@@ -0,0 +1,1085 @@
+/*
+ * COPYRIGHT:       See COPYING in the top level directory
+ * PROJECT:         ReactOS system libraries
+ * PURPOSE:         XPRESS and XPRESS Huffman compression engines
+ * FILE:            lib/rtl/xpress.c
+ * PROGRAMER:       ReactOS Team
+ */
+
+/* INCLUDES *****************************************************************/
+
+#ifndef XPRESS_HOST
+#include <rtl.h>
+
+#define NDEBUG
+#include <debug.h>
+#endif
+
+#include "xpress.h"
+
+/* TYPES ********************************************************************/
+
+typedef struct _XPRESS_MATCH_FINDER
+{
+    PULONG Head;
+    PULONG Chain;
+    ULONG HashShift;
+    ULONG MaxDepth;
+    ULONG Window;
+    ULONG MaxLength;
+} XPRESS_MATCH_FINDER, *PXPRESS_MATCH_FINDER;
+
+typedef struct _XPRESS_BIT_WRITER
+{
+    PUCHAR Out;
+    PUCHAR OutEnd;
+    PUCHAR Word1;
+    PUCHAR Word2;
+    ULONG Bits;
+    ULONG FreeBits;
+    BOOLEAN Overflow;
+} XPRESS_BIT_WRITER, *PXPRESS_BIT_WRITER;
+
+typedef struct _XPRESS_BIT_READER
+{
+    PUCHAR In;
+    PUCHAR InEnd;
+    ULONG Bits;
+    LONG ExtraBits;
+} XPRESS_BIT_READER, *PXPRESS_BIT_READER;
+
+/* Huffman compressor state, lives in the caller supplied work space */
+typedef struct _XPRESS_HUFF_ENCODER
+{
+    ULONG Frequencies[XPRESS_HUFF_SYMBOLS];
+    ULONG Order[XPRESS_HUFF_SYMBOLS];
+    ULONG Depths[XPRESS_HUFF_SYMBOLS];
+    USHORT Codes[XPRESS_HUFF_SYMBOLS];
+    UCHAR Lengths[XPRESS_HUFF_SYMBOLS];
+    ULONG Tokens[XPRESS_HUFF_BLOCK_SIZE + 1];
+} XPRESS_HUFF_ENCODER, *PXPRESS_HUFF_ENCODER;
+
+/* Codes up to this length are resolved with a single table lookup */
+#define XPRESS_HUFF_TABLE_BITS 10
+
+typedef struct _XPRESS_HUFF_DECODER
+{
+    USHORT Table[1 << XPRESS_HUFF_TABLE_BITS];
+    USHORT Symbols[XPRESS_HUFF_SYMBOLS];
+    USHORT Count[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    USHORT First[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    USHORT Index[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+} XPRESS_HUFF_DECODER, *PXPRESS_HUFF_DECODER;
+
+#define TAG_XPRESS 'hxRR'
+
+/* Huffman match tokens: bit 31 set, length - 3 in bits 16-30, offset below */
+#define XPRESS_TOKEN_MATCH      0x80000000
+#define XPRESS_HUFF_MAX_MATCH   (0x7FFF + XPRESS_MIN_MATCH)
+#define XPRESS_MAX_MATCH        0xFFFF
+
+#define XPRESS_HUFF_LENGTH(Table, Symbol) \
+    (((Table)[(Symbol) / 2] >> (((Symbol) & 1) * 4)) & 0xF)
+
+/* FUNCTIONS ****************************************************************/
+
+static
+ULONG
+RtlpXpressRead16(IN PUCHAR Data)
+{
+    return (ULONG)Data[0] | ((ULONG)Data[1] << 8);
+}
+
+static
+ULONG
+RtlpXpressRead32(IN PUCHAR Data)
+{
+    return (ULONG)Data[0] | ((ULONG)Data[1] << 8) |
+           ((ULONG)Data[2] << 16) | ((ULONG)Data[3] << 24);
+}
+
+static
+VOID
+RtlpXpressStore16(OUT PUCHAR Data, IN ULONG Value)
+{
+    Data[0] = (UCHAR)Value;
+    Data[1] = (UCHAR)(Value >> 8);
+}
+
+static
+VOID
+RtlpXpressStore32(OUT PUCHAR Data, IN ULONG Value)
+{
+    Data[0] = (UCHAR)Value;
+    Data[1] = (UCHAR)(Value >> 8);
+    Data[2] = (UCHAR)(Value >> 16);
+    Data[3] = (UCHAR)(Value >> 24);
+}
+
+/* Copy a match, source and destination may overlap */
+static
+PUCHAR
+RtlpXpressCopyMatch(IN PUCHAR Out,
+                    IN PUCHAR OutEnd,
+                    IN ULONG Offset,
+                    IN ULONG Length)
+{
+    PUCHAR Source = Out - Offset;
+
+    if (Length > (ULONG)(OutEnd - Out))
+        Length = (ULONG)(OutEnd - Out);
+
+    if (Length <= Offset)
+    {
+        memcpy(Out, Source, Length);
+        return Out + Length;
+    }
+
+    if (Offset == 1)
+    {
+        memset(Out, *Source, Length);
+        return Out + Length;
+    }
+
+    while (Length--)
+        *Out++ = *Source++;
+
+    return Out;
+}
+
+static
+PUCHAR
+RtlpXpressReserve(IN PXPRESS_BIT_WRITER Writer,
+                  IN ULONG Size)
+{
+    PUCHAR Data;
+
+    if ((ULONG)(Writer->OutEnd - Writer->Out) < Size)
+    {
+        Writer->Overflow = TRUE;
+        return NULL;
+    }
+
+    Data = Writer->Out;
+    Writer->Out += Size;
+    return Data;
+}
+
+static
+VOID
+RtlpXpressPutByte(IN PXPRESS_BIT_WRITER Writer,
+                  IN ULONG Value)
+{
+    PUCHAR Data = RtlpXpressReserve(Writer, 1);
+
+    if (Data)
+        *Data = (UCHAR)Value;
+}
+
+static
+VOID
+RtlpXpressPutWord(IN PXPRESS_BIT_WRITER Writer,
+                  IN ULONG Value)
+{
+    PUCHAR Data = RtlpXpressReserve(Writer, 2);
+
+    if (Data)
+        RtlpXpressStore16(Data, Value);
+}
+
+static
+VOID
+RtlpXpressInitMatchFinder(OUT PXPRESS_MATCH_FINDER Finder,
+                          IN PVOID Head,
+                          IN ULONG SourceSize,
+                          IN ULONG Window,
+                          IN ULONG MaxLength,
+                          IN BOOLEAN Maximum)
+{
+    ULONG HashBits = 10;
+
+    /* The table is cleared on every call, so keep it small for small buffers */
+    while (HashBits < XPRESS_MAX_HASH_BITS && (1UL << HashBits) < SourceSize)
+        HashBits++;
+
+    Finder->Head = Head;
+    Finder->Chain = Maximum ? Finder->Head + (1 << XPRESS_MAX_HASH_BITS) : NULL;
+    Finder->HashShift = 32 - HashBits;
+    Finder->MaxDepth = Maximum ? XPRESS_MAXIMUM_DEPTH : XPRESS_STANDARD_DEPTH;
+    Finder->Window = Window;
+    Finder->MaxLength = MaxLength;
+
+    RtlZeroMemory(Finder->Head, sizeof(ULONG) << HashBits);
+}
+
+static
+ULONG
+RtlpXpressHash(IN PXPRESS_MATCH_FINDER Finder,
+               IN PUCHAR Data)
+{
+    ULONG Value = (ULONG)Data[0] | ((ULONG)Data[1] << 8) | ((ULONG)Data[2] << 16);
+
+    return (Value * 0x9E3779B1) >> Finder->HashShift;
+}
+
+/* Remember a position that is skipped over by a match */
+static
+VOID
+RtlpXpressInsert(IN PXPRESS_MATCH_FINDER Finder,
+                 IN PUCHAR Source,
+                 IN ULONG Position,
+                 IN ULONG End)
+{
+    ULONG Hash;
+
+    if (Position + XPRESS_MIN_MATCH > End)
+        return;
+
+    Hash = RtlpXpressHash(Finder, Source + Position);
+    if (Finder->Chain)
+        Finder->Chain[Position & (XPRESS_CHAIN_SIZE - 1)] = Finder->Head[Hash];
+    Finder->Head[Hash] = Position + 1;
+}
+
+/*
+ * Find the longest match for the given position and insert the position.
+ * The standard engine only looks at the most recent candidate, the maximum
+ * engine walks the hash chain.
+ */
+static
+ULONG
+RtlpXpressFindMatch(IN PXPRESS_MATCH_FINDER Finder,
+                    IN PUCHAR Source,
+                    IN ULONG Position,
+                    IN ULONG End,
+                    OUT PULONG Offset)
+{
+    PUCHAR Current = Source + Position, Candidate;
+    ULONG Hash, Next, Depth, Length, MaxLength;
+    ULONG BestLength = XPRESS_MIN_MATCH - 1;
+
+    MaxLength = min(Finder->MaxLength, End - Position);
+    if (MaxLength < XPRESS_MIN_MATCH)
+        return 0;
+
+    Hash = RtlpXpressHash(Finder, Current);
+    Next = Finder->Head[Hash];
+    if (Finder->Chain)
+        Finder->Chain[Position & (XPRESS_CHAIN_SIZE - 1)] = Next;
+    Finder->Head[Hash] = Position + 1;
+
+    for (Depth = Finder->MaxDepth; Next && Depth; Depth--)
+    {
+        Next--;
+        if (Position - Next > Finder->Window)
+            break;
+
+        Candidate = Source + Next;
+        if (Candidate[BestLength] == Current[BestLength] &&
+            Candidate[0] == Current[0] &&
+            Candidate[1] == Current[1])
+        {
+            for (Length = 2; Length < MaxLength && Candidate[Length] == Current[Length]; Length++);
+
+            if (Length > BestLength)
+            {
+                BestLength = Length;
+                *Offset = Position - Next;
+                if (Length == MaxLength)
+                    break;
+            }
+        }
+
+        if (!Finder->Chain)
+            break;
+
+        Next = Finder->Chain[Next & (XPRESS_CHAIN_SIZE - 1)];
+    }
+
+    return (BestLength >= XPRESS_MIN_MATCH) ? BestLength : 0;
+}
+
+ULONG
+NTAPI
+RtlpXpressWorkSpaceSize(IN BOOLEAN Huffman,
+                        IN BOOLEAN Maximum)
+{
+    ULONG Size = sizeof(ULONG) << XPRESS_MAX_HASH_BITS;
+
+    if (Maximum)
+        Size += sizeof(ULONG) * XPRESS_CHAIN_SIZE;
+
+    if (Huffman)
+        Size += sizeof(XPRESS_HUFF_ENCODER);
+
+    return Size;
+}
+
+/*
+ * Plain LZ77 format: a 32 bit flag word precedes every 32 literals or
+ * matches, a match is a 16 bit (offset - 1) << 3 | length word with the
+ * longer lengths continued in shared nibbles, bytes and words.
+ */
+NTSTATUS
+NTAPI
+RtlpXpressCompress(IN PUCHAR Source,
+                   IN ULONG SourceSize,
+                   OUT PUCHAR Destination,
+                   IN ULONG DestinationSize,
+                   OUT PULONG FinalSize,
+                   IN PVOID WorkSpace,
+                   IN BOOLEAN Maximum)
+{
+    XPRESS_MATCH_FINDER Finder;
+    XPRESS_BIT_WRITER Writer;
+    PUCHAR FlagWord, HalfByte = NULL;
+    ULONG Flags = 0, FlagCount = 0, Position = 0;
+    ULONG Length, Offset, Extra, End;
+
+    RtlpXpressInitMatchFinder(&Finder, WorkSpace, SourceSize,
+                              XPRESS_WINDOW_SIZE, XPRESS_MAX_MATCH, Maximum);
+
+    Writer.Out = Destination;
+    Writer.OutEnd = Destination + DestinationSize;
+    Writer.Overflow = FALSE;
+
+    FlagWord = RtlpXpressReserve(&Writer, sizeof(ULONG));
+
+    while (Position < SourceSize && !Writer.Overflow)
+    {
+        Length = RtlpXpressFindMatch(&Finder, Source, Position, SourceSize, &Offset);
+        if (!Length)
+        {
+            RtlpXpressPutByte(&Writer, Source[Position++]);
+            Flags <<= 1;
+        }
+        else
+        {
+            Extra = Length - XPRESS_MIN_MATCH;
+            RtlpXpressPutWord(&Writer, ((Offset - 1) << 3) | min(Extra, 7));
+
+            if (Extra >= 7)
+            {
+                Extra -= 7;
+
+                /* Two long matches share one byte for their first extension */
+                if (!HalfByte)
+                {
+                    HalfByte = RtlpXpressReserve(&Writer, 1);
+                    if (HalfByte)
+                        *HalfByte = (UCHAR)min(Extra, 15);
+                }
+                else
+                {
+                    *HalfByte |= (UCHAR)(min(Extra, 15) << 4);
+                    HalfByte = NULL;
+                }
+
+                if (Extra >= 15)
+                {
+                    Extra -= 15;
+                    if (Extra < 255)
+                    {
+                        RtlpXpressPutByte(&Writer, Extra);
+                    }
+                    else
+                    {
+                        RtlpXpressPutByte(&Writer, 255);
+                        RtlpXpressPutWord(&Writer, Extra + 15 + 7);
+                    }
+                }
+            }
+
+            for (End = Position + Length, Position++; Position < End; Position++)
+                RtlpXpressInsert(&Finder, Source, Position, SourceSize);
+
+            Flags = (Flags << 1) | 1;
+        }
+
+        if (++FlagCount == 32)
+        {
+            if (FlagWord)
+                RtlpXpressStore32(FlagWord, Flags);
+
+            FlagWord = RtlpXpressReserve(&Writer, sizeof(ULONG));
+            Flags = 0;
+            FlagCount = 0;
+        }
+    }
+
+    if (Writer.Overflow)
+        return STATUS_BUFFER_TOO_SMALL;
+
+    /* The unused flags are set, the decoder stops at a match without data */
+    if (FlagCount)
+        Flags = (Flags << (32 - FlagCount)) | ((1UL << (32 - FlagCount)) - 1);
+    else
+        Flags = 0xFFFFFFFF;
+
+    RtlpXpressStore32(FlagWord, Flags);
+
+    *FinalSize = (ULONG)(Writer.Out - Destination);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+RtlpXpressDecompress(OUT PUCHAR Destination,
+                     IN ULONG DestinationSize,
+                     IN PUCHAR Source,
+                     IN ULONG SourceSize,
+                     OUT PULONG FinalSize)
+{
+    PUCHAR In = Source, InEnd = Source + SourceSize;
+    PUCHAR Out = Destination, OutEnd = Destination + DestinationSize;
+    PUCHAR HalfByte = NULL;
+    ULONG Flags = 0, FlagCount = 0;
+    ULONG Token, Length, Offset;
+
+    /* Partial decompression is no error */
+    while (Out < OutEnd)
+    {
+        if (!FlagCount)
+        {
+            if (InEnd - In < 4)
+            {
+                if (In == InEnd)
+                    break;
+                return STATUS_BAD_COMPRESSION_BUFFER;
+            }
+
+            Flags = RtlpXpressRead32(In);
+            In += 4;
+            FlagCount = 32;
+        }
+
+        FlagCount--;
+        if (!(Flags & (1UL << FlagCount)))
+        {
+            if (In == InEnd)
+                break;
+
+            *Out++ = *In++;
+            continue;
+        }
+
+        /* A match flag past the end of the input terminates the stream */
+        if (In == InEnd)
+            break;
+
+        if (InEnd - In < 2)
+            return STATUS_BAD_COMPRESSION_BUFFER;
+
+        Token = RtlpXpressRead16(In);
+        In += 2;
+
+        Length = Token & 7;
+        Offset = (Token >> 3) + 1;
+
+        if (Length == 7)
+        {
+            if (!HalfByte)
+            {
+                if (In == InEnd)
+                    return STATUS_BAD_COMPRESSION_BUFFER;
+
+                HalfByte = In++;
+                Length = *HalfByte & 0xF;
+            }
+            else
+            {
+                Length = *HalfByte >> 4;
+                HalfByte = NULL;
+            }
+
+            if (Length == 15)
+            {
+                if (In == InEnd)
+                    return STATUS_BAD_COMPRESSION_BUFFER;
+
+                Length = *In++;
+                if (Length == 255)
+                {
+                    if (InEnd - In < 2)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+
+                    Length = RtlpXpressRead16(In);
+                    In += 2;
+
+                    if (!Length)
+                    {
+                        if (InEnd - In < 4)
+                            return STATUS_BAD_COMPRESSION_BUFFER;
+
+                        Length = RtlpXpressRead32(In);
+                        In += 4;
+                    }
+
+                    if (Length < 15 + 7)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+
+                    Length -= 15 + 7;
+                }
+
+                Length += 15;
+            }
+
+            Length += 7;
+        }
+
+        if (Offset > (ULONG)(Out - Destination))
+            return STATUS_BAD_COMPRESSION_BUFFER;
+
+        /* The length may have come from a 32 bit field */
+        Length = min(Length, (ULONG)(OutEnd - Out));
+        Out = RtlpXpressCopyMatch(Out, OutEnd, Offset, Length + XPRESS_MIN_MATCH);
+    }
+
+    *FinalSize = (ULONG)(Out - Destination);
+    return STATUS_SUCCESS;
+}
+
+/* Length limited Huffman code lengths for the block frequencies */
+static
+VOID
+RtlpXpressHuffBuildLengths(IN PXPRESS_HUFF_ENCODER Encoder)
+{
+    PULONG Order = Encoder->Order, Depths = Encoder->Depths;
+    ULONG Symbol, Count, Key, Gap, Shift, i, j;
+    LONG Root, Leaf, Next, Available, Used, Depth;
+
+    for (Shift = 0; ; Shift++)
+    {
+        RtlZeroMemory(Encoder->Lengths, sizeof(Encoder->Lengths));
+
+        /* Sort the used symbols by frequency, the symbol is kept in the low bits */
+        for (Symbol = 0, Count = 0; Symbol < XPRESS_HUFF_SYMBOLS; Symbol++)
+        {
+            if (Encoder->Frequencies[Symbol])
+                Order[Count++] = (max(Encoder->Frequencies[Symbol] >> Shift, 1) << 9) | Symbol;
+        }
+
+        for (Gap = Count / 2; Gap; Gap /= 2)
+        {
+            for (i = Gap; i < Count; i++)
+            {
+                Key = Order[i];
+                for (j = i; j >= Gap && Order[j - Gap] > Key; j -= Gap)
+                    Order[j] = Order[j - Gap];
+                Order[j] = Key;
+            }
+        }
+
+        if (Count == 1)
+        {
+            /* Keep the code complete by adding a dummy symbol */
+            Symbol = Order[0] & (XPRESS_HUFF_SYMBOLS - 1);
+            Encoder->Lengths[Symbol] = 1;
+            Encoder->Lengths[Symbol ? 0 : 1] = 1;
+            return;
+        }
+
+        /* Moffat and Katajainen, in-place calculation of minimum redundancy codes */
+        for (i = 0; i < Count; i++)
+            Depths[i] = Order[i] >> 9;
+
+        Depths[0] += Depths[1];
+        Root = 0;
+        Leaf = 2;
+        for (Next = 1; Next < (LONG)Count - 1; Next++)
+        {
+            if (Leaf >= (LONG)Count || Depths[Root] < Depths[Leaf])
+            {
+                Depths[Next] = Depths[Root];
+                Depths[Root++] = Next;
+            }
+            else
+            {
+                Depths[Next] = Depths[Leaf++];
+            }
+
+            if (Leaf >= (LONG)Count || (Root < Next && Depths[Root] < Depths[Leaf]))
+            {
+                Depths[Next] += Depths[Root];
+                Depths[Root++] = Next;
+            }
+            else
+            {
+                Depths[Next] += Depths[Leaf++];
+            }
+        }
+
+        Depths[Count - 2] = 0;
+        for (Next = (LONG)Count - 3; Next >= 0; Next--)
+            Depths[Next] = Depths[Depths[Next]] + 1;
+
+        Available = 1;
+        Used = 0;
+        Depth = 0;
+        Root = (LONG)Count - 2;
+        Next = (LONG)Count - 1;
+        while (Available > 0)
+        {
+            while (Root >= 0 && (LONG)Depths[Root] == Depth)
+            {
+                Used++;
+                Root--;
+            }
+
+            while (Available > Used)
+            {
+                Depths[Next--] = Depth;
+                Available--;
+            }
+
+            Available = 2 * Used;
+            Depth++;
+            Used = 0;
+        }
+
+        /* The least frequent symbol has the longest code */
+        if (Depths[0] <= XPRESS_HUFF_MAX_CODE_LENGTH)
+            break;
+
+        /* Flatten the distribution and try again */
+    }
+
+    for (i = 0; i < Count; i++)
+        Encoder->Lengths[Order[i] & (XPRESS_HUFF_SYMBOLS - 1)] = (UCHAR)Depths[i];
+}
+
+/* Canonical codes, ordered by length and then by symbol */
+static
+VOID
+RtlpXpressHuffBuildCodes(IN PXPRESS_HUFF_ENCODER Encoder)
+{
+    ULONG Count[XPRESS_HUFF_MAX_CODE_LENGTH + 1] = { 0 };
+    ULONG Next[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    ULONG Symbol, Length, Code = 0;
+
+    for (Symbol = 0; Symbol < XPRESS_HUFF_SYMBOLS; Symbol++)
+        Count[Encoder->Lengths[Symbol]]++;
+
+    Count[0] = 0;
+    for (Length = 1; Length <= XPRESS_HUFF_MAX_CODE_LENGTH; Length++)
+    {
+        Code = (Code + Count[Length - 1]) << 1;
+        Next[Length] = Code;
+    }
+
+    for (Symbol = 0; Symbol < XPRESS_HUFF_SYMBOLS; Symbol++)
+    {
+        if (Encoder->Lengths[Symbol])
+            Encoder->Codes[Symbol] = (USHORT)Next[Encoder->Lengths[Symbol]]++;
+    }
+}
+
+static
+ULONG
+RtlpXpressHighBit(IN ULONG Value)
+{
+    ULONG Bit = 0;
+
+    while (Value >>= 1)
+        Bit++;
+
+    return Bit;
+}
+
+static
+ULONG
+RtlpXpressHuffMatchSymbol(IN ULONG Length,
+                          IN ULONG Offset)
+{
+    return 256 + (RtlpXpressHighBit(Offset) << 4) + min(Length - XPRESS_MIN_MATCH, 15);
+}
+
+static
+VOID
+RtlpXpressPutBits(IN PXPRESS_BIT_WRITER Writer,
+                  IN ULONG Count,
+                  IN ULONG Value)
+{
+    if (Writer->FreeBits >= Count)
+    {
+        Writer->FreeBits -= Count;
+        Writer->Bits = (Writer->Bits << Count) | Value;
+        return;
+    }
+
+    /* The bits go to the older of the two reserved words */
+    Writer->Bits = (Writer->Bits << Writer->FreeBits) | (Value >> (Count - Writer->FreeBits));
+    if (Writer->Word1)
+        RtlpXpressStore16(Writer->Word1, Writer->Bits);
+
+    Writer->Word1 = Writer->Word2;
+    Writer->Word2 = RtlpXpressReserve(Writer, 2);
+    Writer->FreeBits = 16 - (Count - Writer->FreeBits);
+    Writer->Bits = Value;
+}
+
+static
+VOID
+RtlpXpressHuffWriteBlock(IN PXPRESS_HUFF_ENCODER Encoder,
+                         IN PXPRESS_BIT_WRITER Writer,
+                         IN ULONG TokenCount)
+{
+    PUCHAR Table;
+    ULONG Token, Symbol, Length, Offset, Extra, OffsetBits, i;
+
+    RtlpXpressHuffBuildLengths(Encoder);
+    RtlpXpressHuffBuildCodes(Encoder);
+
+    Table = RtlpXpressReserve(Writer, XPRESS_HUFF_TABLE_SIZE);
+    if (!Table)
+        return;
+
+    for (i = 0; i < XPRESS_HUFF_TABLE_SIZE; i++)
+        Table[i] = Encoder->Lengths[2 * i] | (Encoder->Lengths[2 * i + 1] << 4);
+
+    /* The decoder always has the next two words of bits loaded */
+    Writer->Word1 = RtlpXpressReserve(Writer, 2);
+    Writer->Word2 = RtlpXpressReserve(Writer, 2);
+    Writer->Bits = 0;
+    Writer->FreeBits = 16;
+
+    for (i = 0; i < TokenCount && !Writer->Overflow; i++)
+    {
+        Token = Encoder->Tokens[i];
+        if (!(Token & XPRESS_TOKEN_MATCH))
+        {
+            RtlpXpressPutBits(Writer, Encoder->Lengths[Token], Encoder->Codes[Token]);
+            continue;
+        }
+
+        Length = ((Token >> 16) & 0x7FFF) + XPRESS_MIN_MATCH;
+        Offset = Token & 0xFFFF;
+        Symbol = RtlpXpressHuffMatchSymbol(Length, Offset);
+        RtlpXpressPutBits(Writer, Encoder->Lengths[Symbol], Encoder->Codes[Symbol]);
+
+        Extra = Length - XPRESS_MIN_MATCH;
+        if (Extra >= 15)
+        {
+            if (Extra - 15 < 255)
+            {
+                RtlpXpressPutByte(Writer, Extra - 15);
+            }
+            else
+            {
+                RtlpXpressPutByte(Writer, 255);
+                RtlpXpressPutWord(Writer, Extra);
+            }
+        }
+
+        OffsetBits = RtlpXpressHighBit(Offset);
+        RtlpXpressPutBits(Writer, OffsetBits, Offset & ((1UL << OffsetBits) - 1));
+    }
+
+    if (Writer->Word1)
+        RtlpXpressStore16(Writer->Word1, Writer->Bits << Writer->FreeBits);
+    if (Writer->Word2)
+        RtlpXpressStore16(Writer->Word2, 0);
+}
+
+/*
+ * LZ77 + Huffman format: each block of 64 KB output starts with a table of
+ * 512 four bit code lengths (256 literals, 256 length/offset-bits symbols)
+ * followed by a stream of 16 bit words, extra length bytes are interleaved.
+ */
+NTSTATUS
+NTAPI
+RtlpXpressHuffCompress(IN PUCHAR Source,
+                       IN ULONG SourceSize,
+                       OUT PUCHAR Destination,
+                       IN ULONG DestinationSize,
+                       OUT PULONG FinalSize,
+                       IN PVOID WorkSpace,
+                       IN BOOLEAN Maximum)
+{
+    PXPRESS_HUFF_ENCODER Encoder = WorkSpace;
+    XPRESS_MATCH_FINDER Finder;
+    XPRESS_BIT_WRITER Writer;
+    ULONG Position = 0, BlockStart, TokenCount;
+    ULONG Length, Offset, End;
+    BOOLEAN Last;
+
+    RtlpXpressInitMatchFinder(&Finder, Encoder + 1, SourceSize,
+                              XPRESS_HUFF_WINDOW_SIZE, XPRESS_HUFF_MAX_MATCH, Maximum);
+
+    Writer.Out = Destination;
+    Writer.OutEnd = Destination + DestinationSize;
+    Writer.Overflow = FALSE;
+
+    do
+    {
+        RtlZeroMemory(Encoder->Frequencies, sizeof(Encoder->Frequencies));
+        BlockStart = Position;
+        TokenCount = 0;
+
+        /* A match may run past the end of the block, as in the decoder */
+        while (Position < SourceSize && Position - BlockStart < XPRESS_HUFF_BLOCK_SIZE)
+        {
+            Length = RtlpXpressFindMatch(&Finder, Source, Position, SourceSize, &Offset);
+
+            /* A short match at offset 1 looks like the end of stream */
+            if (Length && (Length > XPRESS_MIN_MATCH || Offset > 1))
+            {
+                Encoder->Tokens[TokenCount++] = XPRESS_TOKEN_MATCH |
+                                                ((Length - XPRESS_MIN_MATCH) << 16) |
+                                                Offset;
+                Encoder->Frequencies[RtlpXpressHuffMatchSymbol(Length, Offset)]++;
+
+                for (End = Position + Length, Position++; Position < End; Position++)
+                    RtlpXpressInsert(&Finder, Source, Position, SourceSize);
+            }
+            else
+            {
+                Encoder->Tokens[TokenCount++] = Source[Position];
+                Encoder->Frequencies[Source[Position]]++;
+                Position++;
+            }
+        }
+
+        /* The end of stream symbol must be in a block the decoder still reads */
+        Last = (Position - BlockStart < XPRESS_HUFF_BLOCK_SIZE);
+        if (Last)
+        {
+            Encoder->Tokens[TokenCount++] = XPRESS_TOKEN_MATCH | 1;
+            Encoder->Frequencies[256]++;
+        }
+
+        RtlpXpressHuffWriteBlock(Encoder, &Writer, TokenCount);
+        if (Writer.Overflow)
+            return STATUS_BUFFER_TOO_SMALL;
+    }
+    while (!Last);
+
+    *FinalSize = (ULONG)(Writer.Out - Destination);
+    return STATUS_SUCCESS;
+}
+
+static
+BOOLEAN
+RtlpXpressHuffBuildDecoder(OUT PXPRESS_HUFF_DECODER Decoder,
+                           IN PUCHAR Table)
+{
+    USHORT Offsets[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    ULONG Symbol, Length, Code, Left, Fill, Entry, Index, i;
+
+    RtlZeroMemory(Decoder->Count, sizeof(Decoder->Count));
+    for (Symbol = 0; Symbol < XPRESS_HUFF_SYMBOLS; Symbol++)
+        Decoder->Count[XPRESS_HUFF_LENGTH(Table, Symbol)]++;
+    Decoder->Count[0] = 0;
+
+    /* Over-subscribed tables are corrupt, incomplete ones are caught while decoding */
+    Left = 1;
+    for (Length = 1; Length <= XPRESS_HUFF_MAX_CODE_LENGTH; Length++)
+    {
+        Left <<= 1;
+        if (Decoder->Count[Length] > Left)
+            return FALSE;
+        Left -= Decoder->Count[Length];
+    }
+
+    Code = 0;
+    Index = 0;
+    for (Length = 1; Length <= XPRESS_HUFF_MAX_CODE_LENGTH; Length++)
+    {
+        Code = (Code + Decoder->Count[Length - 1]) << 1;
+        Decoder->First[Length] = (USHORT)Code;
+        Decoder->Index[Length] = Offsets[Length] = (USHORT)Index;
+        Index += Decoder->Count[Length];
+    }
+
+    for (Symbol = 0; Symbol < XPRESS_HUFF_SYMBOLS; Symbol++)
+    {
+        Length = XPRESS_HUFF_LENGTH(Table, Symbol);
+        if (Length)
+            Decoder->Symbols[Offsets[Length]++] = (USHORT)Symbol;
+    }
+
+    /* Short codes own all table slots they prefix, zero slots need the slow path */
+    RtlZeroMemory(Decoder->Table, sizeof(Decoder->Table));
+    for (Length = 1; Length <= XPRESS_HUFF_TABLE_BITS; Length++)
+    {
+        for (i = 0; i < Decoder->Count[Length]; i++)
+        {
+            Code = Decoder->First[Length] + i;
+            Entry = (Decoder->Symbols[Decoder->Index[Length] + i] << 4) | Length;
+            Fill = 1 << (XPRESS_HUFF_TABLE_BITS - Length);
+            Code <<= XPRESS_HUFF_TABLE_BITS - Length;
+
+            while (Fill--)
+                Decoder->Table[Code++] = (USHORT)Entry;
+        }
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+RtlpXpressConsumeBits(IN PXPRESS_BIT_READER Reader,
+                      IN ULONG Count)
+{
+    Reader->Bits <<= Count;
+    Reader->ExtraBits -= Count;
+
+    if (Reader->ExtraBits < 0)
+    {
+        if (Reader->InEnd - Reader->In < 2)
+            return FALSE;
+
+        Reader->Bits |= RtlpXpressRead16(Reader->In) << -Reader->ExtraBits;
+        Reader->In += 2;
+        Reader->ExtraBits += 16;
+    }
+
+    return TRUE;
+}
+
+static
+LONG
+RtlpXpressHuffDecodeSymbol(IN PXPRESS_HUFF_DECODER Decoder,
+                           IN PXPRESS_BIT_READER Reader)
+{
+    ULONG Next15Bits = Reader->Bits >> (32 - XPRESS_HUFF_MAX_CODE_LENGTH);
+    ULONG Entry, Length, Code;
+
+    Entry = Decoder->Table[Next15Bits >> (XPRESS_HUFF_MAX_CODE_LENGTH - XPRESS_HUFF_TABLE_BITS)];
+    if (Entry)
+    {
+        if (!RtlpXpressConsumeBits(Reader, Entry & 0xF))
+            return -1;
+        return Entry >> 4;
+    }
+
+    for (Length = XPRESS_HUFF_TABLE_BITS + 1; Length <= XPRESS_HUFF_MAX_CODE_LENGTH; Length++)
+    {
+        Code = (Next15Bits >> (XPRESS_HUFF_MAX_CODE_LENGTH - Length)) - Decoder->First[Length];
+        if (Code < Decoder->Count[Length])
+        {
+            if (!RtlpXpressConsumeBits(Reader, Length))
+                return -1;
+            return Decoder->Symbols[Decoder->Index[Length] + Code];
+        }
+    }
+
+    return -1;
+}
+
+NTSTATUS
+NTAPI
+RtlpXpressHuffDecompress(OUT PUCHAR Destination,
+                         IN ULONG DestinationSize,
+                         IN PUCHAR Source,
+                         IN ULONG SourceSize,
+                         OUT PULONG FinalSize)
+{
+    PXPRESS_HUFF_DECODER Decoder;
+    XPRESS_BIT_READER Reader;
+    PUCHAR Out = Destination, OutEnd = Destination + DestinationSize, BlockEnd;
+    ULONG Length, Offset, OffsetBits;
+    LONG Symbol;
+    NTSTATUS Status = STATUS_BAD_COMPRESSION_BUFFER;
+
+    /* The decode tables are too big for a kernel stack */
+    Decoder = RtlpAllocateMemory(sizeof(*Decoder), TAG_XPRESS);
+    if (!Decoder)
+        return STATUS_NO_MEMORY;
+
+    Reader.In = Source;
+    Reader.InEnd = Source + SourceSize;
+
+    while (Out < OutEnd && Reader.In < Reader.InEnd)
+    {
+        if (Reader.InEnd - Reader.In < XPRESS_HUFF_TABLE_SIZE + 4)
+            goto Fail;
+
+        if (!RtlpXpressHuffBuildDecoder(Decoder, Reader.In))
+            goto Fail;
+
+        Reader.In += XPRESS_HUFF_TABLE_SIZE;
+        Reader.Bits = (RtlpXpressRead16(Reader.In) << 16) | RtlpXpressRead16(Reader.In + 2);
+        Reader.In += 4;
+        Reader.ExtraBits = 16;
+
+        BlockEnd = Out + min(XPRESS_HUFF_BLOCK_SIZE, (ULONG)(OutEnd - Out));
+        while (Out < BlockEnd)
+        {
+            Symbol = RtlpXpressHuffDecodeSymbol(Decoder, &Reader);
+            if (Symbol < 0)
+                goto Fail;
+
+            if (Symbol < 256)
+            {
+                *Out++ = (UCHAR)Symbol;
+                continue;
+            }
+
+            /* The end of stream symbol is the last one in the input */
+            if (Symbol == 256 && Reader.In >= Reader.InEnd)
+                goto Done;
+
+            Symbol -= 256;
+            Length = Symbol & 0xF;
+            OffsetBits = Symbol >> 4;
+
+            if (Length == 15)
+            {
+                if (Reader.In == Reader.InEnd)
+                    goto Fail;
+
+                Length = *Reader.In++;
+                if (Length == 255)
+                {
+                    if (Reader.InEnd - Reader.In < 2)
+                        goto Fail;
+
+                    Length = RtlpXpressRead16(Reader.In);
+                    Reader.In += 2;
+
+                    if (!Length)
+                    {
+                        if (Reader.InEnd - Reader.In < 4)
+                            goto Fail;
+
+                        Length = RtlpXpressRead32(Reader.In);
+                        Reader.In += 4;
+                    }
+
+                    if (Length < 15)
+                        goto Fail;
+
+                    Length -= 15;
+                }
+
+                Length += 15;
+            }
+
+            Offset = 1UL << OffsetBits;
+            if (OffsetBits)
+                Offset |= Reader.Bits >> (32 - OffsetBits);
+
+            if (!RtlpXpressConsumeBits(&Reader, OffsetBits))
+                goto Fail;
+
+            if (Offset > (ULONG)(Out - Destination))
+                goto Fail;
+
+            /* Matches may run past the end of the block, but not of the buffer */
+            Length = min(Length, (ULONG)(OutEnd - Out));
+            Out = RtlpXpressCopyMatch(Out, OutEnd, Offset, Length + XPRESS_MIN_MATCH);
+        }
+    }
+
+Done:
+    *FinalSize = (ULONG)(Out - Destination);
+    Status = STATUS_SUCCESS;
+
+Fail:
+    RtlpFreeMemory(Decoder, TAG_XPRESS);
+    return Status;
+}
+
+/* EOF */
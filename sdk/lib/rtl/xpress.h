@@ -0,0 +1,172 @@
+/*
+ * COPYRIGHT:       See COPYING in the top level directory
+ * PROJECT:         ReactOS system libraries
+ * PURPOSE:         XPRESS and XPRESS Huffman compression engines
+ * FILE:            lib/rtl/xpress.h
+ * PROGRAMER:       ReactOS Team
+ */
+
+#pragma once
+
+#ifdef XPRESS_HOST
+
+/* The engines are also built into host tools */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <typedefs.h>
+
+#ifndef STATUS_SUCCESS
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000)
+#endif
+#ifndef STATUS_BUFFER_TOO_SMALL
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023)
+#endif
+#ifndef STATUS_BAD_COMPRESSION_BUFFER
+#define STATUS_BAD_COMPRESSION_BUFFER   ((NTSTATUS)0xC0000242)
+#endif
+#ifndef STATUS_NO_MORE_ENTRIES
+#define STATUS_NO_MORE_ENTRIES          ((NTSTATUS)0x8000001A)
+#endif
+#ifndef STATUS_ACCESS_VIOLATION
+#define STATUS_ACCESS_VIOLATION         ((NTSTATUS)0xC0000005)
+#endif
+#ifndef STATUS_INVALID_PARAMETER
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000D)
+#endif
+#ifndef STATUS_NO_MEMORY
+#define STATUS_NO_MEMORY                ((NTSTATUS)0xC0000017)
+#endif
+#ifndef STATUS_NOT_SUPPORTED
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BB)
+#endif
+#ifndef STATUS_UNSUPPORTED_COMPRESSION
+#define STATUS_UNSUPPORTED_COMPRESSION  ((NTSTATUS)0xC000025F)
+#endif
+
+#ifndef C_ASSERT
+#define C_ASSERT(e) ((void)sizeof(char[(e) ? 1 : -1]))
+#endif
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define RtlpAllocateMemory(Bytes, Tag)  malloc(Bytes)
+#define RtlpFreeMemory(Mem, Tag)        free(Mem)
+
+/* So is compress.c, to test the formats end to end */
+#define COMPRESSION_FORMAT_NONE         (0x0000)
+#define COMPRESSION_FORMAT_DEFAULT      (0x0001)
+#define COMPRESSION_FORMAT_LZNT1        (0x0002)
+#define COMPRESSION_FORMAT_XPRESS       (0x0003)
+#define COMPRESSION_FORMAT_XPRESS_HUFF  (0x0004)
+#define COMPRESSION_ENGINE_STANDARD     (0x0000)
+#define COMPRESSION_ENGINE_MAXIMUM      (0x0100)
+
+typedef struct _COMPRESSED_DATA_INFO {
+    USHORT CompressionFormatAndEngine;
+    UCHAR CompressionUnitShift;
+    UCHAR ChunkShift;
+    UCHAR ClusterShift;
+    UCHAR Reserved;
+    USHORT NumberOfChunks;
+    ULONG CompressedChunkSizes[1];
+} COMPRESSED_DATA_INFO, *PCOMPRESSED_DATA_INFO;
+
+NTSTATUS
+NTAPI
+RtlCompressBuffer(
+    IN USHORT CompressionFormatAndEngine,
+    IN PUCHAR UncompressedBuffer,
+    IN ULONG UncompressedBufferSize,
+    OUT PUCHAR CompressedBuffer,
+    IN ULONG CompressedBufferSize,
+    IN ULONG UncompressedChunkSize,
+    OUT PULONG FinalCompressedSize,
+    IN PVOID WorkSpace);
+
+NTSTATUS
+NTAPI
+RtlDecompressBuffer(
+    IN USHORT CompressionFormat,
+    OUT PUCHAR UncompressedBuffer,
+    IN ULONG UncompressedBufferSize,
+    IN PUCHAR CompressedBuffer,
+    IN ULONG CompressedBufferSize,
+    OUT PULONG FinalUncompressedSize);
+
+NTSTATUS
+NTAPI
+RtlGetCompressionWorkSpaceSize(
+    IN USHORT CompressionFormatAndEngine,
+    OUT PULONG CompressBufferAndWorkSpaceSize,
+    OUT PULONG CompressFragmentWorkSpaceSize);
+
+#endif /* XPRESS_HOST */
+
+/* Plain LZ77 matches reach 8 KB back, Huffman ones 64 KB */
+#define XPRESS_WINDOW_SIZE              0x2000
+#define XPRESS_HUFF_WINDOW_SIZE         0xFFFF
+
+/* Every XPRESS Huffman block carries its own table and covers 64 KB of output */
+#define XPRESS_HUFF_BLOCK_SIZE          0x10000
+#define XPRESS_HUFF_SYMBOLS             512
+#define XPRESS_HUFF_TABLE_SIZE          (XPRESS_HUFF_SYMBOLS / 2)
+#define XPRESS_HUFF_MAX_CODE_LENGTH     15
+
+/* Match finder */
+#define XPRESS_MIN_MATCH                3
+#define XPRESS_MAX_HASH_BITS            15
+#define XPRESS_CHAIN_SIZE               0x10000
+#define XPRESS_STANDARD_DEPTH           1
+#define XPRESS_MAXIMUM_DEPTH            64
+
+ULONG
+NTAPI
+RtlpXpressWorkSpaceSize(
+    IN BOOLEAN Huffman,
+    IN BOOLEAN Maximum);
+
+NTSTATUS
+NTAPI
+RtlpXpressCompress(
+    IN PUCHAR Source,
+    IN ULONG SourceSize,
+    OUT PUCHAR Destination,
+    IN ULONG DestinationSize,
+    OUT PULONG FinalSize,
+    IN PVOID WorkSpace,
+    IN BOOLEAN Maximum);
+
+NTSTATUS
+NTAPI
+RtlpXpressDecompress(
+    OUT PUCHAR Destination,
+    IN ULONG DestinationSize,
+    IN PUCHAR Source,
+    IN ULONG SourceSize,
+    OUT PULONG FinalSize);
+
+NTSTATUS
+NTAPI
+RtlpXpressHuffCompress(
+    IN PUCHAR Source,
+    IN ULONG SourceSize,
+    OUT PUCHAR Destination,
+    IN ULONG DestinationSize,
+    OUT PULONG FinalSize,
+    IN PVOID WorkSpace,
+    IN BOOLEAN Maximum);
+
+NTSTATUS
+NTAPI
+RtlpXpressHuffDecompress(
+    OUT PUCHAR Destination,
+    IN ULONG DestinationSize,
+    IN PUCHAR Source,
+    IN ULONG SourceSize,
+    OUT PULONG FinalSize);
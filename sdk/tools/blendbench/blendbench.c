@@ -0,0 +1,366 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Correctness test and benchmark for the win32k AlphaBlend row kernels
+ * COPYRIGHT:   Copyright 2018 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <alphablend_row.h>
+
+#define AC_SRC_ALPHA    0x01
+
+#define ROW_PIXELS      1024
+#define BENCH_ROWS      4096
+
+static ULONG Seed = 0x12345678;
+
+static
+ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+/* The per pixel code of DIB_32BPP_AlphaBlend, DIB_24BPP_AlphaBlend and
+   DIB_16BPP_AlphaBlend, for a 32bpp source */
+
+typedef union
+{
+    ULONG ul;
+    struct
+    {
+        UCHAR red;
+        UCHAR green;
+        UCHAR blue;
+        UCHAR alpha;
+    } col;
+} NICEPIXEL32;
+
+typedef union
+{
+    USHORT us;
+    struct
+    {
+        USHORT blue  :5;
+        USHORT green :6;
+        USHORT red   :5;
+    } col;
+} NICEPIXEL16_565;
+
+typedef union
+{
+    USHORT us;
+    struct
+    {
+        USHORT blue  :5;
+        USHORT green :5;
+        USHORT red   :5;
+        USHORT xxxx  :1;
+    } col;
+} NICEPIXEL16_555;
+
+static UCHAR Clamp8(ULONG val) { return (val > 255) ? 255 : (UCHAR)val; }
+static UCHAR Clamp6(ULONG val) { return (val > 63) ? 63 : (UCHAR)val; }
+static UCHAR Clamp5(ULONG val) { return (val > 31) ? 31 : (UCHAR)val; }
+
+static
+void
+Reference32(ULONG *Dst, const ULONG *Src, ULONG Count, UCHAR ConstAlpha, UCHAR AlphaFormat)
+{
+    NICEPIXEL32 DstPixel, SrcPixel;
+    UCHAR Alpha;
+
+    while (Count--)
+    {
+        SrcPixel.ul = *Src++;
+        SrcPixel.col.red = (SrcPixel.col.red * ConstAlpha) / 255;
+        SrcPixel.col.green = (SrcPixel.col.green * ConstAlpha) / 255;
+        SrcPixel.col.blue = (SrcPixel.col.blue * ConstAlpha) / 255;
+        SrcPixel.col.alpha = (SrcPixel.col.alpha * ConstAlpha) / 255;
+
+        Alpha = (AlphaFormat & AC_SRC_ALPHA) ? SrcPixel.col.alpha : ConstAlpha;
+
+        DstPixel.ul = *Dst;
+        DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red);
+        DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green);
+        DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue);
+        DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha);
+        *Dst++ = DstPixel.ul;
+    }
+}
+
+static
+void
+Reference24(UCHAR *Dst, const ULONG *Src, ULONG Count, UCHAR ConstAlpha, UCHAR AlphaFormat)
+{
+    NICEPIXEL32 DstPixel, SrcPixel;
+    UCHAR Alpha;
+
+    while (Count--)
+    {
+        SrcPixel.ul = *Src++;
+        SrcPixel.col.red = (SrcPixel.col.red * ConstAlpha) / 255;
+        SrcPixel.col.green = (SrcPixel.col.green * ConstAlpha) / 255;
+        SrcPixel.col.blue = (SrcPixel.col.blue * ConstAlpha) / 255;
+        if (!(AlphaFormat & AC_SRC_ALPHA))
+            Alpha = ConstAlpha;
+        else
+            Alpha = (SrcPixel.col.alpha * ConstAlpha) / 255;
+
+        DstPixel.col.red = Clamp8((*Dst * (255 - Alpha)) / 255 + SrcPixel.col.red);
+        DstPixel.col.green = Clamp8((*(Dst+1) * (255 - Alpha) / 255 + SrcPixel.col.green));
+        DstPixel.col.blue = Clamp8((*(Dst+2) * (255 - Alpha)) / 255 + SrcPixel.col.blue);
+        *Dst++ = DstPixel.col.red;
+        *Dst++ = DstPixel.col.green;
+        *Dst++ = DstPixel.col.blue;
+    }
+}
+
+static
+void
+Reference565(USHORT *Dst, const ULONG *Src, ULONG Count, UCHAR ConstAlpha, UCHAR AlphaFormat)
+{
+    NICEPIXEL32 SrcPixel32;
+    NICEPIXEL16_565 DstPixel16;
+    UCHAR Alpha, Alpha6, Alpha5;
+
+    while (Count--)
+    {
+        SrcPixel32.ul = *Src++;
+        SrcPixel32.col.red = (SrcPixel32.col.red * ConstAlpha) / 255;
+        SrcPixel32.col.green = (SrcPixel32.col.green * ConstAlpha) / 255;
+        SrcPixel32.col.blue = (SrcPixel32.col.blue * ConstAlpha) / 255;
+
+        Alpha = (AlphaFormat & AC_SRC_ALPHA) ?
+                (SrcPixel32.col.alpha * ConstAlpha) / 255 : ConstAlpha;
+        Alpha6 = Alpha >> 2;
+        Alpha5 = Alpha >> 3;
+
+        DstPixel16.us = *Dst;
+        SrcPixel32.col.red >>= 3;
+        SrcPixel32.col.green >>= 2;
+        SrcPixel32.col.blue >>= 3;
+
+        DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha5)) / 31 + SrcPixel32.col.red);
+        DstPixel16.col.green = Clamp6((DstPixel16.col.green * (63 - Alpha6)) / 63 + SrcPixel32.col.green);
+        DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha5)) / 31 + SrcPixel32.col.blue);
+        *Dst++ = DstPixel16.us;
+    }
+}
+
+static
+void
+Reference555(USHORT *Dst, const ULONG *Src, ULONG Count, UCHAR ConstAlpha, UCHAR AlphaFormat)
+{
+    NICEPIXEL32 SrcPixel32;
+    NICEPIXEL16_555 DstPixel16;
+    UCHAR Alpha;
+
+    while (Count--)
+    {
+        SrcPixel32.ul = *Src++;
+        SrcPixel32.col.red = (SrcPixel32.col.red * ConstAlpha) / 255;
+        SrcPixel32.col.green = (SrcPixel32.col.green * ConstAlpha) / 255;
+        SrcPixel32.col.blue = (SrcPixel32.col.blue * ConstAlpha) / 255;
+
+        Alpha = (AlphaFormat & AC_SRC_ALPHA) ?
+                (SrcPixel32.col.alpha * ConstAlpha) / 255 : ConstAlpha;
+        Alpha >>= 3;
+
+        DstPixel16.us = *Dst;
+        SrcPixel32.col.red >>= 3;
+        SrcPixel32.col.green >>= 3;
+        SrcPixel32.col.blue >>= 3;
+
+        DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha)) / 31 + SrcPixel32.col.red);
+        DstPixel16.col.green = Clamp5((DstPixel16.col.green * (31 - Alpha)) / 31 + SrcPixel32.col.green);
+        DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha)) / 31 + SrcPixel32.col.blue);
+        *Dst++ = DstPixel16.us;
+    }
+}
+
+/* Premultiplied icons and layered windows: mostly transparent or opaque pixels
+   with antialiased edges. Straight alpha sources are thrown in as well, they
+   exercise the clamping */
+static
+void
+FillSource(ULONG *Src, ULONG Count, BOOLEAN Premultiplied)
+{
+    ULONG i, Alpha, Color, Run = 0, Kind = 0;
+
+    for (i = 0; i < Count; i++)
+    {
+        /* Pixels come in runs of the same kind, like in real images */
+        if (Run-- == 0)
+        {
+            Run = Random() % 32;
+            Kind = Random() % 4;
+        }
+
+        switch (Kind)
+        {
+            case 0: Alpha = 0; break;
+            case 1: Alpha = 255; break;
+            default: Alpha = Random() & 0xFF; break;
+        }
+
+        Color = Random() & 0xFFFFFF;
+        if (Premultiplied)
+        {
+            Color = ((((Color & 0xFF) * Alpha) / 255) |
+                     ((((Color >> 8) & 0xFF) * Alpha) / 255) << 8 |
+                     ((((Color >> 16) & 0xFF) * Alpha) / 255) << 16);
+        }
+
+        Src[i] = Color | (Alpha << 24);
+    }
+}
+
+static
+void
+FillBytes(void *Buffer, ULONG Size)
+{
+    UCHAR *Bytes = Buffer;
+
+    while (Size--)
+        *Bytes++ = (UCHAR)Random();
+}
+
+static const UCHAR ConstAlphas[] = { 255, 0, 1, 128, 200, 254 };
+
+static
+int
+TestCorrectness(void)
+{
+    static ULONG Src[ROW_PIXELS], Dst32[2][ROW_PIXELS];
+    static UCHAR Dst24[2][ROW_PIXELS * 3];
+    static USHORT Dst16[2][ROW_PIXELS];
+    ULONG Round, c, Count;
+    UCHAR AlphaFormat;
+    int Errors = 0;
+
+    for (Round = 0; Round < 200; Round++)
+    {
+        for (c = 0; c < sizeof(ConstAlphas); c++)
+        {
+            for (AlphaFormat = 0; AlphaFormat <= AC_SRC_ALPHA; AlphaFormat++)
+            {
+                /* Odd lengths too */
+                Count = 1 + Random() % ROW_PIXELS;
+                FillSource(Src, Count, (Round & 1) != 0);
+
+                FillBytes(Dst32[0], sizeof(Dst32[0]));
+                memcpy(Dst32[1], Dst32[0], sizeof(Dst32[0]));
+                Reference32(Dst32[0], Src, Count, ConstAlphas[c], AlphaFormat);
+                DIB_32BPP_AlphaBlendRow(Dst32[1], Src, Count, ConstAlphas[c], AlphaFormat != 0);
+                if (memcmp(Dst32[0], Dst32[1], sizeof(Dst32[0])) != 0)
+                {
+                    printf("32bpp mismatch, constant alpha %u, format %u\n", ConstAlphas[c], AlphaFormat);
+                    Errors++;
+                }
+
+                FillBytes(Dst24[0], sizeof(Dst24[0]));
+                memcpy(Dst24[1], Dst24[0], sizeof(Dst24[0]));
+                Reference24(Dst24[0], Src, Count, ConstAlphas[c], AlphaFormat);
+                DIB_24BPP_AlphaBlendRow(Dst24[1], Src, Count, ConstAlphas[c], AlphaFormat != 0);
+                if (memcmp(Dst24[0], Dst24[1], sizeof(Dst24[0])) != 0)
+                {
+                    printf("24bpp mismatch, constant alpha %u, format %u\n", ConstAlphas[c], AlphaFormat);
+                    Errors++;
+                }
+
+                FillBytes(Dst16[0], sizeof(Dst16[0]));
+                memcpy(Dst16[1], Dst16[0], sizeof(Dst16[0]));
+                Reference565(Dst16[0], Src, Count, ConstAlphas[c], AlphaFormat);
+                DIB_16BPP_AlphaBlendRow565(Dst16[1], Src, Count, ConstAlphas[c], AlphaFormat != 0);
+                if (memcmp(Dst16[0], Dst16[1], sizeof(Dst16[0])) != 0)
+                {
+                    printf("565 mismatch, constant alpha %u, format %u\n", ConstAlphas[c], AlphaFormat);
+                    Errors++;
+                }
+
+                FillBytes(Dst16[0], sizeof(Dst16[0]));
+                memcpy(Dst16[1], Dst16[0], sizeof(Dst16[0]));
+                Reference555(Dst16[0], Src, Count, ConstAlphas[c], AlphaFormat);
+                DIB_16BPP_AlphaBlendRow555(Dst16[1], Src, Count, ConstAlphas[c], AlphaFormat != 0);
+                if (memcmp(Dst16[0], Dst16[1], sizeof(Dst16[0])) != 0)
+                {
+                    printf("555 mismatch, constant alpha %u, format %u\n", ConstAlphas[c], AlphaFormat);
+                    Errors++;
+                }
+            }
+        }
+    }
+
+    return Errors;
+}
+
+static
+double
+Elapsed(clock_t Start)
+{
+    double Seconds = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+    return (Seconds > 0) ? Seconds : 1e-6;
+}
+
+#define BENCH(Name, Call)                                                           \
+    do                                                                              \
+    {                                                                               \
+        clock_t Start = clock();                                                    \
+        for (Row = 0; Row < BENCH_ROWS; Row++)                                      \
+            Call;                                                                   \
+        printf("  %-10s %8.1f Mpixels/s\n", Name,                                   \
+               (double)BENCH_ROWS * ROW_PIXELS / Elapsed(Start) / 1e6);             \
+    } while (0)
+
+static
+void
+Benchmark(UCHAR ConstAlpha, UCHAR AlphaFormat)
+{
+    static ULONG Src[ROW_PIXELS], Dst32[ROW_PIXELS];
+    static UCHAR Dst24[ROW_PIXELS * 3];
+    static USHORT Dst16[ROW_PIXELS];
+    BOOLEAN PerPixel = (AlphaFormat & AC_SRC_ALPHA) != 0;
+    ULONG Row;
+
+    FillSource(Src, ROW_PIXELS, TRUE);
+    FillBytes(Dst32, sizeof(Dst32));
+    FillBytes(Dst24, sizeof(Dst24));
+    FillBytes(Dst16, sizeof(Dst16));
+
+    printf("%s, constant alpha %u:\n", PerPixel ? "Per pixel alpha" : "Constant alpha", ConstAlpha);
+    BENCH("32bpp old", Reference32(Dst32, Src, ROW_PIXELS, ConstAlpha, AlphaFormat));
+    BENCH("32bpp new", DIB_32BPP_AlphaBlendRow(Dst32, Src, ROW_PIXELS, ConstAlpha, PerPixel));
+    BENCH("24bpp old", Reference24(Dst24, Src, ROW_PIXELS, ConstAlpha, AlphaFormat));
+    BENCH("24bpp new", DIB_24BPP_AlphaBlendRow(Dst24, Src, ROW_PIXELS, ConstAlpha, PerPixel));
+    BENCH("565 old", Reference565(Dst16, Src, ROW_PIXELS, ConstAlpha, AlphaFormat));
+    BENCH("565 new", DIB_16BPP_AlphaBlendRow565(Dst16, Src, ROW_PIXELS, ConstAlpha, PerPixel));
+}
+
+int main(int argc, char *argv[])
+{
+    int Errors;
+
+    Errors = TestCorrectness();
+    printf("Correctness: %s\n", Errors ? "FAILED" : "passed");
+    if (Errors)
+        return 1;
+
+    if (argc > 1 && strcmp(argv[1], "-q") == 0)
+        return 0;
+
+    /* The reference code here doesn't include the per pixel XLATEOBJ and
+       DIB_GetPixel/DIB_PutPixel calls win32k makes, so the real gain is larger */
+    Benchmark(255, AC_SRC_ALPHA);
+    Benchmark(128, AC_SRC_ALPHA);
+    Benchmark(128, 0);
+
+    return 0;
+}
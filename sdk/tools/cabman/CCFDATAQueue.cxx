@@ -0,0 +1,279 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CCFDATAQueue class implementation, compresses data blocks on worker threads
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cabinet.h"
+
+#if !defined(CAB_READ_ONLY)
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Default constructor
+*/
+CCFDATAQueue::CCFDATAQueue()
+{
+    Jobs       = NULL;
+    JobCount   = 0;
+    Oldest     = 0;
+    Queued     = 0;
+    Dispatched = 0;
+    Stop       = false;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Default destructor
+*/
+CCFDATAQueue::~CCFDATAQueue()
+{
+    Destroy();
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Starts the worker threads, each with its own codec
+*
+* @param CodecId
+* Codec to compress the data blocks with. It must be stateless
+*
+* @param ThreadCount
+* Number of worker threads
+*
+* @return
+* Status of operation
+*/
+ULONG CCFDATAQueue::Create(LONG CodecId, ULONG ThreadCount)
+{
+    CCABCodec* Codec;
+    ULONG i;
+
+    /* Two blocks per thread keep the workers busy while the oldest is written */
+    JobCount = 2 * ThreadCount;
+    Jobs = (PCFDATA_JOB)calloc(JobCount, sizeof(CFDATA_JOB));
+    if (!Jobs)
+        return CAB_STATUS_NOMEMORY;
+
+    for (i = 0; i < JobCount; i++)
+    {
+        Jobs[i].InputBuffer  = malloc(CAB_BLOCKSIZE);
+        Jobs[i].OutputBuffer = malloc(CAB_MAX_COMPSIZE);
+        if (!Jobs[i].InputBuffer || !Jobs[i].OutputBuffer)
+        {
+            Destroy();
+            return CAB_STATUS_NOMEMORY;
+        }
+    }
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Codec = CCabinet::NewCodec(CodecId);
+        if (!Codec)
+        {
+            Destroy();
+            return CAB_STATUS_UNSUPPCOMP;
+        }
+
+        Codecs.push_back(Codec);
+        Threads.push_back(std::thread(&CCFDATAQueue::Worker, this, Codec));
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Stops the worker threads and frees the data blocks
+*/
+void CCFDATAQueue::Destroy()
+{
+    ULONG i;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Stop = true;
+    }
+    JobQueued.notify_all();
+
+    for (i = 0; i < Threads.size(); i++)
+        Threads[i].join();
+    Threads.clear();
+
+    for (i = 0; i < Codecs.size(); i++)
+        delete Codecs[i];
+    Codecs.clear();
+
+    if (Jobs)
+    {
+        for (i = 0; i < JobCount; i++)
+        {
+            free(Jobs[i].InputBuffer);
+            free(Jobs[i].OutputBuffer);
+        }
+        free(Jobs);
+        Jobs = NULL;
+    }
+
+    JobCount = 0;
+    Oldest = Queued = Dispatched = 0;
+    Stop = false;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Returns whether there are no data blocks in the queue
+*/
+bool CCFDATAQueue::IsEmpty()
+{
+    return (Queued == Oldest);
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Returns whether all data blocks in the queue are in use
+*/
+bool CCFDATAQueue::IsFull()
+{
+    return (Queued - Oldest == JobCount);
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Returns the data block to fill in before calling Submit
+*
+* @return
+* Pointer to data block, NULL if the queue is full
+*/
+PCFDATA_JOB CCFDATAQueue::GetFreeJob()
+{
+    PCFDATA_JOB Job;
+
+    if (IsFull())
+        return NULL;
+
+    Job = &Jobs[Queued % JobCount];
+    Job->Done = false;
+    Job->Status = CS_SUCCESS;
+    Job->OutputLength = 0;
+
+    return Job;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Hands the data block returned by GetFreeJob to the workers
+*/
+void CCFDATAQueue::Submit()
+{
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Queued++;
+    }
+    JobQueued.notify_one();
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Waits until the oldest data block is compressed. Blocks are always
+* returned in the order they were submitted
+*
+* @return
+* Pointer to data block, NULL if the queue is empty
+*/
+PCFDATA_JOB CCFDATAQueue::WaitOldest()
+{
+    PCFDATA_JOB Job;
+
+    if (IsEmpty())
+        return NULL;
+
+    Job = &Jobs[Oldest % JobCount];
+
+    std::unique_lock<std::mutex> Guard(Lock);
+    while (!Job->Done)
+        JobDone.wait(Guard);
+
+    return Job;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Frees the data block returned by WaitOldest
+*/
+void CCFDATAQueue::Release()
+{
+    ASSERT(!IsEmpty());
+    Oldest++;
+}
+
+/**
+* @name CCFDATAQueue class
+* @implemented
+*
+* Worker thread, compresses data blocks in the order they are queued
+*
+* @param Codec
+* Codec owned by this thread
+*/
+void CCFDATAQueue::Worker(CCABCodec* Codec)
+{
+    PCFDATA_JOB Job;
+    ULONG Status;
+    ULONG Length;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Guard(Lock);
+            while (!Stop && (Dispatched == Queued))
+                JobQueued.wait(Guard);
+
+            if (Stop)
+                return;
+
+            Job = &Jobs[Dispatched % JobCount];
+            Dispatched++;
+        }
+
+        Length = 0;
+        Status = Codec->Compress(Job->OutputBuffer,
+            Job->InputBuffer,
+            Job->InputLength,
+            &Length);
+
+        {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Job->OutputLength = Length;
+            Job->Status = Status;
+            Job->Done = true;
+        }
+        JobDone.notify_all();
+    }
+}
+
+#endif /* CAB_READ_ONLY */
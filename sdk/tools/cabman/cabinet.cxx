@@ -18,14 +18,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #if !defined(_WIN32)
 # include <dirent.h>
+# include <sys/mman.h>
 # include <sys/stat.h>
 # include <sys/types.h>
 #endif
 #include "cabinet.h"
 #include "raw.h"
 #include "mszip.h"
+#include "lzx.h"
 
 #ifndef CAB_READ_ONLY
 
@@ -81,6 +84,8 @@ CCabinet::CCabinet()
     *CabinetReservedFile = '\0';
 
     FileOpen = false;
+    CabinetView = NULL;
+    CabinetViewSize = 0;
     CabinetReservedFileBuffer = NULL;
     CabinetReservedFileSize = 0;
 
@@ -88,6 +93,8 @@ CCabinet::CCabinet()
     FolderListTail   = NULL;
     FileListHead     = NULL;
     FileListTail     = NULL;
+    FileHashTable    = NULL;
+    FileHashMask     = 0;
     CriteriaListHead = NULL;
     CriteriaListTail = NULL;
 
@@ -105,6 +112,13 @@ CCabinet::CCabinet()
     BytesLeftInBlock = 0;
     ReuseBlock       = false;
     CurrentDataNode  = NULL;
+
+#ifndef CAB_READ_ONLY
+    CompressQueue     = NULL;
+    UncompressedBytes = 0;
+    CompressedBytes   = 0;
+    SetThreadCount(std::thread::hardware_concurrency());
+#endif /* CAB_READ_ONLY */
 }
 
 
@@ -122,6 +136,11 @@ CCabinet::~CCabinet()
 
     if (CodecSelected)
         delete Codec;
+
+#ifndef CAB_READ_ONLY
+    if (CompressQueue)
+        delete CompressQueue;
+#endif /* CAB_READ_ONLY */
 }
 
 bool CCabinet::IsSeparator(char Char)
@@ -369,6 +388,8 @@ bool CCabinet::SetCompressionCodec(char* CodecName)
         SelectCodec(CAB_CODEC_RAW);
     else if( !strcasecmp(CodecName, "mszip") )
         SelectCodec(CAB_CODEC_MSZIP);
+    else if( !strcasecmp(CodecName, "lzx") )
+        SelectCodec(CAB_CODEC_LZX);
     else
     {
         printf("ERROR: Invalid codec specified!\n");
@@ -616,6 +637,11 @@ ULONG CCabinet::Open()
             }
             FolderNode = FolderNode->Next;
         }
+
+        /* Extraction falls back to reading the file if it cannot be mapped */
+        Status = MapCabinet();
+        if (Status != CAB_STATUS_SUCCESS)
+            DPRINT(MID_TRACE, ("Cannot map cabinet file (%u).\n", (UINT)Status));
     }
     return CAB_STATUS_SUCCESS;
 }
@@ -628,6 +654,7 @@ void CCabinet::Close()
 {
     if (FileOpen)
     {
+        UnmapCabinet();
         fclose(FileHandle);
         FileOpen = false;
     }
@@ -658,8 +685,6 @@ ULONG CCabinet::FindNext(PCAB_SEARCH Search)
  *     Status of operation
  */
 {
-    bool bFound = false;
-    PSEARCH_CRITERIA Criteria;
     ULONG Status;
 
     if (RestartSearch)
@@ -680,31 +705,8 @@ ULONG CCabinet::FindNext(PCAB_SEARCH Search)
     }
 
     /* Check each search criteria against each file */
-    while(Search->Next)
-    {
-        // Some features (like displaying cabinets) don't require search criteria, so we can just break here.
-        // If a feature requires it, handle this in the ParseCmdline() function in "main.cxx".
-        if(!CriteriaListHead)
-            break;
-
-        Criteria = CriteriaListHead;
-
-        while(Criteria)
-        {
-            if(MatchFileNamePattern(Search->Next->FileName, Criteria->Search))
-            {
-                bFound = true;
-                break;
-            }
-
-            Criteria = Criteria->Next;
-        }
-
-        if(bFound)
-            break;
-
+    while (Search->Next && !MatchSearchCriteria(Search->Next->FileName))
         Search->Next = Search->Next->Next;
-    }
 
     if (!Search->Next)
     {
@@ -760,10 +762,6 @@ ULONG CCabinet::ExtractFile(char* FileName)
     CFDATA CFData;
     ULONG Status;
     bool Skip;
-#if defined(_WIN32)
-    FILETIME FileTime;
-#endif
-    CHAR DestName[PATH_MAX];
     CHAR TempName[PATH_MAX];
 
     Status = LocateFile(FileName, &File);
@@ -795,45 +793,9 @@ ULONG CCabinet::ExtractFile(char* FileName)
         (UINT)File->DataBlock->AbsoluteOffset,
         (UINT)File->DataBlock->UncompOffset));
 
-    strcpy(DestName, DestPath);
-    strcat(DestName, FileName);
-
-    /* Create destination file, fail if it already exists */
-    DestFile = fopen(DestName, "rb");
-    if (DestFile != NULL)
-    {
-        fclose(DestFile);
-        /* If file exists, ask to overwrite file */
-        if (OnOverwrite(&File->File, FileName))
-        {
-            DestFile = fopen(DestName, "w+b");
-            if (DestFile == NULL)
-                return CAB_STATUS_CANNOT_CREATE;
-        }
-        else
-            return CAB_STATUS_FILE_EXISTS;
-    }
-    else
-    {
-        DestFile = fopen(DestName, "w+b");
-        if (DestFile == NULL)
-            return CAB_STATUS_CANNOT_CREATE;
-    }
-
-#if defined(_WIN32)
-    if (!DosDateTimeToFileTime(File->File.FileDate, File->File.FileTime, &FileTime))
-    {
-        fclose(DestFile);
-        DPRINT(MIN_TRACE, ("DosDateTimeToFileTime() failed (%u).\n", (UINT)GetLastError()));
-        return CAB_STATUS_CANNOT_WRITE;
-    }
-
-    SetFileTime(DestFile, NULL, &FileTime, NULL);
-#else
-    //DPRINT(MIN_TRACE, ("FIXME: DosDateTimeToFileTime\n"));
-#endif
-
-    SetAttributesOnFile(DestName, File->File.Attributes);
+    Status = CreateDestFile(File, FileName, &DestFile);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
 
     Buffer = (PUCHAR)malloc(CAB_BLOCKSIZE + 12); // This should be enough
     if (!Buffer)
@@ -843,9 +805,6 @@ ULONG CCabinet::ExtractFile(char* FileName)
         return CAB_STATUS_NOMEMORY;
     }
 
-    /* Call OnExtract event handler */
-    OnExtract(&File->File, FileName);
-
     /* Search to start of file */
     if (fseek(FileHandle, (off_t)File->DataBlock->AbsoluteOffset, SEEK_SET) != 0)
     {
@@ -1095,6 +1054,348 @@ ULONG CCabinet::ExtractFile(char* FileName)
     return CAB_STATUS_SUCCESS;
 }
 
+ULONG CCabinet::CreateDestFile(PCFFILE_NODE File,
+                               char* FileName,
+                               FILE** DestFile)
+/*
+ * FUNCTION: Creates the destination file for a file being extracted
+ * ARGUMENTS:
+ *     File     = Pointer to CFFILE_NODE structure for file
+ *     FileName = Pointer to buffer with name of file
+ *     DestFile = Address of buffer to place handle of destination file
+ * RETURNS
+ *     Status of operation
+ */
+{
+#if defined(_WIN32)
+    FILETIME FileTime;
+#endif
+    CHAR DestName[PATH_MAX];
+    FILE* Handle;
+
+    strcpy(DestName, DestPath);
+    strcat(DestName, FileName);
+
+    /* Create destination file, fail if it already exists */
+    Handle = fopen(DestName, "rb");
+    if (Handle != NULL)
+    {
+        fclose(Handle);
+        /* If file exists, ask to overwrite file */
+        if (OnOverwrite(&File->File, FileName))
+        {
+            Handle = fopen(DestName, "w+b");
+            if (Handle == NULL)
+                return CAB_STATUS_CANNOT_CREATE;
+        }
+        else
+            return CAB_STATUS_FILE_EXISTS;
+    }
+    else
+    {
+        Handle = fopen(DestName, "w+b");
+        if (Handle == NULL)
+            return CAB_STATUS_CANNOT_CREATE;
+    }
+
+#if defined(_WIN32)
+    if (!DosDateTimeToFileTime(File->File.FileDate, File->File.FileTime, &FileTime))
+    {
+        fclose(Handle);
+        DPRINT(MIN_TRACE, ("DosDateTimeToFileTime() failed (%u).\n", (UINT)GetLastError()));
+        return CAB_STATUS_CANNOT_WRITE;
+    }
+
+    SetFileTime(Handle, NULL, &FileTime, NULL);
+#else
+    //DPRINT(MIN_TRACE, ("FIXME: DosDateTimeToFileTime\n"));
+#endif
+
+    SetAttributesOnFile(DestName, File->File.Attributes);
+
+    /* Call OnExtract event handler */
+    OnExtract(&File->File, FileName);
+
+    *DestFile = Handle;
+    return CAB_STATUS_SUCCESS;
+}
+
+
+static ULONG HashFileName(char* FileName)
+/*
+ * FUNCTION: Computes a case insensitive hash of a file name
+ */
+{
+    ULONG Hash = 2166136261U;
+
+    while (*FileName)
+    {
+        Hash ^= (UCHAR)tolower((UCHAR)*FileName++);
+        Hash *= 16777619;
+    }
+    return Hash;
+}
+
+
+static int CompareExtractFiles(const void* A, const void* B)
+/*
+ * FUNCTION: Orders files to extract by folder and uncompressed offset
+ */
+{
+    PCFFILE FileA = &((PCAB_EXTRACT)A)->File->File;
+    PCFFILE FileB = &((PCAB_EXTRACT)B)->File->File;
+
+    if (FileA->FileControlID != FileB->FileControlID)
+        return (FileA->FileControlID < FileB->FileControlID) ? -1 : 1;
+    if (FileA->FileOffset != FileB->FileOffset)
+        return (FileA->FileOffset < FileB->FileOffset) ? -1 : 1;
+    return 0;
+}
+
+
+ULONG CCabinet::ExtractFiles()
+/*
+ * FUNCTION: Extracts all files that match the search criteria
+ * RETURNS
+ *     Status of operation
+ * NOTES:
+ *     Each folder is uncompressed only once, and all requested files
+ *     in it are written while its data blocks are streamed from the
+ *     mapped cabinet file
+ */
+{
+    CAB_SEARCH Search;
+    PCAB_EXTRACT Files;
+    PCFFOLDER_NODE FolderNode;
+    PCFFILE_NODE File;
+    ULONG Count;
+    ULONG First;
+    ULONG i;
+    ULONG Status;
+
+    /* Files in a cabinet set may continue in the next cabinet, so
+       extract them one by one like ExtractFile() always did */
+    if (!CabinetView || (CABHeader.Flags & (CAB_FLAG_HASPREV | CAB_FLAG_HASNEXT)))
+    {
+        if (FindFirst(&Search) == CAB_STATUS_SUCCESS)
+        {
+            do
+            {
+                Status = ExtractFile(Search.FileName);
+                if (Status != CAB_STATUS_SUCCESS)
+                    return Status;
+            } while (FindNext(&Search) == CAB_STATUS_SUCCESS);
+        }
+        return CAB_STATUS_SUCCESS;
+    }
+
+    Files = (PCAB_EXTRACT)malloc(CABHeader.FileCount * sizeof(CAB_EXTRACT));
+    if (!Files)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    Count = 0;
+    for (File = FileListHead; File != NULL; File = File->Next)
+    {
+        if (!MatchSearchCriteria(File->FileName))
+            continue;
+
+        Files[Count].File     = File;
+        Files[Count].DestFile = NULL;
+        Files[Count].Done     = false;
+        Count++;
+    }
+
+    qsort(Files, Count, sizeof(CAB_EXTRACT), CompareExtractFiles);
+
+    Status = CAB_STATUS_SUCCESS;
+    for (First = 0; (First < Count) && (Status == CAB_STATUS_SUCCESS); First = i)
+    {
+        /* Gather the files in the same folder */
+        for (i = First + 1; i < Count; i++)
+        {
+            if (Files[i].File->File.FileControlID != Files[First].File->File.FileControlID)
+                break;
+        }
+
+        FolderNode = LocateFolderNode(Files[First].File->File.FileControlID);
+        if (!FolderNode)
+        {
+            DPRINT(MID_TRACE, ("Folder with index number (%u) not found.\n",
+                Files[First].File->File.FileControlID));
+            Status = CAB_STATUS_INVALID_CAB;
+            break;
+        }
+
+        Status = ExtractFolder(FolderNode, &Files[First], i - First);
+    }
+
+    free(Files);
+
+    return Status;
+}
+
+
+ULONG CCabinet::ExtractFolder(PCFFOLDER_NODE FolderNode,
+                              PCAB_EXTRACT Files,
+                              ULONG Count)
+/*
+ * FUNCTION: Extracts files from a folder in the mapped cabinet file
+ * ARGUMENTS:
+ *     FolderNode = Pointer to CFFOLDER_NODE structure for folder
+ *     Files      = Pointer to files to extract, sorted by uncompressed offset
+ *     Count      = Number of files to extract
+ * RETURNS
+ *     Status of operation
+ */
+{
+    PCFDATA_NODE Node;
+    PCFFILE File;
+    ULONG BlockStart;
+    ULONG BlockEnd;
+    ULONG Start;
+    ULONG End;
+    ULONG BytesToWrite;
+    ULONG FilesLeft;
+    ULONG Next;
+    ULONG Status;
+    ULONG i;
+
+    switch (FolderNode->Folder.CompressionType & CAB_COMP_MASK)
+    {
+        case CAB_COMP_NONE:
+            SelectCodec(CAB_CODEC_RAW);
+            break;
+
+        case CAB_COMP_MSZIP:
+            SelectCodec(CAB_CODEC_MSZIP);
+            break;
+
+        case CAB_COMP_LZX:
+            SelectCodec(CAB_CODEC_LZX);
+            break;
+
+        default:
+            return CAB_STATUS_UNSUPPCOMP;
+    }
+
+    if (!CodecSelected || !Codec->Reset(FolderNode->Folder.CompressionType))
+        return CAB_STATUS_UNSUPPCOMP;
+
+    /* Empty files need no data blocks */
+    FilesLeft = 0;
+    for (i = 0; i < Count; i++)
+    {
+        if (Files[i].File->File.FileSize > 0)
+        {
+            FilesLeft++;
+            continue;
+        }
+
+        Status = CreateDestFile(Files[i].File, Files[i].File->FileName, &Files[i].DestFile);
+        if (Status != CAB_STATUS_SUCCESS)
+            goto Cleanup;
+
+        fclose(Files[i].DestFile);
+        Files[i].DestFile = NULL;
+        Files[i].Done = true;
+    }
+
+    Next = 0;
+    Status = CAB_STATUS_SUCCESS;
+    for (Node = FolderNode->DataListHead; (Node != NULL) && (FilesLeft > 0); Node = Node->Next)
+    {
+        while (Files[Next].Done)
+            Next++;
+
+        BlockStart = Node->UncompOffset;
+        BlockEnd   = BlockStart + Node->Data.UncompSize;
+
+        /* Skip data blocks in front of the next file, unless
+           the codec needs them for the history */
+        if ((BlockEnd <= Files[Next].File->File.FileOffset) && Codec->IsStateless())
+            continue;
+
+        if ((Node->Data.UncompSize > CAB_BLOCKSIZE) ||
+            (Node->AbsoluteOffset + sizeof(CFDATA) + Node->Data.CompSize > CabinetViewSize) ||
+            (((FolderNode->Folder.CompressionType & CAB_COMP_MASK) == CAB_COMP_NONE) &&
+            (Node->Data.CompSize != Node->Data.UncompSize)))
+        {
+            DPRINT(MIN_TRACE, ("Bad data block at absolute offset (0x%X).\n", (UINT)Node->AbsoluteOffset));
+            Status = CAB_STATUS_INVALID_CAB;
+            goto Cleanup;
+        }
+
+        Status = Codec->Uncompress(OutputBuffer,
+            CabinetView + Node->AbsoluteOffset + sizeof(CFDATA),
+            Node->Data.CompSize,
+            &BytesToWrite);
+        if ((Status != CS_SUCCESS) || (BytesToWrite != Node->Data.UncompSize))
+        {
+            DPRINT(MID_TRACE, ("Cannot uncompress block.\n"));
+            Status = (Status == CS_NOMEMORY) ? CAB_STATUS_NOMEMORY : CAB_STATUS_INVALID_CAB;
+            goto Cleanup;
+        }
+
+        /* Write the part of each file that is in this block */
+        for (i = Next; (i < Count) && (Files[i].File->File.FileOffset < BlockEnd); i++)
+        {
+            if (Files[i].Done)
+                continue;
+
+            File  = &Files[i].File->File;
+            Start = (File->FileOffset > BlockStart) ? File->FileOffset : BlockStart;
+            End   = (File->FileOffset + File->FileSize < BlockEnd) ? File->FileOffset + File->FileSize : BlockEnd;
+            if (Start >= End)
+                continue;
+
+            if (!Files[i].DestFile)
+            {
+                Status = CreateDestFile(Files[i].File, Files[i].File->FileName, &Files[i].DestFile);
+                if (Status != CAB_STATUS_SUCCESS)
+                    goto Cleanup;
+            }
+
+            if (fwrite((PUCHAR)OutputBuffer + (Start - BlockStart), End - Start, 1, Files[i].DestFile) < 1)
+            {
+                DPRINT(MIN_TRACE, ("Cannot write to file.\n"));
+                Status = CAB_STATUS_CANNOT_WRITE;
+                goto Cleanup;
+            }
+
+            if (End == File->FileOffset + File->FileSize)
+            {
+                fclose(Files[i].DestFile);
+                Files[i].DestFile = NULL;
+                Files[i].Done = true;
+                FilesLeft--;
+            }
+        }
+    }
+
+    /* The folder ended before all files were written */
+    if (FilesLeft > 0)
+    {
+        DPRINT(MIN_TRACE, ("Folder (%u) is truncated.\n", (UINT)FolderNode->Index));
+        Status = CAB_STATUS_INVALID_CAB;
+    }
+
+Cleanup:
+    for (i = 0; i < Count; i++)
+    {
+        if (Files[i].DestFile)
+        {
+            fclose(Files[i].DestFile);
+            Files[i].DestFile = NULL;
+        }
+    }
+
+    return Status;
+}
+
+
 bool CCabinet::IsCodecSelected()
 /*
  * FUNCTION: Returns the value of CodecSelected
@@ -1105,6 +1406,31 @@ bool CCabinet::IsCodecSelected()
     return CodecSelected;
 }
 
+CCABCodec* CCabinet::NewCodec(LONG Id)
+/*
+ * FUNCTION: Creates a codec engine
+ * ARGUMENTS:
+ *     Id = Codec identifier
+ * RETURNS:
+ *     Pointer to codec, NULL if the codec is not supported
+ */
+{
+    switch (Id)
+    {
+        case CAB_CODEC_RAW:
+            return new CRawCodec();
+
+        case CAB_CODEC_MSZIP:
+            return new CMSZipCodec();
+
+        case CAB_CODEC_LZX:
+            return new CLZXCodec();
+
+        default:
+            return NULL;
+    }
+}
+
 void CCabinet::SelectCodec(LONG Id)
 /*
  * FUNCTION: Selects codec engine to use
@@ -1121,19 +1447,9 @@ void CCabinet::SelectCodec(LONG Id)
         delete Codec;
     }
 
-    switch (Id)
-    {
-        case CAB_CODEC_RAW:
-            Codec = new CRawCodec();
-            break;
-
-        case CAB_CODEC_MSZIP:
-            Codec = new CMSZipCodec();
-            break;
-
-        default:
-            return;
-    }
+    Codec = NewCodec(Id);
+    if (!Codec)
+        return;
 
     CodecId       = Id;
     CodecSelected = true;
@@ -1155,13 +1471,29 @@ ULONG CCabinet::NewCabinet()
 
     CurrentDiskNumber = 0;
 
-    OutputBuffer = malloc(CAB_BLOCKSIZE + 12); // This should be enough
-    InputBuffer  = malloc(CAB_BLOCKSIZE + 12); // This should be enough
+    /* InputBuffer also holds compressed blocks when they are committed */
+    OutputBuffer = malloc(CAB_MAX_COMPSIZE);
+    InputBuffer  = malloc(CAB_MAX_COMPSIZE);
     if ((!OutputBuffer) || (!InputBuffer))
     {
         DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
         return CAB_STATUS_NOMEMORY;
     }
+
+    /* Blocks of stateless codecs can be compressed on worker threads.
+       The queue keeps them in order so the cabinet stays the same */
+    if (!CompressQueue && (ThreadCount > 1) && CodecSelected && Codec->IsStateless())
+    {
+        CompressQueue = new CCFDATAQueue;
+        Status = CompressQueue->Create(CodecId, ThreadCount);
+        if (Status != CAB_STATUS_SUCCESS)
+        {
+            DPRINT(MIN_TRACE, ("Cannot start compression threads (%u).\n", (UINT)Status));
+            delete CompressQueue;
+            CompressQueue = NULL;
+        }
+    }
+
     CurrentIBuffer     = InputBuffer;
     CurrentIBufferSize = 0;
 
@@ -1264,10 +1596,17 @@ ULONG CCabinet::NewFolder()
             CurrentFolderNode->Folder.CompressionType = CAB_COMP_MSZIP;
             break;
 
+        case CAB_CODEC_LZX:
+            CurrentFolderNode->Folder.CompressionType = CAB_COMP_LZX | (LZX_WINDOW_BITS << 8);
+            break;
+
         default:
             return CAB_STATUS_UNSUPPCOMP;
     }
 
+    /* Every folder starts with a fresh history */
+    Codec->Reset(CurrentFolderNode->Folder.CompressionType);
+
     /* FIXME: This won't work if no files are added to the new folder */
 
     DiskSize += sizeof(CFFOLDER);
@@ -1496,6 +1835,11 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
     PCFFOLDER_NODE FolderNode;
     ULONG Status;
 
+    /* All data blocks must be in the scratch file */
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     OnCabinetName(CurrentDiskNumber, CabinetName);
 
     /* Create file, fail if it already exists */
@@ -1584,6 +1928,14 @@ ULONG CCabinet::CloseCabinet()
 
     DestroyFolderNodes();
 
+#ifndef CAB_READ_ONLY
+    if (CompressQueue)
+    {
+        delete CompressQueue;
+        CompressQueue = NULL;
+    }
+#endif /* CAB_READ_ONLY */
+
     if (InputBuffer)
     {
         free(InputBuffer);
@@ -1837,6 +2189,33 @@ void CCabinet::SetMaxDiskSize(ULONG Size)
     MaxDiskSize = Size;
 }
 
+void CCabinet::SetThreadCount(ULONG Count)
+/*
+ * FUNCTION: Sets the number of threads to compress data blocks on
+ * ARGUMENTS:
+ *     Count = Number of threads (1 compresses on the calling thread)
+ */
+{
+    if (Count < 1)
+        Count = 1;
+    if (Count > CAB_MAX_THREADS)
+        Count = CAB_MAX_THREADS;
+
+    ThreadCount = Count;
+}
+
+void CCabinet::GetCompressionStatistics(ULONGLONG* Uncompressed, ULONGLONG* Compressed)
+/*
+ * FUNCTION: Returns how much data was compressed in the current cabinet
+ * ARGUMENTS:
+ *     Uncompressed = Address of buffer to place number of bytes compressed
+ *     Compressed   = Address of buffer to place their compressed size
+ */
+{
+    *Uncompressed = UncompressedBytes;
+    *Compressed   = CompressedBytes;
+}
+
 #endif /* CAB_READ_ONLY */
 
 
@@ -1924,6 +2303,108 @@ bool CCabinet::OnCabinetName(ULONG Number, char* Name)
 
 #endif /* CAB_READ_ONLY */
 
+ULONG CCabinet::MapCabinet()
+/*
+ * FUNCTION: Maps the cabinet file into memory
+ * RETURNS:
+ *     Status of operation
+ */
+{
+#if defined(_WIN32)
+    HANDLE File;
+    HANDLE Mapping;
+    LARGE_INTEGER Size;
+
+    File = CreateFileA(CabinetName, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+        return CAB_STATUS_CANNOT_OPEN;
+
+    if (!GetFileSizeEx(File, &Size) || (Size.HighPart != 0))
+    {
+        CloseHandle(File);
+        return CAB_STATUS_INVALID_CAB;
+    }
+
+    Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(File);
+    if (!Mapping)
+        return CAB_STATUS_FAILURE;
+
+    /* The view keeps the mapping alive */
+    CabinetView = (PUCHAR)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(Mapping);
+    if (!CabinetView)
+        return CAB_STATUS_FAILURE;
+
+    CabinetViewSize = Size.LowPart;
+#else
+    struct stat Stat;
+    void* View;
+
+    if ((fstat(fileno(FileHandle), &Stat) != 0) || (Stat.st_size > (off_t)MAXULONG))
+        return CAB_STATUS_INVALID_CAB;
+
+    View = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, fileno(FileHandle), 0);
+    if (View == MAP_FAILED)
+        return CAB_STATUS_FAILURE;
+
+    /* Folders are read from start to end */
+    posix_madvise(View, (size_t)Stat.st_size, POSIX_MADV_SEQUENTIAL);
+
+    CabinetView     = (PUCHAR)View;
+    CabinetViewSize = (ULONG)Stat.st_size;
+#endif
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+void CCabinet::UnmapCabinet()
+/*
+ * FUNCTION: Unmaps the cabinet file
+ */
+{
+    if (!CabinetView)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(CabinetView);
+#else
+    munmap(CabinetView, CabinetViewSize);
+#endif
+
+    CabinetView     = NULL;
+    CabinetViewSize = 0;
+}
+
+
+bool CCabinet::MatchSearchCriteria(char* FileName)
+/*
+ * FUNCTION: Checks a file name against the search criteria
+ * ARGUMENTS:
+ *     FileName = Pointer to string with name of file
+ * RETURNS:
+ *     true if the file name matches any search criteria, false if not
+ */
+{
+    PSEARCH_CRITERIA Criteria;
+
+    // Some features (like displaying cabinets) don't require search criteria, so we can just return here.
+    // If a feature requires it, handle this in the ParseCmdline() function in "main.cxx".
+    if (!CriteriaListHead)
+        return true;
+
+    for (Criteria = CriteriaListHead; Criteria != NULL; Criteria = Criteria->Next)
+    {
+        if (MatchFileNamePattern(FileName, Criteria->Search))
+            return true;
+    }
+
+    return false;
+}
+
+
 PCFFOLDER_NODE CCabinet::LocateFolderNode(ULONG Index)
 /*
  * FUNCTION: Locates a folder node
@@ -2015,7 +2496,11 @@ ULONG CCabinet::LocateFile(char* FileName,
 
     DPRINT(MAX_TRACE, ("FileName '%s'\n", FileName));
 
-    Node = FileListHead;
+    if (FileHashTable)
+        Node = FileHashTable[HashFileName(FileName) & FileHashMask];
+    else
+        Node = FileListHead;
+
     while (Node != NULL)
     {
         if (strcasecmp(FileName, Node->FileName) == 0)
@@ -2036,7 +2521,7 @@ ULONG CCabinet::LocateFile(char* FileName,
             *File = Node;
             return Status;
         }
-        Node = Node->Next;
+        Node = FileHashTable ? Node->HashNext : Node->Next;
     }
     return CAB_STATUS_NOFILE;
 }
@@ -2154,10 +2639,60 @@ ULONG CCabinet::ReadFileTable()
             File->File.FileControlID));
 
     }
+
+    return BuildFileIndex();
+}
+
+
+ULONG CCabinet::BuildFileIndex()
+/*
+ * FUNCTION: Hashes the file nodes by name so LocateFile doesn't have to walk the file list
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PCFFILE_NODE File;
+    ULONG Size;
+    ULONG Bucket;
+
+    DestroyFileIndex();
+
+    for (Size = 16; Size < 2 * (ULONG)CABHeader.FileCount; Size *= 2);
+
+    FileHashTable = (PCFFILE_NODE*)calloc(Size, sizeof(PCFFILE_NODE));
+    if (!FileHashTable)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+    FileHashMask = Size - 1;
+
+    /* Insert from the tail so the first file with a name is found first */
+    for (File = FileListTail; File != NULL; File = File->Prev)
+    {
+        Bucket = HashFileName(File->FileName) & FileHashMask;
+        File->HashNext = FileHashTable[Bucket];
+        FileHashTable[Bucket] = File;
+    }
+
     return CAB_STATUS_SUCCESS;
 }
 
 
+void CCabinet::DestroyFileIndex()
+/*
+ * FUNCTION: Destroys the file name hash table
+ */
+{
+    if (FileHashTable)
+    {
+        free(FileHashTable);
+        FileHashTable = NULL;
+    }
+    FileHashMask = 0;
+}
+
+
 ULONG CCabinet::ReadDataBlocks(PCFFOLDER_NODE FolderNode)
 /*
  * FUNCTION: Reads all CFDATA blocks for a folder from the cabinet file
@@ -2343,6 +2878,8 @@ void CCabinet::DestroyFileNodes()
     PCFFILE_NODE PrevNode;
     PCFFILE_NODE NextNode;
 
+    DestroyFileIndex();
+
     NextNode = FileListHead;
     while (NextNode != NULL)
     {
@@ -2365,6 +2902,8 @@ void CCabinet::DestroyDeletedFileNodes()
     PCFFILE_NODE CurNode;
     PCFFILE_NODE NextNode;
 
+    DestroyFileIndex();
+
     CurNode = FileListHead;
     while (CurNode != NULL)
     {
@@ -2984,6 +3523,15 @@ ULONG CCabinet::WriteDataBlock()
     ULONG BytesWritten;
     PCFDATA_NODE DataNode;
 
+    /* Blocks are only split when the disk size is limited, and that
+       needs the compressed size of every block before it */
+    if (CompressQueue && (MaxDiskSize == 0) && !BlockIsSplit)
+        return QueueDataBlock();
+
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     if (!BlockIsSplit)
     {
         Status = Codec->Compress(OutputBuffer,
@@ -2996,6 +3544,9 @@ ULONG CCabinet::WriteDataBlock()
 
         CurrentOBuffer     = OutputBuffer;
         CurrentOBufferSize = TotalCompSize;
+
+        UncompressedBytes += CurrentIBufferSize;
+        CompressedBytes   += TotalCompSize;
     }
 
     DataNode = NewDataNode(CurrentFolderNode);
@@ -3060,6 +3611,135 @@ ULONG CCabinet::WriteDataBlock()
     return CAB_STATUS_SUCCESS;
 }
 
+
+ULONG CCabinet::QueueDataBlock()
+/*
+ * FUNCTION: Hands the current data block to the compression threads
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     The data block node is created right away so the folder keeps the
+ *     blocks in order, its compressed size is filled in when it is retired
+ */
+{
+    PCFDATA_NODE DataNode;
+    PCFDATA_JOB Job;
+    ULONG Status;
+
+    if (CompressQueue->IsFull())
+    {
+        Status = RetireDataBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    DataNode = NewDataNode(CurrentFolderNode);
+    if (!DataNode)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    DataNode->Data.Checksum   = 0;
+    DataNode->Data.UncompSize = (USHORT)CurrentIBufferSize;
+
+    Job = CompressQueue->GetFreeJob();
+    Job->DataNode    = DataNode;
+    Job->FolderNode  = CurrentFolderNode;
+    Job->InputLength = CurrentIBufferSize;
+    memcpy(Job->InputBuffer, InputBuffer, CurrentIBufferSize);
+    CompressQueue->Submit();
+
+    DiskSize += sizeof(CFDATA);
+
+    CurrentFolderNode->Folder.DataBlockCount++;
+
+    LastBlockStart += CurrentIBufferSize;
+
+    CurrentIBufferSize = 0;
+    CurrentIBuffer     = InputBuffer;
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::RetireDataBlock()
+/*
+ * FUNCTION: Writes the oldest queued data block to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PCFDATA_NODE DataNode;
+    PCFDATA_JOB Job;
+    ULONG BytesWritten;
+    ULONG Status;
+
+    Job = CompressQueue->WaitOldest();
+    if (!Job)
+        return CAB_STATUS_SUCCESS;
+
+    if (Job->Status != CS_SUCCESS)
+    {
+        DPRINT(MIN_TRACE, ("Cannot compress block (%u).\n", (UINT)Job->Status));
+        CompressQueue->Release();
+        if (Job->Status == CS_NOMEMORY)
+            return CAB_STATUS_NOMEMORY;
+        return CAB_STATUS_FAILURE;
+    }
+
+    DataNode = Job->DataNode;
+    DataNode->Data.CompSize = (USHORT)Job->OutputLength;
+    DataNode->ScratchFilePosition = ScratchFile->Position();
+
+    DPRINT(MAX_TRACE, ("Writing block. Checksum (0x%X)  CompSize (%u)  UncompSize (%u).\n",
+        (UINT)DataNode->Data.Checksum,
+        DataNode->Data.CompSize,
+        DataNode->Data.UncompSize));
+
+    Status = ScratchFile->WriteBlock(&DataNode->Data,
+        Job->OutputBuffer, &BytesWritten);
+    if (Status != CAB_STATUS_SUCCESS)
+    {
+        CompressQueue->Release();
+        return Status;
+    }
+
+    DiskSize += BytesWritten;
+
+    Job->FolderNode->TotalFolderSize += (BytesWritten + sizeof(CFDATA));
+
+    UncompressedBytes += Job->InputLength;
+    CompressedBytes   += Job->OutputLength;
+
+    CompressQueue->Release();
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::FlushDataBlocks()
+/*
+ * FUNCTION: Writes all queued data blocks to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+
+    if (!CompressQueue)
+        return CAB_STATUS_SUCCESS;
+
+    while (!CompressQueue->IsEmpty())
+    {
+        Status = RetireDataBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
 #if !defined(_WIN32)
 
 void CCabinet::ConvertDateAndTime(time_t* Time,
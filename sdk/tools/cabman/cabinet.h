@@ -25,6 +25,13 @@
 #include <string.h>
 #include <limits.h>
 
+#ifndef CAB_READ_ONLY
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
 #ifndef PATH_MAX
 #define PATH_MAX MAX_PATH
 #endif
@@ -101,6 +108,8 @@ extern ULONG DebugTraceLevel;
 #define CAB_SIGNATURE        0x4643534D // "MSCF"
 #define CAB_VERSION          0x0103
 #define CAB_BLOCKSIZE        32768
+#define CAB_MAX_COMPSIZE     (CAB_BLOCKSIZE + 6144) // LZX may grow a block this much
+#define CAB_MAX_THREADS      64
 
 #define CAB_COMP_MASK        0x00FF
 #define CAB_COMP_NONE        0x0000
@@ -224,6 +233,7 @@ typedef struct _CFFILE_NODE
     bool                Commit;         // true if the file data should be committed
     bool                Delete;         // true if marked for deletion
     PCFFOLDER_NODE      FolderNode;     // Folder this file belong to
+    struct _CFFILE_NODE *HashNext;      // Next file in the same file name hash bucket
 } CFFILE_NODE, *PCFFILE_NODE;
 
 typedef struct _SEARCH_CRITERIA
@@ -240,6 +250,13 @@ typedef struct _CAB_SEARCH
     char*             FileName;  // Current filename
 } CAB_SEARCH, *PCAB_SEARCH;
 
+typedef struct _CAB_EXTRACT
+{
+    PCFFILE_NODE      File;      // File to extract
+    FILE*             DestFile;  // Destination file, NULL if not created yet
+    bool              Done;      // true if all data has been written
+} CAB_EXTRACT, *PCAB_EXTRACT;
+
 
 /* Constants */
 
@@ -277,6 +294,10 @@ public:
                              void* InputBuffer,
                              ULONG InputLength,
                              PULONG OutputLength) = 0;
+    /* Starts a new folder, returns false if its compression type is not supported */
+    virtual bool Reset(USHORT CompressionType) { return true; };
+    /* Returns whether data blocks can be compressed independently of each other */
+    virtual bool IsStateless() { return true; };
 };
 
 
@@ -316,6 +337,48 @@ private:
     FILE* FileHandle;
 };
 
+typedef struct _CFDATA_JOB
+{
+    PCFDATA_NODE    DataNode;       // Data block waiting for its compressed data
+    PCFFOLDER_NODE  FolderNode;     // Folder the data block belongs to
+    void*           InputBuffer;
+    ULONG           InputLength;
+    void*           OutputBuffer;
+    ULONG           OutputLength;
+    ULONG           Status;         // Codec status
+    bool            Done;           // true if the worker is done with the block
+} CFDATA_JOB, *PCFDATA_JOB;
+
+class CCFDATAQueue
+{
+public:
+    /* Default constructor */
+    CCFDATAQueue();
+    /* Default destructor */
+    virtual ~CCFDATAQueue();
+    ULONG Create(LONG CodecId, ULONG ThreadCount);
+    void Destroy();
+    bool IsEmpty();
+    bool IsFull();
+    PCFDATA_JOB GetFreeJob();
+    void Submit();
+    PCFDATA_JOB WaitOldest();
+    void Release();
+private:
+    void Worker(CCABCodec* Codec);
+    std::vector<std::thread> Threads;
+    std::vector<CCABCodec*> Codecs;
+    std::mutex Lock;
+    std::condition_variable JobQueued;
+    std::condition_variable JobDone;
+    PCFDATA_JOB Jobs;
+    ULONG JobCount;
+    ULONG Oldest;                   // Sequence number of the oldest job
+    ULONG Queued;                   // Sequence number of the next job to queue
+    ULONG Dispatched;               // Sequence number of the next job for a worker
+    bool Stop;
+};
+
 #endif /* CAB_READ_ONLY */
 
 class CCabinet
@@ -359,8 +422,12 @@ public:
     ULONG FindNext(PCAB_SEARCH Search);
     /* Extracts a file from the current cabinet file */
     ULONG ExtractFile(char* FileName);
+    /* Extracts all files that match the search criteria in a single pass */
+    ULONG ExtractFiles();
     /* Select codec engine to use */
     void SelectCodec(LONG Id);
+    /* Creates a codec engine */
+    static CCABCodec* NewCodec(LONG Id);
     /* Returns whether a codec engine is selected */
     bool IsCodecSelected();
     /* Adds a search criteria for adding files to a simple cabinet, displaying files in a cabinet or extracting them */
@@ -395,6 +462,10 @@ public:
     ULONG AddFile(char* FileName);
     /* Sets the maximum size of the current disk */
     void SetMaxDiskSize(ULONG Size);
+    /* Sets the number of threads to compress data blocks on */
+    void SetThreadCount(ULONG Count);
+    /* Returns the number of bytes compressed so far and their compressed size */
+    void GetCompressionStatistics(ULONGLONG* Uncompressed, ULONGLONG* Compressed);
 #endif /* CAB_READ_ONLY */
 
     /* Default event handlers */
@@ -414,11 +485,18 @@ public:
     virtual bool OnDiskLabel(ULONG Number, char* Label);
 #endif /* CAB_READ_ONLY */
 private:
+    ULONG MapCabinet();
+    void UnmapCabinet();
+    bool MatchSearchCriteria(char* FileName);
+    ULONG CreateDestFile(PCFFILE_NODE File, char* FileName, FILE** DestFile);
+    ULONG ExtractFolder(PCFFOLDER_NODE FolderNode, PCAB_EXTRACT Files, ULONG Count);
     PCFFOLDER_NODE LocateFolderNode(ULONG Index);
     ULONG GetAbsoluteOffset(PCFFILE_NODE File);
     ULONG LocateFile(char* FileName, PCFFILE_NODE *File);
     ULONG ReadString(char* String, LONG MaxLength);
     ULONG ReadFileTable();
+    ULONG BuildFileIndex();
+    void DestroyFileIndex();
     ULONG ReadDataBlocks(PCFFOLDER_NODE FolderNode);
     PCFFOLDER_NODE NewFolderNode();
     PCFFILE_NODE NewFileNode();
@@ -438,6 +516,9 @@ private:
     ULONG WriteFileEntries();
     ULONG CommitDataBlocks(PCFFOLDER_NODE FolderNode);
     ULONG WriteDataBlock();
+    ULONG QueueDataBlock();
+    ULONG RetireDataBlock();
+    ULONG FlushDataBlocks();
     ULONG GetAttributesOnFile(PCFFILE_NODE File);
     ULONG SetAttributesOnFile(char* FileName, USHORT FileAttributes);
     ULONG GetFileTimes(FILE* FileHandle, PCFFILE_NODE File);
@@ -464,6 +545,8 @@ private:
     ULONG CabinetReservedFileSize;
     FILE* FileHandle;
     bool FileOpen;
+    PUCHAR CabinetView;         // Cabinet file mapped into memory, NULL if not mapped
+    ULONG CabinetViewSize;
     CFHEADER CABHeader;
     ULONG CabinetReserved;
     ULONG FolderReserved;
@@ -474,6 +557,8 @@ private:
     PCFDATA_NODE CurrentDataNode;
     PCFFILE_NODE FileListHead;
     PCFFILE_NODE FileListTail;
+    PCFFILE_NODE* FileHashTable;        // File nodes hashed by name, built by ReadFileTable
+    ULONG FileHashMask;
     PSEARCH_CRITERIA CriteriaListHead;
     PSEARCH_CRITERIA CriteriaListTail;
     CCABCodec *Codec;
@@ -503,6 +588,10 @@ private:
     ULONG TotalBytesLeft;
     bool BlockIsSplit;                  // true if current data block is split
     ULONG NextFolderNumber;     // Zero based folder number
+    CCFDATAQueue *CompressQueue;        // Data blocks being compressed by worker threads
+    ULONG ThreadCount;
+    ULONGLONG UncompressedBytes;
+    ULONGLONG CompressedBytes;
 #endif /* CAB_READ_ONLY */
 };
 
@@ -0,0 +1,1426 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CAB codec for LZX compressed data
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ * NOTES:       Every CFDATA block is one 32K frame. The compressor writes
+ *              each frame as a single verbatim block (or an uncompressed one
+ *              if that is smaller), so the frame can be aligned to 16 bits
+ *              at the end as the decoders expect. Matches, repeated offsets and
+ *              the delta coded tree lengths carry over from frame to frame,
+ *              so the blocks of a folder have to be processed in order.
+ *              The decompressor takes all block types, any window size
+ *              and blocks spanning frames.
+ */
+#include <stdio.h>
+#include "lzx.h"
+
+static const UCHAR LZXExtraBits[LZX_POSITION_SLOTS] =
+{
+     0,  0,  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,
+     7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14,
+    15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17
+};
+
+/* Number of position slots for window sizes from 2^15 up */
+static const UCHAR LZXWindowSlots[LZX_WINDOW_BITS - LZX_MIN_WINDOW_BITS + 1] =
+{
+    30, 32, 34, 36, 38, 42, 50
+};
+
+static const ULONG LZXPositionBase[LZX_POSITION_SLOTS] =
+{
+          0,       1,       2,       3,       4,       6,       8,      12,
+         16,      24,      32,      48,      64,      96,     128,     192,
+        256,     384,     512,     768,    1024,    1536,    2048,    3072,
+       4096,    6144,    8192,   12288,   16384,   24576,   32768,   49152,
+      65536,   98304,  131072,  196608,  262144,  393216,  524288,  655360,
+     786432,  917504, 1048576, 1179648, 1310720, 1441792, 1572864, 1703936,
+    1835008, 1966080
+};
+
+
+/* Huffman trees */
+
+static int LZXCompareLeaves(const void* Leaf1, const void* Leaf2)
+{
+    ULONGLONG Key1 = *(const ULONGLONG*)Leaf1;
+    ULONGLONG Key2 = *(const ULONGLONG*)Leaf2;
+
+    return (Key1 < Key2) ? -1 : (Key1 > Key2);
+}
+
+
+static void LZXEnsureTwoSymbols(PULONG Freq, ULONG Count)
+/*
+ * FUNCTION: Makes sure a tree has at least two symbols
+ * ARGUMENTS:
+ *     Freq  = Pointer to symbol frequencies
+ *     Count = Number of symbols in the tree
+ * NOTES:
+ *     Decoders only accept complete trees, and a single
+ *     symbol can't make one
+ */
+{
+    ULONG Used = 0;
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Freq[i] != 0)
+            Used++;
+    }
+
+    for (i = 0; (Used < 2) && (i < Count); i++)
+    {
+        if (Freq[i] == 0)
+        {
+            Freq[i] = 1;
+            Used++;
+        }
+    }
+}
+
+
+static void LZXBuildLengths(PULONG Freq, ULONG Count, ULONG MaxLength, PUCHAR Lengths)
+/*
+ * FUNCTION: Computes length limited Huffman code lengths
+ * ARGUMENTS:
+ *     Freq      = Pointer to symbol frequencies
+ *     Count     = Number of symbols in the tree
+ *     MaxLength = Longest code allowed
+ *     Lengths   = Address of buffer to place the code lengths
+ * NOTES:
+ *     Frequencies are flattened until the tree is shallow enough
+ */
+{
+    ULONGLONG Leaves[LZX_MAIN_ELEMENTS];
+    ULONG Scaled[LZX_MAIN_ELEMENTS];
+    ULONG Weight[2 * LZX_MAIN_ELEMENTS];
+    ULONG Parent[2 * LZX_MAIN_ELEMENTS];
+    ULONG Depth[2 * LZX_MAIN_ELEMENTS];
+    ULONG LeafCount, NodeCount, NextLeaf, NextNode;
+    ULONG Child[2];
+    ULONG MaxDepth;
+    ULONG i, j;
+
+    memcpy(Scaled, Freq, Count * sizeof(ULONG));
+
+    for (;;)
+    {
+        LeafCount = 0;
+        for (i = 0; i < Count; i++)
+        {
+            Lengths[i] = 0;
+            if (Scaled[i] != 0)
+                Leaves[LeafCount++] = ((ULONGLONG)Scaled[i] << 16) | i;
+        }
+
+        if (LeafCount < 2)
+        {
+            if (LeafCount == 1)
+                Lengths[Leaves[0] & 0xFFFF] = 1;
+            return;
+        }
+
+        /* Leaves are sorted by weight, internal nodes are created in
+           order of weight too, so the two lightest are always at the
+           head of either list */
+        qsort(Leaves, LeafCount, sizeof(ULONGLONG), LZXCompareLeaves);
+        for (i = 0; i < LeafCount; i++)
+            Weight[i] = (ULONG)(Leaves[i] >> 16);
+
+        NextLeaf  = 0;
+        NextNode  = LeafCount;
+        NodeCount = LeafCount;
+        while (NodeCount < 2 * LeafCount - 1)
+        {
+            for (j = 0; j < 2; j++)
+            {
+                if ((NextLeaf < LeafCount) &&
+                    ((NextNode >= NodeCount) || (Weight[NextLeaf] <= Weight[NextNode])))
+                    Child[j] = NextLeaf++;
+                else
+                    Child[j] = NextNode++;
+            }
+
+            Weight[NodeCount] = Weight[Child[0]] + Weight[Child[1]];
+            Parent[Child[0]] = NodeCount;
+            Parent[Child[1]] = NodeCount;
+            NodeCount++;
+        }
+
+        /* Parents always come after their children */
+        MaxDepth = 0;
+        Depth[NodeCount - 1] = 0;
+        for (i = NodeCount - 1; i-- > 0;)
+        {
+            Depth[i] = Depth[Parent[i]] + 1;
+            if (Depth[i] > MaxDepth)
+                MaxDepth = Depth[i];
+        }
+
+        if (MaxDepth <= MaxLength)
+        {
+            for (i = 0; i < LeafCount; i++)
+                Lengths[Leaves[i] & 0xFFFF] = (UCHAR)Depth[i];
+            return;
+        }
+
+        for (i = 0; i < Count; i++)
+        {
+            if (Scaled[i] != 0)
+                Scaled[i] = (Scaled[i] >> 1) | 1;
+        }
+    }
+}
+
+
+static void LZXBuildCodes(PUCHAR Lengths, ULONG Count, PUSHORT Codes)
+/*
+ * FUNCTION: Assigns canonical Huffman codes
+ * ARGUMENTS:
+ *     Lengths = Pointer to code lengths
+ *     Count   = Number of symbols in the tree
+ *     Codes   = Address of buffer to place the codes
+ */
+{
+    ULONG LengthCount[17];
+    ULONG NextCode[17];
+    ULONG Code = 0;
+    ULONG i;
+
+    memset(LengthCount, 0, sizeof(LengthCount));
+    for (i = 0; i < Count; i++)
+        LengthCount[Lengths[i]]++;
+    LengthCount[0] = 0;
+
+    for (i = 1; i <= 16; i++)
+    {
+        Code = (Code + LengthCount[i - 1]) << 1;
+        NextCode[i] = Code;
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Lengths[i] != 0)
+            Codes[i] = (USHORT)NextCode[Lengths[i]]++;
+    }
+}
+
+
+static ULONG LZXReadUlong(PUCHAR Data)
+/*
+ * FUNCTION: Reads a little endian 32 bit value
+ * ARGUMENTS:
+ *     Data = Pointer to value
+ */
+{
+    return Data[0] | (Data[1] << 8) | (Data[2] << 16) | ((ULONG)Data[3] << 24);
+}
+
+
+static bool LZXBuildTree(PLZX_DECODE_TREE Tree, PUCHAR Lengths, ULONG Count)
+/*
+ * FUNCTION: Prepares a tree for decoding
+ * ARGUMENTS:
+ *     Tree    = Address of buffer to place the decoding tables
+ *     Lengths = Pointer to code lengths
+ *     Count   = Number of symbols in the tree
+ * RETURNS:
+ *     false if there are more codes than fit in 16 bits
+ * NOTES:
+ *     Incomplete trees are accepted, the unused codes fail to decode
+ */
+{
+    USHORT Offsets[17];
+    LONG Left = 1;
+    ULONG Code = 0;
+    ULONG Index = 0;
+    ULONG Fill, Length, i, j;
+
+    memset(Tree->Count, 0, sizeof(Tree->Count));
+    for (i = 0; i < Count; i++)
+        Tree->Count[Lengths[i]]++;
+    Tree->Count[0] = 0;
+
+    for (Length = 1; Length <= 16; Length++)
+    {
+        Left = (Left << 1) - Tree->Count[Length];
+        if (Left < 0)
+            return false;
+    }
+
+    Offsets[1] = 0;
+    for (Length = 1; Length < 16; Length++)
+        Offsets[Length + 1] = Offsets[Length] + Tree->Count[Length];
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Lengths[i] != 0)
+            Tree->Symbols[Offsets[Lengths[i]]++] = (USHORT)i;
+    }
+
+    /* Short codes take all table entries starting with them */
+    memset(Tree->Table, 0, sizeof(Tree->Table));
+    for (Length = 1; Length <= LZX_TABLE_BITS; Length++)
+    {
+        Fill = 1 << (LZX_TABLE_BITS - Length);
+        for (i = 0; i < Tree->Count[Length]; i++, Code++, Index++)
+        {
+            for (j = 0; j < Fill; j++)
+                Tree->Table[(Code << (LZX_TABLE_BITS - Length)) + j] = (USHORT)((Tree->Symbols[Index] << 4) | Length);
+        }
+        Code <<= 1;
+    }
+
+    return true;
+}
+
+
+/* CLZXCodec */
+
+CLZXCodec::CLZXCodec()
+/*
+ * FUNCTION: Default constructor
+ */
+{
+    Window      = (PUCHAR)malloc(LZX_HISTORY_SIZE);
+    HashHead    = (PULONG)malloc(LZX_HASH_SIZE * sizeof(ULONG));
+    HashPrev    = (PULONG)malloc(LZX_WINDOW_SIZE * sizeof(ULONG));
+    Items       = (PLZX_ITEM)malloc(CAB_BLOCKSIZE * sizeof(LZX_ITEM));
+    FrameBuffer = (PUCHAR)malloc(LZX_FRAME_BUFFER_SIZE);
+
+    Reset(CAB_COMP_LZX | (LZX_WINDOW_BITS << 8));
+}
+
+
+CLZXCodec::~CLZXCodec()
+/*
+ * FUNCTION: Default destructor
+ */
+{
+    free(Window);
+    free(HashHead);
+    free(HashPrev);
+    free(Items);
+    free(FrameBuffer);
+}
+
+
+bool CLZXCodec::Reset(USHORT CompressionType)
+/*
+ * FUNCTION: Resets the history and trees at the start of a folder
+ * ARGUMENTS:
+ *     CompressionType = Compression type of the folder
+ * RETURNS:
+ *     Whether the window size of the folder is supported
+ */
+{
+    ULONG WindowBits = (CompressionType >> 8) & 0x1F;
+    ULONG i;
+
+    WindowBase     = 0;
+    WindowEnd      = 0;
+    HashPosition   = 0;
+    R0 = R1 = R2   = 1;
+    HeaderDone     = false;
+    E8Size         = 0;
+    FrameCount     = 0;
+    BlockType      = 0;
+    BlockLength    = 0;
+    BlockRemaining = 0;
+
+    /* The history always holds the largest window, smaller ones only
+       change the number of position slots */
+    MainElements = 0;
+    if ((WindowBits >= LZX_MIN_WINDOW_BITS) && (WindowBits <= LZX_WINDOW_BITS))
+        MainElements = LZX_NUM_CHARS + LZXWindowSlots[WindowBits - LZX_MIN_WINDOW_BITS] * 8;
+
+    memset(PrevMainLengths, 0, sizeof(PrevMainLengths));
+    memset(PrevLengthLengths, 0, sizeof(PrevLengthLengths));
+
+    if (HashHead)
+    {
+        for (i = 0; i < LZX_HASH_SIZE; i++)
+            HashHead[i] = LZX_NIL;
+    }
+
+    return (MainElements != 0);
+}
+
+
+void CLZXCodec::SlideWindow(ULONG Length)
+/*
+ * FUNCTION: Makes room for a frame at the end of the history
+ * ARGUMENTS:
+ *     Length = Length of frame
+ * NOTES:
+ *     The oldest data is dropped when the buffer is full, keeping
+ *     a whole window in front of the new frame
+ */
+{
+    ULONG Used = WindowEnd - WindowBase;
+    ULONG Shift;
+
+    if (Used + Length > LZX_HISTORY_SIZE)
+    {
+        Shift = Used - LZX_WINDOW_SIZE;
+        memmove(Window, Window + Shift, LZX_WINDOW_SIZE);
+        WindowBase += Shift;
+    }
+}
+
+
+void CLZXCodec::AppendWindow(PUCHAR Data, ULONG Length)
+/*
+ * FUNCTION: Appends a frame to the history
+ * ARGUMENTS:
+ *     Data   = Pointer to frame data
+ *     Length = Length of frame
+ */
+{
+    SlideWindow(Length);
+    memcpy(Window + (WindowEnd - WindowBase), Data, Length);
+    WindowEnd += Length;
+}
+
+
+void CLZXCodec::InsertHashes(ULONG Position)
+/*
+ * FUNCTION: Inserts all positions before a folder offset in the hash chains
+ * ARGUMENTS:
+ *     Position = Folder offset to stop at
+ */
+{
+    PUCHAR Data;
+    ULONG Hash;
+
+    while ((HashPosition < Position) && (HashPosition + 3 <= WindowEnd))
+    {
+        Data = Window + (HashPosition - WindowBase);
+        Hash = ((Data[0] | (Data[1] << 8) | (Data[2] << 16)) * 2654435761U) >> (32 - LZX_HASH_BITS);
+
+        HashPrev[HashPosition & (LZX_WINDOW_SIZE - 1)] = HashHead[Hash];
+        HashHead[Hash] = HashPosition;
+        HashPosition++;
+    }
+}
+
+
+ULONG CLZXCodec::FindMatch(ULONG Position, ULONG End, ULONG PrevLength, PULONG Offset)
+/*
+ * FUNCTION: Finds the longest match at a folder offset
+ * ARGUMENTS:
+ *     Position   = Folder offset to match
+ *     End        = Folder offset of the end of the frame
+ *     PrevLength = Length the match has to beat
+ *     Offset     = Address of buffer to place match offset
+ * RETURNS:
+ *     Length of match, 0 if none longer than PrevLength was found
+ */
+{
+    ULONG Repeated[3] = { R0, R1, R2 };
+    PUCHAR Current;
+    PUCHAR Match;
+    ULONG MaxLength;
+    ULONG MaxChain = LZX_MAX_CHAIN;
+    ULONG BestLength = PrevLength;
+    ULONG Candidate;
+    ULONG Distance;
+    ULONG Length;
+    ULONG Next;
+    ULONG Chain;
+    ULONG Hash;
+    ULONG i;
+
+    /* Matches can't cross the frame end */
+    MaxLength = End - Position;
+    if (MaxLength > LZX_MAX_MATCH)
+        MaxLength = LZX_MAX_MATCH;
+    if ((MaxLength < 3) || (MaxLength <= BestLength))
+        return 0;
+
+    Current = Window + (Position - WindowBase);
+
+    /* Repeated offsets are the cheapest to encode, so try them first */
+    for (i = 0; i < 3; i++)
+    {
+        if (Repeated[i] > Position)
+            continue;
+
+        Match = Current - Repeated[i];
+        for (Length = 0; (Length < MaxLength) && (Match[Length] == Current[Length]); Length++);
+
+        if ((Length >= 3) && (Length > BestLength))
+        {
+            BestLength = Length;
+            *Offset    = Repeated[i];
+        }
+    }
+
+    /* Don't spend much on beating a match that is good already */
+    if (BestLength >= LZX_GOOD_MATCH)
+        MaxChain /= 4;
+
+    Hash = ((Current[0] | (Current[1] << 8) | (Current[2] << 16)) * 2654435761U) >> (32 - LZX_HASH_BITS);
+    Candidate = HashHead[Hash];
+
+    for (Chain = 0; (Chain < MaxChain) && (Candidate != LZX_NIL); Chain++)
+    {
+        if ((BestLength == MaxLength) || (BestLength >= LZX_NICE_MATCH))
+            break;
+
+        Distance = Position - Candidate;
+        if (Distance > LZX_MAX_OFFSET)
+            break;
+
+        /* Check the bytes that would make it longer and the first ones,
+           which differ on hash collisions, before comparing it all */
+        Match = Window + (Candidate - WindowBase);
+        if ((Match[BestLength] == Current[BestLength]) &&
+            (Match[0] == Current[0]) && (Match[1] == Current[1]))
+        {
+            for (Length = 2; (Length < MaxLength) && (Match[Length] == Current[Length]); Length++);
+
+            if ((Length >= 3) && (Length > BestLength) &&
+                ((Length > 3) || (Distance <= LZX_FAR_MATCH)))
+            {
+                BestLength = Length;
+                *Offset    = Distance;
+
+                if ((BestLength >= LZX_GOOD_MATCH) && (MaxChain > Chain + LZX_MAX_CHAIN / 4))
+                    MaxChain = Chain + LZX_MAX_CHAIN / 4;
+            }
+        }
+
+        /* Slots are reused once the chain is a window old */
+        Next = HashPrev[Candidate & (LZX_WINDOW_SIZE - 1)];
+        if (Next >= Candidate)
+            break;
+        Candidate = Next;
+    }
+
+    return (BestLength > PrevLength) ? BestLength : 0;
+}
+
+
+void CLZXCodec::AddLiteral(UCHAR Literal)
+/*
+ * FUNCTION: Adds a literal to the current frame
+ * ARGUMENTS:
+ *     Literal = Byte to add
+ */
+{
+    Items[ItemCount].MainElement = Literal;
+    Items[ItemCount].ExtraBits   = 0;
+    ItemCount++;
+
+    MainFreq[Literal]++;
+}
+
+
+void CLZXCodec::AddMatch(ULONG Length, ULONG Offset)
+/*
+ * FUNCTION: Adds a match to the current frame
+ * ARGUMENTS:
+ *     Length = Length of match
+ *     Offset = Distance to the matched data
+ */
+{
+    PLZX_ITEM Item = &Items[ItemCount++];
+    ULONG Formatted;
+    ULONG Header;
+    ULONG Slot;
+    ULONG Low, High, Middle;
+
+    Item->ExtraBits    = 0;
+    Item->VerbatimBits = 0;
+
+    /* Keep the repeated offsets the way the decoder does */
+    if (Offset == R0)
+    {
+        Slot = 0;
+    }
+    else if (Offset == R1)
+    {
+        Slot = 1;
+        R1 = R0;
+        R0 = Offset;
+    }
+    else if (Offset == R2)
+    {
+        Slot = 2;
+        R2 = R0;
+        R0 = Offset;
+    }
+    else
+    {
+        /* Find the last slot whose base fits, offsets 1 and up go in slot 3 and up */
+        Formatted = Offset + 2;
+        Low  = 3;
+        High = LZX_POSITION_SLOTS - 1;
+        while (Low < High)
+        {
+            Middle = (Low + High + 1) / 2;
+            if (LZXPositionBase[Middle] <= Formatted)
+                Low = Middle;
+            else
+                High = Middle - 1;
+        }
+        Slot = Low;
+
+        Item->ExtraBits    = LZXExtraBits[Slot];
+        Item->VerbatimBits = Formatted - LZXPositionBase[Slot];
+
+        R2 = R1;
+        R1 = R0;
+        R0 = Offset;
+    }
+
+    Header = Length - LZX_MIN_MATCH;
+    if (Header >= 7)
+    {
+        Item->LengthFooter = (USHORT)(Header - 7);
+        LengthFreq[Header - 7]++;
+        Header = 7;
+    }
+
+    Item->MainElement = (USHORT)(LZX_NUM_CHARS + ((Slot << 3) | Header));
+    MainFreq[Item->MainElement]++;
+}
+
+
+void CLZXCodec::Parse(ULONG Start, ULONG Length)
+/*
+ * FUNCTION: Turns a frame into literals and matches
+ * ARGUMENTS:
+ *     Start  = Folder offset of the frame
+ *     Length = Length of frame
+ * NOTES:
+ *     A match is deferred by one byte when the next one is longer.
+ *     Positions are skipped faster the longer no match turns up,
+ *     so incompressible data doesn't walk the hash chains at every byte
+ */
+{
+    ULONG Position = Start;
+    ULONG End = Start + Length;
+    ULONG MatchLength = 0, MatchOffset = 0;
+    ULONG NextLength, NextOffset = 0;
+    ULONG Misses = 0;
+    ULONG Skip;
+    bool Pending = false;
+
+    ItemCount = 0;
+    memset(MainFreq, 0, sizeof(MainFreq));
+    memset(LengthFreq, 0, sizeof(LengthFreq));
+
+    while (Position < End)
+    {
+        if (!Pending)
+        {
+            InsertHashes(Position);
+            MatchLength = FindMatch(Position, End, 0, &MatchOffset);
+        }
+        Pending = false;
+
+        if (MatchLength == 0)
+        {
+            Skip = 1 + (++Misses >> LZX_SKIP_SHIFT);
+            for (; (Skip > 0) && (Position < End); Skip--, Position++)
+                AddLiteral(Window[Position - WindowBase]);
+            continue;
+        }
+        Misses = 0;
+
+        if ((MatchLength < LZX_MAX_LAZY) && (Position + 1 < End))
+        {
+            InsertHashes(Position + 1);
+            NextLength = FindMatch(Position + 1, End, MatchLength, &NextOffset);
+            if (NextLength != 0)
+            {
+                AddLiteral(Window[Position - WindowBase]);
+                Position++;
+
+                MatchLength = NextLength;
+                MatchOffset = NextOffset;
+                Pending = true;
+                continue;
+            }
+        }
+
+        AddMatch(MatchLength, MatchOffset);
+        Position += MatchLength;
+    }
+}
+
+
+void CLZXCodec::StartBits(PUCHAR Buffer)
+/*
+ * FUNCTION: Starts writing a bit stream
+ * ARGUMENTS:
+ *     Buffer = Pointer to buffer to place the bit stream
+ */
+{
+    OutputStart    = Buffer;
+    OutputPosition = Buffer;
+    BitBuffer      = 0;
+    BitCount       = 0;
+}
+
+
+void CLZXCodec::PutBits(ULONG Value, ULONG Count)
+/*
+ * FUNCTION: Writes bits to the bit stream
+ * ARGUMENTS:
+ *     Value = Bits to write
+ *     Count = Number of bits to write (at most 17)
+ * NOTES:
+ *     Bits are packed MSB first into little endian 16 bit words
+ */
+{
+    USHORT Word;
+
+    if (Count > 16)
+    {
+        PutBits(Value >> 16, Count - 16);
+        Value &= 0xFFFF;
+        Count  = 16;
+    }
+
+    BitBuffer = (BitBuffer << Count) | (Value & ((1 << Count) - 1));
+    BitCount += Count;
+
+    while (BitCount >= 16)
+    {
+        BitCount -= 16;
+        Word = (USHORT)(BitBuffer >> BitCount);
+        *OutputPosition++ = (UCHAR)Word;
+        *OutputPosition++ = (UCHAR)(Word >> 8);
+    }
+}
+
+
+ULONG CLZXCodec::FlushBits()
+/*
+ * FUNCTION: Pads the bit stream to a 16 bit boundary
+ * RETURNS:
+ *     Number of bytes written
+ */
+{
+    if (BitCount > 0)
+        PutBits(0, 16 - BitCount);
+
+    return (ULONG)(OutputPosition - OutputStart);
+}
+
+
+void CLZXCodec::WriteLengths(PUCHAR Lengths, PUCHAR PrevLengths, ULONG First, ULONG Last)
+/*
+ * FUNCTION: Writes part of a tree through a pretree
+ * ARGUMENTS:
+ *     Lengths     = Pointer to code lengths of the tree
+ *     PrevLengths = Pointer to code lengths of the tree in the previous block
+ *     First       = First element to write
+ *     Last        = Element to stop at
+ */
+{
+    UCHAR Symbols[LZX_MAIN_ELEMENTS];
+    UCHAR Extra[LZX_MAIN_ELEMENTS];
+    ULONG Freq[LZX_PRETREE_ELEMENTS];
+    UCHAR PreLengths[LZX_PRETREE_ELEMENTS];
+    USHORT PreCodes[LZX_PRETREE_ELEMENTS];
+    ULONG SymbolCount = 0;
+    ULONG Run;
+    ULONG i;
+
+    memset(Freq, 0, sizeof(Freq));
+
+    for (i = First; i < Last;)
+    {
+        if (Lengths[i] == 0)
+        {
+            for (Run = 1; (i + Run < Last) && (Lengths[i + Run] == 0) && (Run < 51); Run++);
+
+            if (Run >= 20)
+            {
+                Symbols[SymbolCount] = 18;
+                Extra[SymbolCount++] = (UCHAR)(Run - 20);
+                Freq[18]++;
+                i += Run;
+                continue;
+            }
+
+            if (Run >= 4)
+            {
+                Symbols[SymbolCount] = 17;
+                Extra[SymbolCount++] = (UCHAR)(Run - 4);
+                Freq[17]++;
+                i += Run;
+                continue;
+            }
+        }
+
+        /* The decoder subtracts the symbol from the old length, modulo 17 */
+        Symbols[SymbolCount] = (UCHAR)((PrevLengths[i] + 17 - Lengths[i]) % 17);
+        Freq[Symbols[SymbolCount++]]++;
+        i++;
+    }
+
+    LZXEnsureTwoSymbols(Freq, LZX_PRETREE_ELEMENTS);
+    LZXBuildLengths(Freq, LZX_PRETREE_ELEMENTS, 15, PreLengths);
+    LZXBuildCodes(PreLengths, LZX_PRETREE_ELEMENTS, PreCodes);
+
+    for (i = 0; i < LZX_PRETREE_ELEMENTS; i++)
+        PutBits(PreLengths[i], 4);
+
+    for (i = 0; i < SymbolCount; i++)
+    {
+        PutBits(PreCodes[Symbols[i]], PreLengths[Symbols[i]]);
+        if (Symbols[i] == 17)
+            PutBits(Extra[i], 4);
+        else if (Symbols[i] == 18)
+            PutBits(Extra[i], 5);
+    }
+}
+
+
+void CLZXCodec::WriteVerbatimBlock(ULONG Length)
+/*
+ * FUNCTION: Writes the current frame as a verbatim block
+ * ARGUMENTS:
+ *     Length = Uncompressed length of frame
+ */
+{
+    PLZX_ITEM Item;
+    ULONG i;
+
+    LZXEnsureTwoSymbols(MainFreq, LZX_MAIN_ELEMENTS);
+    LZXEnsureTwoSymbols(LengthFreq, LZX_LENGTH_ELEMENTS);
+
+    LZXBuildLengths(MainFreq, LZX_MAIN_ELEMENTS, 16, MainLengths);
+    LZXBuildCodes(MainLengths, LZX_MAIN_ELEMENTS, MainCodes);
+    LZXBuildLengths(LengthFreq, LZX_LENGTH_ELEMENTS, 16, LengthLengths);
+    LZXBuildCodes(LengthLengths, LZX_LENGTH_ELEMENTS, LengthCodes);
+
+    PutBits(LZX_BLOCKTYPE_VERBATIM, 3);
+    PutBits(Length >> 8, 16);
+    PutBits(Length & 0xFF, 8);
+
+    /* The main tree is sent in two parts, literals first */
+    WriteLengths(MainLengths, PrevMainLengths, 0, LZX_NUM_CHARS);
+    WriteLengths(MainLengths, PrevMainLengths, LZX_NUM_CHARS, LZX_MAIN_ELEMENTS);
+    WriteLengths(LengthLengths, PrevLengthLengths, 0, LZX_LENGTH_ELEMENTS);
+
+    for (i = 0; i < ItemCount; i++)
+    {
+        Item = &Items[i];
+
+        PutBits(MainCodes[Item->MainElement], MainLengths[Item->MainElement]);
+        if (Item->MainElement < LZX_NUM_CHARS)
+            continue;
+
+        if ((Item->MainElement & 7) == 7)
+            PutBits(LengthCodes[Item->LengthFooter], LengthLengths[Item->LengthFooter]);
+
+        PutBits(Item->VerbatimBits, Item->ExtraBits);
+    }
+}
+
+
+void CLZXCodec::WriteUncompressedBlock(PUCHAR Data, ULONG Length)
+/*
+ * FUNCTION: Writes the current frame as an uncompressed block
+ * ARGUMENTS:
+ *     Data   = Pointer to frame data
+ *     Length = Length of frame
+ */
+{
+    ULONG Repeated[3] = { R0, R1, R2 };
+    ULONG i;
+
+    PutBits(LZX_BLOCKTYPE_UNCOMPRESSED, 3);
+    PutBits(Length >> 8, 16);
+    PutBits(Length & 0xFF, 8);
+
+    /* The decoder skips 1 to 16 bits to get to a word boundary */
+    PutBits(0, 16 - BitCount);
+
+    for (i = 0; i < 3; i++)
+    {
+        *OutputPosition++ = (UCHAR)Repeated[i];
+        *OutputPosition++ = (UCHAR)(Repeated[i] >> 8);
+        *OutputPosition++ = (UCHAR)(Repeated[i] >> 16);
+        *OutputPosition++ = (UCHAR)(Repeated[i] >> 24);
+    }
+
+    memcpy(OutputPosition, Data, Length);
+    OutputPosition += Length;
+
+    /* Odd blocks are padded to a word */
+    if (Length & 1)
+        *OutputPosition++ = 0;
+}
+
+
+ULONG CLZXCodec::Compress(void* OutputBuffer,
+                          void* InputBuffer,
+                          ULONG InputLength,
+                          PULONG OutputLength)
+/*
+ * FUNCTION: Compresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer   = Pointer to buffer to place compressed data
+ *     InputBuffer    = Pointer to buffer with data to be compressed
+ *     InputLength    = Length of input buffer
+ *     OutputLength   = Address of buffer to place size of compressed data
+ * NOTES:
+ *     OutputBuffer must have room for InputLength + 17 bytes
+ */
+{
+    ULONG Start = WindowEnd;
+    ULONG SavedR0 = R0, SavedR1 = R1, SavedR2 = R2;
+    ULONG VerbatimLength;
+    bool FirstFrame;
+
+    DPRINT(MAX_TRACE, ("InputLength (%u).\n", (UINT)InputLength));
+
+    if (!Window || !HashHead || !HashPrev || !Items || !FrameBuffer)
+        return CS_NOMEMORY;
+
+    if (InputLength > CAB_BLOCKSIZE)
+        return CS_BADSTREAM;
+
+    AppendWindow((PUCHAR)InputBuffer, InputLength);
+    Parse(Start, InputLength);
+
+    /* The stream header says there is no E8 call translation */
+    FirstFrame = !HeaderDone;
+    HeaderDone = true;
+
+    StartBits(FrameBuffer);
+    if (FirstFrame)
+        PutBits(0, 1);
+    WriteVerbatimBlock(InputLength);
+    VerbatimLength = FlushBits();
+
+    if (VerbatimLength <= InputLength + (InputLength & 1) + 16)
+    {
+        memcpy(OutputBuffer, FrameBuffer, VerbatimLength);
+        *OutputLength = VerbatimLength;
+
+        memcpy(PrevMainLengths, MainLengths, sizeof(MainLengths));
+        memcpy(PrevLengthLengths, LengthLengths, sizeof(LengthLengths));
+        return CS_SUCCESS;
+    }
+
+    /* Incompressible data, the decoder never sees the trees or the matches */
+    R0 = SavedR0;
+    R1 = SavedR1;
+    R2 = SavedR2;
+
+    StartBits((PUCHAR)OutputBuffer);
+    if (FirstFrame)
+        PutBits(0, 1);
+    WriteUncompressedBlock((PUCHAR)InputBuffer, InputLength);
+    *OutputLength = (ULONG)(OutputPosition - OutputStart);
+
+    return CS_SUCCESS;
+}
+
+
+void CLZXCodec::StartInput(PUCHAR Buffer, ULONG Length)
+/*
+ * FUNCTION: Starts reading a bit stream
+ * ARGUMENTS:
+ *     Buffer = Pointer to bit stream
+ *     Length = Length of bit stream
+ */
+{
+    InputStart    = Buffer;
+    InputPosition = 0;
+    InputLength   = Length;
+    BitBuffer     = 0;
+    BitCount      = 0;
+}
+
+
+void CLZXCodec::FillBits(ULONG Count)
+/*
+ * FUNCTION: Makes sure there are enough bits to read
+ * ARGUMENTS:
+ *     Count = Number of bits needed (at most 17)
+ * NOTES:
+ *     Zeroes are read past the end of the input, the
+ *     caller checks for an overrun when the frame is done
+ */
+{
+    ULONG Word = 0;
+
+    while (BitCount < Count)
+    {
+        if (InputPosition + 2 <= InputLength)
+            Word = InputStart[InputPosition] | (InputStart[InputPosition + 1] << 8);
+        else
+            Word = 0;
+        InputPosition += 2;
+
+        BitBuffer |= Word << (16 - BitCount);
+        BitCount  += 16;
+    }
+}
+
+
+ULONG CLZXCodec::GetBits(ULONG Count)
+/*
+ * FUNCTION: Reads bits from the bit stream
+ * ARGUMENTS:
+ *     Count = Number of bits to read (at most 17)
+ * RETURNS:
+ *     Bits read
+ */
+{
+    ULONG Value;
+
+    if (Count == 0)
+        return 0;
+
+    if (Count > 16)
+    {
+        Value = GetBits(Count - 16) << 16;
+        return Value | GetBits(16);
+    }
+
+    FillBits(Count);
+    Value = BitBuffer >> (32 - Count);
+    BitBuffer <<= Count;
+    BitCount  -= Count;
+
+    return Value;
+}
+
+
+ULONG CLZXCodec::BitsLeft()
+/*
+ * FUNCTION: Returns the number of bits left in the input
+ * RETURNS:
+ *     Number of bits left, 0 if more than the input was read
+ */
+{
+    ULONGLONG Used = (ULONGLONG)InputPosition * 8 - BitCount;
+
+    if (Used > (ULONGLONG)InputLength * 8)
+        return 0;
+
+    return (ULONG)((ULONGLONG)InputLength * 8 - Used);
+}
+
+
+void CLZXCodec::AlignInput()
+/*
+ * FUNCTION: Skips the padding in front of an uncompressed block
+ * NOTES:
+ *     There are 1 to 16 bits up to the next word, the words
+ *     read ahead are given back so bytes can be read directly
+ */
+{
+    ULONG Padding = BitCount & 15;
+
+    if (Padding == 0)
+    {
+        FillBits(16);
+        Padding = 16;
+    }
+
+    BitCount      -= Padding;
+    InputPosition -= BitCount / 8;
+    BitBuffer      = 0;
+    BitCount       = 0;
+}
+
+
+ULONG CLZXCodec::DecodeSymbol(PLZX_DECODE_TREE Tree)
+/*
+ * FUNCTION: Reads a Huffman coded symbol
+ * ARGUMENTS:
+ *     Tree = Pointer to tree to decode with
+ * RETURNS:
+ *     Symbol read, LZX_NIL if the code is not part of the tree
+ */
+{
+    ULONG Bits;
+    ULONG Entry;
+    LONG Code = 0;
+    LONG First = 0;
+    ULONG Index = 0;
+    ULONG Length;
+
+    FillBits(16);
+    Bits  = BitBuffer >> 16;
+    Entry = Tree->Table[Bits >> (16 - LZX_TABLE_BITS)];
+    if (Entry != 0)
+    {
+        BitBuffer <<= (Entry & 15);
+        BitCount  -= (Entry & 15);
+        return Entry >> 4;
+    }
+
+    /* Longer codes, walk the canonical code one bit at a time */
+    for (Length = 1; Length <= 16; Length++)
+    {
+        Code |= (Bits >> (16 - Length)) & 1;
+        if (Code - First < (LONG)Tree->Count[Length])
+        {
+            BitBuffer <<= Length;
+            BitCount  -= Length;
+            return Tree->Symbols[Index + Code - First];
+        }
+
+        Index += Tree->Count[Length];
+        First  = (First + Tree->Count[Length]) << 1;
+        Code <<= 1;
+    }
+
+    return LZX_NIL;
+}
+
+
+bool CLZXCodec::ReadLengths(PUCHAR Lengths, PUCHAR PrevLengths, ULONG First, ULONG Last)
+/*
+ * FUNCTION: Reads part of a tree through a pretree
+ * ARGUMENTS:
+ *     Lengths     = Address of buffer to place the code lengths of the tree
+ *     PrevLengths = Pointer to code lengths of the tree in the previous block
+ *     First       = First element to read
+ *     Last        = Element to stop at
+ * RETURNS:
+ *     false if the pretree or its symbols are invalid
+ */
+{
+    UCHAR PreLengths[LZX_PRETREE_ELEMENTS];
+    ULONG Symbol;
+    ULONG Value;
+    ULONG Run;
+    ULONG i;
+
+    for (i = 0; i < LZX_PRETREE_ELEMENTS; i++)
+        PreLengths[i] = (UCHAR)GetBits(4);
+
+    if (!LZXBuildTree(&PreTree, PreLengths, LZX_PRETREE_ELEMENTS))
+        return false;
+
+    for (i = First; i < Last;)
+    {
+        Symbol = DecodeSymbol(&PreTree);
+        if (Symbol == 17)
+        {
+            Run   = 4 + GetBits(4);
+            Value = 0;
+        }
+        else if (Symbol == 18)
+        {
+            Run   = 20 + GetBits(5);
+            Value = 0;
+        }
+        else if (Symbol == 19)
+        {
+            Run    = 4 + GetBits(1);
+            Symbol = DecodeSymbol(&PreTree);
+            if (Symbol > 16)
+                return false;
+            Value  = (PrevLengths[i] + 17 - Symbol) % 17;
+        }
+        else if (Symbol <= 16)
+        {
+            Run   = 1;
+            Value = (PrevLengths[i] + 17 - Symbol) % 17;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (Run > Last - i)
+            return false;
+
+        while (Run-- > 0)
+            Lengths[i++] = (UCHAR)Value;
+    }
+
+    return true;
+}
+
+
+bool CLZXCodec::ReadTrees()
+/*
+ * FUNCTION: Reads the main and length trees of a block
+ * RETURNS:
+ *     false if the trees are invalid
+ */
+{
+    if (!ReadLengths(MainLengths, PrevMainLengths, 0, LZX_NUM_CHARS) ||
+        !ReadLengths(MainLengths, PrevMainLengths, LZX_NUM_CHARS, MainElements) ||
+        !ReadLengths(LengthLengths, PrevLengthLengths, 0, LZX_LENGTH_ELEMENTS))
+    {
+        return false;
+    }
+
+    memcpy(PrevMainLengths, MainLengths, sizeof(MainLengths));
+    memcpy(PrevLengthLengths, LengthLengths, sizeof(LengthLengths));
+
+    /* The length tree is empty when there are no long matches */
+    return LZXBuildTree(&MainTree, MainLengths, MainElements) &&
+           LZXBuildTree(&LengthTree, LengthLengths, LZX_LENGTH_ELEMENTS);
+}
+
+
+void CLZXCodec::TranslateCalls(PUCHAR Data, ULONG Length, ULONG Offset)
+/*
+ * FUNCTION: Turns absolute call targets back into relative ones
+ * ARGUMENTS:
+ *     Data   = Pointer to uncompressed frame
+ *     Length = Length of frame
+ *     Offset = Folder offset of frame
+ */
+{
+    LONG Absolute;
+    LONG Relative;
+    LONG Current;
+    ULONG i;
+
+    if ((E8Size == 0) || (FrameCount >= LZX_E8_FRAMES) || (Length <= 10))
+        return;
+
+    for (i = 0; i < Length - 10;)
+    {
+        if (Data[i] != 0xE8)
+        {
+            i++;
+            continue;
+        }
+
+        Current  = (LONG)(Offset + i);
+        Absolute = (LONG)LZXReadUlong(Data + i + 1);
+        if ((Absolute >= -Current) && (Absolute < (LONG)E8Size))
+        {
+            Relative = (Absolute >= 0) ? Absolute - Current : Absolute + (LONG)E8Size;
+            Data[i + 1] = (UCHAR)Relative;
+            Data[i + 2] = (UCHAR)(Relative >> 8);
+            Data[i + 3] = (UCHAR)(Relative >> 16);
+            Data[i + 4] = (UCHAR)(Relative >> 24);
+        }
+
+        i += 5;
+    }
+}
+
+
+ULONG CLZXCodec::Uncompress(void* OutputBuffer,
+                            void* InputBuffer,
+                            ULONG InputLength,
+                            PULONG OutputLength)
+/*
+ * FUNCTION: Uncompresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer = Pointer to buffer to place uncompressed data
+ *     InputBuffer  = Pointer to buffer with data to be uncompressed
+ *     InputLength  = Length of input buffer
+ *     OutputLength = Address of buffer to place size of uncompressed data
+ * NOTES:
+ *     The frame ends after CAB_BLOCKSIZE bytes, or earlier
+ *     in the last frame of the folder when the input does
+ */
+{
+    PUCHAR Data;
+    PUCHAR Source;
+    ULONG Position = 0;
+    ULONG History;
+    ULONG Start, End;
+    ULONG Main, Slot, Extra;
+    ULONG Length, Offset;
+    ULONG Symbol;
+    ULONG Count;
+
+    DPRINT(MAX_TRACE, ("InputLength (%u).\n", (UINT)InputLength));
+
+    if (!Window)
+        return CS_NOMEMORY;
+
+    if (MainElements == 0)
+        return CS_BADSTREAM;
+
+    SlideWindow(CAB_BLOCKSIZE);
+    Data    = Window + (WindowEnd - WindowBase);
+    History = WindowEnd - WindowBase;
+
+    StartInput((PUCHAR)InputBuffer, InputLength);
+
+    if (!HeaderDone)
+    {
+        HeaderDone = true;
+        if (GetBits(1))
+        {
+            E8Size  = GetBits(16) << 16;
+            E8Size |= GetBits(16);
+        }
+    }
+
+    while (Position < CAB_BLOCKSIZE)
+    {
+        if (BlockRemaining <= 0)
+        {
+            /* Only the padding of the frame is left */
+            if (BitsLeft() < 16)
+                break;
+
+            BlockType       = GetBits(3);
+            BlockLength     = GetBits(16) << 8;
+            BlockLength    |= GetBits(8);
+            BlockRemaining += (LONG)BlockLength;
+            if (BlockRemaining <= 0)
+                return CS_BADSTREAM;
+
+            switch (BlockType)
+            {
+                case LZX_BLOCKTYPE_ALIGNED:
+                    for (Count = 0; Count < LZX_ALIGNED_ELEMENTS; Count++)
+                        AlignedLengths[Count] = (UCHAR)GetBits(3);
+
+                    if (!LZXBuildTree(&AlignedTree, AlignedLengths, LZX_ALIGNED_ELEMENTS))
+                        return CS_BADSTREAM;
+
+                    /* Fall through */
+                case LZX_BLOCKTYPE_VERBATIM:
+                    if (!ReadTrees())
+                        return CS_BADSTREAM;
+                    break;
+
+                case LZX_BLOCKTYPE_UNCOMPRESSED:
+                    AlignInput();
+                    if (InputPosition + 12 > InputLength)
+                        return CS_BADSTREAM;
+
+                    R0 = LZXReadUlong(InputStart + InputPosition);
+                    R1 = LZXReadUlong(InputStart + InputPosition + 4);
+                    R2 = LZXReadUlong(InputStart + InputPosition + 8);
+                    InputPosition += 12;
+                    break;
+
+                default:
+                    DPRINT(MIN_TRACE, ("Bad LZX block type (%u).\n", (UINT)BlockType));
+                    return CS_BADSTREAM;
+            }
+        }
+
+        Start = Position;
+        End   = Position + (((ULONG)BlockRemaining < CAB_BLOCKSIZE - Position) ?
+                            (ULONG)BlockRemaining : CAB_BLOCKSIZE - Position);
+
+        if (BlockType == LZX_BLOCKTYPE_UNCOMPRESSED)
+        {
+            Count = End - Position;
+            if (InputPosition + Count > InputLength)
+                return CS_BADSTREAM;
+
+            memcpy(Data + Position, InputStart + InputPosition, Count);
+            InputPosition  += Count;
+            Position       += Count;
+            BlockRemaining -= (LONG)Count;
+
+            /* Odd blocks are padded to a word */
+            if ((BlockRemaining == 0) && (BlockLength & 1) && (InputPosition < InputLength))
+                InputPosition++;
+            continue;
+        }
+
+        while (Position < End)
+        {
+            Main = DecodeSymbol(&MainTree);
+            if (Main < LZX_NUM_CHARS)
+            {
+                Data[Position++] = (UCHAR)Main;
+                continue;
+            }
+
+            if (Main == LZX_NIL)
+                return CS_BADSTREAM;
+
+            Main  -= LZX_NUM_CHARS;
+            Length = Main & 7;
+            if (Length == 7)
+            {
+                Symbol = DecodeSymbol(&LengthTree);
+                if (Symbol == LZX_NIL)
+                    return CS_BADSTREAM;
+                Length += Symbol;
+            }
+            Length += LZX_MIN_MATCH;
+
+            Slot = Main >> 3;
+            if (Slot == 0)
+            {
+                Offset = R0;
+            }
+            else if (Slot == 1)
+            {
+                Offset = R1;
+                R1 = R0;
+                R0 = Offset;
+            }
+            else if (Slot == 2)
+            {
+                Offset = R2;
+                R2 = R0;
+                R0 = Offset;
+            }
+            else
+            {
+                Extra  = LZXExtraBits[Slot];
+                Offset = LZXPositionBase[Slot] - 2;
+                if ((BlockType == LZX_BLOCKTYPE_ALIGNED) && (Extra >= 3))
+                {
+                    Offset += GetBits(Extra - 3) << 3;
+                    Symbol  = DecodeSymbol(&AlignedTree);
+                    if (Symbol == LZX_NIL)
+                        return CS_BADSTREAM;
+                    Offset += Symbol;
+                }
+                else
+                {
+                    Offset += GetBits(Extra);
+                }
+
+                R2 = R1;
+                R1 = R0;
+                R0 = Offset;
+            }
+
+            /* Matches may run into the next block, but not the next frame */
+            if ((Length > CAB_BLOCKSIZE - Position) || (Offset == 0) || (Offset > History + Position))
+                return CS_BADSTREAM;
+
+            /* A byte at a time, the match may overlap itself */
+            Source = Data + Position - Offset;
+            for (; Length > 0; Length--)
+                Data[Position++] = *Source++;
+        }
+
+        BlockRemaining -= (LONG)(Position - Start);
+    }
+
+    /* Zeroes were read past the end of a truncated frame */
+    if ((ULONGLONG)InputPosition * 8 - BitCount > (ULONGLONG)InputLength * 8)
+        return CS_BADSTREAM;
+
+    memcpy(OutputBuffer, Data, Position);
+    TranslateCalls((PUCHAR)OutputBuffer, Position, WindowEnd);
+
+    WindowEnd += Position;
+    FrameCount++;
+    *OutputLength = Position;
+
+    return CS_SUCCESS;
+}
+
+/* EOF */
@@ -0,0 +1,159 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS cabinet manager
+ * FILE:        tools/cabman/lzx.h
+ * PURPOSE:     CAB codec for LZX compressed data
+ */
+
+#pragma once
+
+#include "cabinet.h"
+
+#define LZX_MIN_WINDOW_BITS     15
+#define LZX_WINDOW_BITS         21
+#define LZX_WINDOW_SIZE         (1 << LZX_WINDOW_BITS)
+#define LZX_HISTORY_SIZE        (2 * LZX_WINDOW_SIZE)
+#define LZX_POSITION_SLOTS      50
+#define LZX_NUM_CHARS           256
+#define LZX_MAIN_ELEMENTS       (LZX_NUM_CHARS + LZX_POSITION_SLOTS * 8)
+#define LZX_LENGTH_ELEMENTS     249
+#define LZX_PRETREE_ELEMENTS    20
+#define LZX_ALIGNED_ELEMENTS    8
+#define LZX_MIN_MATCH           2
+#define LZX_MAX_MATCH           257
+#define LZX_MAX_OFFSET          (LZX_WINDOW_SIZE - 3)
+
+#define LZX_BLOCKTYPE_VERBATIM      1
+#define LZX_BLOCKTYPE_ALIGNED       2
+#define LZX_BLOCKTYPE_UNCOMPRESSED  3
+
+/* Call translation is only done in the first frames of a folder */
+#define LZX_E8_FRAMES           32768
+
+/* Match finder */
+#define LZX_HASH_BITS           20      /* Few collisions left in a full window */
+#define LZX_HASH_SIZE           (1 << LZX_HASH_BITS)
+#define LZX_MAX_CHAIN           64
+#define LZX_GOOD_MATCH          16      /* Search a quarter of the chain after this length */
+#define LZX_NICE_MATCH          64      /* Stop searching at this length */
+#define LZX_MAX_LAZY            32      /* Don't look for a better match after this length */
+#define LZX_FAR_MATCH           16384   /* Shortest matches are not worth a far offset */
+#define LZX_SKIP_SHIFT          5       /* Skip one more byte every 32 positions without a match */
+#define LZX_NIL                 0xFFFFFFFF
+
+/* A verbatim frame takes at most 16 bits per input byte plus the trees */
+#define LZX_FRAME_BUFFER_SIZE   (2 * CAB_BLOCKSIZE + 4096)
+
+/* Codes up to this length are decoded with a single table lookup */
+#define LZX_TABLE_BITS          10
+
+
+/* Structures */
+
+typedef struct _LZX_ITEM
+{
+    USHORT MainElement;     // Literal or match main tree element
+    USHORT LengthFooter;    // Length tree element for long matches
+    ULONG VerbatimBits;     // Position footer for new offsets
+    UCHAR ExtraBits;        // Number of bits in VerbatimBits
+} LZX_ITEM, *PLZX_ITEM;
+
+typedef struct _LZX_DECODE_TREE
+{
+    USHORT Count[17];                       // Number of codes of each length
+    USHORT Symbols[LZX_MAIN_ELEMENTS];      // Symbols in canonical code order
+    USHORT Table[1 << LZX_TABLE_BITS];      // Symbol << 4 | length of short codes
+} LZX_DECODE_TREE, *PLZX_DECODE_TREE;
+
+
+/* Classes */
+
+class CLZXCodec : public CCABCodec
+{
+public:
+    /* Default constructor */
+    CLZXCodec();
+    /* Default destructor */
+    virtual ~CLZXCodec();
+    /* Compresses a data block */
+    virtual ULONG Compress(void* OutputBuffer,
+                           void* InputBuffer,
+                           ULONG InputLength,
+                           PULONG OutputLength);
+    /* Uncompresses a data block */
+    virtual ULONG Uncompress(void* OutputBuffer,
+                             void* InputBuffer,
+                             ULONG InputLength,
+                             PULONG OutputLength);
+    /* Starts a new folder */
+    virtual bool Reset(USHORT CompressionType);
+    /* Frames depend on the window and trees of the previous ones */
+    virtual bool IsStateless() { return false; };
+private:
+    void SlideWindow(ULONG Length);
+    void AppendWindow(PUCHAR Data, ULONG Length);
+    void InsertHashes(ULONG Position);
+    ULONG FindMatch(ULONG Position, ULONG End, ULONG PrevLength, PULONG Offset);
+    void AddLiteral(UCHAR Literal);
+    void AddMatch(ULONG Length, ULONG Offset);
+    void Parse(ULONG Start, ULONG Length);
+    void StartBits(PUCHAR Buffer);
+    void PutBits(ULONG Value, ULONG Count);
+    ULONG FlushBits();
+    void WriteLengths(PUCHAR Lengths, PUCHAR PrevLengths, ULONG First, ULONG Last);
+    void WriteVerbatimBlock(ULONG Length);
+    void WriteUncompressedBlock(PUCHAR Data, ULONG Length);
+    void StartInput(PUCHAR Buffer, ULONG Length);
+    void FillBits(ULONG Count);
+    ULONG GetBits(ULONG Count);
+    ULONG BitsLeft();
+    void AlignInput();
+    ULONG DecodeSymbol(PLZX_DECODE_TREE Tree);
+    bool ReadLengths(PUCHAR Lengths, PUCHAR PrevLengths, ULONG First, ULONG Last);
+    bool ReadTrees();
+    void TranslateCalls(PUCHAR Data, ULONG Length, ULONG Offset);
+    /* History */
+    PUCHAR Window;
+    ULONG WindowBase;       // Folder offset of Window[0]
+    ULONG WindowEnd;        // Folder offset of the end of the history
+    PULONG HashHead;
+    PULONG HashPrev;
+    ULONG HashPosition;     // Next folder offset to insert in the hash chains
+    ULONG R0, R1, R2;       // Repeated offsets
+    ULONG MainElements;     // Main tree size for the window of the folder
+    bool HeaderDone;        // Stream header was written or read
+    /* Current frame */
+    PLZX_ITEM Items;
+    ULONG ItemCount;
+    ULONG MainFreq[LZX_MAIN_ELEMENTS];
+    ULONG LengthFreq[LZX_LENGTH_ELEMENTS];
+    UCHAR MainLengths[LZX_MAIN_ELEMENTS];
+    UCHAR LengthLengths[LZX_LENGTH_ELEMENTS];
+    USHORT MainCodes[LZX_MAIN_ELEMENTS];
+    USHORT LengthCodes[LZX_LENGTH_ELEMENTS];
+    /* Trees of the previous block, lengths are delta coded */
+    UCHAR PrevMainLengths[LZX_MAIN_ELEMENTS];
+    UCHAR PrevLengthLengths[LZX_LENGTH_ELEMENTS];
+    /* Current block when uncompressing */
+    ULONG E8Size;           // Call translation size, 0 if calls aren't translated
+    ULONG FrameCount;
+    ULONG BlockType;
+    ULONG BlockLength;
+    LONG BlockRemaining;    // Negative when a match ran into the next block
+    UCHAR AlignedLengths[LZX_ALIGNED_ELEMENTS];
+    LZX_DECODE_TREE MainTree;
+    LZX_DECODE_TREE LengthTree;
+    LZX_DECODE_TREE AlignedTree;
+    LZX_DECODE_TREE PreTree;
+    /* Bit stream, written right aligned and read left aligned */
+    PUCHAR FrameBuffer;
+    PUCHAR OutputStart;
+    PUCHAR OutputPosition;
+    PUCHAR InputStart;
+    ULONG InputPosition;
+    ULONG InputLength;
+    ULONG BitBuffer;
+    ULONG BitCount;
+};
+
+/* EOF */
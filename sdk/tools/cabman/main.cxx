@@ -14,6 +14,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <chrono>
 #include "cabman.h"
 
 
@@ -192,8 +193,8 @@ void CCABManager::Usage()
 {
     printf("ReactOS Cabinet Manager\n\n");
     printf("CABMAN [-D | -E] [-A] [-L dir] cabinet [filename ...]\n");
-    printf("CABMAN [-M mode] -C dirfile [-I] [-RC file] [-P dir]\n");
-    printf("CABMAN [-M mode] -S cabinet filename [...]\n");
+    printf("CABMAN [-M mode] [-J count] -C dirfile [-I] [-RC file] [-P dir]\n");
+    printf("CABMAN [-M mode] [-J count] -S cabinet filename [...]\n");
     printf("  cabinet   Cabinet file.\n");
     printf("  filename  Name of the file to add to or extract from the cabinet.\n");
     printf("            Wild cards and multiple filenames\n");
@@ -207,17 +208,21 @@ void CCABManager::Usage()
     printf("  -D        Display cabinet directory.\n");
     printf("  -E        Extract files from cabinet.\n");
     printf("  -I        Don't create the cabinet, only the .inf file.\n");
+    printf("  -J count  Number of threads to compress on (default is the\n");
+    printf("            number of processors). LZX always uses one.\n");
     printf("  -L dir    Location to place extracted or generated files\n");
     printf("            (default is current directory).\n");
     printf("  -M mode   Specify the compression method to use:\n");
     printf("               raw    - No compression\n");
     printf("               mszip  - MsZip compression (default)\n");
+    printf("               lzx    - LZX compression\n");
     printf("  -N        Don't create the .inf file, only the cabinet.\n");
     printf("  -RC       Specify file to put in cabinet reserved area\n");
     printf("            (size must be less than 64KB).\n");
     printf("  -S        Create simple cabinet.\n");
     printf("  -P dir    Files in the .dff are relative to this directory.\n");
-    printf("  -V        Verbose mode (prints more messages).\n");
+    printf("  -V        Verbose mode (prints more messages and compression\n");
+    printf("            statistics).\n");
 }
 
 bool CCABManager::ParseCmdline(int argc, char* argv[])
@@ -231,6 +236,7 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
  */
 {
     int i;
+    int Threads;
     bool ShowUsage;
     bool FoundCabinet = false;
 
@@ -267,6 +273,25 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                     InfFileOnly = true;
                     break;
 
+                case 'j':
+                case 'J':
+                    if (argv[i][2] == 0)
+                    {
+                        i++;
+                        Threads = atoi(&argv[i][0]);
+                    }
+                    else
+                        Threads = atoi(&argv[i][2]);
+
+                    if (Threads < 1)
+                    {
+                        printf("ERROR: Invalid thread count specified!\n");
+                        return false;
+                    }
+
+                    SetThreadCount((ULONG)Threads);
+                    break;
+
                 case 'l':
                 case 'L':
                     if (argv[i][2] == 0)
@@ -499,7 +524,6 @@ bool CCABManager::ExtractFromCabinet()
  */
 {
     bool bRet = true;
-    CAB_SEARCH Search;
     ULONG Status;
 
     if (Open() == CAB_STATUS_SUCCESS)
@@ -509,43 +533,34 @@ bool CCABManager::ExtractFromCabinet()
             printf("Cabinet %s\n\n", GetCabinetName());
         }
 
-        if (FindFirst(&Search) == CAB_STATUS_SUCCESS)
+        switch (Status = ExtractFiles())
         {
-            do
-            {
-                switch (Status = ExtractFile(Search.FileName))
-                {
-                    case CAB_STATUS_SUCCESS:
-                        break;
-
-                    case CAB_STATUS_INVALID_CAB:
-                        printf("ERROR: Cabinet contains errors.\n");
-                        bRet = false;
-                        break;
-
-                    case CAB_STATUS_UNSUPPCOMP:
-                        printf("ERROR: Cabinet uses unsupported compression type.\n");
-                        bRet = false;
-                        break;
-
-                    case CAB_STATUS_CANNOT_WRITE:
-                        printf("ERROR: You've run out of free space on the destination volume or the volume is damaged.\n");
-                        bRet = false;
-                        break;
-
-                    default:
-                        printf("ERROR: Unspecified error code (%u).\n", (UINT)Status);
-                        bRet = false;
-                        break;
-                }
-
-                if(!bRet)
-                    break;
-            } while (FindNext(&Search) == CAB_STATUS_SUCCESS);
-
-            DestroySearchCriteria();
+            case CAB_STATUS_SUCCESS:
+                break;
+
+            case CAB_STATUS_INVALID_CAB:
+                printf("ERROR: Cabinet contains errors.\n");
+                bRet = false;
+                break;
+
+            case CAB_STATUS_UNSUPPCOMP:
+                printf("ERROR: Cabinet uses unsupported compression type.\n");
+                bRet = false;
+                break;
+
+            case CAB_STATUS_CANNOT_WRITE:
+                printf("ERROR: You've run out of free space on the destination volume or the volume is damaged.\n");
+                bRet = false;
+                break;
+
+            default:
+                printf("ERROR: Unspecified error code (%u).\n", (UINT)Status);
+                bRet = false;
+                break;
         }
 
+        DestroySearchCriteria();
+
         return bRet;
     }
     else
@@ -555,20 +570,49 @@ bool CCABManager::ExtractFromCabinet()
 }
 
 
+void CCABManager::PrintStatistics(double Seconds)
+/*
+ * FUNCTION: Prints how much was compressed and how fast
+ * ARGUMENTS:
+ *     Seconds = Time it took to create the cabinet
+ */
+{
+    ULONGLONG Uncompressed;
+    ULONGLONG Compressed;
+
+    GetCompressionStatistics(&Uncompressed, &Compressed);
+
+    printf("\nCompressed %llu bytes to %llu bytes", (unsigned long long)Uncompressed, (unsigned long long)Compressed);
+    if (Uncompressed > 0)
+        printf(" (%u%%)", (UINT)(Compressed * 100 / Uncompressed));
+    printf(" in %.2f seconds", Seconds);
+    if (Seconds > 0)
+        printf(" (%.1f MB/s)", Uncompressed / Seconds / (1024 * 1024));
+    printf(".\n");
+}
+
+
 bool CCABManager::Run()
 /*
  * FUNCTION: Process cabinet
  */
 {
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::duration<double> Elapsed;
+    bool bRet;
+
     if (Verbose)
     {
         printf("ReactOS Cabinet Manager\n\n");
     }
 
+    Start = std::chrono::steady_clock::now();
+
     switch (Mode)
     {
         case CM_MODE_CREATE:
-            return CreateCabinet();
+            bRet = CreateCabinet();
+            break;
 
         case CM_MODE_DISPLAY:
             return DisplayCabinet();
@@ -577,12 +621,20 @@ bool CCABManager::Run()
             return ExtractFromCabinet();
 
         case CM_MODE_CREATE_SIMPLE:
-            return CreateSimpleCabinet();
+            bRet = CreateSimpleCabinet();
+            break;
 
         default:
-            break;
+            return false;
     }
-    return false;
+
+    if (Verbose && bRet)
+    {
+        Elapsed = std::chrono::steady_clock::now() - Start;
+        PrintStatistics(Elapsed.count());
+    }
+
+    return bRet;
 }
 
 
@@ -35,6 +35,8 @@ public:
 private:
     int Status;
     z_stream ZStream; /* Zlib stream */
+    z_stream DeflateStream; /* Zlib stream kept for all compressed blocks */
+    bool DeflateReady;
 };
 
 /* EOF */
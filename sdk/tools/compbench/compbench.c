@@ -0,0 +1,299 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Round trip and throughput benchmark for the RTL compression formats
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <xpress.h>
+
+/* Data is compressed in independent chunks, like hibernation and WIM images do */
+#define CHUNK_SIZE      0x10000
+#define CORPUS_SIZE     (4 * 1024 * 1024)
+#define ROUNDS          3
+
+typedef struct _CODEC
+{
+    const char *Name;
+    USHORT Format;
+    USHORT Engine;
+} CODEC, *PCODEC;
+
+/* Every format and engine pair goes through the public RTL entry points */
+static CODEC Codecs[] =
+{
+    { "LZNT1 standard",       COMPRESSION_FORMAT_LZNT1,       COMPRESSION_ENGINE_STANDARD },
+    { "LZNT1 maximum",        COMPRESSION_FORMAT_LZNT1,       COMPRESSION_ENGINE_MAXIMUM },
+    { "XPRESS standard",      COMPRESSION_FORMAT_XPRESS,      COMPRESSION_ENGINE_STANDARD },
+    { "XPRESS maximum",       COMPRESSION_FORMAT_XPRESS,      COMPRESSION_ENGINE_MAXIMUM },
+    { "XPRESS_HUFF standard", COMPRESSION_FORMAT_XPRESS_HUFF, COMPRESSION_ENGINE_STANDARD },
+    { "XPRESS_HUFF maximum",  COMPRESSION_FORMAT_XPRESS_HUFF, COMPRESSION_ENGINE_MAXIMUM },
+};
+
+static ULONG Seed = 0x12345678;
+
+static
+ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+/* Text, structured records, skewed binary, runs and noise, always the same */
+static
+PUCHAR
+GenerateCorpus(ULONG *Size)
+{
+    static const char *Words[] =
+    {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "with",
+        "file", "system", "registry", "kernel", "driver", "memory", "object",
+        "handle", "process", "thread", "section", "compression", "ReactOS",
+        "NtCreateFile", "IRP_MJ_READ", "STATUS_SUCCESS", "\\SystemRoot\\"
+    };
+    static const char *Names[] = { "explorer", "services", "lsass", "winlogon", "csrss", "smss" };
+    PUCHAR Data, Current, End;
+    ULONG Length, Record = 0, i;
+
+    Data = malloc(CORPUS_SIZE);
+    if (!Data)
+        return NULL;
+
+    Current = Data;
+
+    /* Text */
+    End = Data + CORPUS_SIZE / 4;
+    while (Current < End)
+    {
+        const char *Word = Words[Random() % (sizeof(Words) / sizeof(Words[0]))];
+
+        Length = (ULONG)strlen(Word);
+        if (Current + Length + 2 > End)
+            break;
+
+        memcpy(Current, Word, Length);
+        Current += Length;
+        *Current++ = (Random() % 12) ? ' ' : '\n';
+    }
+    memset(Current, ' ', End - Current);
+    Current = End;
+
+    /* Records */
+    End += CORPUS_SIZE / 4;
+    while (Current + 32 <= End)
+    {
+        memset(Current, 0, 32);
+        *(ULONG *)Current = Record++;
+        *(USHORT *)(Current + 4) = (USHORT)(1 << (Random() % 4));
+        strcpy((char *)Current + 8, Names[Random() % (sizeof(Names) / sizeof(Names[0]))]);
+        *(ULONG *)(Current + 24) = 0x1000 * (Random() % 64);
+        Current += 32;
+    }
+    memset(Current, 0, End - Current);
+    Current = End;
+
+    /* Skewed byte distribution, like machine code */
+    End += CORPUS_SIZE / 4;
+    while (Current < End)
+    {
+        for (i = 0; i < 7 && (Random() & 1); i++);
+        *Current++ = (UCHAR)((Random() & ((1 << i) - 1)) | ((i & 1) ? 0x80 : 0));
+    }
+
+    /* Runs */
+    End += CORPUS_SIZE / 8;
+    while (Current < End)
+    {
+        Length = min((ULONG)(End - Current), 1 + Random() % 2048);
+        memset(Current, (Random() % 4) ? 0 : (UCHAR)Random(), Length);
+        Current += Length;
+    }
+
+    /* Noise */
+    End = Data + CORPUS_SIZE;
+    while (Current < End)
+        *Current++ = (UCHAR)Random();
+
+    *Size = CORPUS_SIZE;
+    return Data;
+}
+
+static
+PUCHAR
+LoadCorpus(const char *FileName, ULONG *Size)
+{
+    PUCHAR Data;
+    FILE *File;
+    long Length;
+
+    File = fopen(FileName, "rb");
+    if (!File)
+        return NULL;
+
+    fseek(File, 0, SEEK_END);
+    Length = ftell(File);
+    fseek(File, 0, SEEK_SET);
+
+    Data = malloc(Length ? Length : 1);
+    if (Data && fread(Data, 1, Length, File) != (size_t)Length)
+    {
+        free(Data);
+        Data = NULL;
+    }
+
+    fclose(File);
+    *Size = (ULONG)Length;
+    return Data;
+}
+
+static
+double
+MegabytesPerSecond(ULONG Size, clock_t Ticks)
+{
+    if (!Ticks)
+        Ticks = 1;
+
+    return ((double)Size * ROUNDS / (1024 * 1024)) / ((double)Ticks / CLOCKS_PER_SEC);
+}
+
+static
+int
+RunCodec(PCODEC Codec, PUCHAR Corpus, ULONG Size)
+{
+    ULONG ChunkCount = (Size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    ULONG Chunk, ChunkSize, Round, Final, Total = 0, WorkSpaceSize, FragmentSize;
+    PUCHAR Compressed, Decompressed;
+    PULONG CompressedSizes;
+    clock_t Start, CompressTicks, DecompressTicks;
+    PVOID WorkSpace = NULL;
+    NTSTATUS Status;
+    int Result = 0;
+
+    Status = RtlGetCompressionWorkSpaceSize(Codec->Format | Codec->Engine, &WorkSpaceSize, &FragmentSize);
+    if (!NT_SUCCESS(Status))
+    {
+        printf("%s: no workspace size, 0x%08x\n", Codec->Name, Status);
+        return 1;
+    }
+
+    /* Incompressible chunks grow a little */
+    Compressed = malloc((size_t)ChunkCount * (CHUNK_SIZE * 2));
+    Decompressed = malloc(Size ? Size : 1);
+    CompressedSizes = malloc(ChunkCount * sizeof(ULONG) + 1);
+    WorkSpace = malloc(WorkSpaceSize);
+    if (!Compressed || !Decompressed || !CompressedSizes || !WorkSpace)
+    {
+        printf("%s: out of memory\n", Codec->Name);
+        Result = 1;
+        goto Cleanup;
+    }
+
+    Start = clock();
+    for (Round = 0; Round < ROUNDS; Round++)
+    {
+        for (Chunk = 0; Chunk < ChunkCount; Chunk++)
+        {
+            ChunkSize = min(CHUNK_SIZE, Size - Chunk * CHUNK_SIZE);
+            Status = RtlCompressBuffer(Codec->Format | Codec->Engine,
+                                       Corpus + Chunk * CHUNK_SIZE,
+                                       ChunkSize,
+                                       Compressed + Chunk * (CHUNK_SIZE * 2),
+                                       CHUNK_SIZE * 2,
+                                       4096,
+                                       &CompressedSizes[Chunk],
+                                       WorkSpace);
+            if (!NT_SUCCESS(Status))
+            {
+                printf("%s: compressing chunk %u failed with 0x%08x\n", Codec->Name, Chunk, Status);
+                Result = 1;
+                goto Cleanup;
+            }
+        }
+    }
+    CompressTicks = clock() - Start;
+
+    Start = clock();
+    for (Round = 0; Round < ROUNDS; Round++)
+    {
+        for (Chunk = 0; Chunk < ChunkCount; Chunk++)
+        {
+            ChunkSize = min(CHUNK_SIZE, Size - Chunk * CHUNK_SIZE);
+            Status = RtlDecompressBuffer(Codec->Format,
+                                         Decompressed + Chunk * CHUNK_SIZE,
+                                         ChunkSize,
+                                         Compressed + Chunk * (CHUNK_SIZE * 2),
+                                         CompressedSizes[Chunk],
+                                         &Final);
+            if (!NT_SUCCESS(Status) || Final != ChunkSize)
+            {
+                printf("%s: decompressing chunk %u failed with 0x%08x (%u bytes)\n",
+                       Codec->Name, Chunk, Status, Final);
+                Result = 1;
+                goto Cleanup;
+            }
+        }
+    }
+    DecompressTicks = clock() - Start;
+
+    if (memcmp(Corpus, Decompressed, Size))
+    {
+        printf("%s: decompressed data does not match\n", Codec->Name);
+        Result = 1;
+        goto Cleanup;
+    }
+
+    for (Chunk = 0; Chunk < ChunkCount; Chunk++)
+        Total += CompressedSizes[Chunk];
+
+    printf("%-22s ratio %5.1f%%  compress %8.1f MB/s  decompress %8.1f MB/s\n",
+           Codec->Name,
+           Size ? 100.0 * Total / Size : 0.0,
+           MegabytesPerSecond(Size, CompressTicks),
+           MegabytesPerSecond(Size, DecompressTicks));
+
+Cleanup:
+    free(WorkSpace);
+    free(CompressedSizes);
+    free(Decompressed);
+    free(Compressed);
+    return Result;
+}
+
+int main(int argc, char *argv[])
+{
+    PUCHAR Corpus;
+    ULONG Size, i;
+    int Result = 0;
+
+    if (argc > 2)
+    {
+        printf("Checks and measures RTL compression and decompression.\n"
+               "Syntax: compbench [corpus file]\n");
+        return 1;
+    }
+
+    if (argc == 2)
+        Corpus = LoadCorpus(argv[1], &Size);
+    else
+        Corpus = GenerateCorpus(&Size);
+
+    if (!Corpus)
+    {
+        printf("Unable to load the corpus\n");
+        return 1;
+    }
+
+    printf("Corpus: %u bytes in %u byte chunks, %u rounds\n", Size, CHUNK_SIZE, ROUNDS);
+
+    for (i = 0; i < sizeof(Codecs) / sizeof(Codecs[0]); i++)
+        Result |= RunCodec(&Codecs[i], Corpus, Size);
+
+    free(Corpus);
+    return Result;
+}
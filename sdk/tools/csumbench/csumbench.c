@@ -0,0 +1,166 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Correctness test and benchmark for the tcpip checksum routines
+ * COPYRIGHT:   Copyright 2018 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <checksum.h>
+
+#define MAX_TEST_LENGTH 600
+#define PACKET_SIZE     1500
+#define BENCH_PACKETS   200000
+
+static ULONG Seed = 0x12345678;
+
+static
+ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+static
+void
+FillBytes(PVOID Buffer, ULONG Size)
+{
+    PUCHAR Bytes = Buffer;
+
+    while (Size--)
+        *Bytes++ = (UCHAR)Random();
+}
+
+/* The scalar ChecksumCompute this replaces */
+static
+ULONG
+ReferenceCompute(PVOID Data, UINT Count, ULONG Sum)
+{
+    while (Count > 1)
+    {
+        Sum += *(PUSHORT)Data;
+        Count -= 2;
+        Data = (PVOID)((ULONG_PTR)Data + 2);
+    }
+
+    if (Count > 0)
+        Sum += *(PUCHAR)Data;
+
+    return Sum;
+}
+
+static
+int
+TestCorrectness(void)
+{
+    static UCHAR Source[MAX_TEST_LENGTH + 16], Dest[MAX_TEST_LENGTH + 16], Expected[MAX_TEST_LENGTH + 16];
+    UINT Length, SrcOffset, DstOffset;
+    ULONG Initial, Sum, Reference;
+    int Errors = 0;
+
+    for (Length = 0; Length <= MAX_TEST_LENGTH; Length++)
+    {
+        /* Every alignment of the source against the destination */
+        for (SrcOffset = 0; SrcOffset < 8; SrcOffset++)
+        {
+            for (DstOffset = 0; DstOffset < 8; DstOffset++)
+            {
+                FillBytes(Source, sizeof(Source));
+                FillBytes(Dest, sizeof(Dest));
+
+                /* Also all ones, where carries pile up the most */
+                if (Length % 7 == 3)
+                    memset(Source + SrcOffset, 0xFF, Length);
+
+                memcpy(Expected, Dest, sizeof(Dest));
+                memcpy(Expected + DstOffset, Source + SrcOffset, Length);
+
+                Initial = (Length & 1) ? Random() & 0xFFFFF : 0;
+                Reference = ChecksumFold(ReferenceCompute(Source + SrcOffset, Length, Initial));
+
+                Sum = ChecksumFold(ChecksumCompute(Source + SrcOffset, Length, Initial));
+                if (Sum != Reference)
+                {
+                    if (Errors++ < 10)
+                        printf("ChecksumCompute mismatch, length %u, offset %u: %04lx instead of %04lx\n",
+                               Length, SrcOffset, (unsigned long)Sum, (unsigned long)Reference);
+                }
+
+                Sum = ChecksumFold(ChecksumCopy(Dest + DstOffset, Source + SrcOffset, Length, Initial));
+                if (Sum != Reference || memcmp(Dest, Expected, sizeof(Dest)) != 0)
+                {
+                    if (Errors++ < 10)
+                        printf("ChecksumCopy mismatch, length %u, offsets %u/%u: %04lx instead of %04lx\n",
+                               Length, SrcOffset, DstOffset, (unsigned long)Sum, (unsigned long)Reference);
+                }
+            }
+        }
+    }
+
+    return Errors;
+}
+
+static
+double
+Elapsed(clock_t Start)
+{
+    double Seconds = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+    return (Seconds > 0) ? Seconds : 1e-6;
+}
+
+#define BENCH(Name, Call)                                                           \
+    do                                                                              \
+    {                                                                               \
+        clock_t Start = clock();                                                    \
+        for (i = 0; i < BENCH_PACKETS; i++)                                         \
+            Sum += Call;                                                            \
+        printf("  %-12s %8.1f MB/s\n", Name,                                        \
+               (double)BENCH_PACKETS * PACKET_SIZE / Elapsed(Start) / 1e6);         \
+    } while (0)
+
+static
+void
+Benchmark(UINT Offset)
+{
+    static ULONG Source[PACKET_SIZE / 4 + 2], Dest[PACKET_SIZE / 4 + 2];
+    PUCHAR Src = (PUCHAR)Source + Offset, Dst = (PUCHAR)Dest + Offset;
+    ULONG Sum = 0;
+    UINT i;
+
+    FillBytes(Source, sizeof(Source));
+
+    printf("%u byte packets at offset %u:\n", PACKET_SIZE, Offset);
+    BENCH("compute old", ReferenceCompute(Src, PACKET_SIZE, 0));
+    BENCH("compute new", ChecksumCompute(Src, PACKET_SIZE, 0));
+    BENCH("copy old", (memcpy(Dst, Src, PACKET_SIZE), ReferenceCompute(Dst, PACKET_SIZE, 0)));
+    BENCH("copy new", ChecksumCopy(Dst, Src, PACKET_SIZE, 0));
+
+    /* Keep the sums from being optimized away */
+    if (Sum == 0x12345678)
+        printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int Errors;
+
+    Errors = TestCorrectness();
+    printf("Correctness: %s\n", Errors ? "FAILED" : "passed");
+    if (Errors)
+        return 1;
+
+    if (argc > 1 && strcmp(argv[1], "-q") == 0)
+        return 0;
+
+    Benchmark(0);
+    Benchmark(1);
+    Benchmark(2);
+
+    return 0;
+}
@@ -0,0 +1,402 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Benchmark for registry hive cell allocation in cmlib
+ * COPYRIGHT:   Copyright 2018 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* gcc defaults to cdecl */
+#if defined(__GNUC__)
+#undef __cdecl
+#define __cdecl
+#endif
+
+#include <typedefs.h>
+
+unsigned char BitScanForward(ULONG * Index, unsigned long Mask);
+unsigned char BitScanReverse(ULONG * const Index, unsigned long Mask);
+#define RtlFillMemoryUlong(dst, len, val) memset(dst, val, len)
+
+#define CMLIB_HOST
+#include <cmlib.h>
+#include <bitmap.c>
+
+/* Values alive at any time, each create is followed by a delete */
+#define LIVE_VALUES     50000
+#define DEFAULT_OPS     1000000
+
+#define REG_BINARY      3
+
+static ULONG Seed = 0x12345678;
+
+static
+ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+/* Runtime support cmlib expects from its host */
+
+VOID NTAPI
+RtlInitUnicodeString(
+    IN OUT PUNICODE_STRING DestinationString,
+    IN PCWSTR SourceString)
+{
+    SIZE_T Length = 0;
+
+    if (SourceString)
+    {
+        while (SourceString[Length])
+            Length++;
+    }
+
+    DestinationString->Length = (USHORT)(Length * sizeof(WCHAR));
+    DestinationString->MaximumLength = DestinationString->Length + sizeof(WCHAR);
+    DestinationString->Buffer = (PWCHAR)SourceString;
+}
+
+LONG NTAPI
+RtlCompareUnicodeString(
+    IN PCUNICODE_STRING String1,
+    IN PCUNICODE_STRING String2,
+    IN BOOLEAN CaseInSensitive)
+{
+    USHORT Length = min(String1->Length, String2->Length);
+    LONG Result = memcmp(String1->Buffer, String2->Buffer, Length);
+
+    if (Result == 0)
+        Result = (LONG)String1->Length - (LONG)String2->Length;
+
+    return Result;
+}
+
+WCHAR NTAPI
+RtlUpcaseUnicodeChar(
+    IN WCHAR Source)
+{
+    return (Source >= 'a' && Source <= 'z') ? Source - ('a' - 'A') : Source;
+}
+
+VOID NTAPI
+KeQuerySystemTime(
+    OUT PLARGE_INTEGER CurrentTime)
+{
+    CurrentTime->QuadPart = 0;
+}
+
+ULONG
+__cdecl
+DbgPrint(
+    IN CHAR *Format,
+    IN ...)
+{
+    return 0;
+}
+
+VOID
+NTAPI
+RtlAssert(IN PVOID FailedAssertion,
+          IN PVOID FileName,
+          IN ULONG LineNumber,
+          IN PCHAR Message OPTIONAL)
+{
+    printf("Assertion '%s' failed at %s line %u\n", (PCHAR)FailedAssertion, (PCHAR)FileName, LineNumber);
+    abort();
+}
+
+VOID
+NTAPI
+KeBugCheckEx(
+    IN ULONG BugCheckCode,
+    IN ULONG_PTR BugCheckParameter1,
+    IN ULONG_PTR BugCheckParameter2,
+    IN ULONG_PTR BugCheckParameter3,
+    IN ULONG_PTR BugCheckParameter4)
+{
+    printf("*** STOP: 0x%08X\n", BugCheckCode);
+    abort();
+}
+
+PVOID
+NTAPI
+CmpAllocate(
+    IN SIZE_T Size,
+    IN BOOLEAN Paged,
+    IN ULONG Tag)
+{
+    return malloc(Size);
+}
+
+VOID
+NTAPI
+CmpFree(
+    IN PVOID Ptr,
+    IN ULONG Quota)
+{
+    free(Ptr);
+}
+
+/* The hive only lives in memory */
+static
+BOOLEAN
+CMAPI
+HiveFileSetSize(
+    IN PHHIVE RegistryHive,
+    IN ULONG FileType,
+    IN ULONG FileSize,
+    IN ULONG OldFileSize)
+{
+    return TRUE;
+}
+
+static
+BOOLEAN
+CMAPI
+HiveFileWrite(
+    IN PHHIVE RegistryHive,
+    IN ULONG FileType,
+    IN PULONG FileOffset,
+    IN PVOID Buffer,
+    IN SIZE_T BufferLength)
+{
+    return TRUE;
+}
+
+static
+BOOLEAN
+CMAPI
+HiveFileRead(
+    IN PHHIVE RegistryHive,
+    IN ULONG FileType,
+    IN PULONG FileOffset,
+    OUT PVOID Buffer,
+    IN SIZE_T BufferLength)
+{
+    return FALSE;
+}
+
+static
+BOOLEAN
+CMAPI
+HiveFileFlush(
+    IN PHHIVE RegistryHive,
+    IN ULONG FileType,
+    IN PLARGE_INTEGER FileOffset,
+    IN ULONG Length)
+{
+    return TRUE;
+}
+
+unsigned char BitScanForward(ULONG * Index, unsigned long Mask)
+{
+    *Index = 0;
+    while (Mask && ((Mask & 1) == 0))
+    {
+        Mask >>= 1;
+        ++(*Index);
+    }
+    return Mask ? 1 : 0;
+}
+
+unsigned char BitScanReverse(ULONG * const Index, unsigned long Mask)
+{
+    *Index = 0;
+    while (Mask && ((Mask & (1 << 31)) == 0))
+    {
+        Mask <<= 1;
+        ++(*Index);
+    }
+    return Mask ? 1 : 0;
+}
+
+/* Mostly small values with now and then a big binary one, like real hives */
+static
+ULONG
+RandomDataLength(void)
+{
+    ULONG Class = Random() % 16;
+
+    if (Class < 10)
+        return 8 + Random() % 64;
+    if (Class < 15)
+        return 64 + Random() % 512;
+    return 512 + Random() % 8192;
+}
+
+static
+BOOLEAN
+CreateValue(
+    IN PHHIVE Hive,
+    IN HSTORAGE_TYPE Storage,
+    IN OUT PCHILD_LIST ValueList,
+    IN ULONG Number)
+{
+    HCELL_INDEX ValueCell, DataCell;
+    PCM_KEY_VALUE Value;
+    CHAR Name[16];
+    ULONG NameLength, DataLength;
+
+    NameLength = (ULONG)sprintf(Name, "Value%lu", (unsigned long)Number);
+    DataLength = RandomDataLength();
+
+    ValueCell = HvAllocateCell(Hive, FIELD_OFFSET(CM_KEY_VALUE, Name) + NameLength, Storage, HCELL_NIL);
+    if (ValueCell == HCELL_NIL)
+        return FALSE;
+
+    DataCell = HvAllocateCell(Hive, DataLength, Storage, ValueCell);
+    if (DataCell == HCELL_NIL)
+    {
+        HvFreeCell(Hive, ValueCell);
+        return FALSE;
+    }
+
+    memset(HvGetCell(Hive, DataCell), (int)Number, DataLength);
+
+    Value = (PCM_KEY_VALUE)HvGetCell(Hive, ValueCell);
+    Value->Signature = CM_KEY_VALUE_SIGNATURE;
+    Value->NameLength = (USHORT)NameLength;
+    Value->DataLength = DataLength;
+    Value->Data = DataCell;
+    Value->Type = REG_BINARY;
+    Value->Flags = VALUE_COMP_NAME;
+    memcpy(Value->Name, Name, NameLength);
+
+    return NT_SUCCESS(CmpAddValueToList(Hive, ValueCell, ValueList->Count, Storage, ValueList));
+}
+
+/* The last value takes the place of the deleted one, so the list doesn't move */
+static
+BOOLEAN
+DeleteValue(
+    IN PHHIVE Hive,
+    IN OUT PCHILD_LIST ValueList,
+    IN ULONG Index)
+{
+    PHCELL_INDEX List = (PHCELL_INDEX)HvGetCell(Hive, ValueList->List);
+    HCELL_INDEX ValueCell = List[Index];
+
+    List[Index] = List[ValueList->Count - 1];
+    List[ValueList->Count - 1] = ValueCell;
+
+    if (!CmpFreeValue(Hive, ValueCell))
+        return FALSE;
+
+    return NT_SUCCESS(CmpRemoveValueFromList(Hive, ValueList->Count - 1, ValueList));
+}
+
+static
+int
+RunBenchmark(
+    IN HSTORAGE_TYPE Storage,
+    IN ULONG Operations)
+{
+    CHILD_LIST ValueList = { 0, HCELL_NIL };
+    PHHIVE Hive;
+    NTSTATUS Status;
+    clock_t Start, Ticks;
+    ULONG i, Created = 0, Deleted = 0;
+    int Result = 0;
+
+    Hive = calloc(1, sizeof(HHIVE));
+    if (!Hive)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    Status = HvInitialize(Hive,
+                          HINIT_CREATE,
+                          HIVE_NOLAZYFLUSH,
+                          HFILE_TYPE_PRIMARY,
+                          NULL,
+                          CmpAllocate,
+                          CmpFree,
+                          HiveFileSetSize,
+                          HiveFileWrite,
+                          HiveFileRead,
+                          HiveFileFlush,
+                          1,
+                          NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        printf("HvInitialize failed with 0x%08x\n", Status);
+        free(Hive);
+        return 1;
+    }
+
+    Start = clock();
+    for (i = 0; i < Operations; i++)
+    {
+        if (ValueList.Count < LIVE_VALUES || (Random() & 1))
+        {
+            if (!CreateValue(Hive, Storage, &ValueList, i))
+            {
+                printf("Creating value %u failed\n", i);
+                Result = 1;
+                break;
+            }
+            Created++;
+        }
+        else
+        {
+            if (!DeleteValue(Hive, &ValueList, Random() % ValueList.Count))
+            {
+                printf("Deleting a value failed at operation %u\n", i);
+                Result = 1;
+                break;
+            }
+            Deleted++;
+        }
+
+        /* Keep the number of live values around the target */
+        if (ValueList.Count > 2 * LIVE_VALUES)
+        {
+            while (ValueList.Count > LIVE_VALUES)
+            {
+                DeleteValue(Hive, &ValueList, Random() % ValueList.Count);
+                Deleted++;
+            }
+        }
+    }
+    Ticks = clock() - Start;
+    if (!Ticks)
+        Ticks = 1;
+
+    printf("%-8s %8u creates %8u deletes %10.0f ops/s, hive is %u KB\n",
+           (Storage == Stable) ? "Stable" : "Volatile",
+           Created,
+           Deleted,
+           (double)(Created + Deleted) / ((double)Ticks / CLOCKS_PER_SEC),
+           Hive->Storage[Storage].Length * HBLOCK_SIZE / 1024);
+
+    HvFree(Hive);
+    free(Hive);
+    return Result;
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG Operations = DEFAULT_OPS;
+    int Result = 0;
+
+    if (argc > 2 || (argc == 2 && !(Operations = strtoul(argv[1], NULL, 0))))
+    {
+        printf("Measures hive cell allocation by creating and deleting values.\n"
+               "Syntax: hivebench [operations]\n");
+        return 1;
+    }
+
+    printf("%u operations, %u live values\n", Operations, LIVE_VALUES);
+
+    Result |= RunBenchmark(Stable, Operations);
+    Result |= RunBenchmark(Volatile, Operations);
+
+    return Result;
+}
@@ -0,0 +1,279 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Correctness test and benchmark for the tcpip route trie
+ * COPYRIGHT:   Copyright 2018 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <routetrie.h>
+
+#define ROUTE_COUNT     10000
+#define TEST_LOOKUPS    10000
+#define LINEAR_LOOKUPS  10000
+#define TRIE_LOOKUPS    10000000
+
+typedef struct _TEST_ROUTE
+{
+    LIST_ENTRY PrefixListEntry;
+    PROUTE_TRIE_NODE Node;
+    ULONG Network;
+    UINT Length;
+    BOOLEAN Present;
+} TEST_ROUTE, *PTEST_ROUTE;
+
+static TEST_ROUTE Routes[ROUTE_COUNT];
+static ROUTE_TRIE Trie;
+
+static ULONG Seed = 0x12345678;
+
+static
+ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+static
+ULONG
+Random32(void)
+{
+    return (Random() << 16) ^ Random();
+}
+
+static
+ULONG
+Mask(UINT Length)
+{
+    return Length ? 0xFFFFFFFF << (32 - Length) : 0;
+}
+
+/* What RouterGetRoute did before: look at every route */
+static
+UINT
+LinearLookup(ULONG Address, PULONG Network)
+{
+    UINT i, BestLength = 0;
+    BOOLEAN Found = FALSE;
+
+    for (i = 0; i < ROUTE_COUNT; i++)
+    {
+        if (!Routes[i].Present)
+            continue;
+
+        if ((Address & Mask(Routes[i].Length)) == Routes[i].Network &&
+            (!Found || Routes[i].Length > BestLength))
+        {
+            Found = TRUE;
+            BestLength = Routes[i].Length;
+            *Network = Routes[i].Network;
+        }
+    }
+
+    return Found ? BestLength : ~0U;
+}
+
+static
+UINT
+TrieLookup(ULONG Address, PULONG Network)
+{
+    PROUTE_TRIE_NODE Matches[ROUTE_TRIE_MAX_MATCHES];
+    UINT Count;
+
+    Count = RouteTrieLookup(&Trie, Address, Matches);
+    if (!Count)
+        return ~0U;
+
+    *Network = Matches[Count - 1]->Prefix;
+    return Matches[Count - 1]->PrefixLength;
+}
+
+static
+int
+AddRoute(PTEST_ROUTE Route)
+{
+    Route->Node = RouteTrieInsert(&Trie, Route->Network, Route->Length);
+    if (!Route->Node)
+        return 0;
+
+    InsertTailList(&Route->Node->Routes, &Route->PrefixListEntry);
+    Route->Present = TRUE;
+    return 1;
+}
+
+static
+void
+RemoveRoute(PTEST_ROUTE Route)
+{
+    RemoveEntryList(&Route->PrefixListEntry);
+    RouteTrieRemove(&Trie, Route->Node);
+    Route->Present = FALSE;
+}
+
+/* Addresses inside a route half of the time, so long prefixes get hit too */
+static
+ULONG
+RandomDestination(void)
+{
+    PTEST_ROUTE Route;
+
+    if (Random() & 1)
+        return Random32();
+
+    Route = &Routes[Random() % ROUTE_COUNT];
+    return Route->Network | (Random32() & ~Mask(Route->Length));
+}
+
+static
+int
+CheckLookups(const char *Phase)
+{
+    UINT i, Length, Expected;
+    ULONG Address, Network = 0, ExpectedNetwork = 0;
+    int Errors = 0;
+
+    for (i = 0; i < TEST_LOOKUPS; i++)
+    {
+        Address = RandomDestination();
+        Length = TrieLookup(Address, &Network);
+        Expected = LinearLookup(Address, &ExpectedNetwork);
+
+        if (Length != Expected || (Length != ~0U && Network != ExpectedNetwork))
+        {
+            if (Errors++ < 10)
+                printf("%s: mismatch for %08lx, /%d instead of /%d\n", Phase,
+                       (unsigned long)Address, (int)Length, (int)Expected);
+        }
+    }
+
+    return Errors;
+}
+
+static
+int
+TestCorrectness(void)
+{
+    UINT i, Length;
+    int Errors = 0;
+
+    RouteTrieInitialize(&Trie);
+
+    /* A default route, then prefixes of every length with a bias
+       towards the usual /16 to /24 */
+    Routes[0].Network = 0;
+    Routes[0].Length = 0;
+    for (i = 1; i < ROUTE_COUNT; i++)
+    {
+        Length = (Random() % 4) ? 16 + Random() % 9 : 1 + Random() % 32;
+        Routes[i].Length = Length;
+        Routes[i].Network = Random32() & Mask(Length);
+
+        /* Some nested prefixes */
+        if (i > 10 && Length > 8 && !(Random() % 8))
+        {
+            Routes[i].Network = (Routes[i - 10].Network & Mask(Routes[i - 10].Length)) |
+                                (Random32() & ~Mask(Routes[i - 10].Length));
+            Routes[i].Network &= Mask(Length);
+        }
+    }
+
+    for (i = 0; i < ROUTE_COUNT; i++)
+    {
+        if (!AddRoute(&Routes[i]))
+        {
+            printf("Out of memory\n");
+            return 1;
+        }
+    }
+
+    Errors += CheckLookups("Full table");
+
+    /* Remove every other route, including the default one */
+    for (i = 0; i < ROUTE_COUNT; i += 2)
+        RemoveRoute(&Routes[i]);
+
+    Errors += CheckLookups("Half table");
+
+    /* Put them back in reverse order */
+    for (i = ROUTE_COUNT; i >= 2; i -= 2)
+        AddRoute(&Routes[i - 2]);
+
+    Errors += CheckLookups("Refilled table");
+
+    /* Emptying the trie must free every node */
+    for (i = 0; i < ROUTE_COUNT; i++)
+        RemoveRoute(&Routes[i]);
+
+    if (Trie.Root)
+    {
+        printf("Trie not empty after removing all routes\n");
+        Errors++;
+    }
+
+    for (i = 0; i < ROUTE_COUNT; i++)
+        AddRoute(&Routes[i]);
+
+    return Errors;
+}
+
+static
+double
+Elapsed(clock_t Start)
+{
+    double Seconds = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+    return (Seconds > 0) ? Seconds : 1e-6;
+}
+
+static
+void
+Benchmark(void)
+{
+    static ULONG Destinations[4096];
+    ULONG Network, Sum = 0;
+    clock_t Start;
+    UINT i;
+
+    for (i = 0; i < 4096; i++)
+        Destinations[i] = RandomDestination();
+
+    printf("%u routes:\n", ROUTE_COUNT);
+
+    Start = clock();
+    for (i = 0; i < LINEAR_LOOKUPS; i++)
+        Sum += LinearLookup(Destinations[i % 4096], &Network);
+    printf("  %-10s %10.0f lookups/s\n", "linear", LINEAR_LOOKUPS / Elapsed(Start));
+
+    Start = clock();
+    for (i = 0; i < TRIE_LOOKUPS; i++)
+        Sum += TrieLookup(Destinations[i % 4096], &Network);
+    printf("  %-10s %10.0f lookups/s\n", "trie", TRIE_LOOKUPS / Elapsed(Start));
+
+    /* Keep the lookups from being optimized away */
+    if (Sum == 0x12345678)
+        printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int Errors;
+
+    Errors = TestCorrectness();
+    printf("Correctness: %s\n", Errors ? "FAILED" : "passed");
+    if (Errors)
+        return 1;
+
+    if (argc > 1 && strcmp(argv[1], "-q") == 0)
+        return 0;
+
+    /* The old code also called CommonPrefixLength and AddrCountPrefixBits
+       for every route, so the real gain is larger */
+    Benchmark();
+
+    return 0;
+}
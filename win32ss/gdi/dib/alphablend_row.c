@@ -0,0 +1,314 @@
+/*
+ * PROJECT:         Win32 subsystem
+ * LICENSE:         See COPYING in the top level directory
+ * FILE:            win32ss/gdi/dib/alphablend_row.c
+ * PURPOSE:         AlphaBlend row kernels for unstretched 32bpp sources
+ * PROGRAMMERS:     ReactOS Team
+ */
+
+#ifndef ALPHABLEND_HOST
+#include <win32k.h>
+
+#define NDEBUG
+#include <debug.h>
+#endif
+
+#include "alphablend_row.h"
+
+#ifdef ALPHABLEND_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Without SSE2, the 32bpp kernel works on two channels at once. It also
+ * blends the pixels at the end of SSE2 rows. A pixel is split into its
+ * red/blue and green/alpha bytes, each in a 16 bit lane of a ULONG.
+ * A lane holds at most 255 * 255, so neither the products nor the
+ * division below carry into the next lane.
+ */
+#define LANE_MASK 0x00FF00FF
+
+/* (Lanes * Alpha) / 255 for each lane, rounded down like the per pixel code */
+FORCEINLINE
+ULONG
+MulDiv255Lanes(ULONG Lanes, ULONG Alpha)
+{
+  Lanes *= Alpha;
+  return ((Lanes + 0x00010001 + ((Lanes >> 8) & LANE_MASK)) >> 8) & LANE_MASK;
+}
+
+/* Lane1 + Lane2 for each lane, clamped to 255 */
+FORCEINLINE
+ULONG
+AddClampLanes(ULONG Lanes1, ULONG Lanes2)
+{
+  ULONG Sum = Lanes1 + Lanes2;
+  ULONG Carry = Sum & 0x01000100;
+
+  return (Sum | (Carry - (Carry >> 8))) & LANE_MASK;
+}
+
+FORCEINLINE
+ULONG
+BlendPixel32(ULONG Dst, ULONG Src, ULONG ConstAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG SrcRB, SrcGA, DstRB, DstGA, Alpha;
+
+  SrcRB = Src & LANE_MASK;
+  SrcGA = (Src >> 8) & LANE_MASK;
+  if (ConstAlpha != 255)
+  {
+    SrcRB = MulDiv255Lanes(SrcRB, ConstAlpha);
+    SrcGA = MulDiv255Lanes(SrcGA, ConstAlpha);
+  }
+
+  Alpha = PerPixelAlpha ? (SrcGA >> 16) : ConstAlpha;
+
+  /* Opaque and fully transparent pixels are the common case */
+  if (Alpha == 255)
+    return SrcRB | (SrcGA << 8);
+  if (PerPixelAlpha && (SrcRB | SrcGA) == 0)
+    return Dst;
+
+  DstRB = MulDiv255Lanes(Dst & LANE_MASK, 255 - Alpha);
+  DstGA = MulDiv255Lanes((Dst >> 8) & LANE_MASK, 255 - Alpha);
+
+  return AddClampLanes(DstRB, SrcRB) | (AddClampLanes(DstGA, SrcGA) << 8);
+}
+
+#ifdef ALPHABLEND_SSE2
+
+/*
+ * The SSE2 kernel widens the channels to 16 bit lanes, two pixels per
+ * register, and uses the same division as MulDiv255Lanes. The unsigned
+ * saturation of the final pack does the clamping.
+ */
+FORCEINLINE
+__m128i
+MulDiv255Epi16(__m128i Lanes, __m128i Alpha)
+{
+  Lanes = _mm_mullo_epi16(Lanes, Alpha);
+  Lanes = _mm_add_epi16(Lanes, _mm_add_epi16(_mm_srli_epi16(Lanes, 8), _mm_set1_epi16(1)));
+  return _mm_srli_epi16(Lanes, 8);
+}
+
+FORCEINLINE
+__m128i
+BlendPixels2(__m128i Dst, __m128i Src, __m128i ConstAlpha, BOOLEAN Scale, BOOLEAN PerPixelAlpha)
+{
+  __m128i Alpha;
+
+  if (Scale)
+    Src = MulDiv255Epi16(Src, ConstAlpha);
+
+  if (PerPixelAlpha)
+  {
+    Alpha = _mm_shufflelo_epi16(Src, _MM_SHUFFLE(3, 3, 3, 3));
+    Alpha = _mm_shufflehi_epi16(Alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  else
+  {
+    Alpha = ConstAlpha;
+  }
+
+  Dst = MulDiv255Epi16(Dst, _mm_sub_epi16(_mm_set1_epi16(255), Alpha));
+  return _mm_add_epi16(Dst, Src);
+}
+
+FORCEINLINE
+VOID
+BlendRow32Sse2(ULONG *Dst, const ULONG *Src, ULONG Count, ULONG ConstAlpha, BOOLEAN PerPixelAlpha)
+{
+  const __m128i Zero = _mm_setzero_si128();
+  const __m128i AlphaMask = _mm_set1_epi32(0xFF000000);
+  const __m128i Alpha = _mm_set1_epi16((SHORT)ConstAlpha);
+  const BOOLEAN Scale = (ConstAlpha != 255);
+  __m128i SrcPixels, DstPixels, Low, High;
+
+  for (; Count >= 4; Count -= 4, Src += 4, Dst += 4)
+  {
+    SrcPixels = _mm_loadu_si128((const __m128i *)Src);
+
+    /* Skip runs of fully transparent pixels and copy runs of opaque ones */
+    if (PerPixelAlpha)
+    {
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(SrcPixels, Zero)) == 0xFFFF)
+        continue;
+      if (!Scale &&
+          _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(SrcPixels, AlphaMask), AlphaMask)) == 0xFFFF)
+      {
+        _mm_storeu_si128((__m128i *)Dst, SrcPixels);
+        continue;
+      }
+    }
+
+    DstPixels = _mm_loadu_si128((const __m128i *)Dst);
+
+    Low = BlendPixels2(_mm_unpacklo_epi8(DstPixels, Zero), _mm_unpacklo_epi8(SrcPixels, Zero),
+                       Alpha, Scale, PerPixelAlpha);
+    High = BlendPixels2(_mm_unpackhi_epi8(DstPixels, Zero), _mm_unpackhi_epi8(SrcPixels, Zero),
+                        Alpha, Scale, PerPixelAlpha);
+
+    _mm_storeu_si128((__m128i *)Dst, _mm_packus_epi16(Low, High));
+  }
+
+  while (Count--)
+  {
+    *Dst = BlendPixel32(*Dst, *Src++, ConstAlpha, PerPixelAlpha);
+    Dst++;
+  }
+}
+
+#endif /* ALPHABLEND_SSE2 */
+
+VOID
+DIB_32BPP_AlphaBlendRow(ULONG *Dst, const ULONG *Src, ULONG Count,
+                        UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG ConstAlpha = SourceConstantAlpha;
+
+#ifdef ALPHABLEND_SSE2
+  if (PerPixelAlpha)
+    BlendRow32Sse2(Dst, Src, Count, ConstAlpha, TRUE);
+  else
+    BlendRow32Sse2(Dst, Src, Count, ConstAlpha, FALSE);
+#else
+  /* Keep the alpha test out of the loop */
+  if (PerPixelAlpha)
+  {
+    while (Count--)
+    {
+      *Dst = BlendPixel32(*Dst, *Src++, ConstAlpha, TRUE);
+      Dst++;
+    }
+  }
+  else
+  {
+    while (Count--)
+    {
+      *Dst = BlendPixel32(*Dst, *Src++, ConstAlpha, FALSE);
+      Dst++;
+    }
+  }
+#endif
+}
+
+/* 24bpp pixels straddle ULONGs, so they are blended a byte at a time */
+FORCEINLINE
+UCHAR
+BlendChannel24(ULONG Dst, ULONG Src, ULONG InverseAlpha)
+{
+  ULONG Value = (Dst * InverseAlpha) / 255 + Src;
+
+  return (UCHAR)((Value > 255) ? 255 : Value);
+}
+
+VOID
+DIB_24BPP_AlphaBlendRow(UCHAR *Dst, const ULONG *Src, ULONG Count,
+                        UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG ConstAlpha = SourceConstantAlpha;
+  ULONG Pixel, Red, Green, Blue, Alpha;
+
+  for (; Count--; Dst += 3)
+  {
+    Pixel = *Src++;
+    Red = Pixel & 0xFF;
+    Green = (Pixel >> 8) & 0xFF;
+    Blue = (Pixel >> 16) & 0xFF;
+    if (ConstAlpha != 255)
+    {
+      Red = (Red * ConstAlpha) / 255;
+      Green = (Green * ConstAlpha) / 255;
+      Blue = (Blue * ConstAlpha) / 255;
+    }
+
+    Alpha = PerPixelAlpha ? ((Pixel >> 24) * ConstAlpha) / 255 : ConstAlpha;
+    if (Alpha == 255)
+    {
+      Dst[0] = (UCHAR)Red;
+      Dst[1] = (UCHAR)Green;
+      Dst[2] = (UCHAR)Blue;
+      continue;
+    }
+    if (Alpha == 0 && (Red | Green | Blue) == 0)
+      continue;
+
+    Dst[0] = BlendChannel24(Dst[0], Red, 255 - Alpha);
+    Dst[1] = BlendChannel24(Dst[1], Green, 255 - Alpha);
+    Dst[2] = BlendChannel24(Dst[2], Blue, 255 - Alpha);
+  }
+}
+
+/*
+ * 16bpp surfaces are blended at their own precision, like the per pixel
+ * code does. Only the 8 bit to 5 or 6 bit conversions are shared.
+ */
+FORCEINLINE
+ULONG
+Clamp16(ULONG Value, ULONG Max)
+{
+  return (Value > Max) ? Max : Value;
+}
+
+FORCEINLINE
+ULONG
+ScaleSource16(ULONG Src, ULONG ConstAlpha, BOOLEAN PerPixelAlpha,
+              ULONG *Red, ULONG *Green, ULONG *Blue)
+{
+  *Red = Src & 0xFF;
+  *Green = (Src >> 8) & 0xFF;
+  *Blue = (Src >> 16) & 0xFF;
+  if (ConstAlpha != 255)
+  {
+    *Red = (*Red * ConstAlpha) / 255;
+    *Green = (*Green * ConstAlpha) / 255;
+    *Blue = (*Blue * ConstAlpha) / 255;
+  }
+
+  return PerPixelAlpha ? ((Src >> 24) * ConstAlpha) / 255 : ConstAlpha;
+}
+
+VOID
+DIB_16BPP_AlphaBlendRow565(USHORT *Dst, const ULONG *Src, ULONG Count,
+                           UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG ConstAlpha = SourceConstantAlpha;
+  ULONG Red, Green, Blue, Alpha5, Alpha6, Alpha, Pixel;
+
+  while (Count--)
+  {
+    Alpha = ScaleSource16(*Src++, ConstAlpha, PerPixelAlpha, &Red, &Green, &Blue);
+    Alpha6 = Alpha >> 2;
+    Alpha5 = Alpha >> 3;
+
+    Pixel = *Dst;
+    Red = Clamp16((((Pixel >> 11) & 0x1F) * (31 - Alpha5)) / 31 + (Red >> 3), 31);
+    Green = Clamp16((((Pixel >> 5) & 0x3F) * (63 - Alpha6)) / 63 + (Green >> 2), 63);
+    Blue = Clamp16(((Pixel & 0x1F) * (31 - Alpha5)) / 31 + (Blue >> 3), 31);
+    *Dst++ = (USHORT)((Red << 11) | (Green << 5) | Blue);
+  }
+}
+
+VOID
+DIB_16BPP_AlphaBlendRow555(USHORT *Dst, const ULONG *Src, ULONG Count,
+                           UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG ConstAlpha = SourceConstantAlpha;
+  ULONG Red, Green, Blue, Alpha, Pixel;
+
+  while (Count--)
+  {
+    Alpha = ScaleSource16(*Src++, ConstAlpha, PerPixelAlpha, &Red, &Green, &Blue);
+    Alpha >>= 3;
+
+    /* The unused top bit is kept */
+    Pixel = *Dst;
+    Red = Clamp16((((Pixel >> 10) & 0x1F) * (31 - Alpha)) / 31 + (Red >> 3), 31);
+    Green = Clamp16((((Pixel >> 5) & 0x1F) * (31 - Alpha)) / 31 + (Green >> 3), 31);
+    Blue = Clamp16(((Pixel & 0x1F) * (31 - Alpha)) / 31 + (Blue >> 3), 31);
+    *Dst++ = (USHORT)((Pixel & 0x8000) | (Red << 10) | (Green << 5) | Blue);
+  }
+}
+
+/* EOF */
@@ -0,0 +1,61 @@
+/*
+ * PROJECT:         Win32 subsystem
+ * LICENSE:         See COPYING in the top level directory
+ * FILE:            win32ss/gdi/dib/alphablend_row.h
+ * PURPOSE:         AlphaBlend row kernels for unstretched 32bpp sources
+ * PROGRAMMERS:     ReactOS Team
+ */
+
+#pragma once
+
+#ifdef ALPHABLEND_HOST
+
+/* The kernels are also built into a host test */
+#include <typedefs.h>
+
+#ifndef FORCEINLINE
+#define FORCEINLINE static __inline
+#endif
+
+#endif /* ALPHABLEND_HOST */
+
+/* SSE2 is part of the amd64 baseline. On i386 it would need the FPU state
+ * saved and restored around every blend, so the integer kernels are used */
+#if defined(_M_AMD64) || (defined(ALPHABLEND_HOST) && defined(__x86_64__))
+#define ALPHABLEND_SSE2
+#endif
+
+/* Only the SSE2 32bpp kernel is faster than the per pixel code for constant
+ * alpha. Without it, DIB_32BPP_AlphaBlend takes the row path for AC_SRC_ALPHA */
+#ifdef ALPHABLEND_SSE2
+#define ALPHABLEND_ROW_CONSTANT_ALPHA TRUE
+#else
+#define ALPHABLEND_ROW_CONSTANT_ALPHA FALSE
+#endif
+
+/*
+ * All kernels blend Count pixels of a 32bpp source row over a destination
+ * row, with the same results as the per pixel code in the DIB_XXBPP_AlphaBlend
+ * functions. PerPixelAlpha is TRUE for AC_SRC_ALPHA.
+ *
+ * For 32bpp and 24bpp destinations, the source must already be in the
+ * destination color format. For 16bpp destinations, it must be in the
+ * gpalRGB format.
+ */
+VOID
+DIB_32BPP_AlphaBlendRow(ULONG *Dst, const ULONG *Src, ULONG Count,
+                        UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha);
+
+VOID
+DIB_24BPP_AlphaBlendRow(UCHAR *Dst, const ULONG *Src, ULONG Count,
+                        UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha);
+
+VOID
+DIB_16BPP_AlphaBlendRow565(USHORT *Dst, const ULONG *Src, ULONG Count,
+                           UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha);
+
+VOID
+DIB_16BPP_AlphaBlendRow555(USHORT *Dst, const ULONG *Src, ULONG Count,
+                           UCHAR SourceConstantAlpha, BOOLEAN PerPixelAlpha);
+
+/* EOF */
@@ -142,7 +142,9 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
   LONG     i, j, sx, sy, xColor, f1;
   PBYTE    SourceBits, DestBits, SourceLine, DestLine;
   PBYTE    SourceBits_4BPP, SourceLine_4BPP;
+  ULONG    Buffer[64], Width, Count, k;
   DestBits = (PBYTE)BltInfo->DestSurface->pvScan0 + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta) + 2 * BltInfo->DestRect.left;
+  Width = BltInfo->DestRect.right - BltInfo->DestRect.left;
 
   switch(BltInfo->SourceSurface->iBitmapFormat)
   {
@@ -345,16 +347,24 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      /* Translate the line in spans */
+      for (i = 0; i < (LONG)Width; i += Count)
       {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) + (*(SourceBits));
+        Count = min(Width - i, (ULONG)RTL_NUMBER_OF(Buffer));
+        for (k = 0; k < Count; k++)
+        {
+          Buffer[k] = (*(SourceBits + 2) << 0x10) +
+            (*(SourceBits + 1) << 0x08) + (*(SourceBits));
+          SourceBits += 3;
+        }
 
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, xColor);
+        XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, Buffer, Buffer, Count);
 
-        SourceBits += 3;
-        DestBits += 2;
+        for (k = 0; k < Count; k++)
+        {
+          *((WORD *)DestBits) = (WORD)Buffer[k];
+          DestBits += 2;
+        }
       }
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -373,13 +383,19 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      /* Translate the line in spans */
+      for (i = 0; i < (LONG)Width; i += Count)
       {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest,
-          *((PDWORD) SourceBits));
-        SourceBits += 4;
-        DestBits += 2;
+        Count = min(Width - i, (ULONG)RTL_NUMBER_OF(Buffer));
+        XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, Buffer,
+          (PULONG)SourceBits, Count);
+        SourceBits += 4 * Count;
+
+        for (k = 0; k < Count; k++)
+        {
+          *((WORD *)DestBits) = (WORD)Buffer[k];
+          DestBits += 2;
+        }
       }
 
       SourceLine += BltInfo->SourceSurface->lDelta;
@@ -620,7 +636,48 @@ DIB_16BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
   pexlo = CONTAINING_RECORD(ColorTranslation, EXLATEOBJ, xlo);
   EXLATEOBJ_vInitialize(&exloSrcRGB, pexlo->ppalSrc, &gpalRGB, 0, 0, 0);
 
-  if (pexlo->ppalDst->flFlags & PAL_RGB16_555)
+  /* Unstretched 32bpp sources are translated and blended a row at a time */
+  if (BitsPerFormat(Source->iBitmapFormat) == 32 &&
+      SourceRect->right - SourceRect->left == DestRect->right - DestRect->left &&
+      SourceRect->bottom - SourceRect->top == DestRect->bottom - DestRect->top)
+  {
+    ULONG Buffer[64];
+    PULONG SrcLine, Src;
+    PUSHORT DstLine;
+    ULONG Width = DestRect->right - DestRect->left;
+    ULONG Count;
+
+    SrcY = SourceRect->top;
+    for (DstY = DestRect->top; DstY < DestRect->bottom; DstY++, SrcY++)
+    {
+      SrcLine = (PULONG)((ULONG_PTR)Source->pvScan0 + SrcY * Source->lDelta) + SourceRect->left;
+      DstLine = (PUSHORT)((ULONG_PTR)Dest->pvScan0 + DstY * Dest->lDelta) + DestRect->left;
+
+      for (DstX = 0; DstX < (INT)Width; DstX += Count)
+      {
+        Count = min(Width - DstX, (ULONG)RTL_NUMBER_OF(Buffer));
+        if (exloSrcRGB.xlo.flXlate & XO_TRIVIAL)
+        {
+          Src = SrcLine + DstX;
+        }
+        else
+        {
+          XLATEOBJ_vXlateSpan(&exloSrcRGB.xlo, Buffer, SrcLine + DstX, Count);
+          Src = Buffer;
+        }
+
+        if (pexlo->ppalDst->flFlags & PAL_RGB16_555)
+          DIB_16BPP_AlphaBlendRow555(DstLine + DstX, Src, Count,
+                                     BlendFunc.SourceConstantAlpha,
+                                     (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0);
+        else
+          DIB_16BPP_AlphaBlendRow565(DstLine + DstX, Src, Count,
+                                     BlendFunc.SourceConstantAlpha,
+                                     (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0);
+      }
+    }
+  }
+  else if (pexlo->ppalDst->flFlags & PAL_RGB16_555)
   {
       NICEPIXEL16_555 DstPixel16;
 
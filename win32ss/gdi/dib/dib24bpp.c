@@ -503,6 +503,28 @@ DIB_24BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                              (DestRect->left * 3));
    //SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
+   /* Unstretched 32bpp sources that need no translation are blended a row at a time.
+      With a constant alpha below 255 that is no faster than the code below */
+   if (BlendFunc.SourceConstantAlpha == 255 &&
+       BitsPerFormat(Source->iBitmapFormat) == 32 &&
+       SourceRect->right - SourceRect->left == DestRect->right - DestRect->left &&
+       SourceRect->bottom - SourceRect->top == DestRect->bottom - DestRect->top &&
+       (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL)))
+   {
+      PULONG Src = (PULONG)((ULONG_PTR)Source->pvScan0 + (SourceRect->top * Source->lDelta) +
+                            (SourceRect->left << 2));
+
+      for (Rows = DestRect->top; Rows < DestRect->bottom; Rows++)
+      {
+         DIB_24BPP_AlphaBlendRow(Dst, Src, DestRect->right - DestRect->left,
+                                 BlendFunc.SourceConstantAlpha,
+                                 (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0);
+         Dst += Dest->lDelta;
+         Src = (PULONG)((ULONG_PTR)Src + Source->lDelta);
+      }
+      return TRUE;
+   }
+
    Rows = 0;
    SrcY = SourceRect->top;
    while (++Rows <= DestRect->bottom - DestRect->top)
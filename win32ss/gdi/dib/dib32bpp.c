@@ -53,6 +53,7 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
   PBYTE    SourceBits, DestBits, SourceLine, DestLine;
   PBYTE    SourceBits_4BPP, SourceLine_4BPP;
   PDWORD   Source32, Dest32;
+  ULONG    Width = BltInfo->DestRect.right - BltInfo->DestRect.left;
 
   DestBits = (PBYTE)BltInfo->DestSurface->pvScan0
     + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta)
@@ -120,13 +121,10 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *SourceBits;
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 1;
-        DestBits += 4;
-      }
+      /* Widen the line into the destination, then translate it there */
+      for (i = 0; i < (LONG)Width; i++)
+        ((PDWORD)DestBits)[i] = SourceBits[i];
+      XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits, Width);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -142,13 +140,10 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *((PWORD) SourceBits);
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 2;
-        DestBits += 4;
-      }
+      /* Widen the line into the destination, then translate it there */
+      for (i = 0; i < (LONG)Width; i++)
+        ((PDWORD)DestBits)[i] = ((PWORD)SourceBits)[i];
+      XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits, Width);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -166,15 +161,15 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      /* Widen the line into the destination, then translate it there */
+      for (i = 0; i < (LONG)Width; i++)
       {
-        xColor = (*(SourceBits + 2) << 0x10) +
+        ((PDWORD)DestBits)[i] = (*(SourceBits + 2) << 0x10) +
           (*(SourceBits + 1) << 0x08) +
           (*(SourceBits));
-        *((PDWORD)DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
         SourceBits += 3;
-        DestBits += 4;
       }
+      XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits, Width);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -220,12 +215,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         {
           if (BltInfo->DestRect.left < BltInfo->SourcePoint.x)
           {
-            Dest32 = (DWORD *) DestBits;
-            Source32 = (DWORD *) SourceBits;
-            for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-            {
-              *Dest32++ = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32++);
-            }
+            /* Translating forward never overwrites unread source pixels */
+            XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)SourceBits, Width);
           }
           else
           {
@@ -248,12 +239,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         {
           if (BltInfo->DestRect.left < BltInfo->SourcePoint.x)
           {
-            Dest32 = (DWORD *) DestBits;
-            Source32 = (DWORD *) SourceBits;
-            for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-            {
-              *Dest32++ = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32++);
-            }
+            /* Translating forward never overwrites unread source pixels */
+            XLATEOBJ_vXlateSpan(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)SourceBits, Width);
           }
           else
           {
@@ -383,6 +370,27 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     (DestRect->left << 2));
   SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
+  /* Unstretched 32bpp sources that need no translation are blended a row at a time */
+  if (SrcBpp == 32 &&
+      ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) || ALPHABLEND_ROW_CONSTANT_ALPHA) &&
+      SourceRect->right - SourceRect->left == DestRect->right - DestRect->left &&
+      SourceRect->bottom - SourceRect->top == DestRect->bottom - DestRect->top &&
+      (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL)))
+  {
+    PULONG Src = (PULONG)((ULONG_PTR)Source->pvScan0 + (SourceRect->top * Source->lDelta) +
+      (SourceRect->left << 2));
+
+    for (Rows = DestRect->top; Rows < DestRect->bottom; Rows++)
+    {
+      DIB_32BPP_AlphaBlendRow(Dst, Src, DestRect->right - DestRect->left,
+                              BlendFunc.SourceConstantAlpha,
+                              (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0);
+      Dst = (PULONG)((ULONG_PTR)Dst + Dest->lDelta);
+      Src = (PULONG)((ULONG_PTR)Src + Source->lDelta);
+    }
+    return TRUE;
+  }
+
   Rows = 0;
    SrcY = SourceRect->top;
    while (++Rows <= DestRect->bottom - DestRect->top)
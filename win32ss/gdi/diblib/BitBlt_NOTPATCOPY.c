@@ -12,8 +12,6 @@
 
 #include "DibLib_AllDstBPP.h"
 
-extern PFN_DIBFUNCTION gapfnBitBlt_PATCOPY_Solid[];
-
 VOID
 FASTCALL
 Dib_BitBlt_NOTPATCOPY(PBLTDATA pBltData)
@@ -25,7 +23,7 @@ Dib_BitBlt_NOTPATCOPY(PBLTDATA pBltData)
         pBltData->ulSolidColor = ~pBltData->ulSolidColor;
 
         /* Use the solid version of PATCOPY! */
-        gapfnBitBlt_PATCOPY_Solid[pBltData->siDst.iFormat](pBltData);
+        Dib_BitBlt_SOLIDFILL(pBltData);
     }
     else
     {
@@ -25,7 +25,7 @@ Dib_BitBlt_PATCOPY(PBLTDATA pBltData)
     if (pBltData->ulSolidColor != 0xFFFFFFFF)
     {
         /* Use the solid version of PATCOPY! */
-        gapfnBitBlt_PATCOPY_Solid[pBltData->siDst.iFormat](pBltData);
+        Dib_BitBlt_SOLIDFILL(pBltData);
     }
     else
     {
@@ -0,0 +1,116 @@
+
+#include "DibLib.h"
+
+#ifdef _M_AMD64
+#include <emmintrin.h>
+#endif
+
+/*
+ * Without color translation, ROPs that only combine source and dest bits
+ * don't care where one pixel ends and the next begins. These functions
+ * work on whole machine words instead of pixels, and on amd64, where SSE2
+ * is always there and needs no FPU state saving, on 16 byte vectors.
+ */
+
+#define WORD_MASK (sizeof(ULONG_PTR) - 1)
+
+#ifdef _M_AMD64
+
+#define VEC_XOR(px, x) _mm_xor_si128(_mm_loadu_si128(px), x)
+#define VEC_AND(px, x) _mm_and_si128(_mm_loadu_si128(px), x)
+
+/* Unaligned accesses cost less than aligning narrow rows first */
+#define ROW_VECTOR_LOOP(vecop) \
+    while (cjWidth >= 4 * sizeof(__m128i)) \
+    { \
+        __m128i x0 = _mm_loadu_si128((__m128i*)pjSource + 0); \
+        __m128i x1 = _mm_loadu_si128((__m128i*)pjSource + 1); \
+        __m128i x2 = _mm_loadu_si128((__m128i*)pjSource + 2); \
+        __m128i x3 = _mm_loadu_si128((__m128i*)pjSource + 3); \
+        _mm_storeu_si128((__m128i*)pjDest + 0, vecop((__m128i*)pjDest + 0, x0)); \
+        _mm_storeu_si128((__m128i*)pjDest + 1, vecop((__m128i*)pjDest + 1, x1)); \
+        _mm_storeu_si128((__m128i*)pjDest + 2, vecop((__m128i*)pjDest + 2, x2)); \
+        _mm_storeu_si128((__m128i*)pjDest + 3, vecop((__m128i*)pjDest + 3, x3)); \
+        pjDest += 4 * sizeof(__m128i); \
+        pjSource += 4 * sizeof(__m128i); \
+        cjWidth -= 4 * sizeof(__m128i); \
+    }
+
+#else
+
+#define ROW_VECTOR_LOOP(vecop)
+
+#endif
+
+#define DEFINE_ROW_FUNCTION(name, op, vecop) \
+static \
+VOID \
+name(PBYTE pjDest, PBYTE pjSource, ULONG cjWidth) \
+{ \
+    ROW_VECTOR_LOOP(vecop) \
+\
+    /* Go bytewise until the target is aligned */ \
+    while (cjWidth && ((ULONG_PTR)pjDest & WORD_MASK)) \
+    { \
+        *pjDest++ op *pjSource++; \
+        cjWidth--; \
+    } \
+\
+    /* Both must be aligned for word access */ \
+    if (!((ULONG_PTR)pjSource & WORD_MASK)) \
+    { \
+        while (cjWidth >= 4 * sizeof(ULONG_PTR)) \
+        { \
+            ((PULONG_PTR)pjDest)[0] op ((PULONG_PTR)pjSource)[0]; \
+            ((PULONG_PTR)pjDest)[1] op ((PULONG_PTR)pjSource)[1]; \
+            ((PULONG_PTR)pjDest)[2] op ((PULONG_PTR)pjSource)[2]; \
+            ((PULONG_PTR)pjDest)[3] op ((PULONG_PTR)pjSource)[3]; \
+            pjDest += 4 * sizeof(ULONG_PTR); \
+            pjSource += 4 * sizeof(ULONG_PTR); \
+            cjWidth -= 4 * sizeof(ULONG_PTR); \
+        } \
+\
+        while (cjWidth >= sizeof(ULONG_PTR)) \
+        { \
+            *(PULONG_PTR)pjDest op *(PULONG_PTR)pjSource; \
+            pjDest += sizeof(ULONG_PTR); \
+            pjSource += sizeof(ULONG_PTR); \
+            cjWidth -= sizeof(ULONG_PTR); \
+        } \
+    } \
+\
+    /* Do the rest bytewise */ \
+    while (cjWidth--) \
+    { \
+        *pjDest++ op *pjSource++; \
+    } \
+}
+
+DEFINE_ROW_FUNCTION(XorRow, ^=, VEC_XOR)
+DEFINE_ROW_FUNCTION(AndRow, &=, VEC_AND)
+
+#define DEFINE_ROWBLT_FUNCTION(name, rowfunction) \
+VOID \
+FASTCALL \
+name(PBLTDATA pBltData) \
+{ \
+    ULONG cLines, cjWidth; \
+    PBYTE pjDestBase = pBltData->siDst.pjBase; \
+    PBYTE pjSrcBase = pBltData->siSrc.pjBase; \
+\
+    /* Calculate the width in bytes */ \
+    cjWidth = pBltData->ulWidth * pBltData->siDst.jBpp / 8; \
+\
+    /* Loop all lines */ \
+    cLines = pBltData->ulHeight; \
+    while (cLines--) \
+    { \
+        rowfunction(pjDestBase, pjSrcBase, cjWidth); \
+        pjDestBase += pBltData->siDst.cjAdvanceY; \
+        pjSrcBase += pBltData->siSrc.cjAdvanceY; \
+    } \
+}
+
+DEFINE_ROWBLT_FUNCTION(Dib_RowBlt_SRCINVERT, XorRow)
+DEFINE_ROWBLT_FUNCTION(Dib_RowBlt_SRCAND, AndRow)
+
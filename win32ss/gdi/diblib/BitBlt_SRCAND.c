@@ -16,7 +16,17 @@ VOID
 FASTCALL
 Dib_BitBlt_SRCAND(PBLTDATA pBltData)
 {
-    // TODO: XLATEless same-surface variants
+    /* Check if we can skip the color translation */
+    if (_DibIsUntranslated(pBltData))
+    {
+        /* Whole bytes can be combined directly */
+        if (pBltData->siDst.iFormat >= BMF_8BPP)
+            Dib_RowBlt_SRCAND(pBltData);
+        else
+            gapfnBitBlt_SRCAND[pBltData->siDst.iFormat][0](pBltData);
+        return;
+    }
+
     gapfnBitBlt_SRCAND[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
 }
 
@@ -69,6 +69,13 @@ VOID
 FASTCALL
 Dib_BitBlt_SRCCOPY(PBLTDATA pBltData)
 {
+    /* Use the plain copy functions when no color translation is needed */
+    if (_DibIsUntranslated(pBltData))
+    {
+        gapfnBitBlt_SRCCOPY[pBltData->siDst.iFormat][0](pBltData);
+        return;
+    }
+
     gapfnBitBlt_SRCCOPY[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
 }
 
@@ -1,15 +1,144 @@
 
 #include "DibLib.h"
 
+#ifdef _M_AMD64
+#include <emmintrin.h>
+#endif
+
 extern PFN_DIBFUNCTION gapfnBitBlt_PATCOPY_Solid[];
 
+/* Fills a row with a 12 byte pattern, which is given at least twice */
+static
+VOID
+FillRow(PBYTE pjDest, const BYTE *pjPattern, ULONG cjWidth)
+{
+    ULONG aulPattern[3];
+    PBYTE pjRotated = (PBYTE)aulPattern;
+    ULONG i, j;
+
+    /* Go bytewise until the target is DWORD aligned */
+    for (i = 0; cjWidth && ((ULONG_PTR)pjDest & 3); i++, cjWidth--)
+        *pjDest++ = pjPattern[i];
+
+    /* Continue the pattern from here */
+    for (j = 0; j < sizeof(aulPattern); j++)
+        pjRotated[j] = pjPattern[i + j];
+
+    while (cjWidth >= sizeof(aulPattern))
+    {
+        ((PULONG)pjDest)[0] = aulPattern[0];
+        ((PULONG)pjDest)[1] = aulPattern[1];
+        ((PULONG)pjDest)[2] = aulPattern[2];
+        pjDest += sizeof(aulPattern);
+        cjWidth -= sizeof(aulPattern);
+    }
+
+    for (j = 0; j < cjWidth; j++)
+        pjDest[j] = pjRotated[j];
+}
+
+#ifdef _M_AMD64
+
+/* The pattern repeats every 48 bytes in vectors */
+#define FILL_PATTERN_ULONGS 12
+
+/* Like FillRow, with unaligned stores, which cost less than aligning */
+static
+VOID
+FillRowSse2(PBYTE pjDest, const BYTE *pjPattern, ULONG cjWidth)
+{
+    __m128i x0, x1, x2;
+
+    x0 = _mm_loadu_si128((const __m128i*)pjPattern + 0);
+    x1 = _mm_loadu_si128((const __m128i*)pjPattern + 1);
+    x2 = _mm_loadu_si128((const __m128i*)pjPattern + 2);
+
+    while (cjWidth >= 3 * sizeof(__m128i))
+    {
+        _mm_storeu_si128((__m128i*)pjDest + 0, x0);
+        _mm_storeu_si128((__m128i*)pjDest + 1, x1);
+        _mm_storeu_si128((__m128i*)pjDest + 2, x2);
+        pjDest += 3 * sizeof(__m128i);
+        cjWidth -= 3 * sizeof(__m128i);
+    }
+
+    /* The pattern starts over here */
+    FillRow(pjDest, pjPattern, cjWidth);
+}
+
+#else
+
+#define FILL_PATTERN_ULONGS 6
+
+#endif
+
+VOID
+FASTCALL
+Dib_BitBlt_SOLIDFILL(PBLTDATA pBltData)
+{
+    ULONG ulColor = pBltData->ulSolidColor;
+    ULONG aulPattern[FILL_PATTERN_ULONGS];
+    ULONG i, cLines, cjWidth;
+    PBYTE pjDestBase;
+
+    /* Build 12 bytes worth of pixels, 4 pixels for 24 bpp */
+    switch (pBltData->siDst.iFormat)
+    {
+        case BMF_8BPP:
+            aulPattern[0] = (ulColor & 0xFF) * 0x01010101;
+            aulPattern[1] = aulPattern[2] = aulPattern[0];
+            break;
+
+        case BMF_16BPP:
+            aulPattern[0] = (ulColor & 0xFFFF) * 0x00010001;
+            aulPattern[1] = aulPattern[2] = aulPattern[0];
+            break;
+
+        case BMF_24BPP:
+            ulColor &= 0xFFFFFF;
+            aulPattern[0] = ulColor | (ulColor << 24);
+            aulPattern[1] = (ulColor >> 8) | (ulColor << 16);
+            aulPattern[2] = (ulColor >> 16) | (ulColor << 8);
+            break;
+
+        case BMF_32BPP:
+            aulPattern[0] = aulPattern[1] = aulPattern[2] = ulColor;
+            break;
+
+        default:
+            /* Use the generic function for 1 and 4 bpp */
+            gapfnBitBlt_PATCOPY_Solid[pBltData->siDst.iFormat](pBltData);
+            return;
+    }
+
+    for (i = 3; i < FILL_PATTERN_ULONGS; i++)
+        aulPattern[i] = aulPattern[i - 3];
+
+    /* Calculate the width in bytes */
+    cjWidth = pBltData->ulWidth * pBltData->siDst.jBpp / 8;
+
+    /* Loop all lines */
+    pjDestBase = pBltData->siDst.pjBase;
+    cLines = pBltData->ulHeight;
+    while (cLines--)
+    {
+#ifdef _M_AMD64
+        if (cjWidth >= 3 * sizeof(__m128i))
+            FillRowSse2(pjDestBase, (PBYTE)aulPattern, cjWidth);
+        else
+#endif
+        FillRow(pjDestBase, (PBYTE)aulPattern, cjWidth);
+        pjDestBase += pBltData->siDst.cjAdvanceY;
+    }
+}
+
 VOID
 FASTCALL
 Dib_BitBlt_BLACKNESS(PBLTDATA pBltData)
 {
     /* Pass it to the colorfil function */
     pBltData->ulSolidColor = XLATEOBJ_iXlate(pBltData->pxlo, 0);
-    gapfnBitBlt_PATCOPY_Solid[pBltData->siDst.iFormat](pBltData);
+    Dib_BitBlt_SOLIDFILL(pBltData);
 }
 
 VOID
@@ -18,7 +147,7 @@ Dib_BitBlt_WHITENESS(PBLTDATA pBltData)
 {
     /* Pass it to the colorfil function */
     pBltData->ulSolidColor = XLATEOBJ_iXlate(pBltData->pxlo, 0xFFFFFF);
-    gapfnBitBlt_PATCOPY_Solid[pBltData->siDst.iFormat](pBltData);
+    Dib_BitBlt_SOLIDFILL(pBltData);
 }
 
 VOID
@@ -22,12 +22,31 @@ typedef
 ULONG
 (FASTCALL *PFN_XLATE)(XLATEOBJ* pxlo, ULONG ulColor);
 
+typedef
+VOID
+(FASTCALL *PFN_XLATE_SPAN)(XLATEOBJ* pxlo, PULONG pulDst, const ULONG *pulSrc, ULONG cColors);
+
 extern const BYTE ajShift4[2];
 
 #include "DibLib_interface.h"
 
 #define _DibXlate(pBltData, ulColor) (pBltData->pfnXlate(pBltData->pxlo, ulColor))
 
+/* Source pixels are read and translated in spans of this many pixels */
+#define __USES_XLATE_SPAN 1
+#define _XLATE_SPAN_PIXELS 64
+#define _DibXlateSpan(pBltData, pulColors, cColors) \
+    (pBltData->pfnXlateSpan(pBltData->pxlo, pulColors, pulColors, cColors))
+
+/* Source and target have the same format and no color translation is needed */
+#define _DibIsUntranslated(pBltData) \
+    ((((pBltData)->siSrc.iFormat == 0) || \
+      ((pBltData)->siSrc.iFormat == (pBltData)->siDst.iFormat)) && \
+     ((pBltData)->pxlo->flXlate & XO_TRIVIAL))
+
+VOID FASTCALL Dib_RowBlt_SRCINVERT(PBLTDATA pBltData);
+VOID FASTCALL Dib_RowBlt_SRCAND(PBLTDATA pBltData);
+
 #define __PASTE_(s1,s2) s1##s2
 #define __PASTE(s1,s2) __PASTE_(s1,s2)
 
@@ -29,6 +29,8 @@
 
 #undef _DibXlate
 #define _DibXlate(pBltData, ulColor) (ulColor)
+#undef __USES_XLATE_SPAN
+#define __USES_XLATE_SPAN 0
 #define _SOURCE_BPP _DEST_BPP
 
 #undef __DIB_FUNCTION_NAME
@@ -44,6 +46,8 @@
 
 #undef _DibXlate
 #define _DibXlate(pBltData, ulColor) (pBltData->pfnXlate(pBltData->pxlo, ulColor))
+#undef __USES_XLATE_SPAN
+#define __USES_XLATE_SPAN 1
 
 PFN_DIBFUNCTION
 __PASTE(gapfn, __FUNCTIONNAME)[7][7] =
@@ -10,6 +10,7 @@
 #define _NextPixel(bpp, ppj, pjShift) __PASTE(_NextPixel_, bpp)(ppj, pjShift)
 #define _SHIFT(bpp, x) __PASTE(_SHIFT_, bpp)(x)
 #define _CALCSHIFT(bpp, pshift, x) __PASTE(_CALCSHIFT_, bpp)(pshift, x)
+#define _USES_XLATE_SPAN (__USES_SOURCE && __USES_XLATE_SPAN)
 
 #if (__PASTE(_DibFunction, _manual) != 1)
 
@@ -29,6 +30,10 @@ _DibFunction(PBLTDATA pBltData)
     ULONG ulSource;
     _SHIFT(_SOURCE_BPP, BYTE jSrcShift;)
 #endif
+#if _USES_XLATE_SPAN
+    ULONG aulSource[_XLATE_SPAN_PIXELS], cSpan, i;
+    PULONG pulSource;
+#endif
 #if __USES_PATTERN
     PBYTE pjPattern, pjPatBase;
     ULONG ulPattern, cPatRows, cPatLines;
@@ -74,6 +79,10 @@ _DibFunction(PBLTDATA pBltData)
 
         /* Loop all rows */
         cRows = pBltData->ulWidth;
+#if _USES_XLATE_SPAN
+        cSpan = 0;
+        pulSource = aulSource;
+#endif
         while (cRows--)
         {
 #if __USES_MASK
@@ -95,7 +104,24 @@ _DibFunction(PBLTDATA pBltData)
                 cPatRows = pBltData->ulPatWidth;
             }
 #endif
-#if __USES_SOURCE
+#if _USES_XLATE_SPAN
+            /* Read a span of source pixels and translate them all at once */
+            if (cSpan == 0)
+            {
+                cSpan = min(cRows + 1, _XLATE_SPAN_PIXELS);
+                for (i = 0; i < cSpan; i++)
+                {
+                    aulSource[i] = _ReadPixel(_SOURCE_BPP, pjSource, jSrcShift);
+                    _NextPixel(_SOURCE_BPP, &pjSource, &jSrcShift);
+                }
+                _DibXlateSpan(pBltData, aulSource, cSpan);
+                pulSource = aulSource;
+            }
+
+            /* Take the next translated source color */
+            ulSource = *pulSource++;
+            cSpan--;
+#elif __USES_SOURCE
             /* Read the pattern color, xlate it and go to the next pixel */
             ulSource = _ReadPixel(_SOURCE_BPP, pjSource, jSrcShift);
             ulSource = _DibXlate(pBltData, ulSource);
@@ -134,4 +160,5 @@ _DibFunction(PBLTDATA pBltData)
 #endif // manual
 
 #undef _DibFunction
+#undef _USES_XLATE_SPAN
 #undef __FUNCTIONNAME2
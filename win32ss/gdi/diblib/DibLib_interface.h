@@ -25,6 +25,7 @@ typedef struct
     ULONG ulPatHeight;
     XLATEOBJ *pxlo;
     PFN_XLATE pfnXlate;
+    PFN_XLATE_SPAN pfnXlateSpan;
     ULONG rop4;
     PFN_DOROP apfnDoRop[2];
     ULONG ulSolidColor;
@@ -2,34 +2,62 @@
 #include "DibLib.h"
 
 extern PFN_DIBFUNCTION gapfnBitBlt_SRCCOPY[7][7];
-extern PFN_DIBFUNCTION gapfnBitBlt_SRCINVERT[7][7];
+
+/* The mask has 1 bpp, so the table only ever has 2 entries */
+static
+ULONG
+FASTCALL
+MaskXlate(XLATEOBJ *pxlo, ULONG ulColor)
+{
+    return pxlo->pulXlate[ulColor & 1];
+}
+
+static
+VOID
+FASTCALL
+MaskXlateSpan(XLATEOBJ *pxlo, PULONG pulDst, const ULONG *pulSrc, ULONG cColors)
+{
+    while (cColors--)
+        *pulDst++ = pxlo->pulXlate[*pulSrc++ & 1];
+}
 
 VOID
 FASTCALL
 Dib_MaskCopy(PBLTDATA pBltData)
 {
-    pBltData->siSrc = pBltData->siMsk;
+    XLATEOBJ xlo;
+    ULONG aulColors[2], ulMask;
 
-    /* Create an XLATEOBJ */
-    pBltData->pxlo = 0;// FIXME: use 1bpp -> destbpp
+    /* Neither ROP uses source, pattern or dest, so both are either
+       BLACKNESS (0x00) or WHITENESS (0xFF). Get the target colors. */
+    ulMask = (pBltData->siDst.jBpp < 32) ? (1UL << pBltData->siDst.jBpp) - 1 : 0xFFFFFFFF;
+    aulColors[0] = ((pBltData->rop4 >> 8) & 0xFF) ?
+                   XLATEOBJ_iXlate(pBltData->pxlo, 0xFFFFFF) : XLATEOBJ_iXlate(pBltData->pxlo, 0);
+    aulColors[1] = (pBltData->rop4 & 0xFF) ?
+                   XLATEOBJ_iXlate(pBltData->pxlo, 0xFFFFFF) : XLATEOBJ_iXlate(pBltData->pxlo, 0);
+    aulColors[0] &= ulMask;
+    aulColors[1] &= ulMask;
 
-    /* 4 possibilities... */
-    if (pBltData->rop4 == MAKEROP4(BLACKNESS, WHITENESS))
+    /* Both the same, so the mask doesn't matter */
+    if (aulColors[0] == aulColors[1])
     {
-        gapfnBitBlt_SRCCOPY[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
+        pBltData->ulSolidColor = aulColors[0];
+        Dib_BitBlt_SOLIDFILL(pBltData);
+        return;
     }
-    else if (pBltData->rop4 == MAKEROP4(WHITENESS, BLACKNESS))
-    {
-        gapfnBitBlt_SRCINVERT[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
-    }
-    else if (pBltData->rop4 == MAKEROP4(BLACKNESS, BLACKNESS))
-    {
-        Dib_BitBlt_BLACKNESS(pBltData);
-    }
-    else // if (pBltData->rop4 == MAKEROP4(WHITENESS, WHITENESS))
-    {
-        Dib_BitBlt_WHITENESS(pBltData);
-    }
-}
 
+    /* Copy the mask like a source, with a 1 bpp -> target bpp translation
+       that maps background bits to aulColors[0] and foreground to [1] */
+    memset(&xlo, 0, sizeof(xlo));
+    xlo.flXlate = XO_TABLE;
+    xlo.cEntries = 2;
+    xlo.pulXlate = aulColors;
+
+    pBltData->siSrc = pBltData->siMsk;
+    pBltData->pxlo = &xlo;
+    pBltData->pfnXlate = MaskXlate;
+    pBltData->pfnXlateSpan = MaskXlateSpan;
+
+    gapfnBitBlt_SRCCOPY[pBltData->siDst.iFormat][BMF_1BPP](pBltData);
+}
 
@@ -89,7 +89,7 @@ CalculateCoordinates(
         /* Check for right-to-left case */
         if (pbltdata->siDst.iFormat == 0)
         {
-            pbltdata->siPat.pjBase += (psizlPat->cx - 1) * pbltdata->siMsk.jBpp / 8;
+            pbltdata->siPat.pjBase += (psizlPat->cx - 1) * pbltdata->siPat.jBpp / 8;
             pbltdata->siPat.ptOrig.x = psizlPat->cx - 1 - pbltdata->siPat.ptOrig.x;
         }
     }
@@ -141,6 +141,7 @@ EngBitBlt(
     if (!pxlo) pxlo = &gexloTrivial.xlo;
     bltdata.pxlo = pxlo;
     bltdata.pfnXlate = XLATEOBJ_pfnXlate(pxlo);
+    bltdata.pfnXlateSpan = XLATEOBJ_pfnXlateSpan(pxlo);
 
     /* Check if the ROP uses a source */
     if (ROP4_USES_SOURCE(rop4))
@@ -210,7 +211,11 @@ EngBitBlt(
     if (ROP4_USES_PATTERN(rop4))
     {
         /* Must have a brush */
-        NT_ASSERT(pbo); // FIXME: test this!
+        if (!pbo)
+        {
+            ERR("Pattern ROP without a brush\n");
+            return FALSE;
+        }
 
         /* Copy the solid color */
         bltdata.ulSolidColor = pbo->iSolidColor;
@@ -222,7 +227,7 @@ EngBitBlt(
             psoPattern = BRUSHOBJ_psoPattern(pbo);
             if (!psoPattern)
             {
-                __debugbreak();
+                ERR("Could not get the pattern surface\n");
                 return FALSE;
             }
 
@@ -250,26 +255,23 @@ EngBitBlt(
         psizlPat = NULL;
     }
 
-    /* Check if the ROP uses a mask */
-    if (ROP4_USES_MASK(rop4))
+    /* Check if the ROP uses a mask, but we don't have a mask surface */
+    if (ROP4_USES_MASK(rop4) && (psoMask == NULL))
     {
-        //__debugbreak();
-
-        /* Check if we don't have a mask surface */
+        /* Check if the BRUSHOBJ can provide the mask */
+        psoMask = pbo ? BRUSHOBJ_psoMask(pbo) : NULL;
         if (psoMask == NULL)
         {
-            /* Must have a brush */
-            NT_ASSERT(pbo); // FIXME: test this!
-
-            /* Check if the BRUSHOBJ can provide the mask */
-            psoMask = BRUSHOBJ_psoMask(pbo);
-            if (psoMask == NULL)
-            {
-                /* We have no mask, assume the mask is all foreground */
-                rop4 = (rop4 & 0xFF) || ((rop4 & 0xFF) << 8);
-            }
+            /* We have no mask, assume the mask is all foreground */
+            rop4 = ROP4_FROM_INDEX(ROP4_FGND(rop4));
+            bltdata.rop4 = rop4;
+            bltdata.apfnDoRop[0] = gapfnRop[ROP4_FGND(rop4)];
         }
+    }
 
+    /* Check if the ROP uses a mask */
+    if (ROP4_USES_MASK(rop4))
+    {
         /* Set the mask format info */
         bltdata.siMsk.iFormat = psoMask->iBitmapFormat;
         bltdata.siMsk.pvScan0 = psoMask->pvScan0;
@@ -379,6 +381,51 @@ AdjustOffsetAndSize(
     if (psizTrg->cy > cyMax) psizTrg->cy = cyMax;
 }
 
+/* Copies a rect of a device managed surface to a new standard bitmap
+   with the same format, using the CopyBits of the source device */
+static
+SURFOBJ*
+CopyToTempSurface(
+    _In_ SURFOBJ *psoSrc,
+    _In_ PPOINTL pptlSrc,
+    _In_ PSIZEL psizCopy,
+    _Out_ HBITMAP *phbmTemp)
+{
+    HBITMAP hbmTemp;
+    SURFOBJ *psoTemp;
+    RECTL rcTemp;
+
+    hbmTemp = EngCreateBitmap(*psizCopy,
+                              WIDTH_BYTES_ALIGN32(psizCopy->cx, BitsPerFormat(psoSrc->iBitmapFormat)),
+                              psoSrc->iBitmapFormat,
+                              BMF_TOPDOWN | BMF_NOZEROINIT,
+                              NULL);
+    if (!hbmTemp)
+        return NULL;
+
+    psoTemp = EngLockSurface((HSURF)hbmTemp);
+    if (!psoTemp)
+    {
+        EngDeleteSurface((HSURF)hbmTemp);
+        return NULL;
+    }
+
+    rcTemp.left = 0;
+    rcTemp.top = 0;
+    rcTemp.right = psizCopy->cx;
+    rcTemp.bottom = psizCopy->cy;
+
+    if (!EngCopyBits(psoTemp, psoSrc, NULL, NULL, &rcTemp, pptlSrc))
+    {
+        EngUnlockSurface(psoTemp);
+        EngDeleteSurface((HSURF)hbmTemp);
+        return NULL;
+    }
+
+    *phbmTemp = hbmTemp;
+    return psoTemp;
+}
+
 BOOL
 APIENTRY
 IntEngBitBlt(
@@ -395,10 +442,12 @@ IntEngBitBlt(
     _In_ ROP4 rop4)
 {
     BOOL bResult;
-    RECTL rcClipped;
+    RECTL rcTrg, rcClipped;
     POINTL ptOffset, ptSrc, ptMask, ptBrush;
     SIZEL sizTrg;
     PFN_DrvBitBlt pfnBitBlt;
+    SURFOBJ *psoTemp = NULL;
+    HBITMAP hbmTemp = NULL;
 
 //__debugbreak();
 
@@ -409,6 +458,11 @@ IntEngBitBlt(
     ASSERT(psoTrg->iBitmapFormat <= BMF_32BPP);
     ASSERT(prclTrg);
 
+    /* Make the target rect well ordered */
+    rcTrg = *prclTrg;
+    RECTL_vMakeWellOrdered(&rcTrg);
+    prclTrg = &rcTrg;
+
     /* Clip the target rect to the extents of the target surface */
     if (!RECTL_bClipRectBySize(&rcClipped, prclTrg, &psoTrg->sizlBitmap))
     {
@@ -510,8 +564,17 @@ IntEngBitBlt(
         if (psoSrc && (psoSrc->hdev != psoTrg->hdev) &&
             (SURFOBJ_flags(psoSrc) & HOOK_BITBLT))
         {
-            ERR("Need to copy to standard bitmap format!\n");
-            ASSERT(FALSE);
+            /* The target driver can't read it, copy it to a standard bitmap */
+            psoTemp = CopyToTempSurface(psoSrc, &ptSrc, &sizTrg, &hbmTemp);
+            if (!psoTemp)
+            {
+                ERR("Could not copy the source to a standard bitmap\n");
+                return FALSE;
+            }
+
+            psoSrc = psoTemp;
+            ptSrc.x = 0;
+            ptSrc.y = 0;
         }
 
         pfnBitBlt = GDIDEVFUNCS(psoTrg).BitBlt;
@@ -538,11 +601,52 @@ IntEngBitBlt(
                         pptlBrush ? &ptBrush : NULL,
                         rop4);
 
-    // FIXME: cleanup temp surface!
+    /* Cleanup the temp surface */
+    if (psoTemp)
+    {
+        EngUnlockSurface(psoTemp);
+        EngDeleteSurface((HSURF)hbmTemp);
+    }
 
     return bResult;
 }
 
+/* Locks a surface given by a user mode driver, EngBitBlt needs its bits */
+static
+PSURFACE
+LockUserSurface(
+    _In_ HSURF hsurf)
+{
+    PSURFACE psurf;
+
+    psurf = SURFACE_ShareLockSurface(hsurf);
+    if (!psurf)
+        return NULL;
+
+    if ((psurf->SurfObj.iBitmapFormat < BMF_1BPP) ||
+        (psurf->SurfObj.iBitmapFormat > BMF_32BPP) ||
+        !psurf->SurfObj.pvScan0)
+    {
+        SURFACE_ShareUnlockSurface(psurf);
+        return NULL;
+    }
+
+    return psurf;
+}
+
+/* Checks that a rect of the given size at pptl lies inside the surface */
+static
+BOOL
+IsRectInSurface(
+    _In_ PSURFACE psurf,
+    _In_ PPOINTL pptl,
+    _In_ PSIZEL psiz)
+{
+    return (pptl->x >= 0) && (pptl->y >= 0) &&
+           (psiz->cx <= psurf->SurfObj.sizlBitmap.cx - pptl->x) &&
+           (psiz->cy <= psurf->SurfObj.sizlBitmap.cy - pptl->y);
+}
+
 BOOL
 APIENTRY
 NtGdiEngBitBlt(
@@ -558,15 +662,26 @@ NtGdiEngBitBlt(
     IN POINTL *pptlBrush,
     IN ROP4 rop4)
 {
-    RECTL  rclTrg;
-    POINTL ptlSrc, ptlMask, ptlBrush;
+    RECTL  rclTrg, rclClip;
+    POINTL ptlSrc, ptlMask, ptlBrush, ptlTrg;
+    SIZEL sizTrg;
     HSURF hsurfTrg, hsurfSrc = NULL, hsurfMask = NULL;
-    HANDLE hBrushObj; // HUMPDOBJ
-    SURFOBJ *psoTrg, *psoSrc, *psoMask;
-    CLIPOBJ *pco;
-    XLATEOBJ *pxlo;
-    BRUSHOBJ *pbo;
-    BOOL bResult;
+    PSURFACE psurfTrg = NULL, psurfSrc = NULL, psurfMask = NULL;
+    ULONG iDComplexity = DC_TRIVIAL, flXlate = XO_TRIVIAL, cEntries = 0;
+    PULONG pulXlate = NULL;
+    XCLIPOBJ xco;
+    EXLATEOBJ exlo;
+    BRUSHOBJ bo;
+    CLIPOBJ *pco = NULL;
+    XLATEOBJ *pxlo = NULL;
+    BRUSHOBJ *pbo = NULL;
+    BOOL bXlate = FALSE;
+    BOOL bResult = FALSE;
+
+    if (!IS_VALID_ROP4(rop4))
+        return FALSE;
+
+    RtlZeroMemory(&bo, sizeof(bo));
 
     _SEH2_TRY
     {
@@ -599,36 +714,131 @@ NtGdiEngBitBlt(
             ProbeForRead(pptlBrush, sizeof(POINTL), 1);
             ptlBrush = *pptlBrush;
 
-            ProbeForRead(psoSrcUMPD, sizeof(SURFOBJ), 1);
-            hBrushObj = pboUMPD->pvRbrush; // FIXME
+            ProbeForRead(pboUMPD, sizeof(BRUSHOBJ), 1);
+            bo.iSolidColor = pboUMPD->iSolidColor;
+        }
+
+        if (pcoUMPD)
+        {
+            ProbeForRead(pcoUMPD, sizeof(CLIPOBJ), 1);
+            iDComplexity = pcoUMPD->iDComplexity;
+            rclClip = pcoUMPD->rclBounds;
+        }
+
+        if (pxloUMPD)
+        {
+            ProbeForRead(pxloUMPD, sizeof(XLATEOBJ), 1);
+            flXlate = pxloUMPD->flXlate;
+            cEntries = pxloUMPD->cEntries;
+            pulXlate = pxloUMPD->pulXlate;
+        }
+
+        /* Copy the color table, it is at most 256 entries for 8 bpp */
+        if (!(flXlate & XO_TRIVIAL) && (flXlate & XO_TABLE) &&
+            (cEntries > 0) && (cEntries <= 256))
+        {
+            ProbeForRead(pulXlate, cEntries * sizeof(ULONG), sizeof(ULONG));
+            if (EXLATEOBJ_bInitTable(&exlo, cEntries))
+            {
+                bXlate = TRUE;
+                RtlCopyMemory(exlo.xlo.pulXlate, pulXlate, cEntries * sizeof(ULONG));
+            }
         }
     }
     _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
     {
+        if (bXlate) EXLATEOBJ_vCleanup(&exlo);
         _SEH2_YIELD(return FALSE);
     }
     _SEH2_END;
 
-    // FIXME: these need to be converted/locked!
-    psoTrg = NULL;
-    psoSrc = NULL;
-    psoMask = NULL;
-    pco = NULL;
-    pxlo = NULL;
-    pbo = NULL;
+    /* Only the solid brush is passed by value, we can't realize patterns */
+    if (ROP4_USES_PATTERN(rop4))
+    {
+        if (bo.iSolidColor == 0xFFFFFFFF)
+        {
+            ERR("Pattern brushes are not supported\n");
+            goto Cleanup;
+        }
+        pbo = &bo;
+    }
 
-    bResult = EngBitBlt(psoTrg,
-                        psoSrc,
-                        psoMask,
+    /* Use the table, if there is a translation */
+    if (!(flXlate & XO_TRIVIAL))
+    {
+        if (!bXlate)
+        {
+            ERR("Unsupported XLATEOBJ, flXlate 0x%lx, cEntries %lu\n", flXlate, cEntries);
+            goto Cleanup;
+        }
+        pxlo = &exlo.xlo;
+    }
+
+    /* Build our own clip object from the bounds, a complex region can't
+       be enumerated from user mode memory */
+    if (iDComplexity == DC_RECT)
+    {
+        IntEngInitClipObj(&xco);
+        IntEngUpdateClipRegion(&xco, 1, &rclClip, &rclClip);
+        pco = (CLIPOBJ*)&xco;
+    }
+    else if (iDComplexity != DC_TRIVIAL)
+    {
+        ERR("Unsupported clip complexity %lu\n", iDComplexity);
+        goto Cleanup;
+    }
+
+    /* Lock the surfaces */
+    psurfTrg = LockUserSurface(hsurfTrg);
+    if (!psurfTrg) goto Cleanup;
+
+    if (ROP4_USES_SOURCE(rop4))
+    {
+        psurfSrc = LockUserSurface(hsurfSrc);
+        if (!psurfSrc) goto Cleanup;
+    }
+
+    if (ROP4_USES_MASK(rop4))
+    {
+        psurfMask = LockUserSurface(hsurfMask);
+        if (!psurfMask || (psurfMask->SurfObj.iBitmapFormat != BMF_1BPP))
+            goto Cleanup;
+    }
+
+    /* EngBitBlt trusts the coordinates, check them against the surfaces */
+    if ((rclTrg.left >= rclTrg.right) || (rclTrg.top >= rclTrg.bottom))
+        goto Cleanup;
+
+    ptlTrg.x = rclTrg.left;
+    ptlTrg.y = rclTrg.top;
+    sizTrg.cx = rclTrg.right - rclTrg.left;
+    sizTrg.cy = rclTrg.bottom - rclTrg.top;
+    if (!IsRectInSurface(psurfTrg, &ptlTrg, &sizTrg) ||
+        (psurfSrc && !IsRectInSurface(psurfSrc, &ptlSrc, &sizTrg)) ||
+        (psurfMask && !IsRectInSurface(psurfMask, &ptlMask, &sizTrg)))
+    {
+        goto Cleanup;
+    }
+
+    bResult = EngBitBlt(&psurfTrg->SurfObj,
+                        psurfSrc ? &psurfSrc->SurfObj : NULL,
+                        psurfMask ? &psurfMask->SurfObj : NULL,
                         pco,
                         pxlo,
                         &rclTrg,
-                        pptlSrc ? &ptlSrc : NULL,
-                        pptlMask ? &ptlMask : NULL,
+                        psurfSrc ? &ptlSrc : NULL,
+                        psurfMask ? &ptlMask : NULL,
                         pbo,
-                        pptlBrush ? &ptlBrush : NULL,
+                        pbo ? &ptlBrush : NULL,
                         rop4);
 
+Cleanup:
+    if (psurfMask) SURFACE_ShareUnlockSurface(psurfMask);
+    if (psurfSrc) SURFACE_ShareUnlockSurface(psurfSrc);
+    if (psurfTrg) SURFACE_ShareUnlockSurface(psurfTrg);
+    if (pco) IntEngFreeClipResources(&xco);
+    if (bXlate) EXLATEOBJ_vCleanup(&exlo);
+
     return bResult;
 }
 
@@ -649,7 +859,7 @@ EngCopyBits(
     {
         pfnCopyBits = GDIDEVFUNCS(psoTrg).CopyBits;
     }
-    if (SURFOBJ_flags(psoSrc) & HOOK_COPYBITS)
+    else if (SURFOBJ_flags(psoSrc) & HOOK_COPYBITS)
     {
         pfnCopyBits = GDIDEVFUNCS(psoSrc).CopyBits;
     }
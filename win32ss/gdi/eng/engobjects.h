@@ -127,6 +127,7 @@ typedef struct _SHARED_FACE_CACHE {
 
 typedef struct _SHARED_FACE {
   FT_Face       Face;
+  PFAST_MUTEX   Lock;       /* Serializes the use of Face, see freetype.c */
   LONG          RefCount;
   PSHARED_MEM   Memory;
   SHARED_FACE_CACHE EnglishUS;
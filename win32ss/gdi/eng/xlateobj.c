@@ -8,6 +8,10 @@
 
 #include <win32k.h>
 
+#ifdef _M_AMD64
+#include <emmintrin.h>
+#endif
+
 #define NDEBUG
 #include <debug.h>
 
@@ -19,9 +23,20 @@ EXLATEOBJ_iXlateTrivial(
     _In_ PEXLATEOBJ pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTrivial(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors);
+
 /** Globals *******************************************************************/
 
-EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial};
+EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0},
+                          EXLATEOBJ_iXlateTrivial,
+                          EXLATEOBJ_vXlateSpanTrivial};
 
 static ULONG giUniqueXlate = 0;
 
@@ -351,6 +366,361 @@ EXLATEOBJ_iXlateBitfieldsToPal(PEXLATEOBJ pexlo, ULONG iColor)
 }
 
 
+/** Span functions ************************************************************/
+
+/*
+ * Span functions translate a whole scanline with one indirect call. The
+ * simple conversions are the iXlate functions above in a loop, which the
+ * compiler inlines so that the shifts and masks stay in registers.
+ */
+#define DEFINE_XLATE_SPAN(name) \
+_Function_class_(FN_XLATE_SPAN) \
+VOID \
+FASTCALL \
+EXLATEOBJ_vXlateSpan##name( \
+    _Inout_ PEXLATEOBJ pexlo, \
+    _Out_writes_(cColors) PULONG pulDst, \
+    _In_reads_(cColors) const ULONG *pulSrc, \
+    _In_ ULONG cColors) \
+{ \
+    while (cColors--) \
+    { \
+        *pulDst++ = EXLATEOBJ_iXlate##name(pexlo, *pulSrc++); \
+    } \
+}
+
+#ifdef _M_AMD64
+
+/*
+ * SSE2 is always there on amd64, so the shift and mask conversions handle
+ * four colors at a time. The vector versions follow the iXlate functions
+ * step by step and give the same results. On i386, win32k would have to
+ * save the FPU state for every span, so only the scalar loops are used.
+ */
+#define XMM_AND(x, m) _mm_and_si128(x, _mm_set1_epi32((INT)(m)))
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlateRGBtoBGR(__m128i xColors)
+{
+    __m128i xNew = XMM_AND(xColors, 0xff00ff00);
+
+    xColors = XMM_AND(xColors, 0x00ff00ff);
+    xNew = _mm_or_si128(xNew, _mm_srli_epi32(xColors, 16));
+    return _mm_or_si128(xNew, _mm_slli_epi32(xColors, 16));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlateRGBto555(__m128i xColors)
+{
+    __m128i xNew;
+
+    xColors = _mm_slli_epi32(xColors, 7);
+    xNew = XMM_AND(xColors, 0x7C00);
+    xColors = _mm_srli_epi32(xColors, 13);
+    xNew = _mm_or_si128(xNew, XMM_AND(xColors, 0x3E0));
+    xColors = _mm_srli_epi32(xColors, 13);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0x1F));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlateBGRto555(__m128i xColors)
+{
+    __m128i xNew;
+
+    xColors = _mm_srli_epi32(xColors, 3);
+    xNew = XMM_AND(xColors, 0x1F);
+    xColors = _mm_srli_epi32(xColors, 3);
+    xNew = _mm_or_si128(xNew, XMM_AND(xColors, 0x3E0));
+    xColors = _mm_srli_epi32(xColors, 3);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0x7C00));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlateRGBto565(__m128i xColors)
+{
+    __m128i xNew;
+
+    xColors = _mm_slli_epi32(xColors, 8);
+    xNew = XMM_AND(xColors, 0xF800);
+    xColors = _mm_srli_epi32(xColors, 13);
+    xNew = _mm_or_si128(xNew, XMM_AND(xColors, 0x7E0));
+    xColors = _mm_srli_epi32(xColors, 14);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0x1F));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlateBGRto565(__m128i xColors)
+{
+    __m128i xNew;
+
+    xColors = _mm_srli_epi32(xColors, 3);
+    xNew = XMM_AND(xColors, 0x1F);
+    xColors = _mm_srli_epi32(xColors, 2);
+    xNew = _mm_or_si128(xNew, XMM_AND(xColors, 0x7E0));
+    xColors = _mm_srli_epi32(xColors, 3);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0xF800));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlate555to565(__m128i xColors)
+{
+    __m128i xNew = XMM_AND(xColors, 0x1F);
+
+    xColors = _mm_slli_epi32(xColors, 1);
+    xNew = _mm_or_si128(xNew, XMM_AND(xColors, 0xFFC0));
+    xColors = _mm_srli_epi32(xColors, 5);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0x20));
+}
+
+FORCEINLINE
+__m128i
+EXLATEOBJ_xXlate565to555(__m128i xColors)
+{
+    __m128i xNew = XMM_AND(xColors, 0x1F);
+
+    xColors = _mm_srli_epi32(xColors, 1);
+    return _mm_or_si128(xNew, XMM_AND(xColors, 0x7FE0));
+}
+
+#define DEFINE_XLATE_SPAN_SSE2(name) \
+_Function_class_(FN_XLATE_SPAN) \
+VOID \
+FASTCALL \
+EXLATEOBJ_vXlateSpan##name( \
+    _Inout_ PEXLATEOBJ pexlo, \
+    _Out_writes_(cColors) PULONG pulDst, \
+    _In_reads_(cColors) const ULONG *pulSrc, \
+    _In_ ULONG cColors) \
+{ \
+    for (; cColors >= 4; cColors -= 4, pulSrc += 4, pulDst += 4) \
+    { \
+        _mm_storeu_si128((__m128i *)pulDst, \
+            EXLATEOBJ_xXlate##name(_mm_loadu_si128((const __m128i *)pulSrc))); \
+    } \
+    while (cColors--) \
+    { \
+        *pulDst++ = EXLATEOBJ_iXlate##name(pexlo, *pulSrc++); \
+    } \
+}
+
+DEFINE_XLATE_SPAN_SSE2(RGBtoBGR)
+DEFINE_XLATE_SPAN_SSE2(RGBto555)
+DEFINE_XLATE_SPAN_SSE2(BGRto555)
+DEFINE_XLATE_SPAN_SSE2(RGBto565)
+DEFINE_XLATE_SPAN_SSE2(BGRto565)
+DEFINE_XLATE_SPAN_SSE2(555to565)
+DEFINE_XLATE_SPAN_SSE2(565to555)
+
+#else
+
+DEFINE_XLATE_SPAN(RGBtoBGR)
+DEFINE_XLATE_SPAN(RGBto555)
+DEFINE_XLATE_SPAN(BGRto555)
+DEFINE_XLATE_SPAN(RGBto565)
+DEFINE_XLATE_SPAN(BGRto565)
+DEFINE_XLATE_SPAN(555to565)
+DEFINE_XLATE_SPAN(565to555)
+
+#endif /* _M_AMD64 */
+
+/* These go through lookup tables, which SSE2 can't vectorize */
+DEFINE_XLATE_SPAN(555toRGB)
+DEFINE_XLATE_SPAN(555toBGR)
+DEFINE_XLATE_SPAN(565toRGB)
+DEFINE_XLATE_SPAN(565toBGR)
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTrivial(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    if (pulDst != pulSrc)
+        RtlMoveMemory(pulDst, pulSrc, cColors * sizeof(ULONG));
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanGeneric(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    while (cColors--)
+    {
+        *pulDst++ = pexlo->pfnXlate(pexlo, *pulSrc++);
+    }
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanTable(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    /* Local copies, the compiler must assume that pulDst aliases them */
+    PULONG pulXlate = pexlo->xlo.pulXlate;
+    ULONG cEntries = pexlo->xlo.cEntries;
+    ULONG iColor;
+
+    while (cColors--)
+    {
+        iColor = *pulSrc++;
+        *pulDst++ = (iColor < cEntries) ? pulXlate[iColor] : 0;
+    }
+}
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanShiftAndMask(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    ULONG ulRedMask = pexlo->ulRedMask, ulRedShift = pexlo->ulRedShift;
+    ULONG ulGreenMask = pexlo->ulGreenMask, ulGreenShift = pexlo->ulGreenShift;
+    ULONG ulBlueMask = pexlo->ulBlueMask, ulBlueShift = pexlo->ulBlueShift;
+    ULONG iColor;
+
+#ifdef _M_AMD64
+    /* _rotl by a count that is the same for all four colors */
+    __m128i xColors, xNew;
+    __m128i xRedLeft = _mm_cvtsi32_si128(ulRedShift), xRedRight = _mm_cvtsi32_si128(32 - ulRedShift);
+    __m128i xGreenLeft = _mm_cvtsi32_si128(ulGreenShift), xGreenRight = _mm_cvtsi32_si128(32 - ulGreenShift);
+    __m128i xBlueLeft = _mm_cvtsi32_si128(ulBlueShift), xBlueRight = _mm_cvtsi32_si128(32 - ulBlueShift);
+
+    for (; cColors >= 4; cColors -= 4, pulSrc += 4, pulDst += 4)
+    {
+        xColors = _mm_loadu_si128((const __m128i *)pulSrc);
+        xNew = XMM_AND(_mm_or_si128(_mm_sll_epi32(xColors, xRedLeft),
+                                    _mm_srl_epi32(xColors, xRedRight)), ulRedMask);
+        xNew = _mm_or_si128(xNew, XMM_AND(_mm_or_si128(_mm_sll_epi32(xColors, xGreenLeft),
+                                                       _mm_srl_epi32(xColors, xGreenRight)), ulGreenMask));
+        xNew = _mm_or_si128(xNew, XMM_AND(_mm_or_si128(_mm_sll_epi32(xColors, xBlueLeft),
+                                                       _mm_srl_epi32(xColors, xBlueRight)), ulBlueMask));
+        _mm_storeu_si128((__m128i *)pulDst, xNew);
+    }
+#endif
+
+    while (cColors--)
+    {
+        iColor = *pulSrc++;
+        *pulDst++ = (_rotl(iColor, ulRedShift) & ulRedMask) |
+                    (_rotl(iColor, ulGreenShift) & ulGreenMask) |
+                    (_rotl(iColor, ulBlueShift) & ulBlueMask);
+    }
+}
+
+/*
+ * Translations to a palette search the whole palette for every color.
+ * Scanlines mostly repeat the same few colors, so remember the results
+ * in a direct mapped cache. All entries start out valid for color 0.
+ */
+#define XLATE_CACHE_HASH(iColor) (((iColor) * 0x9E3779B1) >> (32 - XLATE_CACHE_SHIFT))
+
+_Function_class_(FN_XLATE_SPAN)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpanCached(
+    _Inout_ PEXLATEOBJ pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    PXLATE_CACHE_ENTRY pCache = pexlo->pCache, pEntry;
+    ULONG i, iColor;
+
+    if (!pCache)
+    {
+        pCache = EngAllocMem(0,
+                             XLATE_CACHE_SIZE * sizeof(XLATE_CACHE_ENTRY),
+                             GDITAG_PXLATE);
+        if (!pCache)
+        {
+            EXLATEOBJ_vXlateSpanGeneric(pexlo, pulDst, pulSrc, cColors);
+            return;
+        }
+
+        pCache[0].iColor = 0;
+        pCache[0].iXlated = pexlo->pfnXlate(pexlo, 0);
+        for (i = 1; i < XLATE_CACHE_SIZE; i++)
+            pCache[i] = pCache[0];
+
+        pexlo->pCache = pCache;
+    }
+
+    while (cColors--)
+    {
+        iColor = *pulSrc++;
+        pEntry = &pCache[XLATE_CACHE_HASH(iColor)];
+        if (pEntry->iColor != iColor)
+        {
+            pEntry->iColor = iColor;
+            pEntry->iXlated = pexlo->pfnXlate(pexlo, iColor);
+        }
+        *pulDst++ = pEntry->iXlated;
+    }
+}
+
+static const struct
+{
+    PFN_XLATE pfnXlate;
+    PFN_XLATE_SPAN pfnXlateSpan;
+} gaXlateSpan[] =
+{
+    {EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateSpanTrivial},
+    {EXLATEOBJ_iXlateTable, EXLATEOBJ_vXlateSpanTable},
+    {EXLATEOBJ_iXlateShiftAndMask, EXLATEOBJ_vXlateSpanShiftAndMask},
+    {EXLATEOBJ_iXlateRGBtoBGR, EXLATEOBJ_vXlateSpanRGBtoBGR},
+    {EXLATEOBJ_iXlateRGBto555, EXLATEOBJ_vXlateSpanRGBto555},
+    {EXLATEOBJ_iXlateBGRto555, EXLATEOBJ_vXlateSpanBGRto555},
+    {EXLATEOBJ_iXlateRGBto565, EXLATEOBJ_vXlateSpanRGBto565},
+    {EXLATEOBJ_iXlateBGRto565, EXLATEOBJ_vXlateSpanBGRto565},
+    {EXLATEOBJ_iXlate555toRGB, EXLATEOBJ_vXlateSpan555toRGB},
+    {EXLATEOBJ_iXlate555toBGR, EXLATEOBJ_vXlateSpan555toBGR},
+    {EXLATEOBJ_iXlate555to565, EXLATEOBJ_vXlateSpan555to565},
+    {EXLATEOBJ_iXlate565to555, EXLATEOBJ_vXlateSpan565to555},
+    {EXLATEOBJ_iXlate565toRGB, EXLATEOBJ_vXlateSpan565toRGB},
+    {EXLATEOBJ_iXlate565toBGR, EXLATEOBJ_vXlateSpan565toBGR},
+    {EXLATEOBJ_iXlateRGBtoPal, EXLATEOBJ_vXlateSpanCached},
+    {EXLATEOBJ_iXlate555toPal, EXLATEOBJ_vXlateSpanCached},
+    {EXLATEOBJ_iXlate565toPal, EXLATEOBJ_vXlateSpanCached},
+    {EXLATEOBJ_iXlateBitfieldsToPal, EXLATEOBJ_vXlateSpanCached},
+};
+
+static
+PFN_XLATE_SPAN
+EXLATEOBJ_pfnGetXlateSpan(
+    _In_ PFN_XLATE pfnXlate)
+{
+    ULONG i;
+
+    for (i = 0; i < RTL_NUMBER_OF(gaXlateSpan); i++)
+    {
+        if (gaXlateSpan[i].pfnXlate == pfnXlate)
+            return gaXlateSpan[i].pfnXlateSpan;
+    }
+
+    return EXLATEOBJ_vXlateSpanGeneric;
+}
+
+
 /** Private Functions *********************************************************/
 
 VOID
@@ -374,6 +744,8 @@ EXLATEOBJ_vInitialize(
     pexlo->xlo.flXlate = 0;
     pexlo->xlo.pulXlate = pexlo->aulXlate;
     pexlo->pfnXlate = EXLATEOBJ_iXlateTrivial;
+    pexlo->pfnXlateSpan = EXLATEOBJ_vXlateSpanTrivial;
+    pexlo->pCache = NULL;
     pexlo->hColorTransform = NULL;
     pexlo->ppalSrc = ppalSrc;
     pexlo->ppalDst = ppalDst;
@@ -604,6 +976,8 @@ EXLATEOBJ_vInitialize(
         pexlo->xlo.flXlate = XO_TRIVIAL;
     else
         pexlo->xlo.flXlate &= ~XO_TRIVIAL;
+
+    pexlo->pfnXlateSpan = EXLATEOBJ_pfnGetXlateSpan(pexlo->pfnXlate);
 }
 
 VOID
@@ -644,6 +1018,36 @@ VOID NTAPI EXLATEOBJ_vInitSrcMonoXlate(
                           crForegroundClr);
 }
 
+BOOL
+NTAPI
+EXLATEOBJ_bInitTable(
+    _Out_ PEXLATEOBJ pexlo,
+    _In_ ULONG cEntries)
+{
+    /* Start with a trivial xlate, that doesn't need a cleanup */
+    EXLATEOBJ_vInitialize(pexlo, &gpalRGB, &gpalRGB, 0, 0, 0);
+
+    /* Allocate buffer if needed */
+    if (cEntries > RTL_NUMBER_OF(pexlo->aulXlate))
+    {
+        pexlo->xlo.pulXlate = EngAllocMem(0,
+                                          cEntries * sizeof(ULONG),
+                                          GDITAG_PXLATE);
+        if (!pexlo->xlo.pulXlate)
+        {
+            pexlo->xlo.pulXlate = pexlo->aulXlate;
+            return FALSE;
+        }
+    }
+
+    /* The caller fills in the table */
+    pexlo->pfnXlate = EXLATEOBJ_iXlateTable;
+    pexlo->pfnXlateSpan = EXLATEOBJ_vXlateSpanTable;
+    pexlo->xlo.cEntries = cEntries;
+    pexlo->xlo.flXlate = XO_TABLE;
+    return TRUE;
+}
+
 VOID
 NTAPI
 EXLATEOBJ_vCleanup(
@@ -654,6 +1058,28 @@ EXLATEOBJ_vCleanup(
         EngFreeMem(pexlo->xlo.pulXlate);
     }
     pexlo->xlo.pulXlate = pexlo->aulXlate;
+
+    if (pexlo->pCache)
+    {
+        EngFreeMem(pexlo->pCache);
+        pexlo->pCache = NULL;
+    }
+}
+
+VOID
+NTAPI
+XLATEOBJ_vXlateSpan(
+    _In_opt_ XLATEOBJ *pxlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors)
+{
+    PEXLATEOBJ pexlo = (PEXLATEOBJ)pxlo;
+
+    if (!pxlo)
+        pexlo = &gexloTrivial;
+
+    pexlo->pfnXlateSpan(pexlo, pulDst, pulSrc, cColors);
 }
 
 /** Public DDI Functions ******************************************************/
@@ -16,11 +16,32 @@ ULONG
     _In_ struct _EXLATEOBJ *pexlo,
     _In_ ULONG iColor);
 
+/* Translates cColors colors at once, pulDst may be the same as pulSrc */
+_Function_class_(FN_XLATE_SPAN)
+typedef
+VOID
+(FASTCALL *PFN_XLATE_SPAN)(
+    _Inout_ struct _EXLATEOBJ *pexlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors);
+
+/* Remembers the results of the slow nearest palette index lookups */
+#define XLATE_CACHE_SHIFT 9
+#define XLATE_CACHE_SIZE (1 << XLATE_CACHE_SHIFT)
+
+typedef struct _XLATE_CACHE_ENTRY
+{
+    ULONG iColor;
+    ULONG iXlated;
+} XLATE_CACHE_ENTRY, *PXLATE_CACHE_ENTRY;
+
 typedef struct _EXLATEOBJ
 {
     XLATEOBJ xlo;
 
     PFN_XLATE pfnXlate;
+    PFN_XLATE_SPAN pfnXlateSpan;
 
     PPALETTE ppalSrc;
     PPALETTE ppalDst;
@@ -28,6 +49,9 @@ typedef struct _EXLATEOBJ
 
     HANDLE hColorTransform;
 
+    /* Allocated on first use by span translations to a palette */
+    PXLATE_CACHE_ENTRY pCache;
+
     union
     {
         ULONG aulXlate[6];
@@ -54,6 +78,23 @@ XLATEOBJ_pfnXlate(
     return ((PEXLATEOBJ)pxlo)->pfnXlate;
 }
 
+_Notnull_
+FORCEINLINE
+PFN_XLATE_SPAN
+XLATEOBJ_pfnXlateSpan(
+    _In_ XLATEOBJ *pxlo)
+{
+    return ((PEXLATEOBJ)pxlo)->pfnXlateSpan;
+}
+
+VOID
+NTAPI
+XLATEOBJ_vXlateSpan(
+    _In_opt_ XLATEOBJ *pxlo,
+    _Out_writes_(cColors) PULONG pulDst,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _In_ ULONG cColors);
+
 VOID
 NTAPI
 EXLATEOBJ_vInitialize(
@@ -79,6 +120,12 @@ EXLATEOBJ_vInitSrcMonoXlate(
     _In_ COLORREF crBackgroundClr,
     _In_ COLORREF crForegroundClr);
 
+BOOL
+NTAPI
+EXLATEOBJ_bInitTable(
+    _Out_ PEXLATEOBJ pexlo,
+    _In_ ULONG cEntries);
+
 VOID
 NTAPI
 EXLATEOBJ_vCleanup(
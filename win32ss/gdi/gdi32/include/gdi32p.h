@@ -376,14 +376,19 @@ int FASTCALL DocumentEventEx(PVOID,HANDLE,HDC,int,ULONG,PVOID,ULONG,PVOID);
 BOOL FASTCALL EndPagePrinterEx(PVOID,HANDLE);
 BOOL FASTCALL LoadTheSpoolerDrv(VOID);
 
+/*
+ * Allocates a batch command with cjExtra bytes of variable data after the
+ * fixed size structure. Returns NULL if the command can't be batched.
+ */
 FORCEINLINE
 PVOID
-GdiAllocBatchCommand(
+GdiAllocBatchCommandEx(
     HDC hdc,
-    USHORT Cmd)
+    USHORT Cmd,
+    ULONG cjExtra)
 {
     PTEB pTeb;
-    USHORT cjSize;
+    ULONG cjSize;
     PGDIBATCHHDR pHdr;
 
     /* Get a pointer to the TEB */
@@ -402,11 +407,18 @@ GdiAllocBatchCommand(
     else if (Cmd == GdiBCSelObj) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelRgn) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelObj) cjSize = sizeof(GDIBSOBJECT);
+    else if (Cmd == GdiBCLineTo) cjSize = sizeof(GDIBSLINETO);
+    else if (Cmd == GdiBCRectangle) cjSize = sizeof(GDIBSRECTANGLE);
+    else if (Cmd == GdiBCSetPixel) cjSize = sizeof(GDIBSSETPIXEL);
     else cjSize = 0;
 
     /* Unsupported operation */
     if (cjSize == 0) return NULL;
 
+    /* Does it fit into an empty buffer? */
+    if (cjExtra > GDIBATCHBUFSIZE - cjSize) return NULL;
+    cjSize += cjExtra;
+
     /* Do we use a DC? */
     if (hdc)
     {
@@ -417,8 +429,10 @@ GdiAllocBatchCommand(
         else if (pTeb->GdiTebBatch.HDC != hdc) return NULL;
     }
 
-    /* Check if the buffer is full */
-    if ((pTeb->GdiBatchCount >= GDI_BatchLimit) ||
+    /* Check if the buffer is full. The command count only matters when
+       the application lowered the limit with GdiSetBatchLimit. */
+    if (((GDI_BatchLimit < GDI_BATCH_LIMIT) &&
+         (pTeb->GdiBatchCount >= GDI_BatchLimit)) ||
         ((pTeb->GdiTebBatch.Offset + cjSize) > GDIBATCHBUFSIZE))
     {
         /* Call win32k, the kernel will call NtGdiFlushUserBatch to flush
@@ -441,11 +455,69 @@ GdiAllocBatchCommand(
 
     /* Fill in the core fields */
     pHdr->Cmd = Cmd;
-    pHdr->Size = cjSize;
+    pHdr->Size = (SHORT)cjSize;
+
+    return pHdr;
+}
+
+FORCEINLINE
+PVOID
+GdiAllocBatchCommand(
+    HDC hdc,
+    USHORT Cmd)
+{
+    return GdiAllocBatchCommandEx(hdc, Cmd, 0);
+}
+
+/*
+ * Returns the last command of the batch if it is a Cmd command for hdc
+ * and the buffer has room for cjExtra more bytes. The caller can append
+ * to it with GdiGrowBatchCommand instead of adding a new command.
+ */
+FORCEINLINE
+PVOID
+GdiGetLastBatchCommand(
+    HDC hdc,
+    USHORT Cmd,
+    ULONG cjExtra)
+{
+    PTEB pTeb = NtCurrentTeb();
+    PGDIBATCHHDR pHdr;
+    PUCHAR pjBuffer;
+
+    /* GdiThreadLocalInfo remembers the last command. A flush clears it, but
+       check that it still is the last one of the current batch anyway */
+    pHdr = pTeb->GdiThreadLocalInfo;
+    pjBuffer = (PUCHAR)pTeb->GdiTebBatch.Buffer;
+    if (!pHdr ||
+        (pTeb->GdiBatchCount == 0) ||
+        ((PUCHAR)pHdr < pjBuffer) ||
+        ((PUCHAR)pHdr >= pjBuffer + pTeb->GdiTebBatch.Offset) ||
+        ((PUCHAR)pHdr + pHdr->Size != pjBuffer + pTeb->GdiTebBatch.Offset))
+    {
+        return NULL;
+    }
+
+    if ((pHdr->Cmd != Cmd) ||
+        (pTeb->GdiTebBatch.HDC != hdc) ||
+        ((pTeb->GdiTebBatch.Offset + cjExtra) > GDIBATCHBUFSIZE))
+    {
+        return NULL;
+    }
 
     return pHdr;
 }
 
+FORCEINLINE
+VOID
+GdiGrowBatchCommand(
+    PGDIBATCHHDR pHdr,
+    ULONG cjExtra)
+{
+    NtCurrentTeb()->GdiTebBatch.Offset += cjExtra;
+    pHdr->Size += (SHORT)cjExtra;
+}
+
 FORCEINLINE
 PDC_ATTR
 GdiGetDcAttr(HDC hdc)
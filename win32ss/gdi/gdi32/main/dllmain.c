@@ -92,6 +92,7 @@ GdiDllInitialize(
         {
             NtCurrentTeb()->GdiTebBatch.Offset = 0;
             NtCurrentTeb()->GdiBatchCount = 0;
+            NtCurrentTeb()->GdiThreadLocalInfo = NULL;
             break;
         }
 
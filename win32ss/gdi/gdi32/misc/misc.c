@@ -842,10 +842,11 @@ GdiSetBatchLimit(DWORD	Limit)
 {
     DWORD OldLimit = GDI_BatchLimit;
 
+    /* Zero selects the default, which only flushes when the buffer is full */
     if ( (!Limit) ||
             (Limit >= GDI_BATCH_LIMIT))
     {
-        return Limit;
+        Limit = GDI_BATCH_LIMIT;
     }
 
     GdiFlush();
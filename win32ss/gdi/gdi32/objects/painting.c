@@ -1,5 +1,25 @@
 #include <precomp.h>
 
+/* Snapshot the attributes a batched LineTo, Rectangle or SetPixel draws with */
+static
+VOID
+GdiSnapshotDrawAttr(
+    _Out_ PGDIBSDRAWATTR pgAttr,
+    _In_ PDC_ATTR pdcattr)
+{
+    pgAttr->hpen            = pdcattr->hpen;
+    pgAttr->hbrush          = pdcattr->hbrush;
+    pgAttr->crForegroundClr = pdcattr->crForegroundClr;
+    pgAttr->crBackgroundClr = pdcattr->crBackgroundClr;
+    pgAttr->crBrushClr      = pdcattr->crBrushClr;
+    pgAttr->crPenClr        = pdcattr->crPenClr;
+    pgAttr->ulForegroundClr = pdcattr->ulForegroundClr;
+    pgAttr->ulBackgroundClr = pdcattr->ulBackgroundClr;
+    pgAttr->ulBrushClr      = pdcattr->ulBrushClr;
+    pgAttr->ulPenClr        = pdcattr->ulPenClr;
+    pgAttr->ptlViewportOrg  = pdcattr->ptlViewportOrg;
+}
+
 
 /*
  * @implemented
@@ -11,10 +31,37 @@ LineTo(
     _In_ INT x,
     _In_ INT y )
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, LineTo, FALSE, hdc, x, y);
 
     if ( GdiConvertAndCheckDC(hdc) == NULL ) return FALSE;
 
+    /* Get the DC attribute. The current position must be valid here. */
+    pdcattr = GdiGetDcAttr(hdc);
+    if (pdcattr && !(pdcattr->ulDirty_ & (DC_DIBSECTION|DIRTY_PTLCURRENT)))
+    {
+        PGDIBSLINETO pgO;
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCLineTo);
+        if (pgO)
+        {
+            pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+            pgO->ptlStart = pdcattr->ptlCurrent;
+            pgO->ptlEnd.x = x;
+            pgO->ptlEnd.y = y;
+            pgO->flDirty  = pdcattr->ulDirty_ & (DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+            /* Snapshot attributes */
+            GdiSnapshotDrawAttr(&pgO->gbAttr, pdcattr);
+
+            /* Move the current position like win32k will, it updates
+               ptfxCurrent when the batch is flushed */
+            pdcattr->ptlCurrent = pgO->ptlEnd;
+            pdcattr->ulDirty_ &= ~(DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+            return TRUE;
+        }
+    }
+
     return NtGdiLineTo(hdc, x, y);
 }
 
@@ -95,10 +142,32 @@ Rectangle(
     _In_ INT right,
     _In_ INT bottom)
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, Rectangle, FALSE, hdc, left, top, right, bottom);
 
     if ( GdiConvertAndCheckDC(hdc) == NULL ) return FALSE;
 
+    /* Get the DC attribute */
+    pdcattr = GdiGetDcAttr(hdc);
+    if (pdcattr && !(pdcattr->ulDirty_ & DC_DIBSECTION))
+    {
+        PGDIBSRECTANGLE pgO;
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCRectangle);
+        if (pgO)
+        {
+            pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+            pgO->rcl.left   = left;
+            pgO->rcl.top    = top;
+            pgO->rcl.right  = right;
+            pgO->rcl.bottom = bottom;
+            /* Snapshot attributes */
+            GdiSnapshotDrawAttr(&pgO->gbAttr, pdcattr);
+            return TRUE;
+        }
+    }
+
     return NtGdiRectangle(hdc, left, top, right, bottom);
 }
 
@@ -171,6 +240,46 @@ SetPixelV(
     _In_ INT y,
     _In_ COLORREF crColor)
 {
+    PDC_ATTR pdcattr;
+    PGDIBSSETPIXEL pgO;
+    PGDIBSPIXEL pPixel;
+
+    /* Unlike SetPixel, we don't need to return the color. This can be batched. */
+    if (GDI_HANDLE_GET_TYPE(hdc) == GDILoObjType_LO_DC_TYPE)
+    {
+        /* Get the DC attribute */
+        pdcattr = GdiGetDcAttr(hdc);
+        if (pdcattr && !(pdcattr->ulDirty_ & DC_DIBSECTION))
+        {
+            /* Add the pixel to the last run, if it was drawn the same way */
+            pgO = GdiGetLastBatchCommand(hdc, GdiBCSetPixel, sizeof(GDIBSPIXEL));
+            if (pgO &&
+                (pgO->gbAttr.ptlViewportOrg.x == pdcattr->ptlViewportOrg.x) &&
+                (pgO->gbAttr.ptlViewportOrg.y == pdcattr->ptlViewportOrg.y))
+            {
+                GdiGrowBatchCommand(&pgO->gbHdr, sizeof(GDIBSPIXEL));
+            }
+            else
+            {
+                /* Start a new run */
+                pgO = GdiAllocBatchCommand(hdc, GdiBCSetPixel);
+                if (!pgO) return SetPixel(hdc, x, y, crColor) != CLR_INVALID;
+
+                pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+                pgO->Count = 0;
+                /* Snapshot attributes */
+                GdiSnapshotDrawAttr(&pgO->gbAttr, pdcattr);
+                NtCurrentTeb()->GdiThreadLocalInfo = pgO;
+            }
+
+            pPixel = &pgO->Pixels[pgO->Count++];
+            pPixel->x = x;
+            pPixel->y = y;
+            pPixel->crColor = crColor;
+            return TRUE;
+        }
+    }
+
     return SetPixel(hdc, x, y, crColor) != CLR_INVALID;
 }
 
@@ -547,66 +547,56 @@ ExtTextOutW(
         else if ( cwc <= ((GDIBATCHBUFSIZE - sizeof(GDIBSTEXTOUT)) / sizeof(WCHAR)) )
         {
             PGDIBSTEXTOUT pgO;
-            PTEB pTeb = NtCurrentTeb();
+            ULONG cjSize = 0;
+            ULONG DxSize = 0;
 
-            pgO = GdiAllocBatchCommand(hdc, GdiBCTextOut);
-            if (pgO)
-            {
-                USHORT cjSize = 0;
-                ULONG DxSize = 0;
+            if (cwc > 2) cjSize = (cwc * sizeof(WCHAR)) - sizeof(pgO->String);
 
-                if (cwc > 2) cjSize = (cwc * sizeof(WCHAR)) - sizeof(pgO->String);
+            /* Calculate buffer size for string and Dx values */
+            if (lpDx)
+            {
+                /* If ETO_PDY is specified, we have pairs of INTs */
+                DxSize = (cwc * sizeof(INT)) * (fuOptions & ETO_PDY ? 2 : 1);
+                cjSize += DxSize;
+                // The structure buffer holds 4 bytes. Store Dx data then string.
+                // Result one wchar -> Buf[ Dx ]Str[wC], [4][2][X] one extra unused wchar
+                // to assure alignment of 4.
+            }
 
-                /* Calculate buffer size for string and Dx values */
-                if (lpDx)
+            /* This flushes the batch first, if the rest of it is too small */
+            pgO = GdiAllocBatchCommandEx(hdc, GdiBCTextOut, cjSize);
+            if (pgO)
+            {
+                pdcattr->ulDirty_ |= DC_MODE_DIRTY|DC_FONTTEXT_DIRTY;
+                pgO->cbCount = cwc;
+                pgO->x = x;
+                pgO->y = y;
+                pgO->Options = fuOptions;
+                pgO->iCS_CP = 0;
+
+                if (lprc) pgO->Rect = *lprc;
+                else
                 {
-                    /* If ETO_PDY is specified, we have pairs of INTs */
-                    DxSize = (cwc * sizeof(INT)) * (fuOptions & ETO_PDY ? 2 : 1);
-                    cjSize += DxSize;
-                    // The structure buffer holds 4 bytes. Store Dx data then string.
-                    // Result one wchar -> Buf[ Dx ]Str[wC], [4][2][X] one extra unused wchar
-                    // to assure alignment of 4.
+                   pgO->Options |= GDIBS_NORECT; // Tell the other side lprc is nill.
                 }
 
-                if ((pTeb->GdiTebBatch.Offset + cjSize ) <= GDIBATCHBUFSIZE)
-                {
-                    pdcattr->ulDirty_ |= DC_MODE_DIRTY|DC_FONTTEXT_DIRTY;
-                    pgO->cbCount = cwc;
-                    pgO->x = x;
-                    pgO->y = y;
-                    pgO->Options = fuOptions;
-                    pgO->iCS_CP = 0;
-
-                    if (lprc) pgO->Rect = *lprc;
-                    else
-                    {
-                       pgO->Options |= GDIBS_NORECT; // Tell the other side lprc is nill.
-                    }
-
-                    /* Snapshot attributes */
-                    pgO->crForegroundClr = pdcattr->crForegroundClr;
-                    pgO->crBackgroundClr = pdcattr->crBackgroundClr;
-                    pgO->ulForegroundClr = pdcattr->ulForegroundClr;
-                    pgO->ulBackgroundClr = pdcattr->ulBackgroundClr;
-                    pgO->lBkMode         = pdcattr->lBkMode == OPAQUE ? OPAQUE : TRANSPARENT;
-                    pgO->hlfntNew        = pdcattr->hlfntNew;
-                    pgO->flTextAlign     = pdcattr->flTextAlign;
-                    pgO->ptlViewportOrg  = pdcattr->ptlViewportOrg;
+                /* Snapshot attributes */
+                pgO->crForegroundClr = pdcattr->crForegroundClr;
+                pgO->crBackgroundClr = pdcattr->crBackgroundClr;
+                pgO->ulForegroundClr = pdcattr->ulForegroundClr;
+                pgO->ulBackgroundClr = pdcattr->ulBackgroundClr;
+                pgO->lBkMode         = pdcattr->lBkMode == OPAQUE ? OPAQUE : TRANSPARENT;
+                pgO->hlfntNew        = pdcattr->hlfntNew;
+                pgO->flTextAlign     = pdcattr->flTextAlign;
+                pgO->ptlViewportOrg  = pdcattr->ptlViewportOrg;
 
-                    pgO->Size = DxSize; // of lpDx then string after.
-                    /* Put the Dx before the String to assure alignment of 4 */
-                    if (lpDx) RtlCopyMemory( &pgO->Buffer, lpDx, DxSize);
+                pgO->Size = DxSize; // of lpDx then string after.
+                /* Put the Dx before the String to assure alignment of 4 */
+                if (lpDx) RtlCopyMemory( &pgO->Buffer, lpDx, DxSize);
 
-                    if (cwc) RtlCopyMemory( &pgO->String[DxSize/sizeof(WCHAR)], lpString, cwc * sizeof(WCHAR));
+                if (cwc) RtlCopyMemory( &pgO->String[DxSize/sizeof(WCHAR)], lpString, cwc * sizeof(WCHAR));
 
-                    // Recompute offset and return size
-                    pTeb->GdiTebBatch.Offset += cjSize;
-                    ((PGDIBATCHHDR)pgO)->Size += cjSize;
-                    return TRUE;
-                }
-                // Reset offset and count then fall through
-                pTeb->GdiTebBatch.Offset -= sizeof(GDIBSTEXTOUT);
-                pTeb->GdiBatchCount--;
+                return TRUE;
             }
         }
     }
@@ -1358,36 +1358,19 @@ NtGdiInvertRgn(
     return bResult;
 }
 
-COLORREF
-APIENTRY
-NtGdiSetPixel(
-    _In_ HDC hdc,
+/* Sets a pixel to a color in the target format, the DC must have a surface */
+BOOL
+FASTCALL
+IntSetPixel(
+    _In_ PDC pdc,
     _In_ INT x,
     _In_ INT y,
-    _In_ COLORREF crColor)
+    _In_ ULONG iSolidColor)
 {
-    PDC pdc;
-    ULONG iOldColor, iSolidColor;
+    ULONG iOldColor;
     BOOL bResult;
     PEBRUSHOBJ pebo;
     ULONG ulDirty;
-    EXLATEOBJ exlo;
-
-    /* Lock the DC */
-    pdc = DC_LockDc(hdc);
-    if (!pdc)
-    {
-        EngSetLastError(ERROR_INVALID_HANDLE);
-        return -1;
-    }
-
-    /* Check if the DC has no surface (empty mem or info DC) */
-    if (pdc->dclevel.pSurface == NULL)
-    {
-        /* Fail! */
-        DC_UnlockDc(pdc);
-        return -1;
-    }
 
     if (pdc->fs & (DC_ACCUM_APP|DC_ACCUM_WMGR))
     {
@@ -1405,9 +1388,6 @@ NtGdiSetPixel(
        IntUpdateBoundsRect(pdc, &rcDst);
     }
 
-    /* Translate the color to the target format */
-    iSolidColor = TranslateCOLORREF(pdc, crColor);
-
     /* Use the DC's text brush, which is always a solid brush */
     pebo = &pdc->eboText;
 
@@ -1425,6 +1405,44 @@ NtGdiSetPixel(
     EBRUSHOBJ_iSetSolidColor(pebo, iOldColor);
     pdc->pdcattr->ulDirty_ = ulDirty;
 
+    return bResult;
+}
+
+COLORREF
+APIENTRY
+NtGdiSetPixel(
+    _In_ HDC hdc,
+    _In_ INT x,
+    _In_ INT y,
+    _In_ COLORREF crColor)
+{
+    PDC pdc;
+    ULONG iSolidColor;
+    BOOL bResult;
+    EXLATEOBJ exlo;
+
+    /* Lock the DC */
+    pdc = DC_LockDc(hdc);
+    if (!pdc)
+    {
+        EngSetLastError(ERROR_INVALID_HANDLE);
+        return -1;
+    }
+
+    /* Check if the DC has no surface (empty mem or info DC) */
+    if (pdc->dclevel.pSurface == NULL)
+    {
+        /* Fail! */
+        DC_UnlockDc(pdc);
+        return -1;
+    }
+
+    /* Translate the color to the target format */
+    iSolidColor = TranslateCOLORREF(pdc, crColor);
+
+    /* Call the internal function */
+    bResult = IntSetPixel(pdc, x, y, iSolidColor);
+
     /// FIXME: we shouldn't dereference pSurface while the PDEV is not locked!
     /* Initialize an XLATEOBJ from the target surface to RGB */
     EXLATEOBJ_vInitialize(&exlo,
@@ -25,9 +25,14 @@ typedef struct _FONT_ENTRY_COLL_MEM
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;       /* Eviction list, most recently used first */
+    LIST_ENTRY HashEntry;       /* Hash bucket list */
+    ULONG Hash;
+    SIZE_T Size;                /* Bytes charged to the glyph cache */
     int GlyphIndex;
     FT_Face Face;
+    PSHARED_FACE SharedFace;
+    BOOLEAN Referenced;         /* Hit since eviction last looked at it */
     FT_BitmapGlyph BitmapGlyph;
     int Height;
     int Width;
@@ -56,8 +56,11 @@ static UNICODE_STRING g_FontRegPath =
 
 
 /* The FreeType library is not thread safe, so we have
-   to serialize access to it */
-static PFAST_MUTEX      g_FreeTypeLock;
+   to serialize access to it. Text output and extents only take
+   this lock shared plus the lock of the face they use, so that
+   different faces are rasterized in parallel. Anything that creates,
+   destroys or enumerates faces takes it exclusive */
+static PERESOURCE       g_FreeTypeLock;
 
 static LIST_ENTRY       g_FontListHead;
 static PFAST_MUTEX      g_FontListLock;
@@ -73,21 +76,64 @@ static BOOL             g_RenderingEnabled = TRUE;
     ASSERT(g_FontListLock->Owner == KeGetCurrentThread())
 
 #define IntLockFreeType() \
-    ExEnterCriticalRegionAndAcquireFastMutexUnsafe(g_FreeTypeLock)
+    ExEnterCriticalRegionAndAcquireResourceExclusive(g_FreeTypeLock)
+
+#define IntLockFreeTypeShared() \
+    ExEnterCriticalRegionAndAcquireResourceShared(g_FreeTypeLock)
 
 #define IntUnLockFreeType() \
-    ExReleaseFastMutexUnsafeAndLeaveCriticalRegion(g_FreeTypeLock)
+    ExReleaseResourceAndLeaveCriticalRegion(g_FreeTypeLock)
 
 #define ASSERT_FREETYPE_LOCK_HELD() \
-    ASSERT(g_FreeTypeLock->Owner == KeGetCurrentThread())
+    ASSERT(ExIsResourceAcquiredExclusiveLite(g_FreeTypeLock))
 
 #define ASSERT_FREETYPE_LOCK_NOT_HELD() \
-    ASSERT(g_FreeTypeLock->Owner != KeGetCurrentThread())
+    ASSERT(!ExIsResourceAcquiredSharedLite(g_FreeTypeLock))
+
+/* Must be called with the FreeType lock held shared */
+#define IntLockFace(SharedFace) \
+    ExEnterCriticalRegionAndAcquireFastMutexUnsafe((SharedFace)->Lock)
+
+#define IntUnLockFace(SharedFace) \
+    ExReleaseFastMutexUnsafeAndLeaveCriticalRegion((SharedFace)->Lock)
+
+/* The FreeType lock held exclusive covers all the faces */
+#define ASSERT_FACE_LOCK_HELD(SharedFace) \
+    ASSERT(ExIsResourceAcquiredExclusiveLite(g_FreeTypeLock) || \
+           (SharedFace)->Lock->Owner == KeGetCurrentThread())
+
+/* The glyph cache has its own lock, taken after the FreeType and face locks.
+   Lookups take it shared */
+static PERESOURCE g_FontCacheLock;
+
+#define IntLockFontCache() \
+    ExEnterCriticalRegionAndAcquireResourceExclusive(g_FontCacheLock)
+
+#define IntLockFontCacheShared() \
+    ExEnterCriticalRegionAndAcquireResourceShared(g_FontCacheLock)
 
-#define MAX_FONT_CACHE 256
+#define IntUnLockFontCache() \
+    ExReleaseResourceAndLeaveCriticalRegion(g_FontCacheLock)
+
+#define ASSERT_FONT_CACHE_LOCK_HELD() \
+    ASSERT(ExIsResourceAcquiredExclusiveLite(g_FontCacheLock))
+
+/* Glyph cache limits, in bytes. The limit can be set in kilobytes with the
+   GlyphCacheSize value of the GRE_Initialize key */
+#define FONT_CACHE_DEFAULT_SIZE (1024 * 1024)
+#define FONT_CACHE_MIN_SIZE     (64 * 1024)
+#define FONT_CACHE_MAX_SIZE     (64 * 1024 * 1024)
+
+#define FONT_CACHE_HASH_SIZE    2048    /* Must be a power of two */
 
 static LIST_ENTRY g_FontCacheListHead;
+static LIST_ENTRY g_FontCacheHashTable[FONT_CACHE_HASH_SIZE];
 static UINT g_FontCacheNumEntries;
+static SIZE_T g_FontCacheSize;
+static SIZE_T g_FontCacheMaxSize = FONT_CACHE_DEFAULT_SIZE;
+static LONG g_FontCacheHits;
+static LONG g_FontCacheMisses;
+static ULONG g_FontCacheEvictions;
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -213,6 +259,15 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
     Ptr = ExAllocatePoolWithTag(PagedPool, sizeof(SHARED_FACE), TAG_FONT);
     if (Ptr)
     {
+        /* Fast Mutexes must be allocated from non paged pool */
+        Ptr->Lock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
+        if (Ptr->Lock == NULL)
+        {
+            ExFreePoolWithTag(Ptr, TAG_FONT);
+            return NULL;
+        }
+        ExInitializeFastMutex(Ptr->Lock);
+
         Ptr->Face = Face;
         Ptr->RefCount = 1;
         Ptr->Memory = Memory;
@@ -252,13 +307,15 @@ SharedFace_AddRef(PSHARED_FACE Ptr)
 static void
 RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 {
-    ASSERT_FREETYPE_LOCK_HELD();
+    ASSERT_FONT_CACHE_LOCK_HELD();
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
+    RemoveEntryList(&Entry->HashEntry);
+    ASSERT(g_FontCacheSize >= Entry->Size);
+    g_FontCacheSize -= Entry->Size;
     ExFreePoolWithTag(Entry, TAG_FONT);
     g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
 }
 
 static void
@@ -269,6 +326,7 @@ RemoveCacheEntries(FT_Face Face)
 
     ASSERT_FREETYPE_LOCK_HELD();
 
+    IntLockFontCache();
     for (CurrentEntry = g_FontCacheListHead.Flink;
          CurrentEntry != &g_FontCacheListHead;
          CurrentEntry = NextEntry)
@@ -281,6 +339,7 @@ RemoveCacheEntries(FT_Face Face)
             RemoveCachedEntry(FontEntry);
         }
     }
+    IntUnLockFontCache();
 }
 
 static void SharedMem_Release(PSHARED_MEM Ptr)
@@ -328,6 +387,7 @@ SharedFace_Release(PSHARED_FACE Ptr)
         SharedMem_Release(Ptr->Memory);
         SharedFaceCache_Release(&Ptr->EnglishUS);
         SharedFaceCache_Release(&Ptr->UserLanguage);
+        ExFreePoolWithTag(Ptr->Lock, TAG_INTERNAL_SYNC);
         ExFreePoolWithTag(Ptr, TAG_FONT);
     }
     IntUnLockFreeType();
@@ -652,14 +712,41 @@ IntLoadFontSubstList(PLIST_ENTRY pHead)
     return NT_SUCCESS(Status);
 }
 
+static VOID
+IntLoadGlyphCacheSettings(VOID)
+{
+    NTSTATUS Status;
+    HKEY hKey;
+    DWORD dwValue;
+
+    Status = RegOpenKey(L"\\Registry\\Machine\\Software\\Microsoft\\Windows NT\\CurrentVersion\\GRE_Initialize",
+                        &hKey);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* In kilobytes */
+    if (RegReadDWORD(hKey, L"GlyphCacheSize", &dwValue))
+    {
+        dwValue = min(dwValue, FONT_CACHE_MAX_SIZE / 1024);
+        g_FontCacheMaxSize = max((SIZE_T)dwValue * 1024, FONT_CACHE_MIN_SIZE);
+    }
+
+    ZwClose(hKey);
+}
+
 BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    ULONG i;
 
     InitializeListHead(&g_FontListHead);
     InitializeListHead(&g_FontCacheListHead);
+    for (i = 0; i < FONT_CACHE_HASH_SIZE; ++i)
+        InitializeListHead(&g_FontCacheHashTable[i]);
     g_FontCacheNumEntries = 0;
+    g_FontCacheSize = 0;
+    IntLoadGlyphCacheSettings();
     /* Fast Mutexes must be allocated from non paged pool */
     g_FontListLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FontListLock == NULL)
@@ -668,12 +755,20 @@ InitFontSupport(VOID)
     }
 
     ExInitializeFastMutex(g_FontListLock);
-    g_FreeTypeLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
+    /* So are resources */
+    g_FreeTypeLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(ERESOURCE), TAG_INTERNAL_SYNC);
     if (g_FreeTypeLock == NULL)
     {
         return FALSE;
     }
-    ExInitializeFastMutex(g_FreeTypeLock);
+    ExInitializeResourceLite(g_FreeTypeLock);
+
+    g_FontCacheLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(ERESOURCE), TAG_INTERNAL_SYNC);
+    if (g_FontCacheLock == NULL)
+    {
+        return FALSE;
+    }
+    ExInitializeResourceLite(g_FontCacheLock);
 
     ulError = FT_Init_FreeType(&g_FreeTypeLibrary);
     if (ulError)
@@ -2971,25 +3066,64 @@ SameScaleMatrix(
             FLOATOBJ_Equal(&pmx1->efM22, &pmx2->efM22));
 }
 
+/* The matrix is compared but not hashed, glyphs of the same
+   size rarely come in many different transformations */
+static
+ULONG
+GlyphCacheHash(
+    FT_Face Face,
+    INT GlyphIndex,
+    INT Height,
+    FT_Render_Mode RenderMode)
+{
+    ULONG Hash;
+
+    Hash = (ULONG)((ULONG_PTR)Face >> 4);
+    Hash = Hash * 0x9E3779B1 ^ (ULONG)GlyphIndex;
+    Hash = Hash * 0x9E3779B1 ^ (ULONG)Height;
+    Hash = Hash * 0x9E3779B1 ^ (ULONG)RenderMode;
+    return Hash ^ (Hash >> 16);
+}
+
+/* The glyphs of a face are only used with its lock held. While another
+   thread owns it, the glyphs it got from the cache must stay alive */
+static
+BOOL
+GlyphCacheFaceInUse(PSHARED_FACE SharedFace)
+{
+    PKTHREAD Owner = SharedFace->Lock->Owner;
+
+    return (Owner != NULL && Owner != KeGetCurrentThread());
+}
+
 FT_BitmapGlyph APIENTRY
 ftGdiGlyphCacheGet(
-    FT_Face Face,
+    PSHARED_FACE SharedFace,
     INT GlyphIndex,
     INT Height,
     FT_Render_Mode RenderMode,
     PMATRIX pmx)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, Bucket;
     PFONT_CACHE_ENTRY FontEntry;
+    FT_BitmapGlyph BitmapGlyph;
+    FT_Face Face = SharedFace->Face;
+    ULONG Hash;
 
-    ASSERT_FREETYPE_LOCK_HELD();
+    ASSERT_FACE_LOCK_HELD(SharedFace);
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    Hash = GlyphCacheHash(Face, GlyphIndex, Height, RenderMode);
+    Bucket = &g_FontCacheHashTable[Hash & (FONT_CACHE_HASH_SIZE - 1)];
+
+    IntLockFontCacheShared();
+
+    for (CurrentEntry = Bucket->Flink;
+         CurrentEntry != Bucket;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        if ((FontEntry->Face == Face) &&
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
+        if ((FontEntry->Hash == Hash) &&
+            (FontEntry->Face == Face) &&
             (FontEntry->GlyphIndex == GlyphIndex) &&
             (FontEntry->Height == Height) &&
             (FontEntry->RenderMode == RenderMode) &&
@@ -2997,14 +3131,21 @@ ftGdiGlyphCacheGet(
             break;
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == Bucket)
     {
+        IntUnLockFontCache();
+        InterlockedIncrement(&g_FontCacheMisses);
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
-    return FontEntry->BitmapGlyph;
+    /* The LRU list can't be touched with the lock held shared. Mark the
+       glyph instead, eviction gives it a second chance */
+    FontEntry->Referenced = TRUE;
+    BitmapGlyph = FontEntry->BitmapGlyph;
+    IntUnLockFontCache();
+
+    InterlockedIncrement(&g_FontCacheHits);
+    return BitmapGlyph;
 }
 
 /* no cache */
@@ -3051,7 +3192,7 @@ ftGdiGlyphSet(
 
 FT_BitmapGlyph APIENTRY
 ftGdiGlyphCacheSet(
-    FT_Face Face,
+    PSHARED_FACE SharedFace,
     INT GlyphIndex,
     INT Height,
     PMATRIX pmx,
@@ -3060,11 +3201,13 @@ ftGdiGlyphCacheSet(
 {
     FT_Glyph GlyphCopy;
     INT error;
-    PFONT_CACHE_ENTRY NewEntry;
+    PFONT_CACHE_ENTRY NewEntry, FontEntry;
     FT_Bitmap AlignedBitmap;
     FT_BitmapGlyph BitmapGlyph;
+    FT_Face Face = SharedFace->Face;
+    UINT Scanned;
 
-    ASSERT_FREETYPE_LOCK_HELD();
+    ASSERT_FACE_LOCK_HELD(SharedFace);
 
     error = FT_Get_Glyph(GlyphSlot, &GlyphCopy);
     if (error)
@@ -3105,18 +3248,49 @@ ftGdiGlyphCacheSet(
 
     NewEntry->GlyphIndex = GlyphIndex;
     NewEntry->Face = Face;
+    NewEntry->SharedFace = SharedFace;
+    NewEntry->Referenced = FALSE;
     NewEntry->BitmapGlyph = BitmapGlyph;
     NewEntry->Height = Height;
     NewEntry->RenderMode = RenderMode;
     NewEntry->mxWorldToDevice = *pmx;
+    NewEntry->Hash = GlyphCacheHash(Face, GlyphIndex, Height, RenderMode);
+    NewEntry->Size = sizeof(FONT_CACHE_ENTRY) + sizeof(FT_BitmapGlyphRec) +
+                     (SIZE_T)abs(BitmapGlyph->bitmap.pitch) * BitmapGlyph->bitmap.rows;
+
+    IntLockFontCache();
 
     InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
-    {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
+    InsertHeadList(&g_FontCacheHashTable[NewEntry->Hash & (FONT_CACHE_HASH_SIZE - 1)],
+                   &NewEntry->HashEntry);
+    g_FontCacheSize += NewEntry->Size;
+    ++g_FontCacheNumEntries;
+
+    /* Evict from the tail of the LRU list. Glyphs that were hit since they
+       were last looked at, glyphs of faces other threads are rendering with
+       and the one we return go back to the front instead. If everything is
+       in use, the cache stays over its limit until the next insertion */
+    Scanned = 0;
+    while ((g_FontCacheSize > g_FontCacheMaxSize) &&
+           (Scanned++ < 2 * g_FontCacheNumEntries))
+    {
+        FontEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
+        if (FontEntry == NewEntry ||
+            FontEntry->Referenced ||
+            GlyphCacheFaceInUse(FontEntry->SharedFace))
+        {
+            FontEntry->Referenced = FALSE;
+            RemoveEntryList(&FontEntry->ListEntry);
+            InsertHeadList(&g_FontCacheListHead, &FontEntry->ListEntry);
+            continue;
+        }
+
+        RemoveCachedEntry(FontEntry);
+        ++g_FontCacheEvictions;
     }
 
+    IntUnLockFontCache();
+
     return BitmapGlyph;
 }
 
@@ -3346,7 +3520,7 @@ IntRequestFontSize(PDC dc, PFONTGDI FontGDI, LONG lfWidth, LONG lfHeight)
     if (lfHeight == -1)
         lfHeight = -2;
 
-    ASSERT_FREETYPE_LOCK_HELD();
+    ASSERT_FACE_LOCK_HELD(FontGDI->SharedFace);
     pOS2 = (TT_OS2 *)FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
     pHori = (TT_HoriHeader *)FT_Get_Sfnt_Table(face, FT_SFNT_HHEA);
 
@@ -4061,6 +4235,7 @@ TextIntGetTextExtentPoint(PDC dc,
                           FLONG fl)
 {
     PFONTGDI FontGDI;
+    PSHARED_FACE SharedFace;
     FT_Face face;
     FT_GlyphSlot glyph;
     FT_BitmapGlyph realglyph;
@@ -4076,13 +4251,15 @@ TextIntGetTextExtentPoint(PDC dc,
 
     FontGDI = ObjToGDI(TextObj->Font, FONT);
 
-    face = FontGDI->SharedFace->Face;
+    SharedFace = FontGDI->SharedFace;
+    face = SharedFace->Face;
     if (NULL != Fit)
     {
         *Fit = 0;
     }
 
-    IntLockFreeType();
+    IntLockFreeTypeShared();
+    IntLockFace(SharedFace);
 
     TextIntUpdateSize(dc, TextObj, FontGDI, FALSE);
 
@@ -4110,7 +4287,7 @@ TextIntGetTextExtentPoint(PDC dc,
         if (EmuBold || EmuItalic)
             realglyph = NULL;
         else
-            realglyph = ftGdiGlyphCacheGet(face, glyph_index, plf->lfHeight,
+            realglyph = ftGdiGlyphCacheGet(SharedFace, glyph_index, plf->lfHeight,
                                            RenderMode, pmxWorldToDevice);
 
         if (EmuBold || EmuItalic || !realglyph)
@@ -4133,7 +4310,7 @@ TextIntGetTextExtentPoint(PDC dc,
             }
             else
             {
-                realglyph = ftGdiGlyphCacheSet(face,
+                realglyph = ftGdiGlyphCacheSet(SharedFace,
                                                glyph_index,
                                                plf->lfHeight,
                                                pmxWorldToDevice,
@@ -4179,6 +4356,7 @@ TextIntGetTextExtentPoint(PDC dc,
     ASSERT(FontGDI->Magic == FONTGDI_MAGIC);
     ascender = FontGDI->tmAscent; /* Units above baseline */
     descender = FontGDI->tmDescent; /* Units below baseline */
+    IntUnLockFace(SharedFace);
     IntUnLockFreeType();
 
     Size->cx = (TotalWidth64 + 32) >> 6;
@@ -5720,6 +5898,7 @@ IntExtTextOutW(
     SURFOBJ *SurfObj;
     SURFACE *psurf = NULL;
     int error, glyph_index, i;
+    PSHARED_FACE SharedFace;
     FT_Face face;
     FT_GlyphSlot glyph;
     FT_BitmapGlyph realglyph;
@@ -5868,8 +6047,11 @@ IntExtTextOutW(
     FontGDI = ObjToGDI(FontObj, FONT);
     ASSERT(FontGDI);
 
-    IntLockFreeType();
-    face = FontGDI->SharedFace->Face;
+    SharedFace = FontGDI->SharedFace;
+    face = SharedFace->Face;
+
+    IntLockFreeTypeShared();
+    IntLockFace(SharedFace);
 
     plf = &TextObj->logfont.elfEnumLogfontEx.elfLogFont;
     EmuBold = (plf->lfWeight >= FW_BOLD && FontGDI->OriginalWeight <= FW_NORMAL);
@@ -5882,6 +6064,7 @@ IntExtTextOutW(
 
     if (!TextIntUpdateSize(dc, TextObj, FontGDI, FALSE))
     {
+        IntUnLockFace(SharedFace);
         IntUnLockFreeType();
         bResult = FALSE;
         goto Cleanup;
@@ -5952,7 +6135,7 @@ IntExtTextOutW(
             if (EmuBold || EmuItalic)
                 realglyph = NULL;
             else
-                realglyph = ftGdiGlyphCacheGet(face, glyph_index, plf->lfHeight,
+                realglyph = ftGdiGlyphCacheGet(SharedFace, glyph_index, plf->lfHeight,
                                                RenderMode, pmxWorldToDevice);
             if (!realglyph)
             {
@@ -5973,7 +6156,7 @@ IntExtTextOutW(
                 }
                 else
                 {
-                    realglyph = ftGdiGlyphCacheSet(face,
+                    realglyph = ftGdiGlyphCacheSet(SharedFace,
                                                    glyph_index,
                                                    plf->lfHeight,
                                                    pmxWorldToDevice,
@@ -5983,6 +6166,7 @@ IntExtTextOutW(
                 if (!realglyph)
                 {
                     DPRINT1("Failed to render glyph! [index: %d]\n", glyph_index);
+                    IntUnLockFace(SharedFace);
                     IntUnLockFreeType();
                     goto Cleanup;
                 }
@@ -6055,6 +6239,7 @@ IntExtTextOutW(
             if (error)
             {
                 DPRINT1("Failed to load and render glyph! [index: %d]\n", glyph_index);
+                IntUnLockFace(SharedFace);
                 IntUnLockFreeType();
                 goto Cleanup;
             }
@@ -6068,6 +6253,7 @@ IntExtTextOutW(
             if (!realglyph)
             {
                 DPRINT1("Failed to render glyph! [index: %d]\n", glyph_index);
+                IntUnLockFace(SharedFace);
                 IntUnLockFreeType();
                 goto Cleanup;
             }
@@ -6169,7 +6355,7 @@ IntExtTextOutW(
         if (EmuBold || EmuItalic)
             realglyph = NULL;
         else
-            realglyph = ftGdiGlyphCacheGet(face, glyph_index, plf->lfHeight,
+            realglyph = ftGdiGlyphCacheGet(SharedFace, glyph_index, plf->lfHeight,
                                            RenderMode, pmxWorldToDevice);
         if (!realglyph)
         {
@@ -6192,7 +6378,7 @@ IntExtTextOutW(
             }
             else
             {
-                realglyph = ftGdiGlyphCacheSet(face,
+                realglyph = ftGdiGlyphCacheSet(SharedFace,
                                                glyph_index,
                                                plf->lfHeight,
                                                pmxWorldToDevice,
@@ -6414,6 +6600,7 @@ IntExtTextOutW(
         pdcattr->ptlCurrent.x = DestRect.right - dc->ptlDCOrig.x;
     }
 
+    IntUnLockFace(SharedFace);
     IntUnLockFreeType();
 
     EXLATEOBJ_vCleanup(&exloRGB2Dst);
@@ -7153,4 +7340,72 @@ ErrorRet:
     return GDI_ERROR;
 }
 
+/*
+ * @implemented
+ * Only GS_GLYPH_CACHE_INFO and GS_GDI_BATCH_INFO are supported. The batch
+ * statistics are those of the calling process.
+ */
+NTSTATUS
+APIENTRY
+NtGdiGetStats(
+    IN HANDLE hProcess,
+    IN INT iIndex,
+    IN INT iPidType,
+    OUT PVOID pResults,
+    IN UINT cjResultSize)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    union
+    {
+        GLYPH_CACHE_INFO GlyphCache;
+        GDI_BATCH_INFO GdiBatch;
+    } Info;
+    ULONG cjInfo;
+    PPROCESSINFO ppi;
+
+    if (iIndex == GS_GLYPH_CACHE_INFO)
+        cjInfo = sizeof(Info.GlyphCache);
+    else if (iIndex == GS_GDI_BATCH_INFO)
+        cjInfo = sizeof(Info.GdiBatch);
+    else
+    {
+        UNIMPLEMENTED;
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (pResults == NULL || cjResultSize < cjInfo)
+        return STATUS_INVALID_PARAMETER;
+
+    if (iIndex == GS_GLYPH_CACHE_INFO)
+    {
+        IntLockFontCacheShared();
+        Info.GlyphCache.ulHits = g_FontCacheHits;
+        Info.GlyphCache.ulMisses = g_FontCacheMisses;
+        Info.GlyphCache.ulEvictions = g_FontCacheEvictions;
+        Info.GlyphCache.ulEntries = g_FontCacheNumEntries;
+        Info.GlyphCache.cjSize = g_FontCacheSize;
+        Info.GlyphCache.cjMaxSize = g_FontCacheMaxSize;
+        IntUnLockFontCache();
+    }
+    else
+    {
+        ppi = PsGetCurrentProcessWin32Process();
+        Info.GdiBatch.ulFlushes = ppi->cGdiBatchFlushes;
+        Info.GdiBatch.ulCommands = ppi->cGdiBatchCommands;
+    }
+
+    _SEH2_TRY
+    {
+        ProbeForWrite(pResults, cjInfo, 1);
+        RtlCopyMemory(pResults, &Info, cjInfo);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    return Status;
+}
+
 /* EOF */
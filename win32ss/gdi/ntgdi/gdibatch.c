@@ -5,6 +5,7 @@
 #include <debug.h>
 
 BOOL FASTCALL IntPatBlt( PDC,INT,INT,INT,INT,DWORD,PEBRUSHOBJ);
+BOOL FASTCALL IntSetPixel( PDC,INT,INT,ULONG);
 BOOL APIENTRY IntExtTextOutW(IN PDC,IN INT,IN INT,IN UINT,IN OPTIONAL PRECTL,IN LPCWSTR,IN INT,IN OPTIONAL LPINT,IN DWORD);
 
 
@@ -62,6 +63,60 @@ SynchronizeDriver(FLONG Flags)
   return;
 }
 
+//
+// Load the attribute snapshot of a drawing command into the DC. The
+// application may have changed the attributes since, so the current
+// ones are saved to pgSave, to be loaded back afterwards.
+//
+static
+VOID
+FASTCALL
+GdiLoadDrawAttr(PDC dc, PGDIBSDRAWATTR pgAttr, PGDIBSDRAWATTR pgSave)
+{
+  PDC_ATTR pdcattr = dc->pdcattr;
+  GDIBSDRAWATTR Attr = *pgAttr; // The batch is in user memory.
+
+  if (pgSave)
+  {
+     pgSave->hpen            = pdcattr->hpen;
+     pgSave->hbrush          = pdcattr->hbrush;
+     pgSave->crForegroundClr = pdcattr->crForegroundClr;
+     pgSave->crBackgroundClr = pdcattr->crBackgroundClr;
+     pgSave->crBrushClr      = pdcattr->crBrushClr;
+     pgSave->crPenClr        = pdcattr->crPenClr;
+     pgSave->ulForegroundClr = pdcattr->ulForegroundClr;
+     pgSave->ulBackgroundClr = pdcattr->ulBackgroundClr;
+     pgSave->ulBrushClr      = pdcattr->ulBrushClr;
+     pgSave->ulPenClr        = pdcattr->ulPenClr;
+     pgSave->ptlViewportOrg  = pdcattr->ptlViewportOrg;
+  }
+
+  // Set the dirty flags for whatever differs.
+  if (pdcattr->hpen != Attr.hpen)
+     pdcattr->ulDirty_ |= DC_PEN_DIRTY;
+  if (pdcattr->hbrush != Attr.hbrush)
+     pdcattr->ulDirty_ |= DC_BRUSH_DIRTY;
+  if (pdcattr->crForegroundClr != Attr.crForegroundClr ||
+      pdcattr->crBackgroundClr != Attr.crBackgroundClr)
+     pdcattr->ulDirty_ |= (DIRTY_FILL|DIRTY_LINE|DIRTY_TEXT|DIRTY_BACKGROUND);
+  if (pdcattr->ptlViewportOrg.x != Attr.ptlViewportOrg.x ||
+      pdcattr->ptlViewportOrg.y != Attr.ptlViewportOrg.y)
+     pdcattr->flXform |= (PAGE_XLATE_CHANGED|WORLD_XFORM_CHANGED|DEVICE_TO_WORLD_INVALID);
+
+  // The DC brush and pen colors are set on every update.
+  pdcattr->hpen            = Attr.hpen;
+  pdcattr->hbrush          = Attr.hbrush;
+  pdcattr->crForegroundClr = Attr.crForegroundClr;
+  pdcattr->crBackgroundClr = Attr.crBackgroundClr;
+  pdcattr->crBrushClr      = Attr.crBrushClr;
+  pdcattr->crPenClr        = Attr.crPenClr;
+  pdcattr->ulForegroundClr = Attr.ulForegroundClr;
+  pdcattr->ulBackgroundClr = Attr.ulBackgroundClr;
+  pdcattr->ulBrushClr      = Attr.ulBrushClr;
+  pdcattr->ulPenClr        = Attr.ulPenClr;
+  pdcattr->ptlViewportOrg  = Attr.ptlViewportOrg;
+}
+
 //
 // Process the batch.
 //
@@ -413,6 +468,88 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         break;
      }
 
+     case GdiBCLineTo:
+     {
+        PGDIBSLINETO pgO;
+        GDIBSDRAWATTR SaveAttr;
+        POINTL ptlCurrent, ptlEnd;
+        RECTL rcLockRect;
+        DWORD flags;
+        BOOL Ret;
+        if (!dc || Size < sizeof(GDIBSLINETO)) break;
+        pgO = (PGDIBSLINETO) pHdr;
+        ptlEnd = pgO->ptlEnd;
+        // Set the attribute snapshot
+        GdiLoadDrawAttr(dc, &pgO->gbAttr, &SaveAttr);
+        // Start from where the application did. gdi32 keeps ptlCurrent
+        // ahead of us, ptfxCurrent is ours.
+        ptlCurrent = pdcattr->ptlCurrent;
+        flags = pdcattr->ulDirty_ & (DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+        pdcattr->ptlCurrent = pgO->ptlStart;
+        pdcattr->ulDirty_ &= ~(DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+        pdcattr->ulDirty_ |= pgO->flDirty & (DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+
+        rcLockRect.left = pdcattr->ptlCurrent.x;
+        rcLockRect.top = pdcattr->ptlCurrent.y;
+        rcLockRect.right = ptlEnd.x;
+        rcLockRect.bottom = ptlEnd.y;
+        IntLPtoDP(dc, (LPPOINT)&rcLockRect, 2);
+        RECTL_vOffsetRect(&rcLockRect, dc->ptlDCOrig.x, dc->ptlDCOrig.y);
+
+        DC_vPrepareDCsForBlit(dc, &rcLockRect, NULL, NULL);
+        Ret = IntGdiLineTo(dc, ptlEnd.x, ptlEnd.y);
+        DC_vFinishBlit(dc, NULL);
+
+        // Restore the current position and attributes
+        pdcattr->ptlCurrent = ptlCurrent;
+        pdcattr->ulDirty_ &= ~(DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+        pdcattr->ulDirty_ |= flags;
+        if (!Ret) pdcattr->ulDirty_ |= DIRTY_PTFXCURRENT;
+        GdiLoadDrawAttr(dc, &SaveAttr, NULL);
+        break;
+     }
+
+     case GdiBCRectangle:
+     {
+        PGDIBSRECTANGLE pgO;
+        GDIBSDRAWATTR SaveAttr;
+        RECTL rcl;
+        if (!dc || Size < sizeof(GDIBSRECTANGLE)) break;
+        pgO = (PGDIBSRECTANGLE) pHdr;
+        rcl = pgO->rcl;
+        // Set the attribute snapshot
+        GdiLoadDrawAttr(dc, &pgO->gbAttr, &SaveAttr);
+        IntGdiRectangle(dc, rcl.left, rcl.top, rcl.right, rcl.bottom);
+        // Restore attributes
+        GdiLoadDrawAttr(dc, &SaveAttr, NULL);
+        break;
+     }
+
+     case GdiBCSetPixel:
+     {
+        PGDIBSSETPIXEL pgO;
+        GDIBSDRAWATTR SaveAttr;
+        GDIBSPIXEL Pixel;
+        ULONG i, Count;
+        if (!dc || Size < sizeof(GDIBSSETPIXEL)) break;
+        /* Check if the DC has no surface (empty mem or info DC) */
+        if (dc->dclevel.pSurface == NULL) break;
+        pgO = (PGDIBSSETPIXEL) pHdr;
+        // Don't trust the count, the pixels must be within the command.
+        Count = min(pgO->Count,
+                    (Size - FIELD_OFFSET(GDIBSSETPIXEL, Pixels)) / sizeof(GDIBSPIXEL));
+        // Set the attribute snapshot
+        GdiLoadDrawAttr(dc, &pgO->gbAttr, &SaveAttr);
+        for (i = 0; i < Count; i++)
+        {
+            Pixel = pgO->Pixels[i];
+            IntSetPixel(dc, Pixel.x, Pixel.y, TranslateCOLORREF(dc, Pixel.crColor));
+        }
+        // Restore attributes
+        GdiLoadDrawAttr(dc, &SaveAttr, NULL);
+        break;
+     }
+
      case GdiBCSetBrushOrg:
      {
         PGDIBSSETBRHORG pgSBO;
@@ -500,12 +637,20 @@ NtGdiFlushUserBatch(VOID)
     {
       PCHAR pHdr = (PCHAR)&pTeb->GdiTebBatch.Buffer[0];
       PDC pDC = NULL;
+      PPROCESSINFO ppi = PsGetCurrentProcessWin32Process();
 
       if (GDI_HANDLE_GET_TYPE(hDC) == GDILoObjType_LO_DC_TYPE && GreIsHandleValid(hDC))
       {
           pDC = DC_LockDc(hDC);
       }
 
+       // Keep the statistics for GS_GDI_BATCH_INFO.
+       if (ppi)
+       {
+           InterlockedIncrement(&ppi->cGdiBatchFlushes);
+           InterlockedExchangeAdd(&ppi->cGdiBatchCommands, (LONG)GdiBatchCount);
+       }
+
        // No need to init anything, just go!
        for (; GdiBatchCount > 0; GdiBatchCount--)
        {
@@ -525,6 +670,8 @@ NtGdiFlushUserBatch(VOID)
        pTeb->GdiTebBatch.Offset = 0;
        pTeb->GdiBatchCount = 0;
        pTeb->GdiTebBatch.HDC = 0;
+       // The last command gdi32 remembers is gone too.
+       pTeb->GdiThreadLocalInfo = NULL;
     }
   }
 
@@ -61,6 +61,13 @@ GreMoveTo( HDC hdc,
 
 /* Shape functions */
 
+BOOL FASTCALL
+IntGdiRectangle(PDC dc,
+                int LeftRect,
+                int TopRect,
+                int RightRect,
+                int BottomRect);
+
 BOOL
 NTAPI
 GreGradientFill(
@@ -525,6 +525,9 @@ typedef BOOL (FASTCALL *nonOverlapProcp)(PREGION, PRECT, PRECT, INT, INT);
 
 #define RGN_DEFAULT_RECTS    2
 
+// Buffers up to this size are not shrunk after an operation
+#define RGN_KEEP_BUFFER_SIZE (64 * sizeof(RECTL))
+
 // Used to allocate buffers for points and link the buffers together
 typedef struct _POINTBLOCK
 {
@@ -972,6 +975,7 @@ REGION_RegionOp(
     INT ybot;                          /* Bottom of intersection */
     INT ytop;                          /* Top of intersection */
     RECTL *oldRects;                   /* Old rects for newReg */
+    ULONG cjNewSize;                   /* Buffer size for newReg */
     ULONG prevBand;                    /* Index of start of
                                         * Previous band in newReg */
     ULONG curBand;                     /* Index of start of current band in newReg */
@@ -1001,15 +1005,27 @@ REGION_RegionOp(
      * reallocate and copy the array, which is time consuming, yet we don't
      * have to worry about using too much memory. I hope to be able to
      * nuke the Xrealloc() at the end of this function eventually. */
-    newReg->rdh.nRgnSize = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
+    cjNewSize = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
 
-    newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                           newReg->rdh.nRgnSize,
-                                           TAG_REGION);
-    if (newReg->Buffer == NULL)
+    /* If newReg is not a source region, its buffer can be written right
+     * away, as long as it is large enough. */
+    if ((newReg != reg1) && (newReg != reg2) &&
+        (oldRects != &newReg->rdh.rcBound) &&
+        (newReg->rdh.nRgnSize >= cjNewSize))
     {
-        newReg->rdh.nRgnSize = 0;
-        return FALSE;
+        oldRects = NULL;
+    }
+    else
+    {
+        newReg->rdh.nRgnSize = cjNewSize;
+        newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
+                                               newReg->rdh.nRgnSize,
+                                               TAG_REGION);
+        if (newReg->Buffer == NULL)
+        {
+            newReg->rdh.nRgnSize = 0;
+            return FALSE;
+        }
     }
 
     /* Initialize ybot and ytop.
@@ -1184,8 +1200,10 @@ REGION_RegionOp(
      * rectangles in the region. This never goes to 0, however...
      *
      * Only do this stuff if the number of rectangles allocated is more than
-     * twice the number of rectangles in the region (a simple optimization...). */
+     * twice the number of rectangles in the region (a simple optimization...).
+     * Small buffers are kept, the next operation on the region can reuse them. */
     if ((newReg->rdh.nRgnSize > (2 * newReg->rdh.nCount * sizeof(RECT))) &&
+        (newReg->rdh.nRgnSize > RGN_KEEP_BUFFER_SIZE) &&
         (newReg->rdh.nCount > 2))
     {
         if (REGION_NOT_EMPTY(newReg))
@@ -1224,7 +1242,7 @@ REGION_RegionOp(
 
     newReg->rdh.iType = RDH_RECTANGLES;
 
-    if (oldRects != &newReg->rdh.rcBound)
+    if ((oldRects != NULL) && (oldRects != &newReg->rdh.rcBound))
         ExFreePoolWithTag(oldRects, TAG_REGION);
     return TRUE;
 }
@@ -1297,6 +1315,74 @@ REGION_IntersectO(
     return TRUE;
 }
 
+/*!
+ * Intersects a region with a single rectangle. Every rectangle of the
+ * region is clipped on its own, which never yields more rectangles, so
+ * this works in place when newReg is reg.
+ */
+static
+BOOL
+FASTCALL
+REGION_IntersectRectRgn(
+    PREGION newReg,
+    PREGION reg,
+    const RECTL *prcl)
+{
+    RECTL rcClip = *prcl;
+    PRECTL prclSrc;
+    ULONG cRects, iBand, iBandEnd, i;
+    INT top, bottom, left, right;
+    INT prevBand = 0, curBand;
+
+    cRects = reg->rdh.nCount;
+    if (newReg != reg)
+    {
+        /* Don't let the buffer grow copy the old rects */
+        newReg->rdh.nCount = 0;
+        if (!REGION_bEnsureBufferSize(newReg, cRects))
+            return FALSE;
+    }
+
+    prclSrc = reg->Buffer;
+    newReg->rdh.nCount = 0;
+
+    for (iBand = 0; iBand < cRects; iBand = iBandEnd)
+    {
+        /* Find the end of the band */
+        iBandEnd = iBand + 1;
+        while ((iBandEnd < cRects) && (prclSrc[iBandEnd].top == prclSrc[iBand].top))
+            iBandEnd++;
+
+        top = max(prclSrc[iBand].top, rcClip.top);
+        bottom = min(prclSrc[iBand].bottom, rcClip.bottom);
+        if (top >= bottom)
+        {
+            /* Bands are sorted, none of the rest can be inside */
+            if (prclSrc[iBand].top >= rcClip.bottom)
+                break;
+
+            continue;
+        }
+
+        /* The new rects are never written past the one being read */
+        curBand = newReg->rdh.nCount;
+        for (i = iBand; i < iBandEnd; i++)
+        {
+            left = max(prclSrc[i].left, rcClip.left);
+            right = min(prclSrc[i].right, rcClip.right);
+            if (left < right)
+                REGION_vAddRect(newReg, left, top, right, bottom);
+        }
+
+        /* Clipping may have made this band look like the previous one */
+        if (newReg->rdh.nCount != curBand)
+            prevBand = REGION_Coalesce(newReg, prevBand, curBand);
+    }
+
+    newReg->rdh.iType = RDH_RECTANGLES;
+    return TRUE;
+}
+
 /***********************************************************************
  * REGION_IntersectRegion
  */
@@ -1315,6 +1401,16 @@ REGION_IntersectRegion(
     {
         newReg->rdh.nCount = 0;
     }
+    else if (reg2->rdh.nCount == 1)
+    {
+        if (!REGION_IntersectRectRgn(newReg, reg1, &reg2->Buffer[0]))
+            return FALSE;
+    }
+    else if (reg1->rdh.nCount == 1)
+    {
+        if (!REGION_IntersectRectRgn(newReg, reg2, &reg1->Buffer[0]))
+            return FALSE;
+    }
     else
     {
         if (!REGION_RegionOp(newReg,
@@ -1469,6 +1565,63 @@ REGION_UnionO (
     return TRUE;
 }
 
+/*!
+ * Unites two regions that don't share any scanline, with all of regTop
+ * above regBottom. The bands just have to be put after each other, only
+ * the two bands where they meet might be coalesced.
+ */
+static
+BOOL
+FASTCALL
+REGION_bAppendRegion(
+    PREGION newReg,
+    PREGION regTop,
+    PREGION regBottom)
+{
+    ULONG cTopRects = regTop->rdh.nCount;
+    ULONG cBottomRects = regBottom->rdh.nCount;
+    INT prevBand;
+
+    NT_ASSERT(regTop != regBottom);
+
+    /* Keep the rects of newReg if it is a source region */
+    if ((newReg != regTop) && (newReg != regBottom))
+        newReg->rdh.nCount = 0;
+
+    if (!REGION_bEnsureBufferSize(newReg, cTopRects + cBottomRects))
+        return FALSE;
+
+    if (newReg == regBottom)
+    {
+        RtlMoveMemory(&newReg->Buffer[cTopRects],
+                      newReg->Buffer,
+                      cBottomRects * sizeof(RECTL));
+        COPY_RECTS(newReg->Buffer, regTop->Buffer, cTopRects);
+    }
+    else
+    {
+        if (newReg != regTop)
+            COPY_RECTS(newReg->Buffer, regTop->Buffer, cTopRects);
+
+        COPY_RECTS(&newReg->Buffer[cTopRects], regBottom->Buffer, cBottomRects);
+    }
+
+    newReg->rdh.nCount = cTopRects + cBottomRects;
+
+    /* Find the last band of the top region */
+    prevBand = cTopRects - 1;
+    while ((prevBand > 0) &&
+           (newReg->Buffer[prevBand - 1].top == newReg->Buffer[prevBand].top))
+    {
+        prevBand--;
+    }
+
+    (VOID)REGION_Coalesce(newReg, prevBand, cTopRects);
+
+    newReg->rdh.iType = RDH_RECTANGLES;
+    return TRUE;
+}
+
 /***********************************************************************
  * REGION_UnionRegion
  */
@@ -1539,12 +1692,49 @@ REGION_UnionRegion(
         return ret;
     }
 
-    if ((ret = REGION_RegionOp(newReg,
-                    reg1,
-                    reg2,
-                    REGION_UnionO,
-                    REGION_UnionNonO,
-                    REGION_UnionNonO)))
+    /* Two rectangles that make up a single one */
+    if ((reg1->rdh.nCount == 1) && (reg2->rdh.nCount == 1) &&
+        (((reg1->rdh.rcBound.top == reg2->rdh.rcBound.top) &&
+          (reg1->rdh.rcBound.bottom == reg2->rdh.rcBound.bottom) &&
+          (reg1->rdh.rcBound.left <= reg2->rdh.rcBound.right) &&
+          (reg2->rdh.rcBound.left <= reg1->rdh.rcBound.right)) ||
+         ((reg1->rdh.rcBound.left == reg2->rdh.rcBound.left) &&
+          (reg1->rdh.rcBound.right == reg2->rdh.rcBound.right) &&
+          (reg1->rdh.rcBound.top <= reg2->rdh.rcBound.bottom) &&
+          (reg2->rdh.rcBound.top <= reg1->rdh.rcBound.bottom))))
+    {
+        if (!REGION_bEnsureBufferSize(newReg, 1))
+            return FALSE;
+
+        REGION_SetRectRgn(newReg,
+                          min(reg1->rdh.rcBound.left, reg2->rdh.rcBound.left),
+                          min(reg1->rdh.rcBound.top, reg2->rdh.rcBound.top),
+                          max(reg1->rdh.rcBound.right, reg2->rdh.rcBound.right),
+                          max(reg1->rdh.rcBound.bottom, reg2->rdh.rcBound.bottom));
+        return TRUE;
+    }
+
+    /* One region is completely above the other, like when a region is
+     * built from rectangles top to bottom */
+    if (reg1->rdh.rcBound.bottom <= reg2->rdh.rcBound.top)
+    {
+        ret = REGION_bAppendRegion(newReg, reg1, reg2);
+    }
+    else if (reg2->rdh.rcBound.bottom <= reg1->rdh.rcBound.top)
+    {
+        ret = REGION_bAppendRegion(newReg, reg2, reg1);
+    }
+    else
+    {
+        ret = REGION_RegionOp(newReg,
+                              reg1,
+                              reg2,
+                              REGION_UnionO,
+                              REGION_UnionNonO,
+                              REGION_UnionNonO);
+    }
+
+    if (ret)
     {
     newReg->rdh.rcBound.left = min(reg1->rdh.rcBound.left, reg2->rdh.rcBound.left);
     newReg->rdh.rcBound.top = min(reg1->rdh.rcBound.top, reg2->rdh.rcBound.top);
@@ -1770,36 +1960,26 @@ REGION_XorRegion(
     PREGION sra,
     PREGION srb)
 {
-    HRGN htra, htrb;
-    PREGION tra, trb;
+    REGION tra, trb;
     BOOL ret;
 
-    // FIXME: Don't use a handle
-    tra = REGION_AllocRgnWithHandle(sra->rdh.nCount + 1);
-    if (tra == NULL)
-    {
-        return FALSE;
-    }
-    htra = tra->BaseObject.hHmgr;
+    /* The temporary regions don't need a handle, only a buffer */
+    tra.Buffer = &tra.rdh.rcBound;
+    tra.rdh.nCount = 0;
+    tra.rdh.nRgnSize = sizeof(RECTL);
+    trb.Buffer = &trb.rdh.rcBound;
+    trb.rdh.nCount = 0;
+    trb.rdh.nRgnSize = sizeof(RECTL);
 
-    // FIXME: Don't use a handle
-    trb = REGION_AllocRgnWithHandle(srb->rdh.nCount + 1);
-    if (trb == NULL)
-    {
-        REGION_UnlockRgn(tra);
-        GreDeleteObject(htra);
-        return FALSE;
-    }
-    htrb = trb->BaseObject.hHmgr;
+    ret = REGION_SubtractRegion(&tra, sra, srb) &&
+          REGION_SubtractRegion(&trb, srb, sra) &&
+          REGION_UnionRegion(dr, &tra, &trb);
 
-    ret = REGION_SubtractRegion(tra, sra, srb) &&
-          REGION_SubtractRegion(trb, srb, sra) &&
-          REGION_UnionRegion(dr, tra, trb);
-    REGION_UnlockRgn(tra);
-    REGION_UnlockRgn(trb);
+    if ((tra.Buffer != NULL) && (tra.Buffer != &tra.rdh.rcBound))
+        ExFreePoolWithTag(tra.Buffer, TAG_REGION);
+    if ((trb.Buffer != NULL) && (trb.Buffer != &trb.rdh.rcBound))
+        ExFreePoolWithTag(trb.Buffer, TAG_REGION);
 
-    GreDeleteObject(htra);
-    GreDeleteObject(htrb);
     return ret;
 }
 
@@ -91,6 +91,9 @@ typedef enum _GDIBATCHCMD
     GdiBCSelObj,
     GdiBCDelObj,
     GdiBCDelRgn,
+    GdiBCLineTo,
+    GdiBCRectangle,
+    GdiBCSetPixel,
 } GDIBATCHCMD, *PGDIBATCHCMD;
 
 typedef enum _TRANSFORMTYPE
@@ -197,6 +200,7 @@ typedef DWORD LFTYPE;
 /* DEFINES *******************************************************************/
 
 #define GDIBATCHBUFSIZE 0x136*4
+/* Also the default limit, which flushes only when the buffer is full */
 #define GDI_BATCH_LIMIT 20
 
 // NtGdiGetCharWidthW Flags
@@ -451,6 +455,26 @@ typedef struct _CFONT
     DWORD           dwCFCount;
 } CFONT, *PCFONT;
 
+/* NtGdiGetStats, ReactOS specific */
+#define GS_GLYPH_CACHE_INFO 0x100
+#define GS_GDI_BATCH_INFO   0x101
+
+typedef struct _GLYPH_CACHE_INFO
+{
+    ULONG ulHits;               // Glyphs found in the cache
+    ULONG ulMisses;             // Glyphs that had to be rendered
+    ULONG ulEvictions;          // Glyphs dropped to stay within the size limit
+    ULONG ulEntries;            // Glyphs currently cached
+    ULONG_PTR cjSize;           // Bytes currently cached
+    ULONG_PTR cjMaxSize;        // Size limit of the cache
+} GLYPH_CACHE_INFO, *PGLYPH_CACHE_INFO;
+
+typedef struct _GDI_BATCH_INFO
+{
+    ULONG ulFlushes;            // Batches flushed by the process
+    ULONG ulCommands;           // Commands in these batches
+} GDI_BATCH_INFO, *PGDI_BATCH_INFO;
+
 /* GDI Batch structures. */
 typedef struct _GDIBATCHHDR
 {
@@ -552,6 +576,57 @@ typedef struct _GDIBSEXTSELCLPRGN
   RECTL rcl;
 } GDIBSEXTSELCLPRGN, *PGDIBSEXTSELCLPRGN;
 
+/* Attribute snapshot of GdiBCLineTo, GdiBCRectangle and GdiBCSetPixel. */
+typedef struct _GDIBSDRAWATTR
+{
+  HANDLE hpen;
+  HANDLE hbrush;
+  COLORREF crForegroundClr;
+  COLORREF crBackgroundClr;
+  COLORREF crBrushClr;
+  COLORREF crPenClr;
+  ULONG ulForegroundClr;
+  ULONG ulBackgroundClr;
+  ULONG ulBrushClr;
+  ULONG ulPenClr;
+  POINTL ptlViewportOrg;
+} GDIBSDRAWATTR, *PGDIBSDRAWATTR;
+
+typedef struct _GDIBSLINETO
+{
+  GDIBATCHHDR gbHdr;
+  GDIBSDRAWATTR gbAttr;
+  POINTL ptlStart; // Current position when LineTo was called
+  POINTL ptlEnd;
+  ULONG flDirty;   // DIRTY_PTFXCURRENT and DIRTY_STYLESTATE at that time
+} GDIBSLINETO, *PGDIBSLINETO;
+
+typedef struct _GDIBSRECTANGLE
+{
+  GDIBATCHHDR gbHdr;
+  GDIBSDRAWATTR gbAttr;
+  RECTL rcl;
+} GDIBSRECTANGLE, *PGDIBSRECTANGLE;
+
+typedef struct _GDIBSPIXEL
+{
+  LONG x;
+  LONG y;
+  COLORREF crColor;
+} GDIBSPIXEL, *PGDIBSPIXEL;
+
+//
+// Consecutive SetPixelV calls on the same DC grow the pixel array of one
+// command, as long as the buffer has room.
+//
+typedef struct _GDIBSSETPIXEL
+{
+  GDIBATCHHDR gbHdr;
+  GDIBSDRAWATTR gbAttr;
+  ULONG Count;
+  GDIBSPIXEL Pixels[1];
+} GDIBSSETPIXEL, *PGDIBSSETPIXEL;
+
 /* Use with GdiBCSelObj, GdiBCDelObj and GdiBCDelRgn. */
 typedef struct _GDIBSOBJECT
 {
@@ -366,7 +366,8 @@ InitInputImpl(VOID)
         ASSERT(FALSE);
         return STATUS_UNSUCCESSFUL;
     }
-    KeInitializeTimer(MasterTimer);
+    /* Reset on wakeup, it is only set again while timers are pending */
+    KeInitializeTimerEx(MasterTimer, SynchronizationTimer);
 
     return STATUS_SUCCESS;
 }
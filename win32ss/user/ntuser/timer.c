@@ -14,7 +14,17 @@ DBG_DEFAULT_CHANNEL(UserTimer);
 /* GLOBALS *******************************************************************/
 
 static LIST_ENTRY TimersListHead;
-static LONG TimeLast = 0;
+
+/* The counting timers, as a binary min-heap ordered by due time */
+static PTIMER *TimerHeap = NULL;
+static ULONG TimerHeapCount = 0;
+static ULONG TimerHeapSize = 0;
+
+#define TIMER_HEAP_INVALID      ((ULONG)-1)
+#define TIMER_HEAP_INITIAL_SIZE 64
+
+/* Wakeups are rounded up to this, so that close timers share one */
+#define TIMER_GRANULARITY       USER_TIMER_MINIMUM
 
 /* Windows 2000 has room for 32768 window-less timers */
 #define NUM_WINDOW_LESS_TIMERS   32768
@@ -46,6 +56,169 @@ ERESOURCE TimerLock;
 
 
 /* FUNCTIONS *****************************************************************/
+
+/* Milliseconds since boot, this doesn't wrap like the tick count */
+static
+ULONGLONG
+FASTCALL
+TimerGetTime(VOID)
+{
+  return KeQueryInterruptTime() / 10000;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSet(ULONG Index, PTIMER pTmr)
+{
+  TimerHeap[Index] = pTmr;
+  pTmr->iHeap = Index;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftUp(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Parent;
+
+  while (Index > 0)
+  {
+     Parent = (Index - 1) / 2;
+     if (TimerHeap[Parent]->DueTime <= pTmr->DueTime)
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Parent]);
+     Index = Parent;
+  }
+
+  TimerHeapSet(Index, pTmr);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftDown(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Child;
+
+  while ((Child = 2 * Index + 1) < TimerHeapCount)
+  {
+     if ((Child + 1 < TimerHeapCount) &&
+         (TimerHeap[Child + 1]->DueTime < TimerHeap[Child]->DueTime))
+        Child++;
+
+     if (pTmr->DueTime <= TimerHeap[Child]->DueTime)
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Child]);
+     Index = Child;
+  }
+
+  TimerHeapSet(Index, pTmr);
+}
+
+//
+// Makes sure that one more timer fits into the heap.
+//
+static
+BOOL
+FASTCALL
+TimerHeapReserve(VOID)
+{
+  PTIMER *NewHeap;
+  ULONG NewSize;
+
+  if (TimerHeapCount < TimerHeapSize)
+     return TRUE;
+
+  NewSize = TimerHeapSize ? TimerHeapSize * 2 : TIMER_HEAP_INITIAL_SIZE;
+  NewHeap = ExAllocatePoolWithTag(PagedPool, NewSize * sizeof(PTIMER), USERTAG_TIMER);
+  if (!NewHeap)
+     return FALSE;
+
+  if (TimerHeap)
+  {
+     RtlCopyMemory(NewHeap, TimerHeap, TimerHeapCount * sizeof(PTIMER));
+     ExFreePoolWithTag(TimerHeap, USERTAG_TIMER);
+  }
+
+  TimerHeap = NewHeap;
+  TimerHeapSize = NewSize;
+  return TRUE;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapRemove(PTIMER pTmr)
+{
+  ULONG Index = pTmr->iHeap;
+  PTIMER pLast;
+
+  if (Index == TIMER_HEAP_INVALID)
+     return;
+
+  pTmr->iHeap = TIMER_HEAP_INVALID;
+  pLast = TimerHeap[--TimerHeapCount];
+  if (pLast == pTmr)
+     return;
+
+  /* Move the last timer into the hole, then restore the heap order */
+  TimerHeapSet(Index, pLast);
+  if ((Index > 0) && (pLast->DueTime < TimerHeap[(Index - 1) / 2]->DueTime))
+     TimerHeapSiftUp(Index);
+  else
+     TimerHeapSiftDown(Index);
+}
+
+//
+// (Re)queues a timer. Room for it must have been reserved.
+//
+static
+VOID
+FASTCALL
+TimerHeapSchedule(PTIMER pTmr, ULONGLONG DueTime)
+{
+  TimerHeapRemove(pTmr);
+
+  ASSERT(TimerHeapCount < TimerHeapSize);
+  pTmr->DueTime = DueTime;
+  TimerHeapSet(TimerHeapCount++, pTmr);
+  TimerHeapSiftUp(pTmr->iHeap);
+}
+
+//
+// Programs the master timer for the next due timer, or stops it when
+// there is none, so the raw input thread only wakes up when needed.
+// The wakeup is rounded up to the timer granularity, all timers that
+// become due until then are handled together.
+//
+static
+VOID
+FASTCALL
+TimerSetMasterTimer(ULONGLONG Time)
+{
+  LARGE_INTEGER DueTime;
+  ULONGLONG Wakeup, Wait;
+
+  ASSERT(MasterTimer != NULL);
+
+  if (TimerHeapCount == 0)
+  {
+     KeCancelTimer(MasterTimer);
+     return;
+  }
+
+  Wakeup = TimerHeap[0]->DueTime + TIMER_GRANULARITY - 1;
+  Wakeup -= Wakeup % TIMER_GRANULARITY;
+  Wait = (Wakeup > Time) ? Wakeup - Time : 1;
+  DueTime.QuadPart = -(LONGLONG)Wait * 10000;
+  KeSetTimer(MasterTimer, DueTime, NULL);
+}
+
 static
 PTIMER
 FASTCALL
@@ -58,6 +231,7 @@ CreateTimer(VOID)
   if (Ret)
   {
      Ret->head.h = Handle;
+     Ret->iHeap = TIMER_HEAP_INVALID;
      InsertTailList(&TimersListHead, &Ret->ptmrList);
   }
 
@@ -74,6 +248,7 @@ RemoveTimer(PTIMER pTmr)
   {
      /* Set the flag, it will be removed when ready */
      RemoveEntryList(&pTmr->ptmrList);
+     TimerHeapRemove(pTmr);
      if ((pTmr->pWnd == NULL) && (!(pTmr->flags & TMRF_SYSTEM))) // System timers are reusable.
      {
         UINT_PTR IDEvent;
@@ -182,8 +357,7 @@ IntSetTimer( PWND Window,
 {
   PTIMER pTmr;
   UINT Ret = IDEvent;
-  LARGE_INTEGER DueTime;
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
+  ULONGLONG Time;
 
 #if 0
   /* Windows NT/2k/XP behaviour */
@@ -213,8 +387,17 @@ IntSetTimer( PWND Window,
   if ((Window) && (IDEvent == 0))
      Ret = 1;
 
+  TimerEnterExclusive();
   pTmr = FindTimer(Window, IDEvent, Type);
 
+  if ((!pTmr) && (!TimerHeapReserve()))
+  {
+     TimerLeave();
+     ERR("Unable to grow the timer heap\n");
+     EngSetLastError(ERROR_NOT_ENOUGH_MEMORY);
+     return 0;
+  }
+
   if ((!pTmr) && (Window == NULL) && (!(Type & TMRF_SYSTEM)))
   {
       IntLockWindowlessTimerBitmap();
@@ -224,6 +407,7 @@ IntSetTimer( PWND Window,
       if (IDEvent == (UINT_PTR) -1)
       {
          IntUnlockWindowlessTimerBitmap();
+         TimerLeave();
          ERR("Unable to find a free window-less timer id\n");
          EngSetLastError(ERROR_NO_SYSTEM_RESOURCES);
          ASSERT(FALSE);
@@ -239,7 +423,11 @@ IntSetTimer( PWND Window,
   if (!pTmr)
   {
      pTmr = CreateTimer();
-     if (!pTmr) return 0;
+     if (!pTmr)
+     {
+        TimerLeave();
+        return 0;
+     }
 
      if (Window && (Type & TMRF_TIFROMWND))
         pTmr->pti = Window->head.pti->pEThread->Tcb.Win32Thread;
@@ -252,22 +440,28 @@ IntSetTimer( PWND Window,
      }
 
      pTmr->pWnd    = Window;
-     pTmr->cmsCountdown = Elapse;
      pTmr->cmsRate = Elapse;
      pTmr->pfn     = TimerFunc;
      pTmr->nID     = IDEvent;
-     pTmr->flags   = Type|TMRF_INIT;
+     pTmr->flags   = Type;
   }
   else
   {
-     pTmr->cmsCountdown = Elapse;
      pTmr->cmsRate = Elapse;
   }
 
-  ASSERT(MasterTimer != NULL);
-  // Start the timer thread!
-  if (TimersListHead.Flink == TimersListHead.Blink) // There is only one timer
-     KeSetTimer(MasterTimer, DueTime, NULL);
+  // Fired one shot timers stay idle.
+  if (!(pTmr->flags & TMRF_WAITING))
+  {
+     Time = TimerGetTime();
+     TimerHeapSchedule(pTmr, Time + Elapse);
+
+     // Wake up the timer thread earlier if this one is due first.
+     if (TimerHeap[0] == pTmr)
+        TimerSetMasterTimer(Time);
+  }
+
+  TimerLeave();
 
   return Ret;
 }
@@ -445,74 +639,59 @@ VOID
 FASTCALL
 ProcessTimers(VOID)
 {
-  LARGE_INTEGER DueTime;
-  LONG Time;
-  PLIST_ENTRY pLE;
+  ULONGLONG Time, DueTime;
   PTIMER pTmr;
   LONG TimerCount = 0;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  Time = EngGetTickCount32();
-
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
+  Time = TimerGetTime();
 
-  while(pLE != &TimersListHead)
+  // Only the due timers are looked at, they are at the top of the heap.
+  while (TimerHeapCount && (TimerHeap[0]->DueTime <= Time))
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = TimerHeap[0];
     TimerCount++;
-    if (pTmr->flags & TMRF_WAITING)
+
+    // Requeue it before the callback below, which may kill the timer.
+    DueTime = pTmr->DueTime + pTmr->cmsRate;
+    if (DueTime <= Time)
+       DueTime = Time + pTmr->cmsRate; // Fell behind, don't fire in a burst.
+
+    ASSERT(pTmr->pti);
+    if ((pTmr->flags & TMRF_READY) || (pTmr->pti->TIF_flags & TIF_INCLEANUP))
     {
-       pLE = pTmr->ptmrList.Flink;
-       pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+       TimerHeapSchedule(pTmr, DueTime);
        continue;
     }
 
-    if (pTmr->flags & TMRF_INIT)
+    if (pTmr->flags & TMRF_ONESHOT)
     {
-       pTmr->flags &= ~TMRF_INIT; // Skip this run.
+       pTmr->flags |= TMRF_WAITING;
+       TimerHeapRemove(pTmr);
     }
     else
-    {
-       if (pTmr->cmsCountdown < 0)
-       {
-          ASSERT(pTmr->pti);
-          if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
-          {
-             if (pTmr->flags & TMRF_ONESHOT)
-                pTmr->flags |= TMRF_WAITING;
+       TimerHeapSchedule(pTmr, DueTime);
 
-             if (pTmr->flags & TMRF_RIT)
-             {
-                // Hard coded call here, inside raw input thread.
-                pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
-             }
-             else
-             {
-                pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
-                // Set thread message queue for this timer.
-                if (pTmr->pti)
-                {  // Wakeup thread
-                   pTmr->pti->cTimersReady++;
-                   ASSERT(pTmr->pti->pEventQueueServer != NULL);
-                   MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
-                }
-             }
-          }
-          pTmr->cmsCountdown = pTmr->cmsRate;
+    if (pTmr->flags & TMRF_RIT)
+    {
+       // Hard coded call here, inside raw input thread.
+       pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
+    }
+    else
+    {
+       pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
+       // Set thread message queue for this timer.
+       if (pTmr->pti)
+       {  // Wakeup thread
+          pTmr->pti->cTimersReady++;
+          ASSERT(pTmr->pti->pEventQueueServer != NULL);
+          MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
        }
-       else
-          pTmr->cmsCountdown -= Time - TimeLast;
     }
-
-    pLE = pLE->Flink;
   }
 
-  // Restart the timer thread!
-  ASSERT(MasterTimer != NULL);
-  KeSetTimer(MasterTimer, DueTime, NULL);
-
-  TimeLast = Time;
+  // Sleep until the next timer is due.
+  TimerSetMasterTimer(Time);
 
   TimerLeave();
   TRACE("TimerCount = %d\n", TimerCount);
@@ -7,7 +7,8 @@ typedef struct _TIMER
   PTHREADINFO    pti;
   PWND           pWnd;         // hWnd
   UINT_PTR       nID;          // Specifies a nonzero timer identifier.
-  INT            cmsCountdown; // uElapse
+  ULONGLONG      DueTime;      // Absolute, in ms of interrupt time
+  ULONG          iHeap;        // Index in the deadline heap
   INT            cmsRate;      // uElapse
   FLONG          flags;
   TIMERPROC      pfn;          // lpTimerFunc
@@ -19,7 +20,6 @@ typedef struct _TIMER
 #define TMRF_READY   0x0001
 #define TMRF_SYSTEM  0x0002
 #define TMRF_RIT     0x0004
-#define TMRF_INIT    0x0008
 #define TMRF_ONESHOT 0x0010
 #define TMRF_WAITING 0x0020
 #define TMRF_TIFROMWND 0x0040
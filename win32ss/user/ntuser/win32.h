@@ -283,6 +283,10 @@ typedef struct _PROCESSINFO
     struct _GDI_POOL* pPoolBrushAttr;
     struct _GDI_POOL* pPoolRgnAttr;
 
+    /* GDI batching statistics, see GS_GDI_BATCH_INFO */
+    LONG cGdiBatchFlushes;
+    LONG cGdiBatchCommands;
+
 #if DBG
     BYTE DbgChannelLevel[DbgChCount];
 #ifndef __cplusplus